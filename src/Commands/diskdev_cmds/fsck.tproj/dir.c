@@ -346,7 +346,15 @@ adjust(idesc, lcnt)
 
 	dp = ginode(idesc->id_number);
 	if (dp->di_nlink == lcnt) {
-		if (linkup(idesc->id_number, (ino_t)0) == 0)
+		/*
+		 * With soft updates a crash leaves inodes whose last
+		 * name was removed on disk before their link count
+		 * dropped.  They were being freed; do not reconnect
+		 * them to lost+found.
+		 */
+		if (preen && (sblock.fs_flags & FS_DOSOFTDEP))
+			clri(idesc, "UNREF", 1);
+		else if (linkup(idesc->id_number, (ino_t)0) == 0)
 			clri(idesc, "UNREF", 0);
 	} else {
 		pwarn("LINK COUNT %s", (lfdir == idesc->id_number) ? lfname :
@@ -198,6 +198,29 @@ again:
 					warnx(OPTWARN, "space", "<", MINFREE);
 				continue;
 
+			case 'n':
+				name = "soft updates";
+				if (argc < 1)
+					errx(10, "-n: missing %s", name);
+				argc--, argv++;
+				if (strcmp(*argv, "enable") == 0)
+					i = FS_DOSOFTDEP;
+				else if (strcmp(*argv, "disable") == 0)
+					i = 0;
+				else
+					errx(10, "bad %s (options are `enable' or `disable')",
+					    name);
+				if ((sblock.fs_flags & FS_DOSOFTDEP) == i) {
+					warnx("%s remains unchanged as %sd",
+					    name, *argv);
+					continue;
+				}
+				warnx("%s changes from %s to %sd", name,
+				    i ? "disabled" : "enabled", *argv);
+				sblock.fs_flags = (sblock.fs_flags &
+				    ~FS_DOSOFTDEP) | i;
+				continue;
+
 			case 'o':
 				name = "optimization preference";
 				if (argc < 1)
@@ -258,6 +281,8 @@ again:
 		    sblock.fs_maxbpg);
 		fprintf(stdout, "\tminimum percentage of free space %d%%\n",
 		    sblock.fs_minfree);
+		fprintf(stdout, "\tsoft updates: %s\n",
+		    (sblock.fs_flags & FS_DOSOFTDEP) ? "enabled" : "disabled");
 		fprintf(stdout, "\toptimization preference: %s\n",
 		    chg[sblock.fs_optim]);
 		fprintf(stdout, "\ttrack skew %d sectors\n",
@@ -287,6 +312,7 @@ usage()
 	fprintf(stderr, "\t-a maximum contiguous blocks\n");
 	fprintf(stderr, "\t-e maximum blocks per file in a cylinder group\n");
 	fprintf(stderr, "\t-m minimum percentage of free space\n");
+	fprintf(stderr, "\t-n soft updates (`enable' or `disable')\n");
 	fprintf(stderr, "\t-o optimization preference (`space' or `time')\n");
 	fprintf(stderr, "\t-t track skew in sectors\n");
 	exit(2);
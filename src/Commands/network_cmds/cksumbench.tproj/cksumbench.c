@@ -0,0 +1,570 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * "Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.0 (the 'License').  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License."
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+
+/*
+ *	cksumbench - check and time the i386 Internet checksum loops.
+ *
+ *	cksumbench [-n checks] [-s size] [-i iterations] [-S seed] [-m]
+ *
+ *	Carries copies of the block loops in the kernel's
+ *	machdep/i386/in_cksum.c: the 32-byte adc loop, the MMX loop
+ *	and the copy-and-checksum loop, each followed by the short
+ *	tail.  First it sums checks (default 100000) buffers of random
+ *	length (0 to 8K) at random alignment (0 to 7) with each of them
+ *	and with the reference RFC 1071 sum the portable in_cksum()
+ *	computes, and stops at the first difference; the copy loop's
+ *	output is compared with its input as well.  Then it times each
+ *	on a size byte buffer (default 1500, an Ethernet packet) and
+ *	prints the rate in MB/s.  -m leaves out the MMX loop; it is
+ *	also left out when CPUID does not report MMX.
+ *
+ *	The kernel's MMX loop borrows the FPU, which costs an fnsave
+ *	that this program does not pay; compare the two loops at and
+ *	above the kernel's CKSUM_MMX_MIN.  The kernel uses the MMX
+ *	loop only when booted with cksum_mmx=1, which is worth doing
+ *	only where this shows it ahead.  The source builds on other
+ *	machines, where only the reference sum is timed.
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define	MAXLEN		8192
+#define	MB		(1024 * 1024)
+
+static int	checks = 100000;
+static int	size = 1500;
+static int	iterations;
+static int	use_mmx = 1;
+static volatile unsigned int	sink;
+
+static void
+usage()
+{
+	fprintf(stderr, "usage: cksumbench [-n checks] [-s size] "
+	    "[-i iterations] [-S seed] [-m]\n");
+	exit(1);
+}
+
+static double
+now()
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+/*
+ * The reference: 16-bit words in host order, an odd last byte
+ * padded with zero, folded and complemented.
+ */
+static unsigned int
+ref_cksum(buf, len)
+	unsigned char	*buf;
+	int		len;
+{
+	unsigned long	sum = 0;
+	union {
+		unsigned char	c[2];
+		unsigned short	s;
+	} s_util;
+
+	for (; len > 1; len -= 2, buf += 2) {
+		s_util.c[0] = buf[0];
+		s_util.c[1] = buf[1];
+		sum += s_util.s;
+	}
+	if (len) {
+		s_util.c[0] = buf[0];
+		s_util.c[1] = 0;
+		sum += s_util.s;
+	}
+	sum = (sum >> 16) + (sum & 0xffff);
+	sum += sum >> 16;
+	return (~sum & 0xffff);
+}
+
+#ifdef __i386__
+
+/*
+ * These must match machdep/i386/in_cksum.c.  The instructions
+ * are the kernel's; only the operand lists are written so that
+ * newer compilers take them as well.
+ */
+static unsigned long
+oc_cksum_tail(buf, len, oldsum)
+	unsigned char	*buf;
+	int		len;
+	unsigned long	oldsum;
+{
+	unsigned long	sum;
+	int		d1;
+	unsigned char	*d2;
+
+	asm volatile(
+	"	testb	$1,%%cl\n"
+	"	jne	5f\n"
+	"	testb	$2,%%cl\n"
+	"	jne	7f\n"
+	"0:\n"
+	"	adc	$0,%%eax\n"
+	"	shr	$3,%%ecx\n"
+	"	jnc	1f\n"
+	"	add	(%%esi),%%eax\n"
+	"	adc	$0,%%eax\n"
+	"	add	$4,%%esi\n"
+	"1:\n"
+	"	test	%%ecx,%%ecx\n"
+	"	jz	4f\n"
+	"	mov	(%%esi),%%edx\n"
+	"	mov	4(%%esi),%%ebx\n"
+	"	dec	%%ecx\n"
+	"	jz	3f\n"
+	"	add	$8,%%esi\n"
+	"2:\n"
+	"	add	%%edx,%%eax\n"
+	"	mov	(%%esi),%%edx\n"
+	"	adc	%%ebx,%%eax\n"
+	"	mov	4(%%esi),%%ebx\n"
+	"	adc	$0,%%eax\n"
+	"	add	$8,%%esi\n"
+	"	dec	%%ecx\n"
+	"	jnz	2b\n"
+	"3:\n"
+	"	add	%%edx,%%eax\n"
+	"	adc	%%ebx,%%eax\n"
+	"	adc	$0,%%eax\n"
+	"4:\n"
+	"	mov	%%eax,%%edx\n"
+	"	shr	$16,%%edx\n"
+	"	add	%%dx,%%ax\n"
+	"	adc	$0,%%eax\n"
+	"	jmp	8f\n"
+	"5:\n"
+	"	testb	$2,%%cl\n"
+	"	je	6f\n"
+	"	movzwl	-3(%%esi,%%ecx),%%ebx\n"
+	"	add	%%ebx,%%eax\n"
+	"6:\n"
+	"	movzbl	-1(%%esi,%%ecx),%%ebx\n"
+	"	adc	%%ebx,%%eax\n"
+	"	jmp	0b\n"
+	"7:\n"
+	"	movzwl	-2(%%esi,%%ecx),%%ebx\n"
+	"	add	%%ebx,%%eax\n"
+	"	jmp	0b\n"
+	"8:\n"
+	: "=a" (sum), "=c" (d1), "=S" (d2)
+	: "0" (oldsum), "1" (len), "2" (buf)
+	: "ebx", "edx", "cc");
+
+	return (sum & 0xffff);
+}
+
+static unsigned long
+oc_cksum_blocks(buf, nblocks, sum)
+	unsigned char	*buf;
+	int		nblocks;
+	unsigned long	sum;
+{
+	int		d1;
+	unsigned char	*d2;
+
+	asm volatile(
+	"	clc\n"
+	"1:\n"
+	"	adcl	0(%%esi),%%eax\n"
+	"	adcl	4(%%esi),%%eax\n"
+	"	adcl	8(%%esi),%%eax\n"
+	"	adcl	12(%%esi),%%eax\n"
+	"	adcl	16(%%esi),%%eax\n"
+	"	adcl	20(%%esi),%%eax\n"
+	"	adcl	24(%%esi),%%eax\n"
+	"	adcl	28(%%esi),%%eax\n"
+	"	leal	32(%%esi),%%esi\n"
+	"	decl	%%ecx\n"
+	"	jnz	1b\n"
+	"	adcl	$0,%%eax\n"
+	: "=a" (sum), "=c" (d1), "=S" (d2)
+	: "0" (sum), "1" (nblocks), "2" (buf)
+	: "cc");
+
+	return (sum);
+}
+
+#define	CKSUM_MMX_MAXBLOCKS	8192
+
+#define	ADDC(sum, x) \
+	{ (sum) += (x); if ((sum) < (x)) (sum)++; }
+
+static unsigned long
+oc_cksum_mmx(buf, nblocks, sum)
+	unsigned char	*buf;
+	int		nblocks;
+	unsigned long	sum;
+{
+	unsigned long	lanes[2];
+	int		n, d1;
+	unsigned char	*d2;
+
+	while (nblocks > 0) {
+		n = nblocks > CKSUM_MMX_MAXBLOCKS ?
+		    CKSUM_MMX_MAXBLOCKS : nblocks;
+		asm volatile(
+		"	pxor	%%mm7,%%mm7\n"
+		"	pxor	%%mm6,%%mm6\n"
+		"	pxor	%%mm5,%%mm5\n"
+		"1:\n"
+		"	movq	0(%%esi),%%mm0\n"
+		"	movq	8(%%esi),%%mm2\n"
+		"	movq	%%mm0,%%mm1\n"
+		"	movq	%%mm2,%%mm3\n"
+		"	punpcklwd %%mm7,%%mm0\n"
+		"	punpckhwd %%mm7,%%mm1\n"
+		"	punpcklwd %%mm7,%%mm2\n"
+		"	punpckhwd %%mm7,%%mm3\n"
+		"	paddd	%%mm0,%%mm6\n"
+		"	paddd	%%mm1,%%mm5\n"
+		"	paddd	%%mm2,%%mm6\n"
+		"	paddd	%%mm3,%%mm5\n"
+		"	movq	16(%%esi),%%mm0\n"
+		"	movq	24(%%esi),%%mm2\n"
+		"	movq	%%mm0,%%mm1\n"
+		"	movq	%%mm2,%%mm3\n"
+		"	punpcklwd %%mm7,%%mm0\n"
+		"	punpckhwd %%mm7,%%mm1\n"
+		"	punpcklwd %%mm7,%%mm2\n"
+		"	punpckhwd %%mm7,%%mm3\n"
+		"	paddd	%%mm0,%%mm6\n"
+		"	paddd	%%mm1,%%mm5\n"
+		"	paddd	%%mm2,%%mm6\n"
+		"	paddd	%%mm3,%%mm5\n"
+		"	addl	$32,%%esi\n"
+		"	decl	%%ecx\n"
+		"	jnz	1b\n"
+		"	paddd	%%mm5,%%mm6\n"
+		"	movq	%%mm6,(%%edi)\n"
+		: "=c" (d1), "=S" (d2)
+		: "0" (n), "1" (buf), "D" (lanes)
+		: "memory", "cc");
+
+		ADDC(sum, lanes[0]);
+		ADDC(sum, lanes[1]);
+		buf += n << 5;
+		nblocks -= n;
+	}
+	asm volatile("emms");
+
+	return (sum);
+}
+
+static unsigned long
+oc_cksum_copy_blocks(src, dst, nblocks, sum)
+	unsigned char	*src, *dst;
+	int		nblocks;
+	unsigned long	sum;
+{
+	int		d1;
+	unsigned char	*d2, *d3;
+
+	asm volatile(
+	"	clc\n"
+	"1:\n"
+	"	movl	0(%%esi),%%edx\n"
+	"	movl	4(%%esi),%%ebx\n"
+	"	adcl	%%edx,%%eax\n"
+	"	movl	%%edx,0(%%edi)\n"
+	"	adcl	%%ebx,%%eax\n"
+	"	movl	%%ebx,4(%%edi)\n"
+	"	movl	8(%%esi),%%edx\n"
+	"	movl	12(%%esi),%%ebx\n"
+	"	adcl	%%edx,%%eax\n"
+	"	movl	%%edx,8(%%edi)\n"
+	"	adcl	%%ebx,%%eax\n"
+	"	movl	%%ebx,12(%%edi)\n"
+	"	movl	16(%%esi),%%edx\n"
+	"	movl	20(%%esi),%%ebx\n"
+	"	adcl	%%edx,%%eax\n"
+	"	movl	%%edx,16(%%edi)\n"
+	"	adcl	%%ebx,%%eax\n"
+	"	movl	%%ebx,20(%%edi)\n"
+	"	movl	24(%%esi),%%edx\n"
+	"	movl	28(%%esi),%%ebx\n"
+	"	adcl	%%edx,%%eax\n"
+	"	movl	%%edx,24(%%edi)\n"
+	"	adcl	%%ebx,%%eax\n"
+	"	movl	%%ebx,28(%%edi)\n"
+	"	leal	32(%%esi),%%esi\n"
+	"	leal	32(%%edi),%%edi\n"
+	"	decl	%%ecx\n"
+	"	jnz	1b\n"
+	"	adcl	$0,%%eax\n"
+	: "=a" (sum), "=c" (d1), "=S" (d2), "=D" (d3)
+	: "0" (sum), "1" (nblocks), "2" (src), "3" (dst)
+	: "ebx", "edx", "memory", "cc");
+
+	return (sum);
+}
+
+/*
+ * in_cksum() on a single buffer, with the adc or the MMX block loop.
+ */
+static unsigned int
+int_cksum(buf, len)
+	unsigned char	*buf;
+	int		len;
+{
+	unsigned long	sum = 0;
+	int		nblocks;
+
+	if ((nblocks = len >> 5) > 0) {
+		sum = oc_cksum_blocks(buf, nblocks, sum);
+		buf += nblocks << 5;
+		len &= 31;
+	}
+	return (~oc_cksum_tail(buf, len, sum) & 0xffff);
+}
+
+static unsigned int
+mmx_cksum(buf, len)
+	unsigned char	*buf;
+	int		len;
+{
+	unsigned long	sum = 0;
+	int		nblocks;
+
+	if ((nblocks = len >> 5) > 0) {
+		sum = oc_cksum_mmx(buf, nblocks, sum);
+		buf += nblocks << 5;
+		len &= 31;
+	}
+	return (~oc_cksum_tail(buf, len, sum) & 0xffff);
+}
+
+/*
+ * in_cksum_copy(), complemented to compare with the others.
+ */
+static unsigned char	*copy_dst;
+
+static unsigned int
+copy_cksum(buf, len)
+	unsigned char	*buf;
+	int		len;
+{
+	unsigned long	sum = 0;
+	unsigned char	*dst = copy_dst;
+	int		nblocks;
+
+	if ((nblocks = len >> 5) > 0) {
+		sum = oc_cksum_copy_blocks(buf, dst, nblocks, sum);
+		buf += nblocks << 5;
+		dst += nblocks << 5;
+		len &= 31;
+	}
+	bcopy(buf, dst, len);
+	return (~oc_cksum_tail(dst, len, sum) & 0xffff);
+}
+
+/*
+ * CPUID feature bit 23.  Processors that cannot toggle the ID
+ * flag in EFLAGS have no CPUID, and no MMX.
+ */
+static int
+has_mmx()
+{
+	unsigned long	f1, f2, features;
+
+	asm volatile(
+	"	pushfl\n"
+	"	popl	%0\n"
+	"	movl	%0,%1\n"
+	"	xorl	$0x200000,%0\n"
+	"	pushl	%0\n"
+	"	popfl\n"
+	"	pushfl\n"
+	"	popl	%0\n"
+	"	pushl	%1\n"
+	"	popfl\n"
+	: "=&r" (f1), "=&r" (f2));
+	if (((f1 ^ f2) & 0x200000) == 0)
+		return (0);
+	asm volatile(
+	"	pushl	%%ebx\n"
+	"	movl	$1,%%eax\n"
+	"	cpuid\n"
+	"	popl	%%ebx\n"
+	: "=d" (features) : : "eax", "ecx");
+	return ((features & 0x00800000) != 0);
+}
+
+#endif	/* __i386__ */
+
+struct method {
+	char		*name;
+	unsigned int	(*cksum)();
+	int		enabled;
+};
+
+static struct method	methods[] = {
+	{ "reference",	ref_cksum,	1 },
+#ifdef __i386__
+	{ "adc",	int_cksum,	1 },
+	{ "mmx",	mmx_cksum,	1 },
+	{ "copy",	copy_cksum,	1 },
+#endif
+};
+#define	NMETHODS	(sizeof (methods) / sizeof (methods[0]))
+
+static int
+check(buf)
+	unsigned char	*buf;
+{
+	unsigned int	ref, sum;
+	int		i, m, len, align;
+
+	for (i = 0; i < checks; i++) {
+		len = random() % (MAXLEN + 1);
+		align = random() & 7;
+		ref = ref_cksum(buf + align, len);
+		for (m = 1; m < NMETHODS; m++) {
+			if (!methods[m].enabled)
+				continue;
+#ifdef __i386__
+			memset(copy_dst, 0, MAXLEN + 8);
+#endif
+			sum = (*methods[m].cksum)(buf + align, len);
+			if (sum != ref) {
+				printf("%s: length %d, alignment %d: "
+				    "0x%04x, should be 0x%04x\n",
+				    methods[m].name, len, align, sum, ref);
+				return (0);
+			}
+#ifdef __i386__
+			if (methods[m].cksum == copy_cksum &&
+			    memcmp(copy_dst, buf + align, len) != 0) {
+				printf("copy: length %d, alignment %d: "
+				    "bad copy\n", len, align);
+				return (0);
+			}
+#endif
+		}
+		/* new data now and then */
+		if ((i & 1023) == 0)
+			for (len = 0; len < MAXLEN + 8; len++)
+				buf[len] = random();
+	}
+	printf("%d random lengths and alignments checked\n", checks);
+	return (1);
+}
+
+static void
+timeit(buf)
+	unsigned char	*buf;
+{
+	double		start, elapsed;
+	int		i, m;
+
+	if (iterations == 0)
+		iterations = 64 * MB / size;
+	for (m = 0; m < NMETHODS; m++) {
+		if (!methods[m].enabled)
+			continue;
+		start = now();
+		for (i = 0; i < iterations; i++)
+			sink = (*methods[m].cksum)(buf, size);
+		elapsed = now() - start;
+		printf("%-10s %6d bytes x %8d: %7.2fs, %8.1f MB/s\n",
+		    methods[m].name, size, iterations, elapsed,
+		    elapsed > 0 ? (double)size * iterations / MB / elapsed :
+		    0.0);
+	}
+}
+
+int
+main(argc, argv)
+	int	argc;
+	char	**argv;
+{
+	unsigned char	*buf;
+	int		ch, i;
+
+	srandom(1);
+	while ((ch = getopt(argc, argv, "n:s:i:S:m")) != EOF) {
+		switch (ch) {
+		case 'n':
+			checks = atoi(optarg);
+			break;
+		case 's':
+			size = atoi(optarg);
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			break;
+		case 'S':
+			srandom(atoi(optarg));
+			break;
+		case 'm':
+			use_mmx = 0;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind != argc || checks < 0 || size <= 0 || iterations < 0)
+		usage();
+
+#ifdef __i386__
+	if (use_mmx && !has_mmx()) {
+		printf("no MMX\n");
+		use_mmx = 0;
+	}
+	methods[2].enabled = use_mmx;
+#endif
+
+	i = (size > MAXLEN ? size : MAXLEN) + 8;
+	if ((buf = malloc(i)) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+#ifdef __i386__
+	if ((copy_dst = malloc(i)) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+#endif
+	while (i-- > 0)
+		buf[i] = random();
+
+	if (!check(buf))
+		exit(1);
+	timeit(buf);
+	exit(0);
+}
@@ -152,4 +152,13 @@ mbpr(mbaddr)
 	printf("%u requests for memory delayed\n", (unsigned int)mbstat.m_wait);
 	printf("%u calls to protocol drain routines\n",
 	       (unsigned int)mbstat.m_drain);
+	printf("%u mbufs and %u clusters allocated from per-cpu caches\n",
+	       (unsigned int)mbstat.m_cachehits,
+	       (unsigned int)mbstat.m_clcachehits);
+	printf("%u mbuf and %u cluster cache refills\n",
+	       (unsigned int)mbstat.m_refills,
+	       (unsigned int)mbstat.m_clrefills);
+	printf("%u mbuf and %u cluster cache drains\n",
+	       (unsigned int)mbstat.m_drains,
+	       (unsigned int)mbstat.m_cldrains);
 }
@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * "Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.0 (the 'License').  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License."
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+
+/*
+ *	sfbench - loopback TCP throughput of read()/write() against
+ *	sendfile().
+ *
+ *	sfbench [-n passes] [-s megabytes] [file]
+ *
+ *	Sends file (by default a scratch file of -s megabytes, 16 by
+ *	default, made in /tmp) passes times (default 10) over a TCP
+ *	connection to a child process on 127.0.0.1 that reads and
+ *	discards it.  This is done first with read() and write()
+ *	through a 64K buffer, then with sendfile().  The file is read
+ *	once beforehand so both runs start with it cached.
+ *
+ *	For each method it prints the throughput and the sender's
+ *	user and system time per megabyte: the copies sendfile()
+ *	saves show up in the system time.  The source builds on other
+ *	BSD socket systems, where only the read()/write() run is done.
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define	MB		(1024 * 1024)
+#define	BUFSIZE		(64 * 1024)
+
+static int	passes = 10;
+static int	megabytes = 16;
+static char	buf[BUFSIZE];
+
+static void
+usage()
+{
+	fprintf(stderr, "usage: sfbench [-n passes] [-s megabytes] [file]\n");
+	exit(1);
+}
+
+static double
+now()
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+static double
+cputime(ru, which)
+	struct rusage	*ru;
+	int		which;
+{
+	struct timeval	*tv = which ? &ru->ru_stime : &ru->ru_utime;
+
+	return (tv->tv_sec + tv->tv_usec / 1e6);
+}
+
+/*
+ * Make the scratch file, or open the one given.
+ */
+static int
+open_file(name, sizep)
+	char	*name;
+	off_t	*sizep;
+{
+	static char	template[] = "/tmp/sfbench.XXXXXX";
+	struct stat	st;
+	int		fd, i;
+
+	if (name == NULL) {
+		if ((fd = mkstemp(template)) < 0) {
+			perror("sfbench: mkstemp");
+			exit(1);
+		}
+		unlink(template);
+		for (i = 0; i < BUFSIZE; i++)
+			buf[i] = i;
+		for (i = 0; i < megabytes * (MB / BUFSIZE); i++)
+			if (write(fd, buf, BUFSIZE) != BUFSIZE) {
+				perror("sfbench: write");
+				exit(1);
+			}
+	} else if ((fd = open(name, O_RDONLY)) < 0) {
+		perror(name);
+		exit(1);
+	}
+	if (fstat(fd, &st) < 0) {
+		perror("sfbench: fstat");
+		exit(1);
+	}
+	if (st.st_size == 0) {
+		fprintf(stderr, "sfbench: file is empty\n");
+		exit(1);
+	}
+	*sizep = st.st_size;
+
+	/* read it once so both methods start with it cached */
+	lseek(fd, (off_t)0, SEEK_SET);
+	while (read(fd, buf, BUFSIZE) > 0)
+		;
+	return (fd);
+}
+
+/*
+ * Fork a child that accepts one connection and reads until EOF.
+ * Returns the connected socket.
+ */
+static int
+start_sink(pidp)
+	pid_t	*pidp;
+{
+	struct sockaddr_in	sin;
+	int			s, fd, len;
+
+	if ((s = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+		perror("sfbench: socket");
+		exit(1);
+	}
+	bzero((char *)&sin, sizeof (sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(s, (struct sockaddr *)&sin, sizeof (sin)) < 0 ||
+	    listen(s, 1) < 0) {
+		perror("sfbench: bind");
+		exit(1);
+	}
+	len = sizeof (sin);
+	getsockname(s, (struct sockaddr *)&sin, &len);
+
+	switch (*pidp = fork()) {
+	case -1:
+		perror("sfbench: fork");
+		exit(1);
+	case 0:
+		if ((fd = accept(s, NULL, NULL)) < 0)
+			_exit(1);
+		while (read(fd, buf, BUFSIZE) > 0)
+			;
+		_exit(0);
+	}
+	close(s);
+	if ((s = socket(AF_INET, SOCK_STREAM, 0)) < 0 ||
+	    connect(s, (struct sockaddr *)&sin, sizeof (sin)) < 0) {
+		perror("sfbench: connect");
+		exit(1);
+	}
+	return (s);
+}
+
+static int
+send_copy(fd, s, size)
+	int	fd, s;
+	off_t	size;
+{
+	int	n;
+
+	lseek(fd, (off_t)0, SEEK_SET);
+	while ((n = read(fd, buf, BUFSIZE)) > 0)
+		if (write(s, buf, n) != n) {
+			perror("sfbench: write");
+			return (-1);
+		}
+	return (n);
+}
+
+#ifdef NeXT
+static int
+send_file(fd, s, size)
+	int	fd, s;
+	off_t	size;
+{
+	off_t	sent;
+
+	if (sendfile(fd, s, (off_t)0, (size_t)0, NULL, &sent, 0) < 0) {
+		perror("sfbench: sendfile");
+		return (-1);
+	}
+	if (sent != size) {
+		fprintf(stderr, "sfbench: sendfile sent %ld of %ld bytes\n",
+		    (long)sent, (long)size);
+		return (-1);
+	}
+	return (0);
+}
+#endif
+
+static void
+run(name, fn, fd, size)
+	char	*name;
+	int	(*fn)();
+	int	fd;
+	off_t	size;
+{
+	struct rusage	before, after;
+	double		start, elapsed, mbytes;
+	pid_t		pid;
+	int		s, i, status;
+
+	s = start_sink(&pid);
+	getrusage(RUSAGE_SELF, &before);
+	start = now();
+	for (i = 0; i < passes; i++)
+		if ((*fn)(fd, s, size) < 0)
+			break;
+	close(s);
+	waitpid(pid, &status, 0);
+	elapsed = now() - start;
+	getrusage(RUSAGE_SELF, &after);
+
+	if (i == 0)
+		return;
+	mbytes = (double)size * i / MB;
+	printf("%-10s %8.1f MB/s %8.2f ms user/MB %8.2f ms sys/MB\n",
+	    name, elapsed > 0 ? mbytes / elapsed : 0.0,
+	    (cputime(&after, 0) - cputime(&before, 0)) * 1e3 / mbytes,
+	    (cputime(&after, 1) - cputime(&before, 1)) * 1e3 / mbytes);
+	fflush(stdout);
+}
+
+int
+main(argc, argv)
+	int	argc;
+	char	**argv;
+{
+	off_t	size;
+	int	ch, fd;
+
+	while ((ch = getopt(argc, argv, "n:s:")) != EOF) {
+		switch (ch) {
+		case 'n':
+			passes = atoi(optarg);
+			break;
+		case 's':
+			megabytes = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (passes <= 0 || megabytes <= 0 || argc > 1)
+		usage();
+
+	signal(SIGPIPE, SIG_IGN);
+	fd = open_file(argc ? argv[0] : NULL, &size);
+	printf("%ld bytes, %d passes over 127.0.0.1\n", (long)size, passes);
+	run("read/write", send_copy, fd, size);
+#ifdef NeXT
+	run("sendfile", send_file, fd, size);
+#endif
+	exit(0);
+}
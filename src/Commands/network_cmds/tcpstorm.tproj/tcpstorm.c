@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * "Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.0 (the 'License').  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License."
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+ *	tcpstorm - connection storm against one listening port.
+ *
+ *	tcpstorm -l [-p port]
+ *		Listen on port (default 8080), accept everything and
+ *		answer each byte received with one byte.  Connections
+ *		are kept until the peer closes them.
+ *
+ *	tcpstorm [-n conns] [-r rounds] [-p port] host
+ *		Open conns connections (default 1000) to host:port and
+ *		hold them all open, then run rounds passes (default 10)
+ *		of a one byte ping-pong over every connection.  Each
+ *		segment the server receives has to be found among all
+ *		the established connections on its port.
+ *
+ *	Both sides print their rates.  On Rhapsody they also print
+ *	how the kernel's TCP connection and listen hash tables
+ *	(net.inet.tcp.pcbhash, net.inet.tcp.pcbwild) changed over
+ *	the run: bucket count, resizes and the lookup depth histogram.
+ *
+ *	Under QEMU user-mode networking, run the listener in the guest
+ *	and forward a port to it (-net user,hostfwd=tcp::8080-:8080),
+ *	then run the client on the host against localhost; slirp gives
+ *	every connection its own source port on 10.0.2.2.  Running both
+ *	ends in the guest over 127.0.0.1 works too.  The source builds
+ *	on other BSD socket systems for use as the host-side client.
+ */
+
+#define	FD_SETSIZE	8192
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+#ifdef NeXT
+#include <sys/sysctl.h>
+#include <net/route.h>
+#include <netinet/in_systm.h>
+#include <netinet/ip.h>
+#include <netinet/in_pcb.h>
+#include <netinet/tcp.h>
+#include <netinet/tcp_timer.h>
+#include <netinet/tcp_var.h>
+#endif
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int	port = 8080;
+static int	nconns = 1000;
+static int	rounds = 10;
+
+static void
+usage()
+{
+	fprintf(stderr, "usage: tcpstorm -l [-p port]\n");
+	fprintf(stderr,
+	    "       tcpstorm [-n conns] [-r rounds] [-p port] host\n");
+	exit(1);
+}
+
+static double
+now()
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+/*
+ * Allow one descriptor per connection plus a few.
+ */
+static void
+raise_fd_limit(want)
+	int	want;
+{
+	struct rlimit	rl;
+
+	if (getrlimit(RLIMIT_NOFILE, &rl) < 0)
+		return;
+	if (rl.rlim_cur >= want)
+		return;
+	rl.rlim_cur = want;
+	if (rl.rlim_max < want)
+		rl.rlim_max = want;
+	if (setrlimit(RLIMIT_NOFILE, &rl) < 0)
+		fprintf(stderr, "tcpstorm: cannot raise descriptor limit to %d\n",
+		    want);
+}
+
+#ifdef NeXT
+static char *depthname[INP_HASH_NDEPTH] =
+    { "0", "1", "2", "3", "4-7", "8-15", "16-31", "32+" };
+
+static int
+pcbhash_get(which, ihs)
+	int	which;
+	struct inpcb_hash_stats *ihs;
+{
+	int	mib[4];
+	size_t	len = sizeof (*ihs);
+
+	mib[0] = CTL_NET;
+	mib[1] = PF_INET;
+	mib[2] = IPPROTO_TCP;
+	mib[3] = which;
+	return (sysctl(mib, 4, ihs, &len, NULL, 0));
+}
+
+static void
+pcbhash_print(name, before, after)
+	char	*name;
+	struct inpcb_hash_stats *before, *after;
+{
+	u_long	total = 0;
+	int	i;
+
+	for (i = 0; i < INP_HASH_NDEPTH; i++)
+		total += after->ihs_depth[i] - before->ihs_depth[i];
+
+	printf("%s: %lu buckets (%lu resizes), %lu pcbs, longest chain %lu\n",
+	    name, after->ihs_buckets, after->ihs_resizes - before->ihs_resizes,
+	    after->ihs_entries, after->ihs_longest);
+	printf("%s: %lu lookups, depth", name, total);
+	for (i = 0; i < INP_HASH_NDEPTH; i++)
+		printf(" %s:%lu", depthname[i],
+		    after->ihs_depth[i] - before->ihs_depth[i]);
+	printf("\n");
+}
+
+static struct inpcb_hash_stats	hash_before, wild_before;
+
+static void
+stats_begin()
+{
+	if (pcbhash_get(TCPCTL_PCBHASH, &hash_before) < 0 ||
+	    pcbhash_get(TCPCTL_PCBWILD, &wild_before) < 0)
+		perror("tcpstorm: sysctl net.inet.tcp.pcbhash");
+}
+
+static void
+stats_end()
+{
+	struct inpcb_hash_stats	hash_after, wild_after;
+
+	if (pcbhash_get(TCPCTL_PCBHASH, &hash_after) < 0 ||
+	    pcbhash_get(TCPCTL_PCBWILD, &wild_after) < 0)
+		return;
+	pcbhash_print("pcbhash", &hash_before, &hash_after);
+	pcbhash_print("pcbwild", &wild_before, &wild_after);
+}
+#else
+#define	stats_begin()
+#define	stats_end()
+#endif
+
+static int	stopping;
+
+static void
+onintr(sig)
+	int	sig;
+{
+	stopping = 1;
+}
+
+static void
+server()
+{
+	struct sockaddr_in	sin;
+	fd_set			all, rfds;
+	int			s, fd, maxfd, on = 1;
+	int			open_conns = 0, peak = 0;
+	u_long			accepted = 0, bytes = 0;
+	char			c;
+	double			start;
+
+	if ((s = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+		perror("tcpstorm: socket");
+		exit(1);
+	}
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (char *)&on, sizeof (on));
+	bzero((char *)&sin, sizeof (sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(port);
+	sin.sin_addr.s_addr = INADDR_ANY;
+	if (bind(s, (struct sockaddr *)&sin, sizeof (sin)) < 0) {
+		perror("tcpstorm: bind");
+		exit(1);
+	}
+	if (listen(s, 128) < 0) {
+		perror("tcpstorm: listen");
+		exit(1);
+	}
+	signal(SIGINT, onintr);
+	printf("listening on port %d, interrupt to stop\n", port);
+	fflush(stdout);
+
+	stats_begin();
+	start = now();
+
+	FD_ZERO(&all);
+	FD_SET(s, &all);
+	maxfd = s;
+	while (!stopping) {
+		rfds = all;
+		if (select(maxfd + 1, &rfds, NULL, NULL, NULL) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("tcpstorm: select");
+			break;
+		}
+		if (FD_ISSET(s, &rfds)) {
+			if ((fd = accept(s, NULL, NULL)) >= 0) {
+				if (fd >= FD_SETSIZE) {
+					close(fd);
+				} else {
+					FD_SET(fd, &all);
+					if (fd > maxfd)
+						maxfd = fd;
+					accepted++;
+					if (++open_conns > peak)
+						peak = open_conns;
+				}
+			}
+		}
+		for (fd = 0; fd <= maxfd; fd++) {
+			if (fd == s || !FD_ISSET(fd, &rfds))
+				continue;
+			if (read(fd, &c, 1) != 1 || write(fd, &c, 1) != 1) {
+				close(fd);
+				FD_CLR(fd, &all);
+				open_conns--;
+				continue;
+			}
+			bytes++;
+		}
+	}
+
+	printf("%lu connections accepted (%d at once), %lu round trips in %.2fs\n",
+	    accepted, peak, bytes, now() - start);
+	stats_end();
+}
+
+static void
+client(host)
+	char	*host;
+{
+	struct sockaddr_in	sin;
+	struct hostent		*hp;
+	int			*fds;
+	int			i, r, opened;
+	char			c = 'x';
+	double			start, elapsed;
+
+	bzero((char *)&sin, sizeof (sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(port);
+	if ((sin.sin_addr.s_addr = inet_addr(host)) == (u_long)-1) {
+		if ((hp = gethostbyname(host)) == NULL) {
+			fprintf(stderr, "tcpstorm: unknown host %s\n", host);
+			exit(1);
+		}
+		bcopy(hp->h_addr, (char *)&sin.sin_addr, hp->h_length);
+	}
+	if ((fds = (int *)malloc(nconns * sizeof (int))) == NULL) {
+		fprintf(stderr, "tcpstorm: out of memory\n");
+		exit(1);
+	}
+
+	stats_begin();
+
+	start = now();
+	for (opened = 0; opened < nconns; opened++) {
+		if ((fds[opened] = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+			perror("tcpstorm: socket");
+			break;
+		}
+		if (connect(fds[opened], (struct sockaddr *)&sin,
+		    sizeof (sin)) < 0) {
+			perror("tcpstorm: connect");
+			close(fds[opened]);
+			break;
+		}
+	}
+	elapsed = now() - start;
+	printf("%d connections in %.2fs, %.0f/s\n", opened, elapsed,
+	    elapsed > 0 ? opened / elapsed : 0.0);
+	fflush(stdout);
+
+	start = now();
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < opened; i++) {
+			if (write(fds[i], &c, 1) != 1 || read(fds[i], &c, 1) != 1) {
+				fprintf(stderr,
+				    "tcpstorm: connection %d failed in round %d\n",
+				    i, r);
+				exit(1);
+			}
+		}
+	}
+	elapsed = now() - start;
+	printf("%d round trips over %d connections in %.2fs, %.0f/s\n",
+	    rounds * opened, opened, elapsed,
+	    elapsed > 0 ? rounds * opened / elapsed : 0.0);
+
+	stats_end();
+
+	for (i = 0; i < opened; i++)
+		close(fds[i]);
+	free(fds);
+}
+
+int
+main(argc, argv)
+	int	argc;
+	char	**argv;
+{
+	int	ch, listening = 0;
+
+	while ((ch = getopt(argc, argv, "ln:p:r:")) != EOF) {
+		switch (ch) {
+		case 'l':
+			listening = 1;
+			break;
+		case 'n':
+			nconns = atoi(optarg);
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (nconns <= 0 || rounds < 0 || port <= 0 || port > 65535)
+		usage();
+
+	if (listening) {
+		if (argc != 0)
+			usage();
+		raise_fd_limit(FD_SETSIZE);
+		server();
+	} else {
+		if (argc != 1)
+			usage();
+		raise_fd_limit(nconns + 16);
+		client(argv[0]);
+	}
+	exit(0);
+}
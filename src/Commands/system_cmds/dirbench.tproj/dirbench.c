@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * "Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.0 (the 'License').  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License."
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *	dirbench - metadata-heavy file system load.
+ *
+ *	dirbench [-d ndirs] [-n nfiles] [-r rounds] dir
+ *
+ *	Makes ndirs directories (default 4) under dir and nfiles empty
+ *	files (default 2000) in each, then stats every file rounds
+ *	times (default 5), renames each one within its directory and
+ *	finally removes everything.  Each phase is timed.  Creating
+ *	and removing files allocates and frees inodes in the cylinder
+ *	groups; every lookup scans the directory blocks.
+ *
+ *	On Rhapsody the counts from vfs.ufs.bswapstats are printed
+ *	as well: how many cylinder group and directory blocks were
+ *	converted between big endian and host order and how many
+ *	were found already converted in the buffer cache.  They only
+ *	move when dir is on a byte-swapped UFS, e.g. a big endian disk
+ *	image mounted on an Intel machine under QEMU.  Untarring a
+ *	source tree onto the same image is a good second test.
+ *
+ *	The vfs.ufs.dirhashstats counts show how many lookups were
+ *	answered from the directory hash tables instead of a scan.
+ *	"dirbench -d 1 -n 100000" measures one very large directory;
+ *	setting vfs.ufs.dirhash_maxmem to 0 gives the scan for
+ *	comparison.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#ifdef NeXT
+#include <sys/sysctl.h>
+#include <sys/mount.h>
+#include <ufs/ffs/ffs_extern.h>
+#endif
+
+static char	*pgmname;
+static int	ndirs = 4;
+static int	nfiles = 2000;
+static int	rounds = 5;
+
+static void
+usage()
+{
+	fprintf(stderr, "usage: %s [-d ndirs] [-n nfiles] [-r rounds] dir\n",
+	    pgmname);
+	exit(1);
+}
+
+static double
+now()
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+static void
+report(what, count, start)
+	char	*what;
+	int	count;
+	double	start;
+{
+	double	elapsed = now() - start;
+
+	printf("%-8s %8d in %7.2fs, %8.0f/s\n", what, count, elapsed,
+	    elapsed > 0 ? count / elapsed : 0.0);
+	fflush(stdout);
+}
+
+#ifdef NeXT
+/*
+ * Same layout as struct ufs_bswapstats in <ufs/ufs/ufs_byte_order.h>,
+ * which is kernel private.
+ */
+struct bswapstats {
+	u_long	cgin, cgout, cghit;
+	u_long	dirin, dirout, dirhit;
+	u_long	bytes;
+};
+
+/*
+ * Same layout as struct dirhash_stats in <ufs/ufs/dirhash.h>.
+ */
+struct dirhashstats {
+	u_long	builds, nomem, recycled, dropped;
+	u_long	lookups, hits, seqhits, fallback;
+	u_long	findfree, probes, mem, ntables;
+};
+
+static int	ufs_typenum = -1;
+
+static void
+find_ufs()
+{
+	struct vfsconf	vfc;
+	int		mib[4], maxtypenum, i;
+	size_t		len;
+
+	mib[0] = CTL_VFS;
+	mib[1] = VFS_GENERIC;
+	mib[2] = VFS_MAXTYPENUM;
+	len = sizeof (maxtypenum);
+	if (sysctl(mib, 3, &maxtypenum, &len, NULL, 0) < 0)
+		return;
+	mib[2] = VFS_CONF;
+	for (i = 0; i < maxtypenum; i++) {
+		mib[3] = i;
+		len = sizeof (vfc);
+		if (sysctl(mib, 4, &vfc, &len, NULL, 0) < 0)
+			continue;
+		if (strcmp(vfc.vfc_name, "ufs") == 0) {
+			ufs_typenum = vfc.vfc_typenum;
+			return;
+		}
+	}
+}
+
+static int
+ufs_stats_get(which, buf, size)
+	int	which;
+	void	*buf;
+	size_t	size;
+{
+	int	mib[3];
+	size_t	len = size;
+
+	if (ufs_typenum < 0)
+		return (-1);
+	mib[0] = CTL_VFS;
+	mib[1] = ufs_typenum;
+	mib[2] = which;
+	return (sysctl(mib, 3, buf, &len, NULL, 0));
+}
+
+static struct bswapstats	bs_before;
+static struct dirhashstats	dh_before;
+static int			bs_valid, dh_valid;
+
+static void
+stats_begin()
+{
+	find_ufs();
+	bs_valid = (ufs_stats_get(FFS_BSWAPSTATS, &bs_before,
+	    sizeof (bs_before)) == 0);
+	dh_valid = (ufs_stats_get(FFS_DIRHASHSTATS, &dh_before,
+	    sizeof (dh_before)) == 0);
+}
+
+static void
+stats_end()
+{
+	struct bswapstats	a, *b = &bs_before;
+	struct dirhashstats	da, *db = &dh_before;
+
+	if (!bs_valid || ufs_stats_get(FFS_BSWAPSTATS, &a, sizeof (a)) < 0)
+		printf("byte swap counts not available\n");
+	else {
+		printf("cg blocks:  %lu swapped in, %lu swapped out, "
+		    "%lu cached\n", a.cgin - b->cgin, a.cgout - b->cgout,
+		    a.cghit - b->cghit);
+		printf("dir blocks: %lu swapped in, %lu swapped out, "
+		    "%lu cached\n", a.dirin - b->dirin, a.dirout - b->dirout,
+		    a.dirhit - b->dirhit);
+		printf("%lu KB of metadata byte swapped\n",
+		    (a.bytes - b->bytes) / 1024);
+	}
+
+	if (!dh_valid ||
+	    ufs_stats_get(FFS_DIRHASHSTATS, &da, sizeof (da)) < 0) {
+		printf("directory hash counts not available\n");
+		return;
+	}
+	printf("dirhash:    %lu built, %lu recycled, %lu dropped, "
+	    "%lu refused\n", da.builds - db->builds,
+	    da.recycled - db->recycled, da.dropped - db->dropped,
+	    da.nomem - db->nomem);
+	printf("            %lu lookups, %lu hits (%lu sequential), "
+	    "%lu fell back\n", da.lookups - db->lookups, da.hits - db->hits,
+	    da.seqhits - db->seqhits, da.fallback - db->fallback);
+	printf("            %lu entries compared, %lu free slots found, "
+	    "%lu KB in %lu tables\n", da.probes - db->probes,
+	    da.findfree - db->findfree, da.mem / 1024, da.ntables);
+}
+#else
+#define	stats_begin()
+#define	stats_end()
+#endif
+
+static void
+fail(what, path)
+	char	*what, *path;
+{
+	fprintf(stderr, "%s: %s %s: %s\n", pgmname, what, path,
+	    strerror(errno));
+	exit(1);
+}
+
+int
+main(argc, argv)
+	int	argc;
+	char	**argv;
+{
+	char		path[1024], path2[1024];
+	struct stat	st;
+	double		start;
+	int		ch, d, i, r, fd;
+	char		*top;
+
+	pgmname = argv[0];
+	while ((ch = getopt(argc, argv, "d:n:r:")) != EOF) {
+		switch (ch) {
+		case 'd':
+			ndirs = atoi(optarg);
+			break;
+		case 'n':
+			nfiles = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (argc != 1 || ndirs <= 0 || nfiles <= 0 || rounds < 0)
+		usage();
+	top = argv[0];
+
+	stats_begin();
+
+	start = now();
+	for (d = 0; d < ndirs; d++) {
+		sprintf(path, "%s/d%d", top, d);
+		if (mkdir(path, 0755) < 0)
+			fail("mkdir", path);
+		for (i = 0; i < nfiles; i++) {
+			sprintf(path, "%s/d%d/file.%d", top, d, i);
+			if ((fd = open(path, O_CREAT | O_EXCL | O_WRONLY,
+			    0644)) < 0)
+				fail("create", path);
+			close(fd);
+		}
+	}
+	report("create", ndirs * nfiles, start);
+
+	start = now();
+	for (r = 0; r < rounds; r++)
+		for (d = 0; d < ndirs; d++)
+			for (i = 0; i < nfiles; i++) {
+				sprintf(path, "%s/d%d/file.%d", top, d, i);
+				if (stat(path, &st) < 0)
+					fail("stat", path);
+			}
+	report("stat", rounds * ndirs * nfiles, start);
+
+	start = now();
+	for (d = 0; d < ndirs; d++)
+		for (i = 0; i < nfiles; i++) {
+			sprintf(path, "%s/d%d/file.%d", top, d, i);
+			sprintf(path2, "%s/d%d/renamed.%d", top, d, i);
+			if (rename(path, path2) < 0)
+				fail("rename", path);
+		}
+	report("rename", ndirs * nfiles, start);
+
+	start = now();
+	for (d = 0; d < ndirs; d++) {
+		for (i = 0; i < nfiles; i++) {
+			sprintf(path, "%s/d%d/renamed.%d", top, d, i);
+			if (unlink(path) < 0)
+				fail("unlink", path);
+		}
+		sprintf(path, "%s/d%d", top, d);
+		if (rmdir(path) < 0)
+			fail("rmdir", path);
+	}
+	report("unlink", ndirs * nfiles, start);
+
+	stats_end();
+	exit(0);
+}
@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * "Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.0 (the 'License').  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License."
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *	File:	evbench.c
+ *
+ *	select() against kevent() for an event loop with many idle
+ *	descriptors.  Opens nfds socketpairs and watches the read end
+ *	of each.  Every round writes one byte into nactive randomly
+ *	chosen pairs, then waits for readiness and drains the bytes
+ *	that were found, the way a server with mostly idle clients
+ *	spends its time.
+ *
+ *	evbench [-a nactive] [-r rounds] [nfds ...]
+ *
+ *	nactive defaults to 10, rounds to 1000 and the descriptor
+ *	counts to 100, 1000 and 10000.  For each count the time per
+ *	round is printed for select() and, on Rhapsody, for kevent().
+ *	Two descriptors are used per pair, so the descriptor limit is
+ *	raised to twice the largest count.
+ *
+ *	The fd_sets are sized from the descriptors in use rather than
+ *	FD_SETSIZE, so select() is measured at every count.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#ifdef NeXT
+#include <sys/event.h>
+#endif
+
+#define	WORDBITS	(sizeof (u_long) * 8)
+#define	NWORDS(n)	(((n) + WORDBITS - 1) / WORDBITS)
+#define	BIT_SET(n, p)	((p)[(n) / WORDBITS] |= (1UL << ((n) % WORDBITS)))
+#define	BIT_ISSET(n, p)	((p)[(n) / WORDBITS] & (1UL << ((n) % WORDBITS)))
+
+static int	nactive = 10;
+static int	rounds = 1000;
+static int	defcounts[] = { 100, 1000, 10000 };
+static char	*pgmname;
+
+static int	*rfd, *wfd;		/* read and write end of each pair */
+static int	*picked;		/* pairs written to this round */
+static int	maxfd;
+
+static void
+usage()
+{
+	fprintf(stderr, "usage: %s [-a nactive] [-r rounds] [nfds ...]\n",
+	    pgmname);
+	exit(1);
+}
+
+static double
+now()
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+static void
+raise_fd_limit(want)
+	int	want;
+{
+	struct rlimit	rl;
+
+	if (getrlimit(RLIMIT_NOFILE, &rl) < 0)
+		return;
+	if (rl.rlim_cur >= want)
+		return;
+	rl.rlim_cur = want;
+	if (rl.rlim_max < want)
+		rl.rlim_max = want;
+	if (setrlimit(RLIMIT_NOFILE, &rl) < 0)
+		fprintf(stderr, "%s: cannot raise descriptor limit to %d\n",
+		    pgmname, want);
+}
+
+/*
+ * Open n pairs; returns how many could be opened.
+ */
+static int
+open_pairs(n)
+	int	n;
+{
+	int	i, sv[2];
+
+	rfd = (int *)malloc(n * sizeof (int));
+	wfd = (int *)malloc(n * sizeof (int));
+	picked = (int *)malloc(nactive * sizeof (int));
+	if (rfd == NULL || wfd == NULL || picked == NULL) {
+		fprintf(stderr, "%s: out of memory\n", pgmname);
+		exit(1);
+	}
+	maxfd = 0;
+	for (i = 0; i < n; i++) {
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+			fprintf(stderr, "%s: socketpair %d: %s\n", pgmname, i,
+			    strerror(errno));
+			break;
+		}
+		rfd[i] = sv[0];
+		wfd[i] = sv[1];
+		if (sv[0] > maxfd)
+			maxfd = sv[0];
+	}
+	return (i);
+}
+
+static void
+close_pairs(n)
+	int	n;
+{
+	int	i;
+
+	for (i = 0; i < n; i++) {
+		close(rfd[i]);
+		close(wfd[i]);
+	}
+	free(rfd);
+	free(wfd);
+	free(picked);
+}
+
+/*
+ * Write one byte into k distinct random pairs.
+ */
+static void
+stir(n, k)
+	int	n, k;
+{
+	int	i, j, p;
+	char	c = 'x';
+
+	for (i = 0; i < k; i++) {
+again:
+		p = random() % n;
+		for (j = 0; j < i; j++)
+			if (picked[j] == p)
+				goto again;
+		picked[i] = p;
+		if (write(wfd[p], &c, 1) != 1) {
+			perror("write");
+			exit(1);
+		}
+	}
+}
+
+static void
+drain(fd)
+	int	fd;
+{
+	char	c;
+
+	if (read(fd, &c, 1) != 1) {
+		perror("read");
+		exit(1);
+	}
+}
+
+static double
+run_select(n, k)
+	int	n, k;
+{
+	u_long	*all, *ready;
+	size_t	len = NWORDS(maxfd + 1) * sizeof (u_long);
+	int	i, r, found;
+	double	start;
+
+	all = (u_long *)malloc(len);
+	ready = (u_long *)malloc(len);
+	if (all == NULL || ready == NULL) {
+		fprintf(stderr, "%s: out of memory\n", pgmname);
+		exit(1);
+	}
+	memset(all, 0, len);
+	for (i = 0; i < n; i++)
+		BIT_SET(rfd[i], all);
+
+	start = now();
+	for (r = 0; r < rounds; r++) {
+		stir(n, k);
+		memcpy(ready, all, len);
+		if (select(maxfd + 1, (fd_set *)ready, NULL, NULL, NULL) < 0) {
+			perror("select");
+			exit(1);
+		}
+		/* the caller has to look at every bit to find the few set */
+		found = 0;
+		for (i = 0; i < n; i++)
+			if (BIT_ISSET(rfd[i], ready)) {
+				drain(rfd[i]);
+				found++;
+			}
+		/* a pair written late in stir() may not be seen yet */
+		while (found < k) {
+			for (i = 0; i < k; i++) {
+				char	c;
+
+				if (recv(rfd[picked[i]], &c, 1, MSG_DONTWAIT) == 1)
+					found++;
+			}
+		}
+	}
+	start = now() - start;
+	free(all);
+	free(ready);
+	return (start);
+}
+
+#ifdef NeXT
+static double
+run_kevent(n, k)
+	int	n, k;
+{
+	struct kevent	*kev, ev[64];
+	int		kq, i, r, m, found;
+	double		start;
+
+	if ((kq = kqueue()) < 0) {
+		perror("kqueue");
+		return (-1.0);
+	}
+	if ((kev = (struct kevent *)malloc(n * sizeof (*kev))) == NULL) {
+		fprintf(stderr, "%s: out of memory\n", pgmname);
+		exit(1);
+	}
+	/* register interest once, outside the timed loop */
+	for (i = 0; i < n; i++)
+		EV_SET(&kev[i], rfd[i], EVFILT_READ, EV_ADD, 0, 0, NULL);
+	if (kevent(kq, kev, n, NULL, 0, NULL) < 0) {
+		perror("kevent register");
+		exit(1);
+	}
+	free(kev);
+
+	start = now();
+	for (r = 0; r < rounds; r++) {
+		stir(n, k);
+		for (found = 0; found < k; found += m) {
+			m = kevent(kq, NULL, 0, ev, sizeof (ev) / sizeof (ev[0]),
+			    NULL);
+			if (m < 0) {
+				perror("kevent");
+				exit(1);
+			}
+			for (i = 0; i < m; i++)
+				drain(ev[i].ident);
+		}
+	}
+	start = now() - start;
+	close(kq);
+	return (start);
+}
+#endif
+
+int
+main(argc, argv)
+	int	argc;
+	char	**argv;
+{
+	int	ch, i, n, want, opened, ncounts, *counts;
+	double	t;
+
+	pgmname = argv[0];
+	while ((ch = getopt(argc, argv, "a:r:")) != EOF) {
+		switch (ch) {
+		case 'a':
+			nactive = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (nactive <= 0 || rounds <= 0)
+		usage();
+
+	if (argc > 0) {
+		ncounts = argc;
+		counts = (int *)malloc(argc * sizeof (int));
+		for (i = 0; i < argc; i++)
+			if ((counts[i] = atoi(argv[i])) <= 0)
+				usage();
+	} else {
+		ncounts = sizeof (defcounts) / sizeof (defcounts[0]);
+		counts = defcounts;
+	}
+	want = 0;
+	for (i = 0; i < ncounts; i++)
+		if (counts[i] > want)
+			want = counts[i];
+	raise_fd_limit(2 * want + 16);
+	srandom(getpid());
+
+	printf("%d rounds, %d ready per round\n", rounds, nactive);
+	printf("%8s %14s %14s\n", "fds", "select us/rnd", "kevent us/rnd");
+	for (i = 0; i < ncounts; i++) {
+		n = counts[i];
+		opened = open_pairs(n);
+		if (opened < nactive) {
+			close_pairs(opened);
+			break;
+		}
+		t = run_select(opened, nactive);
+		printf("%8d %14.1f", opened, t * 1e6 / rounds);
+#ifdef NeXT
+		t = run_kevent(opened, nactive);
+		if (t >= 0)
+			printf(" %14.1f", t * 1e6 / rounds);
+		else
+			printf(" %14s", "-");
+#else
+		printf(" %14s", "-");
+#endif
+		printf("\n");
+		fflush(stdout);
+		close_pairs(opened);
+	}
+	exit(0);
+}
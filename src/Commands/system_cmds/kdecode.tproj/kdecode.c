@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * "Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.0 (the 'License').  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License."
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+ *	kdecode - turn a kernel trace into a timeline.
+ *
+ *	Reads the kd_buf records produced by /dev/kdebug (or the
+ *	KERN_KDREADTR sysctl), from a file or the standard input, and
+ *	prints one line per event:
+ *
+ *	    time  delta  thread  class/subclass/code  phase  [duration]  args
+ *
+ *	Times are in microseconds from the first event.  Function
+ *	start and end events are matched per thread; end events show
+ *	the time since their start, and nested calls are indented.
+ *	The decoder is meant to run anywhere, so it carries its own
+ *	copy of the record layout and can byte swap traces taken on
+ *	a machine of the other byte order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Must match kd_buf in the kernel's kern/kdebug_private.h.
+ */
+typedef struct {
+	unsigned int	tv_sec;
+	int		tv_nsec;
+	unsigned int	arg1;
+	unsigned int	arg2;
+	unsigned int	arg3;
+	unsigned int	arg4;
+	unsigned int	arg5;		/* thread */
+	unsigned int	debugid;
+} kd_record;
+
+#define	DBG_FUNC_START		1
+#define	DBG_FUNC_END		2
+#define	DBG_FUNC_MASK		3
+
+#define	KDBG_CLASS(id)		(((id) >> 24) & 0xff)
+#define	KDBG_SUBCLASS(id)	(((id) >> 16) & 0xff)
+#define	KDBG_CODE(id)		(((id) >> 2) & 0x3fff)
+
+/* KDBG_CODE(DBG_MISC, 0xff, 0x3fff) */
+#define	KDBG_LOSTEVENTS		0x14fffffc
+
+static char *class_names[] = {
+	"0", "mach", "net", "fs", "bsd", "iokit", "drivers"
+};
+#define	NCLASSNAMES	(sizeof (class_names) / sizeof (class_names[0]))
+
+/*
+ * Open start events, per thread.
+ */
+#define	MAXDEPTH	32
+#define	NTHREADS	256
+
+struct thread_state {
+	unsigned int	thread;
+	int		depth;
+	unsigned int	debugid[MAXDEPTH];
+	double		start[MAXDEPTH];
+};
+
+static struct thread_state threads[NTHREADS];
+
+int	swap;
+int	raw;
+
+static unsigned int
+swap32(unsigned int x)
+{
+	return ((x >> 24) | ((x >> 8) & 0xff00) |
+		((x << 8) & 0xff0000) | (x << 24));
+}
+
+static struct thread_state *
+thread_lookup(unsigned int thread)
+{
+	struct thread_state *ts;
+	int i, h;
+
+	h = (thread >> 4) % NTHREADS;
+	for (i = 0; i < NTHREADS; i++) {
+		ts = &threads[(h + i) % NTHREADS];
+		if (ts->thread == thread)
+			return (ts);
+		if (ts->thread == 0) {
+			ts->thread = thread;
+			ts->depth = 0;
+			return (ts);
+		}
+	}
+	return (NULL);		/* table full; no nesting for this one */
+}
+
+static void
+print_event(kd_record *kd, double now, double delta)
+{
+	struct thread_state *ts;
+	unsigned int id = kd->debugid & ~DBG_FUNC_MASK;
+	unsigned int class = KDBG_CLASS(id);
+	char name[32], phase;
+	double duration = -1.0;
+	int depth = 0;
+
+	if (kd->debugid == KDBG_LOSTEVENTS) {
+		printf("%14.3f %10.3f  *** %u events lost on cpu %u\n",
+		       now, delta, kd->arg1, kd->arg2);
+		return;
+	}
+
+	if (class < NCLASSNAMES)
+		sprintf(name, "%s/%u/%u", class_names[class],
+			KDBG_SUBCLASS(id), KDBG_CODE(id));
+	else
+		sprintf(name, "%u/%u/%u", class,
+			KDBG_SUBCLASS(id), KDBG_CODE(id));
+
+	ts = thread_lookup(kd->arg5);
+	switch (kd->debugid & DBG_FUNC_MASK) {
+	case DBG_FUNC_START:
+		phase = 'B';
+		if (ts != NULL) {
+			depth = ts->depth;
+			if (ts->depth < MAXDEPTH) {
+				ts->debugid[ts->depth] = id;
+				ts->start[ts->depth] = now;
+			}
+			ts->depth++;
+		}
+		break;
+	case DBG_FUNC_END:
+		phase = 'E';
+		if (ts != NULL) {
+			int i;
+
+			/*
+			 * Unwind to the matching start, forgetting
+			 * any starts whose ends were not traced.
+			 */
+			for (i = ts->depth - 1; i >= 0; i--)
+				if (i < MAXDEPTH && ts->debugid[i] == id)
+					break;
+			if (i >= 0) {
+				duration = now - ts->start[i];
+				ts->depth = i;
+			}
+			depth = ts->depth;
+		}
+		break;
+	default:
+		phase = '-';
+		if (ts != NULL)
+			depth = ts->depth;
+		break;
+	}
+
+	if (depth > MAXDEPTH)
+		depth = MAXDEPTH;
+	printf("%14.3f %10.3f  %08x  %*s%-20s %c", now, delta, kd->arg5,
+	       depth * 2, "", name, phase);
+	if (duration >= 0.0)
+		printf(" %10.3f", duration);
+	else
+		printf(" %10s", "");
+	printf("  %08x %08x %08x %08x", kd->arg1, kd->arg2, kd->arg3, kd->arg4);
+	if (raw)
+		printf("  [%08x]", kd->debugid);
+	printf("\n");
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: kdecode [-rs] [file]\n");
+	fprintf(stderr, "\t-r\talso print the raw debug id\n");
+	fprintf(stderr, "\t-s\tbyte swap (trace from other-endian machine)\n");
+	exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+	FILE *fp = stdin;
+	kd_record kd;
+	double base = 0.0, last = 0.0, now;
+	int c, first = 1;
+	unsigned int *w;
+	unsigned int i;
+
+	while ((c = getopt(argc, argv, "rs")) != EOF) {
+		switch (c) {
+		case 'r':
+			raw = 1;
+			break;
+		case 's':
+			swap = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (argc > 1)
+		usage();
+	if (argc == 1 && (fp = fopen(argv[0], "r")) == NULL) {
+		perror(argv[0]);
+		exit(1);
+	}
+
+	while (fread(&kd, sizeof (kd), 1, fp) == 1) {
+		if (swap) {
+			w = (unsigned int *)&kd;
+			for (i = 0; i < sizeof (kd) / sizeof (*w); i++)
+				w[i] = swap32(w[i]);
+		}
+		now = kd.tv_sec * 1000000.0 + kd.tv_nsec / 1000.0;
+		if (first) {
+			base = last = now;
+			first = 0;
+		}
+		print_event(&kd, now - base, now - last);
+		last = now;
+	}
+
+	if (fp != stdin)
+		fclose(fp);
+	exit(0);
+}
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * "Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.0 (the 'License').  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License."
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *	metabench - file create and remove throughput.
+ *
+ *	metabench [-d ndirs] [-n nfiles] [-k nops] dir
+ *
+ *	Creates nfiles empty files (default 100000) spread over ndirs
+ *	directories (default 10) under dir, then removes them all.
+ *	Both phases are timed.  Without soft updates each create and
+ *	each remove writes an inode or directory block synchronously;
+ *	with them ("tunefs -n enable") the writes are delayed and the
+ *	vfs.ufs.softdepstats counts printed at the end show how many
+ *	entries and removals were ordered, rolled back or fell back to
+ *	synchronous writes.
+ *
+ *	-k nops is the crash test: after nops creates and removes the
+ *	machine is rebooted without syncing, leaving whatever delayed
+ *	writes were outstanding unwritten.  Under QEMU:
+ *
+ *		tunefs -n enable /dev/rsd1a	(the scratch disk image)
+ *		mount /dev/sd1a /mnt
+ *		metabench -k 150000 /mnt
+ *
+ *	and after the reboot "fsck -p /dev/rsd1a" must finish without
+ *	asking for help; it may only adjust link counts and clear
+ *	unreferenced inodes.  Varying nops, or killing QEMU from the
+ *	monitor instead, moves the crash around.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/reboot.h>
+#ifdef NeXT
+#include <sys/sysctl.h>
+#include <sys/mount.h>
+#include <ufs/ffs/ffs_extern.h>
+#endif
+
+static char	*pgmname;
+static int	ndirs = 10;
+static int	nfiles = 100000;
+static int	killafter = -1;
+static int	nops;
+
+static void
+usage()
+{
+	fprintf(stderr, "usage: %s [-d ndirs] [-n nfiles] [-k nops] dir\n",
+	    pgmname);
+	exit(1);
+}
+
+static double
+now()
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+static void
+report(what, count, start)
+	char	*what;
+	int	count;
+	double	start;
+{
+	double	elapsed = now() - start;
+
+	printf("%-8s %8d in %7.2fs, %8.0f/s\n", what, count, elapsed,
+	    elapsed > 0 ? count / elapsed : 0.0);
+	fflush(stdout);
+}
+
+static void
+fail(what, path)
+	char	*what, *path;
+{
+	fprintf(stderr, "%s: %s %s: %s\n", pgmname, what, path,
+	    strerror(errno));
+	exit(1);
+}
+
+/*
+ * Count one operation and crash when told to.
+ */
+static void
+tick()
+{
+	if (killafter >= 0 && ++nops >= killafter) {
+		printf("%s: rebooting after %d operations\n", pgmname, nops);
+		fflush(stdout);
+		reboot(RB_NOSYNC);
+		fail("reboot", "");
+	}
+}
+
+#ifdef NeXT
+/*
+ * Same layout as struct softdep_stats in <ufs/ffs/softdep.h>, which
+ * is kernel private.
+ */
+struct sdstats {
+	u_long	diradd, dirrem, cancel, rollback;
+	u_long	inopush, handled, sync, current;
+};
+
+static int	ufs_typenum = -1;
+
+static void
+find_ufs()
+{
+	struct vfsconf	vfc;
+	int		mib[4], maxtypenum, i;
+	size_t		len;
+
+	mib[0] = CTL_VFS;
+	mib[1] = VFS_GENERIC;
+	mib[2] = VFS_MAXTYPENUM;
+	len = sizeof (maxtypenum);
+	if (sysctl(mib, 3, &maxtypenum, &len, NULL, 0) < 0)
+		return;
+	mib[2] = VFS_CONF;
+	for (i = 0; i < maxtypenum; i++) {
+		mib[3] = i;
+		len = sizeof (vfc);
+		if (sysctl(mib, 4, &vfc, &len, NULL, 0) < 0)
+			continue;
+		if (strcmp(vfc.vfc_name, "ufs") == 0) {
+			ufs_typenum = vfc.vfc_typenum;
+			return;
+		}
+	}
+}
+
+static int
+ufs_stats_get(which, buf, size)
+	int	which;
+	void	*buf;
+	size_t	size;
+{
+	int	mib[3];
+	size_t	len = size;
+
+	if (ufs_typenum < 0)
+		return (-1);
+	mib[0] = CTL_VFS;
+	mib[1] = ufs_typenum;
+	mib[2] = which;
+	return (sysctl(mib, 3, buf, &len, NULL, 0));
+}
+
+static struct sdstats	sd_before;
+static int		sd_valid;
+
+static void
+stats_begin()
+{
+	find_ufs();
+	sd_valid = (ufs_stats_get(FFS_SOFTDEPSTATS, &sd_before,
+	    sizeof (sd_before)) == 0);
+}
+
+static void
+stats_end()
+{
+	struct sdstats	a, *b = &sd_before;
+
+	if (!sd_valid ||
+	    ufs_stats_get(FFS_SOFTDEPSTATS, &a, sizeof (a)) < 0) {
+		printf("soft update counts not available\n");
+		return;
+	}
+	printf("softdep:    %lu entries ordered, %lu removals ordered, "
+	    "%lu cancelled\n", a.diradd - b->diradd, a.dirrem - b->dirrem,
+	    a.cancel - b->cancel);
+	printf("            %lu entries rolled back, %lu inode blocks "
+	    "pushed, %lu removals finished\n", a.rollback - b->rollback,
+	    a.inopush - b->inopush, a.handled - b->handled);
+	printf("            %lu updates synchronous at the limit, "
+	    "%lu records outstanding\n", a.sync - b->sync, a.current);
+}
+#else
+#define	stats_begin()
+#define	stats_end()
+#endif
+
+int
+main(argc, argv)
+	int	argc;
+	char	**argv;
+{
+	char		path[1024];
+	double		start;
+	int		ch, d, i, fd;
+	char		*top;
+
+	pgmname = argv[0];
+	while ((ch = getopt(argc, argv, "d:n:k:")) != EOF) {
+		switch (ch) {
+		case 'd':
+			ndirs = atoi(optarg);
+			break;
+		case 'n':
+			nfiles = atoi(optarg);
+			break;
+		case 'k':
+			killafter = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (argc != 1 || ndirs <= 0 || nfiles <= 0)
+		usage();
+	top = argv[0];
+
+	for (d = 0; d < ndirs; d++) {
+		sprintf(path, "%s/m%d", top, d);
+		if (mkdir(path, 0755) < 0 && errno != EEXIST)
+			fail("mkdir", path);
+	}
+	sync();
+
+	stats_begin();
+
+	start = now();
+	for (i = 0; i < nfiles; i++) {
+		sprintf(path, "%s/m%d/file.%d", top, i % ndirs, i);
+		if ((fd = open(path, O_CREAT | O_EXCL | O_WRONLY, 0644)) < 0)
+			fail("create", path);
+		close(fd);
+		tick();
+	}
+	report("create", nfiles, start);
+
+	start = now();
+	for (i = 0; i < nfiles; i++) {
+		sprintf(path, "%s/m%d/file.%d", top, i % ndirs, i);
+		if (unlink(path) < 0)
+			fail("unlink", path);
+		tick();
+	}
+	report("unlink", nfiles, start);
+
+	stats_end();
+
+	for (d = 0; d < ndirs; d++) {
+		sprintf(path, "%s/m%d", top, d);
+		if (rmdir(path) < 0)
+			fail("rmdir", path);
+	}
+	exit(0);
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * "Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.0 (the 'License').  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License."
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *	File:	portbench.c
+ *
+ *	Times port name translation in large IPC spaces.  For each
+ *	space size given, fills the task's space with that many
+ *	receive rights under kernel-chosen names (which land in the
+ *	space's table) and as many again under sparse names of our own
+ *	choosing (which the table can't hold, so the kernel keeps them
+ *	in its tree), then times
+ *
+ *		mach_port_allocate / mach_port_allocate_name
+ *		mach_port_type on random names of each kind
+ *		a send-and-receive mach_msg to a port of each kind
+ *		mach_port_destroy of everything
+ *
+ *	and reports microseconds per call.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <mach/mach.h>
+
+#define	TREE_BASE	0x400000	/* first sparse index */
+#define	TREE_STRIDE	16		/* too sparse for the table */
+#define	TREE_NAME(i)	(((TREE_BASE + (i) * TREE_STRIDE) << 8) | 1)
+#define	LOOKUPS		100000
+
+static char	*pgmname;
+
+static double
+now_usec()
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, 0);
+	return (double)tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
+static void
+fail(what, kr)
+	char		*what;
+	kern_return_t	kr;
+{
+	fprintf(stderr, "%s: %s: %s\n", pgmname, what, mach_error_string(kr));
+	exit(1);
+}
+
+/*
+ *	Send a message to the port and receive it back, in one call.
+ *	Both halves translate the port's name.
+ */
+static double
+time_msg(port, iterations)
+	mach_port_t	port;
+	int		iterations;
+{
+	struct {
+		mach_msg_header_t	head;
+		mach_msg_trailer_t	trailer;
+	} msg;
+	kern_return_t	kr;
+	double		start;
+	int		i;
+
+	start = now_usec();
+	for (i = 0; i < iterations; i++) {
+		msg.head.msgh_bits = MACH_MSGH_BITS(MACH_MSG_TYPE_MAKE_SEND, 0);
+		msg.head.msgh_size = sizeof msg.head;
+		msg.head.msgh_remote_port = port;
+		msg.head.msgh_local_port = MACH_PORT_NULL;
+		msg.head.msgh_id = i;
+		kr = mach_msg(&msg.head, MACH_SEND_MSG | MACH_RCV_MSG,
+			      sizeof msg.head, sizeof msg, port,
+			      MACH_MSG_TIMEOUT_NONE, MACH_PORT_NULL);
+		if (kr != MACH_MSG_SUCCESS)
+			fail("mach_msg", kr);
+	}
+	return (now_usec() - start) / iterations;
+}
+
+static double
+time_type(names, count)
+	mach_port_t	*names;
+	int		count;
+{
+	mach_port_type_t	type;
+	kern_return_t		kr;
+	double			start;
+	int			i;
+
+	start = now_usec();
+	for (i = 0; i < LOOKUPS; i++) {
+		kr = mach_port_type(mach_task_self(),
+				    names[random() % count], &type);
+		if (kr != KERN_SUCCESS)
+			fail("mach_port_type", kr);
+	}
+	return (now_usec() - start) / LOOKUPS;
+}
+
+static void
+run(count, iterations)
+	int	count, iterations;
+{
+	mach_port_t	*table, *tree;
+	kern_return_t	kr;
+	double		start, alloc, alloc_name, destroy;
+	double		type_table, type_tree, msg_table, msg_tree;
+	int		i;
+
+	table = (mach_port_t *)malloc(count * sizeof (mach_port_t));
+	tree = (mach_port_t *)malloc(count * sizeof (mach_port_t));
+	if (table == 0 || tree == 0) {
+		fprintf(stderr, "%s: out of memory\n", pgmname);
+		exit(1);
+	}
+
+	start = now_usec();
+	for (i = 0; i < count; i++) {
+		kr = mach_port_allocate(mach_task_self(),
+					MACH_PORT_RIGHT_RECEIVE, &table[i]);
+		if (kr != KERN_SUCCESS)
+			fail("mach_port_allocate", kr);
+	}
+	alloc = (now_usec() - start) / count;
+
+	start = now_usec();
+	for (i = 0; i < count; i++) {
+		tree[i] = TREE_NAME(i);
+		kr = mach_port_allocate_name(mach_task_self(),
+					     MACH_PORT_RIGHT_RECEIVE, tree[i]);
+		if (kr != KERN_SUCCESS)
+			fail("mach_port_allocate_name", kr);
+	}
+	alloc_name = (now_usec() - start) / count;
+
+	type_table = time_type(table, count);
+	type_tree = time_type(tree, count);
+	msg_table = time_msg(table[count / 2], iterations);
+	msg_tree = time_msg(tree[count / 2], iterations);
+
+	start = now_usec();
+	for (i = 0; i < count; i++) {
+		(void) mach_port_destroy(mach_task_self(), table[i]);
+		(void) mach_port_destroy(mach_task_self(), tree[i]);
+	}
+	destroy = (now_usec() - start) / (2 * count);
+
+	printf("%7d %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f\n", count,
+	       alloc, alloc_name, type_table, type_tree,
+	       msg_table, msg_tree, destroy);
+
+	free(table);
+	free(tree);
+}
+
+static void
+usage()
+{
+	fprintf(stderr, "usage: %s [-i iterations] [count ...]\n", pgmname);
+	exit(1);
+}
+
+main(argc, argv)
+	int	argc;
+	char	*argv[];
+{
+	int		iterations, ch, count;
+	extern char	*optarg;
+	extern int	optind;
+
+	pgmname = argv[0];
+	iterations = 100000;
+
+	while ((ch = getopt(argc, argv, "i:")) != EOF) {
+		switch (ch) {
+		case 'i':
+			iterations = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (iterations <= 0)
+		usage();
+
+	printf("usec per call; \"table\" names are kernel-chosen, "
+	       "\"tree\" names sparse\n");
+	printf("%7s %8s %8s %8s %8s %8s %8s %8s\n", "rights",
+	       "alloc", "alloc_nm", "type_tbl", "type_tre",
+	       "msg_tbl", "msg_tre", "destroy");
+
+	if (optind == argc) {
+		run(10000, iterations);
+		run(100000, iterations);
+		exit(0);
+	}
+	for (; optind < argc; optind++) {
+		count = atoi(argv[optind]);
+		if (count <= 0)
+			usage();
+		run(count, iterations);
+	}
+	exit(0);
+}
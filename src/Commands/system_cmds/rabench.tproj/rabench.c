@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * "Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.0 (the 'License').  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License."
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *	rabench - replay a block read trace against a file.
+ *
+ *	rabench [-a] file trace
+ *	rabench -g pattern [-n nreads] [-b bsize] [-s stride] [-S seed]
+ *
+ *	A trace is a text file of reads, one per line: the byte offset
+ *	and the length, in decimal.  Blank lines and lines starting
+ *	with # are skipped.  The first form does each read in turn with
+ *	lseek() and read() on file and reports the throughput and the
+ *	mean, median, 99th percentile and largest read latency.  -a
+ *	turns read-ahead off for the file first (fcntl F_RDAHEAD), which
+ *	gives the numbers to compare against.
+ *
+ *	The second form writes a trace to the standard output: nreads
+ *	(default 10000) reads of bsize bytes (default 8192), following
+ *	pattern, which is one of
+ *
+ *		seq	one block after another
+ *		rev	one block after another, from the end backwards
+ *		stride	every stride'th block (default 4)
+ *		random	blocks in no order
+ *
+ *	Recorded traces, e.g. the reads of a tar or rsync restore taken
+ *	from a ktrace/kdump of the lseek and read calls, replay the same
+ *	way.  The file must be at least as long as the furthest read.
+ *	Each run should start with the file out of the buffer cache, so
+ *	unmount and remount the file system between runs:
+ *
+ *		rabench -g stride -n 20000 > stride.tr
+ *		mount /dev/sd1a /mnt; rabench -a /mnt/big stride.tr; umount /mnt
+ *		mount /dev/sd1a /mnt; rabench /mnt/big stride.tr; umount /mnt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/time.h>
+
+static char	*pgmname;
+
+struct rec {
+	off_t	off;
+	long	len;
+};
+
+static void
+usage()
+{
+	fprintf(stderr, "usage: %s [-a] file trace\n", pgmname);
+	fprintf(stderr, "       %s -g seq|rev|stride|random [-n nreads] "
+	    "[-b bsize] [-s stride] [-S seed]\n", pgmname);
+	exit(1);
+}
+
+static double
+now()
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+static void
+fail(what, path)
+	char	*what, *path;
+{
+	fprintf(stderr, "%s: %s %s: %s\n", pgmname, what, path,
+	    strerror(errno));
+	exit(1);
+}
+
+static int
+compare(a, b)
+	const void	*a, *b;
+{
+	double	x = *(const double *)a, y = *(const double *)b;
+
+	return (x < y ? -1 : x > y);
+}
+
+/*
+ * Write a synthetic trace.
+ */
+static void
+generate(pattern, nreads, bsize, stride)
+	char	*pattern;
+	int	nreads;
+	long	bsize;
+	int	stride;
+{
+	long	i, bn;
+
+	if (strcmp(pattern, "seq") != 0 && strcmp(pattern, "rev") != 0 &&
+	    strcmp(pattern, "stride") != 0 && strcmp(pattern, "random") != 0)
+		usage();
+	printf("# %s, %d reads of %ld bytes\n", pattern, nreads, bsize);
+	for (i = 0; i < nreads; i++) {
+		if (strcmp(pattern, "seq") == 0)
+			bn = i;
+		else if (strcmp(pattern, "rev") == 0)
+			bn = nreads - 1 - i;
+		else if (strcmp(pattern, "stride") == 0)
+			bn = i * stride;
+		else
+			bn = random() % nreads;
+		printf("%ld %ld\n", bn * bsize, bsize);
+	}
+}
+
+/*
+ * Read the trace into memory, so that parsing it is not timed.
+ */
+static struct rec *
+load(path, nrecp, maxlenp)
+	char	*path;
+	int	*nrecp;
+	long	*maxlenp;
+{
+	FILE		*fp;
+	char		line[256];
+	struct rec	*recs = NULL;
+	int		n = 0, max = 0;
+	long		off;
+
+	if ((fp = fopen(path, "r")) == NULL)
+		fail("open", path);
+	*maxlenp = 0;
+	while (fgets(line, sizeof (line), fp) != NULL) {
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (n == max) {
+			max = max ? max * 2 : 1024;
+			if ((recs = realloc(recs, max * sizeof (*recs))) ==
+			    NULL)
+				fail("realloc", "");
+		}
+		if (sscanf(line, "%ld %ld", &off, &recs[n].len) != 2 ||
+		    off < 0 || recs[n].len <= 0) {
+			fprintf(stderr, "%s: %s: bad line: %s", pgmname, path,
+			    line);
+			exit(1);
+		}
+		recs[n].off = off;
+		if (recs[n].len > *maxlenp)
+			*maxlenp = recs[n].len;
+		n++;
+	}
+	fclose(fp);
+	*nrecp = n;
+	return (recs);
+}
+
+int
+main(argc, argv)
+	int	argc;
+	char	**argv;
+{
+	char		*pattern = NULL, *buf;
+	struct rec	*recs;
+	double		start, elapsed, t, *lat, sum, bytes;
+	long		bsize = 8192, maxlen;
+	int		ch, i, fd, nrecs, nreads = 10000, stride = 4, rdoff = 0;
+
+	pgmname = argv[0];
+	srandom(1);
+	while ((ch = getopt(argc, argv, "ag:n:b:s:S:")) != EOF) {
+		switch (ch) {
+		case 'a':
+			rdoff = 1;
+			break;
+		case 'g':
+			pattern = optarg;
+			break;
+		case 'n':
+			nreads = atoi(optarg);
+			break;
+		case 'b':
+			bsize = atol(optarg);
+			break;
+		case 's':
+			stride = atoi(optarg);
+			break;
+		case 'S':
+			srandom(atoi(optarg));
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (pattern != NULL) {
+		if (argc != 0 || nreads <= 0 || bsize <= 0 || stride <= 0)
+			usage();
+		generate(pattern, nreads, bsize, stride);
+		exit(0);
+	}
+	if (argc != 2)
+		usage();
+
+	recs = load(argv[1], &nrecs, &maxlen);
+	if (nrecs == 0) {
+		fprintf(stderr, "%s: %s: empty trace\n", pgmname, argv[1]);
+		exit(1);
+	}
+	if ((buf = malloc(maxlen)) == NULL ||
+	    (lat = malloc(nrecs * sizeof (double))) == NULL)
+		fail("malloc", "");
+	if ((fd = open(argv[0], O_RDONLY)) < 0)
+		fail("open", argv[0]);
+	if (rdoff && fcntl(fd, F_RDAHEAD, 0) < 0)
+		fail("F_RDAHEAD", argv[0]);
+
+	bytes = 0;
+	start = now();
+	for (i = 0; i < nrecs; i++) {
+		t = now();
+		if (lseek(fd, recs[i].off, SEEK_SET) < 0)
+			fail("lseek", argv[0]);
+		if (read(fd, buf, recs[i].len) != recs[i].len) {
+			fprintf(stderr, "%s: %s: short read at %ld\n",
+			    pgmname, argv[0], (long)recs[i].off);
+			exit(1);
+		}
+		lat[i] = (now() - t) * 1e6;
+		bytes += recs[i].len;
+	}
+	elapsed = now() - start;
+	close(fd);
+
+	printf("%d reads, %.0f bytes in %.2fs, %.2f MB/s, read-ahead %s\n",
+	    nrecs, bytes, elapsed,
+	    elapsed > 0 ? bytes / elapsed / (1024 * 1024) : 0.0,
+	    rdoff ? "off" : "on");
+	qsort(lat, nrecs, sizeof (double), compare);
+	for (i = 0, sum = 0; i < nrecs; i++)
+		sum += lat[i];
+	printf("latency: mean %.0fus, median %.0fus, 99%% %.0fus, "
+	    "max %.0fus\n", sum / nrecs, lat[nrecs / 2],
+	    lat[nrecs * 99 / 100], lat[nrecs - 1]);
+	exit(0);
+}
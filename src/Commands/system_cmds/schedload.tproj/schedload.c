@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * "Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.0 (the 'License').  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License."
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *	File:	schedload.c
+ *
+ *	Synthetic scheduler load.  Runs N compute-bound threads and
+ *	M I/O-bound threads for a while, then reports compute throughput,
+ *	how long the I/O threads took to run after being woken, and the
+ *	per-processor scheduler counters from host_info.
+ *
+ *	Each I/O thread blocks reading its own pipe.  A waker thread
+ *	writes a timestamp down every pipe once per interval, the way
+ *	a device interrupt would make several threads runnable at once;
+ *	wakeup latency is the time from that write until the reader
+ *	is back on a processor.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <mach/mach.h>
+#include <mach/cthreads.h>
+
+#define	WORK_UNIT	10000		/* loop iterations per unit */
+#define	NBUCKETS	5
+
+struct compute {
+	cthread_t		thread;
+	volatile unsigned long	units;
+	char			pad[56];	/* own cache line */
+};
+
+struct io {
+	cthread_t		thread;
+	int			fd[2];
+	unsigned long		wakeups;
+	double			total_usec;
+	double			max_usec;
+	unsigned long		bucket[NBUCKETS];
+};
+
+/* latency histogram upper bounds, usec; the last bucket is open */
+static double	bucket_limit[NBUCKETS - 1] = { 100, 1000, 10000, 100000 };
+static char	*bucket_name[NBUCKETS] =
+		    { "<100us", "<1ms", "<10ms", "<100ms", ">=100ms" };
+
+static volatile int	done;
+static struct compute	*compute;
+static struct io	*io;
+static int		ncompute, nio, interval_ms;
+static char		*pgmname;
+
+static double
+now_usec()
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, 0);
+	return (double)tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
+static any_t
+compute_thread(arg)
+	any_t	arg;
+{
+	struct compute		*c = (struct compute *)arg;
+	volatile unsigned int	x;
+	int			i;
+
+	x = 1;
+	while (!done) {
+		for (i = 0; i < WORK_UNIT; i++)
+			x = x * 1103515245 + 12345;
+		c->units++;
+	}
+	return 0;
+}
+
+static any_t
+io_thread(arg)
+	any_t	arg;
+{
+	struct io	*p = (struct io *)arg;
+	double		stamp, lat;
+	volatile int	x;
+	int		b;
+
+	for (;;) {
+		if (read(p->fd[0], (char *)&stamp, sizeof stamp) !=
+		    sizeof stamp || stamp == 0)
+			break;
+		lat = now_usec() - stamp;
+		p->wakeups++;
+		p->total_usec += lat;
+		if (lat > p->max_usec)
+			p->max_usec = lat;
+		for (b = 0; b < NBUCKETS - 1; b++)
+			if (lat < bucket_limit[b])
+				break;
+		p->bucket[b]++;
+
+		/* a little work per request */
+		for (x = 0; x < WORK_UNIT / 10; x++)
+			;
+	}
+	return 0;
+}
+
+static any_t
+waker_thread(arg)
+	any_t	arg;
+{
+	struct timeval	tv;
+	double		stamp;
+	int		i;
+
+	while (!done) {
+		tv.tv_sec = interval_ms / 1000;
+		tv.tv_usec = (interval_ms % 1000) * 1000;
+		select(0, 0, 0, 0, &tv);
+		for (i = 0; i < nio; i++) {
+			stamp = now_usec();
+			write(io[i].fd[1], (char *)&stamp, sizeof stamp);
+		}
+	}
+	stamp = 0;
+	for (i = 0; i < nio; i++)
+		write(io[i].fd[1], (char *)&stamp, sizeof stamp);
+	return 0;
+}
+
+static int
+sched_cpu_info(info, count)
+	struct host_sched_cpu_info	*info;
+	int				*count;
+{
+	kern_return_t	ret;
+
+	*count = HOST_INFO_MAX;
+	ret = host_info(host_self(), HOST_SCHED_CPU_INFO,
+			(host_info_t)info, count);
+	if (ret != KERN_SUCCESS)
+		return 0;
+	*count /= HOST_SCHED_CPU_INFO_COUNT;
+	return 1;
+}
+
+static void
+usage()
+{
+	fprintf(stderr,
+	    "usage: %s [-c compute] [-i io] [-t seconds] [-w wake_ms]\n",
+	    pgmname);
+	exit(1);
+}
+
+main(argc, argv)
+	int	argc;
+	char	*argv[];
+{
+	static host_info_data_t		before_buf, after_buf;
+	struct host_sched_cpu_info	*before, *after;
+	struct host_basic_info		hi;
+	static host_info_data_t		sample_buf;
+	struct host_sched_cpu_info	*sample;
+	static int			depth[HOST_INFO_MAX];
+	int				nbefore, nafter, nsample, have_counters;
+	int				seconds, samples, i, j, ch, count;
+	unsigned long			total, min, max, wakeups;
+	unsigned long			bucket[NBUCKETS];
+	double				elapsed, start, lat, maxlat;
+	cthread_t			waker;
+	extern char			*optarg;
+	extern int			optind;
+
+	pgmname = argv[0];
+	count = HOST_BASIC_INFO_COUNT;
+	if (host_info(host_self(), HOST_BASIC_INFO, (host_info_t)&hi,
+		      &count) != KERN_SUCCESS)
+		hi.avail_cpus = 1;
+	ncompute = 2 * hi.avail_cpus;
+	nio = 4;
+	seconds = 10;
+	interval_ms = 10;
+
+	while ((ch = getopt(argc, argv, "c:i:t:w:")) != EOF) {
+		switch (ch) {
+		case 'c':
+			ncompute = atoi(optarg);
+			break;
+		case 'i':
+			nio = atoi(optarg);
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		case 'w':
+			interval_ms = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind != argc || ncompute < 0 || nio < 0 ||
+	    seconds <= 0 || interval_ms <= 0)
+		usage();
+
+	compute = (struct compute *)calloc(ncompute + 1, sizeof *compute);
+	io = (struct io *)calloc(nio + 1, sizeof *io);
+	if (compute == 0 || io == 0) {
+		fprintf(stderr, "%s: out of memory\n", pgmname);
+		exit(1);
+	}
+	for (i = 0; i < nio; i++) {
+		if (pipe(io[i].fd) < 0) {
+			perror("pipe");
+			exit(1);
+		}
+	}
+
+	before = (struct host_sched_cpu_info *)before_buf;
+	after = (struct host_sched_cpu_info *)after_buf;
+	have_counters = sched_cpu_info(before, &nbefore);
+
+	printf("%d cpus, %d compute threads, %d io threads, "
+	       "%d ms wakeups, %d seconds\n",
+	       hi.avail_cpus, ncompute, nio, interval_ms, seconds);
+
+	start = now_usec();
+	for (i = 0; i < ncompute; i++)
+		compute[i].thread = cthread_fork(compute_thread,
+						 (any_t)&compute[i]);
+	for (i = 0; i < nio; i++)
+		io[i].thread = cthread_fork(io_thread, (any_t)&io[i]);
+	waker = cthread_fork(waker_thread, (any_t)0);
+
+	/*
+	 *	Queue depths only mean something while the load runs,
+	 *	so sample them once a second.
+	 */
+	sample = (struct host_sched_cpu_info *)sample_buf;
+	for (samples = 0; samples < seconds; samples++) {
+		sleep(1);
+		if (have_counters && sched_cpu_info(sample, &nsample))
+			for (i = 0; i < nsample; i++)
+				depth[sample[i].slot_num] +=
+				    sample[i].queue_depth;
+	}
+	done = 1;
+
+	cthread_join(waker);
+	for (i = 0; i < nio; i++)
+		cthread_join(io[i].thread);
+	for (i = 0; i < ncompute; i++)
+		cthread_join(compute[i].thread);
+	elapsed = (now_usec() - start) / 1000000.0;
+
+	if (have_counters)
+		have_counters = sched_cpu_info(after, &nafter);
+
+	/*
+	 *	Compute throughput, and how evenly it was shared.
+	 */
+	if (ncompute > 0) {
+		total = 0;
+		min = max = compute[0].units;
+		for (i = 0; i < ncompute; i++) {
+			total += compute[i].units;
+			if (compute[i].units < min)
+				min = compute[i].units;
+			if (compute[i].units > max)
+				max = compute[i].units;
+		}
+		printf("compute: %.0f units/s total, %.0f/s per thread "
+		       "(min %.0f, max %.0f)\n",
+		       total / elapsed, total / elapsed / ncompute,
+		       min / elapsed, max / elapsed);
+	}
+
+	/*
+	 *	Wakeup latency over all I/O threads.
+	 */
+	if (nio > 0) {
+		wakeups = 0;
+		lat = maxlat = 0;
+		bzero((char *)bucket, sizeof bucket);
+		for (i = 0; i < nio; i++) {
+			wakeups += io[i].wakeups;
+			lat += io[i].total_usec;
+			if (io[i].max_usec > maxlat)
+				maxlat = io[i].max_usec;
+			for (j = 0; j < NBUCKETS; j++)
+				bucket[j] += io[i].bucket[j];
+		}
+		printf("wakeup:  %lu wakeups, avg %.0f us, max %.0f us\n",
+		       wakeups, wakeups ? lat / wakeups : 0.0, maxlat);
+		printf("        ");
+		for (j = 0; j < NBUCKETS; j++)
+			printf(" %s %lu", bucket_name[j], bucket[j]);
+		printf("\n");
+	}
+
+	/*
+	 *	Scheduler counters, as deltas over the run.
+	 */
+	if (!have_counters) {
+		printf("(kernel does not report HOST_SCHED_CPU_INFO)\n");
+		exit(0);
+	}
+	printf("cpu     csw/s  steals  migrations  avg queued\n");
+	for (i = 0; i < nafter; i++) {
+		for (j = 0; j < nbefore; j++)
+			if (before[j].slot_num == after[i].slot_num)
+				break;
+		if (j == nbefore)
+			continue;
+		printf("%3d %9.0f %7u %11u %11.1f\n", after[i].slot_num,
+		       (unsigned)(after[i].context_switches -
+				  before[j].context_switches) / elapsed,
+		       (unsigned)(after[i].steals - before[j].steals),
+		       (unsigned)(after[i].migrations - before[j].migrations),
+		       (double)depth[after[i].slot_num] / seconds);
+	}
+	exit(0);
+}
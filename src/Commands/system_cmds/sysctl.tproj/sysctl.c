@@ -77,12 +77,17 @@ static char sccsid[] = "@(#)sysctl.c	8.5 (Berkeley) 5/9/95";
 #endif /* !NeXT */
 #include <machine/cpu.h>
 
+#include <net/route.h>
 #include <netinet/in.h>
 #include <netinet/in_systm.h>
 #include <netinet/ip.h>
+#include <netinet/in_pcb.h>
 #include <netinet/ip_icmp.h>
 #include <netinet/icmp_var.h>
 #include <netinet/ip_var.h>
+#include <netinet/tcp.h>
+#include <netinet/tcp_timer.h>
+#include <netinet/tcp_var.h>
 #include <netinet/udp.h>
 #include <netinet/udp_var.h>
 
@@ -134,6 +139,7 @@ int	Aflag, aflag, nflag, wflag;
 #define	CLOCK		0x00000001
 #define	BOOTTIME	0x00000002
 #define	CONSDEV		0x00000004
+#define	PCBHASH		0x00000008
 
 int
 main(argc, argv)
@@ -328,8 +334,12 @@ parse(string, flags)
 	case CTL_NET:
 		if (mib[1] == PF_INET) {
 			len = sysctl_inet(string, &bufp, mib, flags, &type);
-			if (len >= 0)
+			if (len >= 0) {
+				if (type == CTLTYPE_STRUCT &&
+				    (mib[2] == IPPROTO_TCP || mib[2] == IPPROTO_UDP))
+					special |= PCBHASH;
 				break;
+			}
 			return;
 		}
 		if (flags == 0)
@@ -447,6 +457,26 @@ parse(string, flags)
 			fprintf(stdout, "0x%x\n", dev);
 		return;
 	}
+	if (special & PCBHASH) {
+		struct inpcb_hash_stats *ihs = (struct inpcb_hash_stats *)buf;
+		static char *depthname[INP_HASH_NDEPTH] =
+		    { "0", "1", "2", "3", "4-7", "8-15", "16-31", "32+" };
+		int i;
+
+		if (!nflag)
+			fprintf(stdout, "%s: ", string);
+		fprintf(stdout,
+		    "buckets = %lu/%lu, entries = %lu, resizes = %lu, longest = %lu\n",
+		    ihs->ihs_buckets, ihs->ihs_maxbuckets, ihs->ihs_entries,
+		    ihs->ihs_resizes, ihs->ihs_longest);
+		if (!nflag)
+			fprintf(stdout, "%s: ", string);
+		fprintf(stdout, "depth");
+		for (i = 0; i < INP_HASH_NDEPTH; i++)
+			fprintf(stdout, " %s:%lu", depthname[i], ihs->ihs_depth[i]);
+		fprintf(stdout, "\n");
+		return;
+	}
 	switch (type) {
 	case CTLTYPE_INT:
 		if (newsize == 0) {
@@ -570,6 +600,7 @@ vfsinit()
 struct ctlname inetname[] = CTL_IPPROTO_NAMES;
 struct ctlname ipname[] = IPCTL_NAMES;
 struct ctlname icmpname[] = ICMPCTL_NAMES;
+struct ctlname tcpname[] = TCPCTL_NAMES;
 struct ctlname udpname[] = UDPCTL_NAMES;
 struct list inetlist = { inetname, IPPROTO_MAXID };
 struct list inetvars[] = {
@@ -579,7 +610,7 @@ struct list inetvars[] = {
 	{ 0, 0 },			/* ggmp */
 	{ 0, 0 },
 	{ 0, 0 },
-	{ 0, 0 },			/* tcp */
+	{ tcpname, TCPCTL_MAXID },	/* tcp */
 	{ 0, 0 },
 	{ 0, 0 },			/* egp */
 	{ 0, 0 },
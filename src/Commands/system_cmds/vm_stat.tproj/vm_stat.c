@@ -43,6 +43,7 @@
 #include <mach/mach.h>
 
 struct vm_statistics	vm_stat, last;
+struct host_vm_fault_info	fault_stat, last_fault;
 int	percent;
 
 
@@ -88,7 +89,7 @@ banner()
 	printf("Mach Virtual Memory Statistics: ");
 	printf("(page size of %d bytes, cache hits %d%%)\n",
 				vm_stat.pagesize, percent);
-	printf("%6s %6s %4s %4s %8s %8s %8s %8s %8s %8s\n",
+	printf("%6s %6s %4s %4s %8s %8s %8s %8s %8s %6s %8s %5s\n",
 		"free",
 		"active",
 		"inac",
@@ -98,8 +99,11 @@ banner()
 		"zerofill",
 		"reactive",
 		"pageins",
-		"pageout");
+		"pgios",
+		"pageout",
+		"execs");
 	bzero(&last, sizeof(last));
+	bzero(&last_fault, sizeof(last_fault));
 }
 snapshot()
 {
@@ -117,6 +121,12 @@ snapshot()
 	pstat("Pages reactivated:", vm_stat.reactivations);
 	pstat("Pageins:", vm_stat.pageins);
 	pstat("Pageouts:", vm_stat.pageouts);
+	pstat("Pagein I/Os:", fault_stat.pagein_ios);
+	pstat("Pages mapped around faults:", fault_stat.faultaround);
+	pstat("Programs executed:", fault_stat.execs);
+	if (fault_stat.execs != 0)
+		printf("%-25s %10d.\n", "Faults per exec:",
+		       vm_stat.faults / fault_stat.execs);
 	printf("Object cache: %d hits of %d lookups (%d%% hit rate)\n",
 			vm_stat.hits, vm_stat.lookups, percent);
 }
@@ -139,7 +149,7 @@ print_stats()
 		count = 0;
 
 	get_stats(&vm_stat);
-	printf("%6d %6d %4d %4d %8d %8d %8d %8d %8d %8d\n",
+	printf("%6d %6d %4d %4d %8d %8d %8d %8d %8d %6d %8d %5d\n",
 		vm_stat.free_count,
 		vm_stat.active_count,
 		vm_stat.inactive_count,
@@ -149,17 +159,26 @@ print_stats()
 		vm_stat.zero_fill_count - last.zero_fill_count,
 		vm_stat.reactivations - last.reactivations,
 		vm_stat.pageins - last.pageins,
-		vm_stat.pageouts - last.pageouts);
+		fault_stat.pagein_ios - last_fault.pagein_ios,
+		vm_stat.pageouts - last.pageouts,
+		fault_stat.execs - last_fault.execs);
 	last = vm_stat;
+	last_fault = fault_stat;
 }
 
 get_stats(stat)
 	struct vm_statistics	*stat;
 {
+	unsigned int	count = HOST_VM_FAULT_INFO_COUNT;
+
 	if (vm_statistics(current_task(), stat) != KERN_SUCCESS) {
 		fprintf(stderr, "%s: failed to get statistics.\n", pgmname);
 		exit(2);
 	}
+	/* older kernels don't have these; show zeroes */
+	if (host_info(host_self(), HOST_VM_FAULT_INFO,
+		      (host_info_t)&fault_stat, &count) != KERN_SUCCESS)
+		bzero(&fault_stat, sizeof(fault_stat));
 	if (stat->lookups == 0)
 		percent = 0;
 	else
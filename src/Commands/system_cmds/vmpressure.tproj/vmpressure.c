@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * "Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.0 (the 'License').  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License."
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *	File:	vmpressure.c
+ *
+ *	Memory pressure from a file scan against an interactive
+ *	working set.  One thread reads a file larger than memory from
+ *	start to end, over and over, through a mapping; meanwhile the
+ *	main thread touches every page of an anonymous working set,
+ *	pausing between passes the way an interactive program would.
+ *
+ *	The working set should stay resident: the file is never read
+ *	twice within a pass of memory.  Reports how long working set
+ *	passes took, the pageins over the run, and the pageout
+ *	daemon's counters from HOST_VM_PAGEOUT_INFO.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <mach/mach.h>
+#include <mach/cthreads.h>
+
+#define	MB		(1024 * 1024)
+#define	CHUNK		(64 * 1024)	/* file creation writes */
+
+static volatile int	done;
+static char		*file_base;
+static vm_size_t	file_size;
+static unsigned long	file_passes;
+static char		*pgmname;
+
+static double
+now_usec()
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, 0);
+	return (double)tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
+static void
+fail(what)
+	char	*what;
+{
+	fprintf(stderr, "%s: ", pgmname);
+	perror(what);
+	exit(1);
+}
+
+/*
+ *	Read every page of the file mapping, in order, until told
+ *	to stop.
+ */
+static any_t
+scan_thread(arg)
+	any_t	arg;
+{
+	volatile char	*p;
+	vm_size_t	off;
+	int		sum = 0;
+
+	while (!done) {
+		p = file_base;
+		for (off = 0; off < file_size && !done; off += vm_page_size)
+			sum += p[off];
+		file_passes++;
+	}
+	return (any_t)sum;
+}
+
+static int
+pageout_info(info)
+	struct host_vm_pageout_info	*info;
+{
+	int	count = HOST_VM_PAGEOUT_INFO_COUNT;
+
+	return host_info(host_self(), HOST_VM_PAGEOUT_INFO,
+			 (host_info_t)info, &count) == KERN_SUCCESS;
+}
+
+static void
+print_queue(name, after, before)
+	char				*name;
+	struct host_vm_pageout_queue	*after, *before;
+{
+	printf("%-6s %9d %9u %9u %9u %9u\n", name, after->inactive,
+	       (unsigned)(after->scanned - before->scanned),
+	       (unsigned)(after->reclaimed - before->reclaimed),
+	       (unsigned)(after->activated - before->activated),
+	       (unsigned)(after->refaults - before->refaults));
+}
+
+static void
+usage()
+{
+	fprintf(stderr,
+	    "usage: %s [-w ws_mb] [-s file_mb] [-t seconds] [-p pause_ms] "
+	    "[file]\n", pgmname);
+	exit(1);
+}
+
+main(argc, argv)
+	int	argc;
+	char	*argv[];
+{
+	struct host_basic_info		hi;
+	struct host_vm_pageout_info	before, after;
+	struct vm_statistics		vs_before, vs_after;
+	struct timeval			tv;
+	struct stat			st;
+	cthread_t			scanner;
+	vm_address_t			ws;
+	vm_size_t			ws_size, off;
+	double				start, t, total, max, elapsed;
+	char				*path, *buf, tmpname[64];
+	int				ws_mb, file_mb, seconds, pause_ms;
+	int				fd, ch, count, passes, have_info;
+	extern char			*optarg;
+	extern int			optind;
+
+	pgmname = argv[0];
+	count = HOST_BASIC_INFO_COUNT;
+	if (host_info(host_self(), HOST_BASIC_INFO, (host_info_t)&hi,
+		      &count) != KERN_SUCCESS) {
+		fprintf(stderr, "%s: can't get host info\n", pgmname);
+		exit(1);
+	}
+	ws_mb = hi.memory_size / MB / 4;
+	file_mb = 2 * hi.memory_size / MB;
+	seconds = 30;
+	pause_ms = 100;
+
+	while ((ch = getopt(argc, argv, "w:s:t:p:")) != EOF) {
+		switch (ch) {
+		case 'w':
+			ws_mb = atoi(optarg);
+			break;
+		case 's':
+			file_mb = atoi(optarg);
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		case 'p':
+			pause_ms = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (argc - optind > 1 || ws_mb <= 0 || file_mb <= 0 ||
+	    seconds <= 0 || pause_ms < 0)
+		usage();
+
+	/*
+	 *	Use the file given, or make one of file_mb megabytes.
+	 */
+	path = 0;
+	if (optind < argc) {
+		path = argv[optind];
+		if ((fd = open(path, O_RDONLY)) < 0)
+			fail(path);
+	} else {
+		strcpy(tmpname, "/tmp/vmpressure.XXXXXX");
+		if ((fd = mkstemp(tmpname)) < 0)
+			fail("mkstemp");
+		unlink(tmpname);
+		if ((buf = malloc(CHUNK)) == 0)
+			fail("malloc");
+		memset(buf, 'x', CHUNK);
+		printf("writing %d MB scratch file...\n", file_mb);
+		for (off = 0; off < (vm_size_t)file_mb * MB; off += CHUNK)
+			if (write(fd, buf, CHUNK) != CHUNK)
+				fail("write");
+		free(buf);
+	}
+	if (fstat(fd, &st) < 0)
+		fail("fstat");
+	file_size = st.st_size;
+	file_base = mmap(0, file_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (file_base == (char *)-1)
+		fail("mmap");
+
+	/*
+	 *	Build the working set and dirty it, so it has to be
+	 *	paged out to the swapfile to be reclaimed.
+	 */
+	ws_size = (vm_size_t)ws_mb * MB;
+	if (vm_allocate(task_self(), &ws, ws_size, TRUE) != KERN_SUCCESS) {
+		fprintf(stderr, "%s: can't allocate working set\n", pgmname);
+		exit(1);
+	}
+	for (off = 0; off < ws_size; off += vm_page_size)
+		((char *)ws)[off] = 1;
+
+	printf("%d MB memory, %d MB working set, %lu MB file, "
+	       "%d ms pause, %d seconds\n", (int)(hi.memory_size / MB),
+	       ws_mb, (unsigned long)(file_size / MB), pause_ms, seconds);
+
+	have_info = pageout_info(&before);
+	vm_statistics(task_self(), &vs_before);
+
+	start = now_usec();
+	scanner = cthread_fork(scan_thread, (any_t)0);
+
+	passes = 0;
+	total = max = 0;
+	while (now_usec() - start < seconds * 1000000.0) {
+		t = now_usec();
+		for (off = 0; off < ws_size; off += vm_page_size)
+			((volatile char *)ws)[off]++;
+		t = now_usec() - t;
+		passes++;
+		total += t;
+		if (t > max)
+			max = t;
+
+		tv.tv_sec = pause_ms / 1000;
+		tv.tv_usec = (pause_ms % 1000) * 1000;
+		select(0, 0, 0, 0, &tv);
+	}
+	done = 1;
+	cthread_join(scanner);
+	elapsed = (now_usec() - start) / 1000000.0;
+
+	vm_statistics(task_self(), &vs_after);
+
+	printf("working set: %d passes, avg %.1f ms, max %.1f ms\n",
+	       passes, total / passes / 1000.0, max / 1000.0);
+	printf("file scan:   %lu passes, %.1f MB/s\n", file_passes,
+	       (double)file_passes * file_size / MB / elapsed);
+	printf("pageins %d, pageouts %d\n",
+	       vs_after.pageins - vs_before.pageins,
+	       vs_after.pageouts - vs_before.pageouts);
+
+	if (!have_info || !pageout_info(&after)) {
+		printf("(kernel does not report HOST_VM_PAGEOUT_INFO)\n");
+		exit(0);
+	}
+	printf("active %d, inactive target %d, history %d pages\n",
+	       after.active, after.inactive_target, after.history_size);
+	printf("active: %u scanned, %u deactivated\n",
+	       (unsigned)(after.active_scanned - before.active_scanned),
+	       (unsigned)(after.deactivated - before.deactivated));
+	printf("%-6s %9s %9s %9s %9s %9s\n", "queue", "inactive",
+	       "scanned", "reclaimed", "activated", "refaults");
+	print_queue("anon", &after.anon, &before.anon);
+	print_queue("file", &after.file, &before.file);
+	exit(0);
+}
@@ -79,6 +79,9 @@
  *	which the given name is a substring of the zone's name.
  *	With a "-w" flag, calculates how much much space is allocated
  *	to zones but not currently in use.
+ *	With a "-m" flag, shows the magazine size of each zone, the free
+ *	elements held in its magazines, the full and empty magazines in
+ *	its depot, and how often allocations were satisfied there.
  */
 
 #include <stdio.h>
@@ -105,6 +108,7 @@ static boolean_t SortZones = FALSE;
 static boolean_t ColFormat = TRUE;
 static boolean_t PrintHeader = TRUE;
 static boolean_t ShowFreeSpace = FALSE;
+static boolean_t ShowMagazines = FALSE;
 
 static unsigned int totalsize = 0;
 static unsigned int totalused = 0;
@@ -112,7 +116,8 @@ static unsigned int totalused = 0;
 static void
 usage()
 {
-	fprintf(stderr, "usage: %s [-w] [-f] [-s] [-c] [-h] [name]\n", program);
+	fprintf(stderr, "usage: %s [-w] [-f] [-m] [-s] [-c] [-h] [name]\n",
+		program);
 	exit(1);
 }
 
@@ -152,6 +157,10 @@ main(argc, argv)
 			ShowWasted = FALSE;
 		else if (streql(argv[i], "-f"))
 			ShowFreeSpace = TRUE;
+		else if (streql(argv[i], "-m"))
+			ShowMagazines = TRUE;
+		else if (streql(argv[i], "-M"))
+			ShowMagazines = FALSE;
 		else if (streql(argv[i], "-s"))
 			SortZones = TRUE;
 		else if (streql(argv[i], "-S"))
@@ -423,6 +432,16 @@ printzone(name, info)
 		printf("\tPAGEABLE\n");
 	if (info->zi_collectable)
 		printf("\tCOLLECTABLE\n");
+	if (info->zi_mag_rounds > 0) {
+		printf("\tmagazines:   %d rounds, %d elements cached\n",
+		       info->zi_mag_rounds, info->zi_mag_cached);
+		printf("\tdepot:       %d full, %d empty (%u gets, %u puts)\n",
+		       info->zi_depot_full, info->zi_depot_empty,
+		       info->zi_depot_gets, info->zi_depot_puts);
+		printf("\tmag hits:    %u/%u allocs, %u/%u frees\n",
+		       info->zi_mag_alloc_hits, info->zi_mag_allocs,
+		       info->zi_mag_free_hits, info->zi_mag_frees);
+	}
 
 	if (ShowWasted) {
 		totalused += used = info->zi_elem_size * info->zi_count;
@@ -493,6 +512,17 @@ colprintzone(zone_name, info)
 	if (ShowWasted) {
 		printf("%7d", size - used);
 	}
+	if (ShowMagazines) {
+		if (info->zi_mag_rounds > 0)
+			printf("%4d%7d%6d%6d%4d%%", info->zi_mag_rounds,
+			       info->zi_mag_cached, info->zi_depot_full,
+			       info->zi_depot_empty,
+			       info->zi_mag_allocs > 0 ?
+			       (int)((double)info->zi_mag_alloc_hits * 100 /
+				     info->zi_mag_allocs) : 0);
+		else
+			printf("   -      -     -     -    -");
+	}
 
 	printf("%c%c\n",
 	       (info->zi_pageable ? 'P' : ' '),
@@ -507,15 +537,27 @@ colprintzoneheader()
 	}
 	if (ShowWasted) {
 		printf("                   elem    cur    max    cur    max%s",
-		       "   cur alloc alloc\n");
+		       "   cur alloc alloc       ");
+		if (ShowMagazines)
+			printf(" mag    mag depot depot  mag");
+		printf("\n");
 		printf("zone name          size   size   size  #elts  #elts%s",
-		       " inuse  size count wasted\n");
+		       " inuse  size count wasted");
 	} else {
 		printf("                          elem    cur    max    cur%s",
-		       "    max   cur alloc alloc\n");
+		       "    max   cur alloc alloc");
+		if (ShowMagazines)
+			printf(" mag    mag depot depot  mag");
+		printf("\n");
 		printf("zone name                 size   size   size  #elts%s",
-		       "  #elts inuse  size count\n");
+		       "  #elts inuse  size count");
 	}
+	if (ShowMagazines)
+		printf("size cached  full empty hit%%");
+	printf("\n");
 	printf("-----------------------------------------------%s",
-	       "--------------------------------\n");
+	       "--------------------------------");
+	if (ShowMagazines)
+		printf("----------------------------");
+	printf("\n");
 }
@@ -401,6 +401,75 @@ struct malloc_static_t {
 
 static struct malloc_static_t malloc_static = { 0 };
 
+/*
+ * The small block front end.
+ *
+ * Requests for up to SLAB_MAXSIZE bytes from the default zone are
+ * served from size-class slabs instead of the free heap.  A slab is
+ * one page: a slab_t header followed by blocks of a single size,
+ * with the free blocks chained through their first word.  Slabs are
+ * cut from SLAB_SEGSIZE aligned segments, and a bitmap of segments
+ * lets free(), realloc() and malloc_size() recognize a slab block
+ * without taking the malloc lock or searching the region array;
+ * malloc_size() is then just the size in the slab header.
+ *
+ * In front of the slabs are SLAB_NCACHES caches of free blocks, one
+ * list per size class.  A thread picks its cache by hashing its stack
+ * address, so threads normally find their cache uncontended.  Caches
+ * are only ever try-locked; if a cache is busy the caller goes to the
+ * slabs under slab_lock.  Locks are taken in the order malloc lock,
+ * cache, slab_lock, and the slab code never takes the malloc lock.
+ *
+ * Slab blocks belong to the default zone as far as the NXZone
+ * interface is concerned.  Other zones, and all larger blocks, still
+ * use the free heap.
+ */
+#define SLAB_QUANTUM	16		/* size class spacing (and alignment) */
+#define SLAB_MAXSIZE	512		/* largest block served from slabs */
+#define SLAB_NCLASSES	(SLAB_MAXSIZE / SLAB_QUANTUM)
+#define SLAB_CLASS(size)	(((size) - 1) / SLAB_QUANTUM)
+#define SLAB_SIZE(class)	(((class) + 1) * SLAB_QUANTUM)
+
+#define SLAB_SEGSHIFT	16
+#define SLAB_SEGSIZE	(1 << SLAB_SEGSHIFT)
+#define SLAB_NSEGS	(1 << (32 - SLAB_SEGSHIFT))
+
+#define SLAB_CACHESHIFT	4
+#define SLAB_NCACHES	(1 << SLAB_CACHESHIFT)
+#define SLAB_CACHEMAX	32		/* blocks per class in a cache */
+#define SLAB_BATCH	(SLAB_CACHEMAX / 2)	/* blocks moved per refill/flush */
+
+typedef struct slab {
+	struct slab	*next;		/* partial list, or free page list */
+	struct slab	*prev;
+	void		*freelist;	/* free blocks in this slab */
+	unsigned short	size;		/* block size, 0 if page unused */
+	unsigned short	inuse;		/* blocks handed out */
+} slab_t;
+
+#define SLAB_HDRSIZE	((sizeof(slab_t) + SLAB_QUANTUM - 1) & ~(SLAB_QUANTUM - 1))
+#define SLAB_PAGE(ptr)	((slab_t *)((unsigned)(ptr) & ~(vm_page_size - 1)))
+#define SLAB_ISSLAB(ptr) \
+	(slab_segmap[(unsigned)(ptr) >> (SLAB_SEGSHIFT + 3)] & \
+	    (1 << (((unsigned)(ptr) >> SLAB_SEGSHIFT) & 7)))
+#define SLAB_SETSEG(seg) \
+	(slab_segmap[(unsigned)(seg) >> (SLAB_SEGSHIFT + 3)] |= \
+	    (1 << (((unsigned)(seg) >> SLAB_SEGSHIFT) & 7)))
+
+typedef struct slab_cache {
+	struct mutex	lock;
+	void		*freeme;		/* one deep free */
+	void		*head[SLAB_NCLASSES];
+	unsigned char	count[SLAB_NCLASSES];
+} slab_cache_t;
+
+static unsigned char	slab_segmap[SLAB_NSEGS / 8];
+static slab_t		*slab_partial[SLAB_NCLASSES];
+static slab_t		*slab_freepages;
+static struct mutex	slab_lock = MUTEX_INITIALIZER;
+static slab_cache_t	slab_caches[SLAB_NCACHES];
+static int		slab_enabled;
+
 static void *_valloczonenolock(size_t *size);
 static region_t *findregionnolock(void *ptr);
 static region_t *addregionnolock(char *start, int size, zone_t *zonep);
@@ -445,6 +514,13 @@ static void malloc_check(char *str);
 static void errmessage(char *str);
 static void stdmessage(char *str);
 
+static void *slab_alloc(size_t size);
+static void slab_free(void *ptr, int onedeep);
+static void *slab_realloc(void *ptr, size_t size);
+static void slab_drain(void);
+static void slab_adopt(char *seg);
+static void *defaultzonemalloc(NXZone *z, size_t size);
+
 
 #define MARKFREESPOT(f,n) ((int *)(f)->data)[(f)->size / sizeof(int) - 1] = n
 #define NOTPAGEALIGNED(a) (((int)a & (vm_page_size - 1)) != 0)
@@ -456,7 +532,10 @@ static void stdmessage(char *str);
 	if(malloc_static.freeme) {\
 	    void *freeme = malloc_static.freeme;\
 	    malloc_static.freeme = 0;\
-	    if(malloc_static.max_zone == 1 && NOTPAGEALIGNED(freeme)) {\
+	    if(SLAB_ISSLAB(freeme)) {\
+		slab_free(freeme, 0);\
+	    }\
+	    else if(malloc_static.max_zone == 1 && NOTPAGEALIGNED(freeme)) {\
 		nxzonefreenolock(malloc_static.defaultzone,freeme);\
 	    }\
 	    else {\
@@ -477,6 +556,9 @@ size_t malloc_size (void *ptr)
 header_t *headerp;
 region_t *regionp;
 
+  if(SLAB_ISSLAB(ptr))
+    return(SLAB_PAGE(ptr)->size);
+
   if(!NOTPAGEALIGNED(ptr)) {
     regionp = findregionnolock(ptr);
     if(!regionp->zonep)
@@ -490,9 +572,297 @@ region_t *regionp;
 
 size_t malloc_good_size (size_t byteSize)
 {
+  if(byteSize > 0 && byteSize <= SLAB_MAXSIZE)
+    return(SLAB_SIZE(SLAB_CLASS(byteSize)));
   return byteSize;
 }
 
+/*
+ * Pick the cache for the calling thread.  sp is any address
+ * on the caller's stack.  When cthread stacks are aligned the
+ * stack base identifies the thread exactly; otherwise threads
+ * are told apart by megabyte of stack.
+ */
+static slab_cache_t *slab_cache(void *sp)
+{
+unsigned int	key = (unsigned int)sp;
+
+    if(cthread_stack_mask)
+	key &= ~cthread_stack_mask;
+    else
+	key >>= 20;
+    key *= 0x9e3779b1;		/* Fibonacci hashing */
+    return(&slab_caches[key >> (32 - SLAB_CACHESHIFT)]);
+}
+
+/*
+ * Get a fresh segment of slab pages.  Called with slab_lock held.
+ */
+static int slab_newsegment(void)
+{
+vm_address_t	addr, seg;
+int		trim;
+
+    addr = 0;
+    if(vm_allocate(task_self(), &addr, 2*SLAB_SEGSIZE, 1) != KERN_SUCCESS)
+	return(0);
+    seg = (addr + SLAB_SEGSIZE - 1) & ~(SLAB_SEGSIZE - 1);
+    if(seg != addr)
+	vm_deallocate(task_self(), addr, seg - addr);
+    trim = (addr + 2*SLAB_SEGSIZE) - (seg + SLAB_SEGSIZE);
+    if(trim > 0)
+	vm_deallocate(task_self(), seg + SLAB_SEGSIZE, trim);
+    slab_adopt((char *)seg);
+    return(1);
+}
+
+/*
+ * Enter a segment in the segment map and put its pages on the slab
+ * lists: unused pages on the free page list, pages with free blocks
+ * on their class's partial list.  Used both for fresh segments
+ * (all pages unused) and by malloc_jumpstart().
+ */
+static void slab_adopt(char *seg)
+{
+slab_t	*sp;
+char	*page;
+int	class;
+
+    SLAB_SETSEG(seg);
+    for(page = seg; page < seg + SLAB_SEGSIZE; page += vm_page_size) {
+	sp = (slab_t *)page;
+	if(sp->size == 0 || (sp->inuse == 0 && sp->freelist)) {
+	    sp->size = 0;
+	    sp->next = slab_freepages;
+	    slab_freepages = sp;
+	}
+	else if(sp->freelist) {
+	    class = SLAB_CLASS(sp->size);
+	    sp->prev = 0;
+	    sp->next = slab_partial[class];
+	    if(sp->next)
+		sp->next->prev = sp;
+	    slab_partial[class] = sp;
+	}
+    }
+}
+
+static void slab_unlink(slab_t *sp, int class)
+{
+    if(sp->prev)
+	sp->prev->next = sp->next;
+    else
+	slab_partial[class] = sp->next;
+    if(sp->next)
+	sp->next->prev = sp->prev;
+}
+
+/*
+ * Take one block of the given class from the slabs.
+ * Called with slab_lock held.
+ */
+static void *slab_getblock(int class)
+{
+slab_t	*sp;
+char	*p, *end;
+int	size;
+void	*new;
+
+    if((sp = slab_partial[class]) == 0) {
+	if(slab_freepages == 0 && !slab_newsegment())
+	    return(0);
+	sp = slab_freepages;
+	slab_freepages = sp->next;
+
+	/* Carve the page into blocks. */
+	size = SLAB_SIZE(class);
+	sp->size = size;
+	sp->inuse = 0;
+	sp->freelist = 0;
+	end = (char *)sp + vm_page_size - size;
+	for(p = (char *)sp + SLAB_HDRSIZE; p <= end; p += size) {
+	    *(void **)p = sp->freelist;
+	    sp->freelist = p;
+	}
+	sp->prev = 0;
+	sp->next = 0;
+	slab_partial[class] = sp;
+    }
+    new = sp->freelist;
+    sp->freelist = *(void **)new;
+    sp->inuse++;
+    if(sp->freelist == 0)
+	slab_unlink(sp, class);		/* now full */
+    return(new);
+}
+
+/*
+ * Return a block to its slab.  An empty slab goes back to the free
+ * page list unless it is the only partial slab of its class.
+ * Called with slab_lock held.
+ */
+static void slab_putblock(void *ptr)
+{
+slab_t	*sp = SLAB_PAGE(ptr);
+int	class = SLAB_CLASS(sp->size);
+
+    if(sp->freelist == 0) {
+	/* was full */
+	sp->prev = 0;
+	sp->next = slab_partial[class];
+	if(sp->next)
+	    sp->next->prev = sp;
+	slab_partial[class] = sp;
+    }
+    *(void **)ptr = sp->freelist;
+    sp->freelist = ptr;
+    if(--sp->inuse == 0 && (sp->next || sp->prev)) {
+	slab_unlink(sp, class);
+	sp->size = 0;
+	sp->next = slab_freepages;
+	slab_freepages = sp;
+    }
+}
+
+static void *slab_alloc(size_t size)
+{
+slab_cache_t	*cp;
+void		*new, *p;
+int		class, n;
+
+    if(size == 0)
+	size = 1;
+    class = SLAB_CLASS(size);
+    cp = slab_cache(&cp);
+    if(mutex_try_lock(&cp->lock)) {
+	if((new = cp->head[class]) == 0) {
+	    /* Refill the cache from the slabs. */
+	    mutex_lock(&slab_lock);
+	    for(n = 0; n < SLAB_BATCH; n++) {
+		if((p = slab_getblock(class)) == 0)
+		    break;
+		*(void **)p = cp->head[class];
+		cp->head[class] = p;
+	    }
+	    mutex_unlock(&slab_lock);
+	    cp->count[class] = n;
+	    if((new = cp->head[class]) == 0) {
+		mutex_unlock(&cp->lock);
+		return(0);
+	    }
+	}
+	cp->head[class] = *(void **)new;
+	cp->count[class]--;
+	mutex_unlock(&cp->lock);
+	return(new);
+    }
+    mutex_lock(&slab_lock);
+    new = slab_getblock(class);
+    mutex_unlock(&slab_lock);
+    return(new);
+}
+
+/*
+ * Free a slab block.  If onedeep is set the block is held in the
+ * cache until the next free through the same cache, as free() does
+ * for the heap under MALLOC_DEBUG_1DEEPFREE.
+ */
+static void slab_free(void *ptr, int onedeep)
+{
+slab_cache_t	*cp;
+void		*p;
+int		class, n;
+
+    cp = slab_cache(&cp);
+    if(mutex_try_lock(&cp->lock)) {
+	if(onedeep) {
+	    p = cp->freeme;
+	    cp->freeme = ptr;
+	    if((ptr = p) == 0) {
+		mutex_unlock(&cp->lock);
+		return;
+	    }
+	}
+	class = SLAB_CLASS(SLAB_PAGE(ptr)->size);
+	if(cp->count[class] >= SLAB_CACHEMAX) {
+	    /* Flush part of the cache back to the slabs. */
+	    mutex_lock(&slab_lock);
+	    for(n = 0; n < SLAB_BATCH; n++) {
+		p = cp->head[class];
+		cp->head[class] = *(void **)p;
+		slab_putblock(p);
+	    }
+	    mutex_unlock(&slab_lock);
+	    cp->count[class] -= SLAB_BATCH;
+	}
+	*(void **)ptr = cp->head[class];
+	cp->head[class] = ptr;
+	cp->count[class]++;
+	mutex_unlock(&cp->lock);
+	return;
+    }
+    mutex_lock(&slab_lock);
+    slab_putblock(ptr);
+    mutex_unlock(&slab_lock);
+}
+
+static void *slab_realloc(void *ptr, size_t size)
+{
+size_t	oldsize = SLAB_PAGE(ptr)->size;
+void	*new;
+
+    if(size <= oldsize && (size > oldsize / 2 || oldsize == SLAB_QUANTUM))
+	return(ptr);
+    if((new = malloc(size)) == 0)
+	return(0);
+    bcopy(ptr, new, size < oldsize ? size : oldsize);
+    slab_free(ptr, Z(malloc_static.defaultzone)->debug & MALLOC_DEBUG_1DEEPFREE);
+    return(new);
+}
+
+/*
+ * Return every cached block to its slab.
+ */
+static void slab_drain(void)
+{
+slab_cache_t	*cp;
+void		*p;
+int		i, class;
+
+    for(i = 0; i < SLAB_NCACHES; i++) {
+	cp = &slab_caches[i];
+	mutex_lock(&cp->lock);
+	mutex_lock(&slab_lock);
+	if(cp->freeme) {
+	    slab_putblock(cp->freeme);
+	    cp->freeme = 0;
+	}
+	for(class = 0; class < SLAB_NCLASSES; class++) {
+	    while((p = cp->head[class]) != 0) {
+		cp->head[class] = *(void **)p;
+		slab_putblock(p);
+	    }
+	    cp->count[class] = 0;
+	}
+	mutex_unlock(&slab_lock);
+	mutex_unlock(&cp->lock);
+    }
+}
+
+/*
+ * The default zone's malloc: small blocks come from the slabs.
+ */
+static void *defaultzonemalloc(NXZone *z, size_t size)
+{
+void	*new;
+
+    if(size <= SLAB_MAXSIZE && slab_enabled && (new = slab_alloc(size)))
+	return(new);
+    if(malloc_static.safesingle)
+	return(nxzonemallocnolock(z, size));
+    return(nxzonemalloc(z, size));
+}
+
 static void malloc_check(char *str)
 {
     if(NXMallocCheck()) {
@@ -652,6 +1022,7 @@ struct mutex  stacklock;
     bzero(malloc_static.lock,sizeof(struct mutex)); 
     mutex_init(malloc_static.lock);
     ((zone_t *)malloc_static.defaultzone)->debug = MALLOC_DEBUG_1DEEPFREE;
+    slab_enabled = 1;
 #if !defined(SHLIB)
     /*
     ** For backwards compatibility, we leave the malloc data structures thread safe
@@ -1079,6 +1450,8 @@ int   i;
 	malloc_static.zones[i]->z.free = 
 			(fast ? nxzonefreenolock : nxzonefree);
     }
+    if(malloc_static.max_zone > 0)
+	malloc_static.defaultzone->malloc = defaultzonemalloc;
 }
 
 /*
@@ -1572,6 +1945,8 @@ NXZone *NXZoneFromPtr(void *ptr)
 region_t *regionp;
 NXZone *zonep;
 
+    if(SLAB_ISSLAB(ptr))
+	return(malloc_static.defaultzone);
     LOCK {
 	regionp = findregionnolock(ptr);
 	if(regionp)
@@ -1590,7 +1965,18 @@ void NXZonePtrInfo(void *ptr)
 {
 region_t *regionp;
 header_t *headerp;
-
+slab_t	 *sp;
+
+    if(SLAB_ISSLAB(ptr)) {
+	sp = SLAB_PAGE(ptr);
+	if(sp->size) {
+	    headerp = (header_t *)((char *)sp + SLAB_HDRSIZE +
+		((char *)ptr - (char *)sp - SLAB_HDRSIZE) / sp->size * sp->size);
+	    printf("slab -- start add %p size %d\n", headerp, sp->size);
+	    printf("zone %p\n", malloc_static.defaultzone);
+	    return;
+	}
+    }
     regionp = findregionnolock(ptr);
     if(regionp) {
 	if(regionp->zonep) {
@@ -1658,7 +2044,8 @@ int	oldsize;
     if(!ptr)
 	return(nxzonemallocnolock(zonep, size));
 	
-    if(NOTPAGEALIGNED(ptr) && (new = NXZoneRealloc_canyou((zone_t *)zonep, ptr, size)))
+    if(NOTPAGEALIGNED(ptr) && !SLAB_ISSLAB(ptr) &&
+	    (new = NXZoneRealloc_canyou((zone_t *)zonep, ptr, size)))
     ;
     else { 
 	oldsize = malloc_size(ptr);
@@ -1772,6 +2159,10 @@ felem_t *lastfreearray,*nextfreearray,myfree;
 header_t	*headerp,*next;
 
 
+    if(ptr && SLAB_ISSLAB(ptr)) {
+	slab_free(ptr, 0);
+	return;
+    }
     if(!zonep->canfree)
 	return;
 
@@ -2300,6 +2691,11 @@ int   i;
     for(i = 0;i < malloc_static.max_zone; i++) {
 	malloc_static.zones[i]->debug = level;
     }
+    /*
+     * The debugging checks only know the free heap, so new small
+     * blocks come from there while they are on.
+     */
+    slab_enabled = (level & ~MALLOC_DEBUG_1DEEPFREE) == 0;
     if(level && level != MALLOC_DEBUG_1DEEPFREE)
 	dolockordebug(0);
     return old;
@@ -2353,6 +2749,8 @@ realloc(void *oldptr, size_t newsize)
 {
     region_t	*regionp;
 
+    if (oldptr && SLAB_ISSLAB(oldptr))
+	return slab_realloc(oldptr, newsize);
     regionp = findregionnolock(oldptr);
     if (!regionp || !regionp->zonep)
 	return NXZoneRealloc(malloc_static.defaultzone, oldptr, newsize);
@@ -2380,6 +2778,11 @@ extern void free(void *ptr)
  void	*oldfree;
  int	debug;
  
+   if(ptr && SLAB_ISSLAB(ptr)) {
+	slab_free(ptr,
+	    Z(malloc_static.defaultzone)->debug & MALLOC_DEBUG_1DEEPFREE);
+	return;
+   }
    if(malloc_static.safesingle) {
 	if(Z(malloc_static.defaultzone)->debug & MALLOC_DEBUG_1DEEPFREE) {
 		oldfree = malloc_static.freeme;
@@ -2645,13 +3048,23 @@ void _malloc_fork_prepare()
  * malloc critical section.
  */
 {
+int	i;
+
     	LOCK
+	for(i = 0; i < SLAB_NCACHES; i++)
+	    mutex_lock(&slab_caches[i].lock);
+	mutex_lock(&slab_lock);
 }
 void _malloc_fork_parent()
 /*
  * Called in the parent process after a fork() to resume normal operation.
  */
 {
+int	i;
+
+	mutex_unlock(&slab_lock);
+	for(i = 0; i < SLAB_NCACHES; i++)
+	    mutex_unlock(&slab_caches[i].lock);
 	UNLOCK
 }
 void _malloc_fork_child()
@@ -2661,6 +3074,11 @@ void _malloc_fork_child()
  * child does not share memory with the parent.
  */
 {
+int	i;
+
+	mutex_unlock(&slab_lock);
+	for(i = 0; i < SLAB_NCACHES; i++)
+	    mutex_unlock(&slab_caches[i].lock);
 	UNLOCK
 }
 
@@ -2687,7 +3105,7 @@ region_t   *regionp;
     UNLOCK
 }
 
-#define MALLOCVERSION  1
+#define MALLOCVERSION  2	/* 2 adds the slab segments */
 /*
  * The next 2 functions exist for application which want to dump the heap
  * of an application to disk and restart the application later and have
@@ -2706,10 +3124,22 @@ int	malloc_freezedry()
 {
 char	*cp,*startcp;
 int	size,regionsize,zonesize;
+int	i,nsegs;
+
+	/*
+	 * Cached slab blocks are not recorded anywhere in the heap,
+	 * so put them back in their slabs first.
+	 */
+	slab_drain();
+	nsegs = 0;
+	for(i = 0; i < SLAB_NSEGS; i++)
+	    if(SLAB_ISSLAB(i << SLAB_SEGSHIFT))
+		nsegs++;
 
 	regionsize = malloc_static.max_region * sizeof(region_t);
 	zonesize = malloc_static.max_zone   * sizeof(zone_t *);
-	size = sizeof(int) + sizeof(int) + regionsize + sizeof(int) + zonesize;
+	size = sizeof(int) + sizeof(int) + regionsize + sizeof(int) + zonesize
+	    + sizeof(int) + nsegs * sizeof(int);
         startcp = cp = (char *)_valloczonenolock((size_t *)&size);
 	if(!cp)
             return(0);
@@ -2718,6 +3148,10 @@ int	size,regionsize,zonesize;
 	ADDDATA(malloc_static.regions, regionsize);
 	ADDINT(malloc_static.max_zone);
 	ADDDATA(malloc_static.zones, zonesize);
+	ADDINT(nsegs);
+	for(i = 0; i < SLAB_NSEGS; i++)
+	    if(SLAB_ISSLAB(i << SLAB_SEGSHIFT))
+		ADDINT(i << SLAB_SEGSHIFT);
 	return((int)startcp);
 }
 
@@ -2734,13 +3168,13 @@ int malloc_jumpstart(int cookie)
 {
 char *cp = (char *)cookie;
 char *startcp;
-int	 version,regions,zones;
+int	 version,regions,zones,segs,seg;
 region_t	region;
 zone_t		*zonep;
 
     startcp = cp;
     FETCHINT(version); 
-    if(version != MALLOCVERSION) 
+    if(version != MALLOCVERSION && version != 1) 
 	return(1);
     FETCHINT(regions);
     while(--regions >= 0) {
@@ -2755,6 +3189,15 @@ zone_t		*zonep;
 	cp += sizeof(zone_t *);
 	keepzonenolock(zonep);
     }
+    if(version >= 2) {
+	FETCHINT(segs);
+	mutex_lock(&slab_lock);
+	while(--segs >= 0) {
+	    FETCHINT(seg);
+	    slab_adopt((char *)seg);
+	}
+	mutex_unlock(&slab_lock);
+    }
     vm_deallocate(task_self(), (vm_address_t) startcp, (int)(cp - startcp));
     return 0;
 }
@@ -2766,7 +3209,151 @@ zone_t		*zonep;
     * Do
     * cc -DMAIN -DTESTING  -g malloc.c
     * a.out bignumber
+    *
+    * It can also replay an allocation trace, once with the slab
+    * front end and once without, and report the time of each:
+    *
+    * a.out -g count [seed] > trace	make a synthetic trace
+    * a.out -r trace		replay it
+    *
+    * A trace is one operation per line: "m slot size", "r slot size"
+    * or "f slot".  The generator uses its own random number sequence
+    * so the same count and seed give the same trace everywhere.
     */
+#import <sys/time.h>
+
+#define TRACESLOTS	4096
+
+struct traceop {
+  char op;
+  int  slot;
+  int  size;
+  };
+
+static unsigned int traceseed;
+
+static int tracerandom()
+{
+    traceseed = traceseed * 1103515245 + 12345;
+    return((traceseed >> 16) & 0x7fff);
+}
+
+/*
+ * Mostly small objects, like a daemon building and throwing away
+ * strings and dictionaries, with an occasional large block.
+ */
+static void tracegen(int n, int seed)
+{
+int i,slot,size,r;
+char live[TRACESLOTS];
+
+    traceseed = seed;
+    bzero(live, sizeof(live));
+    for(i = 0; i < n; i++) {
+	r = tracerandom();
+	slot = tracerandom() % TRACESLOTS;
+	if((r % 50) == 0)
+	    size = 600 + tracerandom() % 8000;
+	else if((r % 5) == 0)
+	    size = 16 + tracerandom() % 500;
+	else
+	    size = 1 + tracerandom() % 64;
+	if(!live[slot]) {
+	    printf("m %d %d\n", slot, size);
+	    live[slot] = 1;
+	}
+	else if((r % 4) == 0)
+	    printf("r %d %d\n", slot, size);
+	else {
+	    printf("f %d\n", slot);
+	    live[slot] = 0;
+	}
+    }
+    for(slot = 0; slot < TRACESLOTS; slot++)
+	if(live[slot])
+	    printf("f %d\n", slot);
+}
+
+static double tracerun(struct traceop *ops, int n)
+{
+struct timeval start, end;
+char *slots[TRACESLOTS];
+int sizes[TRACESLOTS];
+struct traceop *op;
+
+    bzero(slots, sizeof(slots));
+    gettimeofday(&start, 0);
+    for(op = ops; op < ops + n; op++) {
+	switch(op->op) {
+	    case 'm':
+		slots[op->slot] = malloc(op->size);
+		sizes[op->slot] = op->size;
+		*slots[op->slot] = 1;
+		break;
+	    case 'r':
+		if(*slots[op->slot] != 1) {
+		    printf("trace: slot %d clobbered\n", op->slot);
+		    abort();
+		}
+		slots[op->slot] = realloc(slots[op->slot], op->size);
+		sizes[op->slot] = op->size;
+		break;
+	    case 'f':
+		if(malloc_size(slots[op->slot]) < sizes[op->slot]) {
+		    printf("trace: slot %d too small\n", op->slot);
+		    abort();
+		}
+		free(slots[op->slot]);
+		slots[op->slot] = 0;
+		break;
+	}
+    }
+    gettimeofday(&end, 0);
+    return((end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6);
+}
+
+static void tracereplay(char *file)
+{
+FILE *fp;
+struct traceop *ops;
+int n,max;
+char op;
+double withslab, without;
+
+    if((fp = fopen(file, "r")) == NULL) {
+	perror(file);
+	exit(1);
+    }
+    max = 1024;
+    ops = (struct traceop *) malloc(max * sizeof(*ops));
+    n = 0;
+    while(fscanf(fp, " %c %d", &op, &ops[n].slot) == 2) {
+	ops[n].op = op;
+	ops[n].size = 0;
+	if(op != 'f' && fscanf(fp, "%d", &ops[n].size) != 1)
+	    break;
+	if(ops[n].slot < 0 || ops[n].slot >= TRACESLOTS) {
+	    printf("trace: bad slot %d\n", ops[n].slot);
+	    exit(1);
+	}
+	if(++n == max) {
+	    max *= 2;
+	    ops = (struct traceop *) realloc(ops, max * sizeof(*ops));
+	}
+    }
+    fclose(fp);
+
+    malloc_debug(MALLOC_DEBUG_1DEEPFREE);	/* the default */
+    slab_enabled = 0;
+    without = tracerun(ops, n);
+    slab_enabled = 1;
+    withslab = tracerun(ops, n);
+    printf("%d operations\n", n);
+    printf("heap only  %8.3f sec\n", without);
+    printf("with slabs %8.3f sec\n", withslab);
+    free(ops);
+}
+
 struct uf  {
   char *a;
   NXZone   *z;
@@ -2790,6 +3377,14 @@ char	*argv[];
     NXNameZone(z2,"The second zone");
     NXNameZone(z2,"The second zone");
    NXNameZone(NXDefaultMallocZone(),"The default zone");
+    if(argc > 2 && strcmp(argv[1], "-g") == 0) {
+	tracegen(atoi(argv[2]), argc > 3 ? atoi(argv[3]) : 1);
+	exit(0);
+    }
+    if(argc > 2 && strcmp(argv[1], "-r") == 0) {
+	tracereplay(argv[2]);
+	exit(0);
+    }
     if(argc < 2) {
 	printf("give count\n");
 	exit(1);
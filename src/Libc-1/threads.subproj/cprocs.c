@@ -163,6 +163,11 @@ cproc_alloc()
 	MACH_CALL(port_allocate(task_self(), &p->wait_port), r);
 	MACH_CALL(port_set_backlog(task_self(), p->wait_port, 1), r);
 
+	p->park_port = PORT_NULL;	/* allocated on first park */
+	p->park_next = NO_CPROC;
+	p->park_mutex = 0;
+	p->park_handoff = FALSE;
+
 	p->flags = 0;
 
 	spin_lock(&cproc_lock);
@@ -262,7 +267,7 @@ extern int condition_spin_limit;
 extern int condition_yield_limit;
 #else	NeXT
 int condition_spin_limit = 0;
-int condition_yield_limit = 7;
+int condition_yield_limit = 0;	/* as in threads_data.c */
 #endif	NeXT
 
 void
@@ -271,7 +276,7 @@ condition_wait(c, m)
 	mutex_t m;
 {
 	register cproc_t p;
-	register int i;
+	register int i, limit;
 	register kern_return_t r;
 	msg_header_t msg;
 
@@ -306,18 +311,27 @@ condition_wait(c, m)
 	} while (! swtch_pri(0));
 #else
 	/*
-	 * First, try busy-waiting.
+	 * First, try busy-waiting, for as long as it has recently
+	 * taken to be signalled (multiprocessors only), unless
+	 * condition_spin_limit says otherwise.
 	 */
-	for (i = 0; i < condition_spin_limit; i += 1) {
+	limit = condition_spin_limit ? condition_spin_limit
+				     : cthread_spin_limit(c);
+	for (i = 0; i < limit; i += 1) {
 		if (p->state == CPROC_RUNNING) {
 			/*
 			 * We've been woken up.
 			 */
+			if (! condition_spin_limit)
+				cthread_spin_update(c, i, TRUE);
 			goto done;
 		}
 	}
+	if (limit > 0 && ! condition_spin_limit)
+		cthread_spin_update(c, limit, FALSE);
 	/*
-	 * Next, try yielding the processor.
+	 * Next, try yielding the processor.  Off by default: the
+	 * yields go to unrelated threads.
 	 */
 	for (i = 0; i < condition_yield_limit; i += 1) {
 		if (p->state == CPROC_RUNNING) {
@@ -598,6 +612,7 @@ void cproc_fork_child()
 	 */
 
 	cproc_lock = 0;		/* unlocked */
+	mutex_fork_child();
 
 #if	NeXT
 	/*
@@ -623,6 +638,9 @@ void cproc_fork_child()
 			 */
 			p->state = CPROC_RUNNING;
 			p->reply_port = PORT_NULL;
+			p->park_port = PORT_NULL;
+			p->park_next = NO_CPROC;
+			p->park_handoff = FALSE;
 
 
 			MACH_CALL(port_allocate(task_self(), &p->wait_port), r);
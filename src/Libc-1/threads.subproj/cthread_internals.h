@@ -81,12 +81,25 @@ typedef struct cproc {
 	int	error;
 #endif	/* NeXT */
 
+	port_t park_port;		/* for parking on a mutex */
+	struct cproc *park_next;	/* mutex park queue */
+	struct mutex *park_mutex;	/* mutex parked on */
+	int park_handoff;		/* mutex handed to us */
+
 } *cproc_t;
 
 #define	NO_CPROC		((cproc_t) 0)
 #define	cproc_self()		((cproc_t) ur_cthread_self())
 extern void cthread_set_self(cproc_t p);
 
+/*
+ * Mutex support, in cthreads_sync.c.
+ */
+extern void mutex_sync_init(void);
+extern void mutex_fork_child(void);
+extern int cthread_spin_limit(void *addr);
+extern void cthread_spin_update(void *addr, int spins, boolean_t success);
+
 /*
  * Possible cproc states.
  */
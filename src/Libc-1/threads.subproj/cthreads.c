@@ -148,6 +148,7 @@ cthread_init()
 	t->real_thread = thread_self();
 	cthreads_started = TRUE;
 	mig_init(1);		/* enable multi-threaded mig interfaces */
+	mutex_sync_init();
 }
 
 /*
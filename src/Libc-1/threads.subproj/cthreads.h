@@ -145,15 +145,26 @@ typedef struct mutex {
 #define	mutex_clear(m)		/* nop */
 #define	mutex_free(m)		free((any_t) (m))
 
+/*
+ * Nonzero while threads are parked on mutexes or mutex statistics
+ * are being kept; the lock and unlock macros then go the long way.
+ */
+#define	MUTEX_SLOW_STATS	0x10000
+
 #define	mutex_lock(m) \
 	MACRO_BEGIN \
-		if (! mutex_try_lock(m)) mutex_wait_lock(m); \
+		if (mutex_slow || ! mutex_try_lock(m)) mutex_wait_lock(m); \
 	MACRO_END
 
 __DECLBEGIN
+extern int mutex_slow;
 extern int mutex_try_lock(mutex_t m);	/* nonblocking */
 extern void mutex_wait_lock(mutex_t m);	/* blocking */
 extern void mutex_unlock(mutex_t m);
+extern void mutex_unlock_slow(mutex_t m);	/* wakes a parked thread */
+
+extern void mutex_stats_enable(boolean_t on);
+extern void mutex_stats_print(void);	/* to stderr */
 __DECLEND
 
 /*
@@ -277,7 +288,10 @@ __DECLEND
 /*
  * Mutex locks.
  */
-#define	mutex_unlock(m)		((m)->lock = 0)
+#define	mutex_unlock(m) \
+	MACRO_BEGIN \
+		if (mutex_slow) mutex_unlock_slow(m); else (m)->lock = 0; \
+	MACRO_END
 
 
 /*
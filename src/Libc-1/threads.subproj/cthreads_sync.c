@@ -21,34 +21,443 @@
  * 
  * @APPLE_LICENSE_HEADER_END@
  */
+#include <stdio.h>
 #include "cthreads.h"
 #include "cthread_internals.h"
+#include <mach/message.h>
 
 /*
  * Mutex objects.
  *
- * Mutex_wait_lock is implemented in terms of mutex_try_lock().
- * Mutex_try_lock() and mutex_unlock() are machine-dependent.
+ * Mutex_try_lock() is machine-dependent.  The mutex_lock() and
+ * mutex_unlock() macros only come here when the lock is busy, or
+ * when mutex_slow says that some thread is parked or that statistics
+ * are being kept.
+ *
+ * A contended mutex_wait_lock() first spins, on a multiprocessor
+ * only.  How long is learned per mutex (hashed by address): a spin
+ * that gets the lock pulls the estimate toward the number of
+ * iterations it took, one that fails shrinks it, and the limit is
+ * twice the estimate.  So the spin follows the lock's hold time and
+ * stops being paid for locks that are held long.  mutex_spin_limit
+ * caps it.
+ *
+ * After spinning the thread parks: it is queued on the mutex and
+ * blocks in msg_receive() on its own park port.  mutex_unlock() of a
+ * mutex with parked threads hands the lock, still locked, directly
+ * to the first of them and sends it a message, so the thread that
+ * waited longest gets the lock and no other thread is disturbed.
+ * The queues are hashed by mutex address and kept here, since
+ * struct mutex cannot grow.  Code compiled with the old
+ * mutex_unlock() macro just clears the lock, so parks are timed and
+ * a parked thread looks at the lock again every MUTEX_PARK_TIMEOUT
+ * milliseconds.
  */
 
 extern int mutex_spin_limit;
 
+#define	MUTEX_SPIN_MAX		1000	/* default cap on multiprocessors */
+#define	MUTEX_SPIN_MIN		16	/* always try at least this long */
+#define	MUTEX_SPIN_HASH		256	/* spin estimates */
+#define	MUTEX_PARK_HASH		64	/* park queues */
+#define	MUTEX_PARK_TIMEOUT	10	/* milliseconds */
+
+#define	MUTEX_HASH(m, n)	((((unsigned int) (m)) >> 3) & ((n) - 1))
+
+/*
+ * Results of mutex_park().
+ */
+#define	PARK_TIMEDOUT		0	/* still not ours */
+#define	PARK_LOCKED		1	/* took it ourselves */
+#define	PARK_HANDOFF		2	/* given to us by mutex_unlock() */
+
+private unsigned short spin_estimate[MUTEX_SPIN_HASH];
+
+private int park_lock = 0;		/* protects the queues and mutex_slow */
+private cproc_t park_queue[MUTEX_PARK_HASH];
+
+/*
+ * Contention statistics, kept per mutex in an open hash table while
+ * enabled.  The counters of a mutex are only updated by the thread
+ * holding it.
+ */
+#define	MUTEX_STATS_SIZE	1024
+
+struct mutex_stats {
+	mutex_t		mutex;
+	char		*name;
+	unsigned int	acquisitions;	/* through mutex_lock() */
+	unsigned int	contended;	/* lock was busy */
+	unsigned int	spins;		/* spin iterations */
+	unsigned int	parks;		/* times blocked */
+	unsigned int	handoffs;	/* handed over by mutex_unlock() */
+	unsigned int	locked_at;
+	unsigned int	hold_max;
+	unsigned long long hold_total;
+};
+
+private struct mutex_stats *mutex_stats_table = 0;
+private int mutex_stats_lock = 0;
+private unsigned int mutex_stats_dropped = 0;
+
+/*
+ * A cheap timestamp for hold times, in machine ticks.
+ */
+private unsigned int
+mutex_clock()
+{
+	unsigned int t;
+
+#if	defined(__i386__)
+	asm volatile("rdtsc" : "=a" (t) : : "edx");
+#elif	defined(__ppc__)
+	asm volatile("mftb %0" : "=r" (t));
+#else
+	t = 0;
+#endif
+	return t;
+}
+
+private struct mutex_stats *
+mutex_stats_lookup(m)
+	register mutex_t m;
+{
+	register struct mutex_stats *ms, *table = mutex_stats_table;
+	register int i, h;
+
+	h = MUTEX_HASH(m, MUTEX_STATS_SIZE);
+	for (i = 0; i < MUTEX_STATS_SIZE; i += 1) {
+		ms = &table[(h + i) & (MUTEX_STATS_SIZE - 1)];
+		if (ms->mutex == m)
+			return ms;
+		if (ms->mutex == 0) {
+			spin_lock(&mutex_stats_lock);
+			if (ms->mutex == 0) {
+				ms->name = m->name;
+				ms->mutex = m;
+			}
+			spin_unlock(&mutex_stats_lock);
+			if (ms->mutex == m)
+				return ms;
+		}
+	}
+	mutex_stats_dropped += 1;
+	return 0;
+}
+
+/*
+ * Turn statistics on or off.  Turning them on starts from zero.
+ */
+void
+mutex_stats_enable(on)
+	boolean_t on;
+{
+	if (on) {
+		if (mutex_stats_table == 0)
+			mutex_stats_table = (struct mutex_stats *)
+			    calloc(MUTEX_STATS_SIZE, sizeof(struct mutex_stats));
+		else
+			bzero(mutex_stats_table,
+			      MUTEX_STATS_SIZE * sizeof(struct mutex_stats));
+		mutex_stats_dropped = 0;
+		if (mutex_stats_table == 0)
+			return;
+	}
+	spin_lock(&park_lock);
+	if (on)
+		mutex_slow |= MUTEX_SLOW_STATS;
+	else
+		mutex_slow &= ~MUTEX_SLOW_STATS;
+	spin_unlock(&park_lock);
+}
+
+/*
+ * Print the statistics of every mutex that has been locked since
+ * they were enabled.  Hold times are in machine ticks.
+ */
+void
+mutex_stats_print()
+{
+	register struct mutex_stats *ms;
+	register int i;
+
+	if (mutex_stats_table == 0)
+		return;
+	fprintf(stderr, "%-10s %-20s %10s %10s %10s %8s %8s %10s %10s\n",
+		"mutex", "name", "acquired", "contended", "spins",
+		"parks", "handoffs", "avg hold", "max hold");
+	for (i = 0; i < MUTEX_STATS_SIZE; i += 1) {
+		ms = &mutex_stats_table[i];
+		if (ms->acquisitions == 0)
+			continue;
+		fprintf(stderr, "0x%08x %-20.20s %10u %10u %10u %8u %8u %10u %10u\n",
+			(unsigned int) ms->mutex,
+			ms->name != 0 ? ms->name : "?",
+			ms->acquisitions, ms->contended, ms->spins,
+			ms->parks, ms->handoffs,
+			(unsigned int) (ms->hold_total / ms->acquisitions),
+			ms->hold_max);
+	}
+	if (mutex_stats_dropped)
+		fprintf(stderr, "(%u lockings of mutexes not in the table)\n",
+			mutex_stats_dropped);
+}
+
+/*
+ * Called from cthread_init().
+ */
+void
+mutex_sync_init()
+{
+	struct host_basic_info hbi;
+	unsigned int count = HOST_BASIC_INFO_COUNT;
+
+	if (mutex_spin_limit == 0 &&
+	    host_info(host_self(), HOST_BASIC_INFO,
+		      (host_info_t) &hbi, &count) == KERN_SUCCESS &&
+	    hbi.avail_cpus > 1)
+		mutex_spin_limit = MUTEX_SPIN_MAX;
+
+	if (getenv("CTHREAD_MUTEX_STATS") != 0) {
+		mutex_stats_enable(TRUE);
+		atexit(mutex_stats_print);
+	}
+}
+
+/*
+ * Called in the child after a fork(), when only this thread is left.
+ */
+void
+mutex_fork_child()
+{
+	park_lock = 0;
+	mutex_stats_lock = 0;
+	bzero(park_queue, sizeof(park_queue));
+	mutex_slow &= MUTEX_SLOW_STATS;
+}
+
+/*
+ * The learned spin limit for a lock or condition at addr, and the
+ * feedback after spinning on it.
+ */
+int
+cthread_spin_limit(addr)
+	void *addr;
+{
+	register int limit;
+
+	limit = 2 * spin_estimate[MUTEX_HASH(addr, MUTEX_SPIN_HASH)] +
+		MUTEX_SPIN_MIN;
+	return (limit < mutex_spin_limit ? limit : mutex_spin_limit);
+}
+
+void
+cthread_spin_update(addr, spins, success)
+	void *addr;
+	int spins;
+	boolean_t success;
+{
+	register unsigned short *e;
+
+	e = &spin_estimate[MUTEX_HASH(addr, MUTEX_SPIN_HASH)];
+	if (success)
+		*e += (spins - (int) *e) / 8;
+	else
+		*e -= *e / 8;
+}
+
+/*
+ * Spin for the lock.  Returns the number of iterations if the
+ * lock was taken, else -1 - iterations (so a limit of 0 is a
+ * failure too).
+ */
+private int
+mutex_spin(m)
+	register mutex_t m;
+{
+	register int i, limit;
+
+	limit = cthread_spin_limit(m);
+	for (i = 0; i < limit; i += 1)
+		if (m->lock == 0 && mutex_try_lock(m)) {
+			cthread_spin_update(m, i, TRUE);
+			return i;
+		}
+	if (limit > 0)
+		cthread_spin_update(m, limit, FALSE);
+	return -1 - limit;
+}
+
+/*
+ * Park the calling thread on m until it is handed the lock or
+ * its park times out.
+ */
+private int
+mutex_park(m, p)
+	register mutex_t m;
+	register cproc_t p;
+{
+	register cproc_t *q;
+	register kern_return_t r;
+	msg_header_t msg;
+
+	if (p->park_port == PORT_NULL) {
+		MACH_CALL(port_allocate(task_self(), &p->park_port), r);
+		MACH_CALL(port_set_backlog(task_self(), p->park_port, 1), r);
+	}
+
+	spin_lock(&park_lock);
+	p->park_mutex = m;
+	p->park_handoff = FALSE;
+	p->park_next = NO_CPROC;
+	for (q = &park_queue[MUTEX_HASH(m, MUTEX_PARK_HASH)]; *q != NO_CPROC;
+	     q = &(*q)->park_next)
+		continue;
+	*q = p;
+	mutex_slow += 1;
+	/*
+	 * The holder may have let go before we were queued.
+	 */
+	if (mutex_try_lock(m)) {
+		*q = NO_CPROC;
+		mutex_slow -= 1;
+		spin_unlock(&park_lock);
+		return PARK_LOCKED;
+	}
+	spin_unlock(&park_lock);
+
+	TRACE(printf("[%s] park(%s)\n",
+		     cthread_name(cthread_self()), mutex_name(m)));
+	msg.msg_size = sizeof(msg);
+	msg.msg_local_port = p->park_port;
+	r = msg_receive(&msg, RCV_TIMEOUT, MUTEX_PARK_TIMEOUT);
+	if (r != RCV_SUCCESS && r != RCV_TIMED_OUT) {
+		mach_error("msg_receive", r);
+		ASSERT(SHOULDNT_HAPPEN);
+		exit(1);
+	}
+
+	spin_lock(&park_lock);
+	if (p->park_handoff) {
+		/*
+		 * mutex_unlock() dequeued us and left the lock held.
+		 * If we had already timed out its message stays in the
+		 * port and only cuts a later park short.
+		 */
+		spin_unlock(&park_lock);
+		return PARK_HANDOFF;
+	}
+	for (q = &park_queue[MUTEX_HASH(m, MUTEX_PARK_HASH)]; *q != p;
+	     q = &(*q)->park_next)
+		continue;
+	*q = p->park_next;
+	mutex_slow -= 1;
+	spin_unlock(&park_lock);
+	return PARK_TIMEDOUT;
+}
 
 void
 mutex_wait_lock(m)
 	register mutex_t m;
 {
-	register int i;
+	register struct mutex_stats *ms = 0;
+	register cproc_t p;
+	int i, spins = 0, parks = 0, how = PARK_TIMEDOUT;
+	boolean_t contended = FALSE;
 
 	TRACE(printf("[%s] lock(%s)\n", cthread_name(cthread_self()), mutex_name(m)));
-	for (i = 0; i < mutex_spin_limit; i += 1)
-		if (m->lock == 0 && mutex_try_lock(m))
-			return;
-		else
-			/* spin */;
-	for (;;)
-		if (m->lock == 0 && mutex_try_lock(m))
-			return;
-		else
-			cthread_yield();
+	if (mutex_slow & MUTEX_SLOW_STATS)
+		ms = mutex_stats_lookup(m);
+
+	/*
+	 * mutex_lock() skips its own try while mutex_slow is set.
+	 */
+	if (! mutex_try_lock(m)) {
+		contended = TRUE;
+		for (;;) {
+			if ((i = mutex_spin(m)) >= 0) {
+				spins += i;
+				break;
+			}
+			spins += -1 - i;
+			if ((p = cproc_self()) == NO_CPROC) {
+				/*
+				 * Too early to park.
+				 */
+				cthread_yield();
+				if (m->lock == 0 && mutex_try_lock(m))
+					break;
+				continue;
+			}
+			parks += 1;
+			if ((how = mutex_park(m, p)) != PARK_TIMEDOUT)
+				break;
+		}
+	}
+
+	if (ms != 0) {
+		ms->acquisitions += 1;
+		if (contended)
+			ms->contended += 1;
+		ms->spins += spins;
+		ms->parks += parks;
+		if (how == PARK_HANDOFF)
+			ms->handoffs += 1;
+		ms->locked_at = mutex_clock();
+	}
+}
+
+void
+mutex_unlock_slow(m)
+	register mutex_t m;
+{
+	register struct mutex_stats *ms;
+	register cproc_t p, *q;
+	register kern_return_t r;
+	unsigned int held;
+	msg_header_t msg;
+
+	if ((mutex_slow & MUTEX_SLOW_STATS) &&
+	    (ms = mutex_stats_lookup(m)) != 0 && ms->locked_at != 0) {
+		held = mutex_clock() - ms->locked_at;
+		ms->locked_at = 0;
+		ms->hold_total += held;
+		if (held > ms->hold_max)
+			ms->hold_max = held;
+	}
+
+	if ((mutex_slow & ~MUTEX_SLOW_STATS) == 0) {
+		m->lock = 0;
+		return;
+	}
+
+	spin_lock(&park_lock);
+	for (q = &park_queue[MUTEX_HASH(m, MUTEX_PARK_HASH)];
+	     (p = *q) != NO_CPROC; q = &p->park_next)
+		if (p->park_mutex == m)
+			break;
+	if (p == NO_CPROC) {
+		m->lock = 0;
+		spin_unlock(&park_lock);
+		return;
+	}
+	*q = p->park_next;
+	mutex_slow -= 1;
+	p->park_handoff = TRUE;
+	spin_unlock(&park_lock);
+
+	msg.msg_simple = TRUE;
+	msg.msg_size = sizeof(msg);
+	msg.msg_type = MSG_TYPE_NORMAL;
+	msg.msg_local_port = PORT_NULL;
+	msg.msg_remote_port = p->park_port;
+	msg.msg_id = 0;
+	TRACE(printf("[%s] handoff(%s)\n",
+		     cthread_name(cthread_self()), mutex_name(m)));
+	r = msg_send(&msg, SEND_TIMEOUT, 0);
+	if (r != SEND_SUCCESS && r != SEND_TIMED_OUT) {
+		mach_error("msg_send", r);
+		ASSERT(SHOULDNT_HAPPEN);
+		exit(1);
+	}
 }
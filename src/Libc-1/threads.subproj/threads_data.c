@@ -37,13 +37,14 @@ extern void cthread_init();
 int (*_cthread_init_routine)() = (int (*)()) cthread_init;
 unsigned int cproc_default_stack_size = 1000000;
 int condition_spin_limit = 0;
-int condition_yield_limit = 7;
+int condition_yield_limit = 0;
 unsigned int initial_stack_boundary = 0;
 unsigned int cthread_stack_base = 0;	/* Base for stack allocation */
 int	malloc_lock = 0;			/* 
 					 * Needs to be shared between malloc.o
 					 * and malloc_utils.o
 					 */
+int	mutex_slow = 0;			/* see cthreads_sync.c */
 
 /* global data padding, must NOT be static */
-char _threads_data_padding[208] = { 0 };
+char _threads_data_padding[204] = { 0 };
@@ -392,6 +392,7 @@ typedef int pid_t;
 #define HAVE_GMTOFF
 #define HAVE_MMAP
 #define USE_MMAP_FILES
+#define USE_SENDFILE
 #define USE_MMAP_SCOREBOARD
 #define MAP_TMPFILE
 #define HAVE_RESOURCE
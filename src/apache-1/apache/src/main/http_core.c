@@ -3026,6 +3026,10 @@ static int default_handler(request_rec *r)
 #ifdef USE_MMAP_FILES
     ap_block_alarms();
     if ((r->finfo.st_size >= MMAP_THRESHOLD)
+#ifdef USE_SENDFILE
+	/* ap_send_fd() uses sendfile(); only map if we need the data */
+	&& (d->content_md5 & 1)
+#endif
 	&& (!r->header_only || (d->content_md5 & 1))) {
 	/* we need to protect ourselves in case we die while we've got the
  	 * file mmapped */
@@ -3372,6 +3372,9 @@ static void show_compile_settings(void)
 	printf(" -D MMAP_SEGMENT_SIZE=%ld\n",(long)MMAP_SEGMENT_SIZE);
 #endif
 #endif /*USE_MMAP_FILES*/
+#ifdef USE_SENDFILE
+    printf(" -D USE_SENDFILE\n");
+#endif
 #ifdef NO_WRITEV
     printf(" -D NO_WRITEV\n");
 #endif
@@ -1880,6 +1880,99 @@ API_EXPORT(int) ap_discard_request_body(request_rec *r)
     return OK;
 }
 
+#ifdef USE_SENDFILE
+/*
+ * 1 once sendfile() has been seen to exist, -1 if the kernel turned
+ * out not to have it.
+ */
+static int sendfile_state = 0;
+
+/*
+ * The first call is made with SIGSYS ignored, so that a kernel without
+ * the system call fails it with ENOSYS instead of killing the child.
+ */
+static int first_sendfile(int fd, int s, off_t offset, size_t nbytes,
+                          off_t *sbytes)
+{
+    void (*osigsys) (int);
+    int rv, err;
+
+    osigsys = signal(SIGSYS, SIG_IGN);
+    rv = sendfile(fd, s, offset, nbytes, NULL, sbytes, 0);
+    err = errno;
+    signal(SIGSYS, osigsys);
+    if (rv < 0 && err == ENOSYS)
+        sendfile_state = -1;
+    else
+        sendfile_state = 1;
+    errno = err;
+    return rv;
+}
+
+/*
+ * Send length bytes of f (to EOF if length is negative) from its
+ * current position with sendfile(), so the file goes from the kernel's
+ * buffer cache to the socket without passing through the server.
+ * Returns the number of bytes sent, or -1 if sendfile() can't be used
+ * for this connection and nothing was sent.
+ */
+static long send_fd_sendfile(FILE *f, request_rec *r, long length)
+{
+    BUFF *fb = r->connection->client;
+    long total_bytes_sent = 0;
+    long offset, bytect;
+    off_t sbytes;
+    int rv;
+
+    /* a chunked body has to go through the BUFF layer */
+    if (sendfile_state < 0 || (fb->flags & B_CHUNK))
+        return -1;
+    if ((offset = ftell(f)) < 0 || ap_bflush(fb) < 0)
+        return -1;
+
+    while (!r->connection->aborted) {
+        sbytes = 0;
+        if (sendfile_state == 0) {
+            rv = first_sendfile(fileno(f), ap_bfileno(fb, B_WR),
+                                (off_t)(offset + total_bytes_sent),
+                                length < 0 ? 0 : length - total_bytes_sent,
+                                &sbytes);
+            if (sendfile_state < 0)
+                return -1;
+        }
+        else
+            rv = sendfile(fileno(f), ap_bfileno(fb, B_WR),
+                          (off_t)(offset + total_bytes_sent),
+                          length < 0 ? 0 : length - total_bytes_sent,
+                          NULL, &sbytes, 0);
+        if (sbytes > 0) {
+            ap_reset_timeout(r); /* reset timeout after successful write */
+            total_bytes_sent += sbytes;
+        }
+        if (rv == 0)
+            break;
+        if (errno == EINTR || errno == EAGAIN)
+            continue;
+        if (total_bytes_sent == 0 && (errno == EINVAL || errno == ENOTSOCK))
+            return -1;
+        if (!r->connection->aborted) {
+            ap_log_rerror(APLOG_MARK, APLOG_INFO, r,
+                "client stopped connection before send body completed");
+            ap_bsetflag(fb, B_EOUT, 1);
+            r->connection->aborted = 1;
+        }
+        break;
+    }
+
+    /* account for the bytes that bypassed the buffer */
+    ap_bgetopt(fb, BO_BYTECT, &bytect);
+    bytect += total_bytes_sent;
+    ap_bsetopt(fb, BO_BYTECT, &bytect);
+    fseek(f, offset + total_bytes_sent, SEEK_SET);
+    return total_bytes_sent;
+}
+#endif
+
 /*
  * Send the body of a response to the client.
  */
@@ -1899,6 +1992,15 @@ API_EXPORT(long) ap_send_fd_length(FILE *f, request_rec *r, long length)
 
     ap_soft_timeout("send body", r);
 
+#ifdef USE_SENDFILE
+    if ((total_bytes_sent = send_fd_sendfile(f, r, length)) >= 0) {
+        ap_kill_timeout(r);
+        SET_BYTES_SENT(r);
+        return total_bytes_sent;
+    }
+    total_bytes_sent = 0;
+#endif
+
     while (!r->connection->aborted) {
         if ((length > 0) && (total_bytes_sent + IOBUFSIZE) > length)
             len = length - total_bytes_sent;
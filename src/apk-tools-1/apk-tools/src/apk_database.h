@@ -136,4 +136,57 @@ int apk_db_install_pkg(struct apk_database *db,
 		       struct apk_package *newpkg,
 		       apk_progress_cb cb, void *cb_ctx);
 
+/* Binary, mmap()able index of the installed database (dbindex.c) */
+#define APK_DBIDX_MAGIC		0x41504b49	/* "APKI" */
+#define APK_DBIDX_VERSION	2
+
+/* Sections follow the header in this order: pkgs, names, files,
+ * buckets, deps, strings.  All strings are offsets into strings. */
+struct apk_dbidx_header {
+	unsigned int magic, version;
+	unsigned int fdb_size, fdb_mtime, fdb_ino;
+	unsigned int num_pkgs, num_files, num_buckets, num_deps;
+	unsigned int pkgs, names, files, buckets, deps, strings, size;
+};
+
+struct apk_dbidx_pkg {
+	csum_t csum;
+	unsigned int name, version, description;
+	unsigned int depends, num_depends;	/* slice of deps[] */
+	unsigned int installed_size;
+	unsigned int first_file, num_files;
+};
+
+struct apk_dbidx_file {
+	unsigned int hash, next;
+	unsigned int pkg;
+	unsigned int dir, name;
+};
+
+struct apk_db_index {
+	void *base;
+	size_t size;
+	struct apk_dbidx_header *hdr;
+	struct apk_dbidx_pkg *pkgs;
+	unsigned int *names;
+	struct apk_dbidx_file *files;
+	unsigned int *buckets;
+	unsigned int *deps;
+	const char *strings;
+};
+
+static inline const char *apk_db_index_str(struct apk_db_index *idx,
+					   unsigned int off)
+{
+	return &idx->strings[off];
+}
+
+int apk_db_write_index(struct apk_database *db);
+int apk_db_index_open(struct apk_db_index *idx, const char *root);
+void apk_db_index_close(struct apk_db_index *idx);
+struct apk_dbidx_pkg *apk_db_index_query_name(struct apk_db_index *idx,
+					      apk_blob_t name);
+struct apk_dbidx_pkg *apk_db_index_file_owner(struct apk_db_index *idx,
+					      apk_blob_t filename);
+
 #endif
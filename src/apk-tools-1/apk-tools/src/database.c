@@ -777,6 +777,7 @@ int apk_db_write_config(struct apk_database *db)
 
 	if (rename("var/lib/apk/installed.new", "var/lib/apk/installed") < 0)
 		return -errno;
+	apk_db_write_index(db);
 
 	os = apk_ostream_to_file("var/lib/apk/scripts", 0644);
 	if (os == NULL)
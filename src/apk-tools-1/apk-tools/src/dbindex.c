@@ -0,0 +1,446 @@
+/* dbindex.c - Alpine Package Keeper (APK)
+ *
+ * Copyright (C) 2005-2008 Natanael Copa <n@tanael.org>
+ * Copyright (C) 2008 Timo Teräs <timo.teras@iki.fi>
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation. See http://www.gnu.org/ for details.
+ */
+
+/*
+ * Binary index of the installed database.
+ *
+ * var/lib/apk/installed is text and has to be parsed in full, with every
+ * file hashed, before any question can be answered about it.  Whenever
+ * the text database is written, the same information is also written to
+ * var/lib/apk/installed.idx in a form that can be mmap()ed and queried
+ * in place: packages in installed order, a name-sorted table for finding
+ * them, their files grouped per package, a hash of the files for
+ * ownership lookups, and each package's dependencies.  The index records
+ * the size, mtime and inode of the text database it was built from, and
+ * is ignored unless they still match.  It is also checked throughout
+ * before use, so a damaged index cannot send a query outside the mapping.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "apk_defines.h"
+#include "apk_package.h"
+#include "apk_database.h"
+
+#define APK_DBIDX_FDB		"var/lib/apk/installed"
+#define APK_DBIDX_FILE		"var/lib/apk/installed.idx"
+#define APK_DBIDX_TMPFILE	"var/lib/apk/installed.idx.new"
+
+struct idx_strings {
+	char *buf;
+	unsigned int len, alloc;
+	int failed;
+};
+
+static unsigned int idx_str(struct idx_strings *s, const char *str)
+{
+	unsigned int off, len, alloc;
+	char *buf;
+
+	if (s->buf == NULL || s->failed || str == NULL || str[0] == 0)
+		return 0;
+
+	len = strlen(str) + 1;
+	if (s->len + len > s->alloc) {
+		alloc = s->alloc;
+		while (s->len + len > alloc)
+			alloc = alloc ? alloc * 2 : 64 * 1024;
+		buf = realloc(s->buf, alloc);
+		if (buf == NULL) {
+			s->failed = 1;
+			return 0;
+		}
+		s->buf = buf;
+		s->alloc = alloc;
+	}
+	off = s->len;
+	memcpy(&s->buf[off], str, len);
+	s->len += len;
+	return off;
+}
+
+static unsigned long idx_file_hash(apk_blob_t dir, apk_blob_t name)
+{
+	return apk_blob_hash(dir) ^ apk_blob_hash(name);
+}
+
+static struct apk_dbidx_pkg *sort_pkgs;
+static const char *sort_strings;
+
+static int idx_name_cmp(const void *a, const void *b)
+{
+	return strcmp(&sort_strings[sort_pkgs[*(const unsigned int *) a].name],
+		      &sort_strings[sort_pkgs[*(const unsigned int *) b].name]);
+}
+
+static int idx_write_all(int fd, const void *buf, size_t size)
+{
+	const char *p = buf;
+	ssize_t r;
+
+	while (size > 0) {
+		r = write(fd, p, size);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		p += r;
+		size -= r;
+	}
+	return 0;
+}
+
+int apk_db_write_index(struct apk_database *db)
+{
+	struct apk_dbidx_header hdr;
+	struct apk_dbidx_pkg *pkgs = NULL;
+	struct apk_dbidx_file *files = NULL;
+	unsigned int *names = NULL, *buckets = NULL, *deps = NULL;
+	struct idx_strings strings = { NULL, 0, 0, 0 };
+	struct apk_package *pkg;
+	struct apk_db_dir_instance *diri;
+	struct apk_db_file *file;
+	struct hlist_node *c1, *c2;
+	struct stat st;
+	unsigned int np, nf, nd, i, h;
+	int fd, r = -1;
+
+	/* Caller has chdir'd to the root, and just renamed the text db
+	 * into place; this is the version the index describes. */
+	if (stat(APK_DBIDX_FDB, &st) < 0)
+		goto err;
+
+	np = nf = nd = 0;
+	list_for_each_entry(pkg, &db->installed.packages, installed_pkgs_list) {
+		np++;
+		if (pkg->depends != NULL)
+			nd += pkg->depends->num;
+		hlist_for_each_entry(diri, c1, &pkg->owned_dirs, pkg_dirs_list) {
+			hlist_for_each_entry(file, c2, &diri->owned_files,
+					     diri_files_list)
+				nf++;
+		}
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = APK_DBIDX_MAGIC;
+	hdr.version = APK_DBIDX_VERSION;
+	hdr.fdb_size = st.st_size;
+	hdr.fdb_mtime = st.st_mtime;
+	hdr.fdb_ino = st.st_ino;
+	hdr.num_pkgs = np;
+	hdr.num_files = nf;
+	hdr.num_buckets = nf | 1;
+	hdr.num_deps = nd;
+
+	pkgs = calloc(np + 1, sizeof(*pkgs));
+	names = calloc(np + 1, sizeof(*names));
+	files = calloc(nf + 1, sizeof(*files));
+	buckets = calloc(hdr.num_buckets, sizeof(*buckets));
+	deps = calloc(nd + 1, sizeof(*deps));
+	if (pkgs == NULL || names == NULL || files == NULL || buckets == NULL ||
+	    deps == NULL)
+		goto err;
+
+	/* Offset 0 is the empty string */
+	strings.buf = malloc(64 * 1024);
+	if (strings.buf == NULL)
+		goto err;
+	strings.alloc = 64 * 1024;
+	strings.buf[0] = 0;
+	strings.len = 1;
+
+	np = nf = nd = 0;
+	list_for_each_entry(pkg, &db->installed.packages, installed_pkgs_list) {
+		struct apk_dbidx_pkg *ip = &pkgs[np];
+
+		memcpy(ip->csum, pkg->csum, sizeof(csum_t));
+		ip->name = idx_str(&strings, pkg->name->name);
+		ip->version = idx_str(&strings, pkg->version);
+		ip->description = idx_str(&strings, pkg->description);
+		ip->installed_size = pkg->installed_size;
+		ip->depends = nd;
+		if (pkg->depends != NULL) {
+			ip->num_depends = pkg->depends->num;
+			for (i = 0; i < (unsigned int) pkg->depends->num; i++)
+				deps[nd++] = idx_str(&strings,
+						     pkg->depends->item[i].name->name);
+		}
+		ip->first_file = nf;
+
+		hlist_for_each_entry(diri, c1, &pkg->owned_dirs, pkg_dirs_list) {
+			unsigned int dir = idx_str(&strings, diri->dir->dirname);
+
+			hlist_for_each_entry(file, c2, &diri->owned_files,
+					     diri_files_list) {
+				struct apk_dbidx_file *f = &files[nf];
+
+				f->pkg = np;
+				f->dir = dir;
+				f->name = idx_str(&strings, file->filename);
+				f->hash = idx_file_hash(APK_BLOB_STR(diri->dir->dirname),
+							APK_BLOB_STR(file->filename));
+				h = f->hash % hdr.num_buckets;
+				f->next = buckets[h];
+				buckets[h] = nf + 1;
+				nf++;
+			}
+		}
+		ip->num_files = nf - ip->first_file;
+		names[np] = np;
+		np++;
+	}
+	if (strings.failed)
+		goto err;
+
+	sort_pkgs = pkgs;
+	sort_strings = strings.buf;
+	qsort(names, np, sizeof(*names), idx_name_cmp);
+
+	hdr.pkgs = sizeof(hdr);
+	hdr.names = hdr.pkgs + np * sizeof(*pkgs);
+	hdr.files = hdr.names + np * sizeof(*names);
+	hdr.buckets = hdr.files + nf * sizeof(*files);
+	hdr.deps = hdr.buckets + hdr.num_buckets * sizeof(*buckets);
+	hdr.strings = hdr.deps + nd * sizeof(*deps);
+	hdr.size = hdr.strings + strings.len;
+
+	fd = open(APK_DBIDX_TMPFILE, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+	if (fd < 0)
+		goto err;
+	if (idx_write_all(fd, &hdr, sizeof(hdr)) < 0 ||
+	    idx_write_all(fd, pkgs, np * sizeof(*pkgs)) < 0 ||
+	    idx_write_all(fd, names, np * sizeof(*names)) < 0 ||
+	    idx_write_all(fd, files, nf * sizeof(*files)) < 0 ||
+	    idx_write_all(fd, buckets, hdr.num_buckets * sizeof(*buckets)) < 0 ||
+	    idx_write_all(fd, deps, nd * sizeof(*deps)) < 0 ||
+	    idx_write_all(fd, strings.buf, strings.len) < 0) {
+		close(fd);
+		unlink(APK_DBIDX_TMPFILE);
+		goto err;
+	}
+	close(fd);
+
+	if (rename(APK_DBIDX_TMPFILE, APK_DBIDX_FILE) < 0) {
+		unlink(APK_DBIDX_TMPFILE);
+		goto err;
+	}
+	r = 0;
+err:
+	/* A stale index would be rejected anyway; don't leave one about */
+	if (r != 0) {
+		r = errno ? -errno : -ENOMEM;
+		unlink(APK_DBIDX_FILE);
+		apk_warning("Unable to write installed database index: %s",
+			    strerror(-r));
+	}
+	free(pkgs);
+	free(names);
+	free(files);
+	free(buckets);
+	free(deps);
+	free(strings.buf);
+	return r;
+}
+
+/* Every offset and index in the file must stay inside it.  Section
+ * offsets are summed in 64 bits so that huge counts cannot wrap round
+ * to a plausible value. */
+static int idx_check(void *base, size_t size)
+{
+	struct apk_dbidx_header *hdr = (struct apk_dbidx_header *) base;
+	struct apk_dbidx_pkg *pkgs;
+	struct apk_dbidx_file *files;
+	unsigned int *names, *buckets, *deps;
+	const char *strings;
+	unsigned long long end;
+	unsigned int i, nstr;
+
+	end = sizeof(*hdr);
+	if (hdr->pkgs != end)
+		return 0;
+	end += (unsigned long long) hdr->num_pkgs * sizeof(*pkgs);
+	if (hdr->names != end)
+		return 0;
+	end += (unsigned long long) hdr->num_pkgs * sizeof(*names);
+	if (hdr->files != end)
+		return 0;
+	end += (unsigned long long) hdr->num_files * sizeof(*files);
+	if (hdr->buckets != end)
+		return 0;
+	end += (unsigned long long) hdr->num_buckets * sizeof(*buckets);
+	if (hdr->deps != end)
+		return 0;
+	end += (unsigned long long) hdr->num_deps * sizeof(*deps);
+	if (hdr->strings != end || end >= size || hdr->num_buckets == 0)
+		return 0;
+
+	pkgs = (struct apk_dbidx_pkg *) (base + hdr->pkgs);
+	names = (unsigned int *) (base + hdr->names);
+	files = (struct apk_dbidx_file *) (base + hdr->files);
+	buckets = (unsigned int *) (base + hdr->buckets);
+	deps = (unsigned int *) (base + hdr->deps);
+	strings = (const char *) (base + hdr->strings);
+	nstr = size - hdr->strings;
+
+	/* Offset 0 is the empty string, and the last string is terminated */
+	if (strings[0] != 0 || strings[nstr - 1] != 0)
+		return 0;
+
+	for (i = 0; i < hdr->num_pkgs; i++) {
+		struct apk_dbidx_pkg *p = &pkgs[i];
+
+		if (names[i] >= hdr->num_pkgs ||
+		    p->name >= nstr || p->version >= nstr ||
+		    p->description >= nstr ||
+		    p->depends > hdr->num_deps ||
+		    p->num_depends > hdr->num_deps - p->depends ||
+		    p->first_file > hdr->num_files ||
+		    p->num_files > hdr->num_files - p->first_file)
+			return 0;
+	}
+	/* A chain only ever points back to an earlier file, so it ends */
+	for (i = 0; i < hdr->num_files; i++) {
+		struct apk_dbidx_file *f = &files[i];
+
+		if (f->pkg >= hdr->num_pkgs || f->next > i ||
+		    f->dir >= nstr || f->name >= nstr)
+			return 0;
+	}
+	for (i = 0; i < hdr->num_buckets; i++)
+		if (buckets[i] > hdr->num_files)
+			return 0;
+	for (i = 0; i < hdr->num_deps; i++)
+		if (deps[i] >= nstr)
+			return 0;
+	return 1;
+}
+
+int apk_db_index_open(struct apk_db_index *idx, const char *root)
+{
+	struct apk_dbidx_header *hdr;
+	struct stat st, fst;
+	char path[PATH_MAX];
+	void *base;
+	int fd;
+
+	memset(idx, 0, sizeof(*idx));
+
+	snprintf(path, sizeof(path), "%s/" APK_DBIDX_FDB, root);
+	if (stat(path, &fst) < 0)
+		return -errno;
+
+	snprintf(path, sizeof(path), "%s/" APK_DBIDX_FILE, root);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(*hdr)) {
+		close(fd);
+		return -EINVAL;
+	}
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+		return -errno;
+
+	/* Reject anything not built from the current text database */
+	hdr = (struct apk_dbidx_header *) base;
+	if (hdr->magic != APK_DBIDX_MAGIC ||
+	    hdr->version != APK_DBIDX_VERSION ||
+	    hdr->size != st.st_size ||
+	    hdr->fdb_size != (unsigned int) fst.st_size ||
+	    hdr->fdb_mtime != (unsigned int) fst.st_mtime ||
+	    hdr->fdb_ino != (unsigned int) fst.st_ino) {
+		munmap(base, st.st_size);
+		return -ESTALE;
+	}
+	if (!idx_check(base, st.st_size)) {
+		munmap(base, st.st_size);
+		return -EINVAL;
+	}
+
+	idx->base = base;
+	idx->size = st.st_size;
+	idx->hdr = hdr;
+	idx->pkgs = (struct apk_dbidx_pkg *) (base + hdr->pkgs);
+	idx->names = (unsigned int *) (base + hdr->names);
+	idx->files = (struct apk_dbidx_file *) (base + hdr->files);
+	idx->buckets = (unsigned int *) (base + hdr->buckets);
+	idx->deps = (unsigned int *) (base + hdr->deps);
+	idx->strings = (const char *) (base + hdr->strings);
+	return 0;
+}
+
+void apk_db_index_close(struct apk_db_index *idx)
+{
+	if (idx->base != NULL)
+		munmap(idx->base, idx->size);
+	idx->base = NULL;
+}
+
+struct apk_dbidx_pkg *apk_db_index_query_name(struct apk_db_index *idx,
+					      apk_blob_t name)
+{
+	struct apk_dbidx_pkg *pkg;
+	int lo = 0, hi = idx->hdr->num_pkgs - 1, mid, r;
+	apk_blob_t pname;
+
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		pkg = &idx->pkgs[idx->names[mid]];
+		pname = APK_BLOB_STR(apk_db_index_str(idx, pkg->name));
+		r = memcmp(name.ptr, pname.ptr,
+			   name.len < pname.len ? name.len : pname.len);
+		if (r == 0)
+			r = (int) name.len - (int) pname.len;
+		if (r == 0)
+			return pkg;
+		if (r < 0)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+	return NULL;
+}
+
+struct apk_dbidx_pkg *apk_db_index_file_owner(struct apk_db_index *idx,
+					      apk_blob_t filename)
+{
+	struct apk_dbidx_file *f;
+	apk_blob_t dir, name;
+	unsigned long hash;
+	unsigned int i;
+
+	if (filename.len && filename.ptr[0] == '/')
+		filename.len--, filename.ptr++;
+
+	if (!apk_blob_rsplit(filename, '/', &dir, &name))
+		return NULL;
+
+	hash = idx_file_hash(dir, name) & 0xffffffff;
+	for (i = idx->buckets[hash % idx->hdr->num_buckets]; i != 0; i = f->next) {
+		f = &idx->files[i - 1];
+		if (f->hash != hash)
+			continue;
+		if (apk_blob_compare(dir, APK_BLOB_STR(apk_db_index_str(idx, f->dir))) == 0 &&
+		    apk_blob_compare(name, APK_BLOB_STR(apk_db_index_str(idx, f->name))) == 0)
+			return &idx->pkgs[f->pkg];
+	}
+	return NULL;
+}
@@ -9,6 +9,7 @@
  * by the Free Software Foundation. See http://www.gnu.org/ for details.
  */
 
+#include <errno.h>
 #include <stdio.h>
 #include <unistd.h>
 #include "apk_defines.h"
@@ -21,6 +22,13 @@ struct info_ctx {
 	int (*action)(struct info_ctx *ctx, struct apk_database *db,
 		      int argc, char **argv);
 	void (*subaction)(struct apk_package *pkg);
+
+	/* Same query answered from the installed database index, if it
+	 * can be; -EAGAIN means it needs the full database after all. */
+	int (*index_action)(struct info_ctx *ctx, struct apk_db_index *idx,
+			    int argc, char **argv);
+	void (*index_subaction)(struct apk_db_index *idx,
+				struct apk_dbidx_pkg *pkg);
 };
 
 static void verbose_print_pkg(struct apk_package *pkg, int minimal_verbosity)
@@ -209,6 +217,145 @@ static void info_print_required_by(struct apk_package *pkg)
 	puts("");
 }
 
+static void index_print_pkg(struct apk_db_index *idx,
+			    struct apk_dbidx_pkg *pkg, int minimal_verbosity)
+{
+	int verbosity = apk_verbosity;
+	if (verbosity < minimal_verbosity)
+		verbosity = minimal_verbosity;
+
+	if (pkg == NULL || verbosity < 1)
+		return;
+
+	printf("%s", apk_db_index_str(idx, pkg->name));
+	if (apk_verbosity > 1)
+		printf("-%s", apk_db_index_str(idx, pkg->version));
+	if (apk_verbosity > 2)
+		printf(" - %s", apk_db_index_str(idx, pkg->description));
+	printf("\n");
+}
+
+static int index_list(struct info_ctx *ctx, struct apk_db_index *idx,
+		      int argc, char **argv)
+{
+	int i;
+
+	for (i = 0; i < idx->hdr->num_pkgs; i++)
+		index_print_pkg(idx, &idx->pkgs[i], 1);
+	return 0;
+}
+
+static int index_exists(struct info_ctx *ctx, struct apk_db_index *idx,
+			int argc, char **argv)
+{
+	struct apk_dbidx_pkg *pkg;
+	int i, ret = 0;
+
+	for (i = 0; i < argc; i++) {
+		pkg = apk_db_index_query_name(idx, APK_BLOB_STR(argv[i]));
+		if (pkg == NULL)
+			ret++;
+		else
+			index_print_pkg(idx, pkg, 0);
+	}
+
+	return ret;
+}
+
+static int index_who_owns(struct info_ctx *ctx, struct apk_db_index *idx,
+			  int argc, char **argv)
+{
+	struct apk_dbidx_pkg *pkg, **owners;
+	int i, j, num = 0;
+
+	owners = calloc(argc + 1, sizeof(*owners));
+	if (owners == NULL)
+		return -EAGAIN;
+
+	for (i = 0; i < argc; i++) {
+		pkg = apk_db_index_file_owner(idx, APK_BLOB_STR(argv[i]));
+		if (pkg == NULL)
+			continue;
+
+		if (apk_verbosity < 1) {
+			for (j = 0; j < num && owners[j] != pkg; j++)
+				;
+			if (j == num)
+				owners[num++] = pkg;
+		} else {
+			printf("%s is owned by %s-%s\n", argv[i],
+			       apk_db_index_str(idx, pkg->name),
+			       apk_db_index_str(idx, pkg->version));
+		}
+	}
+	if (num != 0) {
+		for (j = 0; j < num; j++)
+			printf("%s%s", j ? " " : "",
+			       apk_db_index_str(idx, owners[j]->name));
+		printf("\n");
+	}
+	free(owners);
+
+	return 0;
+}
+
+static int index_package(struct info_ctx *ctx, struct apk_db_index *idx,
+			 int argc, char **argv)
+{
+	int i;
+
+	/* Names that are known but not installed, or not known at all,
+	 * are reported by the full database code */
+	for (i = 0; i < argc; i++)
+		if (apk_db_index_query_name(idx, APK_BLOB_STR(argv[i])) == NULL)
+			return -EAGAIN;
+
+	for (i = 0; i < argc; i++)
+		ctx->index_subaction(idx,
+			apk_db_index_query_name(idx, APK_BLOB_STR(argv[i])));
+	return 0;
+}
+
+static void index_print_contents(struct apk_db_index *idx,
+				 struct apk_dbidx_pkg *pkg)
+{
+	const char *name = apk_db_index_str(idx, pkg->name);
+	struct apk_dbidx_file *file;
+	int i;
+
+	if (apk_verbosity == 1)
+		printf("%s-%s contains:\n", name,
+		       apk_db_index_str(idx, pkg->version));
+
+	for (i = 0; i < pkg->num_files; i++) {
+		file = &idx->files[pkg->first_file + i];
+		if (apk_verbosity > 1)
+			printf("%s: ", name);
+		printf("%s/%s\n", apk_db_index_str(idx, file->dir),
+		       apk_db_index_str(idx, file->name));
+	}
+	puts("");
+}
+
+static void index_print_depends(struct apk_db_index *idx,
+				struct apk_dbidx_pkg *pkg)
+{
+	int i;
+	char *separator = apk_verbosity > 1 ? " " : "\n";
+
+	if (apk_verbosity == 1)
+		printf("%s-%s depends on:\n", apk_db_index_str(idx, pkg->name),
+		       apk_db_index_str(idx, pkg->version));
+	if (pkg->num_depends == 0)
+		return;
+	if (apk_verbosity > 1)
+		printf("%s: ", apk_db_index_str(idx, pkg->name));
+	for (i = 0; i < pkg->num_depends; i++)
+		printf("%s%s", apk_db_index_str(idx, idx->deps[pkg->depends + i]),
+		       separator);
+	puts("");
+}
+
 static int info_parse(void *ctx, int optch, int optindex, const char *optarg)
 {
 	struct info_ctx *ictx = (struct info_ctx *) ctx;
@@ -216,21 +363,29 @@ static int info_parse(void *ctx, int optch, int optindex, const char *optarg)
 	switch (optch) {
 	case 'e':
 		ictx->action = info_exists;
+		ictx->index_action = index_exists;
 		break;
 	case 'W':
 		ictx->action = info_who_owns;
+		ictx->index_action = index_who_owns;
 		break;
 	case 'L':
 		ictx->action = info_package;
 		ictx->subaction = info_print_contents;
+		ictx->index_action = index_package;
+		ictx->index_subaction = index_print_contents;
 		break;
 	case 'R':
 		ictx->action = info_package;
 		ictx->subaction = info_print_depends;
+		ictx->index_action = index_package;
+		ictx->index_subaction = index_print_depends;
 		break;
 	case 'r':
+		/* Needs reverse dependencies; not in the index */
 		ictx->action = info_package;
 		ictx->subaction = info_print_required_by;
+		ictx->index_action = NULL;
 		break;
 	default:
 		return -1;
@@ -242,15 +397,26 @@ static int info_main(void *ctx, int argc, char **argv)
 {
 	struct info_ctx *ictx = (struct info_ctx *) ctx;
 	struct apk_database db;
+	struct apk_db_index idx;
 	int r;
 
+	if (ictx->action == NULL) {
+		ictx->action = info_list;
+		ictx->index_action = index_list;
+	}
+
+	if (ictx->index_action != NULL &&
+	    apk_db_index_open(&idx, apk_root) == 0) {
+		r = ictx->index_action(ictx, &idx, argc, argv);
+		apk_db_index_close(&idx);
+		if (r != -EAGAIN)
+			return r;
+	}
+
 	if (apk_db_open(&db, apk_root, APK_OPENF_READ + APK_OPENF_EMPTY_REPOS) < 0)
 		return -1;
 
-	if (ictx->action != NULL)
-		r = ictx->action(ictx, &db, argc, argv);
-	else
-		r = info_list(ictx, &db, argc, argv);
+	r = ictx->action(ictx, &db, argc, argv);
 
 	apk_db_close(&db);
 	return r;
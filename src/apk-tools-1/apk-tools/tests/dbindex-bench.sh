@@ -0,0 +1,105 @@
+#!/bin/sh
+# Host benchmark for the installed database index (installed.idx).
+# Builds a synthetic root whose text installed database lists
+# $NPKGS packages of $NFILES files each (20000 files by default),
+# lets apk write the index, then times read-only queries with the
+# index and with the text database alone, and checks both give the
+# same answers. No root needed; nothing outside $work is touched.
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+APK="$here/../src/apk"
+work=/tmp/apk_dbindex_bench
+root="$work/root"
+NPKGS=${NPKGS:-200}
+NFILES=${NFILES:-100}
+RUNS=${RUNS:-10}
+
+[ -x "$APK" ] || { echo "FAIL: apk binary not found at $APK"; exit 1; }
+
+rm -rf "$work"; mkdir -p "$root/var/lib/apk" "$root/etc/apk"
+: > "$root/etc/apk/repositories"
+APK_REPOS="$root/etc/apk/repositories"; export APK_REPOS
+echo "pkg0" > "$root/var/lib/apk/world"
+
+# 1. Synthetic text database: ten files per directory, each package
+#    depending on the one before it.
+awk -v npkgs="$NPKGS" -v nfiles="$NFILES" 'BEGIN {
+	for (p = 0; p < npkgs; p++) {
+		printf "C:%08x%024d\n", p + 1, 0
+		printf "P:pkg%d\nV:1.%d-r0\nT:synthetic package %d\n", p, p, p
+		printf "S:%d\nI:%d\n", 4096 * nfiles, 4096 * nfiles
+		if (p > 0)
+			printf "D:pkg%d\n", p - 1
+		for (f = 0; f < nfiles; f++) {
+			if (f % 10 == 0)
+				printf "F:usr/share/pkg%d/d%d\nM:0:0:755\n", p, f / 10
+			printf "R:file%d\n", f
+		}
+		printf "\n"
+	}
+}' > "$root/var/lib/apk/installed"
+echo "ok: $NPKGS packages, $((NPKGS * NFILES)) files"
+
+# 2. Any transaction rewrites the databases; an empty add is enough.
+"$APK" --root "$root" add >/dev/null 2>&1
+test -f "$root/var/lib/apk/installed.idx"
+echo "ok: installed.idx written"
+
+now() {
+	date +%s%N 2>/dev/null | grep -v N || echo "$(date +%s)000000000"
+}
+
+bench() {
+	# bench label args...
+	label=$1; shift
+	t0=$(now)
+	i=0
+	while [ $i -lt $RUNS ]; do
+		"$APK" --root "$root" "$@" > /dev/null
+		i=$((i + 1))
+	done
+	t1=$(now)
+	echo "$label: $(( (t1 - t0) / RUNS / 1000 )) us/run"
+}
+
+last=$((NPKGS - 1))
+owner="/usr/share/pkg$last/d$(( (NFILES - 1) / 10 ))/file$((NFILES - 1))"
+
+# 3. Same answers either way.
+for q in "info" "-v info" "-vv info" "info -W $owner" "-q info -W $owner" \
+	 "info -e pkg$last nosuch" "info -L pkg$last" "info -R pkg$last"; do
+	"$APK" --root "$root" $q > "$work/idx.out" 2>&1 || true
+	mv "$root/var/lib/apk/installed.idx" "$work/installed.idx"
+	"$APK" --root "$root" $q > "$work/fdb.out" 2>&1 || true
+	mv "$work/installed.idx" "$root/var/lib/apk/installed.idx"
+	cmp -s "$work/idx.out" "$work/fdb.out" ||
+		{ echo "FAIL: 'apk $q' differs with the index"; exit 1; }
+done
+echo "ok: index and text database agree"
+
+# 4. Timings.
+bench "info -W (index)" info -W "$owner"
+bench "info -L (index)" info -L "pkg$last"
+mv "$root/var/lib/apk/installed.idx" "$work/installed.idx"
+bench "info -W (text) " info -W "$owner"
+bench "info -L (text) " info -L "pkg$last"
+mv "$work/installed.idx" "$root/var/lib/apk/installed.idx"
+
+# 5. An index older than the text database must not be used.  Move
+#    $owner from pkg$last to pkg0 in the text database, in place and
+#    within the same second, and ask again.
+fdb="$root/var/lib/apk/installed"
+awk -v last="pkg$last" -v dir="${owner%/*}" -v file="${owner##*/}" '
+	/^P:/ { pkg = substr($0, 3) }
+	pkg == last && $0 == "R:" file { next }
+	pkg == "pkg0" && $0 == "" { printf "F:%s\nM:0:0:755\nR:%s\n", substr(dir, 2), file }
+	{ print }
+' "$fdb" > "$work/installed.new"
+cat "$work/installed.new" > "$fdb"
+"$APK" --root "$root" info -W "$owner" > "$work/stale.out"
+grep -q "is owned by pkg0-" "$work/stale.out" ||
+	{ echo "FAIL: stale index used: $(cat "$work/stale.out")"; exit 1; }
+echo "ok: stale index ignored"
+
+echo "DBINDEX BENCHMARK PASSED"
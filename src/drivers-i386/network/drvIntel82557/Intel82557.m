@@ -12,6 +12,8 @@
 #import <driverkit/IONetbufQueue.h>
 #import <machkit/NXLock.h>
 #import <kernserv/prototypes.h>
+#import <kernserv/ns_timer.h>
+#import <sys/callout.h>
 
 /* Forward declarations for utility functions */
 static void __resetFunc(id driverInstance);
@@ -20,6 +22,8 @@ static unsigned int _IOIsPhysicallyContiguous(unsigned int vaddr, int size);
 static unsigned int _IOMallocNonCached(int requestedSize, int *allocPtr, int *allocSize);
 static unsigned int _IOMallocPage(int requestedSize, int *allocPtr, int *allocSize);
 static void _intHandler(void);
+static void _coalesceFunc(void *arg);
+static int _configInt(id configTable, const char *key, int defaultValue);
 static void *_QDequeue(void *queue);
 static void _recycleNetbuf(netbuf_t nb, void *arg1, int *bufferEntry);
 
@@ -40,8 +44,66 @@ extern void bzero(void *s, int n);
 extern int spldevice(void);
 extern void splx(int level);
 extern void IOSleep(int milliseconds);
+extern int strcmp(const char *s1, const char *s2);
 extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
 
+/*
+ * Interrupt coalescing defaults, overridden by the "Interrupt Coalesce
+ * Frames" and "Interrupt Coalesce Time" keys in the config table.
+ * Frames is both the transmit interrupt stride (one TCB in that many
+ * carries the I bit) and the number of received frames the interrupt
+ * handler will hold before waking the I/O thread; time bounds how long
+ * they may be held, in milliseconds.  A time of 0 disables the receive
+ * holdoff, which is the old behaviour.
+ */
+#define COALESCE_FRAMES_DEFAULT    8
+#define COALESCE_FRAMES_MAX        16    /* TCB count */
+#define COALESCE_TIME_DEFAULT      0
+#define COALESCE_TIME_MAX          100
+
+/*
+ * Interrupt coalescing state.  The instance layout is fixed by the
+ * class interface and ends at +0x230, so this state is allocated
+ * separately by initFromDeviceDescription: and found from the
+ * instance with _coalesceState().
+ *
+ * The counters are logged in debug mode and cleared each statistics
+ * period along with the hardware counters.
+ */
+typedef struct _CoalesceState {
+    struct _CoalesceState *next;
+    id          driver;             /* owning instance */
+    int         frames;             /* Interrupt Coalesce Frames */
+    int         timeMs;             /* Interrupt Coalesce Time */
+    int         interrupts;         /* hardware interrupts taken */
+    int         messages;           /* interrupt messages sent */
+    int         rxPackets;          /* frames received */
+    int         rxBatches;          /* receive batches handed up */
+    int         txReclaimed;        /* transmits reclaimed */
+    int         txBatches;          /* transmit reclaim batches */
+    BOOL        armed;              /* receive holdoff timer running */
+    void        *msgParam1;         /* saved IOSendInterrupt arguments */
+    void        *msgParam2;
+} CoalesceState;
+
+static CoalesceState *_coalesceList;
+
+/*
+ * Find an instance's coalescing state.  There is one entry per
+ * adapter, so the list is short.
+ */
+static CoalesceState *_coalesceState(id driverInstance)
+{
+    CoalesceState *cs;
+
+    for (cs = _coalesceList; cs != NULL; cs = cs->next) {
+        if (cs->driver == driverInstance) {
+            break;
+        }
+    }
+    return cs;
+}
+
 @implementation Intel82557
 
 /*
@@ -165,7 +227,8 @@ extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
  *
  * Initialization sequence:
  *   1. Call superclass initialization
- *   2. Clear all driver state flags
+ *   2. Clear all driver state flags, allocate the coalescing state
+ *      and read the coalescing tunables into it
  *   3. Get device I/O port from device description
  *   4. Initialize EEPROM interface and read MAC address
  *   5. Attach to network stack
@@ -179,6 +242,10 @@ extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
     unsigned char *eepromContents;
     id networkInterface;
     unsigned char *eepromCtrlReg;
+    id configTable;
+    const char *configValue;
+    int value;
+    CoalesceState *cs;
 
     IOLog("Intel82557: initFromDeviceDescription\n");
 
@@ -197,6 +264,50 @@ extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
     *(unsigned char *)(((char *)self) + 0x1A1) = 0;  /* Debug flag */
     *(unsigned int *)(((char *)self) + 0x1BC) = 0;   /* SCB base address */
 
+    /* Allocate the coalescing state, with all counters zero */
+    cs = (CoalesceState *)IOMalloc(sizeof(CoalesceState));
+    if (cs == NULL) {
+        IOLog("Intel82557: can't allocate coalescing state\n");
+        [self free];
+        return nil;
+    }
+    bzero(cs, sizeof(CoalesceState));
+    cs->driver = self;
+    cs->next = _coalesceList;
+    _coalesceList = cs;
+
+    /* Read interrupt coalescing tunables, clamped to sane ranges */
+    configTable = [deviceDescription configTable];
+
+    value = _configInt(configTable, "Interrupt Coalesce Frames",
+                       COALESCE_FRAMES_DEFAULT);
+    if (value < 1) {
+        value = 1;
+    }
+    if (value > COALESCE_FRAMES_MAX) {
+        value = COALESCE_FRAMES_MAX;
+    }
+    cs->frames = value;
+
+    value = _configInt(configTable, "Interrupt Coalesce Time",
+                       COALESCE_TIME_DEFAULT);
+    if (value < 0) {
+        value = 0;
+    }
+    if (value > COALESCE_TIME_MAX) {
+        value = COALESCE_TIME_MAX;
+    }
+    cs->timeMs = value;
+
+    /* Debug flag also enables the periodic coalescing statistics log */
+    configValue = [configTable valueForStringKey:"Debug"];
+    if (configValue != NULL) {
+        if (strcmp(configValue, "YES") == 0) {
+            *(unsigned char *)(((char *)self) + 0x1A1) = 1;
+        }
+        [configTable freeString:configValue];
+    }
+
     /* Get device I/O port from device description */
     devicePort = [deviceDescription devicePort];
     *(id *)(((char *)self) + 0x1AC) = devicePort;
@@ -264,6 +375,9 @@ extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
     int i;
     netbuf_t nb;
     unsigned char *rfdBase;
+    CoalesceState *cs;
+    CoalesceState **csp;
+    int spl;
 
     /* If initialized, disable interrupts and clear flag */
     if (*(unsigned char *)(((char *)self) + 0x194) == 1) {
@@ -271,6 +385,22 @@ extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
         *(unsigned char *)(((char *)self) + 0x194) = 0;
     }
 
+    /*
+     * Make sure a receive holdoff callout can't fire on freed state,
+     * then unlink and free the coalescing state
+     */
+    cs = _coalesceState(self);
+    if (cs != NULL) {
+        ns_untimeout((func)_coalesceFunc, cs);
+        spl = spldevice();
+        for (csp = &_coalesceList; *csp != cs; csp = &(*csp)->next) {
+            continue;
+        }
+        *csp = cs->next;
+        splx(spl);
+        IOFree(cs, sizeof(CoalesceState));
+    }
+
     /* Free network interface object */
     if (*(id *)(((char *)self) + 0x184) != nil) {
         [*(id *)(((char *)self) + 0x184) free];
@@ -324,7 +454,7 @@ extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
  *
  * Operation:
  *   1. Clear any pending timeouts
- *   2. Disable adapter interrupts
+ *   2. Disable adapter interrupts and cancel the receive holdoff
  *   3. Reset driver state flags
  *   4. Refill free queue with buffers
  *   5. Perform hardware initialization (hwInit)
@@ -340,6 +470,7 @@ extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
 {
     BOOL result;
     int enableResult;
+    CoalesceState *cs;
 
     /* Clear any pending timeouts */
     [self clearTimeout];
@@ -347,6 +478,11 @@ extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
     /* Disable adapter interrupts during reset */
     [self disableAdapterInterrupts];
 
+    /* Cancel any pending receive holdoff */
+    cs = _coalesceState(self);
+    ns_untimeout((func)_coalesceFunc, cs);
+    cs->armed = NO;
+
     /* Reset driver state flags */
     *(unsigned char *)(((char *)self) + 0x197) = 1;  /* Packets received */
     *(unsigned char *)(((char *)self) + 0x198) = 0;  /* Transmit in progress */
@@ -1406,22 +1542,29 @@ extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
  *   1. Check if reset is scheduled (+0x195)
  *   2. If so, call __scheduleReset and clear flag
  *   3. Otherwise:
- *      - Dequeue all received packets from receive queue
- *      - For each packet, either pass to network stack or free if unwanted multicast
+ *      - Detach the whole receive queue in one critical section
+ *      - Hand the batch up, freeing unwanted multicast packets
+ *      - Repeat until the interrupt handler has queued nothing new
  *      - Refill receive queue with fresh buffers
  *      - Free completed transmit buffers
  *      - Service transmit queue
+ *
+ * The interrupt handler has already drained the RFA ring into the
+ * receive queue, so taking the queue as a batch costs one spldevice()
+ * per interrupt message rather than one per frame.
  */
 - (void)interruptOccurred
 {
     unsigned int spl;
     netbuf_t packet;
+    netbuf_t batch;
+    int batchCount;
     int packetsReceived;
-    int *queueCount;
-    void *queueTail;
-    void *queueHead;
     unsigned char *mappedData;
     BOOL isUnwanted;
+    BOOL filterMulticast;
+    id networkInterface;
+    CoalesceState *cs;
 
     /* Check if reset is scheduled */
     if (*(unsigned char *)(((char *)self) + 0x195) != 0) {
@@ -1431,69 +1574,59 @@ extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
         return;
     }
 
+    networkInterface = *(id *)(((char *)self) + 0x184);
+    cs = _coalesceState(self);
+
+    /* Only filter multicast if not promiscuous and multicast is enabled */
+    filterMulticast =
+        (*(unsigned char *)(((char *)self) + 0x190) != 0x01) &&
+        (*(unsigned char *)(((char *)self) + 0x193) != 0);
+
     /* Process received packets */
-    spl = spldevice();
     packetsReceived = 0;
 
     while (1) {
-        /* Dequeue packet from receive queue */
-        if (*(int *)(((char *)self) + 0x210) == 0) {
-            /* Queue is empty */
-            packet = NULL;
-        } else {
-            /* Get head of queue */
-            packet = *(netbuf_t *)(((char *)self) + 0x208);
-
-            /* Update head to next packet */
-            *(netbuf_t *)(((char *)self) + 0x208) = *(netbuf_t *)packet;
+        /* Detach the entire receive queue */
+        spl = spldevice();
+        batch = *(netbuf_t *)(((char *)self) + 0x208);
+        batchCount = *(int *)(((char *)self) + 0x210);
+        *(void **)(((char *)self) + 0x208) = NULL;
+        *(void **)(((char *)self) + 0x20C) = NULL;
+        *(int *)(((char *)self) + 0x210) = 0;
+        splx(spl);
 
-            /* Decrement count */
-            queueCount = (int *)(((char *)self) + 0x210);
-            (*queueCount)--;
+        /* Done once the interrupt handler has queued nothing new */
+        if (batchCount == 0) {
+            break;
+        }
 
-            /* If queue is now empty, clear tail and head */
-            if (*queueCount == 0) {
-                *(void **)(((char *)self) + 0x20C) = NULL;
-                *(void **)(((char *)self) + 0x208) = NULL;
-            }
+        packetsReceived += batchCount;
+        cs->rxPackets += batchCount;
+        cs->rxBatches += 1;
 
-            /* Clear next pointer in dequeued packet */
+        while (batch != NULL) {
+            /* Unlink packet from batch */
+            packet = batch;
+            batch = *(netbuf_t *)packet;
             *(netbuf_t *)packet = NULL;
-        }
 
-        /* Break if no more packets */
-        if (packet == NULL) {
-            break;
-        }
+            if (filterMulticast) {
+                /* Check if this is an unwanted multicast packet */
+                mappedData = nb_map(packet);
+                isUnwanted = [super isUnwantedMulticastPacket:mappedData];
 
-        splx(spl);
-        packetsReceived++;
+                if (isUnwanted) {
+                    /* Unwanted multicast - free it */
+                    nb_free(packet);
+                    continue;
+                }
+            }
 
-        /* Check if we should pass packet to network stack */
-        if ((*(unsigned char *)(((char *)self) + 0x190) == 0x01) ||
-            (*(unsigned char *)(((char *)self) + 0x193) == 0)) {
-            /* Promiscuous mode enabled or multicast not enabled */
             /* Pass packet to network interface */
-            [*(id *)(((char *)self) + 0x184) handleInputPacket:packet extra:0];
-        } else {
-            /* Check if this is an unwanted multicast packet */
-            mappedData = nb_map(packet);
-            isUnwanted = [super isUnwantedMulticastPacket:mappedData];
-
-            if (!isUnwanted) {
-                /* Wanted packet - pass to network interface */
-                [*(id *)(((char *)self) + 0x184) handleInputPacket:packet extra:0];
-            } else {
-                /* Unwanted multicast - free it */
-                nb_free(packet);
-            }
+            [networkInterface handleInputPacket:packet extra:0];
         }
-
-        spl = spldevice();
     }
 
-    splx(spl);
-
     /* Set flag if we received packets */
     if (packetsReceived > 0) {
         *(unsigned char *)(((char *)self) + 0x197) = 1;
@@ -1582,12 +1715,15 @@ extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
  * Driver instance structure:
  *   +0x18C: TX queue object
  *   +0x196: Interrupts enabled flag
+ *   +0x1D4: Total TCB count
  *   +0x1E4: Free TCB count
  *
  * Operation:
  *   1. Check if driver is running and interrupts enabled
  *   2. If not, free packet and return
- *   3. Free completed transmits
+ *   3. Free completed transmits, but only once half the TCBs are in
+ *      use; otherwise leave them for the next interrupt so they are
+ *      reclaimed in a batch rather than one per packet sent
  *   4. Service transmit queue
  *   5. If queue is empty and TCBs available, transmit immediately
  *   6. Otherwise enqueue packet for later transmission
@@ -1607,8 +1743,11 @@ extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
         return;
     }
 
-    /* Free any completed transmit buffers */
-    [self freeCompletedTransmits];
+    /* Reclaim completed transmit buffers once the ring is half used */
+    if (*(int *)(((char *)self) + 0x1E4) <=
+        *(int *)(((char *)self) + 0x1D4) / 2) {
+        [self freeCompletedTransmits];
+    }
 
     /* Service the transmit queue (send queued packets) */
     [self serviceTransmitQueue];
@@ -1956,6 +2095,10 @@ extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
 {
     int tcbAddr;
     netbuf_t nb;
+    int reclaimed;
+    CoalesceState *cs;
+
+    reclaimed = 0;
 
     /* Process completed TCBs while free count < total count and C bit is set */
     while ((*(int *)(((char *)self) + 0x1E4) < *(int *)(((char *)self) + 0x1D4))) {
@@ -1985,6 +2128,13 @@ extern void IOScheduleFunc(void (*func)(void), void *arg, int param);
 
         /* Increment free count */
         *(int *)(((char *)self) + 0x1E4) = *(int *)(((char *)self) + 0x1E4) + 1;
+        reclaimed++;
+    }
+
+    if (reclaimed > 0) {
+        cs = _coalesceState(self);
+        cs->txReclaimed += reclaimed;
+        cs->txBatches += 1;
     }
 }
 
@@ -3341,7 +3491,7 @@ setup_phy:
  * Driver instance structure:
  *   +0x184: Network interface
  *   +0x198: Transmit in progress flag
- *   +0x19C: Interrupt counter (generate interrupt every 8th packet)
+ *   +0x19C: Interrupt counter (generate interrupt every Nth packet)
  *   +0x1BC: SCB base address
  *   +0x1DC: Last TCB pointer
  *   +0x1E0: Current TCB pointer
@@ -3411,10 +3561,14 @@ setup_phy:
     /* Set suspend bit (0x40) */
     ((unsigned char *)currentTcb)[3] |= 0x40;
 
-    /* Handle interrupt generation (every 8th packet) */
+    /*
+     * Handle interrupt generation (every Nth packet).  A burst shorter
+     * than N still gets reclaimed: the CU suspends on the last TCB and
+     * raises CNA, and transmit: reclaims once the ring is half used.
+     */
     *(int *)(((char *)self) + 0x19C) = *(int *)(((char *)self) + 0x19C) + 1;
 
-    if (*(int *)(((char *)self) + 0x19C) == 8) {
+    if (*(int *)(((char *)self) + 0x19C) >= _coalesceState(self)->frames) {
         /* Generate interrupt on this packet */
         ((unsigned char *)currentTcb)[3] |= 0x20;
         *(int *)(((char *)self) + 0x19C) = 0;
@@ -3617,15 +3771,22 @@ transmitError:
  *   +0x38: RX collision detect errors
  *   +0x3C: RX short frame errors
  *   +0x40: Completion flag (non-zero = valid)
+ *
+ * The interrupt and batch counters in the coalescing state are logged
+ * in debug mode and cleared each period along with these.
  */
 - (void)__updateStatistics
 {
     int *statsBuffer;
+    CoalesceState *cs;
     id networkInterface;
     BOOL debugMode;
     int outputErrors;
     int inputErrors;
     int collisions;
+    int packets;
+    int ratio;
+    int spl;
 
     /* Get statistics buffer pointer */
     statsBuffer = *(int **)(((char *)self) + 0x1C8);
@@ -3636,6 +3797,7 @@ transmitError:
     }
 
     debugMode = *(unsigned char *)(((char *)self) + 0x1A1);
+    cs = _coalesceState(self);
 
     /* Log individual statistics in debug mode */
     if (debugMode) {
@@ -3687,8 +3849,39 @@ transmitError:
         if (statsBuffer[0x0F] != 0) {
             IOLog("rx_short_frame_errors %ld\n", statsBuffer[0x0F]);
         }
+
+        /* Interrupts per packet and packets per batch, in hundredths */
+        packets = cs->rxPackets + cs->txReclaimed;
+        if (packets != 0) {
+            ratio = (cs->interrupts * 100) / packets;
+            IOLog("interrupts %ld messages %ld interrupts/packet %d.%02d\n",
+                  cs->interrupts, cs->messages, ratio / 100, ratio % 100);
+        }
+        if (cs->rxBatches != 0) {
+            ratio = (cs->rxPackets * 100) / cs->rxBatches;
+            IOLog("rx_packets %ld rx_batches %ld packets/batch %d.%02d\n",
+                  cs->rxPackets, cs->rxBatches, ratio / 100, ratio % 100);
+        }
+        if (cs->txBatches != 0) {
+            ratio = (cs->txReclaimed * 100) / cs->txBatches;
+            IOLog("tx_reclaimed %ld tx_batches %ld packets/batch %d.%02d\n",
+                  cs->txReclaimed, cs->txBatches, ratio / 100, ratio % 100);
+        }
     }
 
+    /*
+     * Start a new period; interrupts and messages are bumped by
+     * _intHandler
+     */
+    spl = spldevice();
+    cs->interrupts = 0;
+    cs->messages = 0;
+    cs->rxPackets = 0;
+    cs->rxBatches = 0;
+    cs->txReclaimed = 0;
+    cs->txBatches = 0;
+    splx(spl);
+
     networkInterface = *(id *)(((char *)self) + 0x184);
 
     /* Calculate total output errors */
@@ -4541,6 +4734,13 @@ static unsigned int _IOMallocPage(int requestedSize, int *allocPtr, int *allocSi
  *   +0x218: Free netbuf queue head
  *   +0x21C: Free netbuf queue tail
  *   +0x220: Free netbuf queue count
+ *
+ * When a coalesce time is configured, routine receive and transmit
+ * completions do not wake the I/O thread until coalesce-frames frames
+ * are waiting in the receive queue or the holdoff timer expires.  The
+ * RFA ring is still drained here on every interrupt, so holding the
+ * message back never leaves the receive unit short of RFDs.  Resets,
+ * RNR and a transmit ring with no free TCBs are always reported at once.
  */
 static void _intHandler(void *param1, void *param2, int driverInstance)
 {
@@ -4557,6 +4757,7 @@ static void _intHandler(void *param1, void *param2, int driverInstance)
     int loopCount;
     int nbSize;
     int *countPtr;
+    CoalesceState *cs;
 
     /* Check if driver is enabled */
     if (*(char *)(driverInstance + 0x196) != 1) {
@@ -4565,6 +4766,7 @@ static void _intHandler(void *param1, void *param2, int driverInstance)
     }
 
     needInterrupt = NO;
+    cs = _coalesceState((id)driverInstance);
 
     /* Get status register pointer */
     statusRegPtr = *(unsigned char **)(driverInstance + 0x1BC);
@@ -4573,6 +4775,7 @@ static void _intHandler(void *param1, void *param2, int driverInstance)
     statusByte = statusRegPtr[1];
     if (statusByte != 0) {
         statusRegPtr[1] = statusByte;
+        cs->interrupts++;
     }
 
     /* Process interrupts (max 10 iterations to prevent lockup) */
@@ -4700,8 +4903,28 @@ done_receive:
         }
     }
 
+    /* Hold routine completions back if coalescing is enabled */
+    if (needInterrupt &&
+        *(char *)(driverInstance + 0x195) != 1 &&
+        cs->timeMs != 0 &&
+        *(int *)(driverInstance + 0x210) < cs->frames &&
+        *(int *)(driverInstance + 0x1E4) != 0) {
+
+        /* Arm the holdoff timer unless it is already running */
+        if (!cs->armed) {
+            cs->msgParam1 = param1;
+            cs->msgParam2 = param2;
+            cs->armed = YES;
+            ns_timeout((func)_coalesceFunc, (void *)cs,
+                       (ns_time_t)cs->timeMs * 1000000,
+                       CALLOUT_PRI_SOFTINT0);
+        }
+        needInterrupt = NO;
+    }
+
     /* Send interrupt notification if needed */
     if (needInterrupt || *(char *)(driverInstance + 0x195) == 1) {
+        cs->messages++;
         IOSendInterrupt(param1, param2, 0x232325);
     }
 
@@ -4709,6 +4932,67 @@ done_receive:
     IOEnableInterrupt(param1);
 }
 
+/*
+ * Receive holdoff timer callback
+ * Wakes the I/O thread for completions _intHandler held back, using
+ * the interrupt message arguments it saved in the coalescing state
+ *
+ * If the I/O thread was woken for some other reason in the meantime
+ * the message is redundant; interruptOccurred then finds the receive
+ * queue empty and returns quickly.
+ */
+static void _coalesceFunc(void *arg)
+{
+    CoalesceState *cs = (CoalesceState *)arg;
+    int spl;
+
+    spl = spldevice();
+
+    if (cs->armed) {
+        cs->armed = NO;
+        cs->messages++;
+        IOSendInterrupt(cs->msgParam1, cs->msgParam2, 0x232325);
+    }
+
+    splx(spl);
+}
+
+/*
+ * Read an integer from the config table
+ * Returns defaultValue if the key is absent or holds no digits
+ */
+static int _configInt(id configTable, const char *key, int defaultValue)
+{
+    const char *configValue;
+    const char *cp;
+    int value;
+    BOOL sawDigit;
+
+    configValue = [configTable valueForStringKey:key];
+    if (configValue == NULL) {
+        return defaultValue;
+    }
+
+    /* Skip leading whitespace */
+    cp = configValue;
+    while (*cp == ' ' || *cp == '\t' || *cp == '\n') {
+        cp++;
+    }
+
+    /* Parse decimal value */
+    value = 0;
+    sawDigit = NO;
+    while (*cp >= '0' && *cp <= '9') {
+        value = value * 10 + (*cp - '0');
+        sawDigit = YES;
+        cp++;
+    }
+
+    [configTable freeString:configValue];
+
+    return sawDigit ? value : defaultValue;
+}
+
 /*
  * Dequeue operation
  * Removes and returns the first element from a queue
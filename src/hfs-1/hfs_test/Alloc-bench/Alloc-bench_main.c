@@ -0,0 +1,433 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * "Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.0 (the 'License').  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License."
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *	Alloc-bench - HFS allocation on a nearly full volume.
+ *
+ *	Alloc-bench [-f fill] [-s maxkb] [-n nops] [-S seed] [-c] [-k] dir
+ *
+ *	Fills dir, which should be on an otherwise empty HFS or HFS Plus
+ *	volume, with files of random sizes up to maxkb (default 256K)
+ *	until the volume is fill percent full (default 90), removes a
+ *	random half of them and fills it again, which leaves the free
+ *	space in many pieces.  Then it does nops (default 2000) rounds of
+ *	removing a random file and creating another one, growing each new
+ *	file in four steps the way a file being written grows.  Space is
+ *	allocated with F_PREALLOCATE, so no data is written; each call is
+ *	timed, and the latencies are what is reported.  -c asks for every
+ *	step to be contiguous.  -k keeps the files.
+ *
+ *		newfs_hfs /dev/rsd1a		(the scratch disk image)
+ *		mount -t hfs /dev/sd1a /mnt
+ *		Alloc-bench /mnt
+ *
+ *	The vfs.hfs.allocstats counts printed at the end say how many
+ *	allocations the measured rounds made, how many of them started a
+ *	new extent rather than growing the file in place (so how many
+ *	pieces each new file is in), how many searched the bitmap and how
+ *	many times the free extent summary was built.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/param.h>
+#include <sys/mount.h>
+#ifdef NeXT
+#include <sys/sysctl.h>
+#endif
+
+#define	NSTEPS	4		/* F_PREALLOCATE calls per new file */
+
+static char	*pgmname;
+static char	*top;
+static int	fill = 90;
+static int	maxkb = 256;
+static int	nops = 2000;
+static int	contig;
+
+static int	*sizes;		/* sizes[i] is file i's size in K, 0 if none */
+static int	nfiles;		/* entries in sizes */
+static int	maxfiles;	/* space for them */
+
+static void
+usage()
+{
+	fprintf(stderr,
+	    "usage: %s [-f fill] [-s maxkb] [-n nops] [-S seed] [-c] [-k] dir\n",
+	    pgmname);
+	exit(1);
+}
+
+static double
+now()
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+static void
+report(what, count, start)
+	char	*what;
+	int	count;
+	double	start;
+{
+	double	elapsed = now() - start;
+
+	printf("%-8s %8d in %7.2fs, %8.0f/s\n", what, count, elapsed,
+	    elapsed > 0 ? count / elapsed : 0.0);
+	fflush(stdout);
+}
+
+static void
+fail(what, path)
+	char	*what, *path;
+{
+	fprintf(stderr, "%s: %s %s: %s\n", pgmname, what, path,
+	    strerror(errno));
+	exit(1);
+}
+
+/*
+ * Percentage of the volume in use.
+ */
+static int
+used()
+{
+	struct statfs	sfs;
+
+	if (statfs(top, &sfs) < 0)
+		fail("statfs", top);
+	return (100 - (int)((double)sfs.f_bfree * 100 / sfs.f_blocks));
+}
+
+/*
+ * Grow the open file fd by len bytes past what is already allocated to
+ * it.  Returns the time the call took in microseconds, or -1 if the
+ * volume had no room for it.
+ */
+static double
+grow(fd, len, path)
+	int	fd;
+	off_t	len;
+	char	*path;
+{
+	fstore_t	fst;
+	double		start;
+
+	fst.fst_flags = contig ? (F_ALLOCATECONTIG | F_ALLOCATEALL) : 0;
+	fst.fst_posmode = F_PEOFPOSMODE;
+	fst.fst_offset = 0;
+	fst.fst_length = len;
+	fst.fst_bytesalloc = 0;
+	start = now();
+	if (fcntl(fd, F_PREALLOCATE, &fst) < 0) {
+		if (errno == ENOSPC)
+			return (-1);
+		fail("F_PREALLOCATE", path);
+	}
+	return ((now() - start) * 1e6);
+}
+
+/*
+ * Create file i with a random size, allocating it in nsteps pieces.
+ * Latencies go in lat, if it isn't NULL.  Returns 0 if the volume
+ * filled up first.
+ */
+static int
+create(i, nsteps, lat)
+	int	i, nsteps;
+	double	*lat;
+{
+	char	path[1024];
+	int	fd, kb, step;
+	double	t;
+
+	kb = 1 + random() % maxkb;
+	sprintf(path, "%s/a%d", top, i);
+	if ((fd = open(path, O_CREAT | O_EXCL | O_WRONLY, 0644)) < 0)
+		fail("create", path);
+	for (step = 0; step < nsteps; step++) {
+		t = grow(fd, (off_t)(kb * 1024 / nsteps + 1), path);
+		if (t < 0)
+			break;
+		if (lat != NULL)
+			lat[step] = t;
+	}
+	close(fd);
+	if (step < nsteps) {
+		if (unlink(path) < 0)
+			fail("unlink", path);
+		return (0);
+	}
+	sizes[i] = kb;
+	return (1);
+}
+
+static void
+remove_file(i)
+	int	i;
+{
+	char	path[1024];
+
+	sprintf(path, "%s/a%d", top, i);
+	if (unlink(path) < 0)
+		fail("unlink", path);
+	sizes[i] = 0;
+}
+
+/*
+ * Create files until the volume is fill percent full.  Returns the
+ * number created.
+ */
+static int
+fillup()
+{
+	int	i, count = 0;
+
+	for (i = 0; used() < fill; i++) {
+		if (i == maxfiles) {
+			maxfiles = maxfiles ? maxfiles * 2 : 1024;
+			sizes = realloc(sizes, maxfiles * sizeof (int));
+			if (sizes == NULL)
+				fail("realloc", "");
+			memset(sizes + i, 0, (maxfiles - i) * sizeof (int));
+		}
+		if (sizes[i] != 0)
+			continue;
+		if (!create(i, 1, NULL))
+			break;
+		if (i >= nfiles)
+			nfiles = i + 1;
+		count++;
+	}
+	return (count);
+}
+
+static int
+compare(a, b)
+	const void	*a, *b;
+{
+	double	x = *(const double *)a, y = *(const double *)b;
+
+	return (x < y ? -1 : x > y);
+}
+
+#ifdef NeXT
+/*
+ * Same as HFS_ALLOCSTATS and struct hfs_allocstats in the kernel's
+ * hfs.h, which is private.
+ */
+#define	HFS_ALLOCSTATS	2
+
+struct allocstats {
+	u_long	allocs, blocks, newextents, searches, builds;
+};
+
+static int		hfs_typenum = -1;
+static struct allocstats	as_before;
+static int		as_valid;
+
+static void
+find_hfs()
+{
+	struct vfsconf	vfc;
+	int		mib[4], maxtypenum, i;
+	size_t		len;
+
+	mib[0] = CTL_VFS;
+	mib[1] = VFS_GENERIC;
+	mib[2] = VFS_MAXTYPENUM;
+	len = sizeof (maxtypenum);
+	if (sysctl(mib, 3, &maxtypenum, &len, NULL, 0) < 0)
+		return;
+	mib[2] = VFS_CONF;
+	for (i = 0; i < maxtypenum; i++) {
+		mib[3] = i;
+		len = sizeof (vfc);
+		if (sysctl(mib, 4, &vfc, &len, NULL, 0) < 0)
+			continue;
+		if (strcmp(vfc.vfc_name, "hfs") == 0) {
+			hfs_typenum = vfc.vfc_typenum;
+			return;
+		}
+	}
+}
+
+static int
+hfs_stats_get(as)
+	struct allocstats	*as;
+{
+	int	mib[3];
+	size_t	len = sizeof (*as);
+
+	if (hfs_typenum < 0)
+		return (-1);
+	mib[0] = CTL_VFS;
+	mib[1] = hfs_typenum;
+	mib[2] = HFS_ALLOCSTATS;
+	return (sysctl(mib, 3, as, &len, NULL, 0));
+}
+
+static void
+stats_begin()
+{
+	find_hfs();
+	as_valid = (hfs_stats_get(&as_before) == 0);
+}
+
+static void
+stats_end(created)
+	int	created;
+{
+	struct allocstats	a, *b = &as_before;
+	u_long			allocs, newextents;
+
+	if (!as_valid || hfs_stats_get(&a) < 0) {
+		printf("allocation counts not available\n");
+		return;
+	}
+	allocs = a.allocs - b->allocs;
+	newextents = a.newextents - b->newextents;
+	printf("alloc:      %lu allocations, %lu blocks, %lu new extents\n",
+	    allocs, a.blocks - b->blocks, newextents);
+	if (created > 0 && newextents > 0)
+		printf("            %.2f extents per new file, "
+		    "%.1f blocks per extent\n", (double)newextents / created,
+		    (double)(a.blocks - b->blocks) / newextents);
+	printf("            %lu bitmap searches, %lu summary builds\n",
+	    a.searches - b->searches, a.builds - b->builds);
+}
+#else
+#define	stats_begin()
+#define	stats_end(created)
+#endif
+
+int
+main(argc, argv)
+	int	argc;
+	char	**argv;
+{
+	double		start, *lat, sum;
+	int		ch, i, n, op, created, nlat, full, keep = 0;
+
+	pgmname = argv[0];
+	srandom(1);
+	while ((ch = getopt(argc, argv, "f:s:n:S:ck")) != EOF) {
+		switch (ch) {
+		case 'f':
+			fill = atoi(optarg);
+			break;
+		case 's':
+			maxkb = atoi(optarg);
+			break;
+		case 'n':
+			nops = atoi(optarg);
+			break;
+		case 'S':
+			srandom(atoi(optarg));
+			break;
+		case 'c':
+			contig = 1;
+			break;
+		case 'k':
+			keep = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (argc != 1 || fill <= 0 || fill >= 100 || maxkb <= 0 || nops <= 0)
+		usage();
+	top = argv[0];
+
+	/*
+	 * Fill the volume, then punch holes in it and fill it again.
+	 */
+	start = now();
+	n = fillup();
+	report("fill", n, start);
+
+	start = now();
+	for (i = n = 0; i < nfiles; i++)
+		if (sizes[i] != 0 && (random() & 1)) {
+			remove_file(i);
+			n++;
+		}
+	n += fillup();
+	report("age", n, start);
+	printf("%d files, volume %d%% full\n", nfiles, used());
+	sync();
+
+	/*
+	 * The measured rounds.
+	 */
+	if ((lat = malloc(nops * NSTEPS * sizeof (double))) == NULL)
+		fail("malloc", "");
+	nlat = created = full = 0;
+
+	stats_begin();
+
+	start = now();
+	for (op = 0; op < nops; op++) {
+		do
+			i = random() % nfiles;
+		while (sizes[i] == 0);
+		remove_file(i);
+		if (create(i, NSTEPS, lat + nlat)) {
+			nlat += NSTEPS;
+			created++;
+		} else
+			full++;
+	}
+	report("rounds", nops, start);
+
+	stats_end(created);
+
+	if (nlat > 0) {
+		qsort(lat, nlat, sizeof (double), compare);
+		for (i = 0, sum = 0; i < nlat; i++)
+			sum += lat[i];
+		printf("latency:    %d allocations, mean %.0fus, median %.0fus, "
+		    "99%% %.0fus, max %.0fus\n", nlat, sum / nlat,
+		    lat[nlat / 2], lat[nlat * 99 / 100], lat[nlat - 1]);
+	}
+	if (full > 0)
+		printf("            %d new files did not fit\n", full);
+
+	if (keep)
+		exit(0);
+	for (i = 0; i < nfiles; i++)
+		if (sizes[i] != 0)
+			remove_file(i);
+	exit(0);
+}
@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * "Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.0 (the 'License').  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License."
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *	Catalog-bench - HFS catalog enumeration.
+ *
+ *	Catalog-bench [-d ndirs] [-n nfiles] [-r rounds] [-p | -e] dir
+ *
+ *	Fills dir, which should be on an HFS or HFS Plus volume, with
+ *	ndirs folders (default 50) of nfiles files each (default 400),
+ *	then enumerates them rounds times (default 3) the way "ls -lR"
+ *	does: every folder is read with readdir() and every entry in it
+ *	is lstat()ed.  Finally everything is removed.  Each phase is
+ *	timed.  Reading a folder walks its run of leaf records in the
+ *	catalog B-tree; each lstat() looks one up.
+ *
+ *	-p only fills dir and -e only enumerates what -p left there, so
+ *	the enumeration can be measured with nothing in the buffer cache:
+ *
+ *		newfs_hfs /dev/rsd1a		(the scratch disk image)
+ *		mount -t hfs /dev/sd1a /mnt
+ *		Catalog-bench -p /mnt
+ *		umount /mnt; mount -t hfs /dev/sd1a /mnt
+ *		Catalog-bench -e -r 1 /mnt
+ *
+ *	The vfs.hfs.btreestats counts printed at the end show how many
+ *	catalog and extents B-tree nodes were asked for, how many were
+ *	found in the buffer cache and how many had to be read, and how
+ *	many leaf nodes were read ahead while iterating.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#ifdef NeXT
+#include <sys/sysctl.h>
+#include <sys/mount.h>
+#endif
+
+static char	*pgmname;
+static int	ndirs = 50;
+static int	nfiles = 400;
+static int	rounds = 3;
+
+static void
+usage()
+{
+	fprintf(stderr,
+	    "usage: %s [-d ndirs] [-n nfiles] [-r rounds] [-p | -e] dir\n",
+	    pgmname);
+	exit(1);
+}
+
+static double
+now()
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+static void
+report(what, count, start)
+	char	*what;
+	int	count;
+	double	start;
+{
+	double	elapsed = now() - start;
+
+	printf("%-8s %8d in %7.2fs, %8.0f/s\n", what, count, elapsed,
+	    elapsed > 0 ? count / elapsed : 0.0);
+	fflush(stdout);
+}
+
+static void
+fail(what, path)
+	char	*what, *path;
+{
+	fprintf(stderr, "%s: %s %s: %s\n", pgmname, what, path,
+	    strerror(errno));
+	exit(1);
+}
+
+#ifdef NeXT
+/*
+ * Same as HFS_BTREESTATS and struct hfs_btreestats in the kernel's
+ * hfs.h, which is private.
+ */
+#define	HFS_BTREESTATS	1
+
+struct treestats {
+	u_long	gets, hits, misses, readaheads;
+};
+
+struct btreestats {
+	struct treestats	catalog, extents;
+};
+
+static int	hfs_typenum = -1;
+
+static void
+find_hfs()
+{
+	struct vfsconf	vfc;
+	int		mib[4], maxtypenum, i;
+	size_t		len;
+
+	mib[0] = CTL_VFS;
+	mib[1] = VFS_GENERIC;
+	mib[2] = VFS_MAXTYPENUM;
+	len = sizeof (maxtypenum);
+	if (sysctl(mib, 3, &maxtypenum, &len, NULL, 0) < 0)
+		return;
+	mib[2] = VFS_CONF;
+	for (i = 0; i < maxtypenum; i++) {
+		mib[3] = i;
+		len = sizeof (vfc);
+		if (sysctl(mib, 4, &vfc, &len, NULL, 0) < 0)
+			continue;
+		if (strcmp(vfc.vfc_name, "hfs") == 0) {
+			hfs_typenum = vfc.vfc_typenum;
+			return;
+		}
+	}
+}
+
+static int
+hfs_stats_get(bs)
+	struct btreestats	*bs;
+{
+	int	mib[3];
+	size_t	len = sizeof (*bs);
+
+	if (hfs_typenum < 0)
+		return (-1);
+	mib[0] = CTL_VFS;
+	mib[1] = hfs_typenum;
+	mib[2] = HFS_BTREESTATS;
+	return (sysctl(mib, 3, bs, &len, NULL, 0));
+}
+
+static struct btreestats	bt_before;
+static int			bt_valid;
+
+static void
+stats_begin()
+{
+	find_hfs();
+	bt_valid = (hfs_stats_get(&bt_before) == 0);
+}
+
+static void
+print_tree(what, a, b)
+	char			*what;
+	struct treestats	*a, *b;
+{
+	printf("%-10s %8lu nodes, %8lu cached, %8lu read, %8lu read ahead\n",
+	    what, a->gets - b->gets, a->hits - b->hits,
+	    a->misses - b->misses, a->readaheads - b->readaheads);
+}
+
+static void
+stats_end()
+{
+	struct btreestats	a;
+
+	if (!bt_valid || hfs_stats_get(&a) < 0) {
+		printf("B-tree node counts not available\n");
+		return;
+	}
+	print_tree("catalog:", &a.catalog, &bt_before.catalog);
+	print_tree("extents:", &a.extents, &bt_before.extents);
+}
+#else
+#define	stats_begin()
+#define	stats_end()
+#endif
+
+/*
+ * Read every folder under top and lstat everything in it.  Returns the
+ * number of entries seen.
+ */
+static int
+enumerate(top)
+	char	*top;
+{
+	char		path[1024];
+	struct stat	st;
+	struct dirent	*dp, *fp;
+	DIR		*tdir, *dir;
+	int		count = 0;
+
+	if ((tdir = opendir(top)) == NULL)
+		fail("opendir", top);
+	while ((dp = readdir(tdir)) != NULL) {
+		if (dp->d_name[0] != 'c')
+			continue;
+		sprintf(path, "%s/%s", top, dp->d_name);
+		if ((dir = opendir(path)) == NULL)
+			fail("opendir", path);
+		while ((fp = readdir(dir)) != NULL) {
+			if (fp->d_name[0] == '.')
+				continue;
+			sprintf(path, "%s/%s/%s", top, dp->d_name, fp->d_name);
+			if (lstat(path, &st) < 0)
+				fail("lstat", path);
+			count++;
+		}
+		closedir(dir);
+	}
+	closedir(tdir);
+	return (count);
+}
+
+int
+main(argc, argv)
+	int	argc;
+	char	**argv;
+{
+	char		path[1024];
+	double		start;
+	int		ch, d, i, r, fd, count;
+	int		populate = 1, enumonly = 0, keep = 0;
+	char		*top;
+
+	pgmname = argv[0];
+	while ((ch = getopt(argc, argv, "d:n:r:pe")) != EOF) {
+		switch (ch) {
+		case 'd':
+			ndirs = atoi(optarg);
+			break;
+		case 'n':
+			nfiles = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		case 'p':
+			keep = 1;
+			break;
+		case 'e':
+			populate = 0;
+			enumonly = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (argc != 1 || ndirs <= 0 || nfiles <= 0 || rounds < 0 ||
+	    (keep && enumonly))
+		usage();
+	top = argv[0];
+
+	if (populate) {
+		start = now();
+		for (d = 0; d < ndirs; d++) {
+			sprintf(path, "%s/c%d", top, d);
+			if (mkdir(path, 0755) < 0)
+				fail("mkdir", path);
+			for (i = 0; i < nfiles; i++) {
+				sprintf(path, "%s/c%d/catalog entry %d", top,
+				    d, i);
+				if ((fd = open(path, O_CREAT | O_EXCL | O_WRONLY,
+				    0644)) < 0)
+					fail("create", path);
+				close(fd);
+			}
+		}
+		report("create", ndirs * nfiles, start);
+		sync();
+		if (keep)
+			exit(0);
+	}
+
+	stats_begin();
+
+	count = 0;
+	start = now();
+	for (r = 0; r < rounds; r++)
+		count += enumerate(top);
+	report("enum", count, start);
+
+	stats_end();
+
+	if (enumonly)
+		exit(0);
+
+	start = now();
+	for (d = 0; d < ndirs; d++) {
+		for (i = 0; i < nfiles; i++) {
+			sprintf(path, "%s/c%d/catalog entry %d", top, d, i);
+			if (unlink(path) < 0)
+				fail("unlink", path);
+		}
+		sprintf(path, "%s/c%d", top, d);
+		if (rmdir(path) < 0)
+			fail("rmdir", path);
+	}
+	report("unlink", ndirs * nfiles, start);
+	exit(0);
+}
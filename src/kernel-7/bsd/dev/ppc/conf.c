@@ -146,6 +146,15 @@ extern int	ptcopen(),ptcclose(),ptcread(),ptcwrite(),ptcselect(),
 extern int	logopen(),logclose(),logread(),logioctl(),logselect();
 extern int	nvopen(), nvclose(), nvread(), nvwrite();
 
+#include <kdebug.h>
+#if KDEBUG
+extern int	kdbgopen(), kdbgclose(), kdbgread();
+#else
+#define	kdbgopen	eno_opcl
+#define	kdbgclose	eno_opcl
+#define	kdbgread	eno_rdwrt
+#endif
+
 extern int	seltrue();
 
 struct cdevsw	cdevsw[] =
@@ -217,7 +226,11 @@ struct cdevsw	cdevsw[] =
 	eno_ioctl,	nulldev,	nulldev,	0,		eno_select,
 	eno_mmap,	eno_strat,	eno_getc,	eno_putc,	0
     },
-    NO_CDEVICE,								/*18*/
+    {
+	kdbgopen,	kdbgclose,	kdbgread,	eno_rdwrt,	/*18*/
+	eno_ioctl,	nulldev,	nulldev,	0,		eno_select,
+	eno_mmap,	eno_strat,	eno_getc,	eno_putc,	0
+    },
     NO_CDEVICE,								/*19*/
     NO_CDEVICE,								/*20*/
     NO_CDEVICE,								/*21*/
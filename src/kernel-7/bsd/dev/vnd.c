@@ -275,6 +275,7 @@ vndstrategy(bp)
 //		nbp = getvndbuf();
 		MALLOC(nbp, struct vndbuf *, sizeof(struct vndbuf),M_DEVBUF, M_WAITOK);
 		nbp->vb_buf.b_flags = flags;
+		LIST_INIT(&nbp->vb_buf.b_dep);
 		nbp->vb_buf.b_bcount = sz;
 		nbp->vb_buf.b_bufsize = bp->b_bufsize;
 		nbp->vb_buf.b_error = 0;
@@ -120,6 +120,44 @@ struct hfslockf;		// For advisory locking
  */
 #define	FORCE_READONLY	0
 
+/*
+ *	Names for the vfs.hfs sysctl.
+ */
+#define	HFS_BTREESTATS	1	/* struct hfs_btreestats */
+#define	HFS_ALLOCSTATS	2	/* struct hfs_allocstats */
+#define	HFS_MAXID		3
+
+/*
+ *	B-tree node counts, summed over the mounted HFS volumes.  A hit is a
+ *	node GetNode found in the buffer cache, a miss one it had to read;
+ *	read-aheads are the right siblings started by iterations.
+ */
+struct hfs_treestats {
+	u_long	hts_gets;			/* nodes asked for */
+	u_long	hts_hits;			/* ... found in the cache */
+	u_long	hts_misses;			/* ... read from disk */
+	u_long	hts_readaheads;		/* leaf nodes read ahead */
+};
+
+struct hfs_btreestats {
+	struct hfs_treestats	hbs_catalog;
+	struct hfs_treestats	hbs_extents;
+};
+
+/*
+ *	Allocation counts, summed over the mounted HFS volumes.  A new extent
+ *	is an allocation that could not continue where the file left off;
+ *	searches are allocations made from the bitmap because there was no
+ *	memory for the volume's free extent summary.
+ */
+struct hfs_allocstats {
+	u_long	has_allocs;			/* allocations */
+	u_long	has_blocks;			/* allocation blocks allocated */
+	u_long	has_newextents;		/* allocations starting a new extent */
+	u_long	has_searches;		/* allocations that searched the bitmap */
+	u_long	has_builds;			/* free extent summaries built */
+};
+
 enum { kMDBSize = 512 };				/* Size of I/O transfer to read entire MDB */
 
 enum { kMasterDirectoryBlock = 2 };			/* MDB offset on disk in 512-byte blocks */
@@ -560,6 +598,8 @@ short hfsUnmount(struct hfsmount *hfsmp, struct proc *p);
 
 extern int hfs_metafilelocking(struct hfsmount *hfsmp, u_long fileID, u_int flags, struct proc *p);
 extern int hasOverflowExtents(struct hfsnode *hp);
+extern void hfs_addbtreestats(struct hfsmount *hfsmp, struct hfs_btreestats *stats);
+extern void hfs_addallocstats(struct hfsmount *hfsmp, struct hfs_allocstats *stats);
 
 short MacToVFSError(OSErr err);
 void MapFileOffset(struct hfsnode *hp, off_t filePosition, daddr_t *logBlockNumber, long *blockSize, long *blockOffset);
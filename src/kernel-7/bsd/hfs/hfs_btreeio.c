@@ -75,6 +75,20 @@ OSStatus GetBTreeBlock(FileReference vp, UInt32 blockNum, GetBlockOptions option
 
 //	DBG_TREE(("GetBlockProc: block=%ld, blockSize=%ld\n", blockNum, block->blockSize));
 
+    if (options & kReadAheadBlock) {
+        /*
+         * Only start the read; blockReadFromDisk tells the caller
+         * whether one was needed.
+         */
+        block->blockReadFromDisk = bio_readahead (vp,
+                    IOBLKNOFORBLK(blockNum, VTOHFS(vp)->hfs_phys_block_size),
+                    IOBYTECCNTFORBLK(blockNum, block->blockSize, VTOHFS(vp)->hfs_phys_block_size),
+                    NOCRED);
+        block->blockHeader = NULL;
+        block->buffer = NULL;
+        return (E_NONE);
+    }
+
     if (options & kGetEmptyBlock)
         bp = getblk (vp,
                     IOBLKNOFORBLK(blockNum, VTOHFS(vp)->hfs_phys_block_size),
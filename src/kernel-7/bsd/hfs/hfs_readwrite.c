@@ -148,6 +148,8 @@ int bexpand(struct buf *bp, int newsize, struct buf **nbpp, long flags);
 void debug_check_blocksizes(struct vnode *vp);
 #endif
 
+static int hfs_breadra(struct hfsnode *hp, off_t blockOffset, daddr_t logBlockNo, long blockSize, struct buf **bpp);
+
 /*****************************************************************************
 *
 *	Operations on vnodes
@@ -187,6 +189,7 @@ struct vop_read_args /* {
 	FCB						*fcb;
     Boolean 				firstpass;		/* Used for cluster reading */
     int 					seq;			/* Also used for cluster reading */
+    int 					rastride;		/* Scan stride seen by read-ahead */
 
     DBG_FUNC_NAME("hfs_read");
     DBG_VOP_LOCKS_DECL(1);
@@ -267,21 +270,15 @@ struct vop_read_args /* {
             break;
         };
         DBG_VOP(("\tat logBlockNo Ox%X, extent of Ox%lX, xfer of Ox%lX; moveSize = Ox%lX\n", logBlockNo, fragSize, ioxfersize, moveSize));
+        rastride = bio_ratrack(vp, logBlockNo);
         if (( uio->uio_offset + fragSize) >= fcb->fcbEOF) {
             retval = bread(vp, logBlockNo, ioxfersize, NOCRED, &bp);
-        } else if (doclusterread && !(vp->v_flag & VRAOFF) && can_cluster(fragSize)) {
+        } else if (doclusterread && !(vp->v_flag & VRAOFF) && can_cluster(fragSize) &&
+                   (rastride == 0 || rastride == 1)) {
             retval = cluster_read(vp, fcb->fcbEOF, logBlockNo, ioxfersize, NOCRED, &bp,
 						   devBlockSize, firstpass, (uio->uio_resid + startOffset), &seq);
-        } else if (logBlockNo - 1 == vp->v_lastr && !(vp->v_flag & VRAOFF)) {
-            daddr_t nextLogBlockNo = logBlockNo + 1;
-            long nextsize;
-            int nextsize_for_bsd;
-            long nextblkoffset;
-
-            MapFileOffset(hp, uio->uio_offset + fragSize, &nextLogBlockNo, &nextsize, &nextblkoffset);
-            /* Yuck!  This copy exists just because I refuse to write the interface to MapFileOffset relying on 'int' to be 'long'... */
-            nextsize_for_bsd = nextsize;
-            retval = breadn(vp, logBlockNo, ioxfersize, &nextLogBlockNo, &nextsize_for_bsd, 1, NOCRED, &bp);
+        } else if (rastride != 0) {
+            retval = hfs_breadra(hp, uio->uio_offset - startOffset, logBlockNo, ioxfersize, &bp);
         } else {
             retval = bread(vp, logBlockNo, ioxfersize, NOCRED, &bp);
         };
@@ -372,6 +369,38 @@ struct vop_read_args /* {
     return (retval);
 }
 
+/*
+ * Read a block with adaptive read-ahead (see vfs_bio.c).  The read-ahead
+ * code deals in logical block numbers, which only map to file offsets
+ * while the logical block size stays the same, so read-ahead stops at
+ * the first block that MapFileOffset() does not place where expected.
+ */
+static int
+hfs_breadra(struct hfsnode *hp, off_t blockOffset, daddr_t logBlockNo, long blockSize, struct buf **bpp)
+{
+    struct vnode *vp = HTOV(hp);
+    daddr_t rablks[BIO_RAMAX];
+    int rasizes[BIO_RAMAX];
+    daddr_t lastblk, rablockNo;
+    off_t raOffset;
+    long rasize, raBlockOffset;
+    int i, n;
+
+    lastblk = logBlockNo + (HTOFCB(hp)->fcbEOF - blockOffset) / blockSize - 1;
+    n = bio_rablocks(vp, logBlockNo, lastblk, rablks, BIO_RAMAX);
+    for (i = 0; i < n; i++) {
+        raOffset = blockOffset + (off_t)(rablks[i] - logBlockNo) * blockSize;
+        if (raOffset < 0)
+            break;
+        MapFileOffset(hp, raOffset, &rablockNo, &rasize, &raBlockOffset);
+        if (rablockNo != rablks[i] || rasize != blockSize || raBlockOffset != 0)
+            break;
+        rasizes[i] = rasize;
+    };
+
+    return (breadn(vp, logBlockNo, blockSize, rablks, rasizes, i, NOCRED, bpp));
+}
+
 /*
  * Write data to a file or directory.
 #% write	vp	L L L
@@ -403,7 +432,7 @@ struct vop_write_args /* {
     long				devBlockSize = 0;
     daddr_t 			logBlockNo;
     long				fragSize;
-    off_t 				origFileSize, currOffset, writelimit, bytesToAdd;
+    off_t 				origFileSize, origEOF, currOffset, writelimit, bytesToAdd;
     u_long				blkoffset, resid, xfersize, clearSize;				
     UInt32				actualBytesAdded;
     int					flags, ioflag;
@@ -472,6 +501,7 @@ struct vop_write_args /* {
 
     resid = uio->uio_resid;
     origFileSize = fcb->fcbPLen;
+    origEOF = fcb->fcbEOF;
     flags = ioflag & IO_SYNC ? B_SYNC : 0;
 
     DBG_VOP(("\tLEOF is 0x%lX, PEOF is 0x%lX.\n", fcb->fcbEOF, fcb->fcbPLen));
@@ -691,6 +721,8 @@ struct vop_write_args /* {
             break;
         hp->h_meta->h_nodeflags |= IN_CHANGE | IN_UPDATE;
     };
+    if (resid > uio->uio_resid)
+        VN_KNOTE(vp, NOTE_WRITE | ((off_t)fcb->fcbEOF > origEOF ? NOTE_EXTEND : 0));
     /*
     * If we successfully wrote any data, and we are not the superuser
     * we clear the setuid and setgid bits as a precaution against
@@ -103,6 +103,7 @@
 #include <sys/malloc.h>
 #include <sys/fcntl.h>
 #include <sys/stat.h>
+#include <sys/sysctl.h>
 #include <libkern/libkern.h>
 #include <bsd/dev/disk.h>
 #include <mach/machine/simple_lock.h>
@@ -235,6 +236,13 @@ struct proc             *p;
                 hfsmp->hfs_fs_ronly = 0;
                 goto error_exit;
             }
+
+            /*
+             * The bitmap may be changed (by fsck) while the volume is
+             * read-only; rebuild the free extent summary when it is next
+             * written.
+             */
+            DisposeFreeExtents(HFSTOVCB(hfsmp));
         }
 
         if ((mp->mnt_flag & MNT_RELOAD) &&
@@ -1051,10 +1059,55 @@ void *newp;
 size_t newlen;
 struct proc *p;
 {
+    extern struct vfsops hfs_vfsops;
+    struct hfs_btreestats stats;
+    struct hfs_allocstats astats;
+    struct mount *mp, *nmp;
     DBG_FUNC_NAME("hfs_sysctl");
     DBG_PRINT_FUNC_NAME();
 
-    return (EOPNOTSUPP);
+    /* all sysctl names at this level are terminal */
+    if (namelen != 1)
+        return (ENOTDIR);		/* overloaded */
+
+    switch (name[0]) {
+    case HFS_BTREESTATS:
+        bzero(&stats, sizeof(stats));
+        simple_lock(&mountlist_slock);
+        for (mp = mountlist.cqh_first; mp != (void *)&mountlist; mp = nmp) {
+            if (vfs_busy(mp, LK_NOWAIT, &mountlist_slock, p)) {
+                nmp = mp->mnt_list.cqe_next;
+                continue;
+            }
+            if (mp->mnt_op == &hfs_vfsops)
+                hfs_addbtreestats(VFSTOHFS(mp), &stats);
+            simple_lock(&mountlist_slock);
+            nmp = mp->mnt_list.cqe_next;
+            vfs_unbusy(mp, p);
+        }
+        simple_unlock(&mountlist_slock);
+        return (sysctl_rdstruct(oldp, oldlenp, newp, &stats, sizeof(stats)));
+
+    case HFS_ALLOCSTATS:
+        bzero(&astats, sizeof(astats));
+        simple_lock(&mountlist_slock);
+        for (mp = mountlist.cqh_first; mp != (void *)&mountlist; mp = nmp) {
+            if (vfs_busy(mp, LK_NOWAIT, &mountlist_slock, p)) {
+                nmp = mp->mnt_list.cqe_next;
+                continue;
+            }
+            if (mp->mnt_op == &hfs_vfsops)
+                hfs_addallocstats(VFSTOHFS(mp), &astats);
+            simple_lock(&mountlist_slock);
+            nmp = mp->mnt_list.cqe_next;
+            vfs_unbusy(mp, p);
+        }
+        simple_unlock(&mountlist_slock);
+        return (sysctl_rdstruct(oldp, oldlenp, newp, &astats, sizeof(astats)));
+
+    default:
+        return (EOPNOTSUPP);
+    }
 }
 
 /*	This will return a vnode or either a directory or a data vnode based on an object id. If
@@ -146,6 +146,8 @@ static int InitMetaFileVNode(struct vnode *vp, u_long eof, u_long clumpSize, voi
 
 static void ReleaseMetaFileVNode(struct vnode *vp);
 
+static UInt32 HintCacheSize(u_long catalogSize);
+
 
 //*******************************************************************************
 //	Routine:	hfs_MountHFSVolume
@@ -189,7 +191,7 @@ OSErr	hfs_MountHFSVolume( register struct hfsmount *hfsmp, HFSMasterDirectoryBlo
 
 
     //	Initialize our dirID/nodePtr cache associated with this volume.
-    err = InitMRUCache( sizeof(UInt32), kDefaultNumMRUCacheBlocks, &(vcb->hintCachePtr) );
+    err = InitMRUCache( sizeof(UInt32), HintCacheSize(mdb->drCTFlSize), &(vcb->hintCachePtr) );
     ReturnIfError( err );
 
 	/*
@@ -371,7 +373,7 @@ OSErr hfs_MountHFSPlusVolume( register struct hfsmount *hfsmp, HFSPlusVolumeHead
 		vcb->vcbAtrb |= kHFSVolumeNoCacheRequiredMask;		//	yes:mark VCB as a RAM Disk
 
     //	Initialize our dirID/nodePtr cache associated with this volume.
-    retval = InitMRUCache( sizeof(UInt32), kDefaultNumMRUCacheBlocks, &(vcb->hintCachePtr) );
+    retval = InitMRUCache( sizeof(UInt32), HintCacheSize(vhp->catalogFile.logicalSize.lo), &(vcb->hintCachePtr) );
     if (retval != noErr) goto ErrorExit;
 
 	/*
@@ -589,6 +591,25 @@ static int InitMetaFileVNode(struct vnode *vp, u_long eof, u_long clumpSize, voi
 }
 
 
+/*
+ * Size a volume's dirID/node hint cache by its catalog, since a bigger
+ * catalog has more folders worth remembering: one hint for every 8K of
+ * catalog B-tree, between the default and kMaxNumMRUCacheBlocks.
+ */
+static UInt32 HintCacheSize(u_long catalogSize)
+{
+    UInt32	numBlocks;
+
+    numBlocks = catalogSize / 8192;
+    if (numBlocks < kDefaultNumMRUCacheBlocks)
+        numBlocks = kDefaultNumMRUCacheBlocks;
+    else if (numBlocks > kMaxNumMRUCacheBlocks)
+        numBlocks = kMaxNumMRUCacheBlocks;
+
+    return (numBlocks);
+}
+
+
 /*************************************************************
 *
 * Unmounts a hfs volume.
@@ -602,6 +623,7 @@ short hfsUnmount( register struct hfsmount *hfsmp, struct proc *p)
     int			retval = E_NONE;
 
 	(void) DisposeMRUCache(vcb->hintCachePtr);
+	DisposeFreeExtents(vcb);
 	InvalidateCatalogCache( vcb );
 	// XXX PPD: Should dispose of any allocated volume cache here: call DisposeVolumeCacheBlocks( vcb )?
 
@@ -993,6 +1015,48 @@ int hfs_metafilelocking(struct hfsmount *hfsmp, u_long fileID, u_int flags, stru
 }
 
 
+static void AddTreeStats(struct vnode *vp, struct hfs_treestats *ts)
+{
+	BTreeControlBlockPtr	btcb;
+
+	if (vp == NULL || (btcb = (BTreeControlBlockPtr) VTOFCB(vp)->fcbBTCBPtr) == NULL)
+		return;
+
+	ts->hts_gets		+= btcb->numGetNodes;
+	ts->hts_hits		+= btcb->numNodeHits;
+	ts->hts_misses		+= btcb->numNodeMisses;
+	ts->hts_readaheads	+= btcb->numReadAheads;
+}
+
+/*
+ * Add a volume's catalog and extents B-tree node counts to stats, for the
+ * vfs.hfs.btreestats sysctl.  The counts are only read, so the B-trees
+ * are not locked.
+ */
+void hfs_addbtreestats(struct hfsmount *hfsmp, struct hfs_btreestats *stats)
+{
+	ExtendedVCB		*vcb = HFSTOVCB(hfsmp);
+
+	AddTreeStats(vcb->catalogRefNum, &stats->hbs_catalog);
+	AddTreeStats(vcb->extentsRefNum, &stats->hbs_extents);
+}
+
+/*
+ * Add a volume's allocation counts to stats, for the vfs.hfs.allocstats
+ * sysctl.
+ */
+void hfs_addallocstats(struct hfsmount *hfsmp, struct hfs_allocstats *stats)
+{
+	AllocationStats	*as = &HFSTOVCB(hfsmp)->allocStats;
+
+	stats->has_allocs		+= as->allocations;
+	stats->has_blocks		+= as->blocksAllocated;
+	stats->has_newextents	+= as->newExtents;
+	stats->has_searches		+= as->bitmapSearches;
+	stats->has_builds		+= as->summaryBuilds;
+}
+
+
 void CopyVNodeToCatalogNode (struct vnode *vp, struct CatalogNodeData *nodeData)
 {
     ExtendedVCB 			*vcb;
@@ -1974,8 +1974,10 @@ out2:
 
 out:;
 
-    if (! retval)
+    if (! retval) {
    		VTOH(dvp)->h_meta->h_nodeflags |= IN_CHANGE | IN_UPDATE;
+   		VN_KNOTE(vp, NOTE_DELETE);
+    }
 
     if (dvp == vp) {
         VRELE(vp);
@@ -2506,8 +2508,10 @@ struct vop_rmdir_args /* {
 	(void) hfs_metafilelocking(VTOHFS(vp), kHFSCatalogFileID, LK_RELEASE, p);
 
 	/* Set the parent to be updated */
-    if (! retval)
+    if (! retval) {
     	VTOH(dvp)->h_meta->h_nodeflags |= IN_CHANGE | IN_UPDATE;
+    	VN_KNOTE(vp, NOTE_DELETE);
+    }
 
 Err_Exit:;
     if (dvp != 0) 
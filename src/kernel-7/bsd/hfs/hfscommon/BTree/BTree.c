@@ -1159,6 +1159,13 @@ OSStatus	BTIterateRecord		(FCB						*filePtr,
 
 CopyData:
 
+	// just moved forward into a leaf node: start reading its right sibling
+	// so the iteration finds it in the cache when it gets there
+	if ( ((operation == kBTreeFirstRecord) || (operation == kBTreeNextRecord)) && (index == 0) )
+	{
+		(void) ReadAheadNode (btreePtr, ((NodeDescPtr) node.buffer)->fLink);
+	}
+
 	// added check for errors <CS9>
 	err = GetRecordByIndex (btreePtr, node.buffer, index, &keyPtr, &recordPtr, &len);
 	M_ExitOnError (err);
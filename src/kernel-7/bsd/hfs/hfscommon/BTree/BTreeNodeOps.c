@@ -108,6 +108,7 @@
 ///////////////////////// BTree Module Node Operations //////////////////////////
 //
 //	GetNode 			- Call FS Agent to get node
+//	ReadAheadNode		- Ask FS Agent to start reading a node we will want soon
 //	GetNewNode			- Call FS Agent to get a new node
 //	ReleaseNode			- Call FS Agent to release node obtained by GetNode.
 //	UpdateNode			- Mark a node as dirty and call FS Agent to release it.
@@ -225,6 +226,11 @@ OSStatus	GetNode		(BTreeControlBlockPtr	 btreePtr,
 	}
 	++btreePtr->numGetNodes;
 	
+	if ( nodePtr->blockReadFromDisk )
+		++btreePtr->numNodeMisses;
+	else
+		++btreePtr->numNodeHits;
+	
 	//
 	// Optimization
 	// Only call CheckNode if the node came from disk.
@@ -289,6 +295,47 @@ ErrorExit:
 
 
 
+/*-------------------------------------------------------------------------------
+
+Routine:	ReadAheadNode	-	Ask FS Agent to start reading a node we will want soon
+
+Function:	Starts an asynchronous read of a node, typically the right sibling
+			of the leaf node an iteration has just moved to, so that it is in
+			the cache by the time GetNode asks for it.  Nothing is returned;
+			errors are ignored since GetNode will simply read the node itself.
+
+Input:		btreePtr	- pointer to BTree control block
+			nodeNum		- number of node to read ahead
+			
+Result:
+			noErr		- always
+-------------------------------------------------------------------------------*/
+
+OSStatus	ReadAheadNode	(BTreeControlBlockPtr	 btreePtr,
+							 UInt32					 nodeNum )
+{
+#if TARGET_OS_RHAPSODY
+	NodeRec				nodeRec;
+	GetBlockProcPtr		getNodeProc;
+
+	if ( nodeNum == 0 || nodeNum >= btreePtr->totalNodes )
+		return noErr;
+
+	nodeRec.blockSize = btreePtr->nodeSize;
+
+	getNodeProc = btreePtr->getBlockProc;
+	if ( getNodeProc (btreePtr->fileRefNum, nodeNum, kReadAheadBlock, &nodeRec) == noErr &&
+		 nodeRec.blockReadFromDisk )
+		++btreePtr->numReadAheads;
+#else
+#pragma unused (btreePtr, nodeNum)
+#endif
+
+	return noErr;
+}
+
+
+
 /*-------------------------------------------------------------------------------
 
 Routine:	GetNewNode	-	Call FS Agent to get a new node
@@ -72,6 +72,7 @@ enum {
 struct CacheBlock {
 	struct CacheBlock		*nextMRU;					//	next node in MRU order
 	struct CacheBlock		*nextLRU;					//	next node in LRU order
+	struct CacheBlock		*nextHash;					//	next node on the same hash chain
 	UInt32					flags;						//	status flags
 	UInt32					key;						//	comparrison Key
 	char					buffer[1];					//	user defineable data
@@ -82,17 +83,22 @@ struct CacheGlobals {
 	UInt32					cacheBlockSize;				//	Size of CacheBlock structure including the buffer
 	UInt32					cacheBufferSize;			//	Size of cache buffer
 	UInt32					numCacheBlocks;				//	Number of blocks in cache
+	UInt32					hashMask;					//	Number of hash chains - 1
+	CacheBlock				**hashTable;				//	Blocks with valid keys, chained by key
 	CacheBlock				*mru;
 	CacheBlock				*lru;
 };
 typedef struct CacheGlobals CacheGlobals;
 
+#define	CacheHashChain( cacheGlobals, key )		( &(cacheGlobals)->hashTable[ (key) & (cacheGlobals)->hashMask ] )
+
 
 //
 //	Internal routines
 //
 static void InsertAsMRU	( CacheGlobals *cacheGlobals, CacheBlock *cacheBlock );
 static void InsertAsLRU	( CacheGlobals *cacheGlobals, CacheBlock *cacheBlock );
+static void RemoveFromHash	( CacheGlobals *cacheGlobals, CacheBlock *cacheBlock );
 
 
 //
@@ -106,6 +112,10 @@ static void InsertAsLRU	( CacheGlobals *cacheGlobals, CacheBlock *cacheBlock );
 //            \                                           |
 //	           \-----------------------------------------/
 //	CacheGlobals					CacheBlock's
+//
+//	Blocks holding a valid key are also on one of the hashTable chains (linked
+//	through nextHash), so a lookup does not walk the MRU list.  The hash table
+//	sits between the CacheGlobals and the first CacheBlock.
 
 
 
@@ -123,8 +133,14 @@ OSErr	InitMRUCache( UInt32 bufferSize, UInt32 numCacheBlocks, Ptr *cachePtr )
 	CacheBlock		*cacheBlock;
 	CacheGlobals	*cacheGlobals;
 	UInt32			cacheBlockSize	= offsetof( CacheBlock, buffer ) + bufferSize;
+	UInt32			numHashChains;
+	Ptr				firstBlock;
 	
-	cacheGlobals	= (CacheGlobals *) NewPtrSysClear( sizeof( CacheGlobals ) +  ( numCacheBlocks * cacheBlockSize ) );
+	//	one hash chain per block, rounded up to a power of 2
+	for ( numHashChains = 1 ; numHashChains < numCacheBlocks ; numHashChains <<= 1 )
+		;
+
+	cacheGlobals	= (CacheGlobals *) NewPtrSysClear( sizeof( CacheGlobals ) + ( numHashChains * sizeof( CacheBlock * ) ) + ( numCacheBlocks * cacheBlockSize ) );
 	err = MemError();
 	
 	if ( err == noErr )
@@ -132,15 +148,18 @@ OSErr	InitMRUCache( UInt32 bufferSize, UInt32 numCacheBlocks, Ptr *cachePtr )
 		cacheGlobals->cacheBlockSize	= cacheBlockSize;
 		cacheGlobals->cacheBufferSize	= bufferSize;
 		cacheGlobals->numCacheBlocks	= numCacheBlocks;
+		cacheGlobals->hashMask			= numHashChains - 1;
+		cacheGlobals->hashTable			= (CacheBlock **) ( (Ptr)cacheGlobals + sizeof( CacheGlobals ) );	//	all chains start empty
+		firstBlock						= (Ptr)cacheGlobals->hashTable + ( numHashChains * sizeof( CacheBlock * ) );
 
 		lastBuffer = numCacheBlocks - 1;							//	last buffer number, since they start at 0
 		
 		//	Initialize the LRU order for the cache
-		cacheGlobals->lru = (CacheBlock *)((Ptr)cacheGlobals + sizeof( CacheGlobals ) + (lastBuffer * cacheBlockSize));
+		cacheGlobals->lru = (CacheBlock *)( firstBlock + (lastBuffer * cacheBlockSize) );
 		cacheGlobals->lru->nextMRU = nil;
 		
 		//	Initialize the MRU order for the cache
-		cacheGlobals->mru = (CacheBlock *)( (Ptr)cacheGlobals + sizeof( CacheGlobals ) );	//	points to 1st cache block
+		cacheGlobals->mru = (CacheBlock *) firstBlock;				//	points to 1st cache block
 		cacheGlobals->mru->nextLRU = nil;
 		
 		//	Traverse nodes, setting initial mru, lru, and default values
@@ -199,12 +218,17 @@ void	TrashMRUCache( Ptr cachePtr )
 {
 	CacheGlobals	*cacheGlobals	= (CacheGlobals *) cachePtr;
 	CacheBlock		*cacheBlock;
+	UInt32			i;
 	
 	for ( cacheBlock = cacheGlobals->mru ; cacheBlock != nil ; cacheBlock = cacheBlock->nextMRU )
 	{
-		cacheBlock->flags	= 0;					//	Clear the flags
-		cacheBlock->key		= kInvalidMRUCacheKey;	//	Make it an illegal value
+		cacheBlock->flags		= 0;					//	Clear the flags
+		cacheBlock->key			= kInvalidMRUCacheKey;	//	Make it an illegal value
+		cacheBlock->nextHash	= nil;
 	}
+	
+	for ( i = 0 ; i <= cacheGlobals->hashMask ; i++ )
+		cacheGlobals->hashTable[i] = nil;
 }
 
 
@@ -212,7 +236,7 @@ void	TrashMRUCache( Ptr cachePtr )
 //	Routine:	GetMRUCacheBlock
 //
 //	Function: 	Return buffer associated with the passed in key.
-//				Search the cache in MRU order
+//				Search the key's hash chain
 //				 We can insert the found cache block at the head of mru automatically
 //
 //
@@ -224,7 +248,7 @@ OSErr	GetMRUCacheBlock( UInt32 key, Ptr cachePtr, Ptr *buffer )
 //	if ( key == kInvalidMRUCacheKey )		//	removed for performance
 //		return( errInvalidKey );
 		
-	for ( cacheBlock = cacheGlobals->mru ; (cacheBlock != nil) && (cacheBlock->key != kInvalidMRUCacheKey) ; cacheBlock = cacheBlock->nextMRU )
+	for ( cacheBlock = *CacheHashChain( cacheGlobals, key ) ; cacheBlock != nil ; cacheBlock = cacheBlock->nextHash )
 	{
 		if ( cacheBlock->key == key )
 		{
@@ -251,6 +275,8 @@ void	InvalidateMRUCacheBlock( Ptr cachePtr, Ptr buffer )
 	CacheBlock		*cacheBlock;
 	
 	cacheBlock = (CacheBlock *) (buffer - offsetof( CacheBlock, buffer ));
+	if ( cacheBlock->key != kInvalidMRUCacheKey )
+		RemoveFromHash( cacheGlobals, cacheBlock );
 	cacheBlock->flags	= 0;					//	Clear the flags
 	cacheBlock->key		= kInvalidMRUCacheKey;	//	Make it an illegal value
 	InsertAsLRU( cacheGlobals, cacheBlock );
@@ -274,7 +300,13 @@ void	InsertMRUCacheBlock( Ptr cachePtr, UInt32 key, Ptr buffer )
 	
 	err = GetMRUCacheBlock( key, cachePtr, &cacheBuffer );
 	if ( err == errNotInCache )
-	    cacheBlock = cacheGlobals->lru;
+	{
+	    cacheBlock = cacheGlobals->lru;				//	reuse the lru block under the new key
+		if ( cacheBlock->key != kInvalidMRUCacheKey )
+			RemoveFromHash( cacheGlobals, cacheBlock );
+		cacheBlock->nextHash = *CacheHashChain( cacheGlobals, key );
+		*CacheHashChain( cacheGlobals, key ) = cacheBlock;
+	}
 	else if ( err == noErr )
 		cacheBlock = (CacheBlock *) (cacheBuffer - offsetof( CacheBlock, buffer ));
 	
@@ -344,3 +376,24 @@ static void InsertAsLRU	( CacheGlobals *cacheGlobals, CacheBlock *cacheBlock )
 }
 
 
+
+//
+//	Routine:	RemoveFromHash
+//
+//	Function: 	Takes a cache block holding a valid key off its hash chain
+//
+//
+static void RemoveFromHash	( CacheGlobals *cacheGlobals, CacheBlock *cacheBlock )
+{
+	CacheBlock	**link;
+
+	for ( link = CacheHashChain( cacheGlobals, cacheBlock->key ) ; *link != nil ; link = &(*link)->nextHash )
+	{
+		if ( *link == cacheBlock )
+		{
+			*link = cacheBlock->nextHash;
+			break;
+		}
+	}
+	cacheBlock->nextHash = nil;
+}
@@ -141,6 +141,9 @@ Public routines:
 					Given an ExtenddVCB, calculate the vcbFreeBks value
 					so that vcbFreeBks*vcbAlBlkSiz == freeBlocks*blockSize.
 
+	DisposeFreeExtents
+					Throw away the volume's in-memory summary of its free extents.
+
 Internal routines:
 	BlockVerifyAllocated
 					Makes sure that a contiguous range of blocks are marked as used
@@ -165,6 +168,15 @@ Internal routines:
 	ReadBitmapBlock
 					Given an allocation block number, read the bitmap block that
 					contains that allocation block into a caller-supplied buffer.
+
+	BlockAllocateFromSummary
+					Find and allocate a contiguous range of blocks using the
+					volume's free extent summary instead of the bitmap.
+	BuildFreeExtents
+					Build the free extent summary from the bitmap.
+	FreeExtentsAdd, FreeExtentsRemove
+					Keep the free extent summary in step with the bitmap as blocks
+					are freed and allocated.
 */
 
 #include "../headers/system/ConditionalMacros.h"
@@ -256,6 +268,74 @@ static OSErr BlockMarkFree(
 	UInt32			startingBlock,
 	UInt32			numBlocks);
 
+/*
+ *	In-memory summary of a volume's free extents; see "Free extent
+ *	summary" below.
+ */
+enum {
+	kByOffset				=	0,		//	tree ordered by starting block
+	kBySize					=	1,		//	tree ordered by block count, then starting block
+	kNumFreeExtentTrees		=	2,
+
+	kBlocksPerFreeExtent	=	256,	//	volume blocks per summary node
+	kMinFreeExtents			=	64,
+	kMaxFreeExtents			=	2048
+};
+
+typedef struct FreeExtent FreeExtent;
+struct FreeExtent {
+	UInt32			startBlock;
+	UInt32			blockCount;
+	FreeExtent		*child[kNumFreeExtentTrees][2];		//	[tree][left, right]
+	UInt8			height[kNumFreeExtentTrees];
+};
+
+typedef struct FreeExtentMap {
+	FreeExtent		*root[kNumFreeExtentTrees];
+	FreeExtent		*freeList;			//	unused nodes, linked through child[kByOffset][0]
+	UInt32			numExtents;			//	extents in the trees
+	UInt32			maxExtents;			//	size of the node pool, which follows this header
+	UInt32			largestMissing;		//	no free run longer than this is missing, or partly
+										//	missing, from the trees; 0 if none is
+} FreeExtentMap;
+
+static OSErr BuildFreeExtents(
+	ExtendedVCB		*vcb);
+
+static OSErr BlockAllocateFromSummary(
+	ExtendedVCB		*vcb,
+	UInt32			startingBlock,
+	UInt32			minBlocks,
+	UInt32			maxBlocks,
+	UInt32			*actualStartBlock,
+	UInt32			*actualNumBlocks);
+
+static void FreeExtentsAdd(
+	ExtendedVCB		*vcb,
+	UInt32			startBlock,
+	UInt32			numBlocks);
+
+static void FreeExtentsRemove(
+	ExtendedVCB		*vcb,
+	UInt32			startBlock,
+	UInt32			numBlocks);
+
+static void FreeExtentInsert(FreeExtentMap *map, UInt32 startBlock, UInt32 blockCount);
+static void FreeExtentDelete(FreeExtentMap *map, FreeExtent *x);
+static FreeExtent *ExtentAtOrBefore(FreeExtentMap *map, UInt32 block);
+static FreeExtent *ExtentAfter(FreeExtentMap *map, UInt32 block);
+static FreeExtent *ExtentAtLeast(FreeExtentMap *map, UInt32 blockCount);
+static FreeExtent *SmallestExtent(FreeExtentMap *map);
+static FreeExtent *LargestExtent(FreeExtentMap *map);
+static FreeExtent *TreeInsert(FreeExtent *root, FreeExtent *x, int tree);
+static FreeExtent *TreeRemove(FreeExtent *root, FreeExtent *x, int tree);
+static FreeExtent *TreeRemoveFirst(FreeExtent *root, FreeExtent **first, int tree);
+static FreeExtent *TreeBalance(FreeExtent *root, int tree);
+static FreeExtent *TreeRotate(FreeExtent *root, int side, int tree);
+static int TreeHeight(FreeExtent *x, int tree);
+static void TreeSetHeight(FreeExtent *x, int tree);
+static SInt32 CompareFreeExtents(FreeExtent *a, FreeExtent *b, int tree);
+
 #if TARGET_OS_RHAPSODY && DIAGNOSTIC
 	#if DIAGNOSTIC
 		extern void RequireFileLock(FileReference file, int shareable);
@@ -386,16 +466,28 @@ OSErr BlockAllocate (
 	}
 	
 	//
-	//	If the request must be contiguous, then find a sequence of free blocks
-	//	that is long enough.  Otherwise, find the first free block.
+	//	Take the space from the volume's free extent summary.  A request
+	//	that needn't be contiguous takes whatever single run it gets.
+	//
+	err = BlockAllocateFromSummary(vcb, updateAllocPtr ? 0 : startingBlock,
+								   forceContiguous ? minBlocks : 1, maxBlocks,
+								   actualStartBlock, actualNumBlocks);
+
 	//
-	if (forceContiguous) {
-		err = BlockAllocateContig(vcb, startingBlock, minBlocks, maxBlocks, actualStartBlock, actualNumBlocks);
-	} else {
-		err = BlockAllocateAny(vcb, startingBlock, vcb->totalBlocks, maxBlocks, actualStartBlock, actualNumBlocks);
-		if (err == dskFulErr) {
-			err = BlockAllocateAny(vcb, 0, startingBlock, maxBlocks, actualStartBlock, actualNumBlocks);
-			};
+	//	Without memory for the summary, search the bitmap.  If the request
+	//	must be contiguous, then find a sequence of free blocks that is long
+	//	enough.  Otherwise, find the first free block.
+	//
+	if (err == memFullErr) {
+		++vcb->allocStats.bitmapSearches;
+		if (forceContiguous) {
+			err = BlockAllocateContig(vcb, startingBlock, minBlocks, maxBlocks, actualStartBlock, actualNumBlocks);
+		} else {
+			err = BlockAllocateAny(vcb, startingBlock, vcb->totalBlocks, maxBlocks, actualStartBlock, actualNumBlocks);
+			if (err == dskFulErr) {
+				err = BlockAllocateAny(vcb, 0, startingBlock, maxBlocks, actualStartBlock, actualNumBlocks);
+				};
+		}
 	}
 
 	if (err == noErr) {
@@ -420,6 +512,11 @@ OSErr BlockAllocate (
 
 		UpdateVCBFreeBlks( vcb );
 		MarkVCBDirty(vcb);
+
+		++vcb->allocStats.allocations;
+		vcb->allocStats.blocksAllocated += *actualNumBlocks;
+		if (updateAllocPtr || *actualStartBlock != startingBlock)
+			++vcb->allocStats.newExtents;
 	}
 	
 Exit:
@@ -535,6 +632,8 @@ OSErr BlockDeallocate (
 	if (err)
 		goto Exit;
 
+	FreeExtentsAdd(vcb, firstBlock, numBlocks);
+
 	//
 	//	Update the volume's free block count, and mark the VCB as dirty.
 	//
@@ -1172,6 +1271,7 @@ OSErr BlockAllocateAny(
 Exit:
 	if (err == noErr) {
 		*actualNumBlocks = block - *actualStartBlock;
+		FreeExtentsRemove(vcb, *actualStartBlock, *actualNumBlocks);
 	}
 	else {
 		*actualStartBlock = 0;
@@ -1229,6 +1329,11 @@ static OSErr BlockMarkAllocated(
 	InstLogTraceEvent( trace, eventTag, kInstStartEvent);
 #endif
 
+	//
+	//	These blocks are no longer free
+	//
+	FreeExtentsRemove(vcb, startingBlock, numBlocks);
+
 	//
 	//	Pre-read the bitmap block containing the first word of allocation
 	//
@@ -1565,6 +1670,11 @@ static OSErr BlockVerifyAllocated(
 	InstLogTraceEvent( trace, eventTag, kInstStartEvent);
 #endif
 
+	//
+	//	These blocks are no longer free
+	//
+	FreeExtentsRemove(vcb, startBlock, numBlocks);
+
 	//
 	//	Assume everything's OK
 	//
@@ -2075,3 +2185,712 @@ Exit:
 }
 
 
+/*
+_______________________________________________________________________
+
+Free extent summary
+
+	The summary keeps the volume's free extents in memory, in two
+	AVL trees threaded through the same nodes: one ordered by
+	starting block and one by size (then starting block).  The
+	offset tree finds the extent holding a given block and the
+	neighbours a freed range merges with; the size tree finds the
+	smallest extent that holds a request.  Both take time
+	logarithmic in the number of extents.
+
+	The summary is built from the bitmap by the first BlockAllocate
+	on the volume, and is then kept in step with it: every routine
+	that sets bits removes the range from the summary, and
+	BlockDeallocate adds the range it freed.  All of that happens
+	with the bitmap's lock (the Extents B-tree lock) held, which also
+	covers the summary.
+
+	The node pool is sized from the volume.  When it runs out, the
+	smallest extents are dropped; what the summary holds is still
+	free, but it no longer has all of the free space.  It keeps an
+	upper bound on the length of any free run it is missing, or has
+	only part of, and is rebuilt before it says that nothing fits a
+	request no longer than that.
+_______________________________________________________________________
+*/
+
+/*
+_______________________________________________________________________
+
+Routine:	DisposeFreeExtents
+
+Function:	Throw away a volume's free extent summary.  The next
+			allocation builds a new one from the bitmap.
+_______________________________________________________________________
+*/
+void DisposeFreeExtents(
+	ExtendedVCB		*vcb)
+{
+	if (vcb->freeExtentsPtr != NULL) {
+		DisposePtr(vcb->freeExtentsPtr);
+		vcb->freeExtentsPtr = NULL;
+	}
+}
+
+
+/*
+_______________________________________________________________________
+
+Routine:	BuildFreeExtents
+
+Function:	Read the whole bitmap and build the volume's free extent
+			summary from it.  If the summary cannot hold every free
+			extent it keeps the largest ones.
+_______________________________________________________________________
+*/
+static OSErr BuildFreeExtents(
+	ExtendedVCB		*vcb)
+{
+	OSErr			err;
+	FreeExtentMap	*map;
+	FreeExtent		*x;
+	UInt32			maxExtents;
+	UInt32			*buffer = NULL;		//	Pointer to bitmap block
+	register UInt32	*currentWord;		//	Pointer to current word in bitmap block
+	register UInt32	wordsLeft;			//	Number of words left in this bitmap block
+	register UInt32	block;				//	First block described by the current word
+	register UInt32	bitMask;
+	UInt32			word;
+	UInt32			bit;
+	UInt32			runStart;			//	First block of the free run being gathered
+	UInt32			runLength;			//	Length of that run, 0 if none
+
+	//
+	//	Size the node pool from the volume.
+	//
+	maxExtents = vcb->totalBlocks / kBlocksPerFreeExtent;
+	if (maxExtents < kMinFreeExtents)
+		maxExtents = kMinFreeExtents;
+	else if (maxExtents > kMaxFreeExtents)
+		maxExtents = kMaxFreeExtents;
+
+	map = (FreeExtentMap *) NewPtrSysClear(sizeof(FreeExtentMap) + maxExtents * sizeof(FreeExtent));
+	if (map == NULL)
+		return memFullErr;
+
+	map->maxExtents = maxExtents;
+	for (x = (FreeExtent *) (map + 1); maxExtents != 0; --maxExtents, ++x) {
+		x->child[kByOffset][0] = map->freeList;
+		map->freeList = x;
+	}
+
+	//
+	//	Gather the runs of clear bits a word at a time.
+	//
+	err = noErr;
+	currentWord = NULL;
+	wordsLeft = 0;
+	runStart = 0;
+	runLength = 0;
+
+	for (block = 0; block < vcb->totalBlocks; block += kBitsPerWord) {
+		if (wordsLeft == 0) {
+			//	Read in the next bitmap block
+#if EXPLICIT_BUFFER_RELEASES
+			if (buffer != NULL) {
+				err = RelBlock_glue((Ptr)buffer, rbDefault);
+				buffer = NULL;
+				if (err != noErr) goto Exit;
+			}
+#endif
+			err = ReadBitmapBlock(vcb, block, &buffer);
+			if (err != noErr) goto Exit;
+
+			currentWord = buffer;
+			wordsLeft = kWordsPerBlock;
+		}
+
+		word = *currentWord++;
+		--wordsLeft;
+
+		if (word == 0 && (vcb->totalBlocks - block) >= kBitsPerWord) {
+			//	32 free blocks
+			if (runLength == 0)
+				runStart = block;
+			runLength += kBitsPerWord;
+		}
+		else if (word == kAllBitsSetInWord) {
+			//	32 allocated blocks
+			if (runLength != 0) {
+				FreeExtentInsert(map, runStart, runLength);
+				runLength = 0;
+			}
+		}
+		else {
+			//	A mixture, or the last word in the bitmap
+			for (bitMask = kHighBitInWordMask, bit = block;
+				 bitMask != 0 && bit < vcb->totalBlocks;
+				 bitMask >>= 1, ++bit) {
+				if (word & bitMask) {
+					if (runLength != 0) {
+						FreeExtentInsert(map, runStart, runLength);
+						runLength = 0;
+					}
+				}
+				else {
+					if (runLength == 0)
+						runStart = bit;
+					++runLength;
+				}
+			}
+		}
+	}
+
+	if (runLength != 0)
+		FreeExtentInsert(map, runStart, runLength);
+
+Exit:
+
+#if EXPLICIT_BUFFER_RELEASES
+	if (buffer) {
+		(void)RelBlock_glue((Ptr)buffer, rbDefault);		/* Ignore any additional errors */
+	};
+#endif
+
+	if (err == noErr) {
+		DisposeFreeExtents(vcb);
+		vcb->freeExtentsPtr = (Ptr) map;
+		++vcb->allocStats.summaryBuilds;
+	}
+	else {
+		DisposePtr((Ptr) map);
+	}
+
+	return err;
+}
+
+
+/*
+_______________________________________________________________________
+
+Routine:	BlockAllocateFromSummary
+
+Function:	Allocate a contiguous group of allocation blocks using the
+			volume's free extent summary.  If startingBlock is free
+			and starts at least minBlocks free blocks, the allocation
+			starts there, so a file being extended stays contiguous.
+			Otherwise it comes from the smallest free extent that
+			holds maxBlocks or, if none does, from the largest one.
+
+Inputs:
+	vcb				Pointer to volume where space is to be allocated
+	startingBlock	Preferred first block for allocation, 0 for none
+	minBlocks		Minimum number of contiguous blocks to allocate
+	maxBlocks		Maximum number of contiguous blocks to allocate
+
+Outputs:
+	actualStartBlock	First block of range allocated, or 0 if error
+	actualNumBlocks		Number of blocks allocated, or 0 if error
+_______________________________________________________________________
+*/
+static OSErr BlockAllocateFromSummary(
+	ExtendedVCB		*vcb,
+	UInt32			startingBlock,
+	UInt32			minBlocks,
+	UInt32			maxBlocks,
+	UInt32			*actualStartBlock,
+	UInt32			*actualNumBlocks)
+{
+	OSErr			err;
+	FreeExtentMap	*map;
+	FreeExtent		*x;
+	UInt32			start;
+	UInt32			count;
+	Boolean			rebuilt = false;
+
+	if (maxBlocks < minBlocks)
+		maxBlocks = minBlocks;
+
+	for (;;) {
+		if (vcb->freeExtentsPtr == NULL) {
+			err = BuildFreeExtents(vcb);
+			if (err != noErr) goto Exit;
+		}
+		map = (FreeExtentMap *) vcb->freeExtentsPtr;
+
+		//
+		//	Grow in place if the preferred block starts a long enough run.
+		//
+		if (startingBlock != 0) {
+			x = ExtentAtOrBefore(map, startingBlock);
+			if (x != NULL && (x->startBlock + x->blockCount) > startingBlock
+				&& (x->startBlock + x->blockCount - startingBlock) >= minBlocks) {
+				start = startingBlock;
+				count = x->startBlock + x->blockCount - startingBlock;
+				break;
+			}
+		}
+
+		//
+		//	Best fit for the whole request, else as much as we can get.
+		//
+		x = ExtentAtLeast(map, maxBlocks);
+		if (x == NULL)
+			x = LargestExtent(map);
+		if (x != NULL && x->blockCount >= minBlocks) {
+			start = x->startBlock;
+			count = x->blockCount;
+			break;
+		}
+
+		//
+		//	Nothing fits.  Believe that unless the summary is missing a
+		//	free run that might; it hasn't been, right after a rebuild.
+		//
+		if (minBlocks > map->largestMissing || rebuilt) {
+			err = dskFulErr;
+			goto Exit;
+		}
+		DisposeFreeExtents(vcb);
+		rebuilt = true;
+	}
+
+	if (count > maxBlocks)
+		count = maxBlocks;
+
+	err = BlockMarkAllocated(vcb, start, count);
+	if (err == noErr) {
+		*actualStartBlock = start;
+		*actualNumBlocks = count;
+	}
+
+Exit:
+	if (err != noErr) {
+		*actualStartBlock = 0;
+		*actualNumBlocks = 0;
+	}
+
+	return err;
+}
+
+
+/*
+_______________________________________________________________________
+
+Routine:	FreeExtentsAdd
+
+Function:	Add a range of blocks that has just been marked free in the
+			bitmap to the volume's free extent summary, merging it with
+			the free extents on either side.  A range that overlaps an
+			extent already in the summary means the two have gone out of
+			step; the summary is thrown away and rebuilt when next needed.
+_______________________________________________________________________
+*/
+static void FreeExtentsAdd(
+	ExtendedVCB		*vcb,
+	UInt32			startBlock,
+	UInt32			numBlocks)
+{
+	FreeExtentMap	*map = (FreeExtentMap *) vcb->freeExtentsPtr;
+	FreeExtent		*prev;
+	FreeExtent		*next;
+	UInt32			endBlock = startBlock + numBlocks;
+	UInt32			missing;
+
+	if (map == NULL || numBlocks == 0)
+		return;
+
+	prev = ExtentAtOrBefore(map, startBlock);
+	next = ExtentAfter(map, startBlock);
+	if ((prev != NULL && (prev->startBlock + prev->blockCount) > startBlock) ||
+		(next != NULL && next->startBlock < endBlock)) {
+#if DEBUG_BUILD
+		DebugStr("\pFreeExtentsAdd: range already free in summary!");
+#endif
+		DisposeFreeExtents(vcb);
+		return;
+	}
+
+	//
+	//	If the summary is missing free space, a side that doesn't merge
+	//	may border free blocks it doesn't have; the run the range is
+	//	part of may then be longer than the extent added for it.
+	//
+	missing = 0;
+	if (prev != NULL && (prev->startBlock + prev->blockCount) == startBlock) {
+		startBlock = prev->startBlock;
+		FreeExtentDelete(map, prev);
+	}
+	else
+		missing += map->largestMissing;
+	if (next != NULL && next->startBlock == endBlock) {
+		endBlock += next->blockCount;
+		FreeExtentDelete(map, next);
+	}
+	else
+		missing += map->largestMissing;
+
+	FreeExtentInsert(map, startBlock, endBlock - startBlock);
+
+	if (missing != 0) {
+		missing += endBlock - startBlock;
+		if (missing > map->largestMissing)
+			map->largestMissing = missing;
+	}
+}
+
+
+/*
+_______________________________________________________________________
+
+Routine:	FreeExtentsRemove
+
+Function:	Take a range of blocks that is being marked allocated in the
+			bitmap out of the volume's free extent summary.  Parts of the
+			range that the summary doesn't have are ignored.
+_______________________________________________________________________
+*/
+static void FreeExtentsRemove(
+	ExtendedVCB		*vcb,
+	UInt32			startBlock,
+	UInt32			numBlocks)
+{
+	FreeExtentMap	*map = (FreeExtentMap *) vcb->freeExtentsPtr;
+	FreeExtent		*x;
+	UInt32			endBlock = startBlock + numBlocks;
+	UInt32			xStart;
+	UInt32			xEnd;
+
+	if (map == NULL || numBlocks == 0)
+		return;
+
+	x = ExtentAtOrBefore(map, startBlock);
+	if (x == NULL || (x->startBlock + x->blockCount) <= startBlock)
+		x = ExtentAfter(map, startBlock);
+
+	while (x != NULL && x->startBlock < endBlock) {
+		//	Cut the range out of x, keeping whatever is left on either side
+		xStart = x->startBlock;
+		xEnd = xStart + x->blockCount;
+		FreeExtentDelete(map, x);
+		if (xStart < startBlock)
+			FreeExtentInsert(map, xStart, startBlock - xStart);
+		if (xEnd > endBlock)
+			FreeExtentInsert(map, endBlock, xEnd - endBlock);
+
+		x = ExtentAfter(map, startBlock);
+	}
+}
+
+
+/*
+_______________________________________________________________________
+
+Routine:	FreeExtentInsert
+
+Function:	Put a free extent into both trees.  If the pool is empty the
+			smallest extent, which may be the new one, is dropped.
+_______________________________________________________________________
+*/
+static void FreeExtentInsert(
+	FreeExtentMap	*map,
+	UInt32			startBlock,
+	UInt32			blockCount)
+{
+	FreeExtent		*x;
+
+	if (map->freeList == NULL) {
+		x = SmallestExtent(map);
+		if (x->blockCount >= blockCount) {
+			if (blockCount > map->largestMissing)
+				map->largestMissing = blockCount;
+			return;
+		}
+		if (x->blockCount > map->largestMissing)
+			map->largestMissing = x->blockCount;
+		FreeExtentDelete(map, x);
+	}
+
+	x = map->freeList;
+	map->freeList = x->child[kByOffset][0];
+
+	x->startBlock = startBlock;
+	x->blockCount = blockCount;
+	map->root[kByOffset] = TreeInsert(map->root[kByOffset], x, kByOffset);
+	map->root[kBySize] = TreeInsert(map->root[kBySize], x, kBySize);
+	++map->numExtents;
+}
+
+
+/*
+_______________________________________________________________________
+
+Routine:	FreeExtentDelete
+
+Function:	Take a free extent out of both trees and return its node to
+			the pool.
+_______________________________________________________________________
+*/
+static void FreeExtentDelete(
+	FreeExtentMap	*map,
+	FreeExtent		*x)
+{
+	map->root[kByOffset] = TreeRemove(map->root[kByOffset], x, kByOffset);
+	map->root[kBySize] = TreeRemove(map->root[kBySize], x, kBySize);
+	--map->numExtents;
+
+	x->child[kByOffset][0] = map->freeList;
+	map->freeList = x;
+}
+
+
+/*
+_______________________________________________________________________
+
+Routines:	ExtentAtOrBefore, ExtentAfter, ExtentAtLeast,
+			SmallestExtent, LargestExtent
+
+Function:	Look up the extent with the highest starting block not above
+			block; with the lowest starting block above block; the
+			smallest extent of at least blockCount blocks; and the
+			smallest and largest extents.  NULL if there is none.
+_______________________________________________________________________
+*/
+static FreeExtent *ExtentAtOrBefore(
+	FreeExtentMap	*map,
+	UInt32			block)
+{
+	register FreeExtent	*x = map->root[kByOffset];
+	FreeExtent			*found = NULL;
+
+	while (x != NULL) {
+		if (x->startBlock <= block) {
+			found = x;
+			x = x->child[kByOffset][1];
+		}
+		else
+			x = x->child[kByOffset][0];
+	}
+
+	return found;
+}
+
+static FreeExtent *ExtentAfter(
+	FreeExtentMap	*map,
+	UInt32			block)
+{
+	register FreeExtent	*x = map->root[kByOffset];
+	FreeExtent			*found = NULL;
+
+	while (x != NULL) {
+		if (x->startBlock > block) {
+			found = x;
+			x = x->child[kByOffset][0];
+		}
+		else
+			x = x->child[kByOffset][1];
+	}
+
+	return found;
+}
+
+static FreeExtent *ExtentAtLeast(
+	FreeExtentMap	*map,
+	UInt32			blockCount)
+{
+	register FreeExtent	*x = map->root[kBySize];
+	FreeExtent			*found = NULL;
+
+	while (x != NULL) {
+		if (x->blockCount >= blockCount) {
+			found = x;
+			x = x->child[kBySize][0];
+		}
+		else
+			x = x->child[kBySize][1];
+	}
+
+	return found;
+}
+
+static FreeExtent *SmallestExtent(
+	FreeExtentMap	*map)
+{
+	register FreeExtent	*x = map->root[kBySize];
+
+	if (x != NULL)
+		while (x->child[kBySize][0] != NULL)
+			x = x->child[kBySize][0];
+
+	return x;
+}
+
+static FreeExtent *LargestExtent(
+	FreeExtentMap	*map)
+{
+	register FreeExtent	*x = map->root[kBySize];
+
+	if (x != NULL)
+		while (x->child[kBySize][1] != NULL)
+			x = x->child[kBySize][1];
+
+	return x;
+}
+
+
+/*
+_______________________________________________________________________
+
+Routines:	TreeInsert, TreeRemove
+
+Function:	Insert x into, or remove it from, the AVL tree rooted at
+			root, and return the new root.  tree says which of the two
+			trees, and so which links and which ordering, to use.
+			Keys are unique in both trees, so the node that compares
+			equal to x is x.
+_______________________________________________________________________
+*/
+static FreeExtent *TreeInsert(
+	FreeExtent		*root,
+	FreeExtent		*x,
+	int				tree)
+{
+	int				side;
+
+	if (root == NULL) {
+		x->child[tree][0] = NULL;
+		x->child[tree][1] = NULL;
+		x->height[tree] = 1;
+		return x;
+	}
+
+	side = CompareFreeExtents(x, root, tree) > 0;
+	root->child[tree][side] = TreeInsert(root->child[tree][side], x, tree);
+
+	return TreeBalance(root, tree);
+}
+
+static FreeExtent *TreeRemove(
+	FreeExtent		*root,
+	FreeExtent		*x,
+	int				tree)
+{
+	FreeExtent		*successor;
+	SInt32			result;
+
+	if (root == NULL)
+		return NULL;		//	not in the tree
+
+	result = CompareFreeExtents(x, root, tree);
+	if (result != 0) {
+		root->child[tree][result > 0] = TreeRemove(root->child[tree][result > 0], x, tree);
+		return TreeBalance(root, tree);
+	}
+
+	//	root is x: replace it with the first node of its right subtree
+	if (x->child[tree][0] == NULL)
+		return x->child[tree][1];
+	if (x->child[tree][1] == NULL)
+		return x->child[tree][0];
+
+	successor = NULL;
+	root = TreeRemoveFirst(x->child[tree][1], &successor, tree);
+	successor->child[tree][0] = x->child[tree][0];
+	successor->child[tree][1] = root;
+
+	return TreeBalance(successor, tree);
+}
+
+static FreeExtent *TreeRemoveFirst(
+	FreeExtent		*root,
+	FreeExtent		**first,
+	int				tree)
+{
+	if (root->child[tree][0] == NULL) {
+		*first = root;
+		return root->child[tree][1];
+	}
+
+	root->child[tree][0] = TreeRemoveFirst(root->child[tree][0], first, tree);
+
+	return TreeBalance(root, tree);
+}
+
+
+/*
+_______________________________________________________________________
+
+Routine:	TreeBalance
+
+Function:	Recompute the height of root, whose subtrees are balanced,
+			and rotate it if one subtree has grown two levels taller
+			than the other.  Returns the new root of the subtree.
+_______________________________________________________________________
+*/
+static FreeExtent *TreeBalance(
+	FreeExtent		*root,
+	int				tree)
+{
+	FreeExtent		*child;
+	int				balance;
+	int				side;
+
+	balance = TreeHeight(root->child[tree][1], tree) - TreeHeight(root->child[tree][0], tree);
+	if (balance > 1 || balance < -1) {
+		side = balance > 0;		//	the taller side
+		child = root->child[tree][side];
+		if (TreeHeight(child->child[tree][!side], tree) > TreeHeight(child->child[tree][side], tree))
+			root->child[tree][side] = TreeRotate(child, side, tree);
+		return TreeRotate(root, !side, tree);
+	}
+
+	TreeSetHeight(root, tree);
+	return root;
+}
+
+/*
+ *	Rotate root toward side (0 left, 1 right): its child on the other
+ *	side becomes the root of the subtree.
+ */
+static FreeExtent *TreeRotate(
+	FreeExtent		*root,
+	int				side,
+	int				tree)
+{
+	FreeExtent		*child = root->child[tree][!side];
+
+	root->child[tree][!side] = child->child[tree][side];
+	child->child[tree][side] = root;
+	TreeSetHeight(root, tree);
+	TreeSetHeight(child, tree);
+
+	return child;
+}
+
+static int TreeHeight(
+	FreeExtent		*x,
+	int				tree)
+{
+	return (x == NULL) ? 0 : x->height[tree];
+}
+
+static void TreeSetHeight(
+	FreeExtent		*x,
+	int				tree)
+{
+	int				left = TreeHeight(x->child[tree][0], tree);
+	int				right = TreeHeight(x->child[tree][1], tree);
+
+	x->height[tree] = 1 + ((left > right) ? left : right);
+}
+
+/*
+ *	The offset tree is ordered by starting block; the size tree by
+ *	block count, then starting block.
+ */
+static SInt32 CompareFreeExtents(
+	FreeExtent		*a,
+	FreeExtent		*b,
+	int				tree)
+{
+	if (tree == kBySize && a->blockCount != b->blockCount)
+		return (a->blockCount < b->blockCount) ? -1 : 1;
+	if (a->startBlock != b->startBlock)
+		return (a->startBlock < b->startBlock) ? -1 : 1;
+	return 0;
+}
@@ -142,7 +142,8 @@ typedef FSBufferDescriptor *FSBufferDescriptorPtr;
 enum {
 		kGetBlock			= 0x00000000,
 		kForceReadBlock		= 0x00000002,	// how does this relate to Read/Verify? Do we need this?
-		kGetEmptyBlock		= 0x00000008
+		kGetEmptyBlock		= 0x00000008,
+		kReadAheadBlock		= 0x00000010	// start reading the block, return no buffer
 };
 typedef OptionBits	GetBlockOptions;
 
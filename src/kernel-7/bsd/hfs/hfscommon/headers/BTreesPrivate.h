@@ -227,6 +227,9 @@ typedef struct BTreeControlBlock {					// fields specific to BTree CBs
 	UInt32						 numHintChecks;
 	UInt32						 numPossibleHints;	// Looks like a formated hint
 	UInt32						 numValidHints;		// Hint used to find correct record.
+	UInt32						 numNodeHits;		// GetNode found the node in the cache
+	UInt32						 numNodeMisses;		// GetNode had to read the node
+	UInt32						 numReadAheads;		// right siblings read ahead
 	
 	UInt32						 refCon;			//	Used by DFA to point to private data.
 	
@@ -390,6 +393,9 @@ OSStatus	GetRightSiblingNode		(BTreeControlBlockPtr	 btreePtr,
 
 #define		GetRightSiblingNode(btree,node,right)		GetNode ((btree), ((NodeDescPtr)(node))->fLink, (right))
 
+OSStatus	ReadAheadNode			(BTreeControlBlockPtr	 btreePtr,
+									 UInt32					 nodeNum );
+
 
 OSStatus	GetNewNode				(BTreeControlBlockPtr	 btreePtr,
 									 UInt32					 nodeNum,
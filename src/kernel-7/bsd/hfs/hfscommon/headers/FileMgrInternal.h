@@ -385,7 +385,8 @@ enum {
 
 enum {
 	kInvalidMRUCacheKey			= -1L,							/* flag to denote current MRU cache key is invalid*/
-	kDefaultNumMRUCacheBlocks	= 16							/* default number of blocks in each cache*/
+	kDefaultNumMRUCacheBlocks	= 16,							/* default number of blocks in each cache*/
+	kMaxNumMRUCacheBlocks		= 1024							/* most blocks a volume's hint cache is sized to*/
 };
 
 
@@ -456,6 +457,16 @@ enum {
 
 /* Internal Data structures*/
 
+/*	Allocation counts kept per volume by VolumeAllocation.c*/
+struct AllocationStats {
+	UInt32 							allocations;				/* BlockAllocate calls that got space*/
+	UInt32 							blocksAllocated;			/* allocation blocks they got*/
+	UInt32 							newExtents;					/* ... not at the requested starting block*/
+	UInt32 							bitmapSearches;				/* BlockAllocate calls that searched the bitmap*/
+	UInt32 							summaryBuilds;				/* free extent summary built from the bitmap*/
+};
+typedef struct AllocationStats AllocationStats;
+
 struct ExtendedVCB {
 	QElemPtr 						qLink;
 	SInt16 							qType;
@@ -523,6 +534,8 @@ struct ExtendedVCB {
 	TextEncoding 					volumeNameEncodingHint;		/* Text encoding used for volume name*/
 
 	Ptr 							hintCachePtr;				/* points to this volumes heuristicHint cache*/
+	Ptr 							freeExtentsPtr;				/* in-memory summary of free extents, built by first allocation*/
+	AllocationStats 				allocStats;
 
 #if TARGET_OS_RHAPSODY
 	simple_lock_data_t				vcbSimpleLock;				/* simple lock to allow concurrent access to vcb data */
@@ -1170,6 +1183,9 @@ BlockAllocateAny				(ExtendedVCB *			vcb,
 EXTERN_API_C( void )
 UpdateVCBFreeBlks				(ExtendedVCB *			vcb);
 
+EXTERN_API_C( void )
+DisposeFreeExtents				(ExtendedVCB *			vcb);
+
 /*	File Extent Mapping routines*/
 EXTERN_API_C( OSErr )
 FlushExtentFile					(ExtendedVCB *			vcb);
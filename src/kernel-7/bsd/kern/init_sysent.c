@@ -291,6 +291,9 @@ int searchfs();
 int watchevent();
 int waitevent();
 int modwatch();
+int kqueue();
+int kevent();
+int sendfile();
 
 /*
  * System call switch table.
@@ -592,6 +595,9 @@ struct sysent sysent[] = {
 	syss(nosys,0),		/* 230 */
 	syss(watchevent,2),		/* 231 */
 	syss(waitevent,2),		/* 232 */
-	syss(modwatch,2)		/* 233 */
+	syss(modwatch,2),		/* 233 */
+	syss(kqueue,0),		/* 234 = kqueue */
+	syss(kevent,6),		/* 235 = kevent */
+	syss(sendfile,8)	/* 236 = sendfile */
 };
 int	nsysent = sizeof(sysent) / sizeof(sysent[0]);
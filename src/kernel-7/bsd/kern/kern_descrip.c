@@ -87,6 +87,7 @@
 #include <sys/syslog.h>
 #include <sys/unistd.h>
 #include <sys/resourcevar.h>
+#include <sys/event.h>
 
 #include <sys/mount.h>
 
@@ -217,6 +218,8 @@ closeit:
 		if (*(fpp = &fdp->fd_ofiles[new])) {
 			struct file *fp = *fpp;
 
+			if (new < fdp->fd_knlistsize)
+				knote_fdclose(fdp, new);
 			*fpp = NULL; (void) closef(fp, p);
 		}
 	}
@@ -596,6 +599,8 @@ close(p, uap, retval)
 			(fp = fdp->fd_ofiles[fd]) == NULL ||
 			(fdp->fd_ofileflags[fd] & UF_RESERVED))
 		return (EBADF);
+	if (fd < fdp->fd_knlistsize)
+		knote_fdclose(fdp, fd);
 	_fdrelse(fdp, fd);
 	return (closef(fp, p));
 }
@@ -634,6 +639,10 @@ fstat(p, uap, retval)
 		error = soo_stat((struct socket *)fp->f_data, &ub);
 		break;
 
+	case DTYPE_KQUEUE:
+		error = kqueue_stat(fp, &ub);
+		break;
+
 	default:
 		panic("fstat");
 		/*NOTREACHED*/
@@ -679,6 +688,10 @@ ofstat(p, uap, retval)
 		error = soo_stat((struct socket *)fp->f_data, &ub);
 		break;
 
+	case DTYPE_KQUEUE:
+		error = kqueue_stat(fp, &ub);
+		break;
+
 	default:
 		panic("ofstat");
 		/*NOTREACHED*/
@@ -725,6 +738,9 @@ fpathconf(p, uap, retval)
 		vp = (struct vnode *)fp->f_data;
 		return (VOP_PATHCONF(vp, uap->name, retval));
 
+	case DTYPE_KQUEUE:
+		return (EINVAL);
+
 	default:
 		panic("fpathconf");
 	}
@@ -948,6 +964,8 @@ fdexec(p)
 		if ((*flags & (UF_RESERVED|UF_EXCLOSE)) == UF_EXCLOSE) {
 			register struct file *fp = *fpp;
 
+			if (i < fdp->fd_knlistsize)
+				knote_fdclose(fdp, i);
 			*fpp = NULL; *flags = 0;
 			if (i == fdp->fd_lastfile && i > 0)
 				fdp->fd_lastfile--;
@@ -978,6 +996,13 @@ fdcopy(p)
 		VREF(newfdp->fd_rdir);
 	newfdp->fd_refcnt = 1;
 
+	/*
+	 * Knotes belong to the kqueues that registered them and are
+	 * not inherited.
+	 */
+	newfdp->fd_knlist = NULL;
+	newfdp->fd_knlistsize = 0;
+
 	/*
 	 * If the number of open files fits in the internal arrays
 	 * of the open file structure, use them, otherwise allocate
@@ -1011,13 +1036,23 @@ fdcopy(p)
 
 		fpp = newfdp->fd_ofiles;
 		flags = newfdp->fd_ofileflags;
-		for (i = newfdp->fd_lastfile; i-- >= 0; fpp++, flags++)
-			if (*fpp != NULL && !(*flags & UF_RESERVED)) {
+		/*
+		 * A kqueue is tied to the descriptor table it was
+		 * created in, so the child does not get a copy.
+		 */
+		for (i = 0; i <= newfdp->fd_lastfile; i++, fpp++, flags++)
+			if (*fpp != NULL && !(*flags & UF_RESERVED) &&
+			    (*fpp)->f_type != DTYPE_KQUEUE) {
 				if (++(*fpp)->f_count <= 0)
 					panic("fdcopy f_count");
 			} else {
 				*fpp = NULL; *flags = 0;
+				if (i < newfdp->fd_freefile)
+					newfdp->fd_freefile = i;
 			}
+		while (newfdp->fd_lastfile > 0 &&
+		    newfdp->fd_ofiles[newfdp->fd_lastfile] == NULL)
+			newfdp->fd_lastfile--;
 	}
 	else
 		(void) memset(newfdp->fd_ofiles, 0, i * OFILESIZE);
@@ -1043,12 +1078,17 @@ fdfree(p)
 	p->p_fd = NULL;
 	if (fdp->fd_nfiles > 0) {
 		fpp = fdp->fd_ofiles;
-		for (i = fdp->fd_lastfile; i-- >= 0; fpp++)
-			if (*fpp)
+		for (i = 0; i <= fdp->fd_lastfile; i++, fpp++)
+			if (*fpp) {
+				if (i < fdp->fd_knlistsize)
+					knote_fdclose(fdp, i);
 				(void) closef(*fpp, p);
+			}
 		FREE_ZONE(fdp->fd_ofiles,
 				fdp->fd_nfiles * OFILESIZE, M_OFILETABL);
 	}
+	if (fdp->fd_knlist)
+		FREE(fdp->fd_knlist, M_KQUEUE);
 	vrele(fdp->fd_cdir);
 	if (fdp->fd_rdir)
 		vrele(fdp->fd_rdir);
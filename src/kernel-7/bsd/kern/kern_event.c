@@ -0,0 +1,852 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.1 (the "License").  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON- INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+ * Kernel event queues: kqueue() and kevent().
+ *
+ * select() has to ask every descriptor whether it is ready on every
+ * call.  A kqueue instead remembers the interest: kevent() attaches a
+ * knote to the watched object once, the object runs its knotes when
+ * its state changes (sowakeup for sockets and pipes, VN_KNOTE for
+ * vnodes, exit1 for processes, a timeout for timers), and the ones
+ * whose filter says "ready" are put on the queue's active list.
+ * Collecting events only walks that list.
+ *
+ * Events are level triggered by default: a knote that is returned
+ * stays on the active list and is re-checked by the next scan, which
+ * drops it once the condition has gone.  EV_CLEAR makes it edge
+ * triggered and EV_ONESHOT deletes it after it has been returned.
+ *
+ * Like waitevent(), the queues are protected by splhigh, since knotes
+ * are posted from the network and timer paths.
+ */
+
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/kernel.h>
+#include <sys/proc.h>
+#include <sys/malloc.h>
+#include <sys/file.h>
+#include <sys/filedesc.h>
+#include <sys/fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <sys/vm.h>
+#include <sys/event.h>
+#include <sys/eventvar.h>
+
+#define	KQEXTENT	64		/* initial fd_knlist size */
+
+static int	kqueue_read __P((struct file *fp, struct uio *uio,
+		    struct ucred *cred));
+static int	kqueue_write __P((struct file *fp, struct uio *uio,
+		    struct ucred *cred));
+static int	kqueue_ioctl __P((struct file *fp, u_long com,
+		    caddr_t data, struct proc *p));
+static int	kqueue_select __P((struct file *fp, int which,
+		    struct proc *p));
+static int	kqueue_close __P((struct file *fp, struct proc *p));
+
+static struct fileops kqueueops =
+	{ kqueue_read, kqueue_write, kqueue_ioctl, kqueue_select, kqueue_close };
+
+static int	kqueue_register __P((struct kqueue *kq, struct kevent *kev,
+		    struct proc *p));
+static int	kqueue_scan __P((struct file *fp, int maxevents,
+		    struct kevent *ulistp, struct timespec *tsp,
+		    register_t *retval, struct proc *p));
+static void	kqueue_wakeup __P((struct kqueue *kq));
+
+static void	knote_fdgrow __P((struct filedesc *fdp, int fd));
+static void	knote_attach __P((struct knote *kn, struct filedesc *fdp));
+static void	knote_drop __P((struct knote *kn));
+static void	knote_activate __P((struct knote *kn));
+static void	knote_enqueue __P((struct knote *kn));
+static void	knote_dequeue __P((struct knote *kn));
+
+static int	filt_fileattach __P((struct knote *kn));
+static int	filt_procattach __P((struct knote *kn));
+static void	filt_procdetach __P((struct knote *kn));
+static int	filt_proc __P((struct knote *kn, long hint));
+static int	filt_timerattach __P((struct knote *kn));
+static void	filt_timerdetach __P((struct knote *kn));
+static int	filt_timer __P((struct knote *kn, long hint));
+static void	filt_timerexpire __P((void *arg));
+
+/*
+ * Descriptor filters are attached by the code that owns the
+ * descriptor type, which replaces kn_fop with its own routines.
+ */
+static struct filterops file_filtops =
+	{ 1, filt_fileattach, NULL, NULL };
+static struct filterops proc_filtops =
+	{ 0, filt_procattach, filt_procdetach, filt_proc };
+static struct filterops timer_filtops =
+	{ 0, filt_timerattach, filt_timerdetach, filt_timer };
+
+/*
+ * Indexed by ~filter.
+ */
+static struct filterops *sysfilt_ops[EVFILT_SYSCOUNT] = {
+	&file_filtops,			/* EVFILT_READ */
+	&file_filtops,			/* EVFILT_WRITE */
+	&file_filtops,			/* EVFILT_VNODE */
+	&proc_filtops,			/* EVFILT_PROC */
+	&timer_filtops,			/* EVFILT_TIMER */
+};
+
+static int
+filt_fileattach(kn)
+	struct knote *kn;
+{
+	struct file *fp = kn->kn_fp;
+
+	switch (fp->f_type) {
+	case DTYPE_SOCKET:
+		return (soo_kqfilter(fp, kn));
+	case DTYPE_VNODE:
+		return (vn_kqfilter(fp, kn));
+	default:
+		return (EINVAL);
+	}
+}
+
+/*
+ * EVFILT_PROC.  The knote is taken off the process when it exits,
+ * so a process that has gone never has knotes pointing at it.
+ */
+static int
+filt_procattach(kn)
+	struct knote *kn;
+{
+	struct proc *curp = current_proc();
+	struct proc *p;
+	int s;
+
+	if ((p = pfind((pid_t)kn->kn_id)) == NULL)
+		return (ESRCH);
+	if (p->p_cred->p_ruid != curp->p_cred->p_ruid &&
+	    suser(curp->p_ucred, &curp->p_acflag))
+		return (EACCES);
+
+	kn->kn_ptr.p_proc = p;
+	kn->kn_flags |= EV_CLEAR;
+	s = splhigh();
+	LIST_INSERT_HEAD(&p->p_klist, kn, kn_selnext);
+	splx(s);
+	return (0);
+}
+
+static void
+filt_procdetach(kn)
+	struct knote *kn;
+{
+	int s;
+
+	s = splhigh();
+	if ((kn->kn_status & KN_DETACHED) == 0) {
+		LIST_REMOVE(kn, kn_selnext);
+		kn->kn_status |= KN_DETACHED;
+	}
+	splx(s);
+}
+
+static int
+filt_proc(kn, hint)
+	struct knote *kn;
+	long hint;
+{
+	struct proc *p;
+
+	if (hint & NOTE_EXIT) {
+		p = kn->kn_ptr.p_proc;
+		LIST_REMOVE(kn, kn_selnext);
+		kn->kn_status |= KN_DETACHED;
+		kn->kn_ptr.p_proc = NULL;
+		if (kn->kn_sfflags & NOTE_EXIT)
+			kn->kn_fflags |= NOTE_EXIT;
+		kn->kn_data = p->p_xstat;
+		kn->kn_flags |= (EV_EOF | EV_ONESHOT);
+		return (1);
+	}
+	return (kn->kn_fflags != 0);
+}
+
+/*
+ * EVFILT_TIMER.  data is the period in milliseconds; the timer
+ * rearms itself unless EV_ONESHOT is set, and data returns the number
+ * of expirations since the event was last collected.
+ */
+static int
+filt_timerticks(kn)
+	struct knote *kn;
+{
+	int ms = kn->kn_sdata;
+
+	if (ms <= 0)
+		return (1);
+	return ((ms / 1000) * hz + ((ms % 1000) * hz + 999) / 1000);
+}
+
+static int
+filt_timerattach(kn)
+	struct knote *kn;
+{
+
+	kn->kn_flags |= EV_CLEAR;
+	timeout(filt_timerexpire, (void *)kn, filt_timerticks(kn));
+	return (0);
+}
+
+static void
+filt_timerdetach(kn)
+	struct knote *kn;
+{
+
+	untimeout(filt_timerexpire, (void *)kn);
+}
+
+static void
+filt_timerexpire(arg)
+	void *arg;
+{
+	struct knote *kn = (struct knote *)arg;
+	int s;
+
+	s = splhigh();
+	kn->kn_data++;
+	knote_activate(kn);
+	if ((kn->kn_flags & EV_ONESHOT) == 0)
+		timeout(filt_timerexpire, (void *)kn, filt_timerticks(kn));
+	splx(s);
+}
+
+/*ARGSUSED*/
+static int
+filt_timer(kn, hint)
+	struct knote *kn;
+	long hint;
+{
+
+	return (kn->kn_data != 0);
+}
+
+/*
+ * Create a kqueue.
+ */
+struct kqueue_args {
+	int	dummy;
+};
+/* ARGSUSED */
+int
+kqueue(p, uap, retval)
+	struct proc *p;
+	struct kqueue_args *uap;
+	register_t *retval;
+{
+	struct kqueue *kq;
+	struct file *fp;
+	int fd, error;
+
+	if (error = falloc(p, &fp, &fd))
+		return (error);
+	fp->f_flag = FREAD | FWRITE;
+	fp->f_type = DTYPE_KQUEUE;
+	fp->f_ops = &kqueueops;
+	MALLOC_ZONE(kq, struct kqueue *, sizeof(*kq), M_KQUEUE, M_WAITOK);
+	bzero((caddr_t)kq, sizeof(*kq));
+	TAILQ_INIT(&kq->kq_head);
+	kq->kq_fdp = p->p_fd;
+	fp->f_data = (caddr_t)kq;
+	*fdflags(p, fd) &= ~UF_RESERVED;
+	*retval = fd;
+	return (0);
+}
+
+/*
+ * Apply the changes in changelist, then wait for and return up to
+ * nevents events.  A change that fails is reported in eventlist with
+ * EV_ERROR if there is room, otherwise kevent() fails with its error.
+ */
+struct kevent_args {
+	int	fd;
+	struct	kevent *changelist;
+	int	nchanges;
+	struct	kevent *eventlist;
+	int	nevents;
+	struct	timespec *timeout;
+};
+int
+kevent(p, uap, retval)
+	struct proc *p;
+	struct kevent_args *uap;
+	register_t *retval;
+{
+	struct kevent kev[KQ_NEVENTS];
+	struct kevent *kevp;
+	struct kqueue *kq;
+	struct file *fp;
+	struct timespec ts, *tsp;
+	int i, n, nerrors, error;
+
+	if (error = fdgetf(p, uap->fd, &fp))
+		return (error);
+	if (fp->f_type != DTYPE_KQUEUE)
+		return (EBADF);
+	kq = (struct kqueue *)fp->f_data;
+	if (kq->kq_fdp != p->p_fd)
+		return (EBADF);
+
+	tsp = NULL;
+	if (uap->timeout != NULL) {
+		if (error = copyin((caddr_t)uap->timeout, (caddr_t)&ts,
+		    sizeof (ts)))
+			return (error);
+		tsp = &ts;
+	}
+
+	/*
+	 * Hold the file so that a close from another thread cannot
+	 * free the kqueue while we sleep.
+	 */
+	fp->f_count++;
+
+	nerrors = 0;
+	while (uap->nchanges > 0) {
+		n = uap->nchanges > KQ_NEVENTS ? KQ_NEVENTS : uap->nchanges;
+		if (error = copyin((caddr_t)uap->changelist, (caddr_t)kev,
+		    n * sizeof (struct kevent)))
+			goto done;
+		for (i = 0; i < n; i++) {
+			kevp = &kev[i];
+			kevp->flags &= ~EV_ERROR;
+			if ((error = kqueue_register(kq, kevp, p)) == 0)
+				continue;
+			if (uap->nevents == 0)
+				goto done;
+			kevp->flags = EV_ERROR;
+			kevp->data = error;
+			(void) copyout((caddr_t)kevp, (caddr_t)uap->eventlist,
+			    sizeof (*kevp));
+			uap->eventlist++;
+			uap->nevents--;
+			nerrors++;
+		}
+		uap->nchanges -= n;
+		uap->changelist += n;
+	}
+	if (nerrors) {
+		*retval = nerrors;
+		error = 0;
+		goto done;
+	}
+
+	error = kqueue_scan(fp, uap->nevents, uap->eventlist, tsp, retval, p);
+done:
+	(void) closef(fp, p);
+	return (error);
+}
+
+static int
+kqueue_register(kq, kev, p)
+	struct kqueue *kq;
+	struct kevent *kev;
+	struct proc *p;
+{
+	struct filedesc *fdp = kq->kq_fdp;
+	struct filterops *fops;
+	struct file *fp = NULL;
+	struct knote *kn = NULL;
+	int s, error = 0;
+
+	if (kev->filter >= 0 || kev->filter + EVFILT_SYSCOUNT < 0)
+		return (EINVAL);
+	fops = sysfilt_ops[~kev->filter];
+
+	if (fops->f_isfd) {
+		if ((u_int)kev->ident >= fdp->fd_nfiles ||
+		    (fp = fdp->fd_ofiles[kev->ident]) == NULL ||
+		    (fdp->fd_ofileflags[kev->ident] & UF_RESERVED))
+			return (EBADF);
+		if (kev->ident < fdp->fd_knlistsize)
+			for (kn = fdp->fd_knlist[kev->ident].lh_first;
+			    kn != NULL; kn = kn->kn_link.le_next)
+				if (kn->kn_kq == kq &&
+				    kn->kn_filter == kev->filter)
+					break;
+	} else {
+		for (kn = kq->kq_knlist.lh_first; kn != NULL;
+		    kn = kn->kn_kqlink.le_next)
+			if (!kn->kn_fop->f_isfd &&
+			    kn->kn_id == kev->ident &&
+			    kn->kn_filter == kev->filter)
+				break;
+	}
+
+	if (kn == NULL && (kev->flags & EV_ADD) == 0)
+		return (ENOENT);
+
+	if (kev->flags & EV_ADD) {
+		if (kn == NULL) {
+			if (fops->f_isfd && kev->ident >= fdp->fd_knlistsize)
+				knote_fdgrow(fdp, kev->ident);
+			MALLOC_ZONE(kn, struct knote *, sizeof(*kn),
+			    M_KNOTE, M_WAITOK);
+			/*
+			 * We may have slept; make sure the descriptor
+			 * is still the one we looked up.
+			 */
+			if (fops->f_isfd &&
+			    fdp->fd_ofiles[kev->ident] != fp) {
+				FREE_ZONE(kn, sizeof(*kn), M_KNOTE);
+				return (EBADF);
+			}
+			bzero((caddr_t)kn, sizeof(*kn));
+			kn->kn_fp = fp;
+			kn->kn_kq = kq;
+			kn->kn_fop = fops;
+			kn->kn_sfflags = kev->fflags;
+			kn->kn_sdata = kev->data;
+			kev->fflags = 0;
+			kev->data = 0;
+			kn->kn_kevent = *kev;
+			knote_attach(kn, fdp);
+			if (error = fops->f_attach(kn)) {
+				knote_drop(kn);
+				return (error);
+			}
+		} else {
+			kn->kn_sfflags = kev->fflags;
+			kn->kn_sdata = kev->data;
+			kn->kn_kevent.udata = kev->udata;
+		}
+		s = splhigh();
+		if (kn->kn_fop->f_event(kn, 0))
+			knote_activate(kn);
+		splx(s);
+	} else if (kev->flags & EV_DELETE) {
+		kn->kn_fop->f_detach(kn);
+		knote_drop(kn);
+		return (0);
+	}
+
+	s = splhigh();
+	if (kev->flags & EV_DISABLE)
+		kn->kn_status |= KN_DISABLED;
+	if ((kev->flags & EV_ENABLE) && (kn->kn_status & KN_DISABLED)) {
+		kn->kn_status &= ~KN_DISABLED;
+		if ((kn->kn_status & (KN_ACTIVE | KN_QUEUED)) == KN_ACTIVE)
+			knote_enqueue(kn);
+	}
+	splx(s);
+	return (0);
+}
+
+/*
+ * Collect up to maxevents events.  A marker is put at the tail of the
+ * active list so that level triggered knotes, which are put back on
+ * the tail as they are returned, are seen at most once per call.
+ */
+static int
+kqueue_scan(fp, maxevents, ulistp, tsp, retval, p)
+	struct file *fp;
+	int maxevents;
+	struct kevent *ulistp;
+	struct timespec *tsp;
+	register_t *retval;
+	struct proc *p;
+{
+	struct kqueue *kq = (struct kqueue *)fp->f_data;
+	struct kevent kev[KQ_NEVENTS], *kevp;
+	struct knote *kn, marker;
+	struct timeval atv;
+	int s, count, timo, nkev, error = 0;
+
+	count = maxevents;
+	nkev = 0;
+	if (count <= 0)
+		goto done;
+
+	if (tsp != NULL) {
+		TIMESPEC_TO_TIMEVAL(&atv, tsp);
+		if (itimerfix(&atv)) {
+			error = EINVAL;
+			goto done;
+		}
+		s = splhigh();
+		timeradd(&atv, &time, &atv);
+		timo = hzto(&atv);
+		splx(s);
+	} else
+		timo = 0;
+
+	bzero((caddr_t)&marker, sizeof (marker));
+	marker.kn_status = KN_MARKER;
+retry:
+	kevp = kev;
+	s = splhigh();
+	if (kq->kq_count == 0) {
+		/* this should be timercmp(&time, &atv, >=) */
+		if (tsp && (time.tv_sec > atv.tv_sec ||
+		    time.tv_sec == atv.tv_sec && time.tv_usec >= atv.tv_usec)) {
+			splx(s);
+			goto done;
+		}
+		/*
+		 * A zero timeout polls.
+		 */
+		if (tsp && timo == 0) {
+			splx(s);
+			goto done;
+		}
+		kq->kq_state |= KQ_SLEEP;
+		error = tsleep((caddr_t)kq, PSOCK | PCATCH, "kqread", timo);
+		splx(s);
+		if (error == 0)
+			goto retry;
+		/* kevent is not restarted after signals... */
+		if (error == ERESTART)
+			error = EINTR;
+		else if (error == EWOULDBLOCK)
+			error = 0;
+		goto done;
+	}
+
+	TAILQ_INSERT_TAIL(&kq->kq_head, &marker, kn_tqe);
+	while (count) {
+		kn = kq->kq_head.tqh_first;
+		TAILQ_REMOVE(&kq->kq_head, kn, kn_tqe);
+		if (kn == &marker) {
+			splx(s);
+			if (count == maxevents)
+				goto retry;
+			goto done;
+		}
+		if (kn->kn_status & KN_MARKER) {
+			/* another scan's marker, left while it was at spl0 */
+			TAILQ_INSERT_TAIL(&kq->kq_head, kn, kn_tqe);
+			continue;
+		}
+		if (kn->kn_status & KN_DISABLED) {
+			kn->kn_status &= ~KN_QUEUED;
+			kq->kq_count--;
+			continue;
+		}
+		if ((kn->kn_flags & EV_ONESHOT) == 0 &&
+		    kn->kn_fop->f_event(kn, 0) == 0) {
+			kn->kn_status &= ~(KN_QUEUED | KN_ACTIVE);
+			kq->kq_count--;
+			continue;
+		}
+		*kevp++ = kn->kn_kevent;
+		nkev++;
+		if (kn->kn_flags & EV_ONESHOT) {
+			kn->kn_status &= ~KN_QUEUED;
+			kq->kq_count--;
+			splx(s);
+			kn->kn_fop->f_detach(kn);
+			knote_drop(kn);
+			s = splhigh();
+		} else if (kn->kn_flags & EV_CLEAR) {
+			kn->kn_data = 0;
+			kn->kn_fflags = 0;
+			kn->kn_status &= ~(KN_QUEUED | KN_ACTIVE);
+			kq->kq_count--;
+		} else
+			TAILQ_INSERT_TAIL(&kq->kq_head, kn, kn_tqe);
+		count--;
+		if (nkev == KQ_NEVENTS) {
+			splx(s);
+			error = copyout((caddr_t)kev, (caddr_t)ulistp,
+			    sizeof (struct kevent) * nkev);
+			ulistp += nkev;
+			nkev = 0;
+			kevp = kev;
+			s = splhigh();
+			if (error)
+				break;
+		}
+	}
+	TAILQ_REMOVE(&kq->kq_head, &marker, kn_tqe);
+	splx(s);
+done:
+	if (nkev != 0 && error == 0)
+		error = copyout((caddr_t)kev, (caddr_t)ulistp,
+		    sizeof (struct kevent) * nkev);
+	*retval = maxevents - count;
+	return (error);
+}
+
+/*ARGSUSED*/
+static int
+kqueue_read(fp, uio, cred)
+	struct file *fp;
+	struct uio *uio;
+	struct ucred *cred;
+{
+
+	return (ENXIO);
+}
+
+/*ARGSUSED*/
+static int
+kqueue_write(fp, uio, cred)
+	struct file *fp;
+	struct uio *uio;
+	struct ucred *cred;
+{
+
+	return (ENXIO);
+}
+
+/*ARGSUSED*/
+static int
+kqueue_ioctl(fp, com, data, p)
+	struct file *fp;
+	u_long com;
+	caddr_t data;
+	struct proc *p;
+{
+
+	return (ENOTTY);
+}
+
+/*
+ * A kqueue selects as readable when it has events pending, so it
+ * can itself be waited on with select.
+ */
+static int
+kqueue_select(fp, which, p)
+	struct file *fp;
+	int which;
+	struct proc *p;
+{
+	struct kqueue *kq = (struct kqueue *)fp->f_data;
+	int s, retnum = 0;
+
+	if (which != FREAD)
+		return (0);
+	s = splhigh();
+	if (kq->kq_count)
+		retnum = 1;
+	else {
+		selrecord(p, &kq->kq_sel);
+		kq->kq_state |= KQ_SEL;
+	}
+	splx(s);
+	return (retnum);
+}
+
+int
+kqueue_stat(fp, st)
+	struct file *fp;
+	struct stat *st;
+{
+	struct kqueue *kq = (struct kqueue *)fp->f_data;
+
+	bzero((caddr_t)st, sizeof (*st));
+	st->st_size = kq->kq_count;
+	st->st_blksize = sizeof (struct kevent);
+	st->st_mode = S_IFIFO;
+	return (0);
+}
+
+/*ARGSUSED*/
+static int
+kqueue_close(fp, p)
+	struct file *fp;
+	struct proc *p;
+{
+	struct kqueue *kq = (struct kqueue *)fp->f_data;
+	struct knote *kn;
+
+	while ((kn = kq->kq_knlist.lh_first) != NULL) {
+		kn->kn_fop->f_detach(kn);
+		knote_drop(kn);
+	}
+	FREE_ZONE(kq, sizeof(*kq), M_KQUEUE);
+	fp->f_data = NULL;
+	return (0);
+}
+
+static void
+kqueue_wakeup(kq)
+	struct kqueue *kq;
+{
+
+	if (kq->kq_state & KQ_SLEEP) {
+		kq->kq_state &= ~KQ_SLEEP;
+		wakeup((caddr_t)kq);
+	}
+	if (kq->kq_state & KQ_SEL) {
+		kq->kq_state &= ~KQ_SEL;
+		selwakeup(&kq->kq_sel);
+	}
+}
+
+/*
+ * Walk down a list of knotes, activating them if their event has
+ * triggered.  A filter may take its knote off the list (process
+ * exit does), so the next pointer is fetched first.
+ */
+void
+knote(list, hint)
+	struct klist *list;
+	long hint;
+{
+	struct knote *kn, *next;
+
+	for (kn = list->lh_first; kn != NULL; kn = next) {
+		next = kn->kn_selnext.le_next;
+		if (kn->kn_fop->f_event(kn, hint))
+			knote_activate(kn);
+	}
+}
+
+/*
+ * Remove all knotes referencing a descriptor that is being closed.
+ */
+void
+knote_fdclose(fdp, fd)
+	struct filedesc *fdp;
+	int fd;
+{
+	struct klist *list = &fdp->fd_knlist[fd];
+	struct knote *kn;
+
+	while ((kn = list->lh_first) != NULL) {
+		kn->kn_fop->f_detach(kn);
+		knote_drop(kn);
+	}
+}
+
+/*
+ * Make fd_knlist big enough to index fd.  The list heads move, so
+ * the first knote on each list has its back pointer fixed up.
+ */
+static void
+knote_fdgrow(fdp, fd)
+	struct filedesc *fdp;
+	int fd;
+{
+	struct klist *list;
+	int size, i, s;
+
+	size = fdp->fd_knlistsize ? fdp->fd_knlistsize : KQEXTENT;
+	while (size <= fd)
+		size *= 2;
+	MALLOC(list, struct klist *, size * sizeof(struct klist),
+	    M_KQUEUE, M_WAITOK);
+	s = splhigh();
+	if (fdp->fd_knlistsize > fd) {
+		/* someone else grew it while we slept */
+		splx(s);
+		FREE(list, M_KQUEUE);
+		return;
+	}
+	bzero((caddr_t)list, size * sizeof(struct klist));
+	for (i = 0; i < fdp->fd_knlistsize; i++) {
+		list[i] = fdp->fd_knlist[i];
+		if (list[i].lh_first != NULL)
+			list[i].lh_first->kn_link.le_prev = &list[i].lh_first;
+	}
+	if (fdp->fd_knlist != NULL)
+		FREE(fdp->fd_knlist, M_KQUEUE);
+	fdp->fd_knlist = list;
+	fdp->fd_knlistsize = size;
+	splx(s);
+}
+
+static void
+knote_attach(kn, fdp)
+	struct knote *kn;
+	struct filedesc *fdp;
+{
+	struct kqueue *kq = kn->kn_kq;
+	int s;
+
+	s = splhigh();
+	if (kn->kn_fop->f_isfd)
+		LIST_INSERT_HEAD(&fdp->fd_knlist[kn->kn_id], kn, kn_link);
+	LIST_INSERT_HEAD(&kq->kq_knlist, kn, kn_kqlink);
+	splx(s);
+}
+
+/*
+ * Take a knote off its queue and descriptor lists and free it.
+ * The filter's detach routine must already have run.
+ */
+static void
+knote_drop(kn)
+	struct knote *kn;
+{
+	int s;
+
+	s = splhigh();
+	if (kn->kn_fop->f_isfd)
+		LIST_REMOVE(kn, kn_link);
+	LIST_REMOVE(kn, kn_kqlink);
+	if (kn->kn_status & KN_QUEUED)
+		knote_dequeue(kn);
+	splx(s);
+	FREE_ZONE(kn, sizeof(*kn), M_KNOTE);
+}
+
+static void
+knote_activate(kn)
+	struct knote *kn;
+{
+	int s;
+
+	s = splhigh();
+	kn->kn_status |= KN_ACTIVE;
+	if ((kn->kn_status & (KN_QUEUED | KN_DISABLED)) == 0)
+		knote_enqueue(kn);
+	splx(s);
+}
+
+static void
+knote_enqueue(kn)
+	struct knote *kn;
+{
+	struct kqueue *kq = kn->kn_kq;
+
+	TAILQ_INSERT_TAIL(&kq->kq_head, kn, kn_tqe);
+	kn->kn_status |= KN_QUEUED;
+	kq->kq_count++;
+	kqueue_wakeup(kq);
+}
+
+static void
+knote_dequeue(kn)
+	struct knote *kn;
+{
+	struct kqueue *kq = kn->kn_kq;
+
+	TAILQ_REMOVE(&kq->kq_head, kn, kn_tqe);
+	kn->kn_status &= ~KN_QUEUED;
+	kq->kq_count--;
+}
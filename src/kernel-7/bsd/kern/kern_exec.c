@@ -133,6 +133,7 @@
 #include <kern/thread.h>
 
 #include <mach/vm_param.h>
+#include <vm/vm_fault.h>
 #include <vm/vm_map.h>
 #include <vm/vm_object.h>
 #include <vm/vnode_pager.h>
@@ -486,6 +487,7 @@ again:
 		error = load_return_to_errno(lret);
 		goto bad;
 	}
+	vm_fault_stat_add(execs, 1);
 
 	/*
 	 * deal with set[ug]id.
@@ -284,6 +284,11 @@ exit1(p, rv)
 		}
 	}
 
+	/*
+	 * Notify any kqueues watching us; this detaches their knotes.
+	 */
+	KNOTE(&p->p_klist, NOTE_EXIT);
+
 	/*
 	 * Notify parent that we're gone.
 	 */
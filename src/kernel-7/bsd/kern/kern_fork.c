@@ -335,6 +335,7 @@ again:
 	LIST_INSERT_HEAD(&allproc, p2, p_list);
 	LIST_INSERT_HEAD(PIDHASH(p2->p_pid), p2, p_hash);
 	TAILQ_INIT(&p2->p_evlist);
+	LIST_INIT(&p2->p_klist);
 	/*
 	 * Make child runnable, set start time.
 	 */
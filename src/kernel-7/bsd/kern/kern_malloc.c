@@ -77,6 +77,7 @@
 #include <sys/namei.h>
 #include <sys/file.h>
 #include <sys/filedesc.h>
+#include <sys/eventvar.h>
 #include <sys/tty.h>
 
 #include <ufs/ufs/quota.h>
@@ -192,6 +193,10 @@ struct kmzones {
 	0,		KMZ_MALLOC,		/* 77 M_HFSEXT */
 	0,		KMZ_MALLOC,		/* 78 M_VOLFS */
 	0,		KMZ_MALLOC,		/* 79 M_TEMP */
+	SOS(kqueue),	KMZ_CREATEZONE,		/* 80 M_KQUEUE */
+	SOS(knote),	KMZ_CREATEZONE,		/* 81 M_KNOTE */
+	0,		KMZ_MALLOC,		/* 82 M_DIRHASH */
+	0,		KMZ_MALLOC,		/* 83 M_SOFTDEP */
 #undef	SOS
 #undef	SOX
 };
@@ -132,6 +132,17 @@ vm_sysctl(name, namelen, oldp, oldlenp, newp, newlen, p)
 		loadinfo.ldavg[2] = mach_factor[2];
 		loadinfo.fscale = LSCALE;
 		return (sysctl_struct(oldp, oldlenp, newp, newlen, &loadinfo, sizeof(struct loadavg)));
+	case VM_ZMAGAZINE: {
+		extern int zone_magazines_enabled;
+		extern void zone_magazine_enable();
+
+		level = zone_magazines_enabled;
+		if ((error = sysctl_int(oldp, oldlenp, newp, newlen, &level)) ||
+		    newp == NULL)
+			return (error);
+		zone_magazine_enable(level != 0);
+		return (0);
+	}
 	case VM_METER:
 		return (EOPNOTSUPP);
 	case VM_MAXID:
@@ -449,30 +449,41 @@ select(p, uap, retval)
 	register struct select_args *uap;
 	register_t *retval;
 {
-	fd_set ibits[3], obits[3];
+	fd_mask sbits[6 * howmany(FD_SETSIZE, NFDBITS)];
+	fd_mask *bits, *ibits, *obits;
 	struct timeval atv;
 	int s, ncoll, error = 0, timo;
-	u_int ni;
+	u_int ni, nw;
 	struct thread *th;
 	struct uthread	*uth;
 
 	th = current_thread();
 	uth = th->_uthread;
 
-	bzero((caddr_t)ibits, sizeof(ibits));
-	bzero((caddr_t)obits, sizeof(obits));
-
-	if (uap->nd > FD_SETSIZE)
-		return (EINVAL);
 	if (uap->nd > p->p_fd->fd_nfiles) {
 		/* forgiving; slightly wrong */
 		uap->nd = p->p_fd->fd_nfiles;
 	}
-	ni = howmany(uap->nd, NFDBITS) * sizeof(fd_mask);
+	nw = howmany(uap->nd, NFDBITS);
+	ni = nw * sizeof(fd_mask);
+
+	/*
+	 * The three input and three output sets are kept nw words
+	 * apart.  They fit on the stack up to FD_SETSIZE descriptors;
+	 * past that, up to the size of the descriptor table, they
+	 * are allocated.
+	 */
+	if (6 * ni <= sizeof (sbits))
+		bits = sbits;
+	else
+		MALLOC(bits, fd_mask *, 6 * ni, M_TEMP, M_WAITOK);
+	bzero((caddr_t)bits, 6 * ni);
+	ibits = bits;
+	obits = bits + 3 * nw;
 
 #define	getbits(name, x) \
 	if (uap->name && (error = copyin((caddr_t)uap->name, \
-	    (caddr_t)&ibits[x], ni))) \
+	    (caddr_t)&ibits[(x) * nw], ni))) \
 		goto done;
 	getbits(in, 0);
 	getbits(ou, 1);
@@ -531,7 +542,7 @@ done:
 	if (error == EWOULDBLOCK)
 		error = 0;
 #define	putbits(name, x) \
-	if (uap->name && (error2 = copyout((caddr_t)&obits[x], \
+	if (uap->name && (error2 = copyout((caddr_t)&obits[(x) * nw], \
 	    (caddr_t)uap->name, ni))) \
 		error = error2;
 	if (error == 0) {
@@ -542,12 +553,14 @@ done:
 		putbits(ex, 2);
 #undef putbits
 	}
+	if (bits != sbits)
+		FREE(bits, M_TEMP);
 	return (error);
 }
 
 selscan(p, ibits, obits, nfd, retval)
 	struct proc *p;
-	fd_set *ibits, *obits;
+	fd_mask *ibits, *obits;
 	int nfd;
 	register_t *retval;
 {
@@ -555,12 +568,12 @@ selscan(p, ibits, obits, nfd, retval)
 	register int msk, i, j, fd;
 	register fd_mask bits;
 	struct file *fp;
-	int n = 0;
+	int n = 0, nw = howmany(nfd, NFDBITS);
 	static int flag[3] = { FREAD, FWRITE, 0 };
 
 	for (msk = 0; msk < 3; msk++) {
 		for (i = 0; i < nfd; i += NFDBITS) {
-			bits = ibits[msk].fds_bits[i/NFDBITS];
+			bits = ibits[msk * nw + i/NFDBITS];
 			while ((j = ffs(bits)) && (fd = i + --j) < nfd) {
 				bits &= ~(1 << j);
 				fp = fdp->fd_ofiles[fd];
@@ -568,7 +581,8 @@ selscan(p, ibits, obits, nfd, retval)
 								UF_RESERVED))
 					return (EBADF);
 				if ((*fp->f_ops->fo_select)(fp, flag[msk], p)) {
-					FD_SET(fd, &obits[msk]);
+					obits[msk * nw + fd/NFDBITS] |=
+					    (1 << (fd % NFDBITS));
 					n++;
 				}
 			}
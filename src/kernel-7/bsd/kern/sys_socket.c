@@ -67,6 +67,7 @@
 #include <sys/socketvar.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
+#include <sys/event.h>
 
 #include <net/if.h>
 #include <net/route.h>
@@ -199,6 +200,118 @@ soo_select(fp, which, p)
 	return (0);
 }
 
+/*
+ * kqueue filters for sockets (and so for pipes, which are socket
+ * pairs).  The knotes hang off so_klist and are re-evaluated by
+ * sowakeup(); they report the same conditions as soo_select, with
+ * the byte count (or queued connection count) in data.
+ */
+static void	filt_sordetach __P((struct knote *kn));
+static int	filt_soread __P((struct knote *kn, long hint));
+static int	filt_solisten __P((struct knote *kn, long hint));
+static int	filt_sowrite __P((struct knote *kn, long hint));
+
+static struct filterops soread_filtops =
+	{ 1, NULL, filt_sordetach, filt_soread };
+static struct filterops solisten_filtops =
+	{ 1, NULL, filt_sordetach, filt_solisten };
+static struct filterops sowrite_filtops =
+	{ 1, NULL, filt_sordetach, filt_sowrite };
+
+int
+soo_kqfilter(fp, kn)
+	struct file *fp;
+	struct knote *kn;
+{
+	register struct socket *so = (struct socket *)fp->f_data;
+	int s;
+
+	switch (kn->kn_filter) {
+	case EVFILT_READ:
+		if (so->so_options & SO_ACCEPTCONN)
+			kn->kn_fop = &solisten_filtops;
+		else
+			kn->kn_fop = &soread_filtops;
+		break;
+	case EVFILT_WRITE:
+		kn->kn_fop = &sowrite_filtops;
+		break;
+	default:
+		return (EINVAL);
+	}
+	s = splnet();
+	LIST_INSERT_HEAD(&so->so_klist, kn, kn_selnext);
+	splx(s);
+	return (0);
+}
+
+static void
+filt_sordetach(kn)
+	struct knote *kn;
+{
+	int s = splnet();
+
+	LIST_REMOVE(kn, kn_selnext);
+	splx(s);
+}
+
+/*ARGSUSED*/
+static int
+filt_soread(kn, hint)
+	struct knote *kn;
+	long hint;
+{
+	register struct socket *so = (struct socket *)kn->kn_fp->f_data;
+
+	kn->kn_data = so->so_rcv.sb_cc;
+	if (so->so_state & SS_CANTRCVMORE) {
+		kn->kn_flags |= EV_EOF;
+		kn->kn_fflags = so->so_error;
+		return (1);
+	}
+	if (so->so_error)
+		return (1);
+	if (kn->kn_sfflags & NOTE_LOWAT)
+		return (kn->kn_data >= kn->kn_sdata);
+	return (kn->kn_data >= so->so_rcv.sb_lowat);
+}
+
+/*ARGSUSED*/
+static int
+filt_solisten(kn, hint)
+	struct knote *kn;
+	long hint;
+{
+	register struct socket *so = (struct socket *)kn->kn_fp->f_data;
+
+	kn->kn_data = so->so_qlen;
+	return (so->so_qlen != 0);
+}
+
+/*ARGSUSED*/
+static int
+filt_sowrite(kn, hint)
+	struct knote *kn;
+	long hint;
+{
+	register struct socket *so = (struct socket *)kn->kn_fp->f_data;
+
+	kn->kn_data = sbspace(&so->so_snd);
+	if (so->so_state & SS_CANTSENDMORE) {
+		kn->kn_flags |= EV_EOF;
+		kn->kn_fflags = so->so_error;
+		return (1);
+	}
+	if (so->so_error)
+		return (1);
+	if ((so->so_state & SS_ISCONNECTED) == 0 &&
+	    (so->so_proto->pr_flags & PR_CONNREQUIRED))
+		return (0);
+	if (kn->kn_sfflags & NOTE_LOWAT)
+		return (kn->kn_data >= kn->kn_sdata);
+	return (kn->kn_data >= so->so_snd.sb_lowat);
+}
+
 int
 soo_stat(so, ub)
 	register struct socket *so;
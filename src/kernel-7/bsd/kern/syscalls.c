@@ -292,5 +292,8 @@ char *syscallnames[] = {
 	 */
 	"watchevent",		/* 231 = watchevent */
 	"waitevent",		/* 232 = waitevent */
-	"modwatch"			/* 233 = modwatch */
+	"modwatch",			/* 233 = modwatch */
+	"kqueue",		/* 234 = kqueue */
+	"kevent",		/* 235 = kevent */
+	"sendfile"		/* 236 = sendfile */
 };
@@ -67,6 +67,50 @@
 #include <sys/protosw.h>
 #include <sys/domain.h>
 #include <net/netisr.h>
+#include <cpus.h>
+#include <kern/cpu_number.h>
+
+/*
+ * Per-processor cache of free mbufs and clusters, in front of the
+ * global free lists.  Allocation and free use the current
+ * processor's cache at splimp, and only take MBUF_LOCK to move a
+ * batch to or from the global lists.  A cache is refilled with a
+ * batch when empty and gives a batch back when it holds more than
+ * its high mark.
+ *
+ * Cache hits, and the cache's changes to the mbuf type counts and
+ * the free cluster count, are kept in the cache.  They are added to
+ * mbstat under MBUF_LOCK at each refill and drain, so mbstat may lag
+ * by a few batches.  Types of MT_MAX and over are rare and go
+ * straight to mbstat.
+ */
+#define	MBCACHE_BATCH	16		/* mbufs moved at a time */
+#define	MBCACHE_HIGH	(2 * MBCACHE_BATCH)
+#define	MCLCACHE_BATCH	4		/* clusters moved at a time */
+#define	MCLCACHE_HIGH	(2 * MCLCACHE_BATCH)
+
+struct mbcache {
+	struct	mbuf *mc_mbufs;		/* free mbufs */
+	union	mcluster *mc_clusters;	/* free clusters */
+	int	mc_nmbufs;
+	int	mc_nclusters;
+	u_long	mc_hits;		/* not yet in mbstat */
+	u_long	mc_clhits;
+	int	mc_clfree;
+	short	mc_mtypes[MT_MAX];
+};
+
+#define	MBCACHE()	(&mbcache[cpu_number()])
+
+#define	MBCOUNT(mc, type, n) {						\
+	if ((type) < MT_MAX)						\
+		(mc)->mc_mtypes[type] += (n);				\
+	else {								\
+		MBUF_LOCK();						\
+		mbstat.m_mtypes[type] += (n);				\
+		MBUF_UNLOCK();						\
+	}								\
+}
 
 struct mbuf 	*mfree;		/* mbuf free list */
 struct	mbuf *mfreelater;	/* mbuf deallocation list */
@@ -80,6 +124,7 @@ int		max_protohdr;	/* largest protocol header */
 int		max_hdr;	/* largest link+protocol header */
 int		max_datalen;	/* MHLEN - max_hdr */
 struct mbstat 	mbstat;		/* statistics */
+struct mbcache	mbcache[NCPUS];	/* per-processor free mbufs, clusters */
 union mcluster 	*mbutl;		/* first mapped cluster address */
 union 	mcluster embutl;	/* virtual address of mclusters */
 
@@ -87,6 +132,9 @@ static int 	nclpp;		/* # clusters per physical page */
 static char	mbfail[] = "mbuf not mapped";
 
 static int m_howmany();
+static struct mbuf *m_mbufrefill();
+static union mcluster *m_clrefill();
+static void m_cachedrain();
 
 /* The number of cluster mbufs that are allocated, to start. */
 #define MINCL	max(16, 2)
@@ -169,6 +217,208 @@ out:
 	return 0;
 }
 
+/*
+ * Add a processor cache's counts to mbstat.
+ * Called with MBUF_LOCK held.
+ */
+static void
+m_cachesync(mc)
+	register struct mbcache *mc;
+{
+	register int i;
+
+	mbstat.m_cachehits += mc->mc_hits;
+	mbstat.m_clcachehits += mc->mc_clhits;
+	mc->mc_hits = mc->mc_clhits = 0;
+	mbstat.m_clfree += mc->mc_clfree;
+	mc->mc_clfree = 0;
+	for (i = 0; i < MT_MAX; i++) {
+		mbstat.m_mtypes[i] += mc->mc_mtypes[i];
+		mc->mc_mtypes[i] = 0;
+	}
+}
+
+/*
+ * Refill a processor's empty mbuf cache with a batch from the
+ * global free list, and return the first mbuf (0 if there are none).
+ * Must be called at splimp.
+ */
+static struct mbuf *
+m_mbufrefill(mc)
+	register struct mbcache *mc;
+{
+	register struct mbuf *m;
+
+	MBUF_LOCK();
+	m_cachesync(mc);
+	while (mc->mc_nmbufs < MBCACHE_BATCH && (m = mfree) != 0) {
+		mfree = m->m_next;
+		m->m_next = mc->mc_mbufs;
+		mc->mc_mbufs = m;
+		mc->mc_nmbufs++;
+	}
+	if (mc->mc_mbufs)
+		mbstat.m_refills++;
+	MBUF_UNLOCK();
+	return (mc->mc_mbufs);
+}
+
+/*
+ * As above, for clusters.  The global list is grown first if
+ * m_clalloc thinks it should be.
+ * Must be called at splimp.
+ */
+static union mcluster *
+m_clrefill(mc, nowait)
+	register struct mbcache *mc;
+	int nowait;
+{
+	register union mcluster *mcl;
+
+	MBUF_LOCK();
+	m_cachesync(mc);
+	(void)m_clalloc(MCLCACHE_BATCH, nowait);
+	while (mc->mc_nclusters < MCLCACHE_BATCH && (mcl = mclfree) != 0) {
+		mclfree = mcl->mcl_next;
+		mcl->mcl_next = mc->mc_clusters;
+		mc->mc_clusters = mcl;
+		mc->mc_nclusters++;
+	}
+	if (mc->mc_clusters)
+		mbstat.m_clrefills++;
+	MBUF_UNLOCK();
+	return (mc->mc_clusters);
+}
+
+/*
+ * Give a processor's surplus mbufs and clusters back to the global
+ * free lists, leaving a batch of each.  If anyone is waiting for an
+ * mbuf, give back everything, since the waiter may be on another
+ * processor.
+ * Must be called at splimp.
+ */
+static void
+m_cachedrain(mc)
+	register struct mbcache *mc;
+{
+	register struct mbuf *m;
+	register union mcluster *mcl;
+	int keep, want;
+
+	MBUF_LOCK();
+	m_cachesync(mc);
+
+	keep = m_want ? 0 : MBCACHE_BATCH;
+	if (mc->mc_nmbufs > keep) {
+		while (mc->mc_nmbufs > keep) {
+			m = mc->mc_mbufs;
+			mc->mc_mbufs = m->m_next;
+			m->m_next = mfree;
+			mfree = m;
+			mc->mc_nmbufs--;
+		}
+		mbstat.m_drains++;
+	}
+	keep = m_want ? 0 : MCLCACHE_BATCH;
+	if (mc->mc_nclusters > keep) {
+		while (mc->mc_nclusters > keep) {
+			mcl = mc->mc_clusters;
+			mc->mc_clusters = mcl->mcl_next;
+			mcl->mcl_next = mclfree;
+			mclfree = mcl;
+			mc->mc_nclusters--;
+		}
+		mbstat.m_cldrains++;
+	}
+	want = m_want;
+	m_want = 0;
+	MBUF_UNLOCK();
+	if (want)
+		wakeup((caddr_t)&mfree);
+}
+
+/*
+ * Take an mbuf of the given type from the current processor's cache,
+ * refilling the cache if it is empty.  Returns 0 if there are no free
+ * mbufs; MGET then calls m_retry.
+ */
+struct mbuf *
+m_cacheget(type)
+	int type;
+{
+	register struct mbcache *mc;
+	register struct mbuf *m;
+	int s;
+
+	s = splimp();
+	mc = MBCACHE();
+	if ((m = mc->mc_mbufs) != 0)
+		mc->mc_hits++;
+	else
+		m = m_mbufrefill(mc);
+	if (m) {
+		MCHECK(m);
+		++mclrefcnt[mtocl(m)];
+		MBCOUNT(mc, MT_FREE, -1);
+		MBCOUNT(mc, type, 1);
+		mc->mc_mbufs = m->m_next;
+		mc->mc_nmbufs--;
+	}
+	splx(s);
+	return (m);
+}
+
+/*
+ * Take a cluster from the current processor's cache, refilling the
+ * cache if it is empty.  Returns 0 if there are no free clusters.
+ */
+caddr_t
+m_clcacheget(how)
+	int how;
+{
+	register struct mbcache *mc;
+	register union mcluster *mcl;
+	int s;
+
+	s = splimp();
+	mc = MBCACHE();
+	if ((mcl = mc->mc_clusters) != 0)
+		mc->mc_clhits++;
+	else
+		mcl = m_clrefill(mc, how);
+	if (mcl) {
+		++mclrefcnt[mtocl(mcl)];
+		mc->mc_clfree--;
+		mc->mc_clusters = mcl->mcl_next;
+		mc->mc_nclusters--;
+	}
+	splx(s);
+	return ((caddr_t)mcl);
+}
+
+/*
+ * Drop a reference to a cluster, freeing it into the current
+ * processor's cache if it was the last.
+ */
+void
+m_clcachefree(p)
+	caddr_t p;
+{
+	register struct mbcache *mc;
+	int s;
+
+	s = splimp();
+	mc = MBCACHE();
+	if (MCLUNREF(p)) {
+		((union mcluster *)p)->mcl_next = mc->mc_clusters;
+		mc->mc_clusters = (union mcluster *)p;
+		mc->mc_clfree++;
+		if (++mc->mc_nclusters > MCLCACHE_HIGH)
+			m_cachedrain(mc);
+	}
+	splx(s);
+}
+
 /*
  * Add more free mbufs by cutting up a cluster.
  */
@@ -315,26 +565,31 @@ m_getclr(nowait, type)
 	return (m);
 }
 
-struct mbuf *
-m_free(m)
-	struct mbuf *m;
+/*
+ * Free one mbuf, and its cluster if this was the last reference,
+ * into the given processor cache.  Returns the next mbuf in the
+ * chain.  The caller drains the cache if it is over its high mark.
+ * Must be called at splimp.
+ */
+static struct mbuf *
+m_free_cached(mc, m)
+	register struct mbcache *mc;
+	register struct mbuf *m;
 {
 	struct mbuf *n = m->m_next;
-	int i, s;
 
 	if (m->m_type == MT_FREE)
 		panic("freeing free mbuf");
-	s = splimp();
-	MBUF_LOCK();
 	if (m->m_flags & M_EXT) {
 		if (MCLHASREFERENCE(m)) {
 			remque((queue_t)&m->m_ext.ext_refs);
 		} else if (m->m_ext.ext_free == NULL) {
-				union mcluster *mcl= (union mcluster *)m->m_ext.ext_buf;
-				if (MCLUNREF(mcl)) {
-				mcl->mcl_next = mclfree;
-				mclfree = mcl;
-				++mbstat.m_clfree;
+			union mcluster *mcl= (union mcluster *)m->m_ext.ext_buf;
+			if (MCLUNREF(mcl)) {
+				mcl->mcl_next = mc->mc_clusters;
+				mc->mc_clusters = mcl;
+				mc->mc_nclusters++;
+				mc->mc_clfree++;
 			} else	/* sanity check - not referenced this way */
 				panic("m_free m_ext cluster not free");
 		} else {
@@ -342,28 +597,57 @@ m_free(m)
 			    m->m_ext.ext_size, m->m_ext.ext_arg);
 		}
 	}
-	mbstat.m_mtypes[m->m_type]--;
+	MBCOUNT(mc, m->m_type, -1);
 	(void) MCLUNREF(m);
 	m->m_type = MT_FREE;
-	mbstat.m_mtypes[m->m_type]++;
+	MBCOUNT(mc, MT_FREE, 1);
 	m->m_flags = 0;
-	m->m_next = mfree;
+	m->m_next = mc->mc_mbufs;
 	m->m_len = 0;
-	mfree = m;
-	i = m_want;
-	m_want = 0;
-	MBUF_UNLOCK();
+	mc->mc_mbufs = m;
+	mc->mc_nmbufs++;
+	return (n);
+}
+
+struct mbuf *
+m_free(m)
+	struct mbuf *m;
+{
+	register struct mbcache *mc;
+	struct mbuf *n;
+	int s;
+
+	s = splimp();
+	mc = MBCACHE();
+	n = m_free_cached(mc, m);
+	if (mc->mc_nmbufs > MBCACHE_HIGH ||
+	    mc->mc_nclusters > MCLCACHE_HIGH || m_want)
+		m_cachedrain(mc);
 	splx(s);
-	if (i) wakeup((caddr_t)&mfree);
 	return (n);
 }
 
+/*
+ * Free a whole chain at once: one splimp, and at most one drain
+ * to the global lists.
+ */
 void
 m_freem(m)
 	register struct mbuf *m;
 {
+	register struct mbcache *mc;
+	int s;
+
+	if (m == 0)
+		return;
+	s = splimp();
+	mc = MBCACHE();
 	while (m)
-		m = m_free(m);
+		m = m_free_cached(mc, m);
+	if (mc->mc_nmbufs > MBCACHE_HIGH ||
+	    mc->mc_nclusters > MCLCACHE_HIGH || m_want)
+		m_cachedrain(mc);
+	splx(s);
 }
 
 /*
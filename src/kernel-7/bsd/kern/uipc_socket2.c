@@ -355,6 +355,7 @@ sowakeup(so, sb)
 
 	selwakeup(&sb->sb_sel);
 	sb->sb_flags &= ~SB_SEL;
+	KNOTE(&so->so_klist, 0);
 	if (sb->sb_flags & SB_WAIT) {
 		sb->sb_flags &= ~SB_WAIT;
 		wakeup((caddr_t)&sb->sb_cc);
@@ -58,6 +58,7 @@
  *	@(#)uipc_syscalls.c	8.6 (Berkeley) 2/14/95
  */
 
+#include <mach_nbc.h>
 #include <sys/param.h>
 #include <sys/systm.h>
 #include <sys/filedesc.h>
@@ -69,10 +70,14 @@
 #include <sys/protosw.h>
 #include <sys/socket.h>
 #include <sys/socketvar.h>
+#include <sys/uio.h>
+#include <sys/vnode.h>
+#include <sys/mount.h>
 #if KTRACE
 #include <sys/ktrace.h>
 #endif
 #include <sys/kernel.h>
+#include <kern/mapfs.h>
 
 #if NEXT
 #import <kern/kdebug.h>
@@ -699,6 +704,392 @@ bad:
 	return (error);
 }
 
+/*
+ * sendfile(fd, s, offset, nbytes, hdtr, sbytes, flags)
+ *
+ * Send nbytes of the regular file open on fd, starting at offset,
+ * down the connected stream socket s; nbytes of 0 means to the end of
+ * the file.  The iovecs in hdtr, if any, are sent before and after
+ * the file.  The total number of bytes sent is stored in *sbytes,
+ * also when the call fails or is interrupted part way.  No flags are
+ * defined yet.
+ *
+ * The file never passes through user space.  Blocks of a UFS file
+ * that are in the buffer cache are sent in place: the mbufs point
+ * into the buffer, which bufloan() keeps from being recycled until
+ * the protocol frees the last of them.  A block that is not cached is
+ * read in first; what still can't be lent is read into mbuf clusters
+ * with VOP_READ(), one copy instead of the two of read() and write().
+ * The file is queued a socket buffer's worth at a time, so no more of
+ * it is held in mbufs than a write() would hold.
+ */
+struct sendfile_args {
+	int	fd;
+	int	s;
+	off_t	offset;
+	size_t	nbytes;
+	struct	sf_hdtr *hdtr;
+	off_t	*sbytes;
+	int	flags;
+};
+
+#if MACH_NBC
+#define	SF_MAPPED(vp)	((vp)->v_vm_info && (vp)->v_vm_info->mapped)
+#else
+#define	SF_MAPPED(vp)	0
+#endif
+
+/*
+ * ext_free routine for mbufs pointing into a lent buffer.
+ */
+static void
+sf_buffree(buf, size, arg)
+	caddr_t buf;
+	u_int size;
+	caddr_t arg;
+{
+	bufunloan((struct buf *)arg);
+}
+
+/*
+ * Point m at the cached block holding off, if it can be lent.
+ * Returns the number of bytes attached, 0 if none.
+ */
+static long
+sf_loan(m, vp, off, resid, bsize)
+	struct mbuf *m;
+	struct vnode *vp;
+	off_t off;
+	long resid, bsize;
+{
+	struct buf *bp;
+	long boff = off % bsize;
+	long len;
+
+	if ((bp = bufloan(vp, (daddr_t)(off / bsize))) == NULL)
+		return (0);
+	if (boff >= bp->b_bcount) {
+		bufunloan(bp);
+		return (0);
+	}
+	len = bp->b_bcount - boff;
+	if (len > resid)
+		len = resid;
+	/*
+	 * The external storage is exactly the data, so that nothing
+	 * sees leading or trailing space in it and writes into the
+	 * cached block.
+	 */
+	m->m_ext.ext_buf = bp->b_data + boff;
+	m->m_ext.ext_size = len;
+	m->m_ext.ext_free = sf_buffree;
+	m->m_ext.ext_arg = (caddr_t)bp;
+	m->m_ext.ext_refs.forward = m->m_ext.ext_refs.backward =
+	    &m->m_ext.ext_refs;
+	m->m_flags |= M_EXT;
+	m->m_data = m->m_ext.ext_buf;
+	m->m_len = len;
+	return (len);
+}
+
+/*
+ * Read up to len bytes at off into buf.  Returns the count read in
+ * *readp; 0 means end of file.
+ */
+static int
+sf_read(p, vp, off, buf, len, readp)
+	struct proc *p;
+	struct vnode *vp;
+	off_t off;
+	caddr_t buf;
+	long len, *readp;
+{
+	struct uio auio;
+	struct iovec aiov;
+	int error;
+
+	aiov.iov_base = buf;
+	aiov.iov_len = len;
+	auio.uio_iov = &aiov;
+	auio.uio_iovcnt = 1;
+	auio.uio_offset = off;
+	auio.uio_resid = len;
+	auio.uio_segflg = UIO_SYSSPACE;
+	auio.uio_rw = UIO_READ;
+	auio.uio_procp = p;
+	vn_lock(vp, LK_EXCLUSIVE | LK_RETRY, p);
+#if MACH_NBC
+	if (SF_MAPPED(vp))
+		error = mapfs_io(vp, &auio, UIO_READ, 0, p->p_ucred);
+	else
+#endif /* MACH_NBC */
+		error = VOP_READ(vp, &auio, 0, p->p_ucred);
+	VOP_UNLOCK(vp, 0, p);
+	*readp = len - auio.uio_resid;
+	return (error);
+}
+
+/*
+ * Fill m with file data at off, at most resid bytes.  Returns the
+ * count in *lenp; 0 means end of file.
+ */
+static int
+sf_fill(p, m, vp, off, resid, lenp)
+	struct proc *p;
+	struct mbuf *m;
+	struct vnode *vp;
+	off_t off;
+	long resid, *lenp;
+{
+	long bsize, mlen, n;
+	char c;
+	int error;
+
+	bsize = vp->v_mount->mnt_stat.f_iosize;
+	if (vp->v_tag == VT_UFS && bsize > 0 && !SF_MAPPED(vp)) {
+		if ((*lenp = sf_loan(m, vp, off, resid, bsize)) > 0)
+			return (0);
+		/*
+		 * Not cached.  Reading a byte brings the block in,
+		 * along with whatever read-ahead the file system
+		 * starts; then try again.
+		 */
+		if (error = sf_read(p, vp, off, &c, 1L, &n))
+			return (error);
+		if (n == 0) {
+			*lenp = 0;
+			return (0);
+		}
+		if ((*lenp = sf_loan(m, vp, off, resid, bsize)) > 0)
+			return (0);
+	}
+
+	mlen = (m->m_flags & M_PKTHDR) ? MHLEN : MLEN;
+	if (resid >= MINCLSIZE) {
+		MCLGET(m, M_WAIT);
+		if (m->m_flags & M_EXT)
+			mlen = MCLBYTES;
+	}
+	if (mlen > resid)
+		mlen = resid;
+	error = sf_read(p, vp, off, mtod(m, caddr_t), mlen, lenp);
+	m->m_len = *lenp;
+	return (error);
+}
+
+/*
+ * Queue the file from off up to end on so.  *sent is advanced by
+ * the bytes handed to the protocol.
+ */
+static int
+sf_sendfile(p, so, vp, off, end, sent)
+	struct proc *p;
+	struct socket *so;
+	struct vnode *vp;
+	off_t off, end;
+	off_t *sent;
+{
+	struct mbuf *top, *m, **mp;
+	long space, len, n;
+	int error, s;
+
+restart:
+	if (error = sblock(&so->so_snd, M_WAIT))
+		return (error);
+	while (off < end) {
+		s = splnet();
+		if (so->so_state & SS_CANTSENDMORE) {
+			error = EPIPE;
+			splx(s);
+			break;
+		}
+		if (so->so_error) {
+			error = so->so_error;
+			splx(s);
+			break;
+		}
+		if ((so->so_state & SS_ISCONNECTED) == 0) {
+			error = ENOTCONN;
+			splx(s);
+			break;
+		}
+		space = sbspace(&so->so_snd);
+		if (space < end - off &&
+		    (space <= 0 || space < so->so_snd.sb_lowat)) {
+			if (so->so_state & SS_NBIO) {
+				error = EWOULDBLOCK;
+				splx(s);
+				break;
+			}
+			sbunlock(&so->so_snd);
+			error = sbwait(&so->so_snd);
+			splx(s);
+			if (error)
+				return (error);
+			goto restart;
+		}
+		splx(s);
+		if (space > end - off)
+			space = end - off;
+
+		top = NULL;
+		mp = &top;
+		for (len = 0; len < space; len += n) {
+			if (top == NULL) {
+				MGETHDR(m, M_WAIT, MT_DATA);
+				m->m_pkthdr.len = 0;
+				m->m_pkthdr.rcvif = (struct ifnet *)0;
+			} else
+				MGET(m, M_WAIT, MT_DATA);
+			if ((error = sf_fill(p, m, vp, off + len, space - len,
+			    &n)) || n == 0) {
+				m_free(m);
+				break;
+			}
+			*mp = m;
+			mp = &m->m_next;
+			top->m_pkthdr.len += n;
+		}
+		if (top == NULL)
+			break;
+		if (error) {
+			m_freem(top);
+			break;
+		}
+		if (off + len < end)
+			so->so_state |= SS_MORETOCOME;
+		s = splnet();
+		error = (*so->so_proto->pr_usrreq)(so, PRU_SEND, top,
+		    (struct mbuf *)0, (struct mbuf *)0);
+		splx(s);
+		so->so_state &= ~SS_MORETOCOME;
+		if (error)
+			break;
+		off += len;
+		*sent += len;
+		if (len < space)
+			/* the file got shorter */
+			break;
+	}
+	sbunlock(&so->so_snd);
+	return (error);
+}
+
+/*
+ * Send user iovecs on socket s for sendfile(), as writev() would.
+ * A short write leaves EWOULDBLOCK, so the file isn't sent after a
+ * header that only partly went out.
+ */
+static int
+sf_sendiov(p, s, uiov, iovcnt, sent)
+	struct proc *p;
+	int s;
+	struct iovec *uiov;
+	int iovcnt;
+	off_t *sent;
+{
+	struct msghdr msg;
+	struct iovec aiov[UIO_SMALLIOV], *iov;
+	register_t n;
+	long total;
+	int i, error;
+
+	if (iovcnt <= 0)
+		return (0);
+	if (iovcnt >= UIO_SMALLIOV) {
+		if (iovcnt >= UIO_MAXIOV)
+			return (EMSGSIZE);
+		MALLOC_ZONE(iov, struct iovec *,
+			sizeof(struct iovec) * iovcnt, M_IOV, M_WAITOK);
+	} else
+		iov = aiov;
+	if (error = copyin((caddr_t)uiov, (caddr_t)iov,
+	    (unsigned)(iovcnt * sizeof (struct iovec))))
+		goto done;
+	for (total = 0, i = 0; i < iovcnt; i++)
+		total += iov[i].iov_len;
+	bzero((caddr_t)&msg, sizeof (msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = iovcnt;
+	n = 0;
+	if ((error = sendit(p, s, &msg, 0, &n)) == 0) {
+		*sent += n;
+		if (n < total)
+			error = EWOULDBLOCK;
+	}
+done:
+	if (iov != aiov)
+		FREE_ZONE(iov, sizeof (struct iovec) * iovcnt, M_IOV);
+	return (error);
+}
+
+int
+sendfile(p, uap, retval)
+	struct proc *p;
+	register struct sendfile_args *uap;
+	register_t *retval;
+{
+	struct file *fp, *sfp;
+	struct vnode *vp;
+	struct socket *so;
+	struct sf_hdtr hdtr;
+	struct vattr vattr;
+	off_t end, sent = 0;
+	int error, error2;
+
+	if (error = fdgetf(p, uap->fd, &fp))
+		return (error);
+	if (fp->f_type != DTYPE_VNODE || (fp->f_flag & FREAD) == 0)
+		return (EBADF);
+	vp = (struct vnode *)fp->f_data;
+	if (vp->v_type != VREG || uap->offset < 0 || uap->flags != 0)
+		return (EINVAL);
+	if (error = getsock(p, uap->s, &sfp))
+		return (error);
+	so = (struct socket *)sfp->f_data;
+	if (so->so_type != SOCK_STREAM)
+		return (EINVAL);
+	if (uap->hdtr) {
+		if (error = copyin((caddr_t)uap->hdtr, (caddr_t)&hdtr,
+		    sizeof (hdtr)))
+			return (error);
+	} else
+		bzero((caddr_t)&hdtr, sizeof (hdtr));
+
+	/* hold the vnode; fd may be closed while we sleep */
+	VREF(vp);
+	if (error = sf_sendiov(p, uap->s, hdtr.headers, hdtr.hdr_cnt, &sent))
+		goto done;
+
+	vn_lock(vp, LK_EXCLUSIVE | LK_RETRY, p);
+	error = VOP_GETATTR(vp, &vattr, p->p_ucred, p);
+	VOP_UNLOCK(vp, 0, p);
+	if (error)
+		goto done;
+	end = vattr.va_size;
+	if (uap->nbytes != 0 && uap->offset + uap->nbytes < end)
+		end = uap->offset + uap->nbytes;
+	if (uap->offset < end &&
+	    (error = sf_sendfile(p, so, vp, uap->offset, end, &sent))) {
+		if (error == EPIPE)
+			psignal(p, SIGPIPE);
+		goto done;
+	}
+
+	error = sf_sendiov(p, uap->s, hdtr.trailers, hdtr.trl_cnt, &sent);
+done:
+	vrele(vp);
+	/* restarting would send the headers and file again */
+	if (error == ERESTART && sent > 0)
+		error = EINTR;
+	if (uap->sbytes &&
+	    (error2 = copyout((caddr_t)&sent, (caddr_t)uap->sbytes,
+	    sizeof (off_t))) && error == 0)
+		error = error2;
+	*retval = 0;
+	return (error);
+}
+
 struct recvfrom_args {
 	int	s;
 	caddr_t	buf;
@@ -395,6 +395,10 @@ fdesc_attr(fd, vap, cred, p)
 		}
 		break;
 
+	case DTYPE_KQUEUE:
+		error = EBADF;
+		break;
+
 	default:
 		panic("fdesc attr");
 		break;
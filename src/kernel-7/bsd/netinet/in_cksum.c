@@ -111,6 +111,22 @@ in_cksum(m, len)
 	return (~sum & 0xffff);
 }
 
+/*
+ * Copy len bytes from src to dst, returning their 16-bit
+ * ones-complement sum (not complemented) as if they began at
+ * an even offset in the packet.  The sum is taken from dst
+ * straight after the copy, while the data is in the cache.
+ */
+u_int
+in_cksum_copy(src, dst, len)
+	caddr_t src;
+	caddr_t dst;
+	int len;
+{
+	bcopy(src, dst, len);
+	return (xsum_assym((u_short *)dst, len, 0, 0));
+}
+
 #else
 
 
@@ -233,4 +249,39 @@ in_cksum(m, len)
 	return (~sum & 0xffff);
 }
 
+/*
+ * Copy len bytes from src to dst, returning their 16-bit
+ * ones-complement sum (not complemented) as if they began at
+ * an even offset in the packet.  Each byte is loaded once.
+ */
+u_int
+in_cksum_copy(src, dst, len)
+	caddr_t src;
+	caddr_t dst;
+	register int len;
+{
+	register u_char *s = (u_char *)src, *d = (u_char *)dst;
+	register u_long sum = 0;
+	union {
+		u_char	c[2];
+		u_short	s;
+	} s_util;
+
+	for (; len > 1; len -= 2) {
+		s_util.c[0] = d[0] = s[0];
+		s_util.c[1] = d[1] = s[1];
+		sum += s_util.s;
+		s += 2;
+		d += 2;
+	}
+	if (len) {
+		s_util.c[0] = d[0] = s[0];
+		s_util.c[1] = 0;
+		sum += s_util.s;
+	}
+	sum = (sum >> 16) + (sum & 0xffff);
+	sum += sum >> 16;
+	return (sum & 0xffff);
+}
+
 #endif
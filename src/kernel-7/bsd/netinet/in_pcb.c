@@ -69,6 +69,7 @@
 #include <sys/errno.h>
 #include <sys/time.h>
 #include <sys/proc.h>
+#include <sys/sysctl.h>
 
 #include <net/if.h>
 #include <net/route.h>
@@ -147,12 +148,104 @@ lport_hash_insert(inp)
 
 
 
+/*
+ * Hash a connection 4-tuple.  The old sum of ports and foreign address
+ * put every client of one busy local port into a handful of chains;
+ * folding and multiplying spreads the low bits the mask keeps.
+ */
+static u_long
+in_pcbhash_key(l_addr, l_port, f_addr, f_port)
+	u_long	l_addr;
+	u_short	l_port;
+	u_long	f_addr;
+	u_short	f_port;
+{
+	register u_long	key;
+
+	key = f_addr ^ l_addr ^ (((u_long)f_port << 16) | l_port);
+	key ^= key >> 16;
+	key *= 0x9e3779b1;
+	return (key ^ (key >> 15));
+}
+
+/*
+ * Ports are kept in network order; fold the high byte in so that the
+ * low well-known ports do not all land in bucket 0 on little-endian.
+ */
+#define	INP_WILDHASH_KEY(l_port)	((l_port) ^ ((l_port) >> 8))
+
+#define	in_pcbhash_table(inp) \
+	(((inp)->inp_flags & INP_WILDHASH) ? \
+	 (inp)->hash_str->wild_hash_str : (inp)->hash_str)
+
+static u_long
+in_pcbhash_index(inp, table)
+	register struct inpcb *inp;
+	register struct inpcb_hash_str *table;
+{
+	if (inp->inp_flags & INP_WILDHASH)
+		return (INP_WILDHASH_KEY(inp->inp_lport) & table->hash_mask);
+
+	return (in_pcbhash_key(inp->inp_laddr.s_addr, inp->inp_lport,
+			       inp->inp_faddr.s_addr, inp->inp_fport) &
+		table->hash_mask);
+}
+
+/*
+ * Double the bucket count of a table and rehash its pcbs.  Called from
+ * hash_insert() at splnet, so the allocation must not block; if memory
+ * is short the table simply stays at its current size until the next
+ * insert tries again.
+ */
+static void
+in_pcbhash_grow(table)
+	register struct inpcb_hash_str *table;
+{
+	struct inpcb		*(*new_array)[];
+	struct inpcb		*(*old_array)[];
+	register struct inpcb	*inp, *next;
+	register u_long		i, h_idx, old_n;
+
+	old_n = table->n_elements;
+	new_array = (struct inpcb *(*)[])
+		_MALLOC(2 * old_n * sizeof (struct inpcb *), M_PCB, M_NOWAIT);
+	if (new_array == NULL)
+		return;
+	bzero((caddr_t)new_array, 2 * old_n * sizeof (struct inpcb *));
+
+	old_array = table->hash_array;
+	table->hash_array = new_array;
+	table->n_elements = 2 * old_n;
+	table->hash_mask = table->n_elements - 1;
+
+	for (i = 0; i < old_n; i++) {
+		for (inp = (*old_array)[i]; inp != 0; inp = next) {
+			next = inp->hash_next;
+
+			h_idx = in_pcbhash_index(inp, table);
+			inp->hash_prev = 0;
+			inp->hash_next = (*new_array)[h_idx];
+			if (inp->hash_next)
+				inp->hash_next->hash_prev = inp;
+			(*new_array)[h_idx] = inp;
+			inp->hash_element = h_idx;
+		}
+	}
+	table->n_resizes++;
+
+	_FREE(old_array, M_PCB);
+}
+
 void
 hash_remove(inp)
         register struct inpcb *inp;
 {
-	if ((*inp->hash_str->hash_array)[inp->hash_element] == inp)
-		(*inp->hash_str->hash_array)[inp->hash_element] = inp->hash_next;
+	register struct inpcb_hash_str *table;
+
+	table = in_pcbhash_table(inp);
+
+	if ((*table->hash_array)[inp->hash_element] == inp)
+		(*table->hash_array)[inp->hash_element] = inp->hash_next;
 
 	if (inp->hash_prev) 
 	        inp->hash_prev->hash_next = inp->hash_next;
@@ -163,32 +256,56 @@ hash_remove(inp)
 	inp->hash_next = 0;
 	inp->hash_prev = 0;
 	inp->hash_element = -1;
+	inp->inp_flags &= ~INP_WILDHASH;
+	table->n_entries--;
 }
 
 
 
+/*
+ * Hash a pcb by its current addresses.  Connected pcbs go into the
+ * 4-tuple table, listening and unconnected ones into the wildcard
+ * table.  A pcb already hashed on the right side is left alone; one
+ * that was connected or disconnected since it was hashed is moved.
+ */
 void
 hash_insert(inp)
         register struct inpcb *inp;
 {
+	register struct inpcb_hash_str *table;
         register u_long	h_idx;
+	int		wild;
 
-	if (inp->hash_element != -1)
-	        return;
+	wild = (inp->inp_faddr.s_addr == INADDR_ANY &&
+		inp->hash_str->wild_hash_str != NULL);
 
-	h_idx = (inp->inp_lport + inp->inp_fport + inp->inp_faddr.s_addr) & inp->hash_str->hash_mask;
+	if (inp->hash_element != -1) {
+		if (wild == ((inp->inp_flags & INP_WILDHASH) != 0))
+		        return;
+		hash_remove(inp);
+	}
 
-	if ((*inp->hash_str->hash_array)[h_idx]) {
-	        (*inp->hash_str->hash_array)[h_idx]->hash_prev = inp;
-		inp->hash_next = (*inp->hash_str->hash_array)[h_idx];
+	if (wild)
+		inp->inp_flags |= INP_WILDHASH;
+	table = in_pcbhash_table(inp);
+
+	h_idx = in_pcbhash_index(inp, table);
+
+	if ((*table->hash_array)[h_idx]) {
+	        (*table->hash_array)[h_idx]->hash_prev = inp;
+		inp->hash_next = (*table->hash_array)[h_idx];
 		inp->hash_prev = 0;
-		(*inp->hash_str->hash_array)[h_idx] = inp;
+		(*table->hash_array)[h_idx] = inp;
 	} else {
-	        (*inp->hash_str->hash_array)[h_idx] = inp;
+	        (*table->hash_array)[h_idx] = inp;
 		inp->hash_next = 0;
 		inp->hash_prev = 0;
 	}
 	inp->hash_element = h_idx;
+
+	if (++table->n_entries > INP_HASH_LOADFACTOR * table->n_elements &&
+	    table->n_elements < table->max_elements)
+		in_pcbhash_grow(table);
 }
 
 
@@ -199,7 +316,8 @@ struct inpcb *inet_hash1(hash_str, l_addr, l_port, f_addr, f_port)
 	u_long	f_addr;
 	u_short	f_port;
 {
-	return ((*hash_str->hash_array)[(l_port + f_port + f_addr) & hash_str->hash_mask]);
+	return ((*hash_str->hash_array)[in_pcbhash_key(l_addr, l_port, f_addr, f_port) &
+					 hash_str->hash_mask]);
 }
 
 
@@ -212,6 +330,80 @@ struct inpcb *inet_lport_hash1(lport_hash_str, l_port)
 }
 
 
+struct inpcb *inet_wild_hash1(hash_str, l_port)
+	struct inpcb_hash_str *hash_str;
+	u_short  l_port;
+{
+	register struct inpcb_hash_str *wild = hash_str->wild_hash_str;
+
+	return ((*wild->hash_array)[INP_WILDHASH_KEY(l_port) & wild->hash_mask]);
+}
+
+
+/*
+ * Allocate the buckets of a pcb hash table.  n_elements and
+ * max_elements must be powers of 2; pass the same value for both
+ * to get a table that never grows.
+ */
+int
+in_pcbhash_init(table, n_elements, max_elements)
+	struct inpcb_hash_str *table;
+	u_long	n_elements;
+	u_long	max_elements;
+{
+	table->hash_array = (struct inpcb *(*)[])
+		_MALLOC(n_elements * sizeof (struct inpcb *), M_PCB, M_WAITOK);
+	if (table->hash_array == NULL)
+		return (ENOBUFS);
+	bzero((caddr_t)table->hash_array, n_elements * sizeof (struct inpcb *));
+
+	table->n_elements = n_elements;
+	table->hash_mask = n_elements - 1;
+	table->max_elements = max_elements;
+	table->n_entries = 0;
+	table->n_resizes = 0;
+	bzero((caddr_t)table->depth, sizeof (table->depth));
+	return (0);
+}
+
+
+/*
+ * Return the statistics of a pcb hash table to sysctl.
+ */
+int
+in_pcbhash_sysctl(table, oldp, oldlenp, newp, newlen)
+	struct inpcb_hash_str *table;
+	void *oldp;
+	size_t *oldlenp;
+	void *newp;
+	size_t newlen;
+{
+	struct inpcb_hash_stats	ihs;
+	register struct inpcb	*inp;
+	register u_long		i, len;
+	int			s;
+
+	bzero((caddr_t)&ihs, sizeof (ihs));
+
+	s = splnet();
+	ihs.ihs_buckets = table->n_elements;
+	ihs.ihs_maxbuckets = table->max_elements;
+	ihs.ihs_entries = table->n_entries;
+	ihs.ihs_resizes = table->n_resizes;
+	for (i = 0; i < table->n_elements; i++) {
+		len = 0;
+		for (inp = (*table->hash_array)[i]; inp != 0; inp = inp->hash_next)
+			len++;
+		if (len > ihs.ihs_longest)
+			ihs.ihs_longest = len;
+	}
+	bcopy((caddr_t)table->depth, (caddr_t)ihs.ihs_depth, sizeof (ihs.ihs_depth));
+	splx(s);
+
+	return (sysctl_rdstruct(oldp, oldlenp, newp, &ihs, sizeof (ihs)));
+}
+
+
 
 int
 in_pcballoc(so, head, hash_str, lport_hash_str)
@@ -888,3 +1080,90 @@ hash_in_pcblookup(head, faddr, fport_arg, laddr, lport_arg)
 #endif
         return (inp);
 }
+
+
+
+static void
+in_pcbhash_depth(table, checked)
+	struct inpcb_hash_str *table;
+	register u_long checked;
+{
+	register int	i;
+
+	if (checked < 4)
+		i = checked;
+	else if (checked < 8)
+		i = 4;
+	else if (checked < 16)
+		i = 5;
+	else if (checked < 32)
+		i = 6;
+	else
+		i = INP_HASH_NDEPTH - 1;
+	table->depth[i]++;
+}
+
+
+/*
+ * Find the pcb for an incoming packet: an exact match in the 4-tuple
+ * table, or, with INPLOOKUP_WILDCARD, the best listening or unconnected
+ * pcb on the local port from the wildcard table.  The number of pcbs
+ * examined in each table goes into that table's depth histogram.
+ */
+struct inpcb *
+in_pcblookup_hash(hash_str, faddr, fport_arg, laddr, lport_arg, flags)
+	struct inpcb_hash_str *hash_str;
+	struct in_addr faddr, laddr;
+	u_int fport_arg, lport_arg;
+	int flags;
+{
+	register struct inpcb *inp, *match;
+	register struct inpcb_hash_str *wild;
+	u_short fport = fport_arg, lport = lport_arg;
+	register u_long checked = 0;
+
+	KERNEL_DEBUG(DBG_FNC_PCB_HLOOKUP | DBG_FUNC_START, 0,0,0,0,0);
+
+	inp = inet_hash1(hash_str, laddr.s_addr, lport, faddr.s_addr, fport);
+	for (; inp != 0; inp = inp->hash_next) {
+	        checked++;
+		if (inp->inp_lport == lport && inp->inp_laddr.s_addr == laddr.s_addr &&
+		    inp->inp_faddr.s_addr == faddr.s_addr && inp->inp_fport == fport)
+		        break;
+	}
+	in_pcbhash_depth(hash_str, checked);
+
+	if (inp || (flags & INPLOOKUP_WILDCARD) == 0 ||
+	    (wild = hash_str->wild_hash_str) == NULL) {
+		KERNEL_DEBUG(DBG_FNC_PCB_HLOOKUP | DBG_FUNC_END, checked,inp,0,0,0);
+		return (inp);
+	}
+
+	/*
+	 * Everything in the wildcard table has no foreign address, so the
+	 * only question is whether the local address is bound; a pcb bound
+	 * to this very address beats one bound to INADDR_ANY.
+	 */
+	match = 0;
+	checked = 0;
+	inp = inet_wild_hash1(hash_str, lport);
+	for (; inp != 0; inp = inp->hash_next) {
+	        checked++;
+		if (inp->inp_lport != lport)
+			continue;
+		if (inp->inp_faddr.s_addr != INADDR_ANY &&
+		    (inp->inp_faddr.s_addr != faddr.s_addr ||
+		     inp->inp_fport != fport))
+			continue;
+		if (inp->inp_laddr.s_addr == laddr.s_addr) {
+			match = inp;
+			break;
+		}
+		if (inp->inp_laddr.s_addr == INADDR_ANY && match == 0)
+			match = inp;
+	}
+	in_pcbhash_depth(wild, checked);
+
+	KERNEL_DEBUG(DBG_FNC_PCB_HLOOKUP | DBG_FUNC_END, checked,match,0,0,1);
+	return (match);
+}
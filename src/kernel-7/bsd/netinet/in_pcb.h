@@ -59,10 +59,43 @@
  */
 
 
+/*
+ * Lookup depth histogram buckets: the number of pcbs examined by one
+ * hashed lookup, counted as 0, 1, 2, 3, 4-7, 8-15, 16-31 and 32 or more.
+ */
+#define	INP_HASH_NDEPTH		8
+
+/*
+ * A pcb hash table.  The connection table of a protocol is keyed on the
+ * full 4-tuple and doubles in size whenever it holds more than
+ * INP_HASH_LOADFACTOR pcbs per bucket, up to max_elements buckets.
+ * Listening and unconnected pcbs live in the companion wildcard table
+ * hung off wild_hash_str, keyed on the local port alone.
+ */
+#define	INP_HASH_LOADFACTOR	2
+
 struct	inpcb_hash_str {
 	struct	inpcb		*(*hash_array)[];
 	u_long			hash_mask;
-	u_long			n_elements;
+	u_long			n_elements;	/* buckets, power of 2 */
+	u_long			max_elements;	/* growth limit */
+	u_long			n_entries;	/* pcbs in the table */
+	u_long			n_resizes;	/* times the table grew */
+	struct	inpcb_hash_str	*wild_hash_str;	/* listening/unconnected pcbs */
+	u_long			depth[INP_HASH_NDEPTH];	/* lookup depths */
+};
+
+/*
+ * Hash table statistics, as returned by the TCPCTL_PCBHASH,
+ * TCPCTL_PCBWILD, UDPCTL_PCBHASH and UDPCTL_PCBWILD sysctls.
+ */
+struct	inpcb_hash_stats {
+	u_long	ihs_buckets;		/* current bucket count */
+	u_long	ihs_maxbuckets;		/* bucket count growth limit */
+	u_long	ihs_entries;		/* pcbs in the table */
+	u_long	ihs_resizes;		/* times the table grew */
+	u_long	ihs_longest;		/* longest chain right now */
+	u_long	ihs_depth[INP_HASH_NDEPTH];	/* lookup depth histogram */
 };
 
 
@@ -108,6 +141,7 @@ struct inpcb {
 #define	INP_HDRINCL		0x08	/* user supplies entire IP header */
 #define INP_NOLOOKUP            0x10    /* don't need to re-issue lookup in 'in_pcbconnect' */
                                         /* we've already failed to find this address in tcp_input */ 
+#define	INP_WILDHASH		0x20	/* hashed in the wildcard table */
 
 #define	INPLOOKUP_WILDCARD	1
 #define	INPLOOKUP_SETLOCAL	2
@@ -149,4 +183,12 @@ struct inpcb *
 	 hash_in_pcblookup __P((struct inpcb *,
 	    struct in_addr, u_int, struct in_addr, u_int));
 
+struct inpcb *inet_wild_hash1 __P((struct inpcb_hash_str *, u_short));
+struct inpcb *
+	 in_pcblookup_hash __P((struct inpcb_hash_str *,
+	    struct in_addr, u_int, struct in_addr, u_int, int));
+int	 in_pcbhash_init __P((struct inpcb_hash_str *, u_long, u_long));
+int	 in_pcbhash_sysctl __P((struct inpcb_hash_str *,
+	    void *, size_t *, void *, size_t));
+
 #endif
@@ -403,22 +403,8 @@ tcp_input(m, iphlen)
 	 * Locate pcb for segment.
 	 */
 findpcb:
-        inp = inet_hash1(&tcp_hash_str, ti->ti_dst.s_addr, ti->ti_dport,
-			ti->ti_src.s_addr, ti->ti_sport);
-	inp = hash_in_pcblookup(inp, ti->ti_src, ti->ti_sport,
-				     ti->ti_dst, ti->ti_dport);
-	if (inp == 0) {
-findpcb_nolookup:
-		inp = inet_hash1(&tcp_hash_str, 0, ti->ti_dport,0,0);
-	        inp = hash_in_pcbwild(inp,
-				      ti->ti_src, ti->ti_sport,
-				      ti->ti_dst, ti->ti_dport, INPLOOKUP_WILDCARD);
-/*
-		if (inp == 0)
-		        inp = in_pcblookup(&tcb, ti->ti_src, ti->ti_sport,
-					         ti->ti_dst, ti->ti_dport, INPLOOKUP_WILDCARD);
-*/
-	}
+	inp = in_pcblookup_hash(&tcp_hash_str, ti->ti_src, ti->ti_sport,
+				ti->ti_dst, ti->ti_dport, INPLOOKUP_WILDCARD);
 	/*
 	 * If the state is CLOSED (i.e., TCB does not exist) then
 	 * all data in the incoming segment is discarded.
@@ -1033,7 +1019,7 @@ trimthenstep6:
 			    SEQ_GT(ti->ti_seq, tp->rcv_nxt)) {
 				iss = tp->snd_nxt + TCP_ISSINCR;
 				tp = tcp_close(tp);
-				goto findpcb_nolookup;
+				goto findpcb;
 			}
 			/*
 			 * If window is closed can only take segments at
@@ -103,6 +103,50 @@ extern struct mbuf *m_copypack();
 
 #define MAX_TCPOPTLEN	32	/* max # bytes that go in options */
 
+/*
+ * m_copydata() that sums the data as it copies it (see
+ * in_cksum_copy()), so that the payload of a small segment
+ * is only read once.  If odd is set the data lies at an odd
+ * offset in the segment and the partial sums are swapped to
+ * match.  The result is unfolded and not complemented.
+ */
+static u_long
+tcp_copydata_cksum(m, off, len, cp, odd)
+	register struct mbuf *m;
+	register int off;
+	register int len;
+	caddr_t cp;
+	int odd;
+{
+	register unsigned count;
+	register u_int psum;
+	u_long sum = 0;
+
+	while (off > 0) {
+		if (m == 0)
+			panic("tcp_copydata_cksum");
+		if (off < m->m_len)
+			break;
+		off -= m->m_len;
+		m = m->m_next;
+	}
+	while (len > 0) {
+		if (m == 0)
+			panic("tcp_copydata_cksum");
+		count = min(m->m_len - off, len);
+		psum = in_cksum_copy(mtod(m, caddr_t) + off, cp, count);
+		if (odd)
+			psum = ((psum << 8) | (psum >> 8)) & 0xffff;
+		sum += psum;
+		odd ^= count & 1;
+		len -= count;
+		cp += count;
+		off = 0;
+		m = m->m_next;
+	}
+	return (sum);
+}
+
 /*
  * Tcp output routine: figure out what should be sent and send it.
  */
@@ -118,6 +162,8 @@ tcp_output(tp)
 	u_char opt[MAX_TCPOPTLEN];
 	unsigned optlen, hdrlen;
 	int idle, sendalot;
+	u_long datasum;
+	int fused;
 
 
 
@@ -384,6 +430,7 @@ send:
 	 * be transmitted, and initialize the header from
 	 * the template for sends on this connection.
 	 */
+	fused = 0;
 	if (len) {
 		if (tp->t_force && len == 1)
 			tcpstat.tcps_sndprobe++;
@@ -423,6 +470,8 @@ send:
 			m1 = so->so_snd.sb_mb;
 			off1 = off;
 			len1 = len;
+			datasum = 0;
+			fused = 1;
 
 			for (;;) {			
 			        for (cur_len = 0, m2 = m1; m2; m2 = m2->m_next)
@@ -430,7 +479,8 @@ send:
 				if (off1 < cur_len) {
 				        cur_len = min(cur_len - off1, len1);
 
-					m_copydata(m1, off1, (int) cur_len, p);
+					datasum += tcp_copydata_cksum(m1, off1,
+					    (int) cur_len, p, (len - len1) & 1);
 
 					if ((len1 -= cur_len) == 0)
 					        break;
@@ -576,7 +626,17 @@ send:
 	if (len + optlen)
 		ti->ti_len = htons((u_short)(sizeof (struct tcphdr) +
 		    optlen + len));
-	ti->ti_sum = in_cksum(m, (int)(hdrlen + len));
+	if (fused) {
+		/*
+		 * The data was summed as it was copied in;
+		 * add in the header (hdrlen is even).
+		 */
+		datasum += ~in_cksum(m, (int)hdrlen) & 0xffff;
+		datasum = (datasum >> 16) + (datasum & 0xffff);
+		datasum += datasum >> 16;
+		ti->ti_sum = ~datasum & 0xffff;
+	} else
+		ti->ti_sum = in_cksum(m, (int)(hdrlen + len));
 
 	/*
 	 * In transmit state, time the transmission and arrange for
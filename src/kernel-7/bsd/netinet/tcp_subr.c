@@ -86,8 +86,9 @@
 
 #include <kern/kdebug.h>
 
-extern struct	inpcb	*tcp_hash_array[];
 extern struct	inpcb	*tcp_lport_hash_array[];
+extern struct	inpcb_hash_str	tcp_hash_str;
+extern struct	inpcb_hash_str	tcp_wild_hash_str;
 
 
 #if KDEBUG
@@ -160,11 +161,14 @@ tcp_init()
     int i;
 
 	tcp_iss = random();	/* wrong, but better than a constant */
-	for (i=0; i < N_TCP_HASH_ELEMENTS; i++) 
-	    tcp_hash_array[i]    = 0;
+	if (in_pcbhash_init(&tcp_hash_str, N_TCP_HASH_ELEMENTS,
+			    TCP_HASH_MAX_ELEMENTS) ||
+	    in_pcbhash_init(&tcp_wild_hash_str, N_TCP_WILD_HASH_ELEMENTS,
+			    N_TCP_WILD_HASH_ELEMENTS))
+	    panic("tcp_init: no memory for pcb hash tables");
 
 #if DELACK_BITMASK_ON
-	for (i=0; i < (N_TCP_HASH_ELEMENTS / 32); i++)
+	for (i=0; i < (N_TCP_DELACK_BITS / 32); i++)
 	    delack_bitmask[i] = 0;
 #endif
 	for (i=0; i < N_TCP_LPORT_HASH_ELEMENTS; i++) 
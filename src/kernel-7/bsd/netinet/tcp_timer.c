@@ -102,15 +102,16 @@ int	tcp_maxidle;
 extern	int tcp_maxpersistidle;
 #endif /* TUBA_INCLUDE */
 
-extern struct	inpcb	*tcp_hash_array[];
+extern struct	inpcb_hash_str	tcp_hash_str;
 
 struct	inpcb	time_wait_slots[N_TIME_WAIT_SLOTS];
 int		cur_tw_slot = 0;
 
 #if DELACK_BITMASK_ON
-u_long		delack_bitmask[N_TCP_HASH_ELEMENTS / 32];
+u_long		delack_bitmask[N_TCP_DELACK_BITS / 32];
 u_long		current_active_connections = 0;
 u_long		last_active_conn_count = 0;
+static u_long	delack_resizes = 0;	/* tcp_hash_str.n_resizes last tick */
 
 #endif
 
@@ -152,6 +153,7 @@ tcp_fasttimo()
     register u_long			i,j;
     register u_long			temp_mask;
     register u_long			elem_base = 0;
+    register u_long			b;
 #endif
     int s = splnet();
 
@@ -163,23 +165,37 @@ tcp_fasttimo()
 
 #if DELACK_BITMASK_ON
 
+    /*
+     * Bits set before the connection table grew name the old buckets,
+     * so after a resize fall back to the full scan for one tick.
+     */
+    if (tcp_hash_str.n_resizes != delack_resizes) {
+	delack_resizes = tcp_hash_str.n_resizes;
+	for (i=0; i < (N_TCP_DELACK_BITS / 32); i++)
+	    delack_bitmask[i] = 0;
+	last_active_conn_count = 0;
+    }
+
     if ((current_active_connections > DELACK_BITMASK_THRESH) &&
 	(last_active_conn_count > DELACK_BITMASK_THRESH)) {
-	for (i=0; i < (N_TCP_HASH_ELEMENTS / 32); i++) {
+	for (i=0; i < (N_TCP_DELACK_BITS / 32); i++) {
 	    if (delack_bitmask[i]) {
 		temp_mask = 1;
 		for (j=0; j < 32; j++) {
 		    if (temp_mask & delack_bitmask[i]) {
-			inp = tcp_hash_array[elem_base + j];
-			for (; inp != 0; inp = inp->hash_next) {
+			for (b = elem_base + j; b < tcp_hash_str.n_elements;
+			     b += N_TCP_DELACK_BITS) {
+			    inp = (*tcp_hash_str.hash_array)[b];
+			    for (; inp != 0; inp = inp->hash_next) {
 #if KDEBUG
-			    checked++;
+				checked++;
 #endif
-			    if ((tp = (struct tcpcb *)inp->inp_ppcb) && (tp->t_flags & TF_DELACK)) {
-				tp->t_flags &= ~TF_DELACK;
-				tp->t_flags |= TF_ACKNOW;
-				tcpstat.tcps_delack++;
-				(void) tcp_output(tp);
+				if ((tp = (struct tcpcb *)inp->inp_ppcb) && (tp->t_flags & TF_DELACK)) {
+				    tp->t_flags &= ~TF_DELACK;
+				    tp->t_flags |= TF_ACKNOW;
+				    tcpstat.tcps_delack++;
+				    (void) tcp_output(tp);
+				}
 			    }
 			}
 		    }
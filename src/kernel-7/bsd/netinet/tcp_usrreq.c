@@ -87,14 +87,18 @@
 
 
 
-struct	inpcb	*tcp_hash_array[N_TCP_HASH_ELEMENTS];
 struct	inpcb   *tcp_lport_hash_array[N_TCP_LPORT_HASH_ELEMENTS];
-struct  inpcb_hash_str  tcp_hash_str = {tcp_hash_array,
-					TCP_HASH_MASK, 
-					N_TCP_HASH_ELEMENTS};
+
+/*
+ * The connection and wildcard tables are allocated by tcp_init().
+ */
+struct	inpcb_hash_str  tcp_wild_hash_str;
+struct  inpcb_hash_str  tcp_hash_str = {0, 0, 0, 0, 0, 0,
+					&tcp_wild_hash_str};
 
 struct	inpcb_hash_str  tcp_lport_hash_str = {tcp_lport_hash_array,
 					      TCP_LPORT_HASH_MASK,
+					      N_TCP_LPORT_HASH_ELEMENTS,
 					      N_TCP_LPORT_HASH_ELEMENTS};
 
 
@@ -590,3 +594,32 @@ tcp_usrclosed(tp)
 		soisdisconnected(tp->t_inpcb->inp_socket);
 	return (tp);
 }
+
+/*
+ * Sysctl for tcp variables.
+ */
+int
+tcp_sysctl(name, namelen, oldp, oldlenp, newp, newlen)
+	int *name;
+	u_int namelen;
+	void *oldp;
+	size_t *oldlenp;
+	void *newp;
+	size_t newlen;
+{
+	/* All sysctl names at this level are terminal. */
+	if (namelen != 1)
+		return (ENOTDIR);
+
+	switch (name[0]) {
+	case TCPCTL_PCBHASH:
+		return (in_pcbhash_sysctl(&tcp_hash_str, oldp, oldlenp,
+					  newp, newlen));
+	case TCPCTL_PCBWILD:
+		return (in_pcbhash_sysctl(&tcp_wild_hash_str, oldp, oldlenp,
+					  newp, newlen));
+	default:
+		return (ENOPROTOOPT);
+	}
+	/* NOTREACHED */
+}
@@ -64,19 +64,23 @@
 
 #define N_TIME_WAIT_SLOTS	120
 
-#define N_TCP_HASH_ELEMENTS	(8 * 1024)         /* must be power of 2 */
-#define TCP_HASH_MASK           (N_TCP_HASH_ELEMENTS - 1)
+#define N_TCP_HASH_ELEMENTS	(1024)		   /* initial size, power of 2 */
+#define TCP_HASH_MAX_ELEMENTS	(64 * 1024)	   /* growth limit, power of 2 */
+#define N_TCP_WILD_HASH_ELEMENTS	(256)	   /* listening pcbs, power of 2 */
 #define N_TCP_LPORT_HASH_ELEMENTS	(1024)
 #define TCP_LPORT_HASH_MASK		(N_TCP_LPORT_HASH_ELEMENTS - 1)
 
 /*
- * The macro below takes a value from 0 - 8192 and sets a corresponding bit in the
- * 1024 byte delack_bitmask array. Each bit represents represents one of the
- * hash-queue entries in the TCP hash queue array.
+ * The macro below takes a hash-queue index and sets the corresponding bit in the
+ * 1024 byte delack_bitmask array.  The connection table can grow past
+ * N_TCP_DELACK_BITS buckets, so bit n stands for every bucket whose index
+ * is congruent to n modulo N_TCP_DELACK_BITS.
  */
+#define N_TCP_DELACK_BITS	(8 * 1024)
 
 #define TCP_DELACK_BITSET(hash_elem)	\
-			delack_bitmask[((hash_elem) >> 5)] |= 1 << ((hash_elem) & 0x1F)
+			delack_bitmask[(((hash_elem) & (N_TCP_DELACK_BITS - 1)) >> 5)] |= \
+			    1 << ((hash_elem) & 0x1F)
 
 #define DELACK_BITMASK_ON	1
 #define DELACK_BITMASK_THRESH	300
@@ -281,6 +285,19 @@ struct	tcpstat {
 	u_long	tcps_badsyn;		/* bogus SYN, e.g. premature ACK */
 };
 
+/*
+ * Names for TCP sysctl objects
+ */
+#define	TCPCTL_PCBHASH		1	/* connection hash statistics */
+#define	TCPCTL_PCBWILD		2	/* listen hash statistics */
+#define	TCPCTL_MAXID		3
+
+#define	TCPCTL_NAMES { \
+	{ 0, 0 }, \
+	{ "pcbhash", CTLTYPE_STRUCT }, \
+	{ "pcbwild", CTLTYPE_STRUCT }, \
+}
+
 #ifdef _KERNEL
 extern struct	inpcb tcb;		/* head of queue of active tcpcb's */
 extern struct	tcpstat tcpstat;	/* tcp statistics */
@@ -315,6 +332,7 @@ void	 tcp_respond __P((struct tcpcb *,
 	    struct tcpiphdr *, struct mbuf *, u_long, u_long, int));
 void	 tcp_setpersist __P((struct tcpcb *));
 void	 tcp_slowtimo __P((void));
+int	 tcp_sysctl __P((int *, u_int, void *, size_t *, void *, size_t));
 struct tcpiphdr *
 	 tcp_template __P((struct tcpcb *));
 struct tcpcb *
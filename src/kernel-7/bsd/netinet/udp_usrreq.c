@@ -97,8 +97,9 @@
 #endif
 
 
-#define N_UDP_HASH_ELEMENTS	(2 * 1024)         /* must be power of 2 */
-#define UDP_HASH_MASK           (N_UDP_HASH_ELEMENTS - 1)
+#define N_UDP_HASH_ELEMENTS	(256)		   /* initial size, power of 2 */
+#define UDP_HASH_MAX_ELEMENTS	(16 * 1024)	   /* growth limit, power of 2 */
+#define N_UDP_WILD_HASH_ELEMENTS	(256)	   /* unconnected pcbs, power of 2 */
 #define N_UDP_LPORT_HASH_ELEMENTS	(1024)
 #define UDP_LPORT_HASH_MASK		(N_UDP_LPORT_HASH_ELEMENTS - 1)
 
@@ -117,14 +118,18 @@ struct	sockaddr_in udp_in = { sizeof(udp_in), AF_INET };
 struct	inpcb udb;
 struct	udpstat udpstat;
 
-struct	inpcb	*udp_hash_array[N_UDP_HASH_ELEMENTS];
 struct	inpcb	*udp_lport_hash_array[N_UDP_LPORT_HASH_ELEMENTS];
 
+/*
+ * The connection and wildcard tables are allocated by udp_init().
+ */
+struct  inpcb_hash_str  udp_wild_hash_str;
 struct  inpcb_hash_str  udp_hash_str = 
-		{udp_hash_array, UDP_HASH_MASK, N_UDP_HASH_ELEMENTS};
+		{0, 0, 0, 0, 0, 0, &udp_wild_hash_str};
 
 struct  inpcb_hash_str  udp_lport_hash_str =
-		{udp_lport_hash_array, UDP_LPORT_HASH_MASK, N_UDP_LPORT_HASH_ELEMENTS};
+		{udp_lport_hash_array, UDP_LPORT_HASH_MASK, N_UDP_LPORT_HASH_ELEMENTS,
+		 N_UDP_LPORT_HASH_ELEMENTS};
 
 static	void udp_detach __P((struct inpcb *));
 static	void udp_notify __P((struct inpcb *, int));
@@ -159,8 +164,11 @@ udp_init()
 
 	udb.inp_next = udb.inp_prev = &udb;
 
-	for (i=0; i < N_UDP_HASH_ELEMENTS; i++) 
-	    udp_hash_array[i]    = 0;
+	if (in_pcbhash_init(&udp_hash_str, N_UDP_HASH_ELEMENTS,
+			    UDP_HASH_MAX_ELEMENTS) ||
+	    in_pcbhash_init(&udp_wild_hash_str, N_UDP_WILD_HASH_ELEMENTS,
+			    N_UDP_WILD_HASH_ELEMENTS))
+	    panic("udp_init: no memory for pcb hash tables");
 
 	for (i=0; i < N_UDP_LPORT_HASH_ELEMENTS; i++) 
 	    udp_lport_hash_array[i]    = 0;
@@ -359,23 +367,8 @@ udp_input(m, iphlen)
 	 * Locate pcb for datagram.
 	 */
 
-        inp = inet_hash1(&udp_hash_str, ip->ip_dst.s_addr, uh->uh_dport,
-			 ip->ip_src.s_addr, uh->uh_sport);
-
-	inp = hash_in_pcblookup(inp, ip->ip_src, uh->uh_sport,
-				ip->ip_dst, uh->uh_dport);
-	if (inp == 0) {
-		inp = inet_hash1(&udp_hash_str, 0, uh->uh_dport,0,0);
-	        inp = hash_in_pcbwild(inp,
-				      ip->ip_src, uh->uh_sport,
-				      ip->ip_dst, uh->uh_dport, INPLOOKUP_WILDCARD);
-/*
-		if (inp == 0)
-			udpstat.udpps_pcbcachemiss++;
-		        inp = in_pcblookup(&udb, ip->ip_src, uh->uh_sport,
-					   ip->ip_dst, uh->uh_dport, INPLOOKUP_WILDCARD);
-*/
-	}
+	inp = in_pcblookup_hash(&udp_hash_str, ip->ip_src, uh->uh_sport,
+				ip->ip_dst, uh->uh_dport, INPLOOKUP_WILDCARD);
 
 
 	if (inp == 0) {
@@ -815,6 +808,12 @@ udp_sysctl(name, namelen, oldp, oldlenp, newp, newlen)
 	switch (name[0]) {
 	case UDPCTL_CHECKSUM:
 		return (sysctl_int(oldp, oldlenp, newp, newlen, &udpcksum));
+	case UDPCTL_PCBHASH:
+		return (in_pcbhash_sysctl(&udp_hash_str, oldp, oldlenp,
+					  newp, newlen));
+	case UDPCTL_PCBWILD:
+		return (in_pcbhash_sysctl(&udp_wild_hash_str, oldp, oldlenp,
+					  newp, newlen));
 	default:
 		return (ENOPROTOOPT);
 	}
@@ -95,11 +95,15 @@ struct	udpstat {
  * Names for UDP sysctl objects
  */
 #define	UDPCTL_CHECKSUM		1	/* checksum UDP packets */
-#define UDPCTL_MAXID		2
+#define	UDPCTL_PCBHASH		2	/* connection hash statistics */
+#define	UDPCTL_PCBWILD		3	/* unconnected hash statistics */
+#define UDPCTL_MAXID		4
 
 #define UDPCTL_NAMES { \
 	{ 0, 0 }, \
 	{ "checksum", CTLTYPE_INT }, \
+	{ "pcbhash", CTLTYPE_STRUCT }, \
+	{ "pcbwild", CTLTYPE_STRUCT }, \
 }
 
 #ifdef _KERNEL
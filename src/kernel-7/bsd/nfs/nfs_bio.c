@@ -182,9 +182,10 @@ nfs_bioread(vp, uio, ioflag, cred, getpages)
 	struct vattr vattr;
 	struct proc *p;
 	struct nfsmount *nmp = VFSTONFS(vp->v_mount);
-	daddr_t lbn, rabn;
+	daddr_t lbn, rabn, lastbn;
+	daddr_t rablks[BIO_RAMAX];
 	int bufsize;
-	int nra, error = 0, n = 0, on = 0, not_readin;
+	int nra, nbase, error = 0, n = 0, on = 0, not_readin;
 
 #if DIAGNOSTIC
 	if (uio->uio_rw != UIO_READ)
@@ -294,18 +295,33 @@ nfs_bioread(vp, uio, ioflag, cred, getpages)
 		not_readin = 1;
 
 		/*
-		 * Start the read ahead(s), as required.
+		 * Start the read ahead(s), as required: the nm_readahead
+		 * blocks after this one, as always, and then whatever the
+		 * adaptive read-ahead code wants beyond them once it has
+		 * seen a pattern.  There is no point in having more of
+		 * them in flight than the nfsiods can service.
 		 */
+		(void) bio_ratrack(vp, lbn);
 		if (nfs_numasync > 0 && nmp->nm_readahead > 0) {
-		    for (nra = 0; nra < nmp->nm_readahead &&
-			(off_t)(lbn + 1 + nra) * biosize < np->n_size; nra++) {
-			rabn = lbn + 1 + nra;
+		    for (nbase = 0; nbase < nmp->nm_readahead &&
+			nbase < BIO_RAMAX &&
+			(off_t)(lbn + 1 + nbase) * biosize < np->n_size; nbase++)
+			rablks[nbase] = lbn + 1 + nbase;
+		    lastbn = (daddr_t)((np->n_size + biosize - 1) / biosize) - 1;
+		    nra = nbase + bio_rablocks(vp, lbn, lastbn, rablks + nbase,
+			min(nmp->nm_readahead * nfs_numasync, BIO_RAMAX) - nbase);
+		    for (i = 0; i < nra; i++) {
+			rabn = rablks[i];
 			if (!incore(vp, rabn)) {
 			    rabp = nfs_getcacheblk(vp, rabn, biosize, p);
 			    if (!rabp)
 				return (EINTR);
 			    if ((rabp->b_flags & (B_CACHE|B_DELWRI)) == 0) {
 				rabp->b_flags |= (B_READ | B_ASYNC);
+				if (i >= nbase) {
+				    rabp->b_flags |= B_RAHEAD;
+				    bio_rastats.ra_issued++;
+				}
 				vfs_busy_pages(rabp, 0);
 				if (nfs_asyncio(rabp, cred)) {
 				    rabp->b_flags |= B_INVAL|B_ERROR;
@@ -547,6 +563,7 @@ nfs_write(ap)
 	daddr_t lbn;
 	int bufsize;
 	int n, on, error = 0, iomode, must_commit;
+	u_quad_t osize;
 
 #if DIAGNOSTIC
 	if (uio->uio_rw != UIO_WRITE)
@@ -596,6 +613,7 @@ nfs_write(ap)
 	 * still use nm_wsize when sizing the rpc's.
 	 */
 	biosize = vp->v_mount->mnt_stat.f_iosize;
+	osize = np->n_size;
 	do {
 		/*
 		 * Check for a valid write lease.
@@ -725,6 +743,7 @@ again:
 		} else
 			bdwrite(bp);
 	} while (uio->uio_resid > 0 && n > 0);
+	VN_KNOTE(vp, NOTE_WRITE | (np->n_size > osize ? NOTE_EXTEND : 0));
 	return (0);
 }
 
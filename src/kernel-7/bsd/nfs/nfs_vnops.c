@@ -1647,6 +1647,8 @@ nfs_remove(ap)
 			error = 0;
 	} else if (!np->n_sillyrename)
 		error = nfs_sillyrename(dvp, vp, cnp);
+	if (error == 0)
+		VN_KNOTE(vp, NOTE_DELETE);
 	FREE_ZONE(cnp->cn_pnbuf, cnp->cn_pnlen, M_NAMEI);
 	np->n_attrstamp = 0;
 	vput(dvp);
@@ -1757,6 +1759,8 @@ nfs_rename(ap)
 			cache_purge(tdvp);
 		cache_purge(fdvp);
 	}
+	if (tvp != NULL && (error == 0 || error == ENOENT))
+		VN_KNOTE(tvp, NOTE_DELETE);
 out:
 	if (tdvp == tvp)
 		vrele(tdvp);
@@ -2093,6 +2097,8 @@ nfs_rmdir(ap)
 		VTONFS(dvp)->n_attrstamp = 0;
 	cache_purge(dvp);
 	cache_purge(vp);
+	if (error == 0 || error == ENOENT)
+		VN_KNOTE(vp, NOTE_DELETE);
 	vput(vp);
 	vput(dvp);
 	/*
@@ -74,6 +74,18 @@
 
 #include <sys/cdefs.h>
 
+/*
+ * A file system that orders its metadata writes hangs a record of each
+ * outstanding dependency on the buffer it concerns (b_dep).  The buffer
+ * code only calls through bioops for buffers whose list is non-empty.
+ */
+struct worklist {
+	LIST_ENTRY(worklist) wk_list;	/* on b_dep or a work queue */
+	u_short	wk_type;		/* type of dependency record */
+	u_short	wk_state;		/* state flags */
+};
+LIST_HEAD(workhead, worklist);
+
 /*
  * The buffer header describes an I/O operation in the kernel.
  */
@@ -106,9 +118,21 @@ struct buf {
 	int	b_validend;		/* Offset of end of valid region. */
 	void 	*b_drvdata;		/* driver specific data */
 	int     b_timestamp; 	/* timestamp for queuing operation */
+	short	b_whichq;	/* free queue buffer is on */
+	short	b_qflags;	/* BQF_* replacement flags */
+	int	b_loancnt;	/* mbufs pointing into b_data */
+	void	(*b_bswap) __P((struct buf *, int)); /* swap b_data back */
+	void	*b_bswaparg;	/* argument for b_bswap */
+	struct	workhead b_dep;	/* write dependencies, see bioops */
 	long    b_reserved[3];	/* Reserved for future HFS use */
 };
 
+/*
+ * These flags are kept in b_qflags, for the buffer replacement policy.
+ */
+#define	BQF_HOT		0x0001	/* referenced again; release to a hot queue */
+#define	BQF_INHOT	0x0002	/* last released to a hot queue */
+
 /*
  * For portability with historic industry practice, the cylinder number has
  * to be maintained in the `b_resid' field.
@@ -155,6 +179,7 @@ struct buf {
 #define B_KERNSPACE	0x04000000	/* physical I/O to kernel space */
 #define B_CLUST_SYNC    0x08000000      /* part of synchronous cluster write */
 #define B_CLUST_COMMIT  0x10000000      /* commit cluster to disk and wait */
+#define	B_RAHEAD	0x20000000	/* Read ahead, not asked for yet. */
 
 #define	B_SCRACH5	0x40000000	/* Used by device drivers. */
 #define	B_SCRACH6	0x80000000	/* Used by device drivers. */
@@ -181,6 +206,52 @@ struct cluster_save {
 	(bp)->b_resid = 0;						\
 }
 
+/*
+ * Read-ahead statistics, kept by the adaptive read-ahead code in
+ * vfs_bio.c and printed by vfs_bufstats().
+ */
+struct bio_rastats {
+	long	ra_issued;		/* read-ahead I/Os started */
+	long	ra_hits;		/* read-ahead buffers later read */
+	long	ra_wasted;		/* read-ahead buffers recycled unread */
+	long	ra_grow;		/* window increases */
+	long	ra_shrink;		/* window decreases */
+	long	ra_seq;			/* sequential patterns detected */
+	long	ra_strided;		/* strided patterns detected */
+	long	ra_reverse;		/* reverse patterns detected */
+};
+
+#define	BIO_RAMAX	32		/* largest read-ahead window */
+
+/*
+ * Buffer replacement statistics, printed by vfs_bufstats().  The
+ * per-queue counts are indexed by the BQ_* queue numbers in vfs_bio.c.
+ */
+#define	BQUEUES		5		/* number of free buffer queues */
+
+struct bufqstats {
+	long	bq_hits[BQUEUES];	/* cache hits on buffers in each queue */
+	long	bq_evict[BQUEUES];	/* buffers taken from each queue */
+	long	bq_misses;		/* getblk() found nothing */
+	long	bq_ghosthits;		/* misses on recently evicted blocks */
+	long	bq_promote;		/* buffers moved to a hot queue */
+	long	bq_loans;		/* buffers lent to the network */
+	long	bq_loanfull;		/* loans refused, bufloanmax reached */
+};
+
+/*
+ * Hooks into the file system that owns the records on b_dep.
+ * io_start is called by bwrite() just before a write is started and
+ * may roll back parts of b_data that must not reach the disk yet;
+ * io_complete is called by biodone() when the write finishes, at
+ * interrupt level; io_deallocate when the buffer is thrown away.
+ */
+struct bio_ops {
+	void	(*io_start) __P((struct buf *));
+	void	(*io_complete) __P((struct buf *));
+	void	(*io_deallocate) __P((struct buf *));
+};
+
 /* Flags to low-level allocation routines. */
 #define B_CLRBUF	0x01	/* Request allocated buffer be cleared. */
 #define B_SYNC		0x02	/* Do all allocations synchronously. */
@@ -194,6 +265,9 @@ extern struct buf *swbuf;	/* Swap I/O buffer headers. */
 extern int nswbuf;			/* Number of swap I/O buffer headers. */
 extern struct buf bswlist;	/* Head of swap I/O buffer headers free list. */
 extern struct buf *bclnlist;/* Head of cleaned page list. */
+extern struct bio_rastats bio_rastats;	/* read-ahead statistics */
+extern struct bufqstats bufqstats;	/* replacement statistics */
+extern struct bio_ops bioops;		/* write dependency hooks */
 
 __BEGIN_DECLS
 int	allocbuf __P((struct buf *, int));
@@ -207,9 +281,16 @@ int	breada __P((struct vnode *, daddr_t, int, daddr_t, int,
 	    struct ucred *, struct buf **));
 int	breadn __P((struct vnode *, daddr_t, int, daddr_t *, int *, int,
 	    struct ucred *, struct buf **));
+int	breadra __P((struct vnode *, daddr_t, int, daddr_t,
+	    struct ucred *, struct buf **));
+int	bio_ratrack __P((struct vnode *, daddr_t));
+int	bio_rablocks __P((struct vnode *, daddr_t, daddr_t, daddr_t *, int));
+int	bio_readahead __P((struct vnode *, daddr_t, int, struct ucred *));
 void	brelse __P((struct buf *));
 void	bremfree __P((struct buf *));
 void	bufinit __P((void));
+struct buf *bufloan __P((struct vnode *, daddr_t));
+void	bufunloan __P((struct buf *));
 int	bwrite __P((struct buf *));
 void	cluster_callback __P((struct buf *));
 int	cluster_read __P((struct vnode *, u_quad_t, daddr_t, long,
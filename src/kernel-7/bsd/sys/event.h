@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.1 (the "License").  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON- INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+ * Kernel event queues.
+ *
+ * A kqueue is a descriptor that holds a set of registered events
+ * (knotes).  Interest is registered once with kevent(); afterwards
+ * the objects being watched put their knotes on the queue's active
+ * list as they become ready, and kevent() hands back only those.
+ * This generalises watchevent()/waitevent(), which only cover sockets
+ * and keep one event per socket per process.
+ */
+
+#ifndef _SYS_EVENT_H_
+#define _SYS_EVENT_H_
+
+#include <sys/queue.h>
+
+#define	EVFILT_READ		(-1)	/* readable descriptor */
+#define	EVFILT_WRITE		(-2)	/* writable descriptor */
+#define	EVFILT_VNODE		(-3)	/* vnode changes, see NOTE_* */
+#define	EVFILT_PROC		(-4)	/* process exit */
+#define	EVFILT_TIMER		(-5)	/* timer, data in milliseconds */
+
+#define	EVFILT_SYSCOUNT		5
+
+struct kevent {
+	u_int	ident;		/* identifier: fd, pid or timer id */
+	short	filter;		/* EVFILT_* */
+	u_short	flags;		/* EV_* action and state flags */
+	u_int	fflags;		/* filter specific flags */
+	int	data;		/* filter specific data */
+	void	*udata;		/* opaque user data, returned as is */
+};
+
+#define	EV_SET(kevp, a, b, c, d, e, f) {				\
+	(kevp)->ident = (a);						\
+	(kevp)->filter = (b);						\
+	(kevp)->flags = (c);						\
+	(kevp)->fflags = (d);						\
+	(kevp)->data = (e);						\
+	(kevp)->udata = (f);						\
+}
+
+/* actions */
+#define	EV_ADD		0x0001		/* add event, or modify existing */
+#define	EV_DELETE	0x0002		/* delete event */
+#define	EV_ENABLE	0x0004		/* allow event to be returned */
+#define	EV_DISABLE	0x0008		/* keep event, but don't return it */
+
+/* behaviour */
+#define	EV_ONESHOT	0x0010		/* delete after first delivery */
+#define	EV_CLEAR	0x0020		/* edge triggered: reset on delivery */
+
+/* returned */
+#define	EV_ERROR	0x4000		/* registration failed, error in data */
+#define	EV_EOF		0x8000		/* filter specific end of file */
+
+/*
+ * EVFILT_READ and EVFILT_WRITE: when set, data in the kevent is
+ * used as the low water mark instead of the socket's.
+ */
+#define	NOTE_LOWAT	0x0001
+
+/*
+ * EVFILT_VNODE
+ */
+#define	NOTE_DELETE	0x0001		/* vnode was removed */
+#define	NOTE_WRITE	0x0002		/* data contents changed */
+#define	NOTE_EXTEND	0x0004		/* size increased */
+
+/*
+ * EVFILT_PROC
+ */
+#define	NOTE_EXIT	0x80000000	/* process exited, data is status */
+
+struct knote;
+LIST_HEAD(klist, knote);
+
+#ifdef _KERNEL
+
+struct file;
+struct filedesc;
+struct proc;
+struct stat;
+
+/*
+ * Each filter supplies attach, detach and event routines.  f_event
+ * is called with the hint passed to knote() when the watched object
+ * changes, and with a hint of 0 to re-check the current state; it
+ * updates kn_data/kn_fflags and returns nonzero when the event should
+ * be reported.  Filters with f_isfd set take a descriptor as ident.
+ */
+struct filterops {
+	int	f_isfd;
+	int	(*f_attach)	__P((struct knote *kn));
+	void	(*f_detach)	__P((struct knote *kn));
+	int	(*f_event)	__P((struct knote *kn, long hint));
+};
+
+struct knote {
+	LIST_ENTRY(knote) kn_selnext;	/* on the watched object's klist */
+	LIST_ENTRY(knote) kn_link;	/* on fd_knlist[ident] */
+	LIST_ENTRY(knote) kn_kqlink;	/* on the kqueue's list of all knotes */
+	TAILQ_ENTRY(knote) kn_tqe;	/* on the kqueue's active list */
+	struct	kqueue *kn_kq;		/* which queue we are on */
+	struct	kevent kn_kevent;
+	int	kn_status;
+#define	KN_ACTIVE	0x01		/* event has been triggered */
+#define	KN_QUEUED	0x02		/* event is on the active list */
+#define	KN_DISABLED	0x04		/* event is disabled */
+#define	KN_DETACHED	0x08		/* knote is off the object's klist */
+#define	KN_MARKER	0x10		/* scan position, not a real knote */
+	u_int	kn_sfflags;		/* saved filter flags */
+	int	kn_sdata;		/* saved data field */
+	union {
+		struct	file *p_fp;	/* file data pointer */
+		struct	proc *p_proc;	/* proc pointer */
+	} kn_ptr;
+	struct	filterops *kn_fop;
+};
+
+#define	kn_id		kn_kevent.ident
+#define	kn_filter	kn_kevent.filter
+#define	kn_flags	kn_kevent.flags
+#define	kn_fflags	kn_kevent.fflags
+#define	kn_data		kn_kevent.data
+#define	kn_fp		kn_ptr.p_fp
+
+/*
+ * Post hint to every knote on list.  The test keeps the common
+ * case, nobody watching, down to a load and a branch.
+ */
+#define	KNOTE(list, hint)						\
+	do {								\
+		if ((list)->lh_first != NULL)				\
+			knote((list), (hint));				\
+	} while (0)
+
+extern void	knote __P((struct klist *list, long hint));
+extern void	knote_fdclose __P((struct filedesc *fdp, int fd));
+extern int	soo_kqfilter __P((struct file *fp, struct knote *kn));
+extern int	vn_kqfilter __P((struct file *fp, struct knote *kn));
+extern int	kqueue_stat __P((struct file *fp, struct stat *st));
+
+#else /* !_KERNEL */
+
+#include <sys/cdefs.h>
+
+struct timespec;
+
+__BEGIN_DECLS
+int	kqueue __P((void));
+int	kevent __P((int kq, const struct kevent *changelist, int nchanges,
+		    struct kevent *eventlist, int nevents,
+		    const struct timespec *timeout));
+__END_DECLS
+
+#endif /* !_KERNEL */
+
+#endif /* !_SYS_EVENT_H_ */
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.1 (the "License").  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON- INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#ifndef _SYS_EVENTVAR_H_
+#define _SYS_EVENTVAR_H_
+
+#include <sys/select.h>
+#include <sys/event.h>
+
+#define	KQ_NEVENTS	8		/* kevents copied in/out per batch */
+
+/*
+ * kq_head holds the knotes that have fired and not yet been
+ * collected, so a scan costs time in proportion to the number of
+ * ready events rather than the number registered.  kq_knlist holds
+ * every knote on the queue and is used to tear it down on close and
+ * to find the knotes whose ident is not a descriptor.
+ */
+struct kqueue {
+	TAILQ_HEAD(, knote) kq_head;	/* list of pending events */
+	int	kq_count;		/* number of pending events */
+	struct	klist kq_knlist;	/* all knotes on this queue */
+	struct	filedesc *kq_fdp;	/* descriptor table we belong to */
+	struct	selinfo kq_sel;
+	int	kq_state;
+#define	KQ_SEL		0x01		/* someone is selecting */
+#define	KQ_SLEEP	0x02		/* someone is in kevent() */
+};
+
+#endif /* !_SYS_EVENTVAR_H_ */
@@ -88,6 +88,9 @@ struct filedesc {
 	u_short	fd_freefile;		/* approx. next free file */
 	u_short	fd_cmask;		/* mask for file creation */
 	u_short	fd_refcnt;		/* reference count */
+
+	int	fd_knlistsize;		/* size of fd_knlist */
+	struct	klist *fd_knlist;	/* kqueue notes, indexed by fd */
 };
 
 /*
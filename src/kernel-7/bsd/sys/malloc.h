@@ -150,7 +150,11 @@
 #define	M_HFSEXT	77	/* HFS extent list */
 #define M_VOLFS		78  /* VOLFS structures */
 #define	M_TEMP		79	/* misc temporary data buffers */
-#define	M_LAST		80	/* Must be last type + 1 */
+#define	M_KQUEUE	80	/* kqueue and descriptor knote lists */
+#define	M_KNOTE		81	/* kqueue knotes */
+#define	M_DIRHASH	82	/* UFS directory hash tables */
+#define	M_SOFTDEP	83	/* FFS metadata write dependencies */
+#define	M_LAST		84	/* Must be last type + 1 */
 
 /* Strings corresponding to types of memory */
 /* Must be in synch with the #defines above */
@@ -235,6 +239,10 @@
 	"HFS extent",	/* 77 M_HFSEXT */ \
 	"VOLFS structs", /* 78 M_VOLFS */ \
 	"temp",		/* 79 M_TEMP */ \
+	"kqueue",	/* 80 M_KQUEUE */ \
+	"knote",	/* 81 M_KNOTE */ \
+	"dirhash",	/* 82 M_DIRHASH */ \
+	"softdep",	/* 83 M_SOFTDEP */ \
 }
 
 struct kmemstats {
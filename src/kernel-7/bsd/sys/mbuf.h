@@ -211,19 +211,13 @@ struct mbuf {
 
 extern struct mbuf *mfree;				/* mbuf free list */
 
-#define _MINTGET(m, type) { 						\
-	int _ms = splimp();						\
-	MBUF_LOCK();							\
-	if (((m) = mfree) != 0) {					\
-		MCHECK(m);								\
-		++mclrefcnt[mtocl(m)]; 					\
-		mbstat.m_mtypes[MT_FREE]--;				\
-		mbstat.m_mtypes[type]++;				\
-		mfree = (m)->m_next;					\
-	}								\
-	MBUF_UNLOCK();							\
-	splx(_ms);							\
-}
+/*
+ * Free mbufs and clusters are cached per processor, in front of the
+ * global free lists.  The caches are private to uipc_mbuf.c, so the
+ * allocation macros call m_cacheget, m_clcacheget and m_clcachefree
+ * there.
+ */
+#define _MINTGET(m, type)	((m) = m_cacheget(type))
 	
 #define	MGET(m, how, type) {						\
 	_MINTGET(m, type);						\
@@ -264,18 +258,7 @@ union mcluster {
 	char	mcl_buf[MCLBYTES];
 };
 
-#define	MCLALLOC(p, how) {							\
-	int _ms = splimp(); 							\
-	MBUF_LOCK(); 									\
-	(void)m_clalloc(1, (how)); 						\
-	if (((p) = (caddr_t)mclfree)) { 					\
-		++mclrefcnt[mtocl(p)]; 						\
-		mbstat.m_clfree--; 							\
-		mclfree = ((union mcluster *)(p))->mcl_next; 		\
-	} 								\
-	MBUF_UNLOCK(); 							\
-	splx(_ms); 							\
-}
+#define	MCLALLOC(p, how)	((p) = m_clcacheget(how))
 
 #define	MCLGET(m, how) { 						\
 	MCLALLOC((m)->m_ext.ext_buf, (how)); 				\
@@ -289,17 +272,7 @@ union mcluster {
 	} 								\
 }
 
-#define	MCLFREE(p) {							\
-	int _ms = splimp(); 						\
-	MBUF_LOCK(); 							\
-	if (--mclrefcnt[mtocl(p)] == 0) { 				\
-		((union mcluster *)(p))->mcl_next = mclfree; 		\
-		mclfree = (union mcluster *)(p); 			\
-		mbstat.m_clfree++; 					\
-	} 								\
-	MBUF_UNLOCK(); 							\
-	splx(_ms); 							\
-}
+#define	MCLFREE(p)	m_clcachefree((caddr_t)(p))
 
 #define MCLHASREFERENCE(m) \
 	((m)->m_ext.ext_refs.forward != &((m)->m_ext.ext_refs))
@@ -396,8 +369,15 @@ struct mbstat {
 	u_long	m_wait;		/* times waited for space */
 	u_long	m_drain;	/* times drained protocols for space */
 	u_short	m_mtypes[256];	/* type specific mbuf allocations */
+	u_long	m_cachehits;	/* mbufs allocated from a cpu cache */
+	u_long	m_refills;	/* mbuf batches moved to a cpu cache */
+	u_long	m_drains;	/* mbuf batches moved back */
+	u_long	m_clcachehits;	/* clusters allocated from a cpu cache */
+	u_long	m_clrefills;	/* cluster batches moved to a cpu cache */
+	u_long	m_cldrains;	/* cluster batches moved back */
 };
 
+
 #ifdef	_KERNEL
 extern union 	mcluster *mbutl;	/* virtual address of mclusters */
 extern union 	mcluster embutl;	/* virtual address of mclusters */
@@ -419,6 +399,9 @@ struct	mbuf *m_prepend __P((struct mbuf *, int, int));
 struct	mbuf *m_pullup __P((struct mbuf *, int));
 struct	mbuf *m_retry __P((int, int));
 struct	mbuf *m_retryhdr __P((int, int));
+struct	mbuf *m_cacheget __P((int));
+caddr_t	m_clcacheget __P((int));
+void	m_clcachefree __P((caddr_t));
 void m_adj __P((struct mbuf *, int));
 int	 m_clalloc __P((int, int));
 void m_freem __P((struct mbuf *));
@@ -108,6 +108,20 @@ struct statfs {
 	char	f_mntfromname[MNAMELEN];/* mounted filesystem */
 };
 
+/*
+ * Per-mount name cache statistics, as returned by VFS_MNTNCHSTATS.
+ * Counts are charged to the filesystem holding the directory that
+ * was searched.
+ */
+struct mntnchstats {
+	fsid_t	mns_fsid;		/* file system id */
+	long	mns_goodhits;		/* positive hits */
+	long	mns_neghits;		/* negative hits */
+	long	mns_falsehits;		/* hits on entries gone stale */
+	long	mns_miss;		/* misses */
+	long	mns_fasthits;		/* components resolved by namei */
+};
+
 /*
  * Structure per mounted file system.  Each mounted file system has an
  * array of operations and an instance record.  The file systems are
@@ -126,6 +140,7 @@ struct mount {
 	int		mnt_maxsymlinklen;	/* max size of short symlink */
 	struct statfs	mnt_stat;		/* cache of filesystem stats */
 	qaddr_t		mnt_data;		/* private data */
+	struct mntnchstats mnt_nchstats;	/* name cache statistics */
 };
 
 /*
@@ -183,6 +198,10 @@ struct mount {
 #if REV_ENDIAN_FS
 #define	MNT_REVEND	0x08000000	/* Reverse endian FS */
 #endif /* REV_ENDIAN_FS */
+#define MNT_NCFASTPATH	0x10000000	/* namei may walk cached names */
+#define	MNT_SOFTDEP	0x20000000	/* metadata writes ordered by dependencies */
+
+#define	DOINGSOFTDEP(vp)	((vp)->v_mount->mnt_flag & MNT_SOFTDEP)
 
 /*
  * Sysctl CTL_VFS definitions.
@@ -200,6 +219,8 @@ struct mount {
 #define VFS_MAXTYPENUM	1	/* int: highest defined filesystem type */
 #define VFS_CONF	2	/* struct: vfsconf for filesystem given
 				   as next argument */
+#define VFS_NCHSTATS	3	/* struct: global name cache statistics */
+#define VFS_MNTNCHSTATS	4	/* struct: mntnchstats for each mount */
 /*
  * Flags for various system call interfaces.
  *
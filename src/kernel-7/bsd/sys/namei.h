@@ -177,12 +177,13 @@ struct nameidata {
 
 /*
  * This structure describes the elements in the cache of recent
- * names looked up by namei. NCHNAMLEN is sized to make structure
- * size a power of two to optimize malloc's. Minimum reasonable
- * size is 15.
+ * names looked up by namei.  The name is stored inline at the end
+ * of the entry; nc_alloclen records how much room there is.  Names
+ * up to NCHNAMLEN fit in a short entry, and longer ones get an entry
+ * with room for NAME_MAX.
  */
 
-#define	NCHNAMLEN	31	/* maximum name segment length we bother with */
+#define	NCHNAMLEN	31	/* name length covered by the minimum entry */
 
 struct	namecache {
 	LIST_ENTRY(namecache) nc_hash;	/* hash chain */
@@ -191,10 +192,16 @@ struct	namecache {
 	u_long	nc_dvpid;		/* capability number of nc_dvp */
 	struct	vnode *nc_vp;		/* vnode the name refers to */
 	u_long	nc_vpid;		/* capability number of nc_vp */
-	char	nc_nlen;		/* length of name */
-	char	nc_name[NCHNAMLEN];	/* segment name */
+	u_long	nc_hashval;		/* cn_hash of the name */
+	u_short	nc_flag;		/* flags, see below */
+	u_short	nc_alloclen;		/* room in nc_name */
+	u_short	nc_nlen;		/* length of name */
+	char	nc_name[NCHNAMLEN];	/* segment name (variable length) */
 };
 
+/* nc_flag */
+#define	NCF_REF		0x0001		/* referenced since last LRU pass */
+
 #ifdef _KERNEL
 extern u_long	nextvnodeid;
 int	namei __P((struct nameidata *ndp));
@@ -215,5 +222,8 @@ struct	nchstats {
 	long	ncs_long;		/* long names that ignore cache */
 	long	ncs_pass2;		/* names found with passes == 2 */
 	long	ncs_2passes;		/* number of times we attempt it */
+	long	ncs_fasthits;		/* components resolved by namei fast path */
+	long	ncs_retries;		/* lookups restarted by a bucket update */
 };
+
 #endif /* !_SYS_NAMEI_H_ */
@@ -69,6 +69,7 @@
 #include <sys/select.h>			/* For struct selinfo. */
 #include <sys/queue.h>
 #include <sys/lock.h>
+#include <sys/event.h>
 
 /*
  * One structure allocated per session.
@@ -163,6 +164,7 @@ struct	proc {
 	 */
 	LIST_ENTRY(proc) p_hash;	/* Hash chain. */
         TAILQ_HEAD( ,eventqelt) p_evlist;
+	struct	klist p_klist;	/* knotes watching this process */
 
 /* The following fields are all copied upon creation in fork. */
 #define	p_startcopy	p_sigmask
@@ -323,6 +323,17 @@ struct cmsghdr {
 /* "Socket"-level control message types: */
 #define	SCM_RIGHTS	0x01		/* access rights (array of int) */
 
+/*
+ * Header and trailer data for sendfile(), sent before and after
+ * the file as by writev().
+ */
+struct sf_hdtr {
+	struct	iovec *headers;		/* header iovecs */
+	int	hdr_cnt;		/* # of header iovecs */
+	struct	iovec *trailers;	/* trailer iovecs */
+	int	trl_cnt;		/* # of trailer iovecs */
+};
+
 /*
  * 4.3 compat sockaddr, move to compat file later
  */
@@ -366,6 +377,7 @@ int	setsockopt __P((int, int, int, const void *, int));
 int	shutdown __P((int, int));
 int	socket __P((int, int, int));
 int	socketpair __P((int, int, int, int *));
+int	sendfile __P((int, int, off_t, size_t, struct sf_hdtr *, off_t *, int));
 __END_DECLS
 
 #endif /* !_KERNEL */
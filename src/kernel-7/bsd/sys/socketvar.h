@@ -64,6 +64,7 @@
 #include <sys/select.h>			/* for struct selinfo */
 #include <sys/queue.h>
 #include <sys/ev.h>
+#include <sys/event.h>
 /*
  * Hacks to get around compiler bitching
  */
@@ -148,6 +149,7 @@ struct socket {
 	u_long		cache_timestamp;
 	caddr_t		so_saved_pcb;	/* Saved pcb when cacheing */
   TAILQ_HEAD(,eventqelt) so_evlist;
+	struct	klist so_klist;	/* kqueue notes, read and write */
 };
 
 /*
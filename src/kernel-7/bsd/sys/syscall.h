@@ -252,3 +252,9 @@
 #define SYS_searchfs	 225
 
        				/* 226 - 230 are reserved for HFS expansion */
+#define	SYS_watchevent	231
+#define	SYS_waitevent	232
+#define	SYS_modwatch	233
+#define	SYS_kqueue	234
+#define	SYS_kevent	235
+#define	SYS_sendfile	236
@@ -255,6 +255,7 @@ struct kinfo_proc {
 #define	VM_LOADAVG	2		/* struct loadavg */
 #define	VM_MAXID	3		/* number of valid vm ids */
 #define	VM_MACHFACTOR	4		/* struct loadavg with mach factor*/
+#define	VM_ZMAGAZINE	5		/* int: zone magazine layer on */
 
 #define	CTL_VM_NAMES { \
 	{ 0, 0 }, \
@@ -67,6 +67,7 @@
 
 #include <sys/time.h>
 #include <sys/uio.h>
+#include <sys/event.h>
 
 #include <sys/vm.h>
 
@@ -136,7 +137,12 @@ struct vnode {
 	daddr_t	v_maxra;			/* last readahead block */
 	simple_lock_data_t v_interlock;		/* lock on usecount and flag */
 	struct	lock__bsd__ *v_vnlock;		/* used for non-locking fs's */
-	long	v_spare[5];			/* round to 128 bytes */
+	daddr_t	v_raend;			/* last block read ahead */
+	int	v_rastride;			/* distance between reads */
+	short	v_rawin;			/* read-ahead window (blocks) */
+	short	v_raconf;			/* v_rastride has repeated */
+	long	v_rahits;			/* read-ahead used this window */
+	struct	klist v_knotes;		/* kqueue notes on this vnode */
 	enum	vtagtype v_tag;			/* type of underlying data */
 	void 	*v_data;			/* private data for fs */
         u_long  v_bread;
@@ -293,6 +299,11 @@ extern __inline void vref(vp)
 
 #define	NULLVP	((struct vnode *)NULL)
 
+/*
+ * Post a change to any kqueues watching the vnode (NOTE_* in event.h).
+ */
+#define	VN_KNOTE(vp, hint)	KNOTE(&(vp)->v_knotes, (hint))
+
 /*
  * Global vnode data.
  */
@@ -433,6 +444,7 @@ struct vop_generic_args {
 /*
  * Public vnode manipulation functions.
  */
+struct componentname;
 struct file;
 struct mount;
 struct nameidata;
@@ -446,6 +458,14 @@ struct vnode;
 struct vop_bwrite_args;
 
 int 	bdevvp __P((dev_t dev, struct vnode **vpp));
+int	cache_lookup __P((struct vnode *dvp, struct vnode **vpp,
+	    struct componentname *cnp));
+int	cache_fastlookup __P((struct vnode *dvp, struct vnode **vpp,
+	    u_long *vpidp, struct componentname *cnp));
+void	cache_enter __P((struct vnode *dvp, struct vnode *vp,
+	    struct componentname *cnp));
+void	cache_purge __P((struct vnode *vp));
+void	cache_purgevfs __P((struct mount *mp));
 void	cvtstat __P((struct stat *st, struct ostat *ost));
 int 	getnewvnode __P((enum vtagtype tag,
 	    struct mount *mp, int (**vops)(), struct vnode **vpp));
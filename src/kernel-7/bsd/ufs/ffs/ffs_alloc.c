@@ -947,15 +947,11 @@ ffs_fragextend(ip, cg, bprev, osize, nsize)
 	cgp = (struct cg *)bp->b_data;
 #if REV_ENDIAN_FS
 	if (rev_endian) {
-		byte_swap_cgin(cgp, fs);
+		byte_swap_cgin_buf(bp, fs);
 	}
 #endif /* REV_ENDIAN_FS */
 
 	if (!cg_chkmagic(cgp)) {
-#if REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_cgout(cgp,fs);
-#endif /* REV_ENDIAN_FS */
 		brelse(bp);
 		return (NULL);
 	}
@@ -963,10 +959,6 @@ ffs_fragextend(ip, cg, bprev, osize, nsize)
 	bno = dtogd(fs, bprev);
 	for (i = numfrags(fs, osize); i < frags; i++)
 		if (isclr(cg_blksfree(cgp), bno + i)) {
-#if REV_ENDIAN_FS
-			if (rev_endian)
-				byte_swap_cgout(cgp,fs);
-#endif /* REV_ENDIAN_FS */
 			brelse(bp);
 			return (NULL);
 		}
@@ -989,10 +981,6 @@ ffs_fragextend(ip, cg, bprev, osize, nsize)
 		fs->fs_cs(fs, cg).cs_nffree--;
 	}
 	fs->fs_fmod = 1;
-#if REV_ENDIAN_FS
-	if (rev_endian)
-		byte_swap_cgout(cgp,fs);
-#endif /* REV_ENDIAN_FS */
 	bdwrite(bp);
 	return (bprev);
 }
@@ -1033,24 +1021,16 @@ ffs_alloccg(ip, cg, bpref, size)
 	cgp = (struct cg *)bp->b_data;
 #if REV_ENDIAN_FS
 	if (rev_endian)
-		byte_swap_cgin(cgp,fs);
+		byte_swap_cgin_buf(bp, fs);
 #endif /* REV_ENDIAN_FS */
 	if (!cg_chkmagic(cgp) ||
 	    (cgp->cg_cs.cs_nbfree == 0 && size == fs->fs_bsize)) {
-#if REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_cgout(cgp,fs);
-#endif /* REV_ENDIAN_FS */
 		brelse(bp);
 		return (NULL);
 	}
 	cgp->cg_time = time.tv_sec;
 	if (size == fs->fs_bsize) {
 		bno = ffs_alloccgblk(fs, cgp, bpref);
-#if REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_cgout(cgp,fs);
-#endif /* REV_ENDIAN_FS */
 		bdwrite(bp);
 		return (bno);
 	}
@@ -1069,10 +1049,6 @@ ffs_alloccg(ip, cg, bpref, size)
 		 * allocated, and hacked up
 		 */
 		if (cgp->cg_cs.cs_nbfree == 0) {
-#if	REV_ENDIAN_FS
-			if (rev_endian)
-				byte_swap_cgout(cgp,fs);
-#endif	/* REV_ENDIAN_FS */
 			brelse(bp);
 			return (NULL);
 		}
@@ -1086,19 +1062,11 @@ ffs_alloccg(ip, cg, bpref, size)
 		fs->fs_cs(fs, cg).cs_nffree += i;
 		fs->fs_fmod = 1;
 		cgp->cg_frsum[i]++;
-#if	REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_cgout(cgp,fs);
-#endif	/* REV_ENDIAN_FS */
 		bdwrite(bp);
 		return (bno);
 	}
 	bno = ffs_mapsearch(fs, cgp, bpref, allocsiz);
 	if (bno < 0) {
-#if	REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_cgout(cgp,fs);
-#endif	/* REV_ENDIAN_FS */
 		brelse(bp);
 		return (NULL);
 	}
@@ -1111,10 +1079,6 @@ ffs_alloccg(ip, cg, bpref, size)
 	cgp->cg_frsum[allocsiz]--;
 	if (frags != allocsiz)
 		cgp->cg_frsum[allocsiz - frags]++;
-#if	REV_ENDIAN_FS
-	if (rev_endian)
-		byte_swap_cgout(cgp,fs);
-#endif	/* REV_ENDIAN_FS */
 	bdwrite(bp);
 	return (cg * fs->fs_fpg + bno);
 }
@@ -1269,13 +1233,9 @@ ffs_clusteralloc(ip, cg, bpref, len)
 	cgp = (struct cg *)bp->b_data;
 #if	REV_ENDIAN_FS
 	if (rev_endian)
-		byte_swap_cgin(cgp,fs);
+		byte_swap_cgin_buf(bp, fs);
 #endif	/* REV_ENDIAN_FS */
 	if (!cg_chkmagic(cgp)) {
-#if	REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_cgout(cgp,fs);
-#endif	/* REV_ENDIAN_FS */
 		goto fail;
 	}
 	/*
@@ -1299,10 +1259,6 @@ ffs_clusteralloc(ip, cg, bpref, len)
 			if (*lp-- > 0)
 				break;
 		fs->fs_maxcluster[cg] = i;
-#if	REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_cgout(cgp,fs);
-#endif	/* REV_ENDIAN_FS */
 		goto fail;
 	}
 	/*
@@ -1339,10 +1295,6 @@ ffs_clusteralloc(ip, cg, bpref, len)
 		}
 	}
 	if (got == cgp->cg_nclusterblks) {
-#if	REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_cgout(cgp,fs);
-#endif	/* REV_ENDIAN_FS */
 		goto fail;
 	}
 	/*
@@ -1358,10 +1310,6 @@ ffs_clusteralloc(ip, cg, bpref, len)
 	for (i = 0; i < len; i += fs->fs_frag)
 		if ((got = ffs_alloccgblk(fs, cgp, bno + i)) != bno + i)
 			panic("ffs_clusteralloc: lost block");
-#if	REV_ENDIAN_FS
-	if (rev_endian)
-		byte_swap_cgout(cgp,fs);
-#endif	/* REV_ENDIAN_FS */
 	bdwrite(bp);
 	return (bno);
 
@@ -1408,13 +1356,9 @@ ffs_nodealloccg(ip, cg, ipref, mode)
 	cgp = (struct cg *)bp->b_data;
 #if REV_ENDIAN_FS
 	if (rev_endian)
-		byte_swap_cgin(cgp,fs);
+		byte_swap_cgin_buf(bp, fs);
 #endif /* REV_ENDIAN_FS */
 	if (!cg_chkmagic(cgp) || cgp->cg_cs.cs_nifree == 0) {
-#if REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_cgout(cgp,fs);
-#endif /* REV_ENDIAN_FS */
 		brelse(bp);
 		return (NULL);
 	}
@@ -1462,10 +1406,6 @@ gotit:
 		fs->fs_cstotal.cs_ndir++;
 		fs->fs_cs(fs, cg).cs_ndir++;
 	}
-#if REV_ENDIAN_FS
-	if (rev_endian)
-		byte_swap_cgout(cgp,fs);
-#endif /* REV_ENDIAN_FS */
 	bdwrite(bp);
 	return (cg * fs->fs_ipg + ipref);
 }
@@ -1513,13 +1453,9 @@ ffs_blkfree(ip, bno, size)
 	cgp = (struct cg *)bp->b_data;
 #if REV_ENDIAN_FS
 	if (rev_endian)
-		byte_swap_cgin(cgp,fs);
+		byte_swap_cgin_buf(bp, fs);
 #endif /* REV_ENDIAN_FS */
 	if (!cg_chkmagic(cgp)) {
-#if REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_cgout(cgp,fs);
-#endif /* REV_ENDIAN_FS */
 		brelse(bp);
 		return;
 	}
@@ -1585,10 +1521,6 @@ ffs_blkfree(ip, bno, size)
 		}
 	}
 	fs->fs_fmod = 1;
-#if REV_ENDIAN_FS
-	if (rev_endian)
-		byte_swap_cgout(cgp,fs);
-#endif /* REV_ENDIAN_FS */
 	bdwrite(bp);
 }
 
@@ -1629,13 +1561,9 @@ ffs_checkblk(ip, bno, size)
 	cgp = (struct cg *)bp->b_data;
 #if REV_ENDIAN_FS
 	if (rev_endian)
-		byte_swap_cgin(cgp,fs);
+		byte_swap_cgin_buf(bp, fs);
 #endif /* REV_ENDIAN_FS */
 	if (!cg_chkmagic(cgp)) {
-#if REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_cgout(cgp,fs);
-#endif /* REV_ENDIAN_FS */
 		brelse(bp);
 		return;
 	}
@@ -1650,10 +1578,6 @@ ffs_checkblk(ip, bno, size)
 		if (free != 0 && free != frags)
 			panic("checkblk: partially free fragment");
 	}
-#if REV_ENDIAN_FS
-	if (rev_endian)
-		byte_swap_cgout(cgp,fs);
-#endif /* REV_ENDIAN_FS */
 	brelse(bp);
 	return (!free);
 }
@@ -1699,13 +1623,9 @@ ffs_vfree(ap)
 	cgp = (struct cg *)bp->b_data;
 #if REV_ENDIAN_FS
 	if (rev_endian)
-		byte_swap_cgin(cgp,fs);
+		byte_swap_cgin_buf(bp, fs);
 #endif /* REV_ENDIAN_FS */
 	if (!cg_chkmagic(cgp)) {
-#if REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_cgout(cgp,fs);
-#endif /* REV_ENDIAN_FS */
 		brelse(bp);
 		return (0);
 	}
@@ -1729,10 +1649,6 @@ ffs_vfree(ap)
 		fs->fs_cs(fs, cg).cs_ndir--;
 	}
 	fs->fs_fmod = 1;
-#if REV_ENDIAN_FS
-	if (rev_endian)
-		byte_swap_cgout(cgp,fs);
-#endif /* REV_ENDIAN_FS */
 	bdwrite(bp);
 	return (0);
 }
@@ -66,7 +66,13 @@
 #define FFS_CLUSTERWRITE	2	/* cluster writing enabled */
 #define FFS_REALLOCBLKS		3	/* block reallocation enabled */
 #define FFS_ASYNCFREE		4	/* asynchronous block freeing enabled */
-#define	FFS_MAXID		5	/* number of valid ffs ids */
+#define FFS_BSWAPSTATS		5	/* struct: byte-swapped metadata counts */
+#define FFS_DIRHASH_MINSIZE	6	/* smallest directory given a hash */
+#define FFS_DIRHASH_MAXMEM	7	/* memory for directory hashes */
+#define FFS_DIRHASHSTATS	8	/* struct: directory hash counts */
+#define FFS_SOFTDEP_MAXDEPS	9	/* records before updates go synchronous */
+#define FFS_SOFTDEPSTATS	10	/* struct: dependency counts */
+#define	FFS_MAXID		11	/* number of valid ffs ids */
 
 #define FFS_NAMES { \
 	{ 0, 0 }, \
@@ -74,6 +80,12 @@
 	{ "doclusterwrite", CTLTYPE_INT }, \
 	{ "doreallocblks", CTLTYPE_INT }, \
 	{ "doasyncfree", CTLTYPE_INT }, \
+	{ "bswapstats", CTLTYPE_STRUCT }, \
+	{ "dirhash_minsize", CTLTYPE_INT }, \
+	{ "dirhash_maxmem", CTLTYPE_INT }, \
+	{ "dirhashstats", CTLTYPE_STRUCT }, \
+	{ "softdep_maxdeps", CTLTYPE_INT }, \
+	{ "softdepstats", CTLTYPE_STRUCT }, \
 }
 
 struct buf;
@@ -79,10 +79,13 @@
 
 #include <ufs/ufs/quota.h>
 #include <ufs/ufs/inode.h>
+#include <ufs/ufs/dir.h>
+#include <ufs/ufs/dirhash.h>
 #include <ufs/ufs/ufsmount.h>
 #include <ufs/ufs/ufs_extern.h>
 
 #include <ufs/ffs/fs.h>
+#include <ufs/ffs/softdep.h>
 #include <ufs/ffs/ffs_extern.h>
 
 #if REV_ENDIAN_FS
@@ -166,6 +169,8 @@ ffs_update(ap)
 #endif /* REV_ENDIAN_FS */
 	*((struct dinode *)bp->b_data +
 	    ino_to_fsbo(fs, ip->i_number)) = ip->i_din;
+	if (DOINGSOFTDEP(ap->a_vp))
+		softdep_update_inodeblock(ip, bp);
 #if REV_ENDIAN_FS
 	}
 #endif /* REV_ENDIAN_FS */
@@ -221,6 +226,9 @@ ffs_truncate(ap)
 	if (length > fs->fs_maxfilesize)
 	        return (EFBIG);
 
+	if (ovp->v_type == VDIR)
+		ufsdirhash_dirtrunc(oip, (doff_t)length);
+
 	tv = time;
 	if (ovp->v_type == VLNK &&
 	    oip->i_size < ovp->v_mount->mnt_maxsymlinklen) {
@@ -0,0 +1,893 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.1 (the "License").  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON- INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+ * Ordered delayed metadata writes; see <ufs/ffs/softdep.h>.
+ *
+ * Every record lives at splbio, since the buffer hooks run from
+ * biodone() at interrupt level.  Nothing is freed there: finished
+ * records go onto softdep_workitem_pending and inodedeps that may have
+ * nothing left to do onto softdep_idle, and softdep_process_worklist()
+ * deals with both from ffs_sync().  Records are allocated before a
+ * lookup so that no pointer is held across a sleep in MALLOC.
+ */
+
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/buf.h>
+#include <sys/kernel.h>
+#include <sys/malloc.h>
+#include <sys/mount.h>
+#include <sys/proc.h>
+#include <sys/vnode.h>
+
+#include <ufs/ufs/quota.h>
+#include <ufs/ufs/inode.h>
+#include <ufs/ufs/dir.h>
+#include <ufs/ufs/ufsmount.h>
+#include <ufs/ufs/ufs_extern.h>
+
+#include <ufs/ffs/fs.h>
+#include <ufs/ffs/softdep.h>
+#include <ufs/ffs/ffs_extern.h>
+
+int	softdep_maxdeps;		/* records before updates go synchronous */
+struct softdep_stats softdep_stats;
+
+static LIST_HEAD(inodedep_hashhead, inodedep) *inodedep_hashtbl;
+static u_long	inodedep_hash;
+#define	INODEDEP_HASH(mp, ino) \
+	(&inodedep_hashtbl[(((u_long)(mp) >> 8) + (u_long)(ino)) & inodedep_hash])
+
+static struct workhead softdep_workitem_pending;
+static LIST_HEAD(, inodedep) softdep_idle;
+
+static void	softdep_disk_io_initiation __P((struct buf *));
+static void	softdep_disk_write_complete __P((struct buf *));
+static void	softdep_deallocate_dependencies __P((struct buf *));
+
+static struct inodedep *inodedep_lookup __P((struct mount *, ino_t,
+		    struct inodedep **));
+static void	inodedep_idle __P((struct inodedep *));
+static void	inodedep_written __P((struct inodedep *));
+static struct diradd *diradd_find __P((struct buf *, int));
+static void	diradd_free __P((struct diradd *));
+static void	worklist_add __P((struct worklist *));
+static int	handle_dirrem __P((struct dirrem *));
+static int	softdep_count_mount __P((struct mount *));
+static void	softdep_discard __P((struct mount *));
+
+void
+softdep_initialize()
+{
+
+	if (inodedep_hashtbl != NULL)
+		return;
+	LIST_INIT(&softdep_workitem_pending);
+	LIST_INIT(&softdep_idle);
+	inodedep_hashtbl = hashinit(desiredvnodes, M_SOFTDEP, &inodedep_hash);
+	softdep_maxdeps = desiredvnodes * 32;
+	bioops.io_start = softdep_disk_io_initiation;
+	bioops.io_complete = softdep_disk_write_complete;
+	bioops.io_deallocate = softdep_deallocate_dependencies;
+}
+
+/*
+ * Find the inodedep for ino.  If there is none and sparep points at a
+ * preallocated one, that is used and *sparep cleared; otherwise NULL.
+ * Called at splbio.
+ */
+static struct inodedep *
+inodedep_lookup(mp, ino, sparep)
+	struct mount *mp;
+	ino_t ino;
+	struct inodedep **sparep;
+{
+	struct inodedep_hashhead *hp = INODEDEP_HASH(mp, ino);
+	struct inodedep *id;
+
+	for (id = hp->lh_first; id != NULL; id = id->id_hash.le_next)
+		if (id->id_ino == ino && id->id_mp == mp)
+			return (id);
+	if (sparep == NULL || (id = *sparep) == NULL)
+		return (NULL);
+	*sparep = NULL;
+	bzero((caddr_t)id, sizeof (*id));
+	id->id_list.wk_type = D_INODEDEP;
+	id->id_mp = mp;
+	id->id_ino = ino;
+	LIST_INIT(&id->id_pendinghd);
+	LIST_INSERT_HEAD(hp, id, id_hash);
+	softdep_stats.sds_current++;
+	return (id);
+}
+
+/*
+ * Note an inodedep that may have nothing left to do; the work list
+ * frees it if that is still so.  Called at splbio.
+ */
+static void
+inodedep_idle(id)
+	struct inodedep *id;
+{
+
+	if (id->id_list.wk_state & IDLECHECK)
+		return;
+	id->id_list.wk_state |= IDLECHECK;
+	LIST_INSERT_HEAD(&softdep_idle, id, id_idle);
+}
+
+/*
+ * The inode block holding id_donegen is on disk: the entries that were
+ * waiting for it may go out as they are.  A rolled back entry stays on
+ * its buffer until that write finishes and puts d_ino back.
+ */
+static void
+inodedep_written(id)
+	struct inodedep *id;
+{
+	struct diradd *da, *nda;
+
+	for (da = id->id_pendinghd.lh_first; da != NULL; da = nda) {
+		nda = da->da_pending.le_next;
+		if (da->da_gen > id->id_donegen)
+			continue;
+		LIST_REMOVE(da, da_pending);
+		da->da_list.wk_state |= COMPLETE;
+		if ((da->da_list.wk_state & ROLLEDBACK) == 0) {
+			LIST_REMOVE(&da->da_list, wk_list);
+			da->da_list.wk_state &= ~ATTACHED;
+			worklist_add(&da->da_list);
+		}
+	}
+	inodedep_idle(id);
+}
+
+static void
+worklist_add(wk)
+	struct worklist *wk;
+{
+
+	wk->wk_state |= ONWORKLIST;
+	LIST_INSERT_HEAD(&softdep_workitem_pending, wk, wk_list);
+}
+
+/*
+ * The link count of ip was raised; entries made for it from now on
+ * must wait until it has been written.  Called before the VOP_UPDATE.
+ */
+void
+softdep_change_linkcnt(ip)
+	struct inode *ip;
+{
+	struct inodedep *id, *spare;
+	int s;
+
+	MALLOC(spare, struct inodedep *, sizeof (*spare), M_SOFTDEP, M_WAITOK);
+	s = splbio();
+	id = inodedep_lookup(ITOV(ip)->v_mount, ip->i_number, &spare);
+	id->id_gen++;
+	splx(s);
+	if (spare != NULL)
+		FREE(spare, M_SOFTDEP);
+}
+
+/*
+ * ffs_update() has copied ip into bp: add back the link drops that may
+ * not reach the disk yet and, if the copy holds a link count increase
+ * not known to be on disk, hang the inodedep on the buffer.
+ */
+void
+softdep_update_inodeblock(ip, bp)
+	struct inode *ip;
+	struct buf *bp;
+{
+	struct inodedep *id;
+	int s;
+
+	s = splbio();
+	if ((id = inodedep_lookup(ITOV(ip)->v_mount, ip->i_number,
+	    NULL)) == NULL) {
+		splx(s);
+		return;
+	}
+	((struct dinode *)bp->b_data + ino_to_fsbo(ip->i_fs, ip->i_number))->
+	    di_nlink += id->id_nlinkdelta;
+	id->id_savedgen = id->id_gen;
+	if (id->id_savedgen != id->id_donegen &&
+	    (id->id_list.wk_state & ATTACHED) == 0) {
+		id->id_list.wk_state |= ATTACHED;
+		LIST_INSERT_HEAD(&bp->b_dep, &id->id_list, wk_list);
+	}
+	splx(s);
+}
+
+/*
+ * ffs_vget() has read ip from disk, where its link count still includes
+ * the pending drops.
+ */
+void
+softdep_load_inodeblock(ip)
+	struct inode *ip;
+{
+	struct inodedep *id;
+	int s;
+
+	s = splbio();
+	if ((id = inodedep_lookup(ITOV(ip)->v_mount, ip->i_number,
+	    NULL)) != NULL)
+		ip->i_nlink -= id->id_nlinkdelta;
+	splx(s);
+}
+
+/*
+ * An entry for newino has been put at offset off of the directory
+ * buffer bp, which the caller will bdwrite().  If newino's link count
+ * may not be on disk yet, the entry must not be either.
+ */
+void
+softdep_setup_directory_add(bp, dp, off, newino)
+	struct buf *bp;
+	struct inode *dp;
+	int off;
+	ino_t newino;
+{
+	struct inodedep *id;
+	struct diradd *da;
+	int s;
+
+	MALLOC(da, struct diradd *, sizeof (*da), M_SOFTDEP, M_WAITOK);
+	s = splbio();
+	id = inodedep_lookup(ITOV(dp)->v_mount, newino, NULL);
+	if (id == NULL || id->id_gen == id->id_donegen) {
+		splx(s);
+		FREE(da, M_SOFTDEP);
+		return;
+	}
+	bzero((caddr_t)da, sizeof (*da));
+	da->da_list.wk_type = D_DIRADD;
+	da->da_list.wk_state = ATTACHED;
+	da->da_inodedep = id;
+	da->da_offset = off;
+	da->da_ino = newino;
+	da->da_gen = id->id_gen;
+	LIST_INSERT_HEAD(&bp->b_dep, &da->da_list, wk_list);
+	LIST_INSERT_HEAD(&id->id_pendinghd, da, da_pending);
+	softdep_stats.sds_diradd++;
+	softdep_stats.sds_current++;
+	splx(s);
+}
+
+/*
+ * ufs_direnter2() moved an entry while compacting a block.
+ */
+void
+softdep_change_directoryentry_offset(bp, dp, oldoff, newoff)
+	struct buf *bp;
+	struct inode *dp;
+	int oldoff, newoff;
+{
+	struct diradd *da;
+	int s;
+
+	s = splbio();
+	if ((da = diradd_find(bp, oldoff)) != NULL)
+		da->da_offset = newoff;
+	splx(s);
+}
+
+/*
+ * The incomplete diradd for the entry at off in bp, if any.  While the
+ * caller holds bp no write is in progress, so every diradd still on it
+ * is waiting for its inode.
+ */
+static struct diradd *
+diradd_find(bp, off)
+	struct buf *bp;
+	int off;
+{
+	struct worklist *wk;
+
+	for (wk = bp->b_dep.lh_first; wk != NULL; wk = wk->wk_list.le_next)
+		if (wk->wk_type == D_DIRADD &&
+		    (wk->wk_state & COMPLETE) == 0 &&
+		    WK_DIRADD(wk)->da_offset == off)
+			return (WK_DIRADD(wk));
+	return (NULL);
+}
+
+/*
+ * Take an incomplete diradd off its buffer and inodedep and free it.
+ * Called at splbio in process context.
+ */
+static void
+diradd_free(da)
+	struct diradd *da;
+{
+
+	LIST_REMOVE(&da->da_list, wk_list);
+	LIST_REMOVE(da, da_pending);
+	inodedep_idle(da->da_inodedep);
+	FREE(da, M_SOFTDEP);
+	softdep_stats.sds_current--;
+}
+
+/*
+ * The entry at off in bp is being changed or removed and written
+ * synchronously; whatever it named no longer matters to the buffer.
+ */
+void
+softdep_cancel_diradd(bp, dp, off)
+	struct buf *bp;
+	struct inode *dp;
+	int off;
+{
+	struct diradd *da;
+	int s;
+
+	s = splbio();
+	if ((da = diradd_find(bp, off)) != NULL) {
+		diradd_free(da);
+		softdep_stats.sds_cancel++;
+	}
+	splx(s);
+}
+
+/*
+ * The entry for ip at off in bp has been cleared and bp will be
+ * bdwrite()n.  The caller drops i_nlink as usual; the drop is kept out
+ * of the on-disk inode until bp is on disk.  For a directory the entry
+ * took two links from ip (its name and its ".") and one from dp.
+ *
+ * An entry that never reached the disk needs none of this.
+ */
+void
+softdep_setup_remove(bp, dp, ip, off, isrmdir)
+	struct buf *bp;
+	struct inode *dp, *ip;
+	int off, isrmdir;
+{
+	struct mount *mp = ITOV(dp)->v_mount;
+	struct inodedep *id, *spare[2];
+	struct diradd *da;
+	struct dirrem *dm;
+	int s;
+
+	s = splbio();
+	if ((da = diradd_find(bp, off)) != NULL) {
+		diradd_free(da);
+		softdep_stats.sds_cancel++;
+		splx(s);
+		return;
+	}
+	splx(s);
+
+	MALLOC(dm, struct dirrem *, sizeof (*dm), M_SOFTDEP, M_WAITOK);
+	MALLOC(spare[0], struct inodedep *, sizeof (struct inodedep),
+	    M_SOFTDEP, M_WAITOK);
+	spare[1] = NULL;
+	if (isrmdir)
+		MALLOC(spare[1], struct inodedep *, sizeof (struct inodedep),
+		    M_SOFTDEP, M_WAITOK);
+	bzero((caddr_t)dm, sizeof (*dm));
+	dm->dm_list.wk_type = D_DIRREM;
+	dm->dm_list.wk_state = ATTACHED;
+	dm->dm_mp = mp;
+	dm->dm_ino = ip->i_number;
+	dm->dm_dirino = dp->i_number;
+
+	s = splbio();
+	LIST_INSERT_HEAD(&bp->b_dep, &dm->dm_list, wk_list);
+	id = inodedep_lookup(mp, ip->i_number, &spare[0]);
+	id->id_nlinkdelta++;
+	if (isrmdir) {
+		dm->dm_list.wk_state |= RMDIR;
+		id->id_nlinkdelta++;
+		id = inodedep_lookup(mp, dp->i_number, &spare[1]);
+		id->id_nlinkdelta++;
+	}
+	softdep_stats.sds_dirrem++;
+	softdep_stats.sds_current++;
+	splx(s);
+	if (spare[0] != NULL)
+		FREE(spare[0], M_SOFTDEP);
+	if (spare[1] != NULL)
+		FREE(spare[1], M_SOFTDEP);
+}
+
+/*
+ * Nonzero if ip has link drops that are not yet on disk, so that
+ * ufs_inactive() must not free it even though i_nlink is 0.
+ */
+int
+softdep_unlink_pending(ip)
+	struct inode *ip;
+{
+	struct inodedep *id;
+	int s, pending;
+
+	s = splbio();
+	id = inodedep_lookup(ITOV(ip)->v_mount, ip->i_number, NULL);
+	pending = (id != NULL && id->id_nlinkdelta > 0);
+	splx(s);
+	return (pending);
+}
+
+/*
+ * Nonzero if so many records are outstanding that the caller should do
+ * its update synchronously instead.
+ */
+int
+softdep_slowdown(vp)
+	struct vnode *vp;
+{
+
+	if (softdep_stats.sds_current <= softdep_maxdeps)
+		return (0);
+	softdep_stats.sds_sync++;
+	return (1);
+}
+
+/*
+ * bwrite() is about to start bp.  Entries whose inodes are not on disk
+ * are written as empty slots.
+ */
+static void
+softdep_disk_io_initiation(bp)
+	struct buf *bp;
+{
+	struct worklist *wk;
+	struct inodedep *id;
+	struct diradd *da;
+	struct direct *ep;
+	int s;
+
+	s = splbio();
+	for (wk = bp->b_dep.lh_first; wk != NULL; wk = wk->wk_list.le_next) {
+		switch (wk->wk_type) {
+		case D_INODEDEP:
+			id = WK_INODEDEP(wk);
+			id->id_iogen = id->id_savedgen;
+			break;
+		case D_DIRADD:
+			da = WK_DIRADD(wk);
+			if (da->da_list.wk_state & COMPLETE)
+				break;
+			ep = (struct direct *)((char *)bp->b_data +
+			    da->da_offset);
+			if (ep->d_ino != da->da_ino)
+				panic("softdep_disk_io_initiation: entry moved");
+			ep->d_ino = 0;
+			da->da_list.wk_state |= ROLLEDBACK;
+			softdep_stats.sds_rollback++;
+			break;
+		case D_DIRREM:
+			break;
+		default:
+			panic("softdep_disk_io_initiation: unknown type");
+		}
+	}
+	splx(s);
+}
+
+/*
+ * A write of bp has finished; called from biodone() at splbio.  Put
+ * back rolled back entries and dirty the buffer again so that they go
+ * out once their inodes have.
+ */
+static void
+softdep_disk_write_complete(bp)
+	struct buf *bp;
+{
+	struct worklist *wk, *nwk;
+	struct inodedep *id;
+	struct diradd *da;
+	int failed = (bp->b_flags & B_ERROR) != 0;
+	int redirty = 0;
+
+	for (wk = bp->b_dep.lh_first; wk != NULL; wk = nwk) {
+		nwk = wk->wk_list.le_next;
+		switch (wk->wk_type) {
+		case D_INODEDEP:
+			if (failed)
+				break;
+			id = WK_INODEDEP(wk);
+			LIST_REMOVE(wk, wk_list);
+			wk->wk_state &= ~ATTACHED;
+			id->id_donegen = id->id_iogen;
+			inodedep_written(id);
+			break;
+		case D_DIRADD:
+			da = WK_DIRADD(wk);
+			if ((wk->wk_state & ROLLEDBACK) == 0)
+				break;
+			((struct direct *)((char *)bp->b_data +
+			    da->da_offset))->d_ino = da->da_ino;
+			wk->wk_state &= ~ROLLEDBACK;
+			redirty = 1;
+			if (wk->wk_state & COMPLETE) {
+				LIST_REMOVE(wk, wk_list);
+				wk->wk_state &= ~ATTACHED;
+				worklist_add(wk);
+			}
+			break;
+		case D_DIRREM:
+			if (failed)
+				break;
+			LIST_REMOVE(wk, wk_list);
+			wk->wk_state &= ~ATTACHED;
+			worklist_add(wk);
+			break;
+		}
+	}
+	if (redirty && (bp->b_flags & B_DELWRI) == 0) {
+		bp->b_flags |= B_DELWRI;
+		reassignbuf(bp, bp->b_vp);
+	}
+}
+
+/*
+ * bp is being thrown away.  A directory block goes only when its
+ * directory has been truncated or on a write error, so its removals
+ * count as done.  An inode block copy is lost; rather than hold the
+ * entries that wait for it forever they are let go.
+ */
+static void
+softdep_deallocate_dependencies(bp)
+	struct buf *bp;
+{
+	struct worklist *wk;
+	struct inodedep *id;
+	struct diradd *da;
+	int s;
+
+	s = splbio();
+	while ((wk = bp->b_dep.lh_first) != NULL) {
+		LIST_REMOVE(wk, wk_list);
+		wk->wk_state &= ~ATTACHED;
+		switch (wk->wk_type) {
+		case D_INODEDEP:
+			id = WK_INODEDEP(wk);
+			id->id_donegen = id->id_savedgen;
+			inodedep_written(id);
+			break;
+		case D_DIRADD:
+			da = WK_DIRADD(wk);
+			if ((wk->wk_state & COMPLETE) == 0) {
+				LIST_REMOVE(da, da_pending);
+				inodedep_idle(da->da_inodedep);
+			}
+			worklist_add(wk);
+			break;
+		case D_DIRREM:
+			worklist_add(wk);
+			break;
+		}
+	}
+	splx(s);
+}
+
+/*
+ * Finish the records of mp that the buffer hooks handed over and free
+ * the inodedeps that have nothing left to do.  Called from ffs_sync()
+ * with no vnodes locked.  Returns the number of removals finished.
+ */
+int
+softdep_process_worklist(mp)
+	struct mount *mp;
+{
+	struct worklist *wk, *nwk;
+	struct inodedep *id;
+	int s, done = 0;
+
+	s = splbio();
+restart:
+	for (wk = softdep_workitem_pending.lh_first; wk != NULL; wk = nwk) {
+		nwk = wk->wk_list.le_next;
+		if (wk->wk_type == D_DIRREM && WK_DIRREM(wk)->dm_mp != mp)
+			continue;
+		LIST_REMOVE(wk, wk_list);
+		wk->wk_state &= ~ONWORKLIST;
+		if (wk->wk_type == D_DIRADD) {
+			FREE(wk, M_SOFTDEP);
+			softdep_stats.sds_current--;
+			continue;
+		}
+		splx(s);
+		if (handle_dirrem(WK_DIRREM(wk)) != 0) {
+			/* Try again at the next sync. */
+			s = splbio();
+			worklist_add(wk);
+			break;
+		}
+		FREE(wk, M_SOFTDEP);
+		done++;
+		s = splbio();
+		softdep_stats.sds_current--;
+		softdep_stats.sds_handled++;
+		goto restart;
+	}
+
+	while ((id = softdep_idle.lh_first) != NULL) {
+		LIST_REMOVE(id, id_idle);
+		id->id_list.wk_state &= ~IDLECHECK;
+		if (id->id_nlinkdelta != 0 || id->id_pendinghd.lh_first != NULL ||
+		    (id->id_list.wk_state & ATTACHED) ||
+		    id->id_gen != id->id_donegen)
+			continue;
+		LIST_REMOVE(id, id_hash);
+		FREE(id, M_SOFTDEP);
+		softdep_stats.sds_current--;
+	}
+	splx(s);
+	return (done);
+}
+
+/*
+ * The name removed by dm is on disk: let the link count drop.  If it
+ * reaches zero the vput() has ufs_inactive() free the inode.
+ */
+static int
+handle_dirrem(dm)
+	struct dirrem *dm;
+{
+	struct inodedep *id;
+	struct vnode *vp;
+	int error, s;
+
+	if ((error = ffs_vget(dm->dm_mp, dm->dm_ino, &vp)) != 0)
+		return (error);
+	s = splbio();
+	id = inodedep_lookup(dm->dm_mp, dm->dm_ino, NULL);
+	if (id == NULL)
+		panic("handle_dirrem: no inodedep");
+	id->id_nlinkdelta -= (dm->dm_list.wk_state & RMDIR) ? 2 : 1;
+	inodedep_idle(id);
+	splx(s);
+	VTOI(vp)->i_flag |= IN_CHANGE;
+	vput(vp);
+	if ((dm->dm_list.wk_state & RMDIR) == 0)
+		return (0);
+
+	/*
+	 * The ".." of the removed directory went with it.  Should the
+	 * parent not come back, its count just stays one high on disk.
+	 */
+	error = ffs_vget(dm->dm_mp, dm->dm_dirino, &vp);
+	s = splbio();
+	id = inodedep_lookup(dm->dm_mp, dm->dm_dirino, NULL);
+	if (id == NULL)
+		panic("handle_dirrem: no parent inodedep");
+	id->id_nlinkdelta--;
+	inodedep_idle(id);
+	splx(s);
+	if (error == 0) {
+		VTOI(vp)->i_flag |= IN_CHANGE;
+		vput(vp);
+	}
+	return (0);
+}
+
+/*
+ * Push the inode blocks that entries in directory vp wait for, so that
+ * fsync() can write the directory without rolling anything back.  With
+ * MNT_WAIT, also wait for them and let go of entries whose inodes can
+ * no longer be written.
+ */
+int
+softdep_sync_metadata(vp, waitfor)
+	struct vnode *vp;
+	int waitfor;
+{
+	struct ufsmount *ump = VFSTOUFS(vp->v_mount);
+	struct fs *fs = ump->um_fs;
+	struct vnode *devvp = ump->um_devvp;
+	struct buf *bp, *ibp;
+	struct worklist *wk;
+	struct inodedep *id;
+	struct diradd *da;
+	int s;
+
+	if (vp->v_type != VDIR)
+		return (0);
+	s = splbio();
+loop:
+	for (bp = vp->v_dirtyblkhd.lh_first; bp; bp = bp->b_vnbufs.le_next) {
+		for (wk = bp->b_dep.lh_first; wk; wk = wk->wk_list.le_next) {
+			if (wk->wk_type != D_DIRADD ||
+			    (wk->wk_state & COMPLETE))
+				continue;
+			id = WK_DIRADD(wk)->da_inodedep;
+			if ((id->id_list.wk_state & ATTACHED) == 0)
+				continue;
+			ibp = incore(devvp, fsbtodb(fs, ino_to_fsba(fs,
+			    id->id_ino)));
+			if (ibp == NULL || (ibp->b_flags & B_BUSY) ||
+			    (ibp->b_flags & B_DELWRI) == 0)
+				continue;
+			bremfree(ibp);
+			ibp->b_flags |= B_BUSY;
+			splx(s);
+			softdep_stats.sds_inopush++;
+			if (waitfor == MNT_WAIT)
+				(void) bwrite(ibp);
+			else
+				(void) bawrite(ibp);
+			s = splbio();
+			goto loop;
+		}
+	}
+	if (waitfor != MNT_WAIT) {
+		splx(s);
+		return (0);
+	}
+	while (devvp->v_numoutput) {
+		devvp->v_flag |= VBWAIT;
+		tsleep((caddr_t)&devvp->v_numoutput, PRIBIO + 1, "sdsync", 0);
+	}
+	for (bp = vp->v_dirtyblkhd.lh_first; bp; bp = bp->b_vnbufs.le_next) {
+		if (bp->b_flags & B_BUSY)
+			continue;
+		for (wk = bp->b_dep.lh_first; wk; wk = wk->wk_list.le_next) {
+			if (wk->wk_type != D_DIRADD ||
+			    (wk->wk_state & COMPLETE))
+				continue;
+			da = WK_DIRADD(wk);
+			if (da->da_inodedep->id_list.wk_state & ATTACHED)
+				continue;
+			printf("softdep: ino %d never written, entry let go\n",
+			    da->da_ino);
+			diradd_free(da);
+			goto loop;
+		}
+	}
+	splx(s);
+	return (0);
+}
+
+/*
+ * Number of entries in bp that may not be written as they are.
+ */
+int
+softdep_count_dependencies(bp)
+	struct buf *bp;
+{
+	struct worklist *wk;
+	int s, count = 0;
+
+	s = splbio();
+	for (wk = bp->b_dep.lh_first; wk != NULL; wk = wk->wk_list.le_next)
+		if (wk->wk_type == D_DIRADD && (wk->wk_state & COMPLETE) == 0)
+			count++;
+	splx(s);
+	return (count);
+}
+
+/*
+ * Records still held for mp.  Every pending removal or entry keeps an
+ * inodedep, so counting those is enough.  Called at splbio.
+ */
+static int
+softdep_count_mount(mp)
+	struct mount *mp;
+{
+	struct inodedep *id;
+	struct worklist *wk;
+	int i, count = 0;
+
+	for (wk = softdep_workitem_pending.lh_first; wk;
+	    wk = wk->wk_list.le_next)
+		if (wk->wk_type == D_DIRREM && WK_DIRREM(wk)->dm_mp == mp)
+			count++;
+	for (i = 0; i <= inodedep_hash; i++)
+		for (id = inodedep_hashtbl[i].lh_first; id;
+		    id = id->id_hash.le_next)
+			if (id->id_mp == mp)
+				count++;
+	return (count);
+}
+
+/*
+ * Write everything out until no records of mp are left, for unmount
+ * and downgrade to read-only.  With FORCECLOSE whatever cannot be
+ * finished is dropped; fsck then finds link counts that are too high.
+ */
+int
+softdep_flushfiles(mp, flags, p)
+	struct mount *mp;
+	int flags;
+	struct proc *p;
+{
+	int error, loops, s, count;
+
+	for (loops = 0; loops < 10; loops++) {
+		(void) softdep_process_worklist(mp);
+		s = splbio();
+		count = softdep_count_mount(mp);
+		splx(s);
+		if (count == 0)
+			return (0);
+		if ((error = ffs_sync(mp, MNT_WAIT, p->p_ucred, p)) != 0 &&
+		    (flags & FORCECLOSE) == 0)
+			return (error);
+	}
+	if ((flags & FORCECLOSE) == 0)
+		return (EBUSY);
+	softdep_discard(mp);
+	return (0);
+}
+
+/*
+ * Drop every record of mp: removals on its directory buffers and on
+ * the work list, entries waiting for its inodes and the inodedeps.
+ */
+static void
+softdep_discard(mp)
+	struct mount *mp;
+{
+	struct vnode *vp;
+	struct buf *bp;
+	struct worklist *wk, *nwk;
+	struct inodedep *id, *nid;
+	struct diradd *da;
+	int i, s;
+
+	s = splbio();
+	for (vp = mp->mnt_vnodelist.lh_first; vp; vp = vp->v_mntvnodes.le_next) {
+		for (bp = vp->v_dirtyblkhd.lh_first; bp;
+		    bp = bp->b_vnbufs.le_next)
+			for (wk = bp->b_dep.lh_first; wk; wk = nwk) {
+				nwk = wk->wk_list.le_next;
+				if (wk->wk_type != D_DIRREM)
+					continue;
+				LIST_REMOVE(wk, wk_list);
+				FREE(wk, M_SOFTDEP);
+				softdep_stats.sds_current--;
+			}
+	}
+	for (wk = softdep_workitem_pending.lh_first; wk; wk = nwk) {
+		nwk = wk->wk_list.le_next;
+		if (wk->wk_type != D_DIRREM || WK_DIRREM(wk)->dm_mp != mp)
+			continue;
+		LIST_REMOVE(wk, wk_list);
+		FREE(wk, M_SOFTDEP);
+		softdep_stats.sds_current--;
+	}
+	for (i = 0; i <= inodedep_hash; i++)
+		for (id = inodedep_hashtbl[i].lh_first; id; id = nid) {
+			nid = id->id_hash.le_next;
+			if (id->id_mp != mp)
+				continue;
+			while ((da = id->id_pendinghd.lh_first) != NULL)
+				diradd_free(da);
+			if (id->id_list.wk_state & ATTACHED)
+				LIST_REMOVE(&id->id_list, wk_list);
+			if (id->id_list.wk_state & IDLECHECK)
+				LIST_REMOVE(id, id_idle);
+			LIST_REMOVE(id, id_hash);
+			FREE(id, M_SOFTDEP);
+			softdep_stats.sds_current--;
+		}
+	splx(s);
+}
@@ -117,7 +117,7 @@ ffs_blkatoff(ap)
 	}
 #if	REV_ENDIAN_FS
 	if (rev_endian)
-		byte_swap_dir_block_in(bp->b_data, bp->b_bcount);
+		byte_swap_dir_buf_in(bp);
 #endif	/* REV_ENDIAN_FS */
 
 	if (ap->a_res)
@@ -85,9 +85,12 @@
 #include <ufs/ufs/quota.h>
 #include <ufs/ufs/ufsmount.h>
 #include <ufs/ufs/inode.h>
+#include <ufs/ufs/dir.h>
+#include <ufs/ufs/dirhash.h>
 #include <ufs/ufs/ufs_extern.h>
 
 #include <ufs/ffs/fs.h>
+#include <ufs/ffs/softdep.h>
 #include <ufs/ffs/ffs_extern.h>
 #if REV_ENDIAN_FS
 #include <ufs/ufs/ufs_byte_order.h>
@@ -189,6 +192,7 @@ ffs_mount(mp, path, data, ndp, p)
 				flags |= FORCECLOSE;
 			if (error = ffs_flushfiles(mp, flags, p))
 				return (error);
+			mp->mnt_flag &= ~MNT_SOFTDEP;
 			fs->fs_clean = 1;
 			fs->fs_ronly = 1;
 			if (error = ffs_sbupdate(ump, MNT_WAIT)) {
@@ -217,6 +221,10 @@ ffs_mount(mp, path, data, ndp, p)
 			}
 			fs->fs_ronly = 0;
 			fs->fs_clean = 0;
+			if ((fs->fs_flags & FS_DOSOFTDEP) &&
+			    (mp->mnt_flag & MNT_REVEND) == 0 &&
+			    ump->um_devvp->v_tag != VT_MFS)
+				mp->mnt_flag |= MNT_SOFTDEP;
 			(void) ffs_sbupdate(ump, MNT_WAIT);
 		}
 		if (args.fspec == 0) {
@@ -429,6 +437,7 @@ loop:
 		}
 		if (vinvalbuf(vp, 0, cred, p, 0, 0))
 			panic("ffs_reload: dirty2");
+		ufsdirhash_free(VTOI(vp));
 		/*
 		 * Step 6: re-read inode data for all active vnodes.
 		 */
@@ -643,6 +652,7 @@ ffs_mountfs(devvp, mp, p)
 	mp->mnt_data = (qaddr_t)ump;
 	mp->mnt_stat.f_fsid.val[0] = (long)dev;
 	mp->mnt_stat.f_fsid.val[1] = mp->mnt_vfc->vfc_typenum;
+	mp->mnt_flag |= MNT_NCFASTPATH;
 #ifdef NeXT
 #warning hardcoded max symlen
 	mp->mnt_maxsymlinklen = 60;
@@ -653,6 +663,15 @@ ffs_mountfs(devvp, mp, p)
 	if (rev_endian)
 		mp->mnt_flag |= MNT_REVEND;
 #endif /* REV_ENDIAN_FS */
+	/*
+	 * Order metadata writes by dependencies instead of writing them
+	 * synchronously, if tunefs asked for it.  Not for byte-swapped
+	 * file systems, whose directory blocks are converted at write
+	 * time, nor for mfs.
+	 */
+	if ((fs->fs_flags & FS_DOSOFTDEP) && ronly == 0 &&
+	    (mp->mnt_flag & MNT_REVEND) == 0 && devvp->v_tag != VT_MFS)
+		mp->mnt_flag |= MNT_SOFTDEP;
 	ump->um_mountp = mp;
 	ump->um_dev = dev;
 	ump->um_devvp = devvp;
@@ -750,6 +769,14 @@ ffs_unmount(mp, mntflags, p)
 		}
 	}
 	ump->um_devvp->v_specflags &= ~SI_MOUNTEDON;
+#if REV_ENDIAN_FS
+	/*
+	 * Cylinder group buffers may still be cached in host order and
+	 * point at fs; drop them before the device is closed.
+	 */
+	if (mp->mnt_flag & MNT_REVEND)
+		(void) vinvalbuf(ump->um_devvp, V_SAVE, NOCRED, p, 0, 0);
+#endif /* REV_ENDIAN_FS */
 	error = VOP_CLOSE(ump->um_devvp, fs->fs_ronly ? FREAD : FREAD|FWRITE,
 		NOCRED, p);
 	vrele(ump->um_devvp);
@@ -761,6 +788,7 @@ ffs_unmount(mp, mntflags, p)
 #if REV_ENDIAN_FS
 	mp->mnt_flag &= ~MNT_REVEND;
 #endif /* REV_ENDIAN_FS */
+	mp->mnt_flag &= ~(MNT_NCFASTPATH | MNT_SOFTDEP);
 	return (error);
 }
 
@@ -776,6 +804,12 @@ ffs_flushfiles(mp, flags, p)
 	int i, error;
 
 	ump = VFSTOUFS(mp);
+	/*
+	 * Let pending removals finish while the vnodes are still here.
+	 */
+	if ((mp->mnt_flag & MNT_SOFTDEP) &&
+	    (error = softdep_flushfiles(mp, flags, p)))
+		return (error);
 #if QUOTA
 	if (mp->mnt_flag & MNT_QUOTA) {
 		if (error = vflush(mp, NULLVP, SKIPSYSTEM|flags))
@@ -854,6 +888,12 @@ ffs_sync(mp, waitfor, cred, p)
 		printf("fs = %s\n", fs->fs_fsmnt);
 		panic("update: rofs mod");
 	}
+	/*
+	 * Finish the removals whose directory blocks have been written,
+	 * before the vnodes they free are synced.
+	 */
+	if (mp->mnt_flag & MNT_SOFTDEP)
+		(void) softdep_process_worklist(mp);
 	/*
 	 * Write back each (modified) inode.
 	 */
@@ -991,6 +1031,8 @@ ffs_vget(mp, ino, vpp)
 	} else {
 #endif /* REV_ENDIAN_FS */
 	ip->i_din = *((struct dinode *)bp->b_data + ino_to_fsbo(fs, ino));
+	if (mp->mnt_flag & MNT_SOFTDEP)
+		softdep_load_inodeblock(ip);
 #if REV_ENDIAN_FS
 	}
 #endif /* REV_ENDIAN_FS */
@@ -1089,13 +1131,14 @@ ffs_vptofh(vp, fhp)
 }
 
 /*
- * Initialize the filesystem; just use ufs_init.
+ * Initialize the filesystem; ufs_init does most of it.
  */
 int
 ffs_init(vfsp)
 	struct vfsconf *vfsp;
 {
 
+	softdep_initialize();
 	return (ufs_init(vfsp));
 }
 
@@ -1129,6 +1172,26 @@ ffs_sysctl(name, namelen, oldp, oldlenp, newp, newlen, p)
 		    &doreallocblks));
 	case FFS_ASYNCFREE:
 		return (sysctl_int(oldp, oldlenp, newp, newlen, &doasyncfree));
+#if REV_ENDIAN_FS
+	case FFS_BSWAPSTATS:
+		return (sysctl_rdstruct(oldp, oldlenp, newp, &ufs_bswapstats,
+		    sizeof (ufs_bswapstats)));
+#endif /* REV_ENDIAN_FS */
+	case FFS_DIRHASH_MINSIZE:
+		return (sysctl_int(oldp, oldlenp, newp, newlen,
+		    &ufs_dirhashminsize));
+	case FFS_DIRHASH_MAXMEM:
+		return (sysctl_int(oldp, oldlenp, newp, newlen,
+		    &ufs_dirhashmaxmem));
+	case FFS_DIRHASHSTATS:
+		return (sysctl_rdstruct(oldp, oldlenp, newp, &ufs_dirhashstats,
+		    sizeof (ufs_dirhashstats)));
+	case FFS_SOFTDEP_MAXDEPS:
+		return (sysctl_int(oldp, oldlenp, newp, newlen,
+		    &softdep_maxdeps));
+	case FFS_SOFTDEPSTATS:
+		return (sysctl_rdstruct(oldp, oldlenp, newp, &softdep_stats,
+		    sizeof (softdep_stats)));
 	default:
 		return (EOPNOTSUPP);
 	}
@@ -85,6 +85,7 @@
 #include <ufs/ufs/ufs_extern.h>
 
 #include <ufs/ffs/fs.h>
+#include <ufs/ffs/softdep.h>
 #include <ufs/ffs/ffs_extern.h>
 #if REV_ENDIAN_FS
 #include <ufs/ufs/ufs_byte_order.h>
@@ -282,7 +283,14 @@ ffs_fsync(ap)
 	register struct buf *bp;
 	struct timeval tv;
 	struct buf *nbp;
-	int s;
+	int s, passes = 0;
+
+	/*
+	 * Get the inodes that new directory entries name onto disk
+	 * first, so the entries need not be rolled back.
+	 */
+	if (DOINGSOFTDEP(vp))
+		(void) softdep_sync_metadata(vp, ap->a_waitfor);
 
 	/*
 	 * Flush all dirty buffers associated with a vnode.
@@ -295,6 +303,13 @@ loop:
 			continue;
 		if ((bp->b_flags & B_DELWRI) == 0)
 			panic("ffs_fsync: not dirty");
+		/*
+		 * Writing a block whose entries still wait for their
+		 * inodes would only dirty it again.
+		 */
+		if (bp->b_dep.lh_first != NULL &&
+		    softdep_count_dependencies(bp))
+			continue;
 		bremfree(bp);
 		bp->b_flags |= B_BUSY;
 		splx(s);
@@ -318,9 +333,20 @@ loop:
 		 * check for dirty buffers again.  --Umesh
 		 */
 		if (vp->v_dirtyblkhd.lh_first) {
-			vprint("ffs_fsync: dirty", vp);
-			splx(s);
-			goto loop;
+			if (DOINGSOFTDEP(vp)) {
+				splx(s);
+				if (++passes < 5) {
+					(void) softdep_sync_metadata(vp,
+					    MNT_WAIT);
+					goto loop;
+				}
+				vprint("ffs_fsync: dependencies", vp);
+				s = splbio();
+			} else {
+				vprint("ffs_fsync: dirty", vp);
+				splx(s);
+				goto loop;
+			}
 		}
 	}
 	splx(s);
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.1 (the "License").  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON- INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+ * Dependency records for ordered delayed metadata writes in FFS.
+ *
+ * Without them every create and remove writes its inode and directory
+ * block synchronously so the disk never holds a name for an inode that
+ * is not there, nor a freed inode that still has a name.  With them the
+ * blocks are written with bdwrite() and the records enforce the order:
+ *
+ *	diradd	a new directory entry must not reach the disk before the
+ *		inode it names, with its link count, has been written.
+ *		While the inode is outstanding the entry's d_ino is
+ *		written as 0 and put back when the write finishes.
+ *
+ *	dirrem	the link count on disk must not drop before the block
+ *		from which the name was removed has been written.  The
+ *		drop is held in the inodedep and added back to every
+ *		copy of the inode that goes to disk; once the block is
+ *		out the dirrem is handed to the work list, which drops
+ *		the count and lets the inode be truncated and freed.
+ *
+ * Blocks still are allocated and freed as before: ffs_truncate() writes
+ * the inode synchronously before giving blocks back.  A crash therefore
+ * leaves at worst link counts that are too high and unreferenced
+ * inodes, both of which fsck -p repairs.
+ */
+
+#ifndef _UFS_FFS_SOFTDEP_H_
+#define _UFS_FFS_SOFTDEP_H_
+
+#include <sys/queue.h>
+
+/* wk_type */
+#define	D_INODEDEP	1
+#define	D_DIRADD	2
+#define	D_DIRREM	3
+
+/* wk_state */
+#define	ATTACHED	0x0001	/* on a buffer's b_dep */
+#define	ONWORKLIST	0x0002	/* on softdep_workitem_pending */
+#define	ROLLEDBACK	0x0004	/* diradd: d_ino is 0 for the write */
+#define	COMPLETE	0x0008	/* diradd: the inode is on disk */
+#define	RMDIR		0x0010	/* dirrem: the name was of a directory */
+#define	IDLECHECK	0x0020	/* inodedep: on softdep_idle */
+
+/*
+ * One per inode with something outstanding, hashed by mount and inode
+ * number.  id_gen counts link count increases; id_savedgen is the last
+ * one copied into the inode block, id_iogen the one being written and
+ * id_donegen the last one known to be on disk.  The inodedep sits on
+ * the inode block's b_dep while id_savedgen is not yet on disk.
+ */
+struct inodedep {
+	struct	worklist id_list;	/* on the inode block's b_dep */
+	LIST_ENTRY(inodedep) id_hash;	/* hash chain */
+	LIST_ENTRY(inodedep) id_idle;	/* on softdep_idle */
+	struct	mount *id_mp;		/* file system */
+	ino_t	id_ino;			/* inode number */
+	int	id_nlinkdelta;		/* link drops not yet on disk */
+	u_long	id_gen;			/* link count increases */
+	u_long	id_savedgen;		/* ... copied into the inode block */
+	u_long	id_iogen;		/* ... being written */
+	u_long	id_donegen;		/* ... on disk */
+	LIST_HEAD(, diradd) id_pendinghd; /* entries waiting for us */
+};
+
+/*
+ * A directory entry, at da_offset in the directory buffer, that names
+ * an inode whose link count is not yet on disk.
+ */
+struct diradd {
+	struct	worklist da_list;	/* on the directory buffer's b_dep */
+	LIST_ENTRY(diradd) da_pending;	/* on the inodedep's id_pendinghd */
+	struct	inodedep *da_inodedep;	/* inode we wait for */
+	int	da_offset;		/* entry's offset in the buffer */
+	ino_t	da_ino;			/* d_ino to put back */
+	u_long	da_gen;			/* id_gen that must be on disk */
+};
+
+/*
+ * A name removed from a directory buffer; the link count of dm_ino
+ * (and for a directory, of its parent dm_dirino) may drop on disk
+ * once the buffer has been written.
+ */
+struct dirrem {
+	struct	worklist dm_list;	/* on the buffer, then the work list */
+	struct	mount *dm_mp;		/* file system */
+	ino_t	dm_ino;			/* inode whose name went */
+	ino_t	dm_dirino;		/* directory it was in */
+};
+
+#define	WK_INODEDEP(wk)	((struct inodedep *)(wk))
+#define	WK_DIRADD(wk)	((struct diradd *)(wk))
+#define	WK_DIRREM(wk)	((struct dirrem *)(wk))
+
+/*
+ * Counters, returned by the vfs.ufs.softdepstats sysctl.
+ */
+struct softdep_stats {
+	u_long	sds_diradd;	/* entries ordered behind their inodes */
+	u_long	sds_dirrem;	/* link count drops ordered behind removals */
+	u_long	sds_cancel;	/* entries removed before reaching the disk */
+	u_long	sds_rollback;	/* entries rolled back in a directory write */
+	u_long	sds_inopush;	/* inode blocks written for fsync */
+	u_long	sds_handled;	/* dirrems finished by the work list */
+	u_long	sds_sync;	/* updates done synchronously at the limit */
+	u_long	sds_current;	/* records outstanding */
+};
+
+#ifdef _KERNEL
+struct buf;
+struct inode;
+struct mount;
+struct proc;
+struct vnode;
+
+extern int	softdep_maxdeps;
+extern struct softdep_stats softdep_stats;
+
+__BEGIN_DECLS
+void	softdep_initialize __P((void));
+void	softdep_load_inodeblock __P((struct inode *));
+void	softdep_update_inodeblock __P((struct inode *, struct buf *));
+int	softdep_sync_metadata __P((struct vnode *, int));
+int	softdep_count_dependencies __P((struct buf *));
+int	softdep_process_worklist __P((struct mount *));
+int	softdep_flushfiles __P((struct mount *, int, struct proc *));
+__END_DECLS
+#endif /* _KERNEL */
+
+#endif /* !_UFS_FFS_SOFTDEP_H_ */
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.1 (the "License").  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON- INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+ * In-core hash index of large UFS directories.
+ *
+ * A directory of at least ufs_dirhashminsize bytes gets a hash table
+ * the first time it is searched.  The table maps names to the offsets
+ * of their entries, so a lookup reads only the block that holds the
+ * entry instead of scanning the directory.  A per-DIRBLKSIZ count of
+ * free space lets a create find a block with room without a scan.
+ * The table is kept up to date by ufs_direnter2(), ufs_dirremove()
+ * and ffs_truncate(); anything unexpected just throws it away and
+ * the next lookup rebuilds it or falls back to the linear scan.
+ *
+ * Tables are charged against ufs_dirhashmaxmem.  When that is used up
+ * the least recently used tables of unlocked directories are freed;
+ * every use of a table happens with its directory locked.
+ */
+
+#ifndef _UFS_UFS_DIRHASH_H_
+#define _UFS_UFS_DIRHASH_H_
+
+#include <sys/queue.h>
+
+#define	DIRHASH_EMPTY	(-1)	/* slot never used */
+#define	DIRHASH_DEL	(-2)	/* slot's entry was removed */
+
+#define	DIRALIGN	4
+#define	DIRECTSIZ(namlen) \
+	((sizeof(struct direct) - (MAXNAMLEN+1)) + (((namlen)+1 + 3) &~ 3))
+
+/*
+ * dh_firstfree[n] is the first block with exactly n DIRALIGN units
+ * free, except that the last list holds every block with room for
+ * the largest possible entry.
+ */
+#define	DH_NFSTATS	((DIRECTSIZ(MAXNAMLEN) + DIRALIGN - 1) / DIRALIGN)
+#define	BLKFREE2IDX(n)	((n) > DH_NFSTATS ? DH_NFSTATS : (n))
+
+#define	DH_NBLKOFF	1024	/* hash slots per second-level array */
+
+struct dirhash {
+	struct	inode *dh_ip;	/* directory this indexes */
+	doff_t	**dh_hash;	/* second-level arrays of entry offsets */
+	int	dh_narrays;	/* number of second-level arrays */
+	int	dh_hlen;	/* total number of slots */
+	int	dh_hused;	/* slots in use, including DIRHASH_DEL */
+
+	u_short	*dh_blkfree;	/* free DIRALIGN units per directory block */
+	int	dh_nblk;	/* size of dh_blkfree */
+	int	dh_dirblks;	/* directory blocks in use */
+	int	dh_firstfree[DH_NFSTATS + 1];
+
+	int	dh_memreq;	/* bytes charged to ufs_dirhashmem */
+	int	dh_seqopt;	/* lookups are walking the directory */
+	doff_t	dh_seqoff;	/* offset just past the last hit */
+	TAILQ_ENTRY(dirhash) dh_list;	/* LRU list, oldest first */
+};
+
+#define	DH_ENTRY(dh, slot) \
+	((dh)->dh_hash[(slot) / DH_NBLKOFF][(slot) % DH_NBLKOFF])
+
+/*
+ * Counters, returned by the vfs.ufs.dirhashstats sysctl.
+ */
+struct dirhash_stats {
+	u_long	dhs_builds;	/* tables built */
+	u_long	dhs_nomem;	/* builds refused for lack of memory */
+	u_long	dhs_recycled;	/* tables freed to make room */
+	u_long	dhs_dropped;	/* tables thrown away as inconsistent */
+	u_long	dhs_lookups;	/* lookups answered from a table */
+	u_long	dhs_hits;	/* ... that found the name */
+	u_long	dhs_seqhits;	/* ... at the expected sequential offset */
+	u_long	dhs_fallback;	/* lookups that fell back to a scan */
+	u_long	dhs_findfree;	/* free slots found from the block map */
+	u_long	dhs_probes;	/* directory entries compared */
+	u_long	dhs_mem;	/* bytes currently held */
+	u_long	dhs_ntables;	/* tables currently held */
+};
+
+#ifdef _KERNEL
+struct buf;
+struct direct;
+struct inode;
+
+extern int	ufs_dirhashminsize;
+extern int	ufs_dirhashmaxmem;
+extern struct dirhash_stats ufs_dirhashstats;
+
+__BEGIN_DECLS
+void	ufsdirhash_init __P((void));
+int	ufsdirhash_build __P((struct inode *));
+int	ufsdirhash_lookup __P((struct inode *, char *, int, doff_t *,
+	    struct buf **, doff_t *));
+doff_t	ufsdirhash_findfree __P((struct inode *, int, int *));
+doff_t	ufsdirhash_enddir __P((struct inode *));
+void	ufsdirhash_add __P((struct inode *, struct direct *, doff_t));
+void	ufsdirhash_remove __P((struct inode *, struct direct *, doff_t));
+void	ufsdirhash_move __P((struct inode *, struct direct *, doff_t,
+	    doff_t));
+void	ufsdirhash_newblk __P((struct inode *, doff_t));
+void	ufsdirhash_dirtrunc __P((struct inode *, doff_t));
+void	ufsdirhash_free __P((struct inode *));
+__END_DECLS
+#endif /* _KERNEL */
+
+#endif /* !_UFS_UFS_DIRHASH_H_ */
@@ -108,6 +108,7 @@ struct inode {
 	doff_t	  i_offset;	/* Offset of free space in directory. */
 	ino_t	  i_ino;	/* Inode number of found directory. */
 	u_int32_t i_reclen;	/* Size of found directory entry. */
+	struct	 dirhash *i_dirhash;	/* Hashed index of a large directory. */
 	/*
 	 * The on-disk dinode itself.
 	 */
@@ -381,6 +381,83 @@ byte_swap_minidir_in(struct direct *dirp)
 	byte_swap_short(dirp->d_reclen);
 }
 
+/*
+ * Cached metadata buffers.
+ *
+ * A cylinder group or directory block is swapped to host order the
+ * first time it is used after being read, and the buffer is tagged
+ * with the routine that swaps it back.  bwrite() calls that routine
+ * before starting the I/O, so callers modify the buffer in place and
+ * write or release it without swapping; a block that stays in the
+ * cache is swapped once per read and once per write instead of on
+ * every allocation or lookup.
+ */
+struct ufs_bswapstats ufs_bswapstats;
+
+static void
+byte_swap_cgbuf(struct buf *bp, int out)
+{
+	struct fs *fs = (struct fs *)bp->b_bswaparg;
+
+	if (out) {
+		byte_swap_cgout((struct cg *)bp->b_data, fs);
+		ufs_bswapstats.ubs_cgout++;
+	} else {
+		byte_swap_cgin((struct cg *)bp->b_data, fs);
+		ufs_bswapstats.ubs_cgin++;
+	}
+	ufs_bswapstats.ubs_bytes += fs->fs_cgsize;
+}
+
+void
+byte_swap_cgin_buf(struct buf *bp, struct fs *fs)
+{
+	if (bp->b_bswap == byte_swap_cgbuf) {
+		ufs_bswapstats.ubs_cghit++;
+		return;
+	}
+	bp->b_bswaparg = (void *)fs;
+	byte_swap_cgbuf(bp, 0);
+	bp->b_bswap = byte_swap_cgbuf;
+}
+
+static void
+byte_swap_dirbuf(struct buf *bp, int out)
+{
+	if (out) {
+		byte_swap_dir_block_out(bp);
+		ufs_bswapstats.ubs_dirout++;
+	} else {
+		byte_swap_dir_block_in(bp->b_data, bp->b_bcount);
+		ufs_bswapstats.ubs_dirin++;
+	}
+	ufs_bswapstats.ubs_bytes += bp->b_bcount;
+}
+
+void
+byte_swap_dir_buf_in(struct buf *bp)
+{
+	if (bp->b_bswap == byte_swap_dirbuf) {
+		ufs_bswapstats.ubs_dirhit++;
+		return;
+	}
+	byte_swap_dirbuf(bp, 0);
+	bp->b_bswap = byte_swap_dirbuf;
+}
+
+/*
+ * Put a tagged buffer back in disk order, for code that is about to
+ * store disk-order data into part of it.
+ */
+void
+byte_swap_buf_out(struct buf *bp)
+{
+	if (bp->b_bswap != NULL) {
+		(*bp->b_bswap)(bp, 1);
+		bp->b_bswap = NULL;
+	}
+}
+
 #if 0
 // This is for the compatability (old) cylinder group block
 void
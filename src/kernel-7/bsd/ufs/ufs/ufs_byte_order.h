@@ -66,5 +66,26 @@ void byte_swap_direct __P((struct direct *));
 void byte_swap_dirtemplate_in __P((struct dirtemplate *));
 void byte_swap_minidir_in __P((struct direct *));
 
+/*
+ * Cylinder group and directory buffers are converted to host order
+ * when first read and are tagged (b_bswap) so that bwrite() converts
+ * them back; later users of the cached buffer skip the swap.
+ */
+struct ufs_bswapstats {
+	u_long	ubs_cgin;		/* cg blocks swapped to host order */
+	u_long	ubs_cgout;		/* cg blocks swapped back for writing */
+	u_long	ubs_cghit;		/* cg blocks found in host order */
+	u_long	ubs_dirin;		/* dir blocks swapped to host order */
+	u_long	ubs_dirout;		/* dir blocks swapped back */
+	u_long	ubs_dirhit;		/* dir blocks found in host order */
+	u_long	ubs_bytes;		/* bytes of metadata swapped */
+};
+
+extern struct ufs_bswapstats ufs_bswapstats;
+
+void byte_swap_cgin_buf __P((struct buf *, struct fs *));
+void byte_swap_dir_buf_in __P((struct buf *));
+void byte_swap_buf_out __P((struct buf *));
+
 #endif /* _UFS_BYTE_ORDER_H_ */
 #endif	/* KERNEL_PRIVATE */
@@ -0,0 +1,748 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.1 (the "License").  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON- INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+ * Hashed index of large directories; see <ufs/ufs/dirhash.h>.
+ *
+ * The table is open addressed with linear probing.  Each slot holds
+ * the directory offset of an entry, DIRHASH_EMPTY, or DIRHASH_DEL for
+ * a removed entry that later probes must step over.  Names are not
+ * stored; a candidate offset is confirmed by reading the entry, which
+ * is in the buffer cache for any directory being searched this often.
+ */
+
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/buf.h>
+#include <sys/malloc.h>
+#include <sys/mount.h>
+#include <sys/vnode.h>
+
+#include <ufs/ufs/quota.h>
+#include <ufs/ufs/inode.h>
+#include <ufs/ufs/dir.h>
+#include <ufs/ufs/dirhash.h>
+#include <ufs/ufs/ufsmount.h>
+#include <ufs/ufs/ufs_extern.h>
+
+#define	WRAPINCR(val, limit)	(((val) + 1 == (limit)) ? 0 : ((val) + 1))
+#define	WRAPDECR(val, limit)	(((val) == 0) ? ((limit) - 1) : ((val) - 1))
+#define	FSFMT(vp)		((vp)->v_mount->mnt_maxsymlinklen <= 0)
+
+int	ufs_dirhashminsize = 5 * DIRBLKSIZ;	/* smallest directory hashed */
+int	ufs_dirhashmaxmem = 2 * 1024 * 1024;	/* 0 turns hashing off */
+struct dirhash_stats ufs_dirhashstats;
+
+static TAILQ_HEAD(, dirhash) ufsdirhash_list;
+
+static int	ufsdirhash_hash __P((struct dirhash *, char *, int));
+static void	ufsdirhash_adjfree __P((struct dirhash *, doff_t, int));
+static void	ufsdirhash_delslot __P((struct dirhash *, int));
+static void	ufsdirhash_drop __P((struct inode *));
+static int	ufsdirhash_findslot __P((struct dirhash *, char *, int,
+		    doff_t));
+static doff_t	ufsdirhash_getprev __P((struct direct *, doff_t));
+static int	ufsdirhash_recycle __P((int));
+static void	ufsdirhash_release __P((struct dirhash *));
+
+void
+ufsdirhash_init()
+{
+	TAILQ_INIT(&ufsdirhash_list);
+}
+
+/*
+ * Build a table for directory ip if it is large enough and there is
+ * room.  Returns 0 if the directory has a usable table, -1 if lookups
+ * should scan it.
+ */
+int
+ufsdirhash_build(ip)
+	struct inode *ip;
+{
+	struct vnode *vp = ITOV(ip);
+	struct dirhash *dh;
+	struct buf *bp = NULL;
+	struct direct *ep;
+	doff_t pos;
+	u_long bmask;
+	int dirblocks, i, j, memreqd, nblocks, narrays, nslots, slot;
+
+	if ((dh = ip->i_dirhash) != NULL) {
+		if (ip->i_size >= ufs_dirhashminsize &&
+		    ufs_dirhashstats.dhs_mem <= ufs_dirhashmaxmem)
+			return (0);
+		/* The tunables changed under it. */
+		ufsdirhash_free(ip);
+		return (-1);
+	}
+	if (ip->i_size < ufs_dirhashminsize || ufs_dirhashmaxmem == 0 ||
+	    FSFMT(vp) || ip->i_nlink == 0)
+		return (-1);
+
+	/*
+	 * Size the table for half again as many entries as the
+	 * directory could hold at its present size.
+	 */
+	nslots = ip->i_size / DIRECTSIZ(1);
+	nslots = (nslots * 3 + 1) / 2;
+	narrays = howmany(nslots, DH_NBLKOFF);
+	nslots = narrays * DH_NBLKOFF;
+	dirblocks = howmany(ip->i_size, DIRBLKSIZ);
+	nblocks = (dirblocks * 3 + 1) / 2;
+
+	memreqd = sizeof (*dh) + narrays * sizeof (doff_t *) +
+	    narrays * DH_NBLKOFF * sizeof (doff_t) +
+	    nblocks * sizeof (u_short);
+	if (memreqd + ufs_dirhashstats.dhs_mem > ufs_dirhashmaxmem &&
+	    (memreqd > ufs_dirhashmaxmem / 2 ||
+	    ufsdirhash_recycle(memreqd) != 0)) {
+		ufs_dirhashstats.dhs_nomem++;
+		return (-1);
+	}
+
+	/*
+	 * Don't wait for memory; a directory can always be scanned.
+	 */
+	MALLOC(dh, struct dirhash *, sizeof (*dh), M_DIRHASH, M_NOWAIT);
+	if (dh == NULL) {
+		ufs_dirhashstats.dhs_nomem++;
+		return (-1);
+	}
+	bzero((caddr_t)dh, sizeof (*dh));
+	MALLOC(dh->dh_hash, doff_t **, narrays * sizeof (doff_t *),
+	    M_DIRHASH, M_NOWAIT);
+	MALLOC(dh->dh_blkfree, u_short *, nblocks * sizeof (u_short),
+	    M_DIRHASH, M_NOWAIT);
+	if (dh->dh_hash == NULL || dh->dh_blkfree == NULL)
+		goto fail;
+	for (i = 0; i < narrays; i++) {
+		MALLOC(dh->dh_hash[i], doff_t *, DH_NBLKOFF * sizeof (doff_t),
+		    M_DIRHASH, M_NOWAIT);
+		if (dh->dh_hash[i] == NULL)
+			goto fail;
+		dh->dh_narrays++;
+		for (j = 0; j < DH_NBLKOFF; j++)
+			dh->dh_hash[i][j] = DIRHASH_EMPTY;
+	}
+
+	dh->dh_ip = ip;
+	dh->dh_hlen = nslots;
+	dh->dh_nblk = nblocks;
+	dh->dh_dirblks = dirblocks;
+	dh->dh_memreq = memreqd;
+	for (i = 0; i < dirblocks; i++)
+		dh->dh_blkfree[i] = DIRBLKSIZ / DIRALIGN;
+	for (i = 0; i < DH_NFSTATS; i++)
+		dh->dh_firstfree[i] = -1;
+	dh->dh_firstfree[DH_NFSTATS] = 0;
+	ufs_dirhashstats.dhs_mem += memreqd;
+
+	/*
+	 * Enter every entry.  The directory is locked, and nothing can
+	 * recycle this table before it is on the list.
+	 */
+	bmask = VFSTOUFS(vp->v_mount)->um_mountp->mnt_stat.f_iosize - 1;
+	pos = 0;
+	while (pos < ip->i_size) {
+		if ((pos & bmask) == 0) {
+			if (bp != NULL)
+				brelse(bp);
+			if (VOP_BLKATOFF(vp, (off_t)pos, NULL, &bp)) {
+				bp = NULL;
+				goto fail;
+			}
+		}
+		ep = (struct direct *)((char *)bp->b_data + (pos & bmask));
+		if (ep->d_reclen == 0 || ep->d_reclen >
+		    DIRBLKSIZ - (pos & (DIRBLKSIZ - 1)))
+			goto fail;	/* mangled; let the scan complain */
+		if (ep->d_ino != 0) {
+			slot = ufsdirhash_hash(dh, ep->d_name, ep->d_namlen);
+			while (DH_ENTRY(dh, slot) != DIRHASH_EMPTY)
+				slot = WRAPINCR(slot, dh->dh_hlen);
+			dh->dh_hused++;
+			DH_ENTRY(dh, slot) = pos;
+			ufsdirhash_adjfree(dh, pos, -DIRSIZ(0, ep));
+		}
+		pos += ep->d_reclen;
+	}
+	if (bp != NULL)
+		brelse(bp);
+
+	ip->i_dirhash = dh;
+	TAILQ_INSERT_TAIL(&ufsdirhash_list, dh, dh_list);
+	ufs_dirhashstats.dhs_ntables++;
+	ufs_dirhashstats.dhs_builds++;
+	return (0);
+
+fail:
+	if (bp != NULL)
+		brelse(bp);
+	if (dh->dh_memreq)
+		ufs_dirhashstats.dhs_mem -= dh->dh_memreq;
+	ufsdirhash_release(dh);
+	ufs_dirhashstats.dhs_nomem++;
+	return (-1);
+}
+
+/*
+ * Free a table's memory.  The caller has taken it off the list and
+ * uncharged it.
+ */
+static void
+ufsdirhash_release(dh)
+	struct dirhash *dh;
+{
+	int i;
+
+	if (dh->dh_hash != NULL) {
+		for (i = 0; i < dh->dh_narrays; i++)
+			FREE(dh->dh_hash[i], M_DIRHASH);
+		FREE(dh->dh_hash, M_DIRHASH);
+	}
+	if (dh->dh_blkfree != NULL)
+		FREE(dh->dh_blkfree, M_DIRHASH);
+	FREE(dh, M_DIRHASH);
+}
+
+/*
+ * Throw away the table of ip, if any.
+ */
+void
+ufsdirhash_free(ip)
+	struct inode *ip;
+{
+	struct dirhash *dh;
+
+	if ((dh = ip->i_dirhash) == NULL)
+		return;
+	ip->i_dirhash = NULL;
+	TAILQ_REMOVE(&ufsdirhash_list, dh, dh_list);
+	ufs_dirhashstats.dhs_ntables--;
+	ufs_dirhashstats.dhs_mem -= dh->dh_memreq;
+	ufsdirhash_release(dh);
+}
+
+/*
+ * A table disagrees with the directory.  Drop it; the next lookup
+ * rebuilds it from the blocks.
+ */
+static void
+ufsdirhash_drop(ip)
+	struct inode *ip;
+{
+	ufs_dirhashstats.dhs_dropped++;
+	ufsdirhash_free(ip);
+}
+
+/*
+ * Find the slot for name at offset.  Returns -1 if it is not there.
+ */
+static int
+ufsdirhash_findslot(dh, name, namelen, offset)
+	struct dirhash *dh;
+	char *name;
+	int namelen;
+	doff_t offset;
+{
+	int slot;
+
+	slot = ufsdirhash_hash(dh, name, namelen);
+	while (DH_ENTRY(dh, slot) != DIRHASH_EMPTY) {
+		if (DH_ENTRY(dh, slot) == offset)
+			return (slot);
+		slot = WRAPINCR(slot, dh->dh_hlen);
+	}
+	return (-1);
+}
+
+/*
+ * Look name up in the table of ip.  Returns 0 with the entry's offset
+ * in *offp and its block in *bpp, ENOENT if the name is not in the
+ * directory, or EJUSTRETURN if the caller should scan the directory.
+ * If prevoffp is not NULL it gets the offset of the entry before the
+ * one found in the same DIRBLKSIZ block, as ufs_dirremove() wants.
+ */
+int
+ufsdirhash_lookup(ip, name, namelen, offp, bpp, prevoffp)
+	struct inode *ip;
+	char *name;
+	int namelen;
+	doff_t *offp;
+	struct buf **bpp;
+	doff_t *prevoffp;
+{
+	struct vnode *vp = ITOV(ip);
+	struct dirhash *dh;
+	struct direct *ep;
+	struct buf *bp;
+	doff_t blkoff, offset, prevoff;
+	u_long bmask;
+	int i, slot;
+
+	if ((dh = ip->i_dirhash) == NULL)
+		return (EJUSTRETURN);
+	ufs_dirhashstats.dhs_lookups++;
+
+	/* Most recently used at the tail. */
+	if (TAILQ_NEXT(dh, dh_list) != NULL) {
+		TAILQ_REMOVE(&ufsdirhash_list, dh, dh_list);
+		TAILQ_INSERT_TAIL(&ufsdirhash_list, dh, dh_list);
+	}
+
+	bmask = VFSTOUFS(vp->v_mount)->um_mountp->mnt_stat.f_iosize - 1;
+	blkoff = -1;
+	bp = NULL;
+restart:
+	slot = ufsdirhash_hash(dh, name, namelen);
+
+	if (dh->dh_seqopt) {
+		/*
+		 * Callers walking the directory in order (ls -l, rm *)
+		 * want the entry after the last one found.  Try that
+		 * offset first if it is on this name's chain.
+		 */
+		for (i = slot; (offset = DH_ENTRY(dh, i)) != DIRHASH_EMPTY;
+		    i = WRAPINCR(i, dh->dh_hlen))
+			if (offset == dh->dh_seqoff)
+				break;
+		if (offset == dh->dh_seqoff)
+			slot = i;
+		else
+			dh->dh_seqopt = 0;
+	}
+
+	for (; (offset = DH_ENTRY(dh, slot)) != DIRHASH_EMPTY;
+	    slot = WRAPINCR(slot, dh->dh_hlen)) {
+		if (offset == DIRHASH_DEL)
+			continue;
+		if (offset < 0 || offset >= ip->i_size)
+			goto drop;
+		if ((offset & ~bmask) != blkoff) {
+			if (bp != NULL)
+				brelse(bp);
+			blkoff = offset & ~bmask;
+			if (VOP_BLKATOFF(vp, (off_t)blkoff, NULL, &bp)) {
+				ufs_dirhashstats.dhs_fallback++;
+				return (EJUSTRETURN);
+			}
+		}
+		ufs_dirhashstats.dhs_probes++;
+		ep = (struct direct *)((char *)bp->b_data + (offset & bmask));
+		if (ep->d_reclen == 0 || ep->d_reclen >
+		    DIRBLKSIZ - (offset & (DIRBLKSIZ - 1)))
+			goto drop;
+		if (ep->d_namlen == namelen &&
+		    bcmp(ep->d_name, name, (unsigned)namelen) == 0) {
+			if (prevoffp != NULL) {
+				prevoff = ufsdirhash_getprev(ep, offset);
+				if (prevoff == -1)
+					goto drop;
+				*prevoffp = prevoff;
+			}
+			if (dh->dh_seqopt)
+				ufs_dirhashstats.dhs_seqhits++;
+			else if (dh->dh_seqoff == offset)
+				dh->dh_seqopt = 1;
+			dh->dh_seqoff = offset + DIRSIZ(0, ep);
+			ufs_dirhashstats.dhs_hits++;
+			*bpp = bp;
+			*offp = offset;
+			return (0);
+		}
+		if (dh->dh_seqopt) {
+			/* Wrong guess; search the chain from the start. */
+			dh->dh_seqopt = 0;
+			goto restart;
+		}
+	}
+	if (bp != NULL)
+		brelse(bp);
+	return (ENOENT);
+
+drop:
+	if (bp != NULL)
+		brelse(bp);
+	ufsdirhash_drop(ip);
+	ufs_dirhashstats.dhs_fallback++;
+	return (EJUSTRETURN);
+}
+
+/*
+ * Find a place for an entry of slotneeded bytes.  Returns the offset
+ * of the first entry of a run that can be compacted to make room and
+ * the length of that run in *slotsize, or -1 if no block has room.
+ */
+doff_t
+ufsdirhash_findfree(ip, slotneeded, slotsize)
+	struct inode *ip;
+	int slotneeded;
+	int *slotsize;
+{
+	struct dirhash *dh;
+	struct direct *ep;
+	struct buf *bp;
+	doff_t pos, slotstart;
+	int dirblock, freebytes, i;
+
+	if ((dh = ip->i_dirhash) == NULL)
+		return (-1);
+
+	dirblock = -1;
+	for (i = howmany(slotneeded, DIRALIGN); i <= DH_NFSTATS; i++)
+		if ((dirblock = dh->dh_firstfree[i]) != -1)
+			break;
+	if (dirblock == -1)
+		return (-1);
+	if (dirblock >= dh->dh_dirblks ||
+	    dh->dh_blkfree[dirblock] < howmany(slotneeded, DIRALIGN)) {
+		ufsdirhash_drop(ip);
+		return (-1);
+	}
+	pos = dirblock * DIRBLKSIZ;
+	if (VOP_BLKATOFF(ITOV(ip), (off_t)pos, (char **)&ep, &bp))
+		return (-1);
+
+	/* Skip the entries with no slack. */
+	for (i = 0; i < DIRBLKSIZ; ) {
+		if (ep->d_reclen == 0)
+			goto bad;
+		if (ep->d_ino == 0 || ep->d_reclen > DIRSIZ(0, ep))
+			break;
+		i += ep->d_reclen;
+		ep = (struct direct *)((char *)ep + ep->d_reclen);
+	}
+	if (i >= DIRBLKSIZ)
+		goto bad;
+	slotstart = pos + i;
+
+	/* Take entries until their combined slack is enough. */
+	freebytes = 0;
+	while (i < DIRBLKSIZ && freebytes < slotneeded) {
+		if (ep->d_reclen == 0)
+			goto bad;
+		freebytes += ep->d_reclen;
+		if (ep->d_ino != 0)
+			freebytes -= DIRSIZ(0, ep);
+		i += ep->d_reclen;
+		ep = (struct direct *)((char *)ep + ep->d_reclen);
+	}
+	if (i > DIRBLKSIZ || freebytes < slotneeded)
+		goto bad;
+	brelse(bp);
+	*slotsize = pos + i - slotstart;
+	ufs_dirhashstats.dhs_findfree++;
+	return (slotstart);
+
+bad:
+	brelse(bp);
+	ufsdirhash_drop(ip);
+	return (-1);
+}
+
+/*
+ * Return the offset just past the last block holding entries, or -1
+ * if the last block is in use, so that ufs_lookup() can have trailing
+ * empty blocks truncated away.
+ */
+doff_t
+ufsdirhash_enddir(ip)
+	struct inode *ip;
+{
+	struct dirhash *dh;
+	int i;
+
+	if ((dh = ip->i_dirhash) == NULL || dh->dh_dirblks == 0)
+		return (-1);
+	if (dh->dh_blkfree[dh->dh_dirblks - 1] != DIRBLKSIZ / DIRALIGN)
+		return (-1);
+	for (i = dh->dh_dirblks - 1; i >= 0; i--)
+		if (dh->dh_blkfree[i] != DIRBLKSIZ / DIRALIGN)
+			break;
+	return ((doff_t)(i + 1) * DIRBLKSIZ);
+}
+
+/*
+ * An entry was written at offset.
+ */
+void
+ufsdirhash_add(ip, dirp, offset)
+	struct inode *ip;
+	struct direct *dirp;
+	doff_t offset;
+{
+	struct dirhash *dh;
+	int slot;
+
+	if ((dh = ip->i_dirhash) == NULL)
+		return;
+	/* Keep a quarter of the slots empty so probes stay short. */
+	if (dh->dh_hused >= (dh->dh_hlen * 3) / 4 ||
+	    offset / DIRBLKSIZ >= dh->dh_dirblks) {
+		ufsdirhash_free(ip);
+		return;
+	}
+	slot = ufsdirhash_hash(dh, dirp->d_name, dirp->d_namlen);
+	while (DH_ENTRY(dh, slot) >= 0)
+		slot = WRAPINCR(slot, dh->dh_hlen);
+	if (DH_ENTRY(dh, slot) == DIRHASH_EMPTY)
+		dh->dh_hused++;
+	DH_ENTRY(dh, slot) = offset;
+	ufsdirhash_adjfree(dh, offset, -DIRSIZ(0, dirp));
+}
+
+/*
+ * The entry at offset was removed.
+ */
+void
+ufsdirhash_remove(ip, dirp, offset)
+	struct inode *ip;
+	struct direct *dirp;
+	doff_t offset;
+{
+	struct dirhash *dh;
+	int slot;
+
+	if ((dh = ip->i_dirhash) == NULL)
+		return;
+	slot = ufsdirhash_findslot(dh, dirp->d_name, dirp->d_namlen, offset);
+	if (slot == -1 || offset / DIRBLKSIZ >= dh->dh_dirblks) {
+		ufsdirhash_drop(ip);
+		return;
+	}
+	ufsdirhash_delslot(dh, slot);
+	ufsdirhash_adjfree(dh, offset, DIRSIZ(0, dirp));
+}
+
+/*
+ * The entry at oldoff was moved to newoff in the same block.
+ */
+void
+ufsdirhash_move(ip, dirp, oldoff, newoff)
+	struct inode *ip;
+	struct direct *dirp;
+	doff_t oldoff, newoff;
+{
+	struct dirhash *dh;
+	int slot;
+
+	if ((dh = ip->i_dirhash) == NULL)
+		return;
+	slot = ufsdirhash_findslot(dh, dirp->d_name, dirp->d_namlen, oldoff);
+	if (slot == -1) {
+		ufsdirhash_drop(ip);
+		return;
+	}
+	DH_ENTRY(dh, slot) = newoff;
+}
+
+/*
+ * A block was added to the directory at offset.
+ */
+void
+ufsdirhash_newblk(ip, offset)
+	struct inode *ip;
+	doff_t offset;
+{
+	struct dirhash *dh;
+	int block;
+
+	if ((dh = ip->i_dirhash) == NULL)
+		return;
+	block = offset / DIRBLKSIZ;
+	if (block != dh->dh_dirblks || block >= dh->dh_nblk) {
+		/* Grown past what the table was sized for. */
+		ufsdirhash_free(ip);
+		return;
+	}
+	dh->dh_dirblks = block + 1;
+	dh->dh_blkfree[block] = DIRBLKSIZ / DIRALIGN;
+	if (dh->dh_firstfree[DH_NFSTATS] == -1)
+		dh->dh_firstfree[DH_NFSTATS] = block;
+}
+
+/*
+ * The directory is being truncated to offset.
+ */
+void
+ufsdirhash_dirtrunc(ip, offset)
+	struct inode *ip;
+	doff_t offset;
+{
+	struct dirhash *dh;
+	int block, i;
+
+	if ((dh = ip->i_dirhash) == NULL)
+		return;
+	block = offset / DIRBLKSIZ;
+	if (block >= dh->dh_dirblks)
+		return;
+
+	/*
+	 * Free a table that is now far larger than the directory, and
+	 * one whose truncated blocks still hold entries.
+	 */
+	if (offset < ufs_dirhashminsize || block < dh->dh_nblk / 8 ||
+	    (offset & (DIRBLKSIZ - 1)) != 0) {
+		ufsdirhash_free(ip);
+		return;
+	}
+	for (i = block; i < dh->dh_dirblks; i++)
+		if (dh->dh_blkfree[i] != DIRBLKSIZ / DIRALIGN) {
+			ufsdirhash_drop(ip);
+			return;
+		}
+	if (dh->dh_firstfree[DH_NFSTATS] >= block)
+		dh->dh_firstfree[DH_NFSTATS] = -1;
+	dh->dh_dirblks = block;
+}
+
+/*
+ * Adjust the free count of the block holding offset by diff bytes
+ * and keep dh_firstfree up to date.
+ */
+static void
+ufsdirhash_adjfree(dh, offset, diff)
+	struct dirhash *dh;
+	doff_t offset;
+	int diff;
+{
+	int block, i, nfidx, ofidx;
+
+	block = offset / DIRBLKSIZ;
+	ofidx = BLKFREE2IDX(dh->dh_blkfree[block]);
+	dh->dh_blkfree[block] = (int)dh->dh_blkfree[block] + diff / DIRALIGN;
+	nfidx = BLKFREE2IDX(dh->dh_blkfree[block]);
+
+	if (ofidx != nfidx) {
+		/* It may have been the first of its old list. */
+		if (dh->dh_firstfree[ofidx] == block) {
+			for (i = block + 1; i < dh->dh_dirblks; i++)
+				if (BLKFREE2IDX(dh->dh_blkfree[i]) == ofidx)
+					break;
+			dh->dh_firstfree[ofidx] =
+			    (i < dh->dh_dirblks) ? i : -1;
+		}
+		if (dh->dh_firstfree[nfidx] > block ||
+		    dh->dh_firstfree[nfidx] == -1)
+			dh->dh_firstfree[nfidx] = block;
+	}
+}
+
+/*
+ * Mark slot deleted.  A run of deleted slots that ends at an empty
+ * one can be emptied, since no chain passes through it any more.
+ */
+static void
+ufsdirhash_delslot(dh, slot)
+	struct dirhash *dh;
+	int slot;
+{
+	int i;
+
+	DH_ENTRY(dh, slot) = DIRHASH_DEL;
+	for (i = slot; DH_ENTRY(dh, i) == DIRHASH_DEL; )
+		i = WRAPINCR(i, dh->dh_hlen);
+	if (DH_ENTRY(dh, i) == DIRHASH_EMPTY) {
+		i = WRAPDECR(i, dh->dh_hlen);
+		while (DH_ENTRY(dh, i) == DIRHASH_DEL) {
+			DH_ENTRY(dh, i) = DIRHASH_EMPTY;
+			dh->dh_hused--;
+			i = WRAPDECR(i, dh->dh_hlen);
+		}
+	}
+}
+
+/*
+ * Offset of the entry before dirp (at offset) in its DIRBLKSIZ block,
+ * or offset itself if dirp is first.  -1 if the block is mangled.
+ */
+static doff_t
+ufsdirhash_getprev(dirp, offset)
+	struct direct *dirp;
+	doff_t offset;
+{
+	struct direct *ep;
+	char *blkbuf;
+	doff_t blkoff, prevoff;
+	int entrypos, i;
+
+	blkoff = offset & ~(DIRBLKSIZ - 1);
+	entrypos = offset & (DIRBLKSIZ - 1);
+	blkbuf = (char *)dirp - entrypos;
+	prevoff = blkoff;
+
+	if (entrypos == 0)
+		return (offset);
+	for (i = 0; i < entrypos; i += ep->d_reclen) {
+		ep = (struct direct *)(blkbuf + i);
+		if (ep->d_reclen == 0 || i + ep->d_reclen > entrypos)
+			return (-1);
+		prevoff = blkoff + i;
+	}
+	return (prevoff);
+}
+
+/*
+ * Free least recently used tables until size more bytes fit in the
+ * budget.  Tables of locked directories may be in use and are
+ * skipped.  Returns -1 if not enough could be freed.
+ */
+static int
+ufsdirhash_recycle(size)
+	int size;
+{
+	struct dirhash *dh, *next;
+
+	for (dh = TAILQ_FIRST(&ufsdirhash_list);
+	    dh != NULL && size + ufs_dirhashstats.dhs_mem > ufs_dirhashmaxmem;
+	    dh = next) {
+		next = TAILQ_NEXT(dh, dh_list);
+		if (VOP_ISLOCKED(ITOV(dh->dh_ip)))
+			continue;
+		ufsdirhash_free(dh->dh_ip);
+		ufs_dirhashstats.dhs_recycled++;
+	}
+	return (size + ufs_dirhashstats.dhs_mem > ufs_dirhashmaxmem ? -1 : 0);
+}
+
+/*
+ * 32 bit FNV-1 hash of the name.
+ */
+static int
+ufsdirhash_hash(dh, name, namelen)
+	struct dirhash *dh;
+	char *name;
+	int namelen;
+{
+	u_int32_t hash = 2166136261U;
+	u_char *cp = (u_char *)name;
+
+	while (namelen-- > 0) {
+		hash *= 16777619;
+		hash ^= *cp++;
+	}
+	return (hash % dh->dh_hlen);
+}
@@ -97,7 +97,8 @@ void	 ufs_dirbad __P((struct inode *, doff_t, char *));
 int	 ufs_dirbadentry __P((struct vnode *, struct direct *, int));
 int	 ufs_dirempty __P((struct inode *, ino_t, struct ucred *));
 int	 ufs_direnter __P((struct inode *, struct vnode *,struct componentname *));
-int	 ufs_dirremove __P((struct vnode *, struct componentname*));
+int	 ufs_dirremove __P((struct vnode *, struct inode *,
+	    struct componentname *, int));
 int	 ufs_dirrewrite
 	    __P((struct inode *, struct inode *, struct componentname *));
 int	 ufs_getattr __P((struct vop_getattr_args *));
@@ -159,4 +160,16 @@ int	ufsfifo_close __P((struct vop_close_args *));
 int	 ufs_pagein __P((struct vop_pagein_args *));
 int	 ufs_pageout __P((struct vop_pageout_args *));
 
+/* Dependency ordering of directory updates, in ffs_softdep.c. */
+void	 softdep_change_linkcnt __P((struct inode *));
+void	 softdep_setup_directory_add
+	    __P((struct buf *, struct inode *, int, ino_t));
+void	 softdep_change_directoryentry_offset
+	    __P((struct buf *, struct inode *, int, int));
+void	 softdep_setup_remove
+	    __P((struct buf *, struct inode *, struct inode *, int, int));
+void	 softdep_cancel_diradd __P((struct buf *, struct inode *, int));
+int	 softdep_unlink_pending __P((struct inode *));
+int	 softdep_slowdown __P((struct vnode *));
+
 __END_DECLS
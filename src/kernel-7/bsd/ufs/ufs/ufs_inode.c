@@ -73,6 +73,8 @@
 
 #include <ufs/ufs/quota.h>
 #include <ufs/ufs/inode.h>
+#include <ufs/ufs/dir.h>
+#include <ufs/ufs/dirhash.h>
 #include <ufs/ufs/ufsmount.h>
 #include <ufs/ufs/ufs_extern.h>
 
@@ -104,7 +106,12 @@ ufs_inactive(ap)
 	 */
 	if (ip->i_mode == 0)
 		goto out;
-	if (ip->i_nlink <= 0 && (vp->v_mount->mnt_flag & MNT_RDONLY) == 0) {
+	/*
+	 * A removal that is not on disk yet keeps the inode; the work
+	 * list finishes it.
+	 */
+	if (ip->i_nlink <= 0 && (vp->v_mount->mnt_flag & MNT_RDONLY) == 0 &&
+	    (!DOINGSOFTDEP(vp) || !softdep_unlink_pending(ip))) {
 #if QUOTA
 		if (!getinoquota(ip))
 			(void)chkiq(ip, -1, NOCRED, 0);
@@ -154,6 +161,7 @@ ufs_reclaim(vp, p)
 	 * Purge old data structures associated with the inode.
 	 */
 	cache_purge(vp);
+	ufsdirhash_free(ip);
 	if (ip->i_devvp) {
 		vrele(ip->i_devvp);
 		ip->i_devvp = 0;
@@ -66,6 +66,7 @@
 #include <sys/param.h>
 #include <sys/namei.h>
 #include <sys/buf.h>
+#include <sys/kernel.h>
 #include <sys/file.h>
 #include <sys/mount.h>
 #include <sys/vnode.h>
@@ -73,6 +74,7 @@
 #include <ufs/ufs/quota.h>
 #include <ufs/ufs/inode.h>
 #include <ufs/ufs/dir.h>
+#include <ufs/ufs/dirhash.h>
 #include <ufs/ufs/ufsmount.h>
 #include <ufs/ufs/ufs_extern.h>
 #if REV_ENDIAN_FS
@@ -156,10 +158,6 @@ ufs_lookup(ap)
 	int flags = cnp->cn_flags;
 	int nameiop = cnp->cn_nameiop;
 	struct proc *p = cnp->cn_proc;
-#if REV_ENDIAN_FS
-	int rev_endian=0;
-#endif /* REV_ENDIAN_FS */
-
 
 	bp = NULL;
 	slotoffset = -1;
@@ -168,15 +166,18 @@ ufs_lookup(ap)
 	dp = VTOI(vdp);
 	lockparent = flags & LOCKPARENT;
 	wantparent = flags & (LOCKPARENT|WANTPARENT);
-#if REV_ENDIAN_FS
-	rev_endian=(vdp->v_mount->mnt_flag & MNT_REVEND);
-#endif /* REV_ENDIAN_FS */
 
 	/*
 	 * Check accessiblity of directory.
 	 */
 	if ((dp->i_mode & IFMT) != IFDIR)
 		return (ENOTDIR);
+	/*
+	 * A removed directory is not truncated until its removal is
+	 * on disk; until then it must look empty.
+	 */
+	if (dp->i_nlink == 0 && DOINGSOFTDEP(vdp))
+		return (ENOENT);
 	if (error = VOP_ACCESS(vdp, VEXEC, cred, cnp->cn_proc))
 		return (error);
 	if ((flags & ISLASTCN) && (vdp->v_mount->mnt_flag & MNT_RDONLY) &&
@@ -250,6 +251,41 @@ ufs_lookup(ap)
 			cnp->cn_namelen + 3) &~ 3;
 	}
 
+	bmask = VFSTOUFS(vdp->v_mount)->um_mountp->mnt_stat.f_iosize - 1;
+
+	/*
+	 * A large directory is searched through its hash table, which
+	 * also knows which block has room for a new entry.  If the
+	 * table can't answer, fall back to the scan below.
+	 */
+	if (ufsdirhash_build(dp) == 0) {
+		enduseful = dp->i_size;
+		if (slotstatus != FOUND) {
+			slotoffset = ufsdirhash_findfree(dp, slotneeded,
+			    &slotsize);
+			if (slotoffset >= 0) {
+				slotstatus = COMPACT;
+				enduseful = ufsdirhash_enddir(dp);
+				if (enduseful < 0)
+					enduseful = dp->i_size;
+			}
+		}
+		numdirpasses = 1;
+		entryoffsetinblock = 0;
+		switch (ufsdirhash_lookup(dp, cnp->cn_nameptr, cnp->cn_namelen,
+		    &dp->i_offset, &bp, nameiop == DELETE ? &prevoff : NULL)) {
+		case 0:
+			ep = (struct direct *)((char *)bp->b_data +
+			    (dp->i_offset & bmask));
+			goto foundentry;
+		case ENOENT:
+			dp->i_offset = roundup(dp->i_size, DIRBLKSIZ);
+			goto notfound;
+		default:
+			break;
+		}
+	}
+
 	/*
 	 * If there is cached information on a previous search of
 	 * this directory, pick up where we last left off.
@@ -261,7 +297,6 @@ ufs_lookup(ap)
 	 * profiling time and hence has been removed in the interest
 	 * of simplicity.
 	 */
-	bmask = VFSTOUFS(vdp->v_mount)->um_mountp->mnt_stat.f_iosize - 1;
 	if (nameiop != LOOKUP || dp->i_diroff == 0 ||
 	    dp->i_diroff > dp->i_size) {
 		entryoffsetinblock = 0;
@@ -286,10 +321,6 @@ searchloop:
 		 */
 		if ((dp->i_offset & bmask) == 0) {
 			if (bp != NULL)  {
-#if REV_ENDIAN_FS
-				if (rev_endian)
-					byte_swap_dir_block_out(bp);
-#endif /* REV_ENDIAN_FS */
 				brelse(bp);
 			}
 			if (error =
@@ -369,10 +400,10 @@ searchloop:
 			if (namlen == cnp->cn_namelen &&
 			    !bcmp(cnp->cn_nameptr, ep->d_name,
 				(unsigned)namlen)) {
+foundentry:
 				/*
 				 * Save directory entry's inode number and
-				 * reclen in ndp->ni_ufs area, and release
-				 * directory buffer.
+				 * reclen in ndp->ni_ufs area.
 				 */
 				if (vdp->v_mount->mnt_maxsymlinklen > 0 &&
 				    ep->d_type == DT_WHT) {
@@ -387,11 +418,6 @@ searchloop:
 				}
 				dp->i_ino = ep->d_ino;
 				dp->i_reclen = ep->d_reclen;
-#if REV_ENDIAN_FS
-				if (rev_endian)
-					byte_swap_dir_block_out(bp);
-#endif /* REV_ENDIAN_FS */
-				brelse(bp);
 				goto found;
 			}
 		}
@@ -413,10 +439,6 @@ notfound:
 		goto searchloop;
 	}
 	if (bp != NULL) {
-#if REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_dir_block_out(bp);
-#endif /* REV_ENDIAN_FS */
 		brelse(bp);
 	}
 	/*
@@ -494,11 +516,12 @@ found:
 	 * Check that directory length properly reflects presence
 	 * of this entry.
 	 */
-	if (entryoffsetinblock + DIRSIZ(FSFMT(vdp), ep) > dp->i_size) {
+	if (dp->i_offset + DIRSIZ(FSFMT(vdp), ep) > dp->i_size) {
 		ufs_dirbad(dp, dp->i_offset, "i_size too small");
-		dp->i_size = entryoffsetinblock + DIRSIZ(FSFMT(vdp), ep);
+		dp->i_size = dp->i_offset + DIRSIZ(FSFMT(vdp), ep);
 		dp->i_flag |= IN_CHANGE | IN_UPDATE;
 	}
+	brelse(bp);
 
 	/*
 	 * Found component in pathname.
@@ -711,6 +734,8 @@ ufs_direnter(ip, dvp, cnp)
 {
 	register struct inode *dp;
 	struct direct newdir;
+	struct timeval tv;
+	int delayed = 0, error;
 
 #if DIAGNOSTIC
 	if ((cnp->cn_flags & SAVENAME) == 0)
@@ -730,18 +755,39 @@ ufs_direnter(ip, dvp, cnp)
 			newdir.d_type = tmp; }
 #		endif
 	}
-	return (ufs_direnter2(dvp, &newdir, cnp->cn_cred, cnp->cn_proc));
+	/*
+	 * With dependencies an entry going into an existing block is
+	 * written later and held back until its inode is on disk.  A
+	 * new block, a rename (whose old name goes synchronously) or
+	 * too many outstanding records get the old order instead: the
+	 * inode first, then the entry, both synchronously.
+	 */
+	if (DOINGSOFTDEP(dvp)) {
+		if (dp->i_count != 0 && cnp->cn_nameiop != RENAME &&
+		    !softdep_slowdown(dvp))
+			delayed = 1;
+		else {
+			tv = time;
+			ip->i_flag |= IN_MODIFIED;
+			if (error = VOP_UPDATE(ITOV(ip), &tv, &tv, 1))
+				return (error);
+		}
+	}
+	return (ufs_direnter2(dvp, &newdir, cnp->cn_cred, cnp->cn_proc,
+	    delayed));
 }
 
 /*
  * Common entry point for directory entry removal used by ufs_direnter
- * and ufs_whiteout
+ * and ufs_whiteout.  If delayed, the block is written with bdwrite()
+ * and the entry ordered behind its inode.
  */
-ufs_direnter2(dvp, dirp, cr, p)
+ufs_direnter2(dvp, dirp, cr, p, delayed)
 	struct vnode *dvp;
 	struct direct *dirp;
 	struct ucred *cr;
 	struct proc *p;
+	int delayed;
 {
 	int newentrysize;
 	struct inode *dp;
@@ -752,10 +798,6 @@ ufs_direnter2(dvp, dirp, cr, p)
 	struct direct *ep, *nep;
 	int error, loc, spacefree;
 	char *dirbuf;
-#if REV_ENDIAN_FS
-	struct mount *mp=dvp->v_mount;
-	int rev_endian=(mp->mnt_flag & MNT_REVEND);
-#endif /* REV_ENDIAN_FS */
 
 	dp = VTOI(dvp);
 	newentrysize = DIRSIZ(FSFMT(dvp), dirp);
@@ -788,6 +830,14 @@ ufs_direnter2(dvp, dirp, cr, p)
 			dp->i_size = roundup(dp->i_size, DIRBLKSIZ);
 			dp->i_flag |= IN_CHANGE;
 		}
+		if (dp->i_dirhash != NULL) {
+			if (error)
+				ufsdirhash_free(dp);
+			else {
+				ufsdirhash_newblk(dp, dp->i_offset);
+				ufsdirhash_add(dp, dirp, dp->i_offset);
+			}
+		}
 		return (error);
 	}
 
@@ -834,6 +884,13 @@ ufs_direnter2(dvp, dirp, cr, p)
 			/* overwrite; nothing there; header is ours */
 			spacefree += dsize;
 		}
+		if (nep->d_ino)
+			ufsdirhash_move(dp, nep, dp->i_offset + loc,
+			    dp->i_offset + ((char *)ep - dirbuf));
+		if (nep->d_ino && DOINGSOFTDEP(dvp))
+			softdep_change_directoryentry_offset(bp, dp,
+			    (dirbuf - (char *)bp->b_data) + loc,
+			    (char *)ep - (char *)bp->b_data);
 		dsize = DIRSIZ(FSFMT(dvp), nep);
 		spacefree += nep->d_reclen - dsize;
 		loc += nep->d_reclen;
@@ -856,12 +913,20 @@ ufs_direnter2(dvp, dirp, cr, p)
 		ep->d_reclen = dsize;
 		ep = (struct direct *)((char *)ep + dsize);
 	}
+	/*
+	 * Enter the name in the hash table, unless it replaces a
+	 * whiteout of the same name that is already there.
+	 */
+	if (ep->d_ino == 0 || dirp->d_reclen == spacefree)
+		ufsdirhash_add(dp, dirp, dp->i_offset + ((char *)ep - dirbuf));
 	bcopy((caddr_t)dirp, (caddr_t)ep, (u_int)newentrysize);
-#if REV_ENDIAN_FS
-	if (rev_endian)
-		byte_swap_dir_block_out(bp);
-#endif /* REV_ENDIAN_FS */
-	error = VOP_BWRITE(bp);
+	if (delayed) {
+		softdep_setup_directory_add(bp, dp,
+		    (char *)ep - (char *)bp->b_data, dirp->d_ino);
+		bdwrite(bp);
+		error = 0;
+	} else
+		error = VOP_BWRITE(bp);
 	dp->i_flag |= IN_CHANGE | IN_UPDATE;
 	if (!error && dp->i_endoff && dp->i_endoff < dp->i_size)
 		error = VOP_TRUNCATE(dvp, (off_t)dp->i_endoff, IO_SYNC, cr, p);
@@ -879,20 +944,23 @@ ufs_direnter2(dvp, dirp, cr, p)
  * entry is not the first in the directory, we must reclaim
  * the space of the now empty record by adding the record size
  * to the size of the previous entry.
+ *
+ * Ip is the inode the entry names, isrmdir set if it is a
+ * directory.  With dependencies the block is written later
+ * and the link count drops on disk only once it has been;
+ * an ip of NULL asks for the synchronous write.
  */
 int
-ufs_dirremove(dvp, cnp)
+ufs_dirremove(dvp, ip, cnp, isrmdir)
 	struct vnode *dvp;
+	struct inode *ip;
 	struct componentname *cnp;
+	int isrmdir;
 {
 	register struct inode *dp;
-	struct direct *ep;
+	struct direct *ep, *rep;
 	struct buf *bp;
 	int error;
-#if REV_ENDIAN_FS
-	struct mount *mp=dvp->v_mount;
-	int rev_endian=(mp->mnt_flag & MNT_REVEND);
-#endif /* REV_ENDIAN_FS */
 
 	dp = VTOI(dvp);
 
@@ -905,43 +973,40 @@ ufs_dirremove(dvp, cnp)
 			return (error);
 		ep->d_ino = WINO;
 		ep->d_type = DT_WHT;
-#if REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_dir_block_out(bp);
-#endif /* REV_ENDIAN_FS */
-		error = VOP_BWRITE(bp);
-		dp->i_flag |= IN_CHANGE | IN_UPDATE;
-		return (error);
-	}
-
-	if (dp->i_count == 0) {
+		rep = ep;
+		ip = NULL;
+	} else if (dp->i_count == 0) {
 		/*
 		 * First entry in block: set d_ino to zero.
 		 */
 		if (error =
 		    VOP_BLKATOFF(dvp, (off_t)dp->i_offset, (char **)&ep, &bp))
 			return (error);
+		ufsdirhash_remove(dp, ep, dp->i_offset);
 		ep->d_ino = 0;
-#if REV_ENDIAN_FS
-		if (rev_endian)
-			byte_swap_dir_block_out(bp);
-#endif /* REV_ENDIAN_FS */
+		rep = ep;
+	} else {
+		/*
+		 * Collapse new free space into previous entry.
+		 */
+		if (error = VOP_BLKATOFF(dvp,
+		    (off_t)(dp->i_offset - dp->i_count), (char **)&ep, &bp))
+			return (error);
+		rep = (struct direct *)((char *)ep + ep->d_reclen);
+		ufsdirhash_remove(dp, rep, dp->i_offset);
+		ep->d_reclen += dp->i_reclen;
+	}
+	if (ip != NULL && DOINGSOFTDEP(dvp) && !softdep_slowdown(dvp)) {
+		softdep_setup_remove(bp, dp, ip,
+		    (char *)rep - (char *)bp->b_data, isrmdir);
+		bdwrite(bp);
+		error = 0;
+	} else {
+		if (DOINGSOFTDEP(dvp))
+			softdep_cancel_diradd(bp, dp,
+			    (char *)rep - (char *)bp->b_data);
 		error = VOP_BWRITE(bp);
-		dp->i_flag |= IN_CHANGE | IN_UPDATE;
-		return (error);
 	}
-	/*
-	 * Collapse new free space into previous entry.
-	 */
-	if (error = VOP_BLKATOFF(dvp, (off_t)(dp->i_offset - dp->i_count),
-	    (char **)&ep, &bp))
-		return (error);
-	ep->d_reclen += dp->i_reclen;
-#if REV_ENDIAN_FS
-	if (rev_endian)
-		byte_swap_dir_block_out(bp);
-#endif /* REV_ENDIAN_FS */
-	error = VOP_BWRITE(bp);
 	dp->i_flag |= IN_CHANGE | IN_UPDATE;
 	return (error);
 }
@@ -963,13 +1028,11 @@ ufs_dirrewrite(dp, ip, cnp)
 
 	if (error = VOP_BLKATOFF(vdp, (off_t)dp->i_offset, (char **)&ep, &bp))
 		return (error);
+	if (DOINGSOFTDEP(vdp))
+		softdep_cancel_diradd(bp, dp, (char *)ep - (char *)bp->b_data);
 	ep->d_ino = ip->i_number;
 	if (vdp->v_mount->mnt_maxsymlinklen > 0)
 		ep->d_type = IFTODT(ip->i_mode);
-#if REV_ENDIAN_FS
-	if (vdp->v_mount->mnt_flag & MNT_REVEND)
-		byte_swap_dir_block_out(bp);
-#endif /* REV_ENDIAN_FS */
 	error = VOP_BWRITE(bp);
 	dp->i_flag |= IN_CHANGE | IN_UPDATE;
 	return (error);
@@ -118,6 +118,7 @@ READ(ap)
 	int error;
 	u_short mode;
 	int seq;	/* used only by the cluster read code */
+	int rastride;	/* scan stride seen by the read-ahead code */
 #if REV_ENDIAN_FS
 	int rev_endian=0;
 #endif /* REV_ENDIAN_FS */
@@ -173,9 +174,16 @@ READ(ap)
 		error = cluster_read(vp, ip->i_size, lbn, size, NOCRED, &bp);
 #endif /* NeXT */
 #else
+		/*
+		 * Forward sequential reads are left to the clustering
+		 * code; strided and reverse scans (and sequential ones
+		 * when clustering is off) get adaptive read-ahead.
+		 */
+		rastride = bio_ratrack(vp, lbn);
 		if (lblktosize(fs, nextlbn) >= ip->i_size)
 			error = bread(vp, lbn, size, NOCRED, &bp);
-		else if (doclusterread && !(vp->v_flag & VRAOFF))
+		else if (doclusterread && !(vp->v_flag & VRAOFF) &&
+		    (rastride == 0 || rastride == 1))
 #ifdef NeXT
 			error = cluster_read(vp,
 			    ip->i_size, lbn, size, NOCRED, &bp, devBlockSize,
@@ -184,12 +192,9 @@ READ(ap)
 			error = cluster_read(vp,
 			     ip->i_size, lbn, size, NOCRED, &bp);
 #endif /* NeXT */
-		else if (lbn - 1 == vp->v_lastr && !(vp->v_flag & VRAOFF)) {
-			int nextsize = BLKSIZE(fs, ip, nextlbn);
-			error = breadn(vp, lbn,
-			    size, &nextlbn, &nextsize, 1, NOCRED, &bp);
-		} else
-			error = bread(vp, lbn, size, NOCRED, &bp);
+		else
+			error = breadra(vp, lbn, size,
+			    lblkno(fs, ip->i_size) - 1, NOCRED, &bp);
 #endif
 		firstpass = FALSE;
 		if (error)
@@ -210,25 +215,13 @@ READ(ap)
 			xfersize = size;
 		}
 #if REV_ENDIAN_FS
-		if (rev_endian && S_ISDIR(mode)) {
-			byte_swap_dir_block_in((char *)bp->b_data + blkoffset, xfersize);
-		}
+		if (rev_endian && S_ISDIR(mode))
+			byte_swap_dir_buf_in(bp);
 #endif /* REV_ENDIAN_FS */
 		if (error =
-		    uiomove((char *)bp->b_data + blkoffset, (int)xfersize, uio)) {
-#if REV_ENDIAN_FS
-			if (rev_endian && S_ISDIR(mode)) {
-			byte_swap_dir_block_in((char *)bp->b_data + blkoffset, xfersize);
-			}
-#endif /* REV_ENDIAN_FS */
+		    uiomove((char *)bp->b_data + blkoffset, (int)xfersize, uio))
 			break;
-	}
 
-#if REV_ENDIAN_FS
-		if (rev_endian && S_ISDIR(mode)) {
-			byte_swap_dir_out((char *)bp->b_data + blkoffset, xfersize);
-		}
-#endif /* REV_ENDIAN_FS */
 		if (S_ISREG(mode) && (xfersize + blkoffset == fs->fs_bsize ||
 		    uio->uio_offset == ip->i_size))
 			bp->b_flags |= B_AGE;
@@ -361,6 +354,15 @@ WRITE(ap)
 		if (size < xfersize)
 			xfersize = size;
 
+#if REV_ENDIAN_FS
+		/*
+		 * The caller's entries are in host order and get swapped
+		 * below; put the rest of a cached block back in disk order
+		 * first.
+		 */
+		if (rev_endian && S_ISDIR(ip->i_mode))
+			byte_swap_buf_out(bp);
+#endif /* REV_ENDIAN_FS */
 		error =
 		    uiomove((char *)bp->b_data + blkoffset, (int)xfersize, uio);
 #if REV_ENDIAN_FS
@@ -393,6 +395,8 @@ WRITE(ap)
 			break;
 		ip->i_flag |= IN_CHANGE | IN_UPDATE;
 	}
+	if (resid > uio->uio_resid)
+		VN_KNOTE(vp, NOTE_WRITE | (ip->i_size > osize ? NOTE_EXTEND : 0));
 	/*
 	 * If we successfully wrote any data, and we are not the superuser
 	 * we clear the setuid and setgid bits as a precaution against
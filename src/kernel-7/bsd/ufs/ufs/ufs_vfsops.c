@@ -75,6 +75,8 @@
 
 #include <ufs/ufs/quota.h>
 #include <ufs/ufs/inode.h>
+#include <ufs/ufs/dir.h>
+#include <ufs/ufs/dirhash.h>
 #include <ufs/ufs/ufsmount.h>
 #include <ufs/ufs/ufs_extern.h>
 
@@ -196,6 +198,7 @@ ufs_init(vfsp)
 		return (0);
 	done = 1;
 	ufs_ihashinit();
+	ufsdirhash_init();
 #if QUOTA
 	dqinit();
 #endif
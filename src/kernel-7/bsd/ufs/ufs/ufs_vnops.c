@@ -771,9 +771,10 @@ ufs_remove(ap)
 		error = EPERM;
 		goto out;
 	}
-	if ((error = ufs_dirremove(dvp, ap->a_cnp)) == 0) {
+	if ((error = ufs_dirremove(dvp, ip, ap->a_cnp, 0)) == 0) {
 		ip->i_nlink--;
 		ip->i_flag |= IN_CHANGE;
+		VN_KNOTE(vp, NOTE_DELETE);
 	}
 out:
 	if (dvp == vp)
@@ -829,8 +830,10 @@ ufs_link(ap)
 	}
 	ip->i_nlink++;
 	ip->i_flag |= IN_CHANGE;
+	if (DOINGSOFTDEP(vp))
+		softdep_change_linkcnt(ip);
 	tv = time;
-	error = VOP_UPDATE(vp, &tv, &tv, 1);
+	error = VOP_UPDATE(vp, &tv, &tv, !DOINGSOFTDEP(vp));
 	if (!error)
 		error = ufs_direnter(ip, tdvp, cnp);
 	if (error) {
@@ -882,7 +885,8 @@ ufs_whiteout(ap)
 		newdir.d_namlen = cnp->cn_namelen;
 		bcopy(cnp->cn_nameptr, newdir.d_name, (unsigned)cnp->cn_namelen + 1);
 		newdir.d_type = DT_WHT;
-		error = ufs_direnter2(dvp, &newdir, cnp->cn_cred, cnp->cn_proc);
+		error = ufs_direnter2(dvp, &newdir, cnp->cn_cred, cnp->cn_proc,
+		    0);
 		break;
 
 	case DELETE:
@@ -893,7 +897,7 @@ ufs_whiteout(ap)
 #endif
 
 		cnp->cn_flags &= ~DOWHITEOUT;
-		error = ufs_dirremove(dvp, cnp);
+		error = ufs_dirremove(dvp, NULL, cnp, 0);
 		break;
 	}
 	if (cnp->cn_flags & HASBUF) {
@@ -1192,6 +1196,7 @@ abortit:
 			    tcnp->cn_cred, tcnp->cn_proc);
 		}
 		xp->i_flag |= IN_CHANGE;
+		VN_KNOTE(tvp, NOTE_DELETE);
 		vput(tvp);
 		xp = NULL;
 	}
@@ -1270,7 +1275,7 @@ abortit:
 				}
 			}
 		}
-		error = ufs_dirremove(fdvp, fcnp);
+		error = ufs_dirremove(fdvp, NULL, fcnp, 0);
 		if (!error) {
 			xp->i_nlink--;
 			xp->i_flag |= IN_CHANGE;
@@ -1370,8 +1375,10 @@ ufs_mkdir(ap)
 	ip->i_nlink = 2;
 	if (cnp->cn_flags & ISWHITEOUT)
 		ip->i_flags |= UF_OPAQUE;
+	if (DOINGSOFTDEP(tvp))
+		softdep_change_linkcnt(ip);
 	tv = time;
-	error = VOP_UPDATE(tvp, &tv, &tv, 1);
+	error = VOP_UPDATE(tvp, &tv, &tv, !DOINGSOFTDEP(tvp));
 
 	/*
 	 * Bump link count in parent directory
@@ -1478,7 +1485,7 @@ ufs_rmdir(ap)
 	 * inode.  If we crash in between, the directory
 	 * will be reattached to lost+found,
 	 */
-	if (error = ufs_dirremove(dvp, cnp))
+	if (error = ufs_dirremove(dvp, ip, cnp, 1))
 		goto out;
 	dp->i_nlink--;
 	dp->i_flag |= IN_CHANGE;
@@ -1494,12 +1501,16 @@ ufs_rmdir(ap)
 	 * removed the "." reference and the reference
 	 * in the parent directory, but there may be
 	 * other hard links so decrement by 2 and
-	 * worry about them later.
+	 * worry about them later.  If the removal
+	 * is not on disk yet, ufs_inactive truncates
+	 * once it is.
 	 */
 	ip->i_nlink -= 2;
-	error = VOP_TRUNCATE(vp, (off_t)0, IO_SYNC, cnp->cn_cred,
-	    cnp->cn_proc);
+	if (!DOINGSOFTDEP(vp) || !softdep_unlink_pending(ip))
+		error = VOP_TRUNCATE(vp, (off_t)0, IO_SYNC, cnp->cn_cred,
+		    cnp->cn_proc);
 	cache_purge(ITOV(ip));
+	VN_KNOTE(vp, NOTE_DELETE);
 out:
 	if (dvp)
 		vput(dvp);
@@ -2181,10 +2192,13 @@ ufs_makeinode(mode, dvp, vpp, cnp)
 		ip->i_flags |= UF_OPAQUE;
 
 	/*
-	 * Make sure inode goes to disk before directory entry.
+	 * Make sure inode goes to disk before directory entry.  With
+	 * dependencies the entry is held back until it has instead.
 	 */
+	if (DOINGSOFTDEP(tvp))
+		softdep_change_linkcnt(ip);
 	tv = time;
-	if (error = VOP_UPDATE(tvp, &tv, &tv, 1))
+	if (error = VOP_UPDATE(tvp, &tv, &tv, !DOINGSOFTDEP(tvp)))
 		goto bad;
 	if (error = ufs_direnter(ip, dvp, cnp))
 		goto bad;
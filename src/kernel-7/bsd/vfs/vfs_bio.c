@@ -107,6 +107,7 @@ struct buf *swbuf;	/* Swap I/O buffer headers. */
 int nswbuf;			/* Number of swap I/O buffer headers. */
 struct buf bswlist;	/* Head of swap I/O buffer headers free list. */
 struct buf *bclnlist;/* Head of cleaned page list. */
+struct bio_ops bioops;	/* Hooks for buffers with write dependencies. */
 
 #if TRACE
 struct	proc *traceproc;
@@ -136,38 +137,103 @@ u_long	bufhash;
 
 /*
  * Definitions for the buffer free lists.
+ *
+ * Buffers are replaced 2Q style.  A buffer whose block has been read in
+ * (or written) once sits on the AGE queue; if it is asked for again
+ * while there, it is released to one of the hot queues, LRU for file
+ * data and META for metadata.  getnewbuf() recycles from the AGE queue
+ * whenever it holds more than bufagetarget buffers, so a long scan
+ * that touches each block once only ever churns the AGE queue and
+ * cannot push out the hot working set.  Metadata is further protected
+ * by being taken only when there is no hot data left, or when it
+ * holds more than bufmetamax buffers.
+ *
+ * Blocks recycled off the AGE queue are remembered in a ghost list.
+ * A miss on a remembered block means the AGE queue was too short to
+ * catch its reuse, so the new buffer goes straight to a hot queue on
+ * release.
+ *
+ * A buffer whose memory has been lent to mbufs by sendfile() is kept
+ * on the LOCKED queue until the last mbuf is freed, so that it is not
+ * recycled or has its pages stolen while the network still reads it.
+ * It can be looked up and used normally in the meantime.
  */
-#define	BQUEUES		4		/* number of free buffer queues */
-
 #define	BQ_LOCKED	0		/* super-blocks &c */
-#define	BQ_LRU		1		/* lru, useful buffers */
-#define	BQ_AGE		2		/* rubbish */
+#define	BQ_LRU		1		/* data, referenced more than once */
+#define	BQ_AGE		2		/* referenced once, and rubbish */
 #define	BQ_EMPTY	3		/* buffer headers with no memory */
+#define	BQ_META		4		/* metadata, referenced more than once */
 
 TAILQ_HEAD(ioqueue, buf) iobufqueue;
 TAILQ_HEAD(bqueues, buf) bufqueues[BQUEUES];
+int bufqlen[BQUEUES];			/* buffers on each queue */
 int needbuffer;
 
+int bufagetarget;			/* AGE queue length to keep */
+int bufmetamax;				/* META queue length before it competes */
+int bufloanmax;				/* most buffers lent at once */
+int nbufloaned;				/* buffers lent now */
+struct bufqstats bufqstats;
+
+/*
+ * Is this buffer file system metadata?  Anything cached through a
+ * device vnode (superblocks, cylinder groups, inodes), directories,
+ * indirect blocks (negative logical block numbers) and system files
+ * (HFS B-trees).
+ */
+#define	BUF_ISMETA(bp)							\
+	((bp)->b_vp != NULL &&						\
+	 ((bp)->b_vp->v_type == VBLK || (bp)->b_vp->v_type == VCHR ||	\
+	  (bp)->b_vp->v_type == VDIR || (bp)->b_lblkno < 0 ||		\
+	  ISSET((bp)->b_vp->v_flag, VSYSTEM)))
+
 /*
  * Insq/Remq for the buffer free lists.
  */
-#define	binsheadfree(bp, dp)	do { \
+#define	binsheadfree(bp, dp, whichq)	do { \
 				    TAILQ_INSERT_HEAD(dp, bp, b_freelist); \
+				    (bp)->b_whichq = whichq; \
+				    bufqlen[whichq]++; \
 				    (bp)->b_timestamp = time.tv_sec; \
 				} while (0)
 
-#define	binstailfree(bp, dp)	do { \
+#define	binstailfree(bp, dp, whichq)	do { \
 				    TAILQ_INSERT_TAIL(dp, bp, b_freelist); \
+				    (bp)->b_whichq = whichq; \
+				    bufqlen[whichq]++; \
 				    (bp)->b_timestamp = time.tv_sec; \
 				} while (0)
 
+/*
+ * Ghost list: identities of blocks recently recycled off the AGE
+ * queue.  The entries form a ring, oldest overwritten first, and are
+ * hashed on (vnode, block) for lookup.
+ */
+struct bufghost {
+	LIST_ENTRY(bufghost) bg_hash;	/* hash chain */
+	struct vnode	*bg_vp;		/* vnode; NULL if slot is unused */
+	u_long		bg_vpid;	/* capability number of bg_vp */
+	daddr_t		bg_lblkno;	/* logical block number */
+};
+
+#define	GHOSTHASH(vp, lbn)	\
+	(&bufghosthash[((long)(vp) / sizeof(*(vp)) + (int)(lbn)) & bufghostmask])
+LIST_HEAD(bufghosthdr, bufghost) *bufghosthash;
+u_long	bufghostmask;
+struct bufghost *bufghosts;		/* the ring */
+int	nbufghost;			/* entries in the ring */
+int	bufghosthand;			/* next entry to overwrite */
 
-/* Time in seconds before a buf on a list is considered as a stale buf */
-#define LRU_IS_STALE 120 /* default value for the LRU */
-#define AGE_IS_STALE 60  /* default value for the AGE */
+/*
+ * Adaptive read-ahead tunables and statistics.
+ */
+#define BIO_RAMIN	2	/* window when a pattern is first seen */
+#define BIO_RASTRIDE	64	/* largest stride treated as a pattern */
 
-int lru_is_stale = LRU_IS_STALE;
-int age_is_stale = AGE_IS_STALE;
+int bio_ramin = BIO_RAMIN;
+int bio_ramax = BIO_RAMAX;
+int bio_rastridemax = BIO_RASTRIDE;
+struct bio_rastats bio_rastats;
 
 
 
@@ -175,26 +241,66 @@ void
 bremfree(bp)
 	struct buf *bp;
 {
-	struct bqueues *dp = NULL;
+	struct bqueues *dp;
 
-	/*
-	 * We only calculate the head of the freelist when removing
-	 * the last element of the list as that is the only time that
-	 * it is needed (e.g. to reset the tail pointer).
-	 *
-	 * NB: This makes an assumption about how tailq's are implemented.
-	 */
-	if (bp->b_freelist.tqe_next == NULL) {
-		for (dp = bufqueues; dp < &bufqueues[BQUEUES]; dp++)
-			if (dp->tqh_last == &bp->b_freelist.tqe_next)
-				break;
-		if (dp == &bufqueues[BQUEUES])
-			panic("bremfree: lost tail");
-	}
+	if (bp->b_whichq < 0 || bp->b_whichq >= BQUEUES)
+		panic("bremfree: not on a queue");
+	dp = &bufqueues[bp->b_whichq];
+#if DIAGNOSTIC
+	if (bp->b_freelist.tqe_next == NULL &&
+	    dp->tqh_last != &bp->b_freelist.tqe_next)
+		panic("bremfree: lost tail");
+#endif
 	TAILQ_REMOVE(dp, bp, b_freelist);
+	bufqlen[bp->b_whichq]--;
+	bp->b_whichq = -1;
 	bp->b_timestamp = 0; 
 }
 
+/*
+ * Remember the identity of a block being recycled off the AGE queue.
+ */
+static void
+bufghost_enter(bp)
+	struct buf *bp;
+{
+	struct bufghost *bg;
+
+	if (nbufghost == 0)
+		return;
+	bg = &bufghosts[bufghosthand];
+	if (++bufghosthand == nbufghost)
+		bufghosthand = 0;
+	if (bg->bg_vp != NULL)
+		LIST_REMOVE(bg, bg_hash);
+	bg->bg_vp = bp->b_vp;
+	bg->bg_vpid = bp->b_vp->v_id;
+	bg->bg_lblkno = bp->b_lblkno;
+	LIST_INSERT_HEAD(GHOSTHASH(bg->bg_vp, bg->bg_lblkno), bg, bg_hash);
+}
+
+/*
+ * Was this block recently recycled off the AGE queue?  A block is
+ * only reported once.
+ */
+static int
+bufghost_lookup(vp, blkno)
+	struct vnode *vp;
+	daddr_t blkno;
+{
+	struct bufghost *bg;
+
+	for (bg = GHOSTHASH(vp, blkno)->lh_first; bg != NULL;
+	    bg = bg->bg_hash.le_next) {
+		if (bg->bg_vp == vp && bg->bg_lblkno == blkno) {
+			LIST_REMOVE(bg, bg_hash);
+			bg->bg_vp = NULL;
+			return (bg->bg_vpid == vp->v_id);
+		}
+	}
+	return (0);
+}
+
 /*
  * Initialize buffers and hash links for buffers.
  */
@@ -209,6 +315,17 @@ bufinit()
 	for (dp = bufqueues; dp < &bufqueues[BQUEUES]; dp++)
 		TAILQ_INIT(dp);
 	bufhashtbl = hashinit(nbuf, M_CACHE, &bufhash);
+
+	bufagetarget = nbuf / 4;
+	bufmetamax = nbuf / 2;
+	bufloanmax = nbuf / 4;
+	nbufghost = nbuf / 2;
+	if (nbufghost > 0) {
+		bufghosthash = hashinit(nbufghost, M_CACHE, &bufghostmask);
+		MALLOC(bufghosts, struct bufghost *,
+		    nbufghost * sizeof(struct bufghost), M_CACHE, M_WAITOK);
+		bzero(bufghosts, nbufghost * sizeof(struct bufghost));
+	}
 	base = bufpages / nbuf;
 	residual = bufpages % nbuf;
 	for (i = 0; i < nbuf; i++) {
@@ -224,8 +341,10 @@ bufinit()
 		else
 			bp->b_bufsize = base * CLBYTES;
 		bp->b_flags = B_INVAL;
-		dp = bp->b_bufsize ? &bufqueues[BQ_AGE] : &bufqueues[BQ_EMPTY];
-		binsheadfree(bp, dp);
+		if (bp->b_bufsize)
+			binsheadfree(bp, &bufqueues[BQ_AGE], BQ_AGE);
+		else
+			binsheadfree(bp, &bufqueues[BQ_EMPTY], BQ_EMPTY);
 		binshash(bp, &invalhash);
 	}
 	base = (int )(buffers + (i * MAXBSIZE));
@@ -240,7 +359,8 @@ bufinit()
 		bp->b_data = (char *)base;
 		bp->b_bufsize = 0;
 		bp->b_flags = B_INVAL;
-		binsheadfree(bp, &iobufqueue);
+		bp->b_whichq = -1;
+		TAILQ_INSERT_HEAD(&iobufqueue, bp, b_freelist);
 
 		base += MAXPHYSIO;
 	}
@@ -267,6 +387,10 @@ bio_doread(vp, blkno, size, cred, async)
 	if (!ISSET(bp->b_flags, (B_DONE | B_DELWRI))) {
 		/* Start I/O for the buffer (keeping credentials). */
 		SET(bp->b_flags, B_READ | async);
+		if (async) {
+			SET(bp->b_flags, B_RAHEAD);
+			bio_rastats.ra_issued++;
+		}
 		if (cred != NOCRED && bp->b_rcred == NOCRED) {
 			crhold(cred);
 			bp->b_rcred = cred;
@@ -359,6 +483,208 @@ breada(vp, blkno, size, rablkno, rabsize, cred, bpp)
 	return (breadn(vp, blkno, size, &rablkno, &rabsize, 1, cred, bpp));	
 }
 
+/*
+ * Adaptive read-ahead.
+ *
+ * Each vnode keeps track of the distance between its successive block
+ * reads.  Once the same distance has been seen twice in a row the
+ * vnode is taken to be in a sequential (+1), reverse (-1) or strided
+ * scan, and reads start asynchronous read-ahead of the blocks the scan
+ * will want next.  The window starts at bio_ramin blocks; it doubles
+ * each time a whole window of read-ahead gets used, and halves
+ * whenever a read-ahead buffer is recycled without having been read,
+ * so it settles where the read-ahead is consumed before the cache
+ * pushes it out.
+ *
+ *	v_lastr		last block read, maintained by the filesystem
+ *	v_rastride	distance between the last two reads
+ *	v_raconf	set once v_rastride has been repeated
+ *	v_rawin		current window, 0 while there is no pattern
+ *	v_raend		furthest block already scheduled
+ *	v_rahits	read-ahead buffers used at the current window
+ *
+ * Filesystems call bio_ratrack() once for each block they read and
+ * then either breadra(), or bio_rablocks() if they issue their own
+ * I/O.  Buffers being read ahead carry B_RAHEAD until somebody asks
+ * for them; getblk() and getnewbuf() feed that back into the window.
+ */
+
+/*
+ * Note a read of block lbn of vp.  Returns the stride of the scan the
+ * read belongs to, or 0 if there is no pattern.  v_lastr is left for
+ * the filesystem to update once the read has been done.
+ */
+int
+bio_ratrack(vp, lbn)
+	struct vnode *vp;
+	daddr_t lbn;
+{
+	int stride;
+
+	if (ISSET(vp->v_flag, VRAOFF))
+		return (0);
+
+	stride = lbn - vp->v_lastr;
+	if (stride == 0)
+		/* more of the same block; changes nothing */
+		return (vp->v_rawin ? vp->v_rastride : 0);
+
+	if (stride != vp->v_rastride ||
+	    stride > bio_rastridemax || stride < -bio_rastridemax) {
+		/* pattern (if any) broken; start again */
+		vp->v_rastride = stride;
+		vp->v_raconf = 0;
+		vp->v_rawin = 0;
+		vp->v_raend = lbn;
+		vp->v_rahits = 0;
+		return (0);
+	}
+
+	if (vp->v_raconf == 0) {
+		/* second read at this distance: we have a pattern */
+		vp->v_raconf = 1;
+		vp->v_rawin = bio_ramin;
+		vp->v_raend = lbn;
+		vp->v_rahits = 0;
+		if (stride == 1)
+			bio_rastats.ra_seq++;
+		else if (stride == -1)
+			bio_rastats.ra_reverse++;
+		else
+			bio_rastats.ra_strided++;
+	}
+	return (stride);
+}
+
+/*
+ * Fill in rablks with the blocks that should be read ahead of block
+ * lbn, and return how many there are (at most nmax).  Blocks beyond
+ * lastblk, the last block the caller can read ahead, are never
+ * included, nor are blocks already scheduled.  Read-ahead is topped
+ * up only once less than half a window remains, so that it goes out
+ * in batches rather than a block at a time.
+ */
+int
+bio_rablocks(vp, lbn, lastblk, rablks, nmax)
+	struct vnode *vp;
+	daddr_t lbn, lastblk;
+	daddr_t *rablks;
+	int nmax;
+{
+	int stride, win, lead, n;
+	daddr_t bn;
+
+	if ((win = vp->v_rawin) == 0 || ISSET(vp->v_flag, VRAOFF))
+		return (0);
+	stride = vp->v_rastride;
+	if (win > nmax)
+		win = nmax;
+
+	lead = (vp->v_raend - lbn) / stride;
+	if (lead < 0)
+		lead = 0;
+	if (lead > win / 2)
+		return (0);
+
+	n = 0;
+	for (bn = lbn + (lead + 1) * stride; lead < win; bn += stride) {
+		if (bn < 0 || bn > lastblk)
+			break;
+		lead++;
+		if (incore(vp, bn))
+			continue;
+		rablks[n++] = bn;
+	}
+	vp->v_raend = lbn + lead * stride;
+	return (n);
+}
+
+/*
+ * Read a disk block with adaptive read-ahead.  Read-ahead blocks are
+ * assumed to be the same size as the block being read; lastblk is the
+ * last block of the file for which that holds.  bio_ratrack() must
+ * already have been told about this read.
+ */
+int
+breadra(vp, blkno, size, lastblk, cred, bpp)
+	struct vnode *vp;
+	daddr_t blkno; int size;
+	daddr_t lastblk;
+	struct ucred *cred;
+	struct buf **bpp;
+{
+	daddr_t rablks[BIO_RAMAX];
+	int rasizes[BIO_RAMAX];
+	int i, n;
+
+	n = bio_rablocks(vp, blkno, lastblk, rablks, BIO_RAMAX);
+	for (i = 0; i < n; i++)
+		rasizes[i] = size;
+	return (breadn(vp, blkno, size, rablks, rasizes, n, cred, bpp));
+}
+
+/*
+ * Start an asynchronous read of a block the caller expects to want
+ * next, without waiting for it or any other block.  For files whose
+ * next block is not at a fixed distance from the last one, such as
+ * the right sibling of a B-tree node.  Returns 0 if the block was
+ * already in the cache, 1 if it was not and a read was started.
+ */
+int
+bio_readahead(vp, blkno, size, cred)
+	struct vnode *vp;
+	daddr_t blkno; int size;
+	struct ucred *cred;
+{
+
+	if (incore(vp, blkno))
+		return (0);
+	(void) bio_doread(vp, blkno, size, cred, B_ASYNC);
+	return (1);
+}
+
+/*
+ * A read-ahead buffer has been asked for: count the hit, and widen
+ * the window once a whole window's worth has been used.
+ */
+static void
+bio_rahit(bp)
+	struct buf *bp;
+{
+	struct vnode *vp = bp->b_vp;
+
+	CLR(bp->b_flags, B_RAHEAD);
+	bio_rastats.ra_hits++;
+	if (vp == NULL || vp->v_rawin == 0)
+		return;
+	if (++vp->v_rahits >= vp->v_rawin && vp->v_rawin < bio_ramax) {
+		vp->v_rawin = min(vp->v_rawin * 2, bio_ramax);
+		vp->v_rahits = 0;
+		bio_rastats.ra_grow++;
+	}
+}
+
+/*
+ * A read-ahead buffer is being recycled without having been used:
+ * the window is too large for the rate the data is consumed.
+ */
+static void
+bio_rawaste(bp)
+	struct buf *bp;
+{
+	struct vnode *vp = bp->b_vp;
+
+	CLR(bp->b_flags, B_RAHEAD);
+	if (ISSET(bp->b_flags, B_INVAL))
+		return;
+	bio_rastats.ra_wasted++;
+	if (vp == NULL || vp->v_rawin <= bio_ramin)
+		return;
+	vp->v_rawin = max(vp->v_rawin / 2, bio_ramin);
+	vp->v_rahits = 0;
+	bio_rastats.ra_shrink++;
+}
+
 /*
  * Block write.  Described in Bach (p.56)
  */
@@ -368,6 +694,7 @@ bwrite(bp)
 {
 	int rv, sync, wasdelayed;
 	struct proc	*p = current_proc();
+	void (*swap) __P((struct buf *, int));
 
 	/* Remember buffer type, to switch on it later. */
 	sync = !ISSET(bp->b_flags, B_ASYNC);
@@ -390,6 +717,25 @@ bwrite(bp)
 
 	trace(TR_BWRITE, pack(bp->b_vp, bp->b_bcount), bp->b_lblkno);
 
+	/*
+	 * Let the owner of any write dependencies roll back what may
+	 * not be written yet.  This is done in host order, before the
+	 * buffer is swapped.
+	 */
+	if (bp->b_dep.lh_first != NULL && bioops.io_start)
+		(*bioops.io_start)(bp);
+
+	/*
+	 * A file system that keeps this buffer in host byte order puts
+	 * it back in disk order for the write.  A synchronous write that
+	 * succeeds gets the host-order copy back; an asynchronous one
+	 * leaves the buffer in disk order for the next reader to convert.
+	 */
+	if ((swap = bp->b_bswap) != NULL) {
+		(*swap)(bp, 1);
+		bp->b_bswap = NULL;
+	}
+
 	/* Initiate disk write.  Make sure the appropriate party is charged. */
 	SET(bp->b_flags, B_WRITEINPROG);
 	bp->b_vp->v_numoutput++;
@@ -400,6 +746,10 @@ bwrite(bp)
 		 * If I/O was synchronous, wait for it to complete.
 		 */
 		rv = biowait(bp);
+		if (swap != NULL && rv == 0) {
+			(*swap)(bp, 0);
+			bp->b_bswap = swap;
+		}
 
 		/*
 		 * Pay for the I/O operation, if it's not been paid for, and
@@ -492,7 +842,7 @@ void
 brelse(bp)
 	struct buf *bp;
 {
-	struct bqueues *bufq;
+	int whichq;
 	int s;
 
 	trace(TR_BRELSE, pack(bp->b_vp, bp->b_bufsize), bp->b_lblkno);
@@ -532,28 +882,45 @@ brelse(bp)
 		if (bp->b_vp)
 			brelvp(bp);
 		CLR(bp->b_flags, B_DELWRI);
-		if (bp->b_bufsize <= 0)
+		bp->b_qflags = 0;
+		bp->b_bswap = NULL;
+		if (bp->b_dep.lh_first != NULL && bioops.io_deallocate)
+			(*bioops.io_deallocate)(bp);
+		if (bp->b_loancnt > 0)
+			/* memory still lent out */
+			whichq = BQ_LOCKED;
+		else if (bp->b_bufsize <= 0)
 			/* no data */
-			bufq = &bufqueues[BQ_EMPTY];
+			whichq = BQ_EMPTY;
 		else
 			/* invalid data */
-			bufq = &bufqueues[BQ_AGE];
-		binsheadfree(bp, bufq);
+			whichq = BQ_AGE;
+		binsheadfree(bp, &bufqueues[whichq], whichq);
 	} else {
 		/*
 		 * It has valid data.  Put it on the end of the appropriate
 		 * queue, so that it'll stick around for as long as possible.
 		 */
-		if (ISSET(bp->b_flags, B_LOCKED))
+		if (ISSET(bp->b_flags, B_LOCKED) || bp->b_loancnt > 0)
 			/* locked in core */
-			bufq = &bufqueues[BQ_LOCKED];
+			whichq = BQ_LOCKED;
 		else if (ISSET(bp->b_flags, B_AGE))
 			/* stale but valid data */
-			bufq = &bufqueues[BQ_AGE];
+			whichq = BQ_AGE;
+		else if (bp->b_qflags & BQF_HOT)
+			/* valid data, in demand */
+			whichq = BUF_ISMETA(bp) ? BQ_META : BQ_LRU;
 		else
-			/* valid data */
-			bufq = &bufqueues[BQ_LRU];
-		binstailfree(bp, bufq);
+			/* valid data, used once so far */
+			whichq = BQ_AGE;
+		/* count moves onto a hot queue, not each release to one */
+		if (whichq == BQ_LRU || whichq == BQ_META) {
+			if (!(bp->b_qflags & BQF_INHOT))
+				bufqstats.bq_promote++;
+			bp->b_qflags |= BQF_INHOT;
+		} else
+			bp->b_qflags &= ~BQF_INHOT;
+		binstailfree(bp, &bufqueues[whichq], whichq);
 	}
 
 	/* Unlock the buffer. */
@@ -589,6 +956,77 @@ incore(vp, blkno)
 	return (0);
 }
 
+/*
+ * Lend the memory of a cached block to the caller, who will point
+ * mbufs at it.  The block must be valid and not busy; nothing is
+ * read.  Returns NULL if the block can't be lent, in which case the
+ * caller falls back to copying.  Each successful call must be
+ * matched by a bufunloan(), which may come at interrupt level.
+ */
+struct buf *
+bufloan(vp, blkno)
+	struct vnode *vp;
+	daddr_t blkno;
+{
+	struct buf *bp;
+	int s;
+
+	s = splbio();
+	bp = incore(vp, blkno);
+	if (bp == NULL || ISSET(bp->b_flags, B_BUSY) ||
+	    !ISSET(bp->b_flags, B_DONE | B_DELWRI)) {
+		splx(s);
+		return (NULL);
+	}
+	if (bp->b_loancnt == 0) {
+		if (nbufloaned >= bufloanmax) {
+			bufqstats.bq_loanfull++;
+			splx(s);
+			return (NULL);
+		}
+		nbufloaned++;
+		bufqstats.bq_loans++;
+		bufqstats.bq_hits[bp->b_whichq]++;
+		bp->b_qflags |= BQF_HOT;
+		if (bp->b_whichq != BQ_LOCKED) {
+			bremfree(bp);
+			binstailfree(bp, &bufqueues[BQ_LOCKED], BQ_LOCKED);
+		}
+	}
+	bp->b_loancnt++;
+	splx(s);
+	return (bp);
+}
+
+/*
+ * Drop a reference taken by bufloan().  When the last one goes, the
+ * buffer is put back on the queue its state calls for.
+ */
+void
+bufunloan(bp)
+	struct buf *bp;
+{
+	int s;
+
+	s = splbio();
+	if (bp->b_loancnt <= 0)
+		panic("bufunloan: not lent");
+	if (--bp->b_loancnt > 0) {
+		splx(s);
+		return;
+	}
+	nbufloaned--;
+	if (ISSET(bp->b_flags, B_BUSY | B_LOCKED)) {
+		/* brelse() or the LOCKED queue will take care of it */
+		splx(s);
+		return;
+	}
+	bremfree(bp);
+	SET(bp->b_flags, B_BUSY);
+	splx(s);
+	brelse(bp);
+}
+
 /*
  * Get a block of requested size that is associated with
  * a given vnode and block offset. If it is found in the
@@ -619,13 +1057,22 @@ start:
 			goto start;
 		}
 		SET(bp->b_flags, (B_BUSY | B_CACHE));
+		bufqstats.bq_hits[bp->b_whichq]++;
+		bp->b_qflags |= BQF_HOT;
 		bremfree(bp);
 		splx(s);
+		if (ISSET(bp->b_flags, B_RAHEAD))
+			bio_rahit(bp);
 		allocbuf(bp, size);
 	} else {
 		splx(s);
 		if ((bp = getnewbuf(slpflag, slptimeo)) == NULL)
 			goto start;
+		bufqstats.bq_misses++;
+		if (bufghost_lookup(vp, blkno)) {
+			bufqstats.bq_ghosthits++;
+			bp->b_qflags |= BQF_HOT;
+		}
 		binshash(bp, BUFHASH(vp, blkno));
 		allocbuf(bp, size);
 		bp->b_blkno = bp->b_lblkno = blkno;
@@ -715,9 +1162,10 @@ allocbuf(bp, size)
 	 * If we want a buffer smaller than the current size,
 	 * shrink this buffer.  Grab a buf head from the EMPTY queue,
 	 * move a page onto it, and put it on front of the AGE queue.
-	 * If there are no free buffer headers, leave the buffer alone.
+	 * If there are no free buffer headers, or the pages are lent
+	 * to the network, leave the buffer alone.
 	 */
-	if (bp->b_bufsize > desired_size) {
+	if (bp->b_bufsize > desired_size && bp->b_loancnt == 0) {
 		s = splbio();
 		if ((nbp = bufqueues[BQ_EMPTY].tqh_first) == NULL) {
 			/* No free buffer head */
@@ -746,8 +1194,8 @@ out:
 
 /*
  * Find a buffer which is available for use.
- * Select something from a free list.
- * Preference is to AGE list, then LRU list.    
+ * Select something from a free list, as described at the top
+ * of this file.
  */
 struct buf *
 getnewbuf(slpflag, slptimeo)
@@ -756,8 +1204,8 @@ getnewbuf(slpflag, slptimeo)
 	register struct buf *bp;
 	register struct buf *lru_bp;
 	register struct buf *age_bp;
-	register int age_time, lru_time;
-	int s;
+	register struct buf *meta_bp;
+	int s, whichq;
 	struct ucred *cred;
 
 start:
@@ -765,48 +1213,60 @@ start:
 
 	age_bp = bufqueues[BQ_AGE].tqh_first;
 	lru_bp = bufqueues[BQ_LRU].tqh_first;
+	meta_bp = bufqueues[BQ_META].tqh_first;
 
-	if (age_bp == NULL && lru_bp == NULL) {
+	if (age_bp == NULL && lru_bp == NULL && meta_bp == NULL) {
 		/* wait for a free buffer of any kind */
 		needbuffer = 1;
 		tsleep(&needbuffer, slpflag|(PRIBIO+1), "getnewbuf", slptimeo);
 		splx(s);
 		return (0);
 	}
-	if (age_bp == NULL)
+	/*
+	 * Invalid buffers, and the AGE queue once it is over its target,
+	 * go first; then hot data, then hot metadata.  See the comment
+	 * at the top of this file.
+	 */
+	if (age_bp != NULL &&
+	    (ISSET(age_bp->b_flags, B_INVAL) ||
+	    bufqlen[BQ_AGE] > bufagetarget ||
+	    (lru_bp == NULL && meta_bp == NULL)))
+		bp = age_bp;
+	else if (meta_bp != NULL &&
+	    (bufqlen[BQ_META] > bufmetamax || lru_bp == NULL))
+		bp = meta_bp;
+	else if (lru_bp != NULL)
 		bp = lru_bp;
-	else if (lru_bp == NULL)
+	else
 		bp = age_bp;
-	else {
-		if (((age_time = (time.tv_sec - age_bp->b_timestamp)) < 0) ||
-			((lru_time = (time.tv_sec - lru_bp->b_timestamp)) < 0)) {
-			/* time was set backwards */
-			bp = age_bp;
-			/*
-			 * we should probably re-timestamp eveything in the queues
-			 * at this point with the current time
-			 */
-		} else {
-			if (lru_time >= lru_is_stale && age_time < age_is_stale)
-				bp = lru_bp;
-			else
-				bp = age_bp;
-		}
-	}
+	whichq = bp->b_whichq;
 	bremfree(bp);
 
 	/* Buffer is no longer on free lists. */
 	SET(bp->b_flags, B_BUSY);
 	splx(s);
 
-	/* If buffer was a delayed write, start it, and go back to the top. */
+	/*
+	 * If buffer was a delayed write, start it, and go back to the top.
+	 * It stays cached, so it is neither an eviction nor a ghost yet.
+	 */
 	if (ISSET(bp->b_flags, B_DELWRI)) {
 		bawrite (bp);
 		goto start;
 	}
 
+	s = splbio();
+	bufqstats.bq_evict[whichq]++;
+	if (whichq == BQ_AGE && bp->b_vp != NULL &&
+	    !ISSET(bp->b_flags, B_INVAL))
+		bufghost_enter(bp);
+	splx(s);
+
 	trace(TR_BRELSE, pack(bp->b_vp, bp->b_bufsize), bp->b_lblkno);
 
+	if (ISSET(bp->b_flags, B_RAHEAD))
+		bio_rawaste(bp);
+
 	/* disassociate us from our vnode, if we had one... */
 	s = splbio();
 	if (bp->b_vp)
@@ -815,6 +1275,7 @@ start:
 
 	/* clear out various other fields */
 	bp->b_flags = B_BUSY;
+	bp->b_qflags = 0;
 	bp->b_dev = NODEV;
 	bp->b_blkno = bp->b_lblkno = 0;
 	bp->b_iodone = 0;
@@ -823,6 +1284,9 @@ start:
 	bp->b_bcount = 0;
 	bp->b_dirtyoff = bp->b_dirtyend = 0;
 	bp->b_validoff = bp->b_validend = 0;
+	bp->b_bswap = NULL;
+	if (bp->b_dep.lh_first != NULL && bioops.io_deallocate)
+		(*bioops.io_deallocate)(bp);
 
 	/* nuke any credentials we were holding */
 	cred = bp->b_rcred;
@@ -889,6 +1353,15 @@ biodone(bp)
 		panic("biodone already");
 	SET(bp->b_flags, B_DONE);		/* note that it's done */
 
+	/*
+	 * Settle write dependencies first; a buffer that was written
+	 * with parts rolled back is dirtied again before anybody
+	 * waiting on the vnode's output is woken.
+	 */
+	if (!ISSET(bp->b_flags, B_READ) && !ISSET(bp->b_flags, B_RAW) &&
+	    bp->b_dep.lh_first != NULL && bioops.io_complete)
+		(*bioops.io_complete)(bp);
+
 	if (!ISSET(bp->b_flags, B_READ) && !ISSET(bp->b_flags, B_RAW))	/* wake up reader */
 		vwakeup(bp);
 
@@ -981,7 +1454,7 @@ vfs_bufstats()
 	register struct buf *bp;
 	register struct bqueues *dp;
 	int counts[MAXBSIZE/CLBYTES+1];
-	static char *bname[BQUEUES] = { "LOCKED", "LRU", "AGE", "EMPTY" };
+	static char *bname[BQUEUES] = { "LOCKED", "LRU", "AGE", "EMPTY", "META" };
 
 	for (dp = bufqueues, i = 0; dp < &bufqueues[BQUEUES]; dp++, i++) {
 		count = 0;
@@ -998,7 +1471,23 @@ vfs_bufstats()
 			if (counts[j] != 0)
 				printf(", %d-%d", j * CLBYTES, counts[j]);
 		printf("\n");
+		printf("%s: hits %ld, evictions %ld\n", bname[i],
+		    bufqstats.bq_hits[i], bufqstats.bq_evict[i]);
 	}
+	printf("misses %ld, ghost hits %ld, promotions %ld\n",
+	    bufqstats.bq_misses, bufqstats.bq_ghosthits,
+	    bufqstats.bq_promote);
+	printf("loans %ld, refused %ld, lent now %d\n",
+	    bufqstats.bq_loans, bufqstats.bq_loanfull, nbufloaned);
+	printf("read-ahead: issued %ld, hits %ld, wasted %ld, grow %ld, "
+	    "shrink %ld\n",
+	    bio_rastats.ra_issued, bio_rastats.ra_hits,
+	    bio_rastats.ra_wasted, bio_rastats.ra_grow,
+	    bio_rastats.ra_shrink);
+	printf("read-ahead patterns: sequential %ld, strided %ld, "
+	    "reverse %ld\n",
+	    bio_rastats.ra_seq, bio_rastats.ra_strided,
+	    bio_rastats.ra_reverse);
 }
 #endif /* DIAGNOSTIC */
 
@@ -1050,7 +1539,8 @@ free_io_buf(bp)
 	bp->b_vp = NULL;
 	bp->b_flags = B_INVAL;
 
-	binsheadfree(bp, &iobufqueue);
+	TAILQ_INSERT_HEAD(&iobufqueue, bp, b_freelist);
+	bp->b_timestamp = time.tv_sec;
 
 	splx(s);
 }
@@ -76,17 +76,32 @@
  * Name caching works as follows:
  *
  * Names found by directory scans are retained in a cache
- * for future reference.  It is managed LRU, so frequently
- * used names will hang around.  Cache is indexed by hash value
- * obtained from (vp, name) where vp refers to the directory
- * containing name.
+ * for future reference.  It is managed LRU with a second chance,
+ * so frequently used names will hang around.  Cache is indexed by
+ * hash value obtained from (vp, name) where vp refers to the
+ * directory containing name.
  *
  * If it is a "negative" entry, (i.e. for a name that is known NOT to
  * exist) the vnode pointer will be NULL.
  *
- * For simplicity (and economy of storage), names longer than
- * a maximum length of NCHNAMLEN are not cached; they occur
- * infrequently in any case, and are almost never of interest.
+ * Names of any length up to NAME_MAX are cached.  Entries come in
+ * two sizes: names of NCHNAMLEN or less get a short entry, longer
+ * names one with room for NAME_MAX.  When the entry at the front of
+ * the LRU list is the wrong size for a new name it is traded for a
+ * spare of the right size, and kept as a spare itself.
+ *
+ * Lookups never write to the cache structure on a hit.  Each hash
+ * bucket carries a sequence number that writers make odd while they
+ * change the chain and even again when they are done; a reader
+ * samples it before walking the chain and starts over if it moved.
+ * Writers are serialised by namecache_slock.  A hit only marks the
+ * entry referenced (once per LRU pass) instead of moving it on the
+ * LRU list; cache_enter() gives referenced entries a second pass
+ * before recycling them.  Stale entries (whose vnodes have been
+ * recycled) are skipped by lookups and reclaimed by cache_enter().
+ * Entries are never freed, not even to the kalloc zones, so a reader
+ * that races with a writer only ever follows pointers into namecache
+ * memory and is sent back by the sequence check.
  *
  * Upon reaching the last segment of a path, if the reference
  * is for DELETE, or NOCACHE is set (rewrite), and the
@@ -96,34 +111,96 @@
 /*
  * Structures associated with name cacheing.
  */
+struct nchashhead {
+	LIST_HEAD(, namecache) nh_list;	/* hash chain */
+	volatile u_long	nh_seq;		/* odd while chain is changing */
+};
+
 #define NCHHASH(dvp, cnp) \
 	(&nchashtbl[((dvp)->v_id + (cnp)->cn_hash) & nchash])
-LIST_HEAD(nchashhead, namecache) *nchashtbl;	/* Hash Table */
+struct nchashhead *nchashtbl;		/* Hash Table */
 u_long	nchash;				/* size of hash table - 1 */
 long	numcache;			/* number of cache entries allocated */
 TAILQ_HEAD(, namecache) nclruhead;	/* LRU chain */
+TAILQ_HEAD(, namecache) ncspare[2];	/* unused short and long entries */
 struct	nchstats nchstats;		/* cache effectiveness statistics */
 u_long nextvnodeid = 0;
 int doingcache = 1;			/* 1 => enable the cache */
+decl_simple_lock_data(,namecache_slock);	/* serialises cache writers */
+
+/*
+ * Size of an entry able to hold a name of len bytes, and the spare
+ * list for entries of that size.
+ */
+#define NCNAMEOFF	((u_long)&((struct namecache *)0)->nc_name[0])
+#define NCLONGSIZE	(NCNAMEOFF + ((NAME_MAX + 4) & ~3))
+#define NCALLOCSIZE(len) \
+	((len) <= NCHNAMLEN ? sizeof(struct namecache) : NCLONGSIZE)
+#define NCENTRYSIZE(ncp)	(NCNAMEOFF + (ncp)->nc_alloclen)
+#define NCSPARE(size)	(&ncspare[(size) == NCLONGSIZE])
+
+/*
+ * Per-mount statistics for the filesystem holding directory dvp.
+ */
+#define NCMNTSTAT(dvp, field) {					\
+	if ((dvp)->v_mount != NULL)				\
+		(dvp)->v_mount->mnt_nchstats.field++;		\
+}
+
+/*
+ * Order accesses to a hash chain against its sequence number, which
+ * the processor would otherwise be free to do on an MP ppc.
+ */
+#if defined(ppc)
+#define NCH_MEMBAR()	__asm__ volatile ("sync" : : : "memory")
+#else
+#define NCH_MEMBAR()	__asm__ volatile ("" : : : "memory")
+#endif
+
+/*
+ * Bracket a change to a hash chain.  Called with namecache_slock held.
+ */
+#define NCH_WRITE_BEGIN(ncpp)	{ (ncpp)->nh_seq++; NCH_MEMBAR(); }
+#define NCH_WRITE_END(ncpp)	{ NCH_MEMBAR(); (ncpp)->nh_seq++; }
+
+/*
+ * Has a hash chain changed since a reader sampled its sequence number
+ * as seq?  Everything the reader loaded from the chain before the call
+ * is ordered before the check.
+ */
+static __inline__ int
+nch_changed(ncpp, seq)
+	struct nchashhead *ncpp;
+	u_long seq;
+{
+
+	NCH_MEMBAR();
+	return (ncpp->nh_seq != seq);
+}
 
 /*
  * Delete an entry from its hash list and move it to the front
- * of the LRU list for immediate reuse.
+ * of the LRU list for immediate reuse.  Called with namecache_slock
+ * held.
  */
 #if DIAGNOSTIC
-#define PURGE(ncp)  {						\
+#define PURGE(ncpp, ncp)  {					\
 	if (ncp->nc_hash.le_prev == 0)				\
 		panic("namecache purge le_prev");		\
 	if (ncp->nc_hash.le_next == ncp)			\
 		panic("namecache purge le_next");		\
+	NCH_WRITE_BEGIN(ncpp);					\
 	LIST_REMOVE(ncp, nc_hash);				\
+	NCH_WRITE_END(ncpp);					\
 	ncp->nc_hash.le_prev = 0;				\
 	TAILQ_REMOVE(&nclruhead, ncp, nc_lru);			\
 	TAILQ_INSERT_HEAD(&nclruhead, ncp, nc_lru);		\
 }
 #else
-#define PURGE(ncp)  {						\
+#define PURGE(ncpp, ncp)  {					\
+	NCH_WRITE_BEGIN(ncpp);					\
 	LIST_REMOVE(ncp, nc_hash);				\
+	NCH_WRITE_END(ncpp);					\
 	ncp->nc_hash.le_prev = 0;				\
 	TAILQ_REMOVE(&nclruhead, ncp, nc_lru);			\
 	TAILQ_INSERT_HEAD(&nclruhead, ncp, nc_lru);		\
@@ -131,22 +208,97 @@ int doingcache = 1;			/* 1 => enable the cache */
 #endif /* DIAGNOSTIC */
 
 /*
- * Move an entry that has been used to the tail of the LRU list
- * so that it will be preserved for future use.
+ * Note that an entry has been used so that the next LRU pass
+ * preserves it.  Only the first use in each pass stores to the entry.
  */
 #define TOUCH(ncp)  {						\
-	if (ncp->nc_lru.tqe_next != 0) {			\
-		TAILQ_REMOVE(&nclruhead, ncp, nc_lru);		\
-		TAILQ_INSERT_TAIL(&nclruhead, ncp, nc_lru);	\
-	}							\
+	if ((ncp->nc_flag & NCF_REF) == 0)			\
+		ncp->nc_flag |= NCF_REF;			\
 }
 
 /*
- * Lookup an entry in the cache 
+ * Search a hash chain without taking namecache_slock.
  *
- * We don't do this if the segment name is long, simply so the cache 
- * can avoid holding long names (which would either waste space, or
- * add greatly to the complexity).
+ * Returns the entry for (dvp, name), or NULL if there is none.  The
+ * vnode and capability number are copied out while the chain is known
+ * to be stable, since the entry itself may be recycled as soon as we
+ * return.  Entries whose vnodes have gone stale are counted and
+ * skipped.
+ */
+static struct namecache *
+cache_search(ncpp, dvp, cnp, vpp, vpidp)
+	struct nchashhead *ncpp;
+	struct vnode *dvp;
+	struct componentname *cnp;
+	struct vnode **vpp;
+	u_long *vpidp;
+{
+	register struct namecache *ncp;
+	struct vnode *vp;
+	u_long seq, vpid, dvpid;
+
+retry:
+	while ((seq = ncpp->nh_seq) & 1)
+		continue;
+	NCH_MEMBAR();
+	for (ncp = ncpp->nh_list.lh_first; ncp != 0;
+	    ncp = ncp->nc_hash.le_next) {
+		if (nch_changed(ncpp, seq)) {
+			nchstats.ncs_retries++;
+			goto retry;
+		}
+		if (ncp->nc_dvp != dvp ||
+		    ncp->nc_hashval != cnp->cn_hash ||
+		    ncp->nc_nlen != cnp->cn_namelen ||
+		    bcmp(ncp->nc_name, cnp->cn_nameptr, (u_int)ncp->nc_nlen))
+			continue;
+		vp = ncp->nc_vp;
+		vpid = ncp->nc_vpid;
+		dvpid = ncp->nc_dvpid;
+		if (nch_changed(ncpp, seq)) {
+			nchstats.ncs_retries++;
+			goto retry;
+		}
+		/* If one of the vp's went stale, don't bother anymore. */
+		if (dvpid != dvp->v_id || (vp && vpid != vp->v_id)) {
+			nchstats.ncs_falsehits++;
+			NCMNTSTAT(dvp, mns_falsehits);
+			continue;
+		}
+		*vpp = vp;
+		*vpidp = vpid;
+		return (ncp);
+	}
+	if (nch_changed(ncpp, seq)) {
+		nchstats.ncs_retries++;
+		goto retry;
+	}
+	return (0);
+}
+
+/*
+ * Drop an entry found by cache_search(), provided nobody has
+ * recycled it for another name in the meantime.
+ */
+static void
+cache_zap(ncpp, ncp, dvp, cnp)
+	struct nchashhead *ncpp;
+	struct namecache *ncp;
+	struct vnode *dvp;
+	struct componentname *cnp;
+{
+
+	simple_lock(&namecache_slock);
+	if (ncp->nc_hash.le_prev != 0 &&
+	    ncp->nc_dvp == dvp &&
+	    ncp->nc_nlen == cnp->cn_namelen &&
+	    !bcmp(ncp->nc_name, cnp->cn_nameptr, (u_int)ncp->nc_nlen))
+		PURGE(ncpp, ncp);
+	simple_unlock(&namecache_slock);
+}
+
+/*
+ * Lookup an entry in the cache 
  *
  * Lookup is called with dvp pointing to the directory to search,
  * cnp pointing to the name of the entry being sought. If the lookup
@@ -162,61 +314,46 @@ cache_lookup(dvp, vpp, cnp)
 	struct vnode **vpp;
 	struct componentname *cnp;
 {
-	register struct namecache *ncp, *nnp;
+	register struct namecache *ncp;
 	register struct nchashhead *ncpp;
+	struct vnode *vp;
+	u_long vpid;
 
 	if (!doingcache) {
 		cnp->cn_flags &= ~MAKEENTRY;
 		return (0);
 	}
-	if (cnp->cn_namelen > NCHNAMLEN) {
-		nchstats.ncs_long++;
-		cnp->cn_flags &= ~MAKEENTRY;
-		return (0);
-	}
 
 	ncpp = NCHHASH(dvp, cnp);
-	for (ncp = ncpp->lh_first; ncp != 0; ncp = nnp) {
-		nnp = ncp->nc_hash.le_next;
-		/* If one of the vp's went stale, don't bother anymore. */
-		if ((ncp->nc_dvpid != ncp->nc_dvp->v_id) ||
-		    (ncp->nc_vp && ncp->nc_vpid != ncp->nc_vp->v_id)) {
-			nchstats.ncs_falsehits++;
-			PURGE(ncp);
-			continue;
-		}
-		/* Now that we know the vp's to be valid, is it ours ? */
-		if (ncp->nc_dvp == dvp &&
-		    ncp->nc_nlen == cnp->cn_namelen &&
-		    !bcmp(ncp->nc_name, cnp->cn_nameptr, (u_int)ncp->nc_nlen))
-			break;
-	}
+	ncp = cache_search(ncpp, dvp, cnp, &vp, &vpid);
 
 	/* We failed to find an entry */
 	if (ncp == 0) {
 		nchstats.ncs_miss++;
+		NCMNTSTAT(dvp, mns_miss);
 		return (0);
 	}
 
 	/* We don't want to have an entry, so dump it */
 	if ((cnp->cn_flags & MAKEENTRY) == 0) {
 		nchstats.ncs_badhits++;
-		PURGE(ncp);
+		cache_zap(ncpp, ncp, dvp, cnp);
 		return (0);
 	} 
 
 	/* We found a "positive" match, return the vnode */
-        if (ncp->nc_vp) {
+        if (vp) {
 		nchstats.ncs_goodhits++;
+		NCMNTSTAT(dvp, mns_goodhits);
 		TOUCH(ncp);
-		*vpp = ncp->nc_vp;
+		*vpp = vp;
 		return (-1);
 	}
 
 	/* We found a negative match, and want to create it, so purge */
 	if (cnp->cn_nameiop == CREATE) {
 		nchstats.ncs_badhits++;
-		PURGE(ncp);
+		cache_zap(ncpp, ncp, dvp, cnp);
 		return (0);
 	}
 
@@ -225,11 +362,105 @@ cache_lookup(dvp, vpp, cnp)
 	 * The nc_vpid field records whether this is a whiteout.
 	 */
 	nchstats.ncs_neghits++;
+	NCMNTSTAT(dvp, mns_neghits);
 	TOUCH(ncp);
-	cnp->cn_flags |= ncp->nc_vpid;
+	cnp->cn_flags |= vpid;
 	return (ENOENT);
 }
 
+/*
+ * Lookup for the namei() fast path.
+ *
+ * Only positive entries are reported, and nothing is ever purged;
+ * the caller falls back to VOP_LOOKUP (and so to cache_lookup) on a
+ * zero return.  On a hit, 1 is returned along with the vnode and the
+ * capability number it had when it was entered, which the caller must
+ * check once it holds the vnode.
+ */
+int
+cache_fastlookup(dvp, vpp, vpidp, cnp)
+	struct vnode *dvp;
+	struct vnode **vpp;
+	u_long *vpidp;
+	struct componentname *cnp;
+{
+	register struct namecache *ncp;
+	struct vnode *vp;
+	u_long vpid;
+
+	if (!doingcache)
+		return (0);
+	ncp = cache_search(NCHHASH(dvp, cnp), dvp, cnp, &vp, &vpid);
+	if (ncp == 0 || vp == NULL)
+		return (0);
+	nchstats.ncs_goodhits++;
+	nchstats.ncs_fasthits++;
+	NCMNTSTAT(dvp, mns_goodhits);
+	NCMNTSTAT(dvp, mns_fasthits);
+	TOUCH(ncp);
+	*vpp = vp;
+	*vpidp = vpid;
+	return (1);
+}
+
+/*
+ * Take an entry off the LRU list for reuse, giving referenced entries
+ * one more pass.  The entry is returned unhashed, or NULL if there is
+ * nothing to take.  Called with namecache_slock held.
+ */
+static struct namecache *
+cache_reclaim()
+{
+	register struct namecache *ncp;
+	long scan;
+
+	for (scan = 0; (ncp = nclruhead.tqh_first) != NULL; scan++) {
+		TAILQ_REMOVE(&nclruhead, ncp, nc_lru);
+		if (ncp->nc_hash.le_prev == 0)
+			return (ncp);
+		if ((ncp->nc_flag & NCF_REF) && scan < numcache) {
+			ncp->nc_flag &= ~NCF_REF;
+			TAILQ_INSERT_TAIL(&nclruhead, ncp, nc_lru);
+			continue;
+		}
+#if DIAGNOSTIC
+		if (ncp->nc_hash.le_next == ncp)
+			panic("cache_enter: le_next");
+#endif
+		NCH_WRITE_BEGIN(&nchashtbl[(ncp->nc_dvpid +
+		    ncp->nc_hashval) & nchash]);
+		LIST_REMOVE(ncp, nc_hash);
+		NCH_WRITE_END(&nchashtbl[(ncp->nc_dvpid +
+		    ncp->nc_hashval) & nchash]);
+		ncp->nc_hash.le_prev = 0;
+		return (ncp);
+	}
+	return (NULL);
+}
+
+/*
+ * Get an unused entry of the given size, from the spares if there is
+ * one.  Called with namecache_slock held, which is dropped while a
+ * new entry is allocated.
+ */
+static struct namecache *
+cache_newentry(size)
+	u_long size;
+{
+	register struct namecache *ncp;
+
+	if (ncp = NCSPARE(size)->tqh_first) {
+		TAILQ_REMOVE(NCSPARE(size), ncp, nc_lru);
+		return (ncp);
+	}
+	simple_unlock(&namecache_slock);
+	ncp = (struct namecache *)_MALLOC_ZONE(size, M_CACHE, M_WAITOK);
+	ncp->nc_alloclen = size - NCNAMEOFF;
+	ncp->nc_hash.le_prev = 0;
+	simple_lock(&namecache_slock);
+	return (ncp);
+}
+
 /*
  * Add an entry to the cache.
  */
@@ -241,40 +472,44 @@ cache_enter(dvp, vp, cnp)
 {
 	register struct namecache *ncp;
 	register struct nchashhead *ncpp;
+	u_long size;
 
 	if (!doingcache)
 		return;
 
 #if DIAGNOSTIC
-	if (cnp->cn_namelen > NCHNAMLEN)
+	if (cnp->cn_namelen > NAME_MAX)
 		panic("cache_enter: name too long");
 #endif
+	size = NCALLOCSIZE(cnp->cn_namelen);
 
 	/*
-	 * We allocate a new entry if we are less than the maximum
-	 * allowed and the one at the front of the LRU list is in use.
-	 * Otherwise we use the one at the front of the LRU list.
+	 * We add a new entry if we are less than the maximum allowed
+	 * and the one at the front of the LRU list is in use.
+	 * Otherwise we reuse the one at the front of the LRU list.
+	 * If it is too small for this name, or a long entry when a
+	 * short spare would do, it is swapped for a spare.  A long
+	 * entry is only allocated when there is no long spare, and a
+	 * short one only when the cache grows, so there are never
+	 * more than desiredvnodes of either.
 	 */
+	simple_lock(&namecache_slock);
 	if (numcache < desiredvnodes &&
 	    ((ncp = nclruhead.tqh_first) == NULL ||
 	    ncp->nc_hash.le_prev != 0)) {
 		/* Add one more entry */
-		ncp = (struct namecache *)
-			_MALLOC_ZONE((u_long)sizeof *ncp, M_CACHE, M_WAITOK);
 		numcache++;
-	} else if (ncp = nclruhead.tqh_first) {
+		ncp = cache_newentry(size);
+	} else if (ncp = cache_reclaim()) {
 		/* reuse an old entry */
-		TAILQ_REMOVE(&nclruhead, ncp, nc_lru);
-		if (ncp->nc_hash.le_prev != 0) {
-#if DIAGNOSTIC
-			if (ncp->nc_hash.le_next == ncp)
-				panic("cache_enter: le_next");
-#endif
-			LIST_REMOVE(ncp, nc_hash);
-			ncp->nc_hash.le_prev = 0;
+		if (NCENTRYSIZE(ncp) < size ||
+		    (NCENTRYSIZE(ncp) > size && NCSPARE(size)->tqh_first)) {
+			TAILQ_INSERT_HEAD(NCSPARE(NCENTRYSIZE(ncp)), ncp, nc_lru);
+			ncp = cache_newentry(size);
 		}
 	} else {
 		/* give up */
+		simple_unlock(&namecache_slock);
 		return;
 	}
 
@@ -282,7 +517,8 @@ cache_enter(dvp, vp, cnp)
 	 * Fill in cache info, if vp is NULL this is a "negative" cache entry.
 	 * For negative entries, we have to record whether it is a whiteout.
 	 * the whiteout flag is stored in the nc_vpid field which is
-	 * otherwise unused.
+	 * otherwise unused.  The entry is not yet on a hash chain, so no
+	 * reader can see it half built.
 	 */
 	ncp->nc_vp = vp;
 	if (vp)
@@ -291,6 +527,8 @@ cache_enter(dvp, vp, cnp)
 		ncp->nc_vpid = cnp->cn_flags & ISWHITEOUT;
 	ncp->nc_dvp = dvp;
 	ncp->nc_dvpid = dvp->v_id;
+	ncp->nc_hashval = cnp->cn_hash;
+	ncp->nc_flag = 0;
 	ncp->nc_nlen = cnp->cn_namelen;
 	bcopy(cnp->cn_nameptr, ncp->nc_name, (unsigned)ncp->nc_nlen);
 	TAILQ_INSERT_TAIL(&nclruhead, ncp, nc_lru);
@@ -299,12 +537,15 @@ cache_enter(dvp, vp, cnp)
 	{
 		register struct namecache *p;
 
-		for (p = ncpp->lh_first; p != 0; p = p->nc_hash.le_next)
+		for (p = ncpp->nh_list.lh_first; p != 0; p = p->nc_hash.le_next)
 			if (p == ncp)
 				panic("cache_enter: duplicate");
 	}
 #endif
-	LIST_INSERT_HEAD(ncpp, ncp, nc_hash);
+	NCH_WRITE_BEGIN(ncpp);
+	LIST_INSERT_HEAD(&ncpp->nh_list, ncp, nc_hash);
+	NCH_WRITE_END(ncpp);
+	simple_unlock(&namecache_slock);
 }
 
 /*
@@ -313,18 +554,31 @@ cache_enter(dvp, vp, cnp)
 void
 nchinit()
 {
+	long hashsize;
+	int i;
 
 	TAILQ_INIT(&nclruhead);
-	nchashtbl = hashinit(desiredvnodes, M_CACHE, &nchash);
+	TAILQ_INIT(&ncspare[0]);
+	TAILQ_INIT(&ncspare[1]);
+	simple_lock_init(&namecache_slock);
+	for (hashsize = 1; hashsize <= desiredvnodes; hashsize <<= 1)
+		continue;
+	hashsize >>= 1;
+	MALLOC(nchashtbl, struct nchashhead *,
+	    (u_long)hashsize * sizeof(*nchashtbl), M_CACHE, M_WAITOK);
+	bzero(nchashtbl, (u_long)hashsize * sizeof(*nchashtbl));
+	for (i = 0; i < hashsize; i++)
+		LIST_INIT(&nchashtbl[i].nh_list);
+	nchash = hashsize - 1;
 }
 
 /*
  * Invalidate a all entries to particular vnode.
  * 
  * We actually just increment the v_id, that will do it. The entries will
- * be purged by lookup as they get found. If the v_id wraps around, we
- * need to ditch the entire cache, to avoid confusion. No valid vnode will
- * ever have (v_id == 0).
+ * be skipped by lookup and recycled by cache_enter. If the v_id wraps
+ * around, we need to ditch the entire cache, to avoid confusion. No
+ * valid vnode will ever have (v_id == 0).
  */
 void
 cache_purge(vp)
@@ -336,10 +590,12 @@ cache_purge(vp)
 	vp->v_id = ++nextvnodeid;
 	if (nextvnodeid != 0)
 		return;
+	simple_lock(&namecache_slock);
 	for (ncpp = &nchashtbl[nchash]; ncpp >= nchashtbl; ncpp--) {
-		while (ncp = ncpp->lh_first)
-			PURGE(ncp);
+		while (ncp = ncpp->nh_list.lh_first)
+			PURGE(ncpp, ncp);
 	}
+	simple_unlock(&namecache_slock);
 	vp->v_id = ++nextvnodeid;
 #if MACH_NBC
 	/* ?? */
@@ -361,14 +617,72 @@ cache_purgevfs(mp)
 	struct namecache *ncp, *nnp;
 
 	/* Scan hash tables for applicable entries */
+	simple_lock(&namecache_slock);
 	for (ncpp = &nchashtbl[nchash]; ncpp >= nchashtbl; ncpp--) {
-		for (ncp = ncpp->lh_first; ncp != 0; ncp = nnp) {
+		for (ncp = ncpp->nh_list.lh_first; ncp != 0; ncp = nnp) {
 			nnp = ncp->nc_hash.le_next;
 			if (ncp->nc_dvpid != ncp->nc_dvp->v_id ||
 			    (ncp->nc_vp && ncp->nc_vpid != ncp->nc_vp->v_id) ||
 			    ncp->nc_dvp->v_mount == mp) {
-				PURGE(ncp);
+				PURGE(ncpp, ncp);
 			}
 		}
 	}
+	simple_unlock(&namecache_slock);
+}
+
+#define KINFO_MNTSLOP	4
+/*
+ * Copy out the per-mount name cache statistics (via sysctl).
+ */
+int
+sysctl_mntnchstats(where, sizep, p)
+	char *where;
+	size_t *sizep;
+	struct proc *p;
+{
+	struct mount *mp, *nmp;
+	struct mntnchstats mns;
+	char *bp = where;
+	char *ewhere;
+	int nmounts, error;
+
+	if (where == NULL) {
+		nmounts = 0;
+		simple_lock(&mountlist_slock);
+		for (mp = mountlist.cqh_first; mp != (void *)&mountlist;
+		    mp = mp->mnt_list.cqe_next)
+			nmounts++;
+		simple_unlock(&mountlist_slock);
+		*sizep = (nmounts + KINFO_MNTSLOP) * sizeof(mns);
+		return (0);
+	}
+	ewhere = where + *sizep;
+
+	simple_lock(&mountlist_slock);
+	for (mp = mountlist.cqh_first; mp != (void *)&mountlist; mp = nmp) {
+		if (vfs_busy(mp, LK_NOWAIT, &mountlist_slock, p)) {
+			nmp = mp->mnt_list.cqe_next;
+			continue;
+		}
+		if (bp + sizeof(mns) > ewhere) {
+			vfs_unbusy(mp, p);
+			*sizep = bp - where;
+			return (ENOMEM);
+		}
+		mns = mp->mnt_nchstats;
+		mns.mns_fsid = mp->mnt_stat.f_fsid;
+		if (error = copyout((caddr_t)&mns, bp, sizeof(mns))) {
+			vfs_unbusy(mp, p);
+			return (error);
+		}
+		bp += sizeof(mns);
+		simple_lock(&mountlist_slock);
+		nmp = mp->mnt_list.cqe_next;
+		vfs_unbusy(mp, p);
+	}
+	simple_unlock(&mountlist_slock);
+
+	*sizep = bp - where;
+	return (0);
 }
@@ -1319,7 +1319,13 @@ redo:
 		 */
 		if (last_bp == NULL || start_lbn != lbn) {
 			tbp = getblk(vp, start_lbn, size, 0, 0);
-			if (!(tbp->b_flags & B_DELWRI)) {
+			/*
+			 * A buffer held in host byte order, or one with
+			 * write dependencies, has to go through bwrite()
+			 * to be swapped or rolled back; leave it dirty.
+			 */
+			if (!(tbp->b_flags & B_DELWRI) || tbp->b_bswap ||
+			    tbp->b_dep.lh_first != NULL) {
 				brelse(tbp);
 				break;
 			}
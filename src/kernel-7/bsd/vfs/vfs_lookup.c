@@ -291,6 +291,7 @@ lookup(ndp)
 	int error = 0;
 	struct componentname *cnp = &ndp->ni_cnd;
 	struct proc *p = cnp->cn_proc;
+	u_long vpid;			/* capability number of cached vnode */
 	int i;
 
 	/*
@@ -406,7 +407,33 @@ dirloop:
 
 	/*
 	 * We now have a segment name to search for, and a directory to search.
+	 *
+	 * If the filesystem lets namei walk its cached names, try to
+	 * resolve the component from the name cache without calling
+	 * VOP_LOOKUP.  This is what the filesystem's own lookup would do
+	 * on a cache hit: check search permission, lock the child, drop
+	 * the parent and make sure the child was not recycled meanwhile.
+	 * Anything unusual ("..", "." or a last component that has to
+	 * leave the parent locked or be dropped from the cache) goes the
+	 * long way.
 	 */
+	if ((dp->v_type == VDIR) && (dp->v_mount != NULL) &&
+	    (dp->v_mount->mnt_flag & (MNT_NCFASTPATH | MNT_UNION)) ==
+	    MNT_NCFASTPATH &&
+	    (cnp->cn_flags & (MAKEENTRY | ISDOTDOT)) == MAKEENTRY &&
+	    ((cnp->cn_flags & ISLASTCN) == 0 ||
+	    (cnp->cn_nameiop == LOOKUP && (cnp->cn_flags & LOCKPARENT) == 0)) &&
+	    cache_fastlookup(dp, &tdp, &vpid, cnp) && tdp != dp &&
+	    VOP_ACCESS(dp, VEXEC, cnp->cn_cred, p) == 0 &&
+	    vget(tdp, LK_EXCLUSIVE, p) == 0) {
+		if (tdp->v_id == vpid) {
+			VOP_UNLOCK(dp, 0, p);
+			ndp->ni_dvp = dp;
+			ndp->ni_vp = tdp;
+			goto found;
+		}
+		vput(tdp);
+	}
 unionlookup:
 	ndp->ni_dvp = dp;
 	ndp->ni_vp = NULL;
@@ -465,6 +492,7 @@ unionlookup:
 		cnp->cn_consume = 0;
 	}
 
+found:
 	dp = ndp->ni_vp;
 	/*
 	 * Check to see if the vnode has been mounted on;
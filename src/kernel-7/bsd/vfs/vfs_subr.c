@@ -497,6 +497,11 @@ retry:
 		vp->v_lastr = 0;
 		vp->v_ralen = 0;
 		vp->v_maxra = 0;
+		vp->v_raend = 0;
+		vp->v_rastride = 0;
+		vp->v_rawin = 0;
+		vp->v_raconf = 0;
+		vp->v_rahits = 0;
 		vp->v_lastw = 0;
 		vp->v_lasta = 0;
 		vp->v_cstart = 0;
@@ -705,6 +710,8 @@ brelvp(bp)
  * Reassign a buffer from one vnode to another.
  * Used to assign file specific control information
  * (indirect blocks) to the vnode to which they belong.
+ * Write completion may re-dirty a buffer from interrupt
+ * level, so the lists are only touched at splbio.
  */
 void
 reassignbuf(bp, newvp)
@@ -712,11 +719,13 @@ reassignbuf(bp, newvp)
 	register struct vnode *newvp;
 {
 	register struct buflists *listheadp;
+	int s;
 
 	if (newvp == NULL) {
 		printf("reassignbuf: NULL");
 		return;
 	}
+	s = splbio();
 	/*
 	 * Delete from old vnode list, if on one.
 	 */
@@ -731,6 +740,7 @@ reassignbuf(bp, newvp)
 	else
 		listheadp = &newvp->v_cleanblkhd;
 	bufinsvn(bp, listheadp);
+	splx(s);
 }
 
 /*
@@ -1640,6 +1650,8 @@ vfs_sysctl(name, namelen, oldp, oldlenp, newp, newlen, p)
 {
 	struct ctldebug *cdp;
 	struct vfsconf *vfsp;
+	extern struct nchstats nchstats;
+	extern int sysctl_mntnchstats __P((char *, size_t *, struct proc *));
 
 #ifdef NeXT
 	if (name[0] == VFS_NUMMNTOPS) {
@@ -1672,6 +1684,13 @@ vfs_sysctl(name, namelen, oldp, oldlenp, newp, newlen, p)
 			return (EOPNOTSUPP);
 		return (sysctl_rdstruct(oldp, oldlenp, newp, vfsp,
 		    sizeof(struct vfsconf)));
+	case VFS_NCHSTATS:
+		return (sysctl_rdstruct(oldp, oldlenp, newp, &nchstats,
+		    sizeof(struct nchstats)));
+	case VFS_MNTNCHSTATS:
+		if (newp)
+			return (EPERM);
+		return (sysctl_mntnchstats(oldp, oldlenp, p));
 	}
 	return (EOPNOTSUPP);
 }
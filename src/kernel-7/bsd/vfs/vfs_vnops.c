@@ -80,6 +80,7 @@
 #include <sys/vnode.h>
 #include <sys/ioctl.h>
 #include <sys/tty.h>
+#include <sys/event.h>
 #include <kern/mapfs.h>
 
 struct 	fileops vnops =
@@ -517,6 +518,100 @@ vn_select(fp, which, p)
 		fp->f_cred, p));
 }
 
+/*
+ * File table vnode kqueue filters.
+ *
+ * Regular files and directories are always readable and writable,
+ * as they are for select.  EVFILT_VNODE collects the NOTE_* changes
+ * posted by the filesystem with VN_KNOTE; it is edge triggered, the
+ * collected flags are cleared each time they are returned.  Only the
+ * filesystems that post them take EVFILT_VNODE; elsewhere a watcher
+ * would wait forever, so it is refused.
+ */
+#define	VN_POSTS_KNOTES(vp) \
+	((vp)->v_tag == VT_UFS || (vp)->v_tag == VT_HFS || (vp)->v_tag == VT_NFS)
+
+static int	filt_vnattach __P((struct knote *kn));
+static void	filt_vndetach __P((struct knote *kn));
+static int	filt_vnode __P((struct knote *kn, long hint));
+static int	filt_vnready __P((struct knote *kn, long hint));
+
+static struct filterops vnode_filtops =
+	{ 1, filt_vnattach, filt_vndetach, filt_vnode };
+static struct filterops vnready_filtops =
+	{ 1, filt_vnattach, filt_vndetach, filt_vnready };
+
+int
+vn_kqfilter(fp, kn)
+	struct file *fp;
+	struct knote *kn;
+{
+	struct vnode *vp = (struct vnode *)fp->f_data;
+
+	switch (kn->kn_filter) {
+	case EVFILT_READ:
+	case EVFILT_WRITE:
+		if (vp->v_type != VREG && vp->v_type != VDIR)
+			return (EINVAL);
+		kn->kn_fop = &vnready_filtops;
+		break;
+	case EVFILT_VNODE:
+		if (!VN_POSTS_KNOTES(vp))
+			return (EOPNOTSUPP);
+		kn->kn_fop = &vnode_filtops;
+		kn->kn_flags |= EV_CLEAR;
+		break;
+	default:
+		return (EINVAL);
+	}
+	return (filt_vnattach(kn));
+}
+
+static int
+filt_vnattach(kn)
+	struct knote *kn;
+{
+	struct vnode *vp = (struct vnode *)kn->kn_fp->f_data;
+	int s;
+
+	s = splhigh();
+	LIST_INSERT_HEAD(&vp->v_knotes, kn, kn_selnext);
+	splx(s);
+	return (0);
+}
+
+static void
+filt_vndetach(kn)
+	struct knote *kn;
+{
+	int s;
+
+	s = splhigh();
+	LIST_REMOVE(kn, kn_selnext);
+	splx(s);
+}
+
+static int
+filt_vnode(kn, hint)
+	struct knote *kn;
+	long hint;
+{
+
+	if (kn->kn_sfflags & hint)
+		kn->kn_fflags |= hint;
+	return (kn->kn_fflags != 0);
+}
+
+static int
+filt_vnready(kn, hint)
+	struct knote *kn;
+	long hint;
+{
+
+	kn->kn_data = 0;
+	return (1);
+}
+
 /*
  * Check that the vnode is still valid, and if so
  * acquire requested lock.
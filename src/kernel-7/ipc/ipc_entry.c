@@ -86,7 +86,7 @@
 #include <ipc/port.h>
 #include <ipc/ipc_entry.h>
 #include <ipc/ipc_space.h>
-#include <ipc/ipc_splay.h>
+#include <ipc/ipc_tree.h>
 #include <ipc/ipc_object.h>
 #include <ipc/ipc_hash.h>
 #include <ipc/ipc_table.h>
@@ -101,12 +101,15 @@ boolean_t ipc_entry_tree_collision(
 	ipc_space_t	space,
 	mach_port_t	name);
 
+kern_return_t ipc_entry_grow_tree(
+	ipc_space_t	space);
+
 /*
  *	Routine:	ipc_entry_tree_collision
  *	Purpose:
  *		Checks if "name" collides with an allocated name
  *		in the space's tree.  That is, returns TRUE
- *		if the splay tree contains a name with the same
+ *		if the tree contains another name with the same
  *		index as "name".
  *	Conditions:
  *		The space is locked (read or write) and active.
@@ -117,21 +120,83 @@ ipc_entry_tree_collision(
 	ipc_space_t	space,
 	mach_port_t	name)
 {
-	mach_port_index_t index;
-	mach_port_t lower, upper;
+	assert(space->is_active);
+
+	return ipc_tree_collision(&space->is_tree, name);
+}
+
+/*
+ *	Routine:	ipc_entry_grow_tree
+ *	Purpose:
+ *		Makes room in the space's tree for one more entry,
+ *		and frees tree slots that are no longer in use.
+ *	Conditions:
+ *		The space must be write-locked and active before.
+ *		If successful, it is also returned locked, but
+ *		it may have been unlocked, and may have died.
+ *		Allocates memory.
+ *	Returns:
+ *		KERN_SUCCESS		Made room, or somebody else did.
+ *		KERN_RESOURCE_SHORTAGE	Couldn't allocate slots.
+ */
+
+kern_return_t
+ipc_entry_grow_tree(
+	ipc_space_t	space)
+{
+	ipc_tree_t tree = &space->is_tree;
+	ipc_tree_entry_t *slots;
+	ipc_entry_num_t size;
 
 	assert(space->is_active);
 
 	/*
-	 *	Check if we collide with the next smaller name
-	 *	or the next larger name.
+	 *	If a rehash is still under way, finish it now;
+	 *	new slots can't be installed until it is done.
 	 */
 
-	ipc_splay_tree_bounds(&space->is_tree, name, &lower, &upper);
+	if (tree->itr_oslots != (ipc_tree_entry_t *) 0)
+		ipc_tree_rehash(tree, tree->itr_osize);
 
-	index = MACH_PORT_INDEX(name);
-	return (((lower != ~0) && (MACH_PORT_INDEX(lower) == index)) ||
-		((upper != 0) && (MACH_PORT_INDEX(upper) == index)));
+	if (tree->itr_fslots != (ipc_tree_entry_t *) 0) {
+		slots = tree->itr_fslots;
+		size = tree->itr_fsize;
+		tree->itr_fslots = (ipc_tree_entry_t *) 0;
+		tree->itr_fsize = 0;
+
+		is_write_unlock(space);
+		ipc_tree_slots_free(slots, size);
+		is_write_lock(space);
+		return KERN_SUCCESS;
+	}
+
+	if (!ipc_tree_full(tree))
+		return KERN_SUCCESS;
+
+	size = ipc_tree_grow_size(tree);
+	is_write_unlock(space);
+	slots = ipc_tree_slots_alloc(size);
+	if (slots == (ipc_tree_entry_t *) 0)
+		return KERN_RESOURCE_SHORTAGE;
+	is_write_lock(space);
+
+	if (!space->is_active || !ipc_tree_full(tree) ||
+	    (tree->itr_oslots != (ipc_tree_entry_t *) 0) ||
+	    (tree->itr_fslots != (ipc_tree_entry_t *) 0) ||
+	    (size < 2 * (tree->itr_count + 1))) {
+		/*
+		 *	The tree changed while the space was unlocked.
+		 *	Let the caller look again.
+		 */
+
+		is_write_unlock(space);
+		ipc_tree_slots_free(slots, size);
+		is_write_lock(space);
+		return KERN_SUCCESS;
+	}
+
+	ipc_tree_install(tree, slots, size);
+	return KERN_SUCCESS;
 }
 
 /*
@@ -169,7 +234,7 @@ ipc_entry_lookup(
 	else
 	    tree_lookup:
 		entry = (ipc_entry_t)
-				ipc_splay_tree_lookup(&space->is_tree, name);
+				ipc_tree_lookup(&space->is_tree, name);
 
 	assert((entry == IE_NULL) || IE_BITS_TYPE(entry->ie_bits));
 	return entry;
@@ -369,12 +434,10 @@ ipc_entry_alloc_name(
 		 *	Before trying to allocate any memory,
 		 *	check if the entry already exists in the tree.
 		 *	This avoids spurious resource errors.
-		 *	The splay tree makes a subsequent lookup/insert
-		 *	of the same name cheap, so this costs little.
 		 */
 
 		if ((space->is_tree_total > 0) &&
-		    ((tentry = ipc_splay_tree_lookup(&space->is_tree, name))
+		    ((tentry = ipc_tree_lookup(&space->is_tree, name))
 							!= ITE_NULL)) {
 			assert(tentry->ite_space == space);
 			assert(IE_BITS_TYPE(tentry->ite_bits));
@@ -425,7 +488,29 @@ ipc_entry_alloc_name(
 		}
 
 		/*
-		 *	If a splay-tree entry was allocated previously,
+		 *	Drained tree slots are freed here, where the
+		 *	space can be unlocked, and the tree is grown
+		 *	before it gets too full to insert into.
+		 *	Either way the space was unlocked, so restart.
+		 */
+
+		if ((space->is_tree.itr_fslots != (ipc_tree_entry_t *) 0) ||
+		    ((tree_entry != ITE_NULL) &&
+		     ipc_tree_full(&space->is_tree))) {
+			kern_return_t kr;
+
+			kr = ipc_entry_grow_tree(space);
+			if (kr != KERN_SUCCESS) {
+				/* space is unlocked */
+				if (tree_entry) ite_free(tree_entry);
+				return kr;
+			}
+
+			continue;
+		}
+
+		/*
+		 *	If a tree entry was allocated previously,
 		 *	go ahead and insert it into the tree.
 		 */
 
@@ -439,8 +524,7 @@ ipc_entry_alloc_name(
 				 !ipc_entry_tree_collision(space, name))
 				space->is_tree_small++;
 
-			ipc_splay_tree_insert(&space->is_tree,
-					      name, tree_entry);
+			ipc_tree_insert(&space->is_tree, name, tree_entry);
 
 			tree_entry->ite_bits = 0;
 			tree_entry->ite_object = IO_NULL;
@@ -493,25 +577,16 @@ ipc_entry_dealloc(
 		assert(IE_BITS_GEN(entry->ie_bits) == MACH_PORT_GEN(name));
 
 		if (entry->ie_bits & IE_BITS_COLLISION) {
-			struct ipc_splay_tree small, collisions;
 			ipc_tree_entry_t tentry;
 			mach_port_t tname;
-			boolean_t pick;
 			ipc_entry_bits_t bits;
 			ipc_object_t obj;
 
 			/* must move an entry from tree to table */
 
-			ipc_splay_tree_split(&space->is_tree,
-					     MACH_PORT_MAKE(index+1, 0),
-					     &collisions);
-			ipc_splay_tree_split(&collisions,
-					     MACH_PORT_MAKE(index, 0),
-					     &small);
-
-			pick = ipc_splay_tree_pick(&collisions,
-						   &tname, &tentry);
-			assert(pick);
+			tentry = ipc_tree_lookup_index(&space->is_tree, index);
+			assert(tentry != ITE_NULL);
+			tname = tentry->ite_name;
 			assert(MACH_PORT_INDEX(tname) == index);
 
 			bits = tentry->ite_bits;
@@ -527,22 +602,16 @@ ipc_entry_dealloc(
 						      index, entry);
 			}
 
-			ipc_splay_tree_delete(&collisions, tname, tentry);
+			ipc_tree_delete(&space->is_tree, tname, tentry);
 
 			assert(space->is_tree_total > 0);
 			space->is_tree_total--;
 
 			/* check if collision bit should still be on */
 
-			pick = ipc_splay_tree_pick(&collisions,
-						   &tname, &tentry);
-			if (pick) {
+			if (ipc_tree_lookup_index(&space->is_tree, index)
+							!= ITE_NULL)
 				entry->ie_bits |= IE_BITS_COLLISION;
-				ipc_splay_tree_join(&space->is_tree,
-						    &collisions);
-			}
-
-			ipc_splay_tree_join(&space->is_tree, &small);
 		} else {
 			entry->ie_bits &= IE_BITS_GEN_MASK;
 			entry->ie_next = table->ie_next;
@@ -553,7 +622,7 @@ ipc_entry_dealloc(
 
 		assert(tentry->ite_space == space);
 
-		ipc_splay_tree_delete(&space->is_tree, name, tentry);
+		ipc_tree_delete(&space->is_tree, name, tentry);
 
 		assert(space->is_tree_total > 0);
 		space->is_tree_total--;
@@ -740,7 +809,7 @@ ipc_entry_grow_table(
 		}
 
 		/*
-		 *	If there are entries in the splay tree,
+		 *	If there are entries in the tree,
 		 *	then we have work to do:
 		 *		1) transfer entries to the table
 		 *		2) update is_tree_small
@@ -749,14 +818,11 @@ ipc_entry_grow_table(
 		if (space->is_tree_total > 0) {
 			mach_port_index_t index;
 			boolean_t delete;
-			struct ipc_splay_tree ignore;
-			struct ipc_splay_tree move;
-			struct ipc_splay_tree small;
 			ipc_entry_num_t nosmall;
 			ipc_tree_entry_t tentry;
 
 			/*
-			 *	The splay tree divides into four regions,
+			 *	The tree divides into four regions,
 			 *	based on the index of the entries:
 			 *		1) 0 <= index < osize
 			 *		2) osize <= index < size
@@ -771,21 +837,13 @@ ipc_entry_grow_table(
 			 *	Entries in the fourth part are ignored.
 			 */
 
-			ipc_splay_tree_split(&space->is_tree,
-					     MACH_PORT_MAKE(nsize, 0),
-					     &small);
-			ipc_splay_tree_split(&small,
-					     MACH_PORT_MAKE(size, 0),
-					     &move);
-			ipc_splay_tree_split(&move,
-					     MACH_PORT_MAKE(osize, 0),
-					     &ignore);
-
 			/* move entries into the table */
 
-			for (tentry = ipc_splay_traverse_start(&move);
+			delete = FALSE;
+			for (tentry = ipc_tree_traverse_start(&space->is_tree);
 			     tentry != ITE_NULL;
-			     tentry = ipc_splay_traverse_next(&move, delete)) {
+			     tentry = ipc_tree_traverse_next(&space->is_tree,
+							     delete)) {
 				mach_port_t name;
 				mach_port_gen_t gen;
 				mach_port_type_t type;
@@ -798,7 +856,10 @@ ipc_entry_grow_table(
 				index = MACH_PORT_INDEX(name);
 
 				assert(tentry->ite_space == space);
-				assert((osize <= index) && (index < size));
+
+				delete = FALSE;
+				if ((index < osize) || (size <= index))
+					continue;
 
 				entry = &table[index];
 
@@ -811,7 +872,6 @@ ipc_entry_grow_table(
 
 					entry->ie_bits =
 						bits | IE_BITS_COLLISION;
-					delete = FALSE;
 					continue;
 				}
 
@@ -833,34 +893,31 @@ ipc_entry_grow_table(
 				space->is_tree_total--;
 				delete = TRUE;
 			}
-			ipc_splay_traverse_finish(&move);
+			ipc_tree_traverse_finish(&space->is_tree);
 
-			/* count entries for is_tree_small */
+			/*
+			 *	Count entries for is_tree_small.  Only one
+			 *	entry per index counts; that is the one
+			 *	ipc_tree_lookup_index picks for the index.
+			 */
 
-			nosmall = 0; index = 0;
-			for (tentry = ipc_splay_traverse_start(&small);
+			nosmall = 0;
+			for (tentry = ipc_tree_traverse_start(&space->is_tree);
 			     tentry != ITE_NULL;
-			     tentry = ipc_splay_traverse_next(&small, FALSE)) {
-				mach_port_index_t nindex;
-
-				nindex = MACH_PORT_INDEX(tentry->ite_name);
+			     tentry = ipc_tree_traverse_next(&space->is_tree,
+							     FALSE)) {
+				index = MACH_PORT_INDEX(tentry->ite_name);
 
-				if (nindex != index) {
+				if ((size <= index) && (index < nsize) &&
+				    (ipc_tree_lookup_index(&space->is_tree,
+							   index) == tentry))
 					nosmall++;
-					index = nindex;
-				}
 			}
-			ipc_splay_traverse_finish(&small);
+			ipc_tree_traverse_finish(&space->is_tree);
 
 			assert(nosmall <= (nsize - size));
 			assert(nosmall <= space->is_tree_total);
 			space->is_tree_small = nosmall;
-
-			/* put the splay tree back together */
-
-			ipc_splay_tree_join(&space->is_tree, &small);
-			ipc_splay_tree_join(&space->is_tree, &move);
-			ipc_splay_tree_join(&space->is_tree, &ignore);
 		}
 
 		/*
@@ -897,7 +954,7 @@ ipc_entry_grow_table(
 
 		/*
 		 *	We might have moved enough entries from
-		 *	the splay tree into the table that
+		 *	the tree into the table that
 		 *	the table can be profitably grown again.
 		 *
 		 *	Note that if size == nsize, then
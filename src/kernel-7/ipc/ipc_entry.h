@@ -93,8 +93,8 @@
  *	Spaces hold capabilities for ipc_object_t's (ports and port sets).
  *	Each ipc_entry_t records a capability.  Most capabilities have
  *	small names, and the entries are elements of a table.
- *	Capabilities can have large names, and a splay tree holds
- *	those entries.  The cutoff point between the table and the tree
+ *	Capabilities can have large names, and a hash table (the
+ *	"tree", for historical reasons) holds those entries.  The cutoff point between the table and the tree
  *	is adjusted dynamically to minimize memory consumption.
  *
  *	The ie_index field of entries in the table implements
@@ -153,8 +153,6 @@ typedef struct ipc_tree_entry {
 	struct ipc_entry ite_entry;
 	mach_port_t ite_name;
 	struct ipc_space *ite_space;
-	struct ipc_tree_entry *ite_lchild;
-	struct ipc_tree_entry *ite_rchild;
 } *ipc_tree_entry_t;
 
 #define	ITE_NULL	((ipc_tree_entry_t) 0)
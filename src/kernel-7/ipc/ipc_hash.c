@@ -197,7 +197,7 @@ ipc_hash_delete(
 }
 
 /*
- *	The global reverse hash table holds splay tree entries.
+ *	The global reverse hash table holds tree entries.
  *	It is a simple open-chaining hash table with singly-linked buckets.
  *	Each bucket is locked separately, with an exclusive lock.
  *	Within each bucket, move-to-front is used.
@@ -230,7 +230,7 @@ ipc_hash_global_bucket_t ipc_hash_global_table;
  *	Routine:	ipc_hash_global_lookup
  *	Purpose:
  *		Converts (space, obj) -> (name, entry).
- *		Looks in the global table, for splay tree entries.
+ *		Looks in the global table, for tree entries.
  *		Returns TRUE if an entry was found.
  *	Conditions:
  *		The space must be locked (read or write) throughout.
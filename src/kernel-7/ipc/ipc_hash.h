@@ -112,7 +112,7 @@ extern void ipc_hash_delete(
 
 /*
  *	For use by functions that know what they're doing:
- *	the global primitives, for splay tree entries,
+ *	the global primitives, for tree entries,
  *	and the local primitives, for table entries.
  */
 
@@ -88,7 +88,7 @@
 #include <kern/zalloc.h>
 #include <ipc/port.h>
 #include <ipc/ipc_entry.h>
-#include <ipc/ipc_splay.h>
+#include <ipc/ipc_tree.h>
 #include <ipc/ipc_object.h>
 #include <ipc/ipc_hash.h>
 #include <ipc/ipc_table.h>
@@ -187,7 +187,7 @@ ipc_space_create(
 	space->is_table_size = new_size;
 	space->is_table_next = initial+1;
 
-	ipc_splay_tree_init(&space->is_tree);
+	ipc_tree_init(&space->is_tree);
 	space->is_tree_total = 0;
 	space->is_tree_small = 0;
 	space->is_tree_hash = 0;
@@ -325,9 +325,9 @@ ipc_space_destroy(
 
 	it_entries_free(space->is_table_next-1, table);
 
-	for (tentry = ipc_splay_traverse_start(&space->is_tree);
+	for (tentry = ipc_tree_traverse_start(&space->is_tree);
 	     tentry != ITE_NULL;
-	     tentry = ipc_splay_traverse_next(&space->is_tree, TRUE)) {
+	     tentry = ipc_tree_traverse_next(&space->is_tree, TRUE)) {
 		mach_port_type_t type = IE_BITS_TYPE(tentry->ite_bits);
 		mach_port_t name = tentry->ite_name;
 
@@ -341,7 +341,8 @@ ipc_space_destroy(
 
 		ipc_right_clean(space, name, &tentry->ite_entry);
 	}
-	ipc_splay_traverse_finish(&space->is_tree);
+	ipc_tree_traverse_finish(&space->is_tree);
+	ipc_tree_destroy(&space->is_tree);
 
 #if	MACH_IPC_COMPAT
 	if (IP_VALID(space->is_notify))
@@ -0,0 +1,590 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.1 (the "License").  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ * 
+ * The Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON- INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+ *	File:	ipc/ipc_tree.c
+ *
+ *	Hash table of the tree entries in a space.
+ */
+
+#include <mach/port.h>
+#include <kern/assert.h>
+#include <kern/macro_help.h>
+#include <ipc/ipc_entry.h>
+#include <ipc/ipc_table.h>
+#include <ipc/ipc_tree.h>
+
+/*
+ *	Names that don't fit in a space's table get an ipc_tree_entry,
+ *	and those used to live in a splay tree.  Splaying made every
+ *	lookup restructure the tree and cost O(log n), which tasks
+ *	holding many rights under names of their own choosing (name
+ *	servers, the window server) paid on every message.  The entries
+ *	keep their name, but they now live in an open-addressed hash
+ *	table with linear probing.  Lookups don't modify it.
+ *
+ *	The hash key is MACH_PORT_INDEX of the name, not the whole name,
+ *	so all entries sharing an index sit on the same probe sequence.
+ *	ipc_entry.c needs to ask "is there another entry with this index"
+ *	and "give me any entry with this index" to maintain collision
+ *	bits, and both are then a single probe.
+ *
+ *	Deleted slots are marked with ITE_DELETED so probe sequences
+ *	stay intact; a deleted slot just before an empty one is cleared
+ *	instead.  The table is kept at most three quarters full, counting
+ *	deleted slots.  When an insertion would pass that, the caller
+ *	allocates new slots (with the space unlocked, so this module
+ *	never allocates or frees memory itself) and installs them.
+ *	The old slots are not copied at once: each insertion moves
+ *	itr_ostep of them, which is enough to empty the old slots before
+ *	the new ones can fill up, so no single operation pays for
+ *	rehashing a large space.  Until then lookups check both sets.
+ *
+ *	The space lock protects the tree; readers never write to it.
+ */
+
+#define	ITE_DELETED	((ipc_tree_entry_t) -1)
+
+#define	ITE_LIVE(ite)	(((ite) != ITE_NULL) && ((ite) != ITE_DELETED))
+
+/* Fibonacci hashing; shift leaves the top log2(size) bits */
+#define	IPC_TREE_HASH(index, shift)					\
+	((ipc_entry_num_t) (((unsigned int) (index) * 2654435769U) >>	\
+			    (shift)))
+
+/*
+ *	Routine:	ipc_tree_probe_name
+ *	Purpose:
+ *		Finds the slot holding a name, in one set of slots.
+ *		Returns a null pointer if the name isn't there.
+ */
+
+static ipc_tree_entry_t *
+ipc_tree_probe_name(
+	ipc_tree_entry_t	*slots,
+	ipc_entry_num_t		size,
+	ipc_entry_num_t		shift,
+	mach_port_t		name)
+{
+	ipc_entry_num_t mask = size - 1;
+	ipc_entry_num_t i;
+	ipc_tree_entry_t tentry;
+
+	if (size == 0)
+		return (ipc_tree_entry_t *) 0;
+
+	for (i = IPC_TREE_HASH(MACH_PORT_INDEX(name), shift);
+	     (tentry = slots[i]) != ITE_NULL;
+	     i = (i + 1) & mask)
+		if ((tentry != ITE_DELETED) && (tentry->ite_name == name))
+			return &slots[i];
+
+	return (ipc_tree_entry_t *) 0;
+}
+
+/*
+ *	Routine:	ipc_tree_probe_index
+ *	Purpose:
+ *		Finds an entry whose name has the given index,
+ *		other than the one named "except", in one set of slots.
+ */
+
+static ipc_tree_entry_t
+ipc_tree_probe_index(
+	ipc_tree_entry_t	*slots,
+	ipc_entry_num_t		size,
+	ipc_entry_num_t		shift,
+	mach_port_index_t	index,
+	mach_port_t		except)
+{
+	ipc_entry_num_t mask = size - 1;
+	ipc_entry_num_t i;
+	ipc_tree_entry_t tentry;
+
+	if (size == 0)
+		return ITE_NULL;
+
+	for (i = IPC_TREE_HASH(index, shift);
+	     (tentry = slots[i]) != ITE_NULL;
+	     i = (i + 1) & mask)
+		if ((tentry != ITE_DELETED) &&
+		    (MACH_PORT_INDEX(tentry->ite_name) == index) &&
+		    (tentry->ite_name != except))
+			return tentry;
+
+	return ITE_NULL;
+}
+
+/*
+ *	Routine:	ipc_tree_place
+ *	Purpose:
+ *		Puts an entry in the first free slot of its probe
+ *		sequence in the current slots.  The entry's name
+ *		must not already be present.
+ */
+
+static void
+ipc_tree_place(
+	ipc_tree_t		tree,
+	ipc_tree_entry_t	entry)
+{
+	ipc_tree_entry_t *slots = tree->itr_slots;
+	ipc_entry_num_t mask = tree->itr_size - 1;
+	ipc_entry_num_t i;
+
+	assert(tree->itr_used < tree->itr_size);
+
+	for (i = IPC_TREE_HASH(MACH_PORT_INDEX(entry->ite_name),
+			       tree->itr_shift);
+	     ITE_LIVE(slots[i]);
+	     i = (i + 1) & mask)
+		continue;
+
+	if (slots[i] == ITE_NULL)
+		tree->itr_used++;
+	slots[i] = entry;
+	tree->itr_count++;
+}
+
+/*
+ *	Routine:	ipc_tree_init
+ *	Purpose:
+ *		Initialize an empty tree.  No slots are allocated
+ *		until the first insertion.
+ */
+
+void
+ipc_tree_init(
+	ipc_tree_t	tree)
+{
+	tree->itr_slots = (ipc_tree_entry_t *) 0;
+	tree->itr_size = 0;
+	tree->itr_shift = 0;
+	tree->itr_count = 0;
+	tree->itr_used = 0;
+
+	tree->itr_oslots = (ipc_tree_entry_t *) 0;
+	tree->itr_osize = 0;
+	tree->itr_oshift = 0;
+	tree->itr_ocount = 0;
+	tree->itr_omove = 0;
+	tree->itr_ostep = 0;
+
+	tree->itr_fslots = (ipc_tree_entry_t *) 0;
+	tree->itr_fsize = 0;
+
+	tree->itr_cursor = 0;
+}
+
+/*
+ *	Routine:	ipc_tree_destroy
+ *	Purpose:
+ *		Frees the slots of a tree with no entries left.
+ *	Conditions:
+ *		Nothing locked; uses the VM system.
+ */
+
+void
+ipc_tree_destroy(
+	ipc_tree_t	tree)
+{
+	assert(tree->itr_count == 0);
+	assert(tree->itr_ocount == 0);
+
+	if (tree->itr_slots != (ipc_tree_entry_t *) 0)
+		ipc_tree_slots_free(tree->itr_slots, tree->itr_size);
+	if (tree->itr_oslots != (ipc_tree_entry_t *) 0)
+		ipc_tree_slots_free(tree->itr_oslots, tree->itr_osize);
+	if (tree->itr_fslots != (ipc_tree_entry_t *) 0)
+		ipc_tree_slots_free(tree->itr_fslots, tree->itr_fsize);
+
+	ipc_tree_init(tree);
+}
+
+/*
+ *	Routine:	ipc_tree_lookup
+ *	Purpose:
+ *		Finds an entry, given its name.
+ */
+
+ipc_tree_entry_t
+ipc_tree_lookup(
+	ipc_tree_t	tree,
+	mach_port_t	name)
+{
+	ipc_tree_entry_t *slot;
+
+	slot = ipc_tree_probe_name(tree->itr_slots, tree->itr_size,
+				   tree->itr_shift, name);
+	if (slot == (ipc_tree_entry_t *) 0)
+		slot = ipc_tree_probe_name(tree->itr_oslots, tree->itr_osize,
+					   tree->itr_oshift, name);
+
+	return (slot == (ipc_tree_entry_t *) 0) ? ITE_NULL : *slot;
+}
+
+/*
+ *	Routine:	ipc_tree_lookup_index
+ *	Purpose:
+ *		Finds an entry whose name has the given index.
+ *		If there are several, the same one is returned
+ *		until the tree changes.
+ */
+
+ipc_tree_entry_t
+ipc_tree_lookup_index(
+	ipc_tree_t		tree,
+	mach_port_index_t	index)
+{
+	ipc_tree_entry_t tentry;
+
+	tentry = ipc_tree_probe_index(tree->itr_slots, tree->itr_size,
+				      tree->itr_shift, index, MACH_PORT_NULL);
+	if (tentry == ITE_NULL)
+		tentry = ipc_tree_probe_index(tree->itr_oslots,
+					      tree->itr_osize,
+					      tree->itr_oshift,
+					      index, MACH_PORT_NULL);
+	return tentry;
+}
+
+/*
+ *	Routine:	ipc_tree_collision
+ *	Purpose:
+ *		Returns TRUE if the tree holds a name, other than
+ *		"name" itself, with the same index as "name".
+ */
+
+boolean_t
+ipc_tree_collision(
+	ipc_tree_t	tree,
+	mach_port_t	name)
+{
+	mach_port_index_t index = MACH_PORT_INDEX(name);
+
+	return ((ipc_tree_probe_index(tree->itr_slots, tree->itr_size,
+				      tree->itr_shift, index, name)
+							!= ITE_NULL) ||
+		(ipc_tree_probe_index(tree->itr_oslots, tree->itr_osize,
+				      tree->itr_oshift, index, name)
+							!= ITE_NULL));
+}
+
+/*
+ *	Routine:	ipc_tree_insert
+ *	Purpose:
+ *		Inserts a new entry into the tree, and does a step
+ *		of any rehashing in progress.  The name must not
+ *		already be present, and the tree must not be full.
+ */
+
+void
+ipc_tree_insert(
+	ipc_tree_t		tree,
+	mach_port_t		name,
+	ipc_tree_entry_t	entry)
+{
+	assert(!ipc_tree_full(tree));
+	assert(ipc_tree_lookup(tree, name) == ITE_NULL);
+
+	if (tree->itr_oslots != (ipc_tree_entry_t *) 0)
+		ipc_tree_rehash(tree, tree->itr_ostep);
+
+	entry->ite_name = name;
+	ipc_tree_place(tree, entry);
+}
+
+/*
+ *	Routine:	ipc_tree_delete
+ *	Purpose:
+ *		Deletes an entry from the tree.
+ *		The name must be present in the tree.
+ *		Frees the entry.
+ */
+
+void
+ipc_tree_delete(
+	ipc_tree_t		tree,
+	mach_port_t		name,
+	ipc_tree_entry_t	entry)
+{
+	ipc_tree_entry_t *slot;
+
+	slot = ipc_tree_probe_name(tree->itr_slots, tree->itr_size,
+				   tree->itr_shift, name);
+	if (slot != (ipc_tree_entry_t *) 0) {
+		ipc_entry_num_t next;
+
+		assert(*slot == entry);
+		assert(tree->itr_count > 0);
+		tree->itr_count--;
+
+		/*
+		 *	If the probe sequence ends right after this
+		 *	slot, nothing can be behind it and the slot
+		 *	can simply be emptied.
+		 */
+
+		next = ((slot - tree->itr_slots) + 1) & (tree->itr_size - 1);
+		if (tree->itr_slots[next] == ITE_NULL) {
+			*slot = ITE_NULL;
+			tree->itr_used--;
+		} else
+			*slot = ITE_DELETED;
+	} else {
+		slot = ipc_tree_probe_name(tree->itr_oslots, tree->itr_osize,
+					   tree->itr_oshift, name);
+		assert(slot != (ipc_tree_entry_t *) 0);
+		assert(*slot == entry);
+		assert(tree->itr_ocount > 0);
+		tree->itr_ocount--;
+		*slot = ITE_DELETED;
+	}
+
+	ite_free(entry);
+}
+
+/*
+ *	Routine:	ipc_tree_grow_size
+ *	Purpose:
+ *		Returns the number of slots to use once the tree
+ *		is full: at least twice the live entries, so that
+ *		half the new slots are free.  When the tree is full
+ *		of deleted slots this may be its current size.
+ */
+
+ipc_entry_num_t
+ipc_tree_grow_size(
+	ipc_tree_t	tree)
+{
+	ipc_entry_num_t live = tree->itr_count + tree->itr_ocount;
+	ipc_entry_num_t size;
+
+	for (size = IPC_TREE_MIN_SIZE; size < 2 * (live + 1); size <<= 1)
+		continue;
+	return size;
+}
+
+/*
+ *	Routine:	ipc_tree_slots_alloc
+ *	Routine:	ipc_tree_slots_free
+ *	Purpose:
+ *		Allocate zeroed slots, and free them.
+ *	Conditions:
+ *		Nothing locked; these use the VM system.
+ */
+
+ipc_tree_entry_t *
+ipc_tree_slots_alloc(
+	ipc_entry_num_t	size)
+{
+	ipc_tree_entry_t *slots;
+
+	slots = (ipc_tree_entry_t *)
+		ipc_table_alloc(size * sizeof(ipc_tree_entry_t));
+	if (slots != (ipc_tree_entry_t *) 0)
+		bzero((char *) slots, size * sizeof(ipc_tree_entry_t));
+	return slots;
+}
+
+void
+ipc_tree_slots_free(
+	ipc_tree_entry_t	*slots,
+	ipc_entry_num_t		size)
+{
+	ipc_table_free(size * sizeof(ipc_tree_entry_t), (vm_offset_t) slots);
+}
+
+/*
+ *	Routine:	ipc_tree_install
+ *	Purpose:
+ *		Makes new, zeroed slots current.  Entries in the
+ *		previous slots are moved over by later insertions.
+ *		If the previous slots were empty, they go straight
+ *		to itr_fslots for the caller to free.
+ *	Conditions:
+ *		No rehash in progress, and nothing waiting to be freed.
+ */
+
+void
+ipc_tree_install(
+	ipc_tree_t		tree,
+	ipc_tree_entry_t	*slots,
+	ipc_entry_num_t		size)
+{
+	ipc_entry_num_t shift, room;
+
+	assert(tree->itr_oslots == (ipc_tree_entry_t *) 0);
+	assert(tree->itr_fslots == (ipc_tree_entry_t *) 0);
+	assert(size >= 2 * (tree->itr_count + 1));
+	assert((size & (size - 1)) == 0);
+
+	for (shift = 32; (1U << (32 - shift)) < size; shift--)
+		continue;
+
+	if (tree->itr_count > 0) {
+		/*
+		 *	Move enough old slots per insertion that they
+		 *	are all gone before the new slots fill up.
+		 */
+
+		room = (size * 3) / 4 - tree->itr_count - 1;
+		assert(room > 0);
+
+		tree->itr_oslots = tree->itr_slots;
+		tree->itr_osize = tree->itr_size;
+		tree->itr_oshift = tree->itr_shift;
+		tree->itr_ocount = tree->itr_count;
+		tree->itr_omove = 0;
+		tree->itr_ostep = (tree->itr_osize + room - 1) / room;
+	} else if (tree->itr_slots != (ipc_tree_entry_t *) 0) {
+		tree->itr_fslots = tree->itr_slots;
+		tree->itr_fsize = tree->itr_size;
+	}
+
+	tree->itr_slots = slots;
+	tree->itr_size = size;
+	tree->itr_shift = shift;
+	tree->itr_count = 0;
+	tree->itr_used = 0;
+}
+
+/*
+ *	Routine:	ipc_tree_rehash
+ *	Purpose:
+ *		Moves the entries in the next "count" old slots
+ *		to the current slots.  Once the old slots are
+ *		empty, they go to itr_fslots for the caller to free.
+ */
+
+void
+ipc_tree_rehash(
+	ipc_tree_t	tree,
+	ipc_entry_num_t	count)
+{
+	ipc_tree_entry_t *oslots = tree->itr_oslots;
+	ipc_tree_entry_t tentry;
+
+	assert(oslots != (ipc_tree_entry_t *) 0);
+
+	while ((count-- > 0) && (tree->itr_ocount > 0) &&
+	       (tree->itr_omove < tree->itr_osize)) {
+		tentry = oslots[tree->itr_omove];
+		if (ITE_LIVE(tentry)) {
+			/* keep old probe sequences intact */
+			oslots[tree->itr_omove] = ITE_DELETED;
+			tree->itr_ocount--;
+			ipc_tree_place(tree, tentry);
+		}
+		tree->itr_omove++;
+	}
+
+	if ((tree->itr_ocount == 0) || (tree->itr_omove == tree->itr_osize)) {
+		assert(tree->itr_ocount == 0);
+		assert(tree->itr_fslots == (ipc_tree_entry_t *) 0);
+
+		tree->itr_fslots = oslots;
+		tree->itr_fsize = tree->itr_osize;
+		tree->itr_oslots = (ipc_tree_entry_t *) 0;
+		tree->itr_osize = 0;
+		tree->itr_oshift = 0;
+		tree->itr_omove = 0;
+		tree->itr_ostep = 0;
+	}
+}
+
+/*
+ *	Routine:	ipc_tree_traverse_start
+ *	Routine:	ipc_tree_traverse_next
+ *	Routine:	ipc_tree_traverse_finish
+ *	Purpose:
+ *		Visit every entry in the tree, in no particular order.
+ *	Usage:
+ *		for (entry = ipc_tree_traverse_start(tree);
+ *		     entry != ITE_NULL;
+ *		     entry = ipc_tree_traverse_next(tree, delete)) {
+ *			do something with entry
+ *		}
+ *		ipc_tree_traverse_finish(tree);
+ *
+ *		If "delete" is TRUE, then the current entry
+ *		is removed from the tree and deallocated.
+ *		Nothing may be inserted during the traversal.
+ */
+
+static ipc_tree_entry_t
+ipc_tree_traverse_scan(
+	ipc_tree_t	tree)
+{
+	ipc_tree_entry_t tentry;
+
+	for (; tree->itr_cursor < tree->itr_osize + tree->itr_size;
+	     tree->itr_cursor++) {
+		if (tree->itr_cursor < tree->itr_osize)
+			tentry = tree->itr_oslots[tree->itr_cursor];
+		else
+			tentry = tree->itr_slots[tree->itr_cursor -
+						 tree->itr_osize];
+		if (ITE_LIVE(tentry))
+			return tentry;
+	}
+
+	return ITE_NULL;
+}
+
+ipc_tree_entry_t
+ipc_tree_traverse_start(
+	ipc_tree_t	tree)
+{
+	tree->itr_cursor = 0;
+	return ipc_tree_traverse_scan(tree);
+}
+
+ipc_tree_entry_t
+ipc_tree_traverse_next(
+	ipc_tree_t	tree,
+	boolean_t	delete)
+{
+	ipc_tree_entry_t tentry;
+
+	if (delete) {
+		if (tree->itr_cursor < tree->itr_osize)
+			tentry = tree->itr_oslots[tree->itr_cursor];
+		else
+			tentry = tree->itr_slots[tree->itr_cursor -
+						 tree->itr_osize];
+		assert(ITE_LIVE(tentry));
+		ipc_tree_delete(tree, tentry->ite_name, tentry);
+	}
+
+	tree->itr_cursor++;
+	return ipc_tree_traverse_scan(tree);
+}
+
+void
+ipc_tree_traverse_finish(
+	ipc_tree_t	tree)
+{
+	tree->itr_cursor = 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 1999 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * Portions Copyright (c) 1999 Apple Computer, Inc.  All Rights
+ * Reserved.  This file contains Original Code and/or Modifications of
+ * Original Code as defined in and that are subject to the Apple Public
+ * Source License Version 1.1 (the "License").  You may not use this file
+ * except in compliance with the License.  Please obtain a copy of the
+ * License at http://www.apple.com/publicsource and read it before using
+ * this file.
+ * 
+ * The Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON- INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+ *	File:	ipc/ipc_tree.h
+ *
+ *	Declarations of the hash table holding a space's tree entries,
+ *	the entries whose names don't fit in the space's table.
+ */
+
+#ifndef	_IPC_IPC_TREE_H_
+#define _IPC_IPC_TREE_H_
+
+#include <mach/port.h>
+#include <kern/assert.h>
+#include <kern/macro_help.h>
+#include <ipc/ipc_entry.h>
+
+/*
+ *	An open-addressed hash of tree entries, keyed on the index
+ *	of the entry's name.  itr_slots is the current set of slots;
+ *	while it is being resized, itr_oslots holds the previous set,
+ *	whose entries are moved over a few at a time by insertions.
+ *	A set of slots drained that way is left on itr_fslots, because
+ *	it can only be freed with the space unlocked.
+ */
+
+typedef struct ipc_tree {
+	ipc_tree_entry_t *itr_slots;	/* current slots */
+	ipc_entry_num_t itr_size;	/* number of slots, a power of 2 */
+	ipc_entry_num_t itr_shift;	/* 32 - log2(itr_size) */
+	ipc_entry_num_t itr_count;	/* live entries in itr_slots */
+	ipc_entry_num_t itr_used;	/* live and deleted slots */
+
+	ipc_tree_entry_t *itr_oslots;	/* slots being rehashed */
+	ipc_entry_num_t itr_osize;
+	ipc_entry_num_t itr_oshift;
+	ipc_entry_num_t itr_ocount;	/* live entries in itr_oslots */
+	ipc_entry_num_t itr_omove;	/* next old slot to move */
+	ipc_entry_num_t itr_ostep;	/* old slots moved per insert */
+
+	ipc_tree_entry_t *itr_fslots;	/* drained slots, to be freed */
+	ipc_entry_num_t itr_fsize;
+
+	ipc_entry_num_t itr_cursor;	/* traversal position */
+} *ipc_tree_t;
+
+#define	IPC_TREE_MIN_SIZE	16
+
+/*
+ *	True if an insertion needs more slots than the tree has;
+ *	the tree stays at most three quarters full.
+ */
+#define	ipc_tree_full(tree)						\
+	((((tree)->itr_used + 1) * 4) > ((tree)->itr_size * 3))
+
+/* Initialize an empty tree */
+extern void ipc_tree_init(
+	ipc_tree_t		tree);
+
+/* Free the tree's slots; the entries must be gone */
+extern void ipc_tree_destroy(
+	ipc_tree_t		tree);
+
+/* Find an entry, given its name */
+extern ipc_tree_entry_t ipc_tree_lookup(
+	ipc_tree_t		tree,
+	mach_port_t		name);
+
+/* Find some entry whose name has the given index */
+extern ipc_tree_entry_t ipc_tree_lookup_index(
+	ipc_tree_t		tree,
+	mach_port_index_t	index);
+
+/* Check for another entry whose name has the same index */
+extern boolean_t ipc_tree_collision(
+	ipc_tree_t		tree,
+	mach_port_t		name);
+
+/* Insert a new entry; the tree must not be full */
+extern void ipc_tree_insert(
+	ipc_tree_t		tree,
+	mach_port_t		name,
+	ipc_tree_entry_t	entry);
+
+/* Delete an entry from the tree, and free it */
+extern void ipc_tree_delete(
+	ipc_tree_t		tree,
+	mach_port_t		name,
+	ipc_tree_entry_t	entry);
+
+/* Size of the slots a full tree should grow to */
+extern ipc_entry_num_t ipc_tree_grow_size(
+	ipc_tree_t		tree);
+
+/* Allocate slots for a tree */
+extern ipc_tree_entry_t *ipc_tree_slots_alloc(
+	ipc_entry_num_t		size);
+
+/* Free slots */
+extern void ipc_tree_slots_free(
+	ipc_tree_entry_t	*slots,
+	ipc_entry_num_t		size);
+
+/* Start using new slots, rehashing the old ones incrementally */
+extern void ipc_tree_install(
+	ipc_tree_t		tree,
+	ipc_tree_entry_t	*slots,
+	ipc_entry_num_t		size);
+
+/* Move entries from the old slots to the current ones */
+extern void ipc_tree_rehash(
+	ipc_tree_t		tree,
+	ipc_entry_num_t		count);
+
+/* Start a traversal of the tree */
+extern ipc_tree_entry_t ipc_tree_traverse_start(
+	ipc_tree_t		tree);
+
+/* Return the next entry in a traversal of the tree */
+extern ipc_tree_entry_t ipc_tree_traverse_next(
+	ipc_tree_t		tree,
+	boolean_t		delete);
+
+/* Terminate a traversal of the tree */
+extern void ipc_tree_traverse_finish(
+	ipc_tree_t		tree);
+
+#endif	/* _IPC_IPC_TREE_H_ */
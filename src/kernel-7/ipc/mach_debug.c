@@ -461,9 +461,9 @@ mach_port_space_info(
 		iin->iin_hash = entry->ie_index;
 	}
 
-	for (tentry = ipc_splay_traverse_start(&space->is_tree), index = 0;
+	for (tentry = ipc_tree_traverse_start(&space->is_tree), index = 0;
 	     tentry != ITE_NULL;
-	     tentry = ipc_splay_traverse_next(&space->is_tree, FALSE)) {
+	     tentry = ipc_tree_traverse_next(&space->is_tree, FALSE)) {
 		ipc_info_tree_name_t *iitn = &tree_info[index++];
 		ipc_info_name_t *iin = &iitn->iitn_name;
 		ipc_entry_t entry = &tentry->ite_entry;
@@ -485,18 +485,11 @@ mach_port_space_info(
 		iin->iin_next = entry->ie_next;
 		iin->iin_hash = entry->ie_index;
 
-		if (tentry->ite_lchild == ITE_NULL)
-			iitn->iitn_lchild = MACH_PORT_NULL;
-		else
-			iitn->iitn_lchild = tentry->ite_lchild->ite_name;
-
-		if (tentry->ite_rchild == ITE_NULL)
-			iitn->iitn_rchild = MACH_PORT_NULL;
-		else
-			iitn->iitn_rchild = tentry->ite_rchild->ite_name;
-
+		/* the tree entries are hashed; there are no children */
+		iitn->iitn_lchild = MACH_PORT_NULL;
+		iitn->iitn_rchild = MACH_PORT_NULL;
 	}
-	ipc_splay_traverse_finish(&space->is_tree);
+	ipc_tree_traverse_finish(&space->is_tree);
 	is_read_unlock(space);
 
 	if (table_info == *tablep) {
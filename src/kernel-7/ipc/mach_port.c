@@ -324,9 +324,9 @@ mach_port_names(
 		}
 	}
 
-	for (tentry = ipc_splay_traverse_start(&space->is_tree);
+	for (tentry = ipc_tree_traverse_start(&space->is_tree);
 	     tentry != ITE_NULL;
-	     tentry = ipc_splay_traverse_next(&space->is_tree, FALSE)) {
+	     tentry = ipc_tree_traverse_next(&space->is_tree, FALSE)) {
 		ipc_entry_t entry = &tentry->ite_entry;
 		mach_port_t name = tentry->ite_name;
 
@@ -336,7 +336,7 @@ mach_port_names(
 		mach_port_names_helper(timestamp, entry, name,
 				       names, types, &actual);
 	}
-	ipc_splay_traverse_finish(&space->is_tree);
+	ipc_tree_traverse_finish(&space->is_tree);
 	is_read_unlock(space);
 
 	if (actual == 0) {
@@ -1090,9 +1090,9 @@ mach_port_get_set_status(
 			}
 		}
 
-		for (tentry = ipc_splay_traverse_start(&space->is_tree);
+		for (tentry = ipc_tree_traverse_start(&space->is_tree);
 		     tentry != ITE_NULL;
-		     tentry = ipc_splay_traverse_next(&space->is_tree,
+		     tentry = ipc_tree_traverse_next(&space->is_tree,
 			FALSE)) {
 			ipc_entry_bits_t bits = tentry->ite_bits;
 
@@ -1108,7 +1108,7 @@ mach_port_get_set_status(
 						     names, &actual);
 			}
 		}
-		ipc_splay_traverse_finish(&space->is_tree);
+		ipc_tree_traverse_finish(&space->is_tree);
 		is_read_unlock(space);
 
 		if (actual <= maxnames)
@@ -87,10 +87,9 @@
  *	mach_port_t must be an unsigned type.  Port values
  *	have two parts, a generation number and an index.
  *	These macros encapsulate all knowledge of how
- *	a mach_port_t is layed out.  However, ipc/ipc_entry.c
- *	implicitly assumes when it uses the splay tree functions
- *	that the generation number is in the low bits, so that
- *	names are ordered first by index and then by generation.
+ *	a mach_port_t is layed out.  ipc/ipc_tree.c hashes tree
+ *	entries on MACH_PORT_INDEX alone, so that names with the
+ *	same index share a probe sequence.
  *
  *	If the size of generation numbers changes,
  *	be sure to update IE_BITS_GEN_MASK and friends
@@ -204,6 +204,18 @@ ast_check()
 			break;
 		}
 
+#if	NCPUS > 1
+		/*
+		 *	Unbound threads queued on this processor compete
+		 *	on priority, like those on the processor_set runq.
+		 */
+		if (runq_csw_needed(&myprocessor->affinity_runq,
+				    thread, myprocessor)) {
+			ast_on(mycpu, AST_BLOCK);
+			break;
+		}
+#endif	/* NCPUS > 1 */
+
 		/*
 		 *	Update lazy evaluated runq->low if only timesharing.
 		 */
@@ -213,6 +213,63 @@ kern_return_t	host_info(host, flavor, info, count)
 		return(KERN_SUCCESS);
 	    }
 
+	case HOST_SCHED_CPU_INFO: {
+		register host_sched_cpu_info_t	cpu_info;
+		register processor_t		processor;
+
+		/*
+		 *	Per-processor scheduler counters, one entry per
+		 *	slot with a cpu in it.  Read without locks.
+		 */
+		if (*count < NCPUS * HOST_SCHED_CPU_INFO_COUNT)
+			return(KERN_FAILURE);
+
+		cpu_info = (host_sched_cpu_info_t) info;
+		*count = 0;
+		for (i = 0; i < NCPUS; i++) {
+			if (!machine_slot[i].is_cpu)
+				continue;
+			processor = cpu_to_processor(i);
+			cpu_info->slot_num = i;
+			cpu_info->state = processor->state;
+			cpu_info->context_switches = processor->csw_count;
+			cpu_info->steals = processor->steal_count;
+			cpu_info->migrations = processor->migrate_count;
+			cpu_info->queue_depth = processor->runq.count;
+#if	NCPUS > 1
+			cpu_info->queue_depth +=
+				processor->affinity_runq.count;
+#endif	/* NCPUS > 1 */
+			cpu_info++;
+			*count += HOST_SCHED_CPU_INFO_COUNT;
+		}
+		return(KERN_SUCCESS);
+	    }
+
+	case HOST_VM_PAGEOUT_INFO: {
+		extern void vm_pageout_info(host_vm_pageout_info_t);
+
+		if (*count < HOST_VM_PAGEOUT_INFO_COUNT)
+			return(KERN_FAILURE);
+
+		vm_pageout_info((host_vm_pageout_info_t) info);
+
+		*count = HOST_VM_PAGEOUT_INFO_COUNT;
+		return(KERN_SUCCESS);
+	    }
+
+	case HOST_VM_FAULT_INFO: {
+		extern host_vm_fault_info_data_t vm_fault_stat;
+
+		if (*count < HOST_VM_FAULT_INFO_COUNT)
+			return(KERN_FAILURE);
+
+		*(host_vm_fault_info_t) info = vm_fault_stat;
+
+		*count = HOST_VM_FAULT_INFO_COUNT;
+		return(KERN_SUCCESS);
+	    }
+
 	default:
 		return(KERN_INVALID_ARGUMENT);
 	}
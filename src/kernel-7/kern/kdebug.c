@@ -23,6 +23,7 @@
  */
 
 #import <kern/lock.h>
+#import <kern/cpu_number.h>
 #import <bsd/machine/cpu.h>
 #import <vm/vm_kern.h>
 #import <machine/spl.h>
@@ -35,13 +36,64 @@
 #import <bsd/sys/proc.h>
 #import <bsd/sys/vm.h>
 #import <bsd/sys/sysctl.h>
+#import <bsd/sys/systm.h>
+#import <bsd/sys/kernel.h>
+#import <bsd/sys/uio.h>
+#import <bsd/sys/vnode.h>		/* for IO_NDELAY */
+
+/*
+ * The trace buffer is split into one ring per processor.  Each
+ * ring is written only by kernel_debug() on its own processor, at
+ * splhigh, so producers share nothing and take no locks.  Head and
+ * tail are free running event counts; the ring index is the count
+ * masked by kd_cpumask.  Only the producer moves kdc_head, and only
+ * the reader moves kdc_tail.
+ *
+ * Readers merge the rings by timestamp.  In the default mode a full
+ * ring overwrites its oldest events and the reader skips whatever it
+ * was lapped on.  In KDBG_NOWRAP mode logging stops when any ring
+ * fills.  In KDBG_STREAM mode, used by /dev/kdebug, a full ring drops
+ * new events instead, and the reader reports each run of drops with
+ * a KDBG_LOSTEVENTS record, so a collector that keeps up never loses
+ * anything to wraparound.
+ *
+ * The producer notes a wrap in its own kdc_wrapped rather than
+ * in kdebug_flags, which other processors update from sysctl;
+ * KERN_KDGETBUF folds the rings' flags into KDBG_WRAPPED.
+ */
+struct kd_cpubuf {
+	kd_buf		*kdc_buffer;	/* this processor's ring */
+	volatile unsigned int
+			kdc_head;	/* events written */
+	volatile unsigned int
+			kdc_tail;	/* events consumed */
+	volatile unsigned int
+			kdc_dropped;	/* events dropped, by producer */
+	unsigned int	kdc_reported;	/* drops reported, by reader */
+	unsigned int	kdc_lapped;	/* events overwritten unread */
+	volatile unsigned int
+			kdc_wrapped;	/* ring has wrapped, by producer */
+} kd_cpubuf[NCPUS];
+
+unsigned int kd_cpusize;		/* events per ring */
+unsigned int kd_cpumask;		/* kd_cpusize - 1 */
+
+#define KDC_EVENT(kdc, n)	(&(kdc)->kdc_buffer[(n) & kd_cpumask])
+
+/*
+ * Readers copy events into a staging buffer and copy
+ * them out from there, so user faults never happen with
+ * a ring in an inconsistent state.
+ */
+#define KDBG_READCHUNK	256
+kd_buf * kd_readbuf = 0;
+tvalspec_t kd_lasttime;			/* timestamp of last event read */
+int kd_readbusy = 0;			/* a reader is merging */
+int kd_devopen = 0;			/* /dev/kdebug is open */
+int kd_streamticks = 0;			/* stream reader poll interval */
 
-/* kd_buf kd_buffer[kd_bufsize/sizeof(kd_buf)]; */
-kd_buf * kd_bufptr;
 unsigned int kd_buftomem=0;
 kd_buf * kd_buffer=0;
-kd_buf * kd_buflast;
-kd_buf * kd_readlast;
 unsigned int nkdbufs = 8192;
 unsigned int kd_bufsize = 0;
 unsigned int kdebug_flags = 0;
@@ -78,13 +130,32 @@ void
 kernel_debug(debugid, arg1, arg2, arg3, arg4, arg5)
 unsigned int debugid, arg1, arg2, arg3, arg4, arg5;
 {
+	struct kd_cpubuf * kdc;
 	kd_buf * kd;
+	unsigned int head;
+	int s;
 
 	if (kdebug_nolog ||
 	    ((kdebug_flags & KDBG_RANGECHECK) &&
 	     ((debugid < kdlog_beg) ||(debugid > kdlog_end))))
 		return;
-	kd = kd_bufptr;
+	s = splhigh();
+	kdc = &kd_cpubuf[cpu_number()];
+	head = kdc->kdc_head;
+	if (head - kdc->kdc_tail >= kd_cpusize) {
+		if (kdebug_flags & KDBG_STREAM) {
+			kdc->kdc_dropped++;
+			splx(s);
+			return;
+		}
+		if (kdebug_flags & KDBG_NOWRAP) {
+			kdebug_nolog = 1;
+			splx(s);
+			return;
+		}
+		kdc->kdc_wrapped = 1;
+	}
+	kd = KDC_EVENT(kdc, head);
 	kd->debugid= debugid;
 	kd->arg1 = arg1;
 	kd->arg2 = arg2;
@@ -92,31 +163,48 @@ unsigned int debugid, arg1, arg2, arg3, arg4, arg5;
 	kd->arg4 = arg4;
 	kd->arg5 = (unsigned int)current_thread();
 	kd->timestamp = get_timebase();
-	kd_bufptr++;
-	if(kdebug_flags & KDBG_NOWRAP) {
-		if (kd_bufptr >= kd_buflast)
-			kdebug_nolog = 1 ;
-	} else {
-		if ( kd_bufptr >= kd_buflast)
-		{	kd_bufptr =  kd_buffer;
-			kdebug_flags |= KDBG_WRAPPED;
-		}
-	}
+	kdc->kdc_head = head + 1;
+	splx(s);
 }
 
 
 kdbg_bootstrap()
 {
-	kd_bufsize = nkdbufs * sizeof(kd_buf);
+	vm_offset_t readmem;
+	int cpu;
+
+	/*
+	 * Each processor gets an equal, power of two,
+	 * share of the nkdbufs events asked for.
+	 */
+	for (kd_cpusize = 1; kd_cpusize * 2 * NCPUS <= nkdbufs; )
+		kd_cpusize *= 2;
+	kd_cpumask = kd_cpusize - 1;
+	kd_bufsize = kd_cpusize * NCPUS * sizeof(kd_buf);
 	if (kmem_alloc(kernel_map, &kd_buftomem ,(vm_size_t)kd_bufsize) == KERN_SUCCESS) 
 	kd_buffer = (kd_buf *) kd_buftomem;
 	else kd_buffer= (kd_buf *) 0;
-	kdebug_flags &= ~KDBG_WRAPPED;
+	if (kd_buffer && kd_readbuf == 0) {
+		if (kmem_alloc(kernel_map, &readmem,
+		    (vm_size_t)(KDBG_READCHUNK * sizeof(kd_buf))) == KERN_SUCCESS)
+			kd_readbuf = (kd_buf *) readmem;
+		else {
+			kmem_free(kernel_map, kd_buftomem, kd_bufsize);
+			kd_buffer = (kd_buf *) 0;
+		}
+	}
 	if (kd_buffer) {
 		kdebug_flags |= (KDBG_INIT | KDBG_BUFINIT);
-		kd_bufptr = kd_buffer;
-		kd_buflast = &kd_bufptr[nkdbufs];
-		kd_readlast = kd_bufptr;
+		for (cpu = 0; cpu < NCPUS; cpu++) {
+			kd_cpubuf[cpu].kdc_buffer = &kd_buffer[cpu * kd_cpusize];
+			kd_cpubuf[cpu].kdc_head = kd_cpubuf[cpu].kdc_tail = 0;
+			kd_cpubuf[cpu].kdc_dropped = 0;
+			kd_cpubuf[cpu].kdc_reported = 0;
+			kd_cpubuf[cpu].kdc_lapped = 0;
+			kd_cpubuf[cpu].kdc_wrapped = 0;
+		}
+		kd_lasttime.tv_sec = 0;
+		kd_lasttime.tv_nsec = 0;
 		return(0);
 	} else {
 		kd_bufsize=0;
@@ -130,6 +218,8 @@ kdbg_reinit()
 {
 int x;
 int ret=0;
+	if (kd_readbusy)
+		return(EBUSY);
 	x= splhigh();
 	if ((kdebug_flags & KDBG_INIT) && (kdebug_flags & KDBG_BUFINIT) && kd_bufsize && kd_buffer)
 		kmem_free(kernel_map,kd_buffer,kd_bufsize);
@@ -141,14 +231,18 @@ int ret=0;
 kdbg_clear()
 {
 int x;
+	if (kd_readbusy)
+		return(EBUSY);
 	x=splhigh();
 	kdebug_flags &= ~KDBG_BUFINIT;
+	kdebug_enable = 0;
+	kdebug_nolog = 1;
 	kmem_free(kernel_map,kd_buffer,kd_bufsize);
 	kd_buffer = (kd_buf *)0;
 	kd_bufsize = 0;
-	kdebug_enable = 0;
-	kdebug_nolog = 1;
 	splx(x);
+	wakeup((caddr_t)kd_cpubuf);
+	return(0);
 }
 
 kdbg_setreg(kd_regtype * kdr)
@@ -245,6 +339,7 @@ int size=*sizep;
 unsigned int value = name[1];
 kd_regtype kd_Reg;
 int kd_val[3];
+int cpu;
 
 	switch(name[0]) {
 		case KERN_KDEFLAGS:
@@ -271,7 +366,10 @@ int kd_val[3];
 		  }
 		  kd_val[0] = nkdbufs;
 		  kd_val[1] = kdebug_nolog;
-		  kd_val[2] = kdebug_flags;
+		  kd_val[2] = kdebug_flags & ~KDBG_WRAPPED;
+		  for (cpu = 0; cpu < NCPUS; cpu++)
+			if (kd_cpubuf[cpu].kdc_wrapped)
+				kd_val[2] |= KDBG_WRAPPED;
 		  if(copyout (&kd_val, where, sizeof(kd_val))) {
 		    ret=EINVAL;
 		  }
@@ -280,7 +378,7 @@ int kd_val[3];
 			ret=kdbg_reinit();
 			break;
 		case KERN_KDREMOVE:
-			kdbg_clear();
+			ret=kdbg_clear();
 			break;
 		case KERN_KDSETREG:
 			if(size < sizeof(kd_regtype)) {
@@ -313,40 +411,218 @@ int kd_val[3];
 }
 
 
+/*
+ * Move up to max events, oldest first across all processors,
+ * from the rings into buf.  Drops and overwrites found along
+ * the way are reported in place as KDBG_LOSTEVENTS records.
+ * Caller must own kd_readbusy.
+ */
+static int
+kdbg_merge(kd_buf * buf, int max)
+{
+struct kd_cpubuf *kdc, *best;
+unsigned int head, tail, dropped, lost;
+int cpu, count=0;
+
+	while (count < max) {
+		best = 0;
+		for (cpu = 0; cpu < NCPUS && count < max; cpu++) {
+			kdc = &kd_cpubuf[cpu];
+			head = kdc->kdc_head;
+			if (head - kdc->kdc_tail > kd_cpusize) {
+				/* lapped by the producer */
+				kdc->kdc_lapped += head - kdc->kdc_tail - kd_cpusize;
+				kdc->kdc_tail = head - kd_cpusize;
+			}
+			dropped = kdc->kdc_dropped;
+			lost = (dropped - kdc->kdc_reported) + kdc->kdc_lapped;
+			if (lost) {
+				buf[count].debugid = KDBG_LOSTEVENTS;
+				buf[count].arg1 = lost;
+				buf[count].arg2 = cpu;
+				buf[count].arg3 = buf[count].arg4 = 0;
+				buf[count].arg5 = 0;
+				buf[count].timestamp = kd_lasttime;
+				kdc->kdc_reported = dropped;
+				kdc->kdc_lapped = 0;
+				count++;
+				continue;
+			}
+			if (kdc->kdc_tail == head)
+				continue;
+			if (best == 0 ||
+			    CMP_TVALSPEC(&KDC_EVENT(kdc, kdc->kdc_tail)->timestamp,
+				&KDC_EVENT(best, best->kdc_tail)->timestamp) < 0)
+				best = kdc;
+		}
+		/*
+		 * Lost event records may have filled buf
+		 * after best was chosen.
+		 */
+		if (best == 0 || count >= max)
+			break;
+
+		tail = best->kdc_tail;
+		buf[count] = *KDC_EVENT(best, tail);
+		/*
+		 * In wrap mode the producer may have overwritten
+		 * the event while we copied it.  It writes the slot
+		 * before it bumps head, so the copy may be torn as
+		 * soon as the ring is full by the producer's own
+		 * test.  Count it lost rather than pass it on.
+		 */
+		if (best->kdc_head - tail >= kd_cpusize &&
+		    (kdebug_flags & (KDBG_STREAM | KDBG_NOWRAP)) == 0) {
+			best->kdc_lapped++;
+			best->kdc_tail = tail + 1;
+			continue;
+		}
+		best->kdc_tail = tail + 1;
+		kd_lasttime = buf[count].timestamp;
+		count++;
+	}
+	return (count);
+}
+
+/*
+ * Serialise readers, sleeping if need be.
+ */
+static int
+kdbg_readlock(void)
+{
+int error;
+
+	while (kd_readbusy) {
+		kd_readbusy |= 2;
+		if (error = tsleep((caddr_t)&kd_readbusy, PRIBIO|PCATCH,
+		    "kdread", 0))
+			return(error);
+	}
+	kd_readbusy = 1;
+	return(0);
+}
+
+static void
+kdbg_readunlock(void)
+{
+	if (kd_readbusy & 2)
+		wakeup((caddr_t)&kd_readbusy);
+	kd_readbusy = 0;
+}
+
 kdbg_read(kd_buf * buffer, size_t *number)
 {
-int x,i;
-kd_buf *start; 
+int n, count, total=0;
 int ret=0;
 int avail=*number;
-int count=0;
 
 	count = avail/sizeof(kd_buf);
-	if (count) {
-		if ((kdebug_flags & KDBG_BUFINIT) && kd_bufsize && kd_buffer) {
-			if (count > nkdbufs) count = nkdbufs;
-			x= splhigh();
-			if (kdebug_flags & KDBG_WRAPPED)
-			{	kd_readlast = kd_bufptr+1;
-				if (kd_readlast > kd_buflast)
-					kd_readlast = kd_buffer;
-				kdebug_flags &= ~KDBG_WRAPPED;
-			}
-			for (i = 0 ; i < count ; i++ ) {
-				if (kd_readlast == kd_bufptr) break;
-				if(copyout(kd_readlast,buffer,sizeof(kd_buf))) {
-					ret=EINVAL;
-					break;
-				}
-				kd_readlast++;
-				buffer ++;
-				if (kd_readlast >= kd_buflast)
-					kd_readlast = kd_buffer;
-			}
-			splx(x);
-			*number = i;
-		} else ret = EINVAL;
-	} else ret=EINVAL;
+	if (count == 0)
+		return(EINVAL);
+	if (ret = kdbg_readlock())
+		return(ret);
+	while (count > 0) {
+		if (!(kdebug_flags & KDBG_BUFINIT) || kd_bufsize == 0 || kd_buffer == 0) {
+			ret = EINVAL;
+			break;
+		}
+		n = kdbg_merge(kd_readbuf, min(count, KDBG_READCHUNK));
+		if (n == 0)
+			break;
+		if (copyout(kd_readbuf, buffer, n * sizeof(kd_buf))) {
+			ret = EINVAL;
+			break;
+		}
+		buffer += n;
+		total += n;
+		count -= n;
+	}
+	kdbg_readunlock();
+	*number = total;
 
 	return (ret);
 }
+
+/*
+ * /dev/kdebug: a streaming reader.  While it is open the trace
+ * runs in KDBG_STREAM mode, and read() blocks until at least one
+ * event is available, polling every kd_streamticks.  Reads return
+ * whole kd_buf records only.
+ */
+int
+kdbgopen(dev, flag, devtype, p)
+dev_t dev;
+int flag, devtype;
+struct proc *p;
+{
+int error;
+
+	if (error = suser(p->p_ucred, &p->p_acflag))
+		return(error);
+	if (kd_devopen)
+		return(EBUSY);
+	kd_devopen = 1;
+	if (kd_streamticks == 0)
+		kd_streamticks = hz / 10 ? hz / 10 : 1;
+	kdebug_flags |= KDBG_STREAM;
+	return(0);
+}
+
+int
+kdbgclose(dev, flag, devtype, p)
+dev_t dev;
+int flag, devtype;
+struct proc *p;
+{
+	kdebug_flags &= ~KDBG_STREAM;
+	kd_devopen = 0;
+	return(0);
+}
+
+int
+kdbgread(dev, uio, ioflag)
+dev_t dev;
+struct uio *uio;
+int ioflag;
+{
+int n, total=0;
+int error;
+
+	if (uio->uio_resid < sizeof(kd_buf))
+		return(EINVAL);
+	if (error = kdbg_readlock())
+		return(error);
+	while (uio->uio_resid >= sizeof(kd_buf)) {
+		if (!(kdebug_flags & KDBG_BUFINIT) || kd_bufsize == 0 || kd_buffer == 0) {
+			error = total ? 0 : ENXIO;
+			break;
+		}
+		n = kdbg_merge(kd_readbuf,
+			min(uio->uio_resid / sizeof(kd_buf), KDBG_READCHUNK));
+		if (n == 0) {
+			if (total)
+				break;
+			if (ioflag & IO_NDELAY) {
+				error = EWOULDBLOCK;
+				break;
+			}
+			/*
+			 * Let go of the rings while we wait, so the
+			 * trace can be reconfigured or removed.
+			 */
+			kdbg_readunlock();
+			error = tsleep((caddr_t)kd_cpubuf, PRIBIO|PCATCH,
+					"kdebug", kd_streamticks);
+			if (error && error != EWOULDBLOCK)
+				return(error);
+			if (error = kdbg_readlock())
+				return(error);
+			continue;
+		}
+		if (error = uiomove((caddr_t)kd_readbuf, n * sizeof(kd_buf), uio))
+			break;
+		total += n;
+	}
+	kdbg_readunlock();
+	return(error);
+}
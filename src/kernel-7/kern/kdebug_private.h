@@ -47,7 +47,14 @@ unsigned int	debugid;
 #define	KDBG_NOWRAP	2
 #define	KDBG_FREERUN	4
 #define	KDBG_WRAPPED	8
-#define	KDBG_USERFLAGS	(KDBG_FREERUN|KDBG_NOWRAP|KDBG_INIT)
+#define	KDBG_STREAM	0x10	/* drop, don't overwrite, when full */
+#define	KDBG_USERFLAGS	(KDBG_FREERUN|KDBG_NOWRAP|KDBG_INIT|KDBG_STREAM)
+
+/*
+ * Synthetic record inserted by the reader where events were lost:
+ * arg1 is the number of events lost, arg2 the processor.
+ */
+#define	KDBG_LOSTEVENTS	KDBG_CODE(DBG_MISC, 0xff, 0x3fff)
 
 typedef struct {
 	unsigned int	type;
@@ -104,6 +104,9 @@ void compute_mach_factor()
 		while (!queue_end(&pset->processors,
 		    (queue_entry_t)processor)) {
 			nthreads += processor->runq.count;
+#if	NCPUS > 1
+			nthreads += processor->affinity_runq.count;
+#endif	/* NCPUS > 1 */
 			processor =
 			    (processor_t) queue_next(&processor->processors);
 		}
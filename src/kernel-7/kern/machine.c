@@ -486,6 +486,13 @@ register processor_t	processor;
 	thread_bind(this_thread, processor);
 	thread_block_continue((void (*)()) 0);
 
+	/*
+	 *	The processor is no longer PROCESSOR_RUNNING, so no more
+	 *	threads will be queued for it.  Send the ones already
+	 *	waiting elsewhere.
+	 */
+	affinity_runq_drain(processor);
+
 	pset = processor->processor_set;
 #if	MACH_HOST
 	/*
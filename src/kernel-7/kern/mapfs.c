@@ -1863,10 +1863,7 @@ vmp_push_range(vmp, start, size)
 			 *	now (and are holding lots of locks keeping
 			 *	it there).
 			 */
-			queue_remove(&vm_page_queue_inactive, m, vm_page_t,
-				     pageq);
-			m->inactive = FALSE;
-			vm_page_inactive_count--;
+			VM_PAGE_INACTIVE_REMOVE(m);
 			m->busy = TRUE;
 			if (m->laundry) {
 				pager_return_t	ret;
@@ -1984,10 +1981,7 @@ retry:
 			 *	now (and are holding lots of locks keeping
 			 *	it there).
 			 */
-			queue_remove(&vm_page_queue_inactive, m, vm_page_t,
-				     pageq);
-			m->inactive = FALSE;
-			vm_page_inactive_count--;
+			VM_PAGE_INACTIVE_REMOVE(m);
 			m->busy = TRUE;
 			if (m->laundry) {
 				pager_return_t	ret;
@@ -224,6 +224,14 @@ void processor_init(
 	for (i = 0; i < NRQS; i++) {
 	    queue_init(&(pr->runq.runq[i]));
 	}
+#if	NCPUS > 1
+	simple_lock_init(&pr->affinity_runq.lock);
+	pr->affinity_runq.high = NRQS-1;
+	pr->affinity_runq.count = 0;
+	for (i = 0; i < NRQS; i++) {
+	    queue_init(&(pr->affinity_runq.runq[i]));
+	}
+#endif	/* NCPUS > 1 */
 	queue_init(&pr->processor_queue);
 	pr->state = PROCESSOR_OFF_LINE;
 	pr->next_thread = THREAD_NULL;
@@ -237,6 +245,9 @@ void processor_init(
 	simple_lock_init(&pr->lock);
 	pr->processor_self = IP_NULL;
 	pr->slot_num = slot_num;
+	pr->csw_count = 0;
+	pr->steal_count = 0;
+	pr->migrate_count = 0;
 }
 
 /*
@@ -117,6 +117,9 @@ extern struct processor_set	default_pset;
 struct processor {
 	struct run_queue runq;		/* local runq for this processor */
 		/* XXX want to do this round robin eventually */
+#if	NCPUS > 1
+	struct run_queue affinity_runq;	/* unbound threads placed here */
+#endif	/* NCPUS > 1 */
 	queue_chain_t	processor_queue; /* idle/assign/shutdown queue link */
 	int		state;		/* See below */
 	struct thread	*next_thread;	/* next thread to run if dispatched */
@@ -134,6 +137,10 @@ struct processor {
 #if	NCPUS > 1
 	ast_check_t	ast_check_data;	/* for remote ast_check invocation */
 #endif	/* NCPUS > 1 */
+	/* scheduler counters, see HOST_SCHED_CPU_INFO */
+	unsigned int	csw_count;	/* context switches */
+	unsigned int	steal_count;	/* threads taken from other cpus */
+	unsigned int	migrate_count;	/* threads queued here from elsewhere */
 	/* punt id data temporarily */
 };
 
@@ -100,13 +100,45 @@ struct run_queue {
 typedef struct run_queue	*run_queue_t;
 #define RUN_QUEUE_NULL	((run_queue_t) 0)
 
+/*
+ *	runq_csw_needed: true if the run queue holds a thread that should
+ *	preempt thread on processor.  Ties only preempt once the current
+ *	thread has used its first quantum.  rq->high is a hint and may
+ *	be too high, never too low.
+ */
+#define runq_csw_needed(rq, thread, processor) (			  \
+	((rq)->count > 0) &&						  \
+	 ((processor)->first_quantum?					  \
+	  (rq)->high > (thread)->sched_pri :				  \
+	  (rq)->high >= (thread)->sched_pri))
+
+/*
+ *	runq_pending: is anything queued that processor could run instead
+ *	of its current thread?
+ */
+#if	NCPUS > 1
+#define runq_pending(processor) (					  \
+	((processor)->runq.count > 0) ||				  \
+	((processor)->affinity_runq.count > 0) ||			  \
+	((processor)->processor_set->runq.count > 0))
+#else	/* NCPUS > 1 */
+#define runq_pending(processor) (					  \
+	((processor)->runq.count > 0) ||				  \
+	((processor)->processor_set->runq.count > 0))
+#endif	/* NCPUS > 1 */
+
+#if	NCPUS > 1
 #define csw_needed(thread, processor) (					  \
 	((thread)->state & TH_SUSP) ||					  \
 	((processor)->runq.count > 0) ||				  \
-	(((processor)->processor_set->runq.count > 0) &&		  \
-	 ((processor)->first_quantum?					  \
-	  (processor)->processor_set->runq.high > (thread)->sched_pri :	  \
-	  (processor)->processor_set->runq.high >= (thread)->sched_pri)))
+	runq_csw_needed(&(processor)->affinity_runq, thread, processor) || \
+	runq_csw_needed(&(processor)->processor_set->runq, thread, processor))
+#else	/* NCPUS > 1 */
+#define csw_needed(thread, processor) (					  \
+	((thread)->state & TH_SUSP) ||					  \
+	((processor)->runq.count > 0) ||				  \
+	runq_csw_needed(&(processor)->processor_set->runq, thread, processor))
+#endif	/* NCPUS > 1 */
 
 /*
  *	Scheduler routines.
@@ -114,6 +146,10 @@ typedef struct run_queue	*run_queue_t;
 
 extern struct run_queue	*rem_runq();
 extern struct thread	*choose_thread();
+#if	NCPUS > 1
+extern void		affinity_runq_drain();
+extern void		sched_balance();
+#endif	/* NCPUS > 1 */
 extern queue_head_t	action_queue;	/* assign/shutdown queue */
 decl_simple_lock_data(extern,action_lock);
 
@@ -102,12 +102,25 @@ int		sched_usec;
 
 thread_t	sched_thread_id;
 
+#if	NCPUS > 1
+/*
+ *	A thread is queued back on the processor it last ran on unless
+ *	that processor has more than sched_affinity_slack threads queued
+ *	beyond the least loaded processor in the set.
+ */
+int		sched_affinity_slack = 2;
+#endif	/* NCPUS > 1 */
+
 void recompute_priorities(void);	/* forward */
 void update_priority(thread_t);
 void set_pri(thread_t, int, boolean_t);
 void do_thread_scan(void);
 
 thread_t	choose_pset_thread();
+thread_t	run_queue_dequeue();
+#if	NCPUS > 1
+thread_t	steal_thread();
+#endif	/* NCPUS > 1 */
 
 #define	RUNQ_DEBUG	0
 
@@ -571,18 +584,31 @@ thread_t thread_select(
 	}
 	else {
 		register processor_set_t pset;
+		register run_queue_t	rq;
 
 #if	MACH_HOST
 		pset = myprocessor->processor_set;
 #else	/* MACH_HOST */
 		pset = &default_pset;
 #endif	/* MACH_HOST */
-		simple_lock(&pset->runq.lock);
+		rq = &pset->runq;
+#if	NCPUS > 1
+		/*
+		 *	Unbound threads are queued on the pset runq or on
+		 *	this processor's affinity runq.  Look at whichever
+		 *	hints at the higher priority thread.
+		 */
+		if (myprocessor->affinity_runq.count > 0 &&
+		    (rq->count == 0 ||
+		     myprocessor->affinity_runq.high >= rq->high))
+			rq = &myprocessor->affinity_runq;
+#endif	/* NCPUS > 1 */
+		simple_lock(&rq->lock);
 #if	RUNQ_DEBUG
-		CHECKRQ(&pset->runq, "thread_select");
+		CHECKRQ(rq, "thread_select");
 #endif	/* DEBUG */
-		if (pset->runq.count == 0 ||
-		    pset->runq.high < thread->sched_pri) {
+		if (rq->count == 0 ||
+		    rq->high < thread->sched_pri) {
 			/*
 			 *	Nothing else runnable.  Return if this
 			 *	thread is still runnable on this processor.
@@ -595,13 +621,19 @@ thread_t thread_select(
 			    ((thread->bound_processor == PROCESSOR_NULL) ||
 			     (thread->bound_processor == myprocessor))) {
 
-				simple_unlock(&pset->runq.lock);
+				simple_unlock(&rq->lock);
 				thread_lock(thread);
 				if (thread->sched_stamp != sched_tick)
 				    update_priority(thread);
 				thread_unlock(thread);
 			}
 			else {
+#if	NCPUS > 1
+				if (rq != &pset->runq) {
+					simple_unlock(&rq->lock);
+					simple_lock(&pset->runq.lock);
+				}
+#endif	/* NCPUS > 1 */
 				thread = choose_pset_thread(myprocessor, pset);
 			}
 		}
@@ -612,33 +644,39 @@ thread_t thread_select(
 			 *	If there is a thread at hint, grab it,
 			 *	else call choose_pset_thread.
 			 */
-			q = pset->runq.runq + pset->runq.high;
+			q = rq->runq + rq->high;
 
 			if (queue_empty(q)) {
-				pset->runq.high--;
+				rq->high--;
+#if	NCPUS > 1
+				if (rq != &pset->runq) {
+					simple_unlock(&rq->lock);
+					simple_lock(&pset->runq.lock);
+				}
+#endif	/* NCPUS > 1 */
 				thread = choose_pset_thread(myprocessor, pset);
 			}
 			else {
 				thread = (thread_t) dequeue_head(q);
 				thread->runq = RUN_QUEUE_NULL;
-				pset->runq.count--;
+				rq->count--;
 #if	MACH_FIXPRI
 				/*
-				 *	Cannot lazy evaluate pset->runq.low for
+				 *	Cannot lazy evaluate rq->high for
 				 *	fixed priority policy
 				 */
-				if ((pset->runq.count > 0) &&
+				if ((rq->count > 0) &&
 				    (pset->policies & POLICY_FIXEDPRI)) {
 					    while (queue_empty(q)) {
-						pset->runq.high--;
+						rq->high--;
 						q--;
 					    }
 				}
 #endif	/* MACH_FIXPRI */
 #if	RUNQ_DEBUG
-				CHECKRQ(&pset->runq, "thread_select: after");
+				CHECKRQ(rq, "thread_select: after");
 #endif	/* DEBUG */
-				simple_unlock(&pset->runq.lock);
+				simple_unlock(&rq->lock);
 			}
 		}
 
@@ -796,6 +834,7 @@ boolean_t thread_invoke(
 		     */
 
 		    counter_always(c_thread_invoke_hits++);
+		    current_processor()->csw_count++;
 		    (void) spl0();
 		    call_continuation(new_thread->swap_func);
 		    /*NOTREACHED*/
@@ -857,6 +896,7 @@ boolean_t thread_invoke(
 	 *	It returns only if a continuation is not supplied.
 	 */
 	counter_always(c_thread_invoke_csw++);
+	current_processor()->csw_count++;
 	old_thread = switch_context(old_thread, continuation, new_thread);
 
 	/*
@@ -1272,13 +1312,321 @@ run_queue_enqueue(rq, th)
 	simple_unlock(&rq->lock);
 }
 
+/*
+ *	run_queue_dequeue:
+ *
+ *	Remove and return the highest priority thread on a run queue,
+ *	or THREAD_NULL if it is empty.  Locks the run queue, and leaves
+ *	its high hint exact.
+ */
+thread_t run_queue_dequeue(
+	register run_queue_t	rq)
+{
+	register queue_t	q;
+	register thread_t	th;
+	register int		i;
+
+	simple_lock(&rq->lock);
+	if (rq->count > 0) {
+	    q = rq->runq + rq->high;
+	    for (i = rq->high; i >= 0 ; i--, q--) {
+		if (!queue_empty(q)) {
+		    th = (thread_t) dequeue_head(q);
+		    th->runq = RUN_QUEUE_NULL;
+		    if (--rq->count > 0) {
+			while (queue_empty(q)) {
+			    q--;
+			    i--;
+			}
+		    }
+		    rq->high = i;
+#if	RUNQ_DEBUG
+		    CHECKRQ(rq, "run_queue_dequeue");
+#endif	/* DEBUG */
+		    simple_unlock(&rq->lock);
+		    return th;
+		}
+	    }
+	    panic("run_queue_dequeue");
+	    /*NOTREACHED*/
+	}
+	simple_unlock(&rq->lock);
+	return THREAD_NULL;
+}
+
+#if	NCPUS > 1
+/*
+ *	affinity_runq_enqueue:
+ *
+ *	Queue a thread on a processor's affinity runq.  Fails if the
+ *	processor is no longer running in pset; that is checked under
+ *	the runq lock so affinity_runq_drain cannot miss the thread.
+ */
+boolean_t affinity_runq_enqueue(
+	register processor_t	processor,
+	processor_set_t		pset,
+	register thread_t	th)
+{
+	register run_queue_t	rq;
+	register unsigned int	whichq;
+
+	whichq = th->sched_pri;
+	if (whichq >= NRQS) {
+	    printf("affinity_runq_enqueue: pri too high (%d)\n",
+	    	   th->sched_pri);
+	    whichq = NRQS - 1;
+	}
+
+	rq = &processor->affinity_runq;
+	simple_lock(&rq->lock);
+	if (processor->state != PROCESSOR_RUNNING ||
+	    processor->processor_set != pset) {
+		simple_unlock(&rq->lock);
+		return FALSE;
+	}
+	enqueue_tail(&rq->runq[whichq], (queue_entry_t) th);
+
+	if (whichq > rq->high || rq->count == 0)
+		rq->high = whichq;
+
+	rq->count++;
+	th->runq = rq;
+	if (th->last_processor != processor)
+		processor->migrate_count++;
+#if	RUNQ_DEBUG
+	THREAD_CHECK(th, rq);
+	CHECKRQ(rq, "affinity_runq_enqueue");
+#endif	/* DEBUG */
+	simple_unlock(&rq->lock);
+	return TRUE;
+}
+
+/*
+ *	sched_preempts:
+ *
+ *	Whether th should preempt the thread processor is running, and
+ *	can be made to.
+ *
+ *	XXX Don't interrupt the master remotely; see thread_setrun.
+ */
+static boolean_t sched_preempts(
+	register processor_t	processor,
+	register thread_t	th)
+{
+	register thread_t	active;
+
+	active = active_threads[processor->slot_num];
+	return (active != THREAD_NULL && active->sched_pri < th->sched_pri &&
+		(processor == current_processor() ||
+		 processor != master_processor));
+}
+
+/*
+ *	sched_choose_processor:
+ *
+ *	Choose the running processor in pset whose affinity runq should
+ *	take th.  A processor running something th preempts comes first,
+ *	since th runs there at once; then the shortest queue, preferring
+ *	the current processor on ties.  The processor th last ran on,
+ *	whose cache may still hold its footprint, is taken instead if it
+ *	is as good on preemption and its queue is no more than
+ *	sched_affinity_slack longer.  Unlocked, so only a hint.
+ */
+processor_t sched_choose_processor(
+	thread_t		th,
+	processor_set_t		pset)
+{
+	register processor_t	processor, best;
+	register int		i, depth, best_depth;
+	boolean_t		preempts, best_preempts;
+
+	best = PROCESSOR_NULL;
+	best_depth = 0;
+	best_preempts = FALSE;
+	for (i = 0; i < NCPUS; i++) {
+		processor = cpu_to_processor(i);
+		if (processor->state != PROCESSOR_RUNNING ||
+		    processor->processor_set != pset)
+			continue;
+		preempts = sched_preempts(processor, th);
+		depth = processor->affinity_runq.count;
+		if (best == PROCESSOR_NULL ||
+		    (preempts && !best_preempts) ||
+		    (preempts == best_preempts &&
+		     (depth < best_depth ||
+		      (depth == best_depth &&
+		       processor == current_processor())))) {
+			best = processor;
+			best_depth = depth;
+			best_preempts = preempts;
+		}
+	}
+
+	processor = th->last_processor;
+	if (best != PROCESSOR_NULL && processor != PROCESSOR_NULL &&
+	    processor->state == PROCESSOR_RUNNING &&
+	    processor->processor_set == pset &&
+	    (!best_preempts || sched_preempts(processor, th)) &&
+	    processor->affinity_runq.count <= best_depth + sched_affinity_slack)
+		return processor;
+
+	return best;
+}
+
+/*
+ *	steal_thread:
+ *
+ *	Take the highest priority thread from the longest affinity runq
+ *	of the other processors in pset.  Called at splsched by a processor
+ *	that has nothing else to run.  Bound threads are never on affinity
+ *	runqs, so whatever is found may run here.
+ */
+thread_t steal_thread(
+	register processor_t	myprocessor,
+	processor_set_t		pset)
+{
+	register processor_t	processor, victim;
+	register int		i, depth;
+	register thread_t	th;
+
+	victim = PROCESSOR_NULL;
+	depth = 0;
+	for (i = 0; i < NCPUS; i++) {
+		processor = cpu_to_processor(i);
+		if (processor == myprocessor ||
+		    processor->processor_set != pset)
+			continue;
+		if (processor->affinity_runq.count > depth) {
+			victim = processor;
+			depth = processor->affinity_runq.count;
+		}
+	}
+	if (victim == PROCESSOR_NULL)
+		return THREAD_NULL;
+
+	th = run_queue_dequeue(&victim->affinity_runq);
+	if (th != THREAD_NULL)
+		myprocessor->steal_count++;
+	return th;
+}
+
+/*
+ *	affinity_runq_drain:
+ *
+ *	Requeue the threads on the affinity runq of a processor that is
+ *	leaving its processor set.  The processor must already be out of
+ *	PROCESSOR_RUNNING so that thread_setrun does not choose it again.
+ */
+void affinity_runq_drain(
+	processor_t	processor)
+{
+	register thread_t	th;
+	spl_t			s;
+
+	s = splsched();
+	while ((th = run_queue_dequeue(&processor->affinity_runq))
+							!= THREAD_NULL) {
+		thread_lock(th);
+		thread_setrun(th, FALSE);
+		thread_unlock(th);
+	}
+	splx(s);
+}
+
+/*
+ *	pset_balance:
+ *
+ *	Even out the affinity runqs of a processor set: while the longest
+ *	queue is two or more threads longer than the shortest, or holds
+ *	anything while a processor in the set is idle, move its best
+ *	thread over.  This catches what placement and stealing miss,
+ *	e.g. threads made runnable on a processor that was busy then.
+ */
+void pset_balance(
+	register processor_set_t	pset)
+{
+	register processor_t		processor, busiest, idlest;
+	register int			i, moves, depth;
+	register thread_t		th;
+	spl_t				s;
+
+	s = splsched();
+	for (moves = 0; moves < NCPUS * 4; moves++) {
+		busiest = idlest = PROCESSOR_NULL;
+		depth = 0;
+		for (i = 0; i < NCPUS; i++) {
+			processor = cpu_to_processor(i);
+			if (processor->processor_set == pset &&
+			    processor->affinity_runq.count > depth) {
+				busiest = processor;
+				depth = processor->affinity_runq.count;
+			}
+		}
+		if (busiest == PROCESSOR_NULL)
+			break;
+
+		if (pset->idle_count == 0) {
+			depth--;
+			for (i = 0; i < NCPUS; i++) {
+				processor = cpu_to_processor(i);
+				if (processor->state == PROCESSOR_RUNNING &&
+				    processor->processor_set == pset &&
+				    processor->affinity_runq.count < depth) {
+					idlest = processor;
+					depth = processor->affinity_runq.count;
+				}
+			}
+			if (idlest == PROCESSOR_NULL)
+				break;
+		}
+
+		th = run_queue_dequeue(&busiest->affinity_runq);
+		if (th == THREAD_NULL)
+			continue;
+		thread_lock(th);
+		if (idlest == PROCESSOR_NULL ||
+		    !affinity_runq_enqueue(idlest, pset, th)) {
+			/*
+			 *	Either a processor is idle and thread_setrun
+			 *	will dispatch to it, or the one we chose has
+			 *	just stopped running.
+			 */
+			thread_setrun(th, FALSE);
+		}
+		thread_unlock(th);
+	}
+	splx(s);
+}
+
+/*
+ *	sched_balance:
+ *
+ *	Called once a second by the scheduler thread.
+ */
+void sched_balance(void)
+{
+#if	MACH_HOST
+	register processor_set_t	pset;
+
+	simple_lock(&all_psets_lock);
+	queue_iterate(&all_psets, pset, processor_set_t, all_psets) {
+		pset_balance(pset);
+	}
+	simple_unlock(&all_psets_lock);
+#else	/* MACH_HOST */
+	pset_balance(&default_pset);
+#endif	/* MACH_HOST */
+}
+#endif	/* NCPUS > 1 */
+
 
 /*
  *	thread_setrun:
  *
  *	Make thread runnable; dispatch directly onto an idle processor
  *	if possible.  Else put on appropriate run queue (processor
- *	if bound, else processor set.  Caller must have lock on thread.
+ *	if bound, else the affinity runq of a running processor in the
+ *	set, else processor set).  Caller must have lock on thread.
  *	This is always called at splsched.
  */
 
@@ -1351,6 +1699,29 @@ void thread_setrun(
 		}
 		simple_unlock(&pset->idle_lock);
 	    }
+
+	    /*
+	     *	No idle processor.  Queue the thread on a running
+	     *	processor, preferably the one it last ran on.
+	     */
+	    processor = sched_choose_processor(th, pset);
+	    if (processor != PROCESSOR_NULL &&
+		affinity_runq_enqueue(processor, pset, th)) {
+		/*
+		 *	Preempt check.  Only the thread running on the
+		 *	chosen processor competes with this one.
+		 */
+		if (may_preempt && sched_preempts(processor, th)) {
+			if (processor == current_processor()) {
+				processor->first_quantum = FALSE;
+				ast_on(cpu_number(), AST_BLOCK);
+			}
+			else
+				cause_ast_check(processor);
+		}
+		return;
+	    }
+
 	    rq = &(pset->runq);
 	    run_queue_enqueue(rq,th);
 	    /*
@@ -1537,7 +1908,9 @@ struct run_queue *rem_runq(
  *
  *	Strategy:
  *		Check processor runq first; if anything found, run it.
- *		Else check pset runq; if nothing found, return idle thread.
+ *		Else check affinity and pset runqs, then steal from the
+ *		other processors in the set; if nothing found, return
+ *		idle thread.
  *
  *	Second line of strategy is implemented by choose_pset_thread.
  *	This is only called on processor startup and when thread_block
@@ -1548,30 +1921,11 @@ thread_t choose_thread(
 	processor_t myprocessor)
 {
 	thread_t th;
-	register queue_t q;
-	register run_queue_t runq;
-	register int i;
 	register processor_set_t pset;
 
-	runq = &myprocessor->runq;
-
-	simple_lock(&runq->lock);
-	if (runq->count > 0) {
-	    q = runq->runq + runq->high;
-	    for (i = runq->high; i >= 0 ; i--, q--) {
-		if (!queue_empty(q)) {
-		    th = (thread_t) dequeue_head(q);
-		    th->runq = RUN_QUEUE_NULL;
-		    runq->count--;
-		    runq->high = i;
-		    simple_unlock(&runq->lock);
-		    return(th);
-		}
-	    }
-	    panic("choose_thread");
-	    /*NOTREACHED*/
-	}
-	simple_unlock(&runq->lock);
+	th = run_queue_dequeue(&myprocessor->runq);
+	if (th != THREAD_NULL)
+		return th;
 
 	pset = myprocessor->processor_set;
 
@@ -1586,7 +1940,8 @@ thread_t choose_thread(
  *	Caller must be at splsched and have a lock on the runq.  This
  *	lock is released by this routine.  myprocessor is always the current
  *	processor, and pset must be its processor set.
- *	This routine chooses and removes a thread from the runq if there
+ *	This routine chooses and removes a thread from the runq (or from
+ *	this processor's affinity runq, or another processor's) if there
  *	is one (and returns it), else it sets the processor idle and
  *	returns its idle thread.
  */
@@ -1602,6 +1957,22 @@ thread_t choose_pset_thread(
 
 	runq = &pset->runq;
 
+#if	NCPUS > 1
+	/*
+	 *	Take from the affinity runq instead if it hints at a
+	 *	thread at least as good.
+	 */
+	if (myprocessor->affinity_runq.count > 0 &&
+	    (runq->count == 0 ||
+	     myprocessor->affinity_runq.high >= runq->high)) {
+		simple_unlock(&runq->lock);
+		th = run_queue_dequeue(&myprocessor->affinity_runq);
+		if (th != THREAD_NULL)
+			return th;
+		simple_lock(&runq->lock);
+	}
+#endif	/* NCPUS > 1 */
+
 	if (runq->count > 0) {
 	    q = runq->runq + runq->high;
 	    for (i = runq->high; i >= 0 ; i--, q--) {
@@ -1635,6 +2006,18 @@ thread_t choose_pset_thread(
 	}
 	simple_unlock(&runq->lock);
 
+#if	NCPUS > 1
+	/*
+	 *	Nothing queued for us.  Before going idle, take work
+	 *	waiting behind a busy processor in the same set.
+	 */
+	if (myprocessor->state == PROCESSOR_RUNNING) {
+		th = steal_thread(myprocessor, pset);
+		if (th != THREAD_NULL)
+			return th;
+	}
+#endif	/* NCPUS > 1 */
+
 	/*
 	 *	Nothing is runnable, so set this processor idle if it
 	 *	was running.  If it was in an assignment or shutdown,
@@ -1680,6 +2063,9 @@ void idle_thread_continue(void)
 	register volatile thread_t *threadp;
 	register volatile int *gcount;
 	register volatile int *lcount;
+#if	NCPUS > 1
+	register volatile int *acount;
+#endif	/* NCPUS > 1 */
 	register thread_t new_thread;
 	register int state;
 	int mycpu;
@@ -1689,6 +2075,9 @@ void idle_thread_continue(void)
 	myprocessor = current_processor();
 	threadp = (volatile thread_t *) &myprocessor->next_thread;
 	lcount = (volatile int *) &myprocessor->runq.count;
+#if	NCPUS > 1
+	acount = (volatile int *) &myprocessor->affinity_runq.count;
+#endif	/* NCPUS > 1 */
 
 	while (TRUE) {
 #ifdef	MARK_CPU_IDLE
@@ -1707,6 +2096,9 @@ void idle_thread_continue(void)
  *	to the value of the thread to run next.  Also check runq counts.
  */
 		while ((*threadp == (volatile thread_t)THREAD_NULL) &&
+#if	NCPUS > 1
+		       (*acount == 0) &&
+#endif	/* NCPUS > 1 */
 		       (*gcount == 0) && (*lcount == 0)) {
 
 			/* check for ASTs while we wait */
@@ -1874,6 +2266,13 @@ void sched_thread_continue(void)
      */
     do_thread_scan();
 
+#if	NCPUS > 1
+    /*
+     *	Even out the per-processor run queues.
+     */
+    sched_balance();
+#endif	/* NCPUS > 1 */
+
     assert_wait((event_t) 0, FALSE);
     counter(c_sched_thread_block++);
     thread_block_with_continuation(sched_thread_continue);
@@ -1911,7 +2310,8 @@ void sched_thread(void)
  *	cannot be held during updates [set_pri will deadlock].
  *
  *	Array length should be enough so that restart isn't necessary,
- *	but restart logic is included.  Does not scan processor runqs.
+ *	but restart logic is included.  Of the processor runqs, only the
+ *	master's (bound U*x threads) and the affinity runqs are scanned.
  *
  */
 
@@ -1997,6 +2397,9 @@ void do_thread_scan(void)
 	register spl_t		s;
 	register boolean_t	restart_needed = 0;
 	register thread_t	thread;
+#if	NCPUS > 1
+	register int		i;
+#endif	/* NCPUS > 1 */
 #if	MACH_HOST
 	register processor_set_t	pset;
 #endif	/* MACH_HOST */
@@ -2014,6 +2417,11 @@ void do_thread_scan(void)
 #endif	/* MACH_HOST */
 	    if (!restart_needed)
 	    	restart_needed = do_runq_scan(&master_processor->runq);
+#if	NCPUS > 1
+	    for (i = 0; i < NCPUS && !restart_needed; i++)
+		restart_needed =
+		    do_runq_scan(&cpu_to_processor(i)->affinity_runq);
+#endif	/* NCPUS > 1 */
 
 	    /*
 	     *	Ok, we now have a collection of candidates -- fix them.
@@ -94,8 +94,7 @@ void swtch_continue()
 	register processor_t	myprocessor;
 
 	myprocessor = current_processor();
-	thread_syscall_return(myprocessor->runq.count > 0 ||
-			      myprocessor->processor_set->runq.count > 0);
+	thread_syscall_return(runq_pending(myprocessor));
 	/*NOTREACHED*/
 }
 
@@ -105,16 +104,14 @@ boolean_t swtch()
 
 #if	NCPUS > 1
 	myprocessor = current_processor();
-	if (myprocessor->runq.count == 0 &&
-	    myprocessor->processor_set->runq.count == 0)
+	if (!runq_pending(myprocessor))
 		return(FALSE);
 #endif	NCPUS > 1
 
 	counter(c_swtch_block++);
 	thread_block_with_continuation(swtch_continue);
 	myprocessor = current_processor();
-	return(myprocessor->runq.count > 0 ||
-	       myprocessor->processor_set->runq.count > 0);
+	return(runq_pending(myprocessor));
 }
 
 void swtch_pri_continue()
@@ -125,8 +122,7 @@ void swtch_pri_continue()
 	if (thread->depress_priority >= 0)
 		(void) thread_depress_abort(thread);
 	myprocessor = current_processor();
-	thread_syscall_return(myprocessor->runq.count > 0 ||
-			      myprocessor->processor_set->runq.count > 0);
+	thread_syscall_return(runq_pending(myprocessor));
 	/*NOTREACHED*/
 }
 
@@ -142,8 +138,7 @@ boolean_t  swtch_pri(pri)
 
 #if	NCPUS > 1
 	myprocessor = current_processor();
-	if (myprocessor->runq.count == 0 &&
-	    myprocessor->processor_set->runq.count == 0)
+	if (!runq_pending(myprocessor))
 		return(FALSE);
 #endif	NCPUS > 1
 
@@ -159,8 +154,7 @@ boolean_t  swtch_pri(pri)
 	if (thread->depress_priority >= 0)
 		(void) thread_depress_abort(thread);
 	myprocessor = current_processor();
-	return(myprocessor->runq.count > 0 ||
-	       myprocessor->processor_set->runq.count > 0);
+	return(runq_pending(myprocessor));
 }
 
 extern int hz;
@@ -288,8 +282,7 @@ mach_msg_timeout_t option_time;
      */
 #if	NCPUS > 1
     myprocessor = current_processor();
-    if (myprocessor->processor_set->runq.count > 0 ||
-	myprocessor->runq.count > 0)
+    if (runq_pending(myprocessor))
 #endif	NCPUS > 1
 	    thread_block_with_continuation(thread_switch_continue);
 
@@ -67,6 +67,7 @@
  
 #import <mach/features.h>
 
+#include <kern/cpu_number.h>
 #include <kern/macro_help.h>
 #include <kern/sched.h>
 #include <kern/time_out.h>
@@ -178,7 +179,10 @@ MACRO_BEGIN						\
 		lock_write(&(zone)->complex_lock);	\
 	} else {					\
 		spl_t s = splhigh();			\
-		simple_lock(&(zone)->lock);		\
+		if (!simple_lock_try(&(zone)->lock)) {	\
+			simple_lock(&(zone)->lock);	\
+			(zone)->lock_contended++;	\
+		}					\
 		(zone)->lock_ipl = s;			\
 	}						\
 MACRO_END
@@ -210,6 +214,9 @@ vm_offset_t zget_space(
 
 decl_simple_lock_data(,zget_space_lock)
 
+vm_offset_t zalloc_noblock(
+	zone_t			zone);
+
 /*
  * A free list entry, which is created
  * at the front of an available region
@@ -643,6 +650,46 @@ zone_t			first_zone;
 zone_t			*last_zone;
 int			num_zones;
 
+/*
+ *	Magazines are allocated from their own zone, which
+ *	naturally has no magazine layer of its own.
+ */
+zone_t			zone_magazine_zone;
+
+/*
+ *	Cleared (vm.zmagazine sysctl) to bypass the magazine
+ *	layer of every zone; see zone_magazine_enable().
+ */
+boolean_t		zone_magazines_enabled = TRUE;
+
+/*
+ *	Magazines are bypassed while any of the zone_check
+ *	debugging options is on, so that every element passes
+ *	through the checked free list.
+ */
+#define zone_magazine_usable(z)	\
+	((z)->mag_rounds > 0 && zone_magazines_enabled && zone_check == 0)
+
+/*
+ *	Default magazine size for a zone.  Small elements get
+ *	large magazines; large ones are not worth hoarding.
+ */
+static
+int
+zone_magazine_default(size)
+	vm_size_t	size;
+{
+	if (zone_magazine_zone == ZONE_NULL)
+		return (0);
+	if (size <= 256)
+		return (ZMAG_ROUNDS_MAX);
+	if (size <= 1024)
+		return (ZMAG_ROUNDS_MAX / 2);
+	if (size <= PAGE_SIZE)
+		return (ZMAG_ROUNDS_MAX / 4);
+	return (0);
+}
+
 /*
  *	zinit initializes a new zone.  The zone data structures themselves
  *	are stored in a zone, which is initially a static structure that
@@ -701,6 +748,19 @@ zone_t zinit(size, max, alloc, pageable, name)
 	lock_zone_init(z);
 	zone_free_space_select(z);
 
+	z->depot_full = z->depot_empty = 0;
+	z->depot_nfull = z->depot_nempty = 0;
+	z->depot_gets = z->depot_puts = 0;
+	z->lock_contended = 0;
+	bzero((char *)z->cpu_cache, sizeof (z->cpu_cache));
+	{
+		int	i;
+
+		for (i = 0; i < NCPUS; i++)
+			simple_lock_init(&z->cpu_cache[i].zc_lock);
+	}
+	z->mag_rounds = pageable ? 0 : zone_magazine_default(size);
+
 	/*
 	 *	Add the zone to the all-zones list.
 	 */
@@ -1402,6 +1462,10 @@ void zone_bootstrap(void)
 	zone_zone = zinit(sizeof(struct zone), 128 * sizeof(struct zone),
 			  sizeof(struct zone), FALSE, "zones");
 
+	zone_magazine_zone = ZONE_NULL;
+	zone_magazine_zone = zinit(sizeof(struct zone_magazine),
+			  1024 * 1024, PAGE_SIZE, FALSE, "zone magazines");
+
 	zone_free_space_alloc(16,	96);
 	zone_free_space_alloc(128,	768);
 	zone_free_space_alloc(1024,	PAGE_SIZE);
@@ -1457,6 +1521,372 @@ check_zone(zone, elem)
 #endif
 }
 
+/*
+ *	Exchange this processor's loaded and previous magazines.
+ */
+#define zone_magazine_swap(cc)					\
+MACRO_BEGIN							\
+	struct zone_magazine	*_mag = (cc)->zc_loaded;	\
+	int			_rounds = (cc)->zc_lrounds;	\
+								\
+	(cc)->zc_loaded = (cc)->zc_previous;			\
+	(cc)->zc_lrounds = (cc)->zc_prounds;			\
+	(cc)->zc_previous = _mag;				\
+	(cc)->zc_prounds = _rounds;				\
+MACRO_END
+
+/*
+ *	Allocate an element from this processor's magazines,
+ *	reloading from the depot if both are empty.  Returns
+ *	zero if the caller must use the zone free list.
+ */
+static
+vm_offset_t
+zone_magazine_alloc(zone)
+	register zone_t	zone;
+{
+	register struct zone_cpu_cache	*cc;
+	struct zone_magazine		*mag;
+	vm_offset_t			addr = 0;
+	spl_t				s;
+
+	s = splhigh();
+	cc = &zone->cpu_cache[cpu_number()];
+	simple_lock(&cc->zc_lock);
+	cc->zc_allocs++;
+	while (zone->mag_rounds > 0) {
+		if (cc->zc_lrounds > 0) {
+			addr = cc->zc_loaded->zm_rounds[--cc->zc_lrounds];
+			cc->zc_alloc_hits++;
+			break;
+		}
+		if (cc->zc_prounds > 0) {
+			zone_magazine_swap(cc);
+			continue;
+		}
+
+		/*
+		 *	Both magazines are empty.  Trade the
+		 *	previous one for a full one from the depot.
+		 */
+		lock_zone(zone);
+		if ((mag = zone->depot_full) != 0) {
+			zone->depot_full = mag->zm_next;
+			zone->depot_nfull--;
+			zone->depot_gets++;
+			if (cc->zc_previous != 0) {
+				cc->zc_previous->zm_next = zone->depot_empty;
+				zone->depot_empty = cc->zc_previous;
+				zone->depot_nempty++;
+				zone->depot_puts++;
+			}
+			cc->zc_previous = cc->zc_loaded;
+			cc->zc_prounds = 0;
+			cc->zc_loaded = mag;
+			cc->zc_lrounds = mag->zm_count;
+		}
+		unlock_zone(zone);
+		if (mag == 0)
+			break;
+	}
+	simple_unlock(&cc->zc_lock);
+	splx(s);
+
+	return (addr);
+}
+
+/*
+ *	Free an element into this processor's magazines,
+ *	exchanging a full magazine for an empty one from the
+ *	depot if both are full.  Returns FALSE if the caller
+ *	must use the zone free list.
+ */
+static
+boolean_t
+zone_magazine_free(zone, elem)
+	register zone_t	zone;
+	vm_offset_t	elem;
+{
+	register struct zone_cpu_cache	*cc;
+	struct zone_magazine		*mag = 0;
+	boolean_t			tried_alloc = FALSE;
+	boolean_t			done = FALSE;
+	int				rounds;
+	spl_t				s;
+
+	s = splhigh();
+	cc = &zone->cpu_cache[cpu_number()];
+	simple_lock(&cc->zc_lock);
+	cc->zc_frees++;
+	while ((rounds = zone->mag_rounds) > 0) {
+		if (cc->zc_loaded != 0 && cc->zc_lrounds < rounds) {
+			cc->zc_loaded->zm_rounds[cc->zc_lrounds++] = elem;
+			cc->zc_free_hits++;
+			done = TRUE;
+			break;
+		}
+		if (cc->zc_previous != 0 && cc->zc_prounds < rounds) {
+			zone_magazine_swap(cc);
+			continue;
+		}
+
+		/*
+		 *	Both magazines are full (or missing).  Find
+		 *	an empty one, in the depot or newly allocated.
+		 *	The allocation is made without our locks
+		 *	held, so everything is checked again after.
+		 */
+		if (mag == 0) {
+			lock_zone(zone);
+			if ((mag = zone->depot_empty) != 0) {
+				zone->depot_empty = mag->zm_next;
+				zone->depot_nempty--;
+				zone->depot_gets++;
+			}
+			unlock_zone(zone);
+		}
+		if (mag == 0) {
+			if (tried_alloc)
+				break;
+			tried_alloc = TRUE;
+			simple_unlock(&cc->zc_lock);
+			splx(s);
+
+			mag = (struct zone_magazine *)
+					zalloc_noblock(zone_magazine_zone);
+
+			s = splhigh();
+			cc = &zone->cpu_cache[cpu_number()];
+			simple_lock(&cc->zc_lock);
+			if (mag == 0)
+				break;
+			continue;
+		}
+
+		/*
+		 *	Return the previous (full) magazine to
+		 *	the depot and load the empty one.
+		 */
+		if (cc->zc_previous != 0) {
+			lock_zone(zone);
+			cc->zc_previous->zm_count = cc->zc_prounds;
+			cc->zc_previous->zm_next = zone->depot_full;
+			zone->depot_full = cc->zc_previous;
+			zone->depot_nfull++;
+			zone->depot_puts++;
+			unlock_zone(zone);
+		}
+		cc->zc_previous = cc->zc_loaded;
+		cc->zc_prounds = cc->zc_lrounds;
+		cc->zc_loaded = mag;
+		cc->zc_lrounds = 0;
+		mag = 0;
+	}
+	simple_unlock(&cc->zc_lock);
+	splx(s);
+
+	/*
+	 *	An empty magazine we ended up not needing.
+	 */
+	if (mag != 0) {
+		lock_zone(zone);
+		mag->zm_next = zone->depot_empty;
+		zone->depot_empty = mag;
+		zone->depot_nempty++;
+		unlock_zone(zone);
+	}
+
+	return (done);
+}
+
+/*
+ *	Put the rounds of a magazine back on the zone
+ *	free list.  Zone must be locked.
+ */
+static
+void
+zone_magazine_unload(zone, mag, rounds)
+	register zone_t		zone;
+	struct zone_magazine	*mag;
+	int			rounds;
+{
+	vm_offset_t	elem;
+
+	while (rounds > 0) {
+		elem = mag->zm_rounds[--rounds];
+		ADD_TO_ZONE(zone, elem);
+	}
+}
+
+/*
+ *	Empty the depot of a zone: full magazines go back
+ *	on the zone free list, and all of them are freed.
+ *	The magazines loaded on each processor are left
+ *	alone; they are the working set.
+ */
+static
+void
+zone_depot_trim(zone)
+	register zone_t	zone;
+{
+	struct zone_magazine	*mag, *mags = 0;
+
+	lock_zone(zone);
+	while ((mag = zone->depot_full) != 0) {
+		zone->depot_full = mag->zm_next;
+		zone_magazine_unload(zone, mag, mag->zm_count);
+		mag->zm_next = mags;
+		mags = mag;
+	}
+	while ((mag = zone->depot_empty) != 0) {
+		zone->depot_empty = mag->zm_next;
+		mag->zm_next = mags;
+		mags = mag;
+	}
+	zone->depot_nfull = zone->depot_nempty = 0;
+	unlock_zone(zone);
+
+	while ((mag = mags) != 0) {
+		mags = mag->zm_next;
+		zfree(zone_magazine_zone, (vm_offset_t)mag);
+	}
+}
+
+/*
+ *	Empty every magazine of a zone, on every processor
+ *	and in the depot, back into the zone free list, and
+ *	free the magazines themselves.
+ */
+void
+zone_magazine_drain(zone)
+	register zone_t	zone;
+{
+	register struct zone_cpu_cache	*cc;
+	struct zone_magazine		*mag, *mags = 0;
+	int				i;
+	spl_t				s;
+
+	if (zone->pageable)
+		return;
+
+	for (i = 0; i < NCPUS; i++) {
+		cc = &zone->cpu_cache[i];
+		s = splhigh();
+		simple_lock(&cc->zc_lock);
+		lock_zone(zone);
+		if ((mag = cc->zc_loaded) != 0) {
+			zone_magazine_unload(zone, mag, cc->zc_lrounds);
+			mag->zm_next = mags;
+			mags = mag;
+		}
+		if ((mag = cc->zc_previous) != 0) {
+			zone_magazine_unload(zone, mag, cc->zc_prounds);
+			mag->zm_next = mags;
+			mags = mag;
+		}
+		cc->zc_loaded = cc->zc_previous = 0;
+		cc->zc_lrounds = cc->zc_prounds = 0;
+		unlock_zone(zone);
+		simple_unlock(&cc->zc_lock);
+		splx(s);
+	}
+
+	while ((mag = mags) != 0) {
+		mags = mag->zm_next;
+		zfree(zone_magazine_zone, (vm_offset_t)mag);
+	}
+
+	zone_depot_trim(zone);
+}
+
+/*
+ *	Change the magazine size of a zone.  The magazine
+ *	layer is shut off and drained first, so that no
+ *	magazine of the old size survives.
+ */
+void
+zmagazine(zone, rounds)
+	register zone_t	zone;
+	int		rounds;
+{
+	if (rounds < 0 || zone->pageable || zone->exhaustible ||
+	    zone == zone_magazine_zone || zone_magazine_zone == ZONE_NULL)
+		rounds = 0;
+	else if (rounds > ZMAG_ROUNDS_MAX)
+		rounds = ZMAG_ROUNDS_MAX;
+
+	zone->mag_rounds = 0;
+	zone_magazine_drain(zone);
+	zone->mag_rounds = rounds;
+}
+
+/*
+ *	Turn the magazine layer of all zones on or off.
+ *	Zones keep their magazine size; while the layer
+ *	is off it is bypassed, and what it held is put
+ *	back on the free lists.
+ */
+void
+zone_magazine_enable(enable)
+	boolean_t	enable;
+{
+	zone_t		z;
+	int		max_zones, i;
+
+	zone_magazines_enabled = enable;
+	if (enable)
+		return;
+
+	simple_lock(simple_lock_addr(all_zones_lock));
+	max_zones = num_zones;
+	z = first_zone;
+	simple_unlock(simple_lock_addr(all_zones_lock));
+
+	for (i = 0; i < max_zones; i++) {
+		assert(z != ZONE_NULL);
+		zone_magazine_drain(z);
+		simple_lock(simple_lock_addr(all_zones_lock));
+		z = z->next_zone;
+		simple_unlock(simple_lock_addr(all_zones_lock));
+	}
+}
+
+unsigned	zone_gc_last_tick = 0;
+
+/*
+ *	zone_gc:
+ *
+ *	Called by the pageout daemon when the system needs more
+ *	free pages.  Full and empty magazines sitting in the depots
+ *	are given back: their elements return to the zone free lists,
+ *	where zone_collect() can find them, and the magazines to
+ *	their own zone.  At most once a second.
+ */
+void
+zone_gc()
+{
+	zone_t		z;
+	int		max_zones, i;
+
+	if (sched_tick == zone_gc_last_tick)
+		return;
+	zone_gc_last_tick = sched_tick;
+
+	simple_lock(simple_lock_addr(all_zones_lock));
+	max_zones = num_zones;
+	z = first_zone;
+	simple_unlock(simple_lock_addr(all_zones_lock));
+
+	for (i = 0; i < max_zones; i++) {
+		assert(z != ZONE_NULL);
+		if (!z->pageable && z != zone_magazine_zone)
+			zone_depot_trim(z);
+		simple_lock(simple_lock_addr(all_zones_lock));
+		z = z->next_zone;
+		simple_unlock(simple_lock_addr(all_zones_lock));
+	}
+}
+
 /*
  *	zalloc returns an element from the specified zone.
  */
@@ -1466,10 +1896,15 @@ vm_offset_t zalloc_canblock(zone, canblock)
 	boolean_t canblock;
 {
 	vm_offset_t	addr;
+	boolean_t	drained = FALSE;
 
 	if (zone == ZONE_NULL)
 		panic ("zalloc: null zone");
 
+	if (zone_magazine_usable(zone) &&
+	    (addr = zone_magazine_alloc(zone)) != 0)
+		return(addr);
+
 	lock_zone(zone);
 	if (zone_check & 8)
 		check_zone(zone, 0);
@@ -1512,6 +1947,20 @@ vm_offset_t zalloc_canblock(zone, canblock)
 					 * leak. 
 					 */
 					zone->max_size += (zone->max_size >> 1);
+				} else if (zone->mag_rounds > 0 && !drained) {
+					/*
+					 * The zone is at its limit, but free
+					 * elements may be parked in magazines
+					 * on other processors or in the depot.
+					 * Put them back on the free list and
+					 * look again before giving up.
+					 */
+					unlock_zone(zone);
+					zone_magazine_drain(zone);
+					drained = TRUE;
+					lock_zone(zone);
+					REMOVE_FROM_ZONE(zone, addr, vm_offset_t);
+					continue;
 				} else if (!zone_ignore_overflow) {
 					unlock_zone(zone);
 					if (!canblock)
@@ -1593,6 +2042,10 @@ vm_offset_t zget(zone)
 	if (zone == ZONE_NULL)
 		panic ("zalloc: null zone");
 
+	if (zone_magazine_usable(zone) &&
+	    (addr = zone_magazine_alloc(zone)) != 0)
+		return(addr);
+
 	lock_zone(zone);
 	if (zone_check & 4)
 		check_zone(zone, 0);
@@ -1607,11 +2060,14 @@ zfree(zone, elem)
 	register zone_t	zone;
 	vm_offset_t	elem;
 {
-	lock_zone(zone);
 #if DIAGNOSTIC
 	if (elem < zone->lowest || elem > zone->highest)
 		panic("zfree: argument out of range");
 #endif
+	if (zone_magazine_usable(zone) && zone_magazine_free(zone, elem))
+		return;
+
+	lock_zone(zone);
 	if (zone_check & 2)
 		check_zone(zone, elem);
 	ADD_TO_ZONE(zone, elem);
@@ -1632,6 +2088,13 @@ void zchange(zone, pageable, sleepable, exhaustible, collectable)
 	boolean_t	exhaustible;
 	boolean_t	collectable;
 {
+	/*
+	 * Magazines would hide free elements from other processors,
+	 * which is not acceptable for zones that are allowed to run
+	 * dry or that live in fixed memory.
+	 */
+	if (pageable || exhaustible || !collectable)
+		zmagazine(zone, 0);
 	zone->pageable = pageable;
 	zone->sleepable = sleepable;
 	zone->exhaustible = exhaustible;
@@ -1709,11 +2172,17 @@ kern_return_t host_zone_info(host, namesp, namesCntp, infop, infoCntp)
 		zone_name_t *zn = &names[i];
 		zone_info_t *zi = &info[i];
 		struct zone zcopy;
+		struct zone_magazine *mag;
+		struct zone_cpu_cache *cc;
+		integer_t cached = 0;
+		int cpu;
 
 		assert(z != ZONE_NULL);
 
 		lock_zone(z);
 		zcopy = *z;
+		for (mag = z->depot_full; mag != 0; mag = mag->zm_next)
+			cached += mag->zm_count;
 		unlock_zone(z);
 
 		simple_lock(simple_lock_addr(all_zones_lock));
@@ -1724,7 +2193,18 @@ kern_return_t host_zone_info(host, namesp, namesCntp, infop, infoCntp)
 		(void) strncpy(zn->zn_name, zcopy.zone_name,
 			       sizeof zn->zn_name);
 
-		zi->zi_count = zcopy.count;
+		zi->zi_mag_allocs = zi->zi_mag_alloc_hits = 0;
+		zi->zi_mag_frees = zi->zi_mag_free_hits = 0;
+		for (cpu = 0; cpu < NCPUS; cpu++) {
+			cc = &zcopy.cpu_cache[cpu];
+			cached += cc->zc_lrounds + cc->zc_prounds;
+			zi->zi_mag_allocs += cc->zc_allocs;
+			zi->zi_mag_alloc_hits += cc->zc_alloc_hits;
+			zi->zi_mag_frees += cc->zc_frees;
+			zi->zi_mag_free_hits += cc->zc_free_hits;
+		}
+
+		zi->zi_count = zcopy.count - cached;
 		zi->zi_cur_size = zcopy.cur_size;
 		zi->zi_max_size = zcopy.max_size;
 		zi->zi_elem_size = zcopy.elem_size;
@@ -1733,6 +2213,13 @@ kern_return_t host_zone_info(host, namesp, namesCntp, infop, infoCntp)
 		zi->zi_sleepable = zcopy.sleepable;
 		zi->zi_exhaustible = zcopy.exhaustible;
 		zi->zi_collectable = zone_collectable(&zcopy);
+		zi->zi_mag_rounds = zcopy.mag_rounds;
+		zi->zi_mag_cached = cached;
+		zi->zi_depot_full = zcopy.depot_nfull;
+		zi->zi_depot_empty = zcopy.depot_nempty;
+		zi->zi_depot_gets = zcopy.depot_gets;
+		zi->zi_depot_puts = zcopy.depot_puts;
+		zi->zi_lock_contended = zcopy.lock_contended;
 	}
 
 	if (names != *namesp) {
@@ -2048,6 +2535,23 @@ kern_return_t host_zone_collect(
 
 	if (!collect_zones)
 	    return KERN_SUCCESS;
+
+	/*
+	 * Elements held in magazines look allocated to
+	 * zone_collect(); return them to the free lists first.
+	 */
+	simple_lock(simple_lock_addr(all_zones_lock));
+	max_zones = num_zones;
+	z = first_zone;
+	simple_unlock(simple_lock_addr(all_zones_lock));
+
+	for (i = 0; i < max_zones; i++) {
+		assert(z != ZONE_NULL);
+		zone_magazine_drain(z);
+		simple_lock(simple_lock_addr(all_zones_lock));
+		z = z->next_zone;
+		simple_unlock(simple_lock_addr(all_zones_lock));
+	}
 	
 	simple_lock(simple_lock_addr(zget_space_lock));
 
@@ -80,6 +80,37 @@
  *
  */
 
+/*
+ *	Zones which are neither pageable nor exhaustible are fronted
+ *	by a magazine layer.  A magazine is an array of up to
+ *	ZMAG_ROUNDS_MAX free elements ("rounds").  Each processor keeps
+ *	a loaded and a previous magazine per zone, and allocates and
+ *	frees from them without touching the zone lock.  When both are
+ *	empty (allocating) or full (freeing), a magazine is exchanged
+ *	with the zone's depot, which holds lists of full and empty
+ *	magazines and is protected by the zone lock.  Only a miss in
+ *	the depot goes to the zone free list.
+ */
+#define ZMAG_ROUNDS_MAX		14
+
+struct zone_magazine {
+	struct zone_magazine *	zm_next;	/* depot link */
+	int			zm_count;	/* rounds, while in depot */
+	vm_offset_t		zm_rounds[ZMAG_ROUNDS_MAX];
+};
+
+struct zone_cpu_cache {
+	decl_simple_lock_data(,zc_lock)		/* taken at splhigh */
+	struct zone_magazine *	zc_loaded;	/* magazine in use */
+	struct zone_magazine *	zc_previous;	/* full or empty */
+	int			zc_lrounds;	/* rounds in zc_loaded */
+	int			zc_prounds;	/* rounds in zc_previous */
+	unsigned int		zc_allocs;	/* allocations attempted */
+	unsigned int		zc_alloc_hits;	/* ... satisfied here */
+	unsigned int		zc_frees;	/* frees attempted */
+	unsigned int		zc_free_hits;	/* ... satisfied here */
+};
+
 typedef struct zone {
 	decl_simple_lock_data(,lock)	/* generic lock */
 	spl_t		lock_ipl;
@@ -101,6 +132,18 @@ typedef struct zone {
 	struct zone_free_space *
 			free_space;	/* where to get new elements from */
 	struct zone *	next_zone;	/* Link for all-zones list */
+	int		mag_rounds;	/* magazine size, 0 if none */
+	struct zone_magazine *
+			depot_full;	/* full magazines */
+	struct zone_magazine *
+			depot_empty;	/* empty magazines */
+	int		depot_nfull;	/* number of full magazines */
+	int		depot_nempty;	/* number of empty magazines */
+	unsigned int	depot_gets;	/* magazines taken from depot */
+	unsigned int	depot_puts;	/* magazines returned to depot */
+	unsigned int	lock_contended;	/* zone lock found held */
+	struct zone_cpu_cache
+			cpu_cache[NCPUS];
 #if DIAGNOSTIC
 	vm_offset_t	lowest, highest;
 #endif
@@ -136,6 +179,23 @@ extern void		zchange(zone_t		zone,
 				boolean_t	exhaustible,
 				boolean_t	collectable);
 
+			/* set the number of rounds per magazine
+			 * (0 disables the magazine layer) */
+extern void		zmagazine(zone_t	zone,
+				int		rounds);
+
+			/* return all elements held in magazines
+			 * to the zone free list */
+extern void		zone_magazine_drain(zone_t	zone);
+
+			/* turn the magazine layer of all
+			 * zones on or off */
+extern void		zone_magazine_enable(boolean_t	enable);
+
+			/* give back the magazine depots
+			 * when memory is short */
+extern void		zone_gc(void);
+
 			/* zones are collectable by default
 			 * and cannot later be changed back to collectable */
 extern void		zcollectable(zone_t	zone);
@@ -77,6 +77,9 @@ typedef char	kernel_version_t[KERNEL_VERSION_MAX];
 #define HOST_PROCESSOR_SLOTS	2	/* processor slot numbers */
 #define HOST_SCHED_INFO		3	/* scheduling info */
 #define	HOST_LOAD_INFO		4	/* avenrun/mach_factor info */
+#define	HOST_SCHED_CPU_INFO	5	/* per-processor scheduler counters */
+#define	HOST_VM_PAGEOUT_INFO	6	/* page replacement counters */
+#define	HOST_VM_FAULT_INFO	7	/* pagein clustering counters */
 
 struct host_basic_info {
 	integer_t	max_cpus;	/* max number of cpus possible */
@@ -111,4 +114,69 @@ typedef struct host_load_info	*host_load_info_t;
 #define	HOST_LOAD_INFO_COUNT \
 		(sizeof(host_load_info_data_t)/sizeof(natural_t))
 
+/*
+ *	HOST_SCHED_CPU_INFO returns one of these for each processor slot
+ *	holding a cpu; *count comes back as a multiple of
+ *	HOST_SCHED_CPU_INFO_COUNT.  Counters are cumulative and wrap.
+ */
+struct host_sched_cpu_info {
+	integer_t	slot_num;	/* processor slot */
+	integer_t	state;		/* PROCESSOR_RUNNING, etc. */
+	integer_t	context_switches;
+	integer_t	steals;		/* threads taken from other cpus */
+	integer_t	migrations;	/* threads queued away from last cpu */
+	integer_t	queue_depth;	/* threads now queued on this cpu */
+};
+
+typedef struct host_sched_cpu_info	host_sched_cpu_info_data_t;
+typedef struct host_sched_cpu_info	*host_sched_cpu_info_t;
+#define	HOST_SCHED_CPU_INFO_COUNT \
+		(sizeof(host_sched_cpu_info_data_t)/sizeof(natural_t))
+
+/*
+ *	HOST_VM_PAGEOUT_INFO describes the pageout daemon's work on
+ *	each class of page: anonymous memory (including memory paged
+ *	out to the swapfile) and pages of files.  Inactive pages are
+ *	candidates for reclaim; a refault is a page faulted back in
+ *	soon after it was reclaimed.  Counters are cumulative and wrap.
+ */
+struct host_vm_pageout_queue {
+	integer_t	inactive;	/* pages now inactive */
+	integer_t	scanned;	/* inactive pages examined */
+	integer_t	reclaimed;	/* inactive pages freed */
+	integer_t	activated;	/* inactive pages referenced again */
+	integer_t	refaults;	/* reclaimed pages wanted again */
+};
+
+struct host_vm_pageout_info {
+	integer_t	active;		/* pages now active */
+	integer_t	inactive_target;/* inactive pages wanted, adapts */
+	integer_t	history_size;	/* reclaimed pages remembered */
+	integer_t	active_scanned;	/* active pages examined */
+	integer_t	deactivated;	/* active pages made inactive */
+	struct host_vm_pageout_queue	anon;
+	struct host_vm_pageout_queue	file;
+};
+
+typedef struct host_vm_pageout_info	host_vm_pageout_info_data_t;
+typedef struct host_vm_pageout_info	*host_vm_pageout_info_t;
+#define	HOST_VM_PAGEOUT_INFO_COUNT \
+		(sizeof(host_vm_pageout_info_data_t)/sizeof(natural_t))
+
+/*
+ *	HOST_VM_FAULT_INFO counts the work saved by clustered pagein
+ *	and fault-around, to be set against the fault and pagein
+ *	counts of vm_statistics.  Counters are cumulative and wrap.
+ */
+struct host_vm_fault_info {
+	integer_t	pagein_ios;	/* pager reads issued */
+	integer_t	faultaround;	/* pages mapped around faults */
+	integer_t	execs;		/* programs loaded */
+};
+
+typedef struct host_vm_fault_info	host_vm_fault_info_data_t;
+typedef struct host_vm_fault_info	*host_vm_fault_info_t;
+#define	HOST_VM_FAULT_INFO_COUNT \
+		(sizeof(host_vm_fault_info_data_t)/sizeof(natural_t))
+
 #endif	/* _MACH_HOST_INFO_H_ */
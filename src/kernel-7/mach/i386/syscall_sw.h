@@ -41,7 +41,7 @@
 #define kernel_trap_args_5
 #define kernel_trap_args_6
 #define kernel_trap_args_7
-#define kernel_trap_args_9
+#define kernel_trap_args_8
 #define kernel_trap_args_9
 
 #define save_registers_0
@@ -76,6 +76,7 @@
 #define	kernel_trap_args_5
 #define	kernel_trap_args_6
 #define	kernel_trap_args_7
+#define	kernel_trap_args_8
 
 /*
  * simple_kernel_trap -- Mach system calls with 8 or less args
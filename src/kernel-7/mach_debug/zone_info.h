@@ -78,6 +78,17 @@ typedef struct zone_info {
 /*boolean_t*/integer_t	zi_sleepable;	/* sleep if empty? */
 /*boolean_t*/integer_t	zi_exhaustible;	/* merely return if empty? */
 /*boolean_t*/integer_t	zi_collectable;	/* garbage collect elements? */
+	integer_t	zi_mag_rounds;	/* magazine size, 0 if none */
+	integer_t	zi_mag_cached;	/* free elements held in magazines */
+	integer_t	zi_mag_allocs;	/* allocations tried in magazines */
+	integer_t	zi_mag_alloc_hits; /* ... and satisfied there */
+	integer_t	zi_mag_frees;	/* frees tried in magazines */
+	integer_t	zi_mag_free_hits; /* ... and satisfied there */
+	integer_t	zi_depot_full;	/* full magazines in depot */
+	integer_t	zi_depot_empty;	/* empty magazines in depot */
+	integer_t	zi_depot_gets;	/* magazines taken from depot */
+	integer_t	zi_depot_puts;	/* magazines returned to depot */
+	integer_t	zi_lock_contended; /* zone lock found held */
 } zone_info_t;
 
 typedef zone_info_t *zone_info_array_t;
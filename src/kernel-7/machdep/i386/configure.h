@@ -38,6 +38,7 @@ typedef struct cpu_conf {
 #define FPU_NONE	0
 #define FPU_EMUL	1
 #define FPU_HDW		2
+			mmx		:1,	/* MMX usable by the kernel */
 					:0;
 } cpu_conf_t;
 
@@ -54,4 +54,8 @@ fp_terminate(
 ),
 fp_synch(
 	thread_t		thread
-);
+),
+fp_kernel_end(void);
+
+boolean_t
+fp_kernel_begin(void);
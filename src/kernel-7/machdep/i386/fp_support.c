@@ -42,6 +42,7 @@
 #import <machdep/i386/fp_inline.h>
 #import <machdep/i386/fp_exported.h>
 #import <machdep/i386/configure.h>
+#import <kernserv/i386/spl.h>
 
 #import <fp_emul.h>
 #if	FP_EMUL
@@ -55,6 +56,7 @@
 #endif
 
 static thread_t	fp_thread;
+static boolean_t	fp_kernel_busy;
 
 static
 inline void	fp_init(fp_state_t		*fpstate),
@@ -139,6 +141,8 @@ fp_noextension(
     thread_saved_state_t	*state
 )
 {
+    int			s;
+
     if (cpu_config.fpu_type == FPU_NONE) {
 	/*
 	 * If we are not providing
@@ -151,9 +155,14 @@ fp_noextension(
     
     /*
      * Switch the fpu context
-     * if necessary.
+     * if necessary.  Interrupts are
+     * held off so that a kernel borrower
+     * (fp_kernel_begin) never finds the
+     * FPU half way through a switch.
      */
+    s = splhigh();
     fp_switch();
+    splx(s);
 
 #if	FP_EMUL
     if (cpu_config.fpu_type ==  FPU_EMUL) {
@@ -177,14 +186,18 @@ fp_extension_fault(
     thread_saved_state_t	*state
 )
 {
-    thread_t		exception_thread = fp_thread;
+    thread_t		exception_thread;
+    int			s;
 
     /*
      * Stop the floating point unit
      * dead in its tracks.  We do not
      * want another exception to occur.
      */
+    s = splhigh();
+    exception_thread = fp_thread;
     fp_save();		// sets fp_thread = THREAD_NULL
+    splx(s);
     
     if (exception_thread == current_thread()) {
     	exception(EXC_ARITHMETIC, EXC_I386_EXTENSION_FAULT, 0);
@@ -203,12 +216,16 @@ fp_kernel_extension_fault(
     thread_saved_state_t	*state
 )
 {
-    thread_t		exception_thread = fp_thread;
+    thread_t		exception_thread;
+    int			s;
     
     /*
      * Stop the floating point unit.
      */
+    s = splhigh();
+    exception_thread = fp_thread;
     fp_save();		// sets fp_thread = THREAD_NULL
+    splx(s);
     
     thread_ast_set(exception_thread, AST_FP_EXTEN);
     if (exception_thread == current_thread())
@@ -514,8 +531,11 @@ fp_terminate(
     thread_t	thread
 )
 {
+    int		s = splhigh();
+
     if (thread == fp_thread)
 	fp_unowned();
+    splx(s);
 }
 
 /*
@@ -531,10 +551,52 @@ fp_synch(
     thread_t	thread
 )
 {
+    int		s = splhigh();
+
     if (thread == fp_thread)
 	fp_save();
     else {
 	if (!thread->pcb->fpvalid)
 	    fp_init(&thread->pcb->fpstate);
     }
+    splx(s);
+}
+
+/*
+ * Borrow the FPU for use by the
+ * kernel itself (MMX block loops).
+ * The owner's context is saved, so
+ * its next floating point instruction
+ * faults it back in.  Only the save
+ * runs at splhigh; the caller keeps
+ * its own spl, and an interrupt that
+ * wants the FPU while it is lent is
+ * refused (FALSE) and must use integer
+ * code.  The caller must not block or
+ * take a fault until fp_kernel_end().
+ */
+
+boolean_t
+fp_kernel_begin(void)
+{
+    int		s = splhigh();
+
+    if (fp_kernel_busy) {
+	splx(s);
+	return (FALSE);
+    }
+    fp_kernel_busy = TRUE;
+    fp_save();		// sets fp_thread = THREAD_NULL
+    clts();
+    splx(s);
+
+    return (TRUE);
+}
+
+void
+fp_kernel_end(void)
+{
+    asm volatile("emms");
+    setts();
+    fp_kernel_busy = FALSE;
 }
@@ -55,6 +55,8 @@ extern char rootdevice[];
 extern int nbuf;
 extern int srv;
 extern int ncl;
+extern int cksum_mmx;
+extern void in_cksum_configure(void);
 static unsigned int maxmem;
 static int subtype = 0;
 
@@ -68,6 +70,7 @@ struct kernargs {
 	"subtype", &subtype,
 	"srv", &srv,
 	"ncl", &ncl,
+	"cksum_mmx", &cksum_mmx,
 	0,0,
 };
 
@@ -329,6 +332,39 @@ get_cpuid(void)
     return pid;
 }
 
+#define CPUID_FEAT_MMX	0x00800000	/* MMX instructions (EDX bit 23) */
+
+/*
+ * Return the standard feature
+ * flags (CPUID function 1, EDX),
+ * or zero if CPUID is not supported.
+ */
+static
+unsigned int
+cpuid_features(void)
+{
+    unsigned int	efl, efl_saved, features;
+
+    efl_saved = eflags();
+    set_eflags(efl_saved | EFL_ID);
+    efl = eflags();
+    set_eflags(efl_saved);
+
+    if ((efl & EFL_ID) == 0)
+    	return 0;
+
+    asm volatile(
+	"pushl %%ebx\n\t"		/* Save ebx (required for PIC) */
+	"movl $1,%%eax\n\t"
+	"cpuid\n\t"
+	"popl %%ebx"			/* Restore ebx */
+	    : "=d" (features)
+	    :
+	    : "eax", "ecx");
+
+    return (features);
+}
+
 char cpu_model[65];
 char machine[65];
 
@@ -348,6 +384,16 @@ machine_configure(void)
 
     fp_configure();
 
+    /*
+     * MMX shares the floating point
+     * registers, so the kernel only uses
+     * it when there is a hardware FPU.
+     */
+    if (cpu_config.fpu_type == FPU_HDW &&
+	    (cpuid_features() & CPUID_FEAT_MMX) != 0)
+	cpu_config.mmx = 1;
+    in_cksum_configure();
+
     machine_slot[0].is_cpu = TRUE;
     machine_slot[0].running = TRUE;
 
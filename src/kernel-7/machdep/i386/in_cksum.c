@@ -37,6 +37,9 @@
  */
 
 /* HISTORY
+ * Unrolled the main loop to 32-byte blocks, added an MMX block
+ * loop chosen at boot, and in_cksum_copy() for copy-and-checksum.
+ *
  * 26-May-94 Curtis Galloway at NeXT
  *	Grabbed the m68k code and added a Pentium-optimized checksummer.
  *	(See RFC 1107 for the checksum algorithm.)
@@ -50,6 +53,8 @@
 #include <sys/mbuf.h>
 #include <netinet/in.h>
 #include <netinet/in_systm.h>
+#import <machdep/i386/configure.h>
+#import <machdep/i386/fp_exported.h>
 
 #if defined(NX_CURRENT_COMPILER_RELEASE) && (NX_CURRENT_COMPILER_RELEASE < 320)
 #define SIREG "e"
@@ -57,6 +62,36 @@
 #define SIREG "S"
 #endif
 
+/*
+ * Borrowing the FPU for MMX costs an fnsave of the
+ * owner's context, so the MMX loop is only used for
+ * runs of at least CKSUM_MMX_MIN bytes.  Each of its
+ * 32-bit lanes takes 8 words per 32-byte block, so
+ * the lanes are folded every CKSUM_MMX_MAXBLOCKS.
+ */
+#define CKSUM_MMX_MIN		1024
+#define CKSUM_MMX_MAXBLOCKS	8192
+
+/*
+ * The MMX loop has so far measured slower than the
+ * adc loop (see cksumbench), so it is off unless
+ * booted with cksum_mmx=1.
+ */
+int		cksum_mmx = 0;
+static int	oc_cksum_use_mmx;
+
+#define ADDC(sum, x) \
+	{ (sum) += (x); if ((sum) < (x)) (sum)++; }
+
+/*
+ * Select the block loop; called
+ * from machine_configure().
+ */
+void
+in_cksum_configure(void)
+{
+	oc_cksum_use_mmx = cksum_mmx && cpu_config.mmx;
+}
 
 #if	DEBUG_OC
 
@@ -85,8 +120,12 @@ oc_cksum(
 
 #else	DEBUG_OC
 
+/*
+ * Sum a short run of bytes (the
+ * remainder after the block loops).
+ */
 static inline int
-oc_cksum(
+oc_cksum_tail(
     unsigned char *buf,
     int len,
     unsigned long oldsum
@@ -160,6 +199,181 @@ oc_cksum(
     return sum;
 }
 
+/*
+ * Sum nblocks 32-byte blocks into a 32-bit
+ * partial sum.  lea and dec leave the carry
+ * flag alone, so one adc chain runs the
+ * length of the buffer.
+ */
+static inline unsigned long
+oc_cksum_blocks(
+    unsigned char *buf,
+    int nblocks,
+    unsigned long sum
+)
+{
+    asm("
+	clc
+1:
+	adcl	0(%%esi),%%eax
+	adcl	4(%%esi),%%eax
+	adcl	8(%%esi),%%eax
+	adcl	12(%%esi),%%eax
+	adcl	16(%%esi),%%eax
+	adcl	20(%%esi),%%eax
+	adcl	24(%%esi),%%eax
+	adcl	28(%%esi),%%eax
+	leal	32(%%esi),%%esi
+	decl	%%ecx
+	jnz	1b
+	adcl	$0,%%eax
+    " : "=a" (sum) : "c" (nblocks), SIREG (buf), "a" (sum) :
+    "ecx", "esi");
+
+    return sum;
+}
+
+/*
+ * MMX block loop: widen each word to 32 bits
+ * against a zero register and add the words
+ * into four 32-bit lanes (mm5, mm6), which are
+ * then folded into the adc sum.  No carries are
+ * lost so long as nblocks <= CKSUM_MMX_MAXBLOCKS.
+ * If the FPU is already lent (an interrupt came
+ * in during another sum) the adc loop is used.
+ */
+static unsigned long
+oc_cksum_mmx(
+    unsigned char *buf,
+    int nblocks,
+    unsigned long sum
+)
+{
+    unsigned long	lanes[2];
+    int			n;
+
+    if (!fp_kernel_begin())
+	return oc_cksum_blocks(buf, nblocks, sum);
+    while (nblocks > 0) {
+	n = nblocks > CKSUM_MMX_MAXBLOCKS ? CKSUM_MMX_MAXBLOCKS : nblocks;
+	asm volatile("
+	pxor	%%mm7,%%mm7		// zero, for unpacking
+	pxor	%%mm6,%%mm6
+	pxor	%%mm5,%%mm5
+1:
+	movq	0(%%esi),%%mm0
+	movq	8(%%esi),%%mm2
+	movq	%%mm0,%%mm1
+	movq	%%mm2,%%mm3
+	punpcklwd %%mm7,%%mm0
+	punpckhwd %%mm7,%%mm1
+	punpcklwd %%mm7,%%mm2
+	punpckhwd %%mm7,%%mm3
+	paddd	%%mm0,%%mm6
+	paddd	%%mm1,%%mm5
+	paddd	%%mm2,%%mm6
+	paddd	%%mm3,%%mm5
+	movq	16(%%esi),%%mm0
+	movq	24(%%esi),%%mm2
+	movq	%%mm0,%%mm1
+	movq	%%mm2,%%mm3
+	punpcklwd %%mm7,%%mm0
+	punpckhwd %%mm7,%%mm1
+	punpcklwd %%mm7,%%mm2
+	punpckhwd %%mm7,%%mm3
+	paddd	%%mm0,%%mm6
+	paddd	%%mm1,%%mm5
+	paddd	%%mm2,%%mm6
+	paddd	%%mm3,%%mm5
+	addl	$32,%%esi
+	decl	%%ecx
+	jnz	1b
+	paddd	%%mm5,%%mm6
+	movq	%%mm6,(%%edi)
+	" : : "c" (n), SIREG (buf), "D" (lanes) :
+	"ecx", "esi", "memory");
+
+	ADDC(sum, lanes[0]);
+	ADDC(sum, lanes[1]);
+	buf += n << 5;
+	nblocks -= n;
+    }
+    fp_kernel_end();
+
+    return sum;
+}
+
+/*
+ * As oc_cksum_blocks(), storing each
+ * dword to dst as it is summed.
+ */
+static inline unsigned long
+oc_cksum_copy_blocks(
+    unsigned char *src,
+    unsigned char *dst,
+    int nblocks,
+    unsigned long sum
+)
+{
+    asm("
+	clc
+1:
+	movl	0(%%esi),%%edx
+	movl	4(%%esi),%%ebx
+	adcl	%%edx,%%eax
+	movl	%%edx,0(%%edi)
+	adcl	%%ebx,%%eax
+	movl	%%ebx,4(%%edi)
+	movl	8(%%esi),%%edx
+	movl	12(%%esi),%%ebx
+	adcl	%%edx,%%eax
+	movl	%%edx,8(%%edi)
+	adcl	%%ebx,%%eax
+	movl	%%ebx,12(%%edi)
+	movl	16(%%esi),%%edx
+	movl	20(%%esi),%%ebx
+	adcl	%%edx,%%eax
+	movl	%%edx,16(%%edi)
+	adcl	%%ebx,%%eax
+	movl	%%ebx,20(%%edi)
+	movl	24(%%esi),%%edx
+	movl	28(%%esi),%%ebx
+	adcl	%%edx,%%eax
+	movl	%%edx,24(%%edi)
+	adcl	%%ebx,%%eax
+	movl	%%ebx,28(%%edi)
+	leal	32(%%esi),%%esi
+	leal	32(%%edi),%%edi
+	decl	%%ecx
+	jnz	1b
+	adcl	$0,%%eax
+    " : "=a" (sum) : "c" (nblocks), SIREG (src), "D" (dst), "a" (sum) :
+    "ebx", "ecx", "edx", "esi", "edi", "memory");
+
+    return sum;
+}
+
+static inline int
+oc_cksum(
+    unsigned char *buf,
+    int len,
+    unsigned long oldsum
+)
+{
+    int		nblocks;
+
+    if ((nblocks = len >> 5) > 0) {
+	if (oc_cksum_use_mmx && len >= CKSUM_MMX_MIN)
+	    oldsum = oc_cksum_mmx(buf, nblocks, oldsum);
+	else
+	    oldsum = oc_cksum_blocks(buf, nblocks, oldsum);
+	buf += nblocks << 5;
+	len &= 31;
+    }
+
+    return oc_cksum_tail(buf, len, oldsum);
+}
+
 #endif	DEBUG_OC
 
 
@@ -225,6 +439,39 @@ in_cksum(m, len)
 	return (0xffff & ~oc_cksum(mtod(m, u_char *), len, sum));
 }
 
+/*
+ * Copy len bytes from src to dst, returning
+ * the 16-bit ones-complement sum of the bytes
+ * (not complemented) as it would be if they
+ * began at an even offset in the packet.
+ * Each byte is loaded once; only the short
+ * tail is summed again, from dst.
+ */
+u_int
+in_cksum_copy(src, dst, len)
+	caddr_t src;
+	caddr_t dst;
+	register int len;
+{
+	register unsigned long sum = 0;
+#if	DEBUG_OC
+
+	bcopy(src, dst, len);
+#else	DEBUG_OC
+	register int nblocks;
+
+	if ((nblocks = len >> 5) > 0) {
+		sum = oc_cksum_copy_blocks((u_char *)src, (u_char *)dst,
+		    nblocks, sum);
+		src += nblocks << 5;
+		dst += nblocks << 5;
+		len &= 31;
+	}
+	bcopy(src, dst, len);
+#endif	DEBUG_OC
+	return (0xffff & oc_cksum((u_char *)dst, len, sum));
+}
+
 
 /*
  * Checksum routine for Internet Protocol family headers (Portable Version).
@@ -51,8 +51,266 @@
 #import <vm/pmap.h>
 #import <mach/vm_statistics.h>
 #import <vm/vm_pageout.h>
+#import <vm/vm_pager.h>
+#import <vm/vnode_pager.h>
+#import <vm/vm_fault.h>
 #import <mach/vm_param.h>
 
+/*
+ *	Fault clustering.  A fault that must go to the pager reads
+ *	its non-resident neighbours along with it, in one pager
+ *	operation: an aligned cluster of VM_FAULT_CLUSTER_RANDOM
+ *	pages around a random fault, and a window ahead of a
+ *	sequential one that doubles with each fault in the run, up
+ *	to VM_FAULT_CLUSTER_MAX.  Whether faults in a map entry are
+ *	sequential is kept in the entry.
+ *
+ *	Fault-around.  A read fault on a file page also maps the
+ *	resident pages of the VM_FAULT_AROUND page window around it
+ *	that are not mapped yet, read-only, so a program walking its
+ *	text or a mapped file does not fault on pages already in
+ *	memory.
+ */
+#define	VM_FAULT_CLUSTER_RANDOM	4
+#define	VM_FAULT_CLUSTER_MAX	VNODE_PAGER_CLUSTER_MAX
+#define	VM_FAULT_AROUND		16
+
+host_vm_fault_info_data_t	vm_fault_stat;
+decl_simple_lock_data(,vm_fault_stat_lock)	/* updates to vm_fault_stat */
+
+/*
+ *	vm_fault_window:
+ *
+ *	Note a fault at vaddr in the given map entry, and return
+ *	how many pages before and after it are worth reading with
+ *	it.  A fault a little past the last one continues a
+ *	sequential run; a fault at the same address is a retry and
+ *	changes nothing.  The entry's hints are updated under the
+ *	map's read lock, so they may be lost in a race.
+ */
+static void
+vm_fault_window(entry, vaddr, behind, ahead)
+	vm_map_entry_t	entry;
+	vm_offset_t	vaddr;
+	int		*behind;
+	int		*ahead;
+{
+	vm_offset_t	start;
+	int		n;
+
+	if (vaddr > entry->last_fault &&
+	    vaddr - entry->last_fault <= ptoa(VM_FAULT_CLUSTER_MAX)) {
+		if (entry->sequential < VM_FAULT_CLUSTER_MAX)
+			entry->sequential++;
+	}
+	else if (vaddr != entry->last_fault)
+		entry->sequential = 0;
+	entry->last_fault = vaddr;
+
+	if (entry->sequential > 0) {
+		n = VM_FAULT_CLUSTER_RANDOM;
+		while (n < VM_FAULT_CLUSTER_MAX &&
+		       n < (VM_FAULT_CLUSTER_RANDOM << entry->sequential))
+			n <<= 1;
+		*behind = 0;
+		*ahead = n - 1;
+	}
+	else {
+		start = vaddr & ~(ptoa(VM_FAULT_CLUSTER_RANDOM) - 1);
+		*behind = atop(vaddr - start);
+		*ahead = VM_FAULT_CLUSTER_RANDOM - 1 - *behind;
+	}
+
+	if (*behind > atop(vaddr - entry->vme_start))
+		*behind = atop(vaddr - entry->vme_start);
+	if (*ahead > atop(entry->vme_end - vaddr) - 1)
+		*ahead = atop(entry->vme_end - vaddr) - 1;
+}
+
+/*
+ *	vm_fault_cluster:
+ *
+ *	Gather the pages to read with the busy page m at
+ *	object/offset: the run of non-resident offsets within
+ *	behind pages before and ahead pages after it, as far as the
+ *	pager can read in one operation.  A busy page is allocated
+ *	for each.  Returns the number of pages in pages[], in offset
+ *	order, and m's index among them.  Nothing is added when free
+ *	memory is short.
+ *
+ *	The object must be locked.
+ */
+static int
+vm_fault_cluster(object, offset, m, behind, ahead, pages, index)
+	vm_object_t	object;
+	vm_offset_t	offset;
+	vm_page_t	m;
+	int		behind;
+	int		ahead;
+	vm_page_t	*pages;
+	int		*index;
+{
+	vm_offset_t	f_offset;
+	vm_page_t	p;
+	int		limit, before, after, n;
+
+	pages[0] = m;
+	*index = 0;
+
+	if (behind + ahead == 0 ||
+	    vm_page_free_count < vm_page_free_min + behind + ahead)
+		return(1);
+
+	limit = vm_pager_cluster_limit(object->pager,
+				       offset + object->paging_offset);
+	if (ahead > limit - 1)
+		ahead = limit - 1;
+	if (limit == 1)
+		behind = 0;
+	if (behind + ahead + 1 > VM_FAULT_CLUSTER_MAX)
+		behind = VM_FAULT_CLUSTER_MAX - 1 - ahead;
+
+	for (before = 0; before < behind; before++)
+		if (offset < ptoa(before + 1) ||
+		    vm_page_lookup(object, offset - ptoa(before + 1)) !=
+		    VM_PAGE_NULL)
+			break;
+	for (after = 0; after < ahead; after++)
+		if (vm_page_lookup(object, offset + ptoa(after + 1)) !=
+		    VM_PAGE_NULL)
+			break;
+
+	n = 0;
+	for (f_offset = offset - ptoa(before);
+	     f_offset <= offset + ptoa(after);
+	     f_offset += PAGE_SIZE) {
+		if (f_offset == offset) {
+			*index = n;
+			pages[n++] = m;
+			continue;
+		}
+		p = vm_page_alloc(object, f_offset);
+		if (p == VM_PAGE_NULL) {
+			if (f_offset > offset)
+				break;
+			/*
+			 *	The run must be contiguous: start it
+			 *	again after the hole.
+			 */
+			vm_page_lock_queues();
+			while (n > 0) {
+				p = pages[--n];
+				PAGE_WAKEUP(p);
+				vm_page_free(p);
+			}
+			vm_page_unlock_queues();
+			continue;
+		}
+		pages[n++] = p;
+	}
+	return(n);
+}
+
+/*
+ *	vm_fault_cluster_done:
+ *
+ *	Dispose of the pages read along with the faulting page (the
+ *	one at index): if the read worked they go on the queues like
+ *	any other page brought in, otherwise they are freed.
+ *
+ *	The object must be locked.
+ */
+static void
+vm_fault_cluster_done(pages, count, index, success)
+	vm_page_t	*pages;
+	int		count;
+	int		index;
+	boolean_t	success;
+{
+	vm_page_t	p;
+	int		i;
+
+	vm_page_lock_queues();
+	for (i = 0; i < count; i++) {
+		if (i == index)
+			continue;
+		p = pages[i];
+		PAGE_WAKEUP(p);
+		if (success) {
+			pmap_clear_modify(VM_PAGE_TO_PHYS(p));
+			vm_page_admit(p);
+		}
+		else
+			vm_page_free(p);
+	}
+	vm_page_unlock_queues();
+}
+
+/*
+ *	vm_fault_around:
+ *
+ *	Map read-only the resident pages of object around the page
+ *	just entered at vaddr/offset, within the map entry, that are
+ *	not mapped already.  The pages are made busy while the
+ *	object is unlocked for pmap_enter, which keeps the pageout
+ *	daemon off them, but they stay where they are on the page
+ *	queues: being mapped is not a reference, and only the
+ *	program touching them should count as one.
+ *
+ *	The object must be locked and the map entry must map the
+ *	object directly.
+ */
+static void
+vm_fault_around(map, entry, vaddr, object, offset, prot)
+	vm_map_t	map;
+	vm_map_entry_t	entry;
+	vm_offset_t	vaddr;
+	vm_object_t	object;
+	vm_offset_t	offset;
+	vm_prot_t	prot;
+{
+	vm_page_t	pages[VM_FAULT_AROUND];
+	vm_offset_t	va[VM_FAULT_AROUND];
+	vm_offset_t	start, end, addr;
+	vm_page_t	m;
+	int		i, n;
+
+	start = vaddr & ~(ptoa(VM_FAULT_AROUND) - 1);
+	end = start + ptoa(VM_FAULT_AROUND);
+	if (start < entry->vme_start)
+		start = entry->vme_start;
+	if (end > entry->vme_end)
+		end = entry->vme_end;
+	prot &= ~VM_PROT_WRITE;
+
+	n = 0;
+	for (addr = start; addr < end; addr += PAGE_SIZE) {
+		if (addr == vaddr)
+			continue;
+		m = vm_page_lookup(object, offset + addr - vaddr);
+		if (m == VM_PAGE_NULL || m->busy || m->absent || m->error ||
+		    m->free || (m->page_lock & VM_PROT_READ))
+			continue;
+		if (pmap_extract(map->pmap, addr) != 0)
+			continue;
+		m->busy = TRUE;
+		va[n] = addr;
+		pages[n++] = m;
+	}
+	if (n == 0)
+		return;
+
+	vm_object_unlock(object);
+	for (i = 0; i < n; i++)
+		pmap_enter(map->pmap, va[i], VM_PAGE_TO_PHYS(pages[i]),
+			   prot & ~(pages[i]->page_lock), FALSE);
+	vm_object_lock(object);
+
+	for (i = 0; i < n; i++)
+		PAGE_WAKEUP(pages[i]);
+	vm_fault_stat_add(faultaround, n);
+}
+
 
 /*
  *	vm_fault:
@@ -106,6 +364,8 @@ kern_return_t vm_fault(map, vaddr, fault_type, change_wiring)
 	boolean_t		lookup_still_valid;
 #endif	!USE_VERSIONS
 	boolean_t		page_exists;
+	boolean_t		page_found;
+	int			behind, ahead;
 	vm_page_t		old_m;
 	vm_object_t		next_object;
 
@@ -188,6 +448,17 @@ kern_return_t vm_fault(map, vaddr, fault_type, change_wiring)
 		fault_type = prot;
 
 	first_m = VM_PAGE_NULL;
+	page_found = FALSE;
+
+	/*
+	 *	Decide how much to read if the page has to come
+	 *	from a pager.
+	 */
+	behind = ahead = 0;
+#if	!USE_VERSIONS
+	if (!change_wiring && !wired)
+		vm_fault_window(entry, vaddr, &behind, &ahead);
+#endif	!USE_VERSIONS
 
    	/*
 	 *	Make a reference to this object to
@@ -363,10 +634,7 @@ kern_return_t vm_fault(map, vaddr, fault_type, change_wiring)
 
 			vm_page_lock_queues();
 			if (m->inactive) {
-				queue_remove(&vm_page_queue_inactive, m,
-						vm_page_t, pageq);
-				m->inactive = FALSE;
-				vm_page_inactive_count--;
+				VM_PAGE_INACTIVE_REMOVE(m);
 				vm_stat.reactivations++;
 			} 
 
@@ -388,9 +656,11 @@ kern_return_t vm_fault(map, vaddr, fault_type, change_wiring)
 				m->free = FALSE;
 				vm_page_free_count--;
 				vm_stat.reactivations++;
+				vm_pageout_refault(m->file);
 			}
 #endif	NeXT
 			vm_page_unlock_queues();
+			page_found = TRUE;
 
 			/*
 			 *	Mark page busy for other threads.
@@ -424,6 +694,15 @@ kern_return_t vm_fault(map, vaddr, fault_type, change_wiring)
 			kern_return_t	rc;
 #else	MACH_XP
 			pager_return_t	rc;
+			vm_page_t	cluster[VM_FAULT_CLUSTER_MAX];
+			int		count, index;
+
+			/*
+			 *	Pick the neighbours to read with this
+			 *	page, while we still hold the lock.
+			 */
+			count = vm_fault_cluster(object, offset, m,
+					behind, ahead, cluster, &index);
 #endif	MACH_XP
 
 			/*
@@ -469,10 +748,18 @@ kern_return_t vm_fault(map, vaddr, fault_type, change_wiring)
 			continue;
 #else	MACH_XP
 #if	NeXT
-			rc = vm_pager_get(object->pager, m, error);
+			rc = vm_pager_get_cluster(object->pager, cluster,
+						  count, error);
 #else	NeXT
-			rc = vm_pager_get(object->pager, m);
+			rc = vm_pager_get_cluster(object->pager, cluster,
+						  count, (int *) 0);
 #endif	NeXT
+			if (count > 1) {
+				vm_object_lock(object);
+				vm_fault_cluster_done(cluster, count, index,
+						      rc == PAGER_SUCCESS);
+				vm_object_unlock(object);
+			}
 			if (rc == PAGER_SUCCESS) {
 
 				/*
@@ -488,7 +775,7 @@ kern_return_t vm_fault(map, vaddr, fault_type, change_wiring)
 				 */
 				m = vm_page_lookup(object, offset);
 
-				vm_stat.pageins++;
+				vm_stat.pageins += count;
 				pmap_clear_modify(VM_PAGE_TO_PHYS(m));
 				break;
 			}
@@ -1150,10 +1437,23 @@ kern_return_t vm_fault(map, vaddr, fault_type, change_wiring)
 		else
 			vm_page_unwire(m);
 	}
-	else
+	else if (page_found)
 		vm_page_activate(m);
+	else
+		vm_page_admit(m);
 	vm_page_unlock_queues();
 
+#if	!USE_VERSIONS
+	/*
+	 *	Map the resident neighbours of a file page being
+	 *	read, while we hold everything it takes.
+	 */
+	if (!change_wiring && !wired && !entry->is_a_map &&
+	    object == first_object && !(fault_type & VM_PROT_WRITE) &&
+	    vm_pageout_file_backed(object))
+		vm_fault_around(map, entry, vaddr, object, offset, prot);
+#endif	!USE_VERSIONS
+
 	/*
 	 *	Unlock everything, and return
 	 */
@@ -57,6 +57,9 @@
 #define _VM_VM_FAULT_H_
 
 #include <mach/kern_return.h>
+#include <mach/host_info.h>
+#include <kern/lock.h>
+#include <kern/macro_help.h>
 
 /*
  *	Page fault handling based on vm_object only.
@@ -74,6 +77,16 @@ extern void vm_fault_init();
 extern vm_fault_return_t vm_fault_page();
 
 extern void		vm_fault_cleanup();
+
+extern host_vm_fault_info_data_t	vm_fault_stat;
+decl_simple_lock_data(extern,vm_fault_stat_lock)
+
+#define	vm_fault_stat_add(field, n)				\
+MACRO_BEGIN							\
+	simple_lock(&vm_fault_stat_lock);			\
+	vm_fault_stat.field += (n);				\
+	simple_unlock(&vm_fault_stat_lock);			\
+MACRO_END
 /*
  *	Page fault handling based on vm_map (or entries therein)
  */
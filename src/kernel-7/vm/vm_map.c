@@ -255,6 +255,8 @@ vm_map_entry_t _vm_map_entry_create(map_header)
 	entry = (vm_map_entry_t) zalloc(zone);
 	if (entry == VM_MAP_ENTRY_NULL)
 		panic("vm_map_entry_create");
+	entry->last_fault = 0;
+	entry->sequential = 0;
 
 	return(entry);
 }
@@ -148,6 +148,9 @@ struct vm_map_entry {
 	vm_inherit_t		inheritance;	/* inheritance */
 	unsigned short		wired_count;	/* can be paged if = 0 */
 	unsigned short		user_wired_count; /* for vm_wire */
+		/* Fault clustering hints, updated without the write lock: */
+	vm_offset_t		last_fault;	/* address of last fault */
+	unsigned short		sequential;	/* run of forward faults */
 };
 
 typedef struct vm_map_entry	*vm_map_entry_t;
@@ -435,10 +435,7 @@ void vm_object_terminate(object)
 		}
 
 		if (p->inactive) {
-			queue_remove(&vm_page_queue_inactive, p, vm_page_t,
-						pageq);
-			p->inactive = FALSE;
-			vm_page_inactive_count--;
+			VM_PAGE_INACTIVE_REMOVE(p);
 		}
 		/*
 		 *	If we are on the free list just free ourselves now to make sure
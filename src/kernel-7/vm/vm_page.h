@@ -117,6 +117,10 @@ struct vm_page {
 			laundry:1,	/* page is being cleaned now (P)*/
 			free:1,		/* page is on free list (P) */
 			reference:1,	/* page has been used (P) */
+			file:1,		/* object is file-backed; picks
+					 * the inactive queue (P) */
+			refault:1,	/* faulted back in soon after
+					 * being paged out (P) */
 #if	OLD_VM_CODE
 			clean:1,	/* page has not been modified (P) */
 #endif
@@ -178,6 +182,12 @@ typedef struct vm_page	*vm_page_t;
  *		A list of pages which have been placed in
  *		at least one physical map.  This list is
  *		ordered, in LRU-like fashion.
+ *
+ *	The inactive list is really two queues, one for pages of
+ *	file-backed objects and one for anonymous memory, so that
+ *	the pageout daemon can choose which to reclaim from (see
+ *	vm_pageout_scan).  Newly faulted pages start out inactive
+ *	and are activated only if they are referenced again.
  */
 
 #if	OLD_VM_CODE
@@ -192,7 +202,9 @@ vm_page_t	vm_page_queue_fictitious;	/* fictitious free queue */
 extern
 queue_head_t	vm_page_queue_active;	/* active memory queue */
 extern
-queue_head_t	vm_page_queue_inactive;	/* inactive memory queue */
+queue_head_t	vm_page_queue_inactive;	/* inactive anonymous memory */
+extern
+queue_head_t	vm_page_queue_inactive_file;	/* inactive file memory */
 
 extern
 vm_offset_t	first_phys_addr;	/* physical address for first_page */
@@ -208,6 +220,8 @@ int	vm_page_active_count;	/* How many pages are active? */
 extern
 int	vm_page_inactive_count;	/* How many pages are inactive? */
 extern
+int	vm_page_inactive_file_count;/* How many of those are file pages? */
+extern
 int	vm_page_wire_count;	/* How many pages are wired? */
 extern
 int	vm_page_free_target;	/* How many do we want free? */
@@ -244,6 +258,7 @@ void		vm_page_free(vm_page_t);
 void		vm_page_addfree(vm_page_t);
 void		vm_page_activate(vm_page_t);
 void		vm_page_deactivate(vm_page_t);
+void		vm_page_admit(vm_page_t);
 void		vm_page_rename(vm_page_t, vm_object_t, vm_offset_t);
 void		vm_page_insert(vm_page_t, vm_object_t, vm_offset_t);
 void		vm_page_remove(vm_page_t);
@@ -392,6 +407,19 @@ extern unsigned int	vm_page_info(
 #define vm_page_lock_queues()	simple_lock(&vm_page_queue_lock)
 #define vm_page_unlock_queues()	simple_unlock(&vm_page_queue_lock)
 
+#define	VM_PAGE_INACTIVE_QUEUE(mem)				\
+	((mem)->file ? &vm_page_queue_inactive_file : &vm_page_queue_inactive)
+
+#define VM_PAGE_INACTIVE_REMOVE(mem)				\
+	MACRO_BEGIN						\
+	queue_remove(VM_PAGE_INACTIVE_QUEUE(mem),		\
+		mem, vm_page_t, pageq);				\
+	mem->inactive = FALSE;					\
+	vm_page_inactive_count--;				\
+	if (mem->file)						\
+		vm_page_inactive_file_count--;			\
+	MACRO_END
+
 #define VM_PAGE_QUEUES_REMOVE(mem)				\
 	MACRO_BEGIN						\
 	if (mem->active) {					\
@@ -401,12 +429,8 @@ extern unsigned int	vm_page_info(
 		vm_page_active_count--;				\
 	}							\
 								\
-	if (mem->inactive) {					\
-		queue_remove(&vm_page_queue_inactive,		\
-			mem, vm_page_t, pageq);			\
-		mem->inactive = FALSE;				\
-		vm_page_inactive_count--;			\
-	}							\
+	if (mem->inactive)					\
+		VM_PAGE_INACTIVE_REMOVE(mem);			\
 	MACRO_END
 
 #if	OLD_VM_CODE
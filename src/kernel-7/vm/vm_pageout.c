@@ -41,9 +41,13 @@
 #import <vm/pmap.h>
 #import <vm/vm_object.h>
 #import <vm/vm_pageout.h>
+#import <vm/vm_kern.h>
+#import <vm/vnode_pager.h>
 #import <mach/vm_statistics.h>
 #import <mach/vm_param.h>
+#import <mach/host_info.h>
 #import <kern/thread.h>
+#import <kern/zalloc.h>
 #import <machine/spl.h>
 
 simple_lock_data_t	vm_pages_needed_lock;
@@ -59,76 +63,275 @@ long	local_total_pages;
 #endif	/* MACH_VM_DEBUG */
 
 /*
- *	vm_pageout_scan does the dirty work for the pageout daemon.
+ *	Page replacement.
+ *
+ *	The active and inactive lists play the parts of the hot and
+ *	cold pages of CLOCK-Pro.  A page faulted in goes on the
+ *	inactive list (vm_page_admit), and is activated only if the
+ *	scan below finds it referenced on two visits; the first
+ *	reference is usually just the fault that brought it in.
+ *	Active pages that go unreferenced for a trip around the active
+ *	list are deactivated when the inactive list runs short.
+ *
+ *	Pages reclaimed here stay on the free list, still in their
+ *	objects, until the frame is reused; vm_page_alloc then
+ *	remembers their object and offset in vm_page_history.  A page
+ *	that is faulted back in while it is still remembered was
+ *	reclaimed too soon: it is activated at once, and the inactive
+ *	target grows so inactive pages get longer to prove themselves.
+ *	Every page remembered shrinks the target a little, so when
+ *	reclaimed pages are not coming back -- a large file being read
+ *	once, say -- the inactive list stays short and the active
+ *	pages are left alone.
+ *
+ *	File pages and anonymous pages are on separate inactive queues,
+ *	and the scan reclaims first from the class that has refaulted
+ *	less lately.
  */
-boolean_t
-vm_pageout_scan()
+
+struct vm_page_history {
+	unsigned int	key;		/* object/offset hash, 0 if none */
+	unsigned int	when;		/* vm_page_history_clock at entry */
+};
+
+struct vm_page_history	*vm_page_history;
+unsigned int		vm_page_history_size;	/* entries, a power of 2 */
+unsigned int		vm_page_history_shift;	/* 32 - log2(size) */
+unsigned int		vm_page_history_clock;	/* entries made so far */
+simple_lock_data_t	vm_page_history_lock;
+
+int	vm_page_inactive_target_max;	/* ceiling for adapting target */
+
+int	vm_pageout_refaults_recent[2];	/* decaying, by page->file */
+#define	VM_PAGEOUT_REFAULTS_DECAY	1024
+
+host_vm_pageout_info_data_t	vm_pageout_stat;
+
+#define	vm_pageout_queue_stat(file)					\
+		((file) ? &vm_pageout_stat.file : &vm_pageout_stat.anon)
+
+/*
+ *	vm_page_history_hash:
+ *
+ *	Mixes an object/offset pair into 32 bits.  The top bits pick
+ *	the history slot; all of them, with the low bit forced on,
+ *	make the key.
+ */
+static unsigned int
+vm_page_history_hash(object, offset)
+	vm_object_t	object;
+	vm_offset_t	offset;
 {
-	register vm_page_t	m;
-	register int		page_shortage;
-	register int		s;
-	register int		pages_freed = 0;
-	register int            pages_cleaned = 0;
-	boolean_t		free_pages;
-	boolean_t		did_work = FALSE;
-#if	MACH_VM_DEBUG
-	int			dbg_intoa_pages = 0;
-	int			dbg_pages_needed = 0;
-	int			dbg_pages_cleaned = 0;
-#endif	/* MACH_VM_DEBUG */
+	register unsigned int	h;
 
+	h = ((unsigned int) object >> 3) * 0x9e3779b1 + atop(offset);
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+	return h;
+}
 
-	/*
-	 *	Only continue when we want more pages to be "free"
-	 */
-		s = splimp();
-		simple_lock(&vm_page_queue_free_lock);
+/*
+ *	vm_page_history_init:
+ *
+ *	Allocates the history, with room for about as many pages as
+ *	there are in memory.  Without it, nothing is remembered and
+ *	nothing refaults.
+ */
+static void
+vm_page_history_init()
+{
+	vm_offset_t	addr;
+	vm_size_t	size;
+	int		shift;
 
-		free_pages = FALSE;
-		if (vm_page_free_count <= vm_page_free_min) {
-			free_pages = TRUE;
-			/*
-		 	 *	See whether the physical mapping system
-		 	 *	knows of any pages which are not being used.
-		 	 */
-		 
-			simple_unlock(&vm_page_queue_free_lock);
-			splx(s);
+	simple_lock_init(&vm_page_history_lock);
 
-			/*
-		 	 *	And be sure the pmap system is updated so
-		 	 *	we can scan the inactive queue.
-		 	 */
+	shift = 32;
+	for (size = 1; size < vm_page_free_count; size <<= 1)
+		shift--;
 
-			pmap_update();
-		}
-		else {
-			simple_unlock(&vm_page_queue_free_lock);
-			splx(s);
-		}
+	if (kmem_alloc(kernel_map, &addr,
+		       round_page(size * sizeof (struct vm_page_history)))
+							!= KERN_SUCCESS)
+		return;
+	bzero((char *) addr, size * sizeof (struct vm_page_history));
 
-	/*
-	 *	Acquire the resident page system lock,
-	 *	as we may be changing what's resident quite a bit.
-	 */
-	vm_page_lock_queues();
+	vm_page_history_shift = shift;
+	vm_page_history_size = size;
+	vm_page_history = (struct vm_page_history *) addr;
+}
+
+/*
+ *	vm_page_history_enter:
+ *
+ *	Remember a page that was reclaimed by the pageout daemon and
+ *	whose frame is now being reused.  Called by vm_page_alloc.
+ */
+void
+vm_page_history_enter(object, offset)
+	vm_object_t	object;
+	vm_offset_t	offset;
+{
+	register struct vm_page_history	*e;
+	register unsigned int		h;
+	int				s;
+
+	if (vm_page_history == 0)
+		return;
+
+	h = vm_page_history_hash(object, offset);
+
+	s = splimp();
+	simple_lock(&vm_page_history_lock);
+	e = &vm_page_history[h >> vm_page_history_shift];
+	e->key = h | 1;
+	e->when = vm_page_history_clock++;
 
 	/*
-	 *	Start scanning the inactive queue for pages we can free.
-	 *	We keep scanning until we have enough free pages or
-	 *	we have scanned through the entire queue.  If we
-	 *	encounter dirty pages, we start cleaning them.
+	 *	Charge now for the page never coming back; a refault
+	 *	pays it back (see vm_pageout_refault).
 	 */
+	if (vm_page_inactive_target > vm_page_inactive_target_min)
+		vm_page_inactive_target--;
+	simple_unlock(&vm_page_history_lock);
+	splx(s);
+}
+
+/*
+ *	vm_page_history_lookup:
+ *
+ *	Whether a page being allocated at this object and offset was
+ *	reclaimed recently: within the last vm_page_history_size pages
+ *	remembered.  Forgets the page if so.
+ */
+boolean_t
+vm_page_history_lookup(object, offset)
+	vm_object_t	object;
+	vm_offset_t	offset;
+{
+	register struct vm_page_history	*e;
+	register unsigned int		h;
+	boolean_t			found;
+	int				s;
+
+	if (vm_page_history == 0)
+		return FALSE;
+
+	h = vm_page_history_hash(object, offset);
+
+	s = splimp();
+	simple_lock(&vm_page_history_lock);
+	e = &vm_page_history[h >> vm_page_history_shift];
+	found = (e->key == (h | 1) &&
+		 vm_page_history_clock - e->when < vm_page_history_size);
+	if (found)
+		e->key = 0;
+	simple_unlock(&vm_page_history_lock);
+	splx(s);
+
+	return found;
+}
+
+/*
+ *	vm_pageout_refault:
+ *
+ *	Note that a reclaimed page of the given class was wanted
+ *	again, either found still on the free list or remembered by
+ *	vm_page_history_lookup.  Gives inactive pages longer, and
+ *	steers the scan toward the other class.
+ */
+void
+vm_pageout_refault(file)
+	boolean_t	file;
+{
+	int		s;
+
+	vm_pageout_queue_stat(file)->refaults++;
+	vm_pageout_refaults_recent[file ? 1 : 0]++;
+
+	s = splimp();
+	simple_lock(&vm_page_history_lock);
+	vm_page_inactive_target += 2;
+	if (vm_page_inactive_target > vm_page_inactive_target_max)
+		vm_page_inactive_target = vm_page_inactive_target_max;
+	simple_unlock(&vm_page_history_lock);
+	splx(s);
+}
+
+/*
+ *	vm_pageout_file_backed:
+ *
+ *	Whether pages of this object belong to a file, as opposed to
+ *	anonymous memory, which may be paged to the swapfile.
+ */
+boolean_t
+vm_pageout_file_backed(object)
+	vm_object_t	object;
+{
+	register vm_pager_t	pager = object->pager;
+
+	return (pager != vm_pager_null && !pager->is_device &&
+		!((vnode_pager_t) pager)->vs_swapfile);
+}
+
+/*
+ *	vm_pageout_info:
+ *
+ *	Fills in HOST_VM_PAGEOUT_INFO.  Read without locks.
+ */
+void
+vm_pageout_info(info)
+	host_vm_pageout_info_t	info;
+{
+	*info = vm_pageout_stat;
+	info->active = vm_page_active_count;
+	info->inactive_target = vm_page_inactive_target;
+	info->history_size = vm_page_history_size;
+	info->file.inactive = vm_page_inactive_file_count;
+	info->anon.inactive =
+		vm_page_inactive_count - vm_page_inactive_file_count;
+}
+
+/*
+ *	vm_pageout_scan_inactive:
+ *
+ *	Reclaims pages from one of the inactive queues until there are
+ *	enough free pages or every page on it has been looked at once.
+ *	Clean pages are freed; dirty ones are sent to their pager.
+ *
+ *	The page queues are locked, and unlocked while we wait for
+ *	pmap operations and pagers.
+ */
+static boolean_t
+vm_pageout_scan_inactive(file, pages_freed, pages_cleaned)
+	boolean_t	file;
+	int		*pages_freed;
+	int		*pages_cleaned;
+{
+	register vm_page_t	m;
+	register int		s;
+	register queue_t	q;
+	struct host_vm_pageout_queue *stat;
+	boolean_t		did_work = FALSE;
+	int			budget;
+
+	if (file) {
+		q = &vm_page_queue_inactive_file;
+		budget = vm_page_inactive_file_count;
+	} else {
+		q = &vm_page_queue_inactive;
+		budget = vm_page_inactive_count - vm_page_inactive_file_count;
+	}
+	stat = vm_pageout_queue_stat(file);
 
-	pages_freed = 0;
-	m = (vm_page_t) queue_first(&vm_page_queue_inactive);
-	while (free_pages &&
-	    !queue_end(&vm_page_queue_inactive, (queue_entry_t) m)) {
+	m = (vm_page_t) queue_first(q);
+	while (budget-- > 0 && !queue_end(q, (queue_entry_t) m)) {
 		vm_page_t	next;
 
 			s = splimp();
 			simple_lock(&vm_page_queue_free_lock);
-			if ((vm_page_free_count + pages_cleaned) >= vm_page_free_target) {
+			if ((vm_page_free_count + *pages_cleaned) >= vm_page_free_target) {
 				simple_unlock(&vm_page_queue_free_lock);
 				splx(s);
 				break;
@@ -136,20 +339,43 @@ vm_pageout_scan()
 			simple_unlock(&vm_page_queue_free_lock);
 			splx(s);
 
-#if 0
-		if (pmap_is_referenced(VM_PAGE_TO_PHYS(m)) &&
-		    (vm_page_inactive_target < vm_page_inactive_count))
-#else
-		if (pmap_is_referenced(VM_PAGE_TO_PHYS(m)))
-#endif
-		{
+		/*
+		 *	A busy page is being worked on with its object
+		 *	unlocked (vm_fault_around, or a pageout still in
+		 *	progress); leave it, and its reference state, alone.
+		 */
+		if (m->busy) {
+			m = (vm_page_t) queue_next(&m->pageq);
+			continue;
+		}
+
+		stat->scanned++;
+
+		if (pmap_is_referenced(VM_PAGE_TO_PHYS(m))) {
 			next = (vm_page_t) queue_next(&m->pageq);
-			vm_page_activate(m);
-			vm_stat.reactivations++; 
+			if (m->reference) {
+				/*
+				 *	Referenced on two visits: activate.
+				 */
+				vm_page_activate(m);
+				vm_stat.reactivations++; 
+				stat->activated++;
+			}
+			else {
+				/*
+				 *	Once is probably just the fault that
+				 *	brought the page in.  Send it round
+				 *	again, noting whether it was written.
+				 */
+				pmap_clear_reference(VM_PAGE_TO_PHYS(m));
+				m->reference = TRUE;
+				if (m->clean &&
+				    pmap_is_modified(VM_PAGE_TO_PHYS(m)))
+					m->clean = FALSE;
+				queue_remove(q, m, vm_page_t, pageq);
+				queue_enter(q, m, vm_page_t, pageq);
+			}
 			m = next;
-#if	MACH_VM_DEBUG
-			dbg_intoa_pages++;
-#endif	/* MACH_VM_DEBUG */
 			continue;
 		}
 
@@ -177,148 +403,217 @@ vm_pageout_scan()
 			
 				next = (vm_page_t) queue_next(&m->pageq);
 				vm_page_addfree(m);
-				pages_freed++;
-#if	MACH_VM_DEBUG
-			--dbg_pages_needed;
-#endif	/* MACH_VM_DEBUG */
+				(*pages_freed)++;
+				stat->reclaimed++;
 				vm_object_unlock(object);
 				m = next;
 		}
 		else {
 			/*
-			 *	If a page is dirty, then it is either
-			 *	being washed (but not yet cleaned)
-			 *	or it is still in the laundry.  If it is
-			 *	still in the laundry, then we start the
-			 *	cleaning operation.
+			 *	The page is dirty.  One being washed is
+			 *	busy and was passed over above, so this
+			 *	one needs cleaning, whether it went into
+			 *	the laundry when deactivated or was
+			 *	written while on the inactive list.
+			 *
+			 *	Clean the page and remove it from the
+			 *	laundry.
+			 *
+			 *	We set the busy bit to cause
+			 *	potential page faults on this page to
+			 *	block.
+			 *
+			 *	And we set pageout-in-progress to keep
+			 *	the object from disappearing during
+			 *	pageout.  This guarantees that the
+			 *	page won't move from the inactive
+			 *	queue.  (However, any other page on
+			 *	the inactive queue may move!)
 			 */
 
-#if	0 && MACH_VM_DEBUG
-	kprintf("     : pulled dirty page off inactive list\n");
-#endif	/* MACH_VM_DEBUG */
-			if (m->laundry) {
-				/*
-				 *	Clean the page and remove it from the
-				 *	laundry.
-				 *
-				 *	We set the busy bit to cause
-				 *	potential page faults on this page to
-				 *	block.
-				 *
-				 *	And we set pageout-in-progress to keep
-				 *	the object from disappearing during
-				 *	pageout.  This guarantees that the
-				 *	page won't move from the inactive
-				 *	queue.  (However, any other page on
-				 *	the inactive queue may move!)
-				 */
-
-				register vm_object_t	object;
-				register vm_pager_t	pager;
-				boolean_t	pageout_succeeded;
-
-#if	0 && MACH_VM_DEBUG
-	kprintf("    cleaning dirty page off inactive list\n");
-#endif	/* MACH_VM_DEBUG */
-				object = m->object;
-				if (!vm_object_lock_try(object)) {
-					/*
-					 *	Skip page if we can't lock
-					 *	its object
-					 */
-					m = (vm_page_t) queue_next(&m->pageq);
-					continue;
-				}
-
-				m->busy = TRUE;
-				vm_stat.pageouts++;
+			register vm_object_t	object;
+			register vm_pager_t	pager;
+			boolean_t	pageout_succeeded;
 
+			object = m->object;
+			if (!vm_object_lock_try(object)) {
 				/*
-				 *	Try to collapse the object before
-				 *	making a pager for it.  We must
-				 *	unlock the page queues first.
+				 *	Skip page if we can't lock
+				 *	its object
 				 */
-				vm_page_unlock_queues();
+				m = (vm_page_t) queue_next(&m->pageq);
+				continue;
+			}
 
-				did_work = TRUE;
-				/*
-				 * Moved this call from inside the queue lock
-				 * to prevent the following scenario:
-				 * remove_all -> pmap_collapse ->
-				 * kmem_free -> vm_page_lock_queues
-				 */
-				pmap_remove_all(VM_PAGE_TO_PHYS(m));
+			m->busy = TRUE;
+			vm_stat.pageouts++;
 
-				vm_object_collapse(object);
+			/*
+			 *	Try to collapse the object before
+			 *	making a pager for it.  We must
+			 *	unlock the page queues first.
+			 */
+			vm_page_unlock_queues();
 
-				object->paging_in_progress++;
+			did_work = TRUE;
+			/*
+			 * Moved this call from inside the queue lock
+			 * to prevent the following scenario:
+			 * remove_all -> pmap_collapse ->
+			 * kmem_free -> vm_page_lock_queues
+			 */
+			pmap_remove_all(VM_PAGE_TO_PHYS(m));
 
-				vm_object_unlock(object);
+			vm_object_collapse(object);
 
+			object->paging_in_progress++;
 
-				/*
-				 *	Do a wakeup here in case the following
-				 *	operations block.
-				 */
-				thread_wakeup(&vm_page_free_count);
+			vm_object_unlock(object);
 
-				/*
-				 *	If there is no pager for the page,
-				 *	use the default pager.  If there's
-				 *	no place to put the page at the
-				 *	moment, leave it in the laundry and
-				 *	hope that there will be paging space
-				 *	later.
-				 */
 
-				if ((pager = object->pager) == vm_pager_null) {
-					pager = (vm_pager_t)vm_pager_allocate(
-							object->size);
-					if (pager != vm_pager_null) {
-						vm_object_setpager(object,
-							pager, 0, FALSE);
-					}
-				}
+			/*
+			 *	Do a wakeup here in case the following
+			 *	operations block.
+			 */
+			thread_wakeup(&vm_page_free_count);
 
-				pageout_succeeded = FALSE;
+			/*
+			 *	If there is no pager for the page,
+			 *	use the default pager.  If there's
+			 *	no place to put the page at the
+			 *	moment, leave it in the laundry and
+			 *	hope that there will be paging space
+			 *	later.
+			 */
+
+			if ((pager = object->pager) == vm_pager_null) {
+				pager = (vm_pager_t)vm_pager_allocate(
+						object->size);
 				if (pager != vm_pager_null) {
-				    if (vm_pager_put(pager, m) == PAGER_SUCCESS) {
-					pageout_succeeded = TRUE;
-#if	MACH_VM_DEBUG
-					dbg_pages_cleaned++;
-#endif	/* MACH_VM_DEBUG */
-					pages_cleaned++;
-				    }
+					vm_object_setpager(object,
+						pager, 0, FALSE);
 				}
+			}
 
-				vm_object_lock(object);
-				vm_page_lock_queues();
+			pageout_succeeded = FALSE;
+			if (pager != vm_pager_null) {
+			    if (vm_pager_put(pager, m) == PAGER_SUCCESS) {
+				pageout_succeeded = TRUE;
+				(*pages_cleaned)++;
+			    }
+			}
 
-				/*
-				 *	If page couldn't be paged out, then
-				 *	reactivate the page so it doesn't
-				 *	clog the inactive list.  (We will try
-				 *	paging out it again later).
-				 */
-				next = (vm_page_t) queue_next(&m->pageq);
-				if (pageout_succeeded)
-					m->laundry = FALSE;
-				else
-					vm_page_activate(m);
+			vm_object_lock(object);
+			vm_page_lock_queues();
+
+			/*
+			 *	If page couldn't be paged out, then
+			 *	reactivate the page so it doesn't
+			 *	clog the inactive list.  (We will try
+			 *	paging out it again later).
+			 */
+			next = (vm_page_t) queue_next(&m->pageq);
+			if (pageout_succeeded)
+				m->laundry = FALSE;
+			else
+				vm_page_activate(m);
 
 /* Why are we doing this. Was it not cleared when the mappings were removed
  * Is this here for a different arch */
-				pmap_clear_reference(VM_PAGE_TO_PHYS(m));
-					m->busy = FALSE;
-					PAGE_WAKEUP(m);
+			pmap_clear_reference(VM_PAGE_TO_PHYS(m));
+				m->busy = FALSE;
+				PAGE_WAKEUP(m);
 
-					object->paging_in_progress--;
-					thread_wakeup(object);
-				vm_object_unlock(object);
-				m = next;
-			}
-			else
-				m = (vm_page_t) queue_next(&m->pageq);
+				object->paging_in_progress--;
+				thread_wakeup(object);
+			vm_object_unlock(object);
+			m = next;
+		}
+	}
+
+	return did_work;
+}
+
+/*
+ *	vm_pageout_scan does the dirty work for the pageout daemon.
+ */
+boolean_t
+vm_pageout_scan()
+{
+	register vm_page_t	m;
+	register int		page_shortage;
+	register int		s;
+	int			pages_freed = 0;
+	int			pages_cleaned = 0;
+	int			budget;
+	boolean_t		free_pages;
+	boolean_t		file_first;
+	boolean_t		did_work = FALSE;
+
+
+	/*
+	 *	Only continue when we want more pages to be "free"
+	 */
+		s = splimp();
+		simple_lock(&vm_page_queue_free_lock);
+
+		free_pages = FALSE;
+		if (vm_page_free_count <= vm_page_free_min) {
+			free_pages = TRUE;
+			/*
+		 	 *	See whether the physical mapping system
+		 	 *	knows of any pages which are not being used.
+		 	 */
+		 
+			simple_unlock(&vm_page_queue_free_lock);
+			splx(s);
+
+			/*
+			 *	Free elements hoarded in zone
+			 *	magazine depots go back to the zones.
+			 */
+			zone_gc();
+
+			/*
+		 	 *	And be sure the pmap system is updated so
+		 	 *	we can scan the inactive queue.
+		 	 */
+
+			pmap_update();
+		}
+		else {
+			simple_unlock(&vm_page_queue_free_lock);
+			splx(s);
+		}
+
+	/*
+	 *	Acquire the resident page system lock,
+	 *	as we may be changing what's resident quite a bit.
+	 */
+	vm_page_lock_queues();
+
+	/*
+	 *	Scan the inactive queues for pages we can free, starting
+	 *	with the class that has refaulted less lately.  We keep
+	 *	scanning until we have enough free pages or we have been
+	 *	through both queues.  If we encounter dirty pages, we
+	 *	start cleaning them.
+	 */
+
+	if (free_pages) {
+		file_first = (vm_pageout_refaults_recent[1] <=
+			      vm_pageout_refaults_recent[0]);
+		if (vm_pageout_scan_inactive(file_first,
+					     &pages_freed, &pages_cleaned))
+			did_work = TRUE;
+		if (vm_pageout_scan_inactive(!file_first,
+					     &pages_freed, &pages_cleaned))
+			did_work = TRUE;
+
+		if (vm_pageout_refaults_recent[0] +
+		    vm_pageout_refaults_recent[1] > VM_PAGEOUT_REFAULTS_DECAY) {
+			vm_pageout_refaults_recent[0] /= 2;
+			vm_pageout_refaults_recent[1] /= 2;
 		}
 	}
 
@@ -331,20 +626,27 @@ vm_pageout_scan()
 	page_shortage = vm_page_inactive_target - vm_page_inactive_count;
 	page_shortage -= vm_page_free_count;
 
-//	if ((page_shortage <= 0) && (pages_freed == 0))
-//		page_shortage = 1;
-
-	while (page_shortage > 0) {
-		/*
-		 *	Move some more pages from active to inactive.
-		 */
+	/*
+	 *	Move some more pages from active to inactive, giving those
+	 *	referenced since we last came by another trip around.
+	 */
 
+	budget = vm_page_active_count;
+	while (page_shortage > 0 && budget-- > 0) {
 		if (queue_empty(&vm_page_queue_active)) {
 			break;
 		}
 		did_work = TRUE;
 		m = (vm_page_t) queue_first(&vm_page_queue_active);
+		vm_pageout_stat.active_scanned++;
+		if (pmap_is_referenced(VM_PAGE_TO_PHYS(m))) {
+			pmap_clear_reference(VM_PAGE_TO_PHYS(m));
+			queue_remove(&vm_page_queue_active, m, vm_page_t, pageq);
+			queue_enter(&vm_page_queue_active, m, vm_page_t, pageq);
+			continue;
+		}
 		vm_page_deactivate(m);
+		vm_pageout_stat.deactivated++;
 		page_shortage--;
 	}
 
@@ -429,6 +731,22 @@ void vm_pageout()
 	if (vm_page_inactive_target <= vm_page_free_target)
 		vm_page_inactive_target = vm_page_free_target + 1;
 
+	/*
+	 *	The inactive target adapts between these bounds as
+	 *	reclaimed pages do or don't come back.
+	 */
+
+	if (vm_page_inactive_target_min == 0)
+		vm_page_inactive_target_min = vm_page_free_target + 1;
+
+	if (vm_page_inactive_target_max == 0)
+		vm_page_inactive_target_max = vm_page_free_count / 2;
+
+	if (vm_page_inactive_target_max < vm_page_inactive_target)
+		vm_page_inactive_target_max = vm_page_inactive_target;
+
+	vm_page_history_init();
+
 #if	MACH_VM_DEBUG
 	kprintf("vm_pageout: free_count=0x%X\n",
 	    vm_page_free_count);
@@ -75,6 +75,11 @@ extern simple_lock_data_t	vm_pages_needed_lock;
 void	vm_pageout_page();
 #endif	/* MACH_XP */
 
+void		vm_page_history_enter();
+boolean_t	vm_page_history_lookup();
+void		vm_pageout_refault();
+boolean_t	vm_pageout_file_backed();
+
 /*
  *	Signal pageout-daemon and wait for it.
  */
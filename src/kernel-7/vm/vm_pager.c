@@ -72,6 +72,38 @@ pager_return_t vm_pager_get(pager, m, error)
 	return(vnode_pagein(m, error));
 }
 
+/*
+ *	Read a run of busy pages at consecutive offsets, the
+ *	first of which is pages[0], in one pager operation.
+ *	Only file pagers do more than one page at a time; see
+ *	vm_pager_cluster_limit.
+ */
+pager_return_t vm_pager_get_cluster(pager, pages, count, error)
+	vm_pager_t	pager;
+	vm_page_t	*pages;
+	int		count;
+	int		*error;
+{
+	if (count == 1)
+		return(vm_pager_get(pager, pages[0], error));
+	if (pager == vm_pager_null || pager->is_device)
+		panic("vm_pager_get_cluster");
+	return(vnode_pagein_cluster(pages, count, error));
+}
+
+/*
+ *	How many pages, starting at offset, the pager could
+ *	read at once.
+ */
+int vm_pager_cluster_limit(pager, offset)
+	vm_pager_t	pager;
+	vm_offset_t	offset;
+{
+	if (pager == vm_pager_null || pager->is_device)
+		return(1);
+	return(vnode_pager_cluster_limit(pager, offset));
+}
+
 pager_return_t vm_pager_put(pager, m)
 	vm_pager_t	pager;
 	vm_page_t	m;
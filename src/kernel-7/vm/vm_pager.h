@@ -59,6 +59,8 @@ typedef	int		pager_return_t;
 vm_pager_t	vm_pager_allocate();
 void		vm_pager_deallocate();
 pager_return_t	vm_pager_get();
+pager_return_t	vm_pager_get_cluster();
+int		vm_pager_cluster_limit();
 pager_return_t	vm_pager_put();
 boolean_t	vm_pager_has_page();
 #endif	/* KERNEL */
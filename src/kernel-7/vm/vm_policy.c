@@ -69,9 +69,7 @@ vm_page_free_head(mem)
 	}
 
 	if (mem->inactive) {
-		queue_remove(&vm_page_queue_inactive, mem, vm_page_t, pageq);
-		mem->inactive = FALSE;
-		vm_page_inactive_count--;
+		VM_PAGE_INACTIVE_REMOVE(mem);
 	}
 
 	if (!mem->fictitious) {
@@ -128,6 +128,7 @@ extern vm_size_t	zdata_size;
 queue_head_t	vm_page_queue_free;
 queue_head_t	vm_page_queue_active;
 queue_head_t	vm_page_queue_inactive;
+queue_head_t	vm_page_queue_inactive_file;
 simple_lock_data_t	vm_page_queue_lock;
 simple_lock_data_t	vm_page_queue_free_lock;
 
@@ -140,6 +141,7 @@ vm_offset_t	last_phys_addr;
 int	vm_page_free_count;
 int	vm_page_active_count;
 int	vm_page_inactive_count;
+int	vm_page_inactive_file_count;
 int	vm_page_wire_count;
 
 /*
@@ -151,6 +153,7 @@ int	vm_page_wire_count;
 int	vm_page_free_target = 0;
 int	vm_page_free_min = 0;
 int	vm_page_inactive_target = 0;
+int	vm_page_inactive_target_min = 0;
 int	vm_page_free_reserved = 0;
 int	vm_page_laundry_count = 0;
 
@@ -304,6 +307,8 @@ vm_offset_t vm_page_startup(mem_region, num_regions, vavail)
 	m->dirty = FALSE;
 	m->precious = FALSE;
 	m->reference = FALSE;
+	m->file = FALSE;
+	m->refault = FALSE;
 
 	m->phys_addr = 0;		/* reset later */
 
@@ -319,12 +324,13 @@ vm_offset_t vm_page_startup(mem_region, num_regions, vavail)
 
 	/*
 	 *	Initialize the queue headers for the free queue,
-	 *	the active queue and the inactive queue.
+	 *	the active queue and the inactive queues.
 	 */
 
 	queue_init(&vm_page_queue_free);
 	queue_init(&vm_page_queue_active);
 	queue_init(&vm_page_queue_inactive);
+	queue_init(&vm_page_queue_inactive_file);
 
 	/*
 	 *	Allocate (and initialize) the virtual-to-physical
@@ -686,10 +692,23 @@ vm_page_t vm_page_alloc_sequential(object, offset, sequential_unmap)
 	simple_unlock(&vm_page_queue_free_lock);
 	splx(spl);
 
- 	vm_page_remove(mem);	/* in case it is still in hash table */
+	/*
+	 *	A page the pageout daemon freed is still in its
+	 *	object.  Remember it as it goes, in case it is
+	 *	wanted again.
+	 */
+	if (mem->tabled) {
+		vm_page_history_enter(mem->object, mem->offset);
+		vm_page_remove(mem);
+	}
 
 	vm_page_init(mem, object, offset, mem->phys_addr);
 
+	if (vm_page_history_lookup(object, offset)) {
+		mem->refault = TRUE;
+		vm_pageout_refault(vm_pageout_file_backed(object));
+	}
+
 	/*
 	 *	Decide if we should poke the pageout daemon.
 	 *	We do this if the free count is less than the low
@@ -764,9 +783,7 @@ void vm_page_addfree(mem)
 	}
 
 	if (mem->inactive) {
-		queue_remove(&vm_page_queue_inactive, mem, vm_page_t, pageq);
-		mem->inactive = FALSE;
-		vm_page_inactive_count--;
+		VM_PAGE_INACTIVE_REMOVE(mem);
 	}
 
 	if (!mem->fictitious) {
@@ -804,10 +821,7 @@ void vm_page_wire(mem)
 			mem->active = FALSE;
 		}
 		if (mem->inactive) {
-			queue_remove(&vm_page_queue_inactive, mem, vm_page_t,
-						pageq);
-			vm_page_inactive_count--;
-			mem->inactive = FALSE;
+			VM_PAGE_INACTIVE_REMOVE(mem);
 		}
 		if (mem->free) {
 			queue_remove(&vm_page_queue_free, mem, vm_page_t,
@@ -841,6 +855,34 @@ void vm_page_unwire(mem)
 	}
 }
 
+/*
+ *	vm_page_enter_inactive:
+ *
+ *	Internal routine to put a page that is on no queue on the
+ *	inactive queue for its class, at the head if first is TRUE.
+ *	It has to be referenced again to be activated.
+ *
+ *	The page queues must be locked.
+ */
+static void vm_page_enter_inactive(m, first)
+	register vm_page_t	m;
+	register boolean_t	first;
+{
+	m->file = vm_pageout_file_backed(m->object);
+	m->reference = FALSE;
+	if (first)
+		queue_enter_first(VM_PAGE_INACTIVE_QUEUE(m), m, vm_page_t, pageq);
+	else
+		queue_enter(VM_PAGE_INACTIVE_QUEUE(m), m, vm_page_t, pageq);
+	m->inactive = TRUE;
+	vm_page_inactive_count++;
+	if (m->file)
+		vm_page_inactive_file_count++;
+	if (m->clean && pmap_is_modified(VM_PAGE_TO_PHYS(m)))
+		m->clean = FALSE;
+	m->laundry = !m->clean;
+}
+
 /*
  *	_vm_page_deactivate:
  *
@@ -865,17 +907,9 @@ static void _vm_page_deactivate(m, age)
 	if (m->active) {
 		pmap_clear_reference(VM_PAGE_TO_PHYS(m));
 		queue_remove(&vm_page_queue_active, m, vm_page_t, pageq);
-		if (age)
-			queue_enter_first(&vm_page_queue_inactive, m, vm_page_t, pageq);
-		else
-			queue_enter(&vm_page_queue_inactive, m, vm_page_t, pageq);
 		m->active = FALSE;
-		m->inactive = TRUE;
 		vm_page_active_count--;
-		vm_page_inactive_count++;
-		if (m->clean && pmap_is_modified(VM_PAGE_TO_PHYS(m)))
-			m->clean = FALSE;
-		m->laundry = !m->clean;
+		vm_page_enter_inactive(m, age);
 	}
 }
 
@@ -924,10 +958,7 @@ void vm_page_activate(m)
 
 
 	if (m->inactive) {
-		queue_remove(&vm_page_queue_inactive, m, vm_page_t,
-						pageq);
-		vm_page_inactive_count--;
-		m->inactive = FALSE;
+		VM_PAGE_INACTIVE_REMOVE(m);
 	}
 	if (m->free) {
 		queue_remove(&vm_page_queue_free, m, vm_page_t,
@@ -935,6 +966,8 @@ void vm_page_activate(m)
 		vm_page_free_count--;
 		m->free = FALSE;
 	}
+	m->reference = FALSE;
+	m->refault = FALSE;
 	if (m->wire_count == 0) {
 		if (m->active)
 			panic("vm_page_activate: already active");
@@ -945,6 +978,32 @@ void vm_page_activate(m)
 	}
 }
 
+/*
+ *	vm_page_admit:
+ *
+ *	Put a page that has just been brought in on the paging
+ *	queues.  It starts out inactive, so that one pass over a
+ *	large file can't push the pages in use off the active list;
+ *	the pageout daemon activates it if it is used again.  A page
+ *	faulted back in soon after being paged out has been used
+ *	again already, and is activated at once.
+ *
+ *	The page queues must be locked.
+ */
+void vm_page_admit(m)
+	register vm_page_t	m;
+{
+	VM_PAGE_CHECK(m);
+
+	if (m->refault || m->wire_count != 0 ||
+	    m->active || m->inactive || m->free) {
+		if (!m->active)
+			vm_page_activate(m);
+		return;
+	}
+	vm_page_enter_inactive(m, FALSE);
+}
+
 /*
  *	vm_page_zero_fill:
  *
@@ -68,7 +68,9 @@
 #undef	fs_bavail
 
 #import <mach/mach_types.h>
+#import <mach/vm_statistics.h>
 #import <vm/vm_page.h>
+#import <vm/vm_fault.h>
 #if defined(ppc)
 #import <vm/pmap.h>
 #endif /* ppc */
@@ -720,12 +722,58 @@ vnode_pageio_complete(
 
 #endif	/* notdef i386 */
 
+/*
+ *	vnode_pager_cluster_limit:
+ *
+ *	Return how many pages, starting with the one at the given
+ *	pager offset, can be read in a single transfer.  Objects in
+ *	a swapfile get one page, since their pages need not be next
+ *	to each other there; file pages can be read to end of file.
+ *	The file size is only a hint here; vnode_pagein_cluster zero
+ *	fills whatever the read comes up short.
+ */
+int
+vnode_pager_cluster_limit(pager, f_offset)
+	vm_pager_t	pager;
+	vm_offset_t	f_offset;
+{
+	vnode_pager_t	vs = (vnode_pager_t) pager;
+	vm_size_t	size;
+
+	if (vs->vs_swapfile)
+		return (1);
+	size = vs->vs_vp->v_vm_info->vnode_size;
+	if (f_offset >= size)
+		return (1);
+	return (atop(round_page(size) - f_offset));
+}
+
 pager_return_t
 vnode_pagein(
     vm_page_t		m,
     int			*errorp
 )
 {
+	return (vnode_pagein_cluster(&m, 1, errorp));
+}
+
+/*
+ *	vnode_pagein_cluster:
+ *
+ *	Read count busy pages, at consecutive offsets of one object,
+ *	with one VOP_PAGEIN: each page gets its own iovec in the uio,
+ *	so the file system sees a single read it can cluster.  Only
+ *	single pages may come from a swapfile.  The result applies to
+ *	every page in the cluster.
+ */
+pager_return_t
+vnode_pagein_cluster(
+    vm_page_t		*pages,
+    int			count,
+    int			*errorp
+)
+{
+	vm_page_t	m = pages[0];
 	struct vnode	*vp;
 	vnode_pager_t	vs;
 	pager_return_t	result = PAGER_SUCCESS;
@@ -733,6 +781,9 @@ vnode_pagein(
 	pf_entry	entry;
 	struct proc	*p = current_proc();
 	int		error = 0;
+	int		i;
+
+	assert(count > 0 && count <= VNODE_PAGER_CLUSTER_MAX);
 
 	unix_master();
 
@@ -741,6 +792,7 @@ vnode_pagein(
 	f_offset = m->offset + m->object->paging_offset;
 
 	if (vs->vs_swapfile) {
+	    assert(count == 1);
 	    if (pagerfile_bmap(vs, f_offset, B_READ, &entry) == KERN_FAILURE)
 		result = PAGER_ABSENT;
 	    else {
@@ -750,49 +802,66 @@ vnode_pagein(
 	}
 
 	if (result != PAGER_ABSENT) {
-	    vm_offset_t		ioaddr = vnode_pageio_setup(m);
+	    vm_offset_t		ioaddr[VNODE_PAGER_CLUSTER_MAX];
+	    struct iovec	aiov[VNODE_PAGER_CLUSTER_MAX];
 	    struct uio		auio;
-	    struct iovec	aiov;
 
-	    if (ioaddr) {
-		auio.uio_iov = &aiov;
-		auio.uio_iovcnt = 1;
+	    for (i = 0; i < count; i++) {
+		if ((ioaddr[i] = vnode_pageio_setup(pages[i])) == 0)
+		    break;
+		aiov[i].iov_base = (caddr_t)ioaddr[i];
+		aiov[i].iov_len = PAGE_SIZE;
+	    }
+
+	    if (i == count) {
+		auio.uio_iov = aiov;
+		auio.uio_iovcnt = count;
 		auio.uio_offset = f_offset;
 		auio.uio_segflg = UIO_SYSSPACE;
 		auio.uio_rw = UIO_READ;
-		auio.uio_resid = PAGE_SIZE;
+		auio.uio_resid = ptoa(count);
 		auio.uio_procp = NULL;
 
-		aiov.iov_len = PAGE_SIZE;
-		aiov.iov_base = (caddr_t)ioaddr;
-
 		vn_lock(vp, LK_EXCLUSIVE | LK_RETRY | LK_CANRECURSE, p);
 
-		m->nfspagereq=TRUE;
+		for (i = 0; i < count; i++)
+		    pages[i]->nfspagereq = TRUE;
+		vm_fault_stat_add(pagein_ios, 1);
 		error = VOP_PAGEIN(vp, &auio, 0, p->p_ucred);
-		m->nfspagereq=FALSE;
+		for (i = 0; i < count; i++)
+		    pages[i]->nfspagereq = FALSE;
 		if (error)
 		    result = PAGER_ERROR;
 		vp->v_vm_info->error = error;
 
 		VOP_UNLOCK(vp, 0, p);
 
+		/*
+		 * The uio has been advanced past what was read; zero
+		 * what is left of each page (the read stopped at end
+		 * of file).
+		 */
 		if (!error && auio.uio_resid > 0)
-		    (void) memset((void *)(ioaddr + PAGE_SIZE -
-					   auio.uio_resid), 0, auio.uio_resid);
+		    for (i = 0; i < count; i++)
+			if (aiov[i].iov_len > 0)
+			    (void) memset((void *)aiov[i].iov_base, 0,
+					  aiov[i].iov_len);
+	    }
+	    else
+		result = PAGER_ERROR;
 
-		vnode_pageio_complete(m, ioaddr);
+	    while (--i >= 0) {
+		vnode_pageio_complete(pages[i], ioaddr[i]);
 #ifdef	ppc
 		/*
 		 * After a pagein, we must synchronize the processor caches.
 		 * On PPC, the i-cache is not coherent in all models, thus
 		 * it needs to be invalidated.
 		 */
-		flush_cache(VM_PAGE_TO_PHYS(m), PAGE_SIZE);
+		if (result == PAGER_SUCCESS)
+		    flush_cache(VM_PAGE_TO_PHYS(pages[i]), PAGE_SIZE);
 #endif /* ppc */
 	    }
-	    else
-		result = PAGER_ERROR;
 	}
 
 	vnode_pager_vput(vs);
@@ -124,7 +124,14 @@ typedef struct vstruct {
 
 
 
+/*
+ *	Most pages vnode_pagein_cluster will read in one transfer.
+ */
+#define	VNODE_PAGER_CLUSTER_MAX	16
+
 pager_return_t	vnode_pagein();
+pager_return_t	vnode_pagein_cluster();
+int		vnode_pager_cluster_limit();
 pager_return_t	vnode_pageout();
 void		vnode_dealloc();
 vm_pager_t	vnode_alloc();
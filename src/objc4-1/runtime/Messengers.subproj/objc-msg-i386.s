@@ -49,12 +49,16 @@
 _objc_entryPoints:
 	.long	_objc_msgSend
 	.long	_objc_msgSendSuper
+	.long	__cache_getMethod
+	.long	__cache_getImp
 	.long	0
 
 .globl		_objc_exitPoints
 _objc_exitPoints:
 	.long	LMsgSendExit
 	.long	LMsgSendSuperExit
+	.long	LGetMethodExit
+	.long	LGetImpExit
 	.long	0
 #endif
 
@@ -582,6 +586,82 @@ LMsgSendSuperMTCacheMiss:
 LMsgSendSuperExit:
 	END_ENTRY	_objc_msgSendSuper
 
+#if defined(OBJC_COLLECTING_CACHE)
+/********************************************************************
+ * Method	_cache_getMethod	(Class	cls,
+ *								SEL		sel,
+ *								IMP		forwardImp);
+ *
+ * IMP		_cache_getImp		(Class	cls,
+ *								SEL		sel);
+ *
+ * Look for sel in the method cache of cls, without locking.  These
+ * are the runtime's own cache readers.  Like the messengers they are
+ * listed in _objc_entryPoints, so a cache is not freed while they are
+ * reading it.  _cache_getMethod returns the cache entry, or NULL if
+ * there is none or if its implementation is forwardImp: forward::
+ * entries are freed along with the cache, so they must not escape.
+ * _cache_getImp returns the entry's implementation, or NULL.
+ ********************************************************************/
+
+	ENTRY	__cache_getMethod
+	pushl	%edi					// save scratch register
+	pushl	%esi					// save scratch register
+	movl	12(%esp), %eax			// get class
+	movl	16(%esp), %ecx			// get selector
+	movl	cache(%eax), %eax		// cache = class->cache
+	leal	buckets(%eax), %edi		// buckets = &cache->buckets
+	movl	mask(%eax), %esi		// mask = cache->mask
+	movl	%ecx, %edx				// index = selector
+LGetMethodProbe:
+	andl	%esi, %edx				// index &= mask
+	movl	(%edi, %edx, 4), %eax	// method = buckets[index]
+	testl	%eax, %eax				// check for end of bucket
+	je		LGetMethodDone			// not found: return NULL
+	cmpl	method_name(%eax), %ecx	// check for method name match
+	je		LGetMethodHit			// go handle cache hit
+	inc		%edx					// bump index ...
+	jmp		LGetMethodProbe			// ... and loop
+LGetMethodHit:
+	movl	20(%esp), %ecx			// get forwardImp
+	cmpl	method_imp(%eax), %ecx	// forward:: entry?
+	jne		LGetMethodDone			// no: return method
+	xorl	%eax, %eax				// yes: return NULL
+LGetMethodDone:
+	popl	%esi					// restore callers register
+	popl	%edi					// restore callers register
+	ret
+LGetMethodExit:
+	END_ENTRY	__cache_getMethod
+
+	ENTRY	__cache_getImp
+	pushl	%edi					// save scratch register
+	pushl	%esi					// save scratch register
+	movl	12(%esp), %eax			// get class
+	movl	16(%esp), %ecx			// get selector
+	movl	cache(%eax), %eax		// cache = class->cache
+	leal	buckets(%eax), %edi		// buckets = &cache->buckets
+	movl	mask(%eax), %esi		// mask = cache->mask
+	movl	%ecx, %edx				// index = selector
+LGetImpProbe:
+	andl	%esi, %edx				// index &= mask
+	movl	(%edi, %edx, 4), %eax	// method = buckets[index]
+	testl	%eax, %eax				// check for end of bucket
+	je		LGetImpDone				// not found: return NULL
+	cmpl	method_name(%eax), %ecx	// check for method name match
+	je		LGetImpHit				// go handle cache hit
+	inc		%edx					// bump index ...
+	jmp		LGetImpProbe			// ... and loop
+LGetImpHit:
+	movl	method_imp(%eax), %eax	// imp = method->method_imp
+LGetImpDone:
+	popl	%esi					// restore callers register
+	popl	%edi					// restore callers register
+	ret
+LGetImpExit:
+	END_ENTRY	__cache_getImp
+#endif
+
 /********************************************************************
  * id		_objc_msgForward	(id	self,
  *								SEL	sel,
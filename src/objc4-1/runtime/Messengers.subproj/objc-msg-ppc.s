@@ -55,6 +55,8 @@ _objc_entryPoints:
 	.long	_objc_msgSend_stret
 	.long	_objc_msgSendSuper
 	.long	_objc_msgSendSuper_stret
+	.long	__cache_getMethod
+	.long	__cache_getImp
 	.long	0
 
 .globl _objc_exitPoints
@@ -63,6 +65,8 @@ _objc_exitPoints:
 	.long	LMsgSendStretExit
 	.long	LMsgSendSuperExit
 	.long	LMsgSendSuperStretExit
+	.long	LGetMethodExit
+	.long	LGetImpExit
 	.long	0
 #endif
 
@@ -903,6 +907,72 @@ LMsgSendSuperStretMTCacheMiss:
 LMsgSendSuperStretExit:
 	END_ENTRY	_objc_msgSendSuper_stret
 
+#if defined(OBJC_COLLECTING_CACHE)
+/********************************************************************
+ * Method	_cache_getMethod	(Class	cls,
+ *								SEL		sel,
+ *								IMP		forwardImp);
+ *
+ * IMP		_cache_getImp		(Class	cls,
+ *								SEL		sel);
+ *
+ * Look for sel in the method cache of cls, without locking.  These
+ * are the runtime's own cache readers.  Like the messengers they are
+ * listed in _objc_entryPoints, so a cache is not freed while they are
+ * reading it.  _cache_getMethod returns the cache entry, or NULL if
+ * there is none or if its implementation is forwardImp: forward::
+ * entries are freed along with the cache, so they must not escape.
+ * _cache_getImp returns the entry's implementation, or NULL.
+ *
+ * On entry:	r3 is the class,
+ *				r4 is the selector,
+ *				r5 is forwardImp (_cache_getMethod only)
+ ********************************************************************/
+
+	ENTRY	__cache_getMethod
+	lwz		r12,cache(r3)		; cache   = class->cache
+	lwz		r11,mask(r12)		; mask    = cache->mask
+	addi	r9,r12,buckets		; buckets = cache->buckets
+	and		r12,r4,r11			; index   = selector & mask
+LGetMethodLoop:
+	slwi	r0,r12,2			; convert word index into byte count
+	lwzx	r3,r9,r0			; method = cache->buckets[index]
+	cmplwi	r3,0				; if (method == NULL)
+	beqlr						;	return NULL
+	addi	r12,r12,1			; index += 1
+	lwz		r10,method_name(r3)	; name  = method->method_name
+	and		r12,r12,r11			; index &= mask
+	cmplw	r10,r4				; if (name != selector)
+	bne		LGetMethodLoop		;	goto loop
+	lwz		r10,method_imp(r3)	; if (method->method_imp != forwardImp)
+	cmplw	r10,r5				;
+	bnelr						;	return method
+	li		r3,0				; return NULL
+	blr
+LGetMethodExit:
+	END_ENTRY	__cache_getMethod
+
+	ENTRY	__cache_getImp
+	lwz		r12,cache(r3)		; cache   = class->cache
+	lwz		r11,mask(r12)		; mask    = cache->mask
+	addi	r9,r12,buckets		; buckets = cache->buckets
+	and		r12,r4,r11			; index   = selector & mask
+LGetImpLoop:
+	slwi	r0,r12,2			; convert word index into byte count
+	lwzx	r3,r9,r0			; method = cache->buckets[index]
+	cmplwi	r3,0				; if (method == NULL)
+	beqlr						;	return NULL
+	addi	r12,r12,1			; index += 1
+	lwz		r10,method_name(r3)	; name  = method->method_name
+	and		r12,r12,r11			; index &= mask
+	cmplw	r10,r4				; if (name != selector)
+	bne		LGetImpLoop			;	goto loop
+	lwz		r3,method_imp(r3)	; return method->method_imp
+	blr
+LGetImpExit:
+	END_ENTRY	__cache_getImp
+#endif
+
 /********************************************************************
  *
  * Out-of-band parameter r11 indicates whether it was objc_msgSend or
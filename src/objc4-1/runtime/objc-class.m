@@ -150,8 +150,38 @@ typedef struct CacheInstrumentation	CacheInstrumentation;
 
 // Cache instrumentation data follows table, so it is most compatible
 #define CACHE_INSTRUMENTATION(cache)	(CacheInstrumentation *) &cache->buckets[cache->mask + 1];
+#define CACHE_INSTRUMENTATION_SIZE	sizeof(CacheInstrumentation)
+#else
+#define CACHE_INSTRUMENTATION_SIZE	0
 #endif
 
+// Per-cache history used to size the cache.  Kept in every build,
+// after the table and any instrumentation data.  When a full cache
+// is emptied for re-use, the selectors it held are remembered in
+// evicted[], a one-hash bit filter; a fill of a selector found there
+// is a refill, a miss that a bigger cache would have avoided.
+enum {
+	CACHE_EVICTED_WORDS	= 8,
+	CACHE_EVICTED_BITS	= CACHE_EVICTED_WORDS * 32
+};
+
+struct CacheInfo
+{
+	unsigned int	fills;			// entries added since last emptied
+	unsigned int	refills;		// of those, ones evicted last time
+	unsigned int	evicted[CACHE_EVICTED_WORDS];	// evicted selector filter
+	unsigned int	missCount;		// total entries added
+	unsigned int	flushCount;		// times emptied, for re-use or flush
+	unsigned int	growCount;		// times doubled
+};
+typedef struct CacheInfo	CacheInfo;
+
+#define CACHE_INFO(cache)	((CacheInfo *) ((char *) &(cache)->buckets[(cache)->mask + 1] + CACHE_INSTRUMENTATION_SIZE))
+#define CACHE_EVICTED_BIT(sel)	((((uarith_t) (sel)) >> 2) % CACHE_EVICTED_BITS)
+
+// Bytes to allocate for a cache of count buckets
+#define CACHE_SIZE(count)	(sizeof(struct objc_cache) + TABLE_SIZE(count) + CACHE_INSTRUMENTATION_SIZE + sizeof(CacheInfo))
+
 /***********************************************************************
  * Function prototypes internal to this module.
  **********************************************************************/
@@ -195,10 +225,11 @@ static void		PrintCacheHistogram		(char * title, unsigned int * firstEntry, unsi
 // (larger) caches start out empty.
 static int	_class_uncache		= 1;
 
-// When _class_slow_grow is non-zero, any given cache is actually grown
-// only on the odd-numbered times it becomes full; on the even-numbered
-// times, it is simply emptied and re-used.  When this flag is zero,
-// caches are grown every time.
+// When _class_slow_grow is non-zero, a cache that becomes full is
+// grown only if it is missing on selectors it had to evict before;
+// otherwise it is simply emptied and re-used.  So classes whose
+// working set fits stay small, and classes that thrash grow.  When
+// this flag is zero, caches are grown every time.
 static int	_class_slow_grow	= 1;
 
 // Locks for cache access
@@ -1254,14 +1285,28 @@ BOOL	class_respondsToMethod	       (Class		cls,
 					SEL		sel)
 {
 	Class				thisCls;
+#ifdef OBJC_CACHE_PROBE
+	IMP					imp;
+#else
 	arith_t				index;
 	arith_t				mask;
 	Method *			buckets;
+#endif
 	
 	// No one responds to zero!
 	if (!sel) 
 		return NO;
 
+#ifdef OBJC_CACHE_PROBE
+	// Look in the cache of the specified class.  The probe is safe
+	// without the lock, just as objc_msgSend's is.
+	imp = _cache_getImp (cls, sel);
+	if (imp)
+		return (imp == &_objc_msgForward) ? NO : YES;
+
+	// Synchronize access to caches
+	OBJC_LOCK(&messageLock);
+#else
 	// Synchronize access to caches
 	OBJC_LOCK(&messageLock);
 
@@ -1288,6 +1333,7 @@ BOOL	class_respondsToMethod	       (Class		cls,
 		index += 1;
 		index &= mask;
 	}
+#endif
 
 	// Handle cache miss
 	// Outer loop - search the method lists of the class and its super-classes
@@ -1362,15 +1408,26 @@ BOOL	class_respondsToMethod	       (Class		cls,
 IMP		class_lookupMethod	       (Class		cls,
 						SEL		sel)
 {
+#ifndef OBJC_CACHE_PROBE
 	Method *	buckets;
 	arith_t		index;
 	arith_t		mask;
+#endif
 	IMP		result;
 	
 	// No one responds to zero!
 	if (!sel) 
 		[(id) cls error:_errBadSel, sel];
 
+#ifdef OBJC_CACHE_PROBE
+	// Scan the cache, without locking
+	result = _cache_getImp (cls, sel);
+	if (result)
+		return result;
+
+	// Synchronize access to caches
+	OBJC_LOCK(&messageLock);
+#else
 	// Synchronize access to caches
 	OBJC_LOCK(&messageLock);
 
@@ -1390,6 +1447,7 @@ IMP		class_lookupMethod	       (Class		cls,
 		index += 1;
 		index &= mask;
 	}
+#endif
 
 	// Handle cache miss
 	result = _class_lookupMethodAndLoadCache (cls, sel);
@@ -1445,14 +1503,7 @@ Cache		_cache_create		(Class		cls)
 	slotCount = (ISMETA(cls)) ? INIT_META_CACHE_SIZE : INIT_CACHE_SIZE;
 
 	// Allocate table (why not check for failure?)
-#ifdef OBJC_INSTRUMENTED
-	new_cache = NXZoneMalloc (NXDefaultMallocZone (),
-			sizeof(struct objc_cache) + TABLE_SIZE(slotCount)
-			 + sizeof(CacheInstrumentation));
-#else
-	new_cache = NXZoneMalloc (NXDefaultMallocZone (),
-			sizeof(struct objc_cache) + TABLE_SIZE(slotCount));
-#endif
+	new_cache = NXZoneMalloc (NXDefaultMallocZone (), CACHE_SIZE(slotCount));
 
 	// Invalidate all the buckets
 	for (index = 0; index < slotCount; index += 1)
@@ -1474,6 +1525,9 @@ Cache		_cache_create		(Class		cls)
 	}
 #endif
 
+	// Start with no sizing history
+	bzero ((char *) CACHE_INFO(new_cache), sizeof(CacheInfo));
+
 	// Install the cache
 	cls->cache = new_cache;
 
@@ -1481,12 +1535,6 @@ Cache		_cache_create		(Class		cls)
 	// before expanding it for the first time.
 	cls->info &= ~(CLS_FLUSH_CACHE);
 
-	// Clear the grow flag so that we will re-use the current storage,
-	// rather than actually grow the cache, when expanding the cache
-	// for the first time
-	if (_class_slow_grow)
-		cls->info &= ~(CLS_GROW_CACHE);
-
 	// Return our creation
 	return new_cache;
 }
@@ -1504,6 +1552,8 @@ static	Cache		_cache_expand	       (Class		cls)
 {
 	Cache		old_cache;
 	Cache		new_cache;
+	CacheInfo *	oldInfo;
+	CacheInfo *	newInfo;
 	unsigned int	slotCount;
 	unsigned int	index;
 
@@ -1513,66 +1563,62 @@ static	Cache		_cache_expand	       (Class		cls)
 		return _cache_create (cls);
 
 	// iff _class_slow_grow, trade off actual cache growth with re-using
-	// the current one, so that growth only happens every odd time
-	if (_class_slow_grow)
+	// the current one.  Grow only when at least half the entries added
+	// since the cache was last emptied had been evicted that time, i.e.
+	// when the misses are for lack of room rather than for selectors
+	// the class has simply not sent before.
+	oldInfo = CACHE_INFO(old_cache);
+	if (_class_slow_grow && (oldInfo->refills * 2 < oldInfo->fills))
 	{
-		// CLS_GROW_CACHE controls every-other-time behavior.  If it
-		// is non-zero, let the cache grow this time, but clear the
-		// flag so the cache is reused next time
-		if ((cls->info & CLS_GROW_CACHE) != 0)
-			cls->info &= ~CLS_GROW_CACHE;
+		// Reuse the current cache storage this time.  Clear the
+		// valid-entry counter
+		old_cache->occupied = 0;
 
-		// Reuse the current cache storage this time
-		else
+		// Forget the old evictions; remember these instead
+		bzero ((char *) oldInfo->evicted, sizeof(oldInfo->evicted));
+		oldInfo->fills = 0;
+		oldInfo->refills = 0;
+		oldInfo->flushCount += 1;
+
+		// Invalidate all the cache entries
+		for (index = 0; index < old_cache->mask + 1; index += 1)
 		{
-			// Clear the valid-entry counter
-			old_cache->occupied = 0;
+			// Remember what this entry was, so we can possibly
+			// deallocate it after the bucket has been invalidated
+			Method		oldEntry = old_cache->buckets[index];
+			unsigned int	bit;
 
-			// Invalidate all the cache entries
-			for (index = 0; index < old_cache->mask + 1; index += 1)
-			{
-				// Remember what this entry was, so we can possibly
-				// deallocate it after the bucket has been invalidated
-				Method		oldEntry = old_cache->buckets[index];
-				// Skip invalid entry
-				if (!CACHE_BUCKET_VALID(old_cache->buckets[index]))
-					continue;
+			// Skip invalid entry
+			if (!CACHE_BUCKET_VALID(old_cache->buckets[index]))
+				continue;
 
-				// Invalidate this entry
-				CACHE_BUCKET_VALID(old_cache->buckets[index]) = NULL;
-					
-				// Deallocate "forward::" entry
-				if (CACHE_BUCKET_IMP(oldEntry) == &_objc_msgForward)
-				{
+			// Note the eviction
+			bit = CACHE_EVICTED_BIT(CACHE_BUCKET_NAME(oldEntry));
+			oldInfo->evicted[bit >> 5] |= 1 << (bit & 31);
+
+			// Invalidate this entry
+			CACHE_BUCKET_VALID(old_cache->buckets[index]) = NULL;
+				
+			// Deallocate "forward::" entry
+			if (CACHE_BUCKET_IMP(oldEntry) == &_objc_msgForward)
+			{
 #ifdef OBJC_COLLECTING_CACHE
-					_cache_collect_free (oldEntry, NO);
+				_cache_collect_free (oldEntry, NO);
 #else
-					NXZoneFree (NXDefaultMallocZone (), oldEntry);
+				NXZoneFree (NXDefaultMallocZone (), oldEntry);
 #endif
-				}
 			}
-			
-			// Set the slow growth flag so the cache is next grown
-			cls->info |= CLS_GROW_CACHE;
-			
-			// Return the same old cache, freshly emptied
-			return old_cache;
 		}
 		
+		// Return the same old cache, freshly emptied
+		return old_cache;
 	}
 
 	// Double the cache size
 	slotCount = (old_cache->mask + 1) << 1;
 	
 	// Allocate a new cache table
-#ifdef OBJC_INSTRUMENTED
-	new_cache = NXZoneMalloc (NXDefaultMallocZone (),
-			sizeof(struct objc_cache) + TABLE_SIZE(slotCount)
-			 + sizeof(CacheInstrumentation));
-#else
-	new_cache = NXZoneMalloc (NXDefaultMallocZone (),
-			sizeof(struct objc_cache) + TABLE_SIZE(slotCount));
-#endif
+	new_cache = NXZoneMalloc (NXDefaultMallocZone (), CACHE_SIZE(slotCount));
 
 	// Zero out the new cache
 	new_cache->mask = slotCount - 1;
@@ -1592,6 +1638,13 @@ static	Cache		_cache_expand	       (Class		cls)
 	}
 #endif
 
+	// Carry the totals over; the new size starts a new history
+	newInfo = CACHE_INFO(new_cache);
+	bzero ((char *) newInfo, sizeof(CacheInfo));
+	newInfo->missCount	= oldInfo->missCount;
+	newInfo->flushCount	= oldInfo->flushCount;
+	newInfo->growCount	= oldInfo->growCount + 1;
+
 	// iff _class_uncache, copy old cache entries into the new cache
 	if (_class_uncache == 0)
 	{
@@ -1841,6 +1894,17 @@ static	void	_cache_fill    (Class		cls,
 		cache->occupied += 1;
 	}
 	
+	// Keep the sizing history
+	{
+	CacheInfo *		info = CACHE_INFO(cache);
+	unsigned int	bit = CACHE_EVICTED_BIT(sel);
+
+	info->fills += 1;
+	info->missCount += 1;
+	if (info->evicted[bit >> 5] & (1 << (bit & 31)))
+		info->refills += 1;
+	}
+
 	// Insert the new entry.  This can be done by either:
 	// 	(a) Scanning for the first unused spot.  Easy!
 	//	(b) Opening up an unused spot by sliding existing
@@ -1910,6 +1974,17 @@ static void	_cache_flush		(Class		cls)
 		cacheData->maxFlushedEntries = cache->occupied;
 	}
 #endif
+
+	// Tally this flush.  The entries are not evicted for lack of room,
+	// so refilling them says nothing about the cache size.
+	{
+	CacheInfo *	info = CACHE_INFO(cache);
+
+	info->flushCount += 1;
+	info->fills = 0;
+	info->refills = 0;
+	bzero ((char *) info->evicted, sizeof(info->evicted));
+	}
 	
 	// Traverse the cache
 	for (index = 0; index <= cache->mask; index += 1)
@@ -1996,20 +2071,55 @@ IMP	_class_lookupMethodAndLoadCache	   (Class	cls,
 	if (!ISINITIALIZED(cls))
 		class_initialize (objc_getClass (cls->name));
 	
+#ifdef OBJC_CACHE_PROBE
+	// The class' own cache may hold the method (or a "forward::"
+	// entry) if +initialize sent it; see the note in minor loop #1.
+	methodPC = _cache_getImp (cls, sel);
+#else
+	methodPC = NULL;
+#endif
+
 	// Outer loop - search the caches and method lists of the
 	// class and its super-classes
-	methodPC = NULL;
-	for (curClass = cls; curClass; curClass = curClass->super_class)
+	for (curClass = cls; curClass && !methodPC; curClass = curClass->super_class)
 	{
 		struct objc_method_list **	methodLists;
+#ifndef OBJC_CACHE_PROBE
 		Method *					buckets;
 		arith_t						idx;
 		arith_t						mask;
+#endif
 		arith_t						methodCount;
 #ifdef PRELOAD_SUPERCLASS_CACHES
 		Class						curClass2;
 #endif
 
+#ifdef OBJC_CACHE_PROBE
+		// Minor loop #1 - check cache of given class.  "forward::"
+		// entries are not returned: they belong to the cache they
+		// are in, and are freed with it.
+		smt = _cache_getMethod (curClass, sel, &_objc_msgForward);
+		if (smt)
+		{
+			// Found the method.  Add it to the cache(s) unless it
+			// was found in the cache of the class originally being
+			// messaged (see below).
+			if (curClass != cls)
+			{
+#ifdef PRELOAD_SUPERCLASS_CACHES
+				for (curClass2 = cls; curClass2 != curClass; curClass2 = curClass2->super_class)
+					_cache_fill (curClass2, smt, sel);
+				_cache_fill (curClass, smt, sel);
+#else
+				_cache_fill (cls, smt, sel);
+#endif
+			}
+
+			// Return the implementation address
+			methodPC = smt->method_imp;
+			break;
+		}
+#else
 		mask    = curClass->cache->mask;
 		buckets	= curClass->cache->buckets;
 
@@ -2052,6 +2162,7 @@ IMP	_class_lookupMethodAndLoadCache	   (Class	cls,
 			methodPC = CACHE_BUCKET_IMP(buckets[idx]);
 			break;
 		}
+#endif
 
 		// Done if that found it
 		if (methodPC)
@@ -2872,6 +2983,64 @@ static void	PrintCacheHistogram    (char *		title,
 }
 #endif
 
+/***********************************************************************
+ * _class_printCacheStatsByClass.  One line per class and metaclass
+ * cache that has been used: its size and entries, and how often it
+ * missed, was emptied, and grew.  Hits are counted by the messengers
+ * only in OBJC_INSTRUMENTED builds.
+ *
+ * Registered with atexit () when OBJC_PRINT_CACHE_STATS is set.
+ **********************************************************************/
+void		_class_printCacheStatsByClass		(void)
+{
+	NXHashTable *	class_hash;
+	NXHashState		state;
+	Class			cls;
+	unsigned int	isMeta;
+
+	_NXLogError ("%-32s %6s %6s %10s %10s %8s %6s\n",
+				 "class", "slots", "used", "hits", "misses", "flushes", "grows");
+
+	class_hash = objc_getClasses ();
+	state	   = NXInitHashState (class_hash);
+	while (NXNextHashState (class_hash, &state, (void **) &cls))
+	{
+		for (isMeta = 0; isMeta <= 1; isMeta += 1)
+		{
+			Cache		cache;
+			CacheInfo *	info;
+			char		name[32];
+			char		hits[16];
+
+			// Skip caches never filled
+			cache = isMeta ? cls->isa->cache : cls->cache;
+			if (cache == &emptyCache)
+				continue;
+			info = CACHE_INFO(cache);
+
+			sprintf (name, "%c%.30s", isMeta ? '+' : '-', cls->name);
+#ifdef OBJC_INSTRUMENTED
+			{
+			CacheInstrumentation *	cacheData;
+
+			cacheData = CACHE_INSTRUMENTATION(cache);
+			sprintf (hits, "%u", cacheData->hitCount);
+			}
+#else
+			strcpy (hits, "-");
+#endif
+			_NXLogError ("%-32s %6u %6u %10s %10u %8u %6u\n",
+						 name,
+						 cache->mask + 1,
+						 cache->occupied,
+						 hits,
+						 info->missCount,
+						 info->flushCount,
+						 info->growCount);
+		}
+	}
+}
+
 /***********************************************************************
  * _class_printMethodCacheStatistics.
  **********************************************************************/
@@ -43,6 +43,14 @@
     #endif
 #endif
 
+// OBJC_CACHE_PROBE says the messenger also provides _cache_getMethod
+// and _cache_getImp, which let the runtime itself look in a method
+// cache without taking messageLock.  They sit inside the collecting
+// cache's critical regions, so they need OBJC_COLLECTING_CACHE.
+#if defined(OBJC_COLLECTING_CACHE) && (defined(i386) || defined(ppc))
+    #define OBJC_CACHE_PROBE
+#endif
+
 // Turn on support for class refs
 #define OBJC_CLASS_REFS
 
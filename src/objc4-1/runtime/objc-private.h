@@ -164,6 +164,11 @@
     OBJC_EXPORT Cache _cache_create(Class);
     OBJC_EXPORT IMP _class_lookupMethodAndLoadCache(Class, SEL);
     OBJC_EXPORT id _objc_msgForward (id self, SEL sel, ...);
+    #if defined(OBJC_CACHE_PROBE)
+    OBJC_EXPORT Method _cache_getMethod(Class, SEL, IMP);
+    OBJC_EXPORT IMP _cache_getImp(Class, SEL);
+    #endif
+    OBJC_EXPORT void _class_printCacheStatsByClass(void);
 
     /* errors */
     OBJC_EXPORT volatile void __S(_objc_fatal)(const char *message);
@@ -2266,6 +2266,8 @@ void	_objcInit	       (void)
 	// Get our configuration
 	rocketLaunching	     = _dyld_launched_prebound () && (getenv ("OBJC_DISABLE_OBJCUNIQUE") == 0);
 	rocketLaunchingDebug = (getenv ("OBJC_UNIQUE_DEBUG") != 0);
+	if (getenv ("OBJC_PRINT_CACHE_STATS"))
+		atexit (_class_printCacheStatsByClass);
 	if (getenv ("OBJC_INIT_TIME"))
 	{
 		getrusage (RUSAGE_SELF, &r1);